@@ -1,12 +1,18 @@
 #include "address_resolver.h"
+#include "stage_trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <elf.h>
 #include <link.h>
 #include <dlfcn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
 //#include <cxxabi.h>
 
 // Symbol cache entry
@@ -16,6 +22,13 @@ typedef struct cache_entry {
     struct cache_entry *next;
 } cache_entry_t;
 
+// Function from the ELF symbol table; the name indexes the copied string table
+typedef struct {
+    uint64_t address;
+    uint64_t size;
+    uint32_t name_offset;
+} elf_function_t;
+
 // Internal resolver structure
 struct address_resolver {
     pid_t pid;
@@ -31,10 +44,17 @@ struct address_resolver {
     size_t cache_entries;
     size_t max_cache_entries;
     
-    // addr2line process for source resolution
+    // addr2line process for source resolution; one socket carries both ways
     FILE *addr2line_pipe;
     pid_t addr2line_pid;
     
+    // Function symbols sorted by link-time address
+    elf_function_t *functions;
+    int function_count;
+    char *symbol_names;
+    uint64_t load_bias;          // Runtime minus link-time address (PIE)
+    bool has_process_maps;       // Mappings came from /proc, not a guess
+    
     pthread_mutex_t mutex;
 };
 
@@ -74,9 +94,12 @@ void address_resolver_destroy(address_resolver_t *resolver) {
     
     LOG_INFO("Destroying address resolver");
     
-    // Close addr2line pipe
+    // Closing the socket ends addr2line's input
     if (resolver->addr2line_pipe) {
-        pclose(resolver->addr2line_pipe);
+        fclose(resolver->addr2line_pipe);
+    }
+    if (resolver->addr2line_pid > 0) {
+        waitpid(resolver->addr2line_pid, NULL, 0);
     }
     
     // Free mappings
@@ -84,6 +107,14 @@ void address_resolver_destroy(address_resolver_t *resolver) {
         FREE_LOGGED(resolver->mappings);
     }
     
+    // Free symbol table
+    if (resolver->functions) {
+        FREE_LOGGED(resolver->functions);
+    }
+    if (resolver->symbol_names) {
+        FREE_LOGGED(resolver->symbol_names);
+    }
+    
     // Free cache
     if (resolver->cache_table) {
         for (size_t i = 0; i < resolver->cache_size; i++) {
@@ -102,13 +133,19 @@ void address_resolver_destroy(address_resolver_t *resolver) {
 }
 
 // Parse /proc/pid/maps
-static int parse_proc_maps(address_resolver_t *resolver) {
-    char maps_path[256];
+int address_resolver_read_maps(pid_t pid, memory_mapping_t **mappings, int *count) {
+    if (!mappings || !count) {
+        LOG_ERROR("Invalid parameters for address_resolver_read_maps");
+        return -1;
+    }
+    *mappings = NULL;
+    *count = 0;
     
-    if (resolver->pid == 0 || resolver->pid == getpid()) {
+    char maps_path[256];
+    if (pid == 0 || pid == getpid()) {
         snprintf(maps_path, sizeof(maps_path), "/proc/self/maps");
     } else {
-        snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps", resolver->pid);
+        snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps", pid);
     }
     
     FILE *fp = fopen(maps_path, "r");
@@ -119,14 +156,14 @@ static int parse_proc_maps(address_resolver_t *resolver) {
     
     // Count mappings
     char line[512];
-    int count = 0;
+    int capacity = 0;
     while (fgets(line, sizeof(line), fp)) {
-        count++;
+        capacity++;
     }
     
     // Allocate mappings array
-    resolver->mappings = CALLOC_LOGGED(count, sizeof(memory_mapping_t));
-    if (!resolver->mappings) {
+    memory_mapping_t *parsed = CALLOC_LOGGED(capacity > 0 ? capacity : 1, sizeof(memory_mapping_t));
+    if (!parsed) {
         fclose(fp);
         return -1;
     }
@@ -134,8 +171,8 @@ static int parse_proc_maps(address_resolver_t *resolver) {
     // Parse mappings
     rewind(fp);
     int idx = 0;
-    while (fgets(line, sizeof(line), fp) && idx < count) {
-        memory_mapping_t *map = &resolver->mappings[idx];
+    while (fgets(line, sizeof(line), fp) && idx < capacity) {
+        memory_mapping_t *map = &parsed[idx];
         char perms[5];
         int ret = sscanf(line, "%lx-%lx %4s %lx %*x:%*x %*d %255s",
                         &map->start_addr, &map->end_addr, perms,
@@ -155,11 +192,42 @@ static int parse_proc_maps(address_resolver_t *resolver) {
             idx++;
         }
     }
-    
-    resolver->mapping_count = idx;
     fclose(fp);
     
-    LOG_INFO("Parsed %d memory mappings", resolver->mapping_count);
+    *mappings = parsed;
+    *count = idx;
+    LOG_INFO("Parsed %d memory mappings from %s", idx, maps_path);
+    return 0;
+}
+
+static int parse_proc_maps(address_resolver_t *resolver) {
+    return address_resolver_read_maps(resolver->pid, &resolver->mappings, &resolver->mapping_count);
+}
+
+// Use mappings captured earlier, e.g. while a since-exited process was sampled
+int address_resolver_set_mappings(address_resolver_t *resolver,
+                                const memory_mapping_t *mappings, int count) {
+    if (!resolver || !mappings || count <= 0) {
+        LOG_ERROR("Invalid parameters for address_resolver_set_mappings");
+        return -1;
+    }
+    
+    memory_mapping_t *copy = MALLOC_LOGGED(count * sizeof(memory_mapping_t));
+    if (!copy) {
+        LOG_ERROR("Failed to allocate %d mappings", count);
+        return -1;
+    }
+    memcpy(copy, mappings, count * sizeof(memory_mapping_t));
+    
+    pthread_mutex_lock(&resolver->mutex);
+    if (resolver->mappings) {
+        FREE_LOGGED(resolver->mappings);
+    }
+    resolver->mappings = copy;
+    resolver->mapping_count = count;
+    resolver->has_process_maps = true;
+    pthread_mutex_unlock(&resolver->mutex);
+    
     return 0;
 }
 
@@ -180,6 +248,8 @@ int address_resolver_init_process(address_resolver_t *resolver) {
         return -1;
     }
     
+    resolver->has_process_maps = true;
+    
     // Find main executable
     for (int i = 0; i < resolver->mapping_count; i++) {
         if (resolver->mappings[i].is_executable &&
@@ -208,7 +278,10 @@ int address_resolver_init_binary(address_resolver_t *resolver, const char *binar
     
     pthread_mutex_lock(&resolver->mutex);
     
-    strncpy(resolver->binary_path, binary_path, sizeof(resolver->binary_path) - 1);
+    // /proc maps name files by their canonical path
+    char canonical[PATH_MAX];
+    const char *path = realpath(binary_path, canonical) ? canonical : binary_path;
+    strncpy(resolver->binary_path, path, sizeof(resolver->binary_path) - 1);
     
     // For standalone binary analysis, create minimal mapping
     if (resolver->mapping_count == 0) {
@@ -240,19 +313,41 @@ static int start_addr2line(address_resolver_t *resolver) {
         return -1;
     }
     
-    char cmd[512];
-    snprintf(cmd, sizeof(cmd), "addr2line -e %s -f -C", resolver->binary_path);
+    // popen() is one-way on Linux; a socket pair carries queries and answers,
+    // and send() with MSG_NOSIGNAL survives an addr2line that failed to start
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        LOG_ERROR("Failed to start addr2line: %s", strerror(errno));
+        return -1;
+    }
     
-    resolver->addr2line_pipe = popen(cmd, "r+");
-    if (!resolver->addr2line_pipe) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(sv[1], STDIN_FILENO);
+        dup2(sv[1], STDOUT_FILENO);
+        close(sv[0]);
+        close(sv[1]);
+        execlp("addr2line", "addr2line", "-e", resolver->binary_path, "-f", "-C", (char *)NULL);
+        _exit(127);
+    }
+    close(sv[1]);
+    if (pid < 0) {
         LOG_ERROR("Failed to start addr2line: %s", strerror(errno));
+        close(sv[0]);
         return -1;
     }
     
-    // Set to line buffered
-    setlinebuf(resolver->addr2line_pipe);
+    resolver->addr2line_pid = pid;
+    resolver->addr2line_pipe = fdopen(sv[0], "r");
+    if (!resolver->addr2line_pipe) {
+        LOG_ERROR("Failed to open addr2line socket");
+        close(sv[0]);
+        waitpid(pid, NULL, 0);
+        resolver->addr2line_pid = 0;
+        return -1;
+    }
     
-    LOG_DEBUG("Started addr2line process");
+    LOG_DEBUG("Started addr2line process %d", (int)pid);
     return 0;
 }
 
@@ -306,9 +401,14 @@ int address_resolver_resolve(address_resolver_t *resolver,
         return -1;
     }
     
-    // Query addr2line
-    fprintf(resolver->addr2line_pipe, "0x%lx\n", address);
-    fflush(resolver->addr2line_pipe);
+    // Query addr2line with the link-time address
+    char query[32];
+    int query_length = snprintf(query, sizeof(query), "0x%lx\n", address - resolver->load_bias);
+    if (send(fileno(resolver->addr2line_pipe), query, query_length, MSG_NOSIGNAL) != query_length) {
+        LOG_WARNING("addr2line is not accepting queries: %s", strerror(errno));
+        pthread_mutex_unlock(&resolver->mutex);
+        return -1;
+    }
     
     // Read function name
     char line[1024];
@@ -379,6 +479,8 @@ int address_resolver_resolve_batch(address_resolver_t *resolver,
         LOG_ERROR("Invalid parameters for address_resolver_resolve_batch");
         return -1;
     }
+    TRACE_SCOPE(trace, "symbols.resolve_batch");
+    trace_add_items(&trace, count);
     
     LOG_INFO("Resolving batch of %d addresses", count);
     
@@ -433,6 +535,108 @@ int address_resolver_get_line_info(address_resolver_t *resolver,
     return -1;
 }
 
+// Line table lookup: all addresses go to a single addr2line run
+int address_resolver_resolve_lines(address_resolver_t *resolver,
+                                 const uint64_t *addresses, int count,
+                                 source_location_t *locations) {
+    if (!resolver || !addresses || !locations || count <= 0) {
+        LOG_ERROR("Invalid parameters for address_resolver_resolve_lines");
+        return -1;
+    }
+    TRACE_SCOPE(trace, "symbols.resolve_lines");
+    trace_add_items(&trace, count);
+    
+    if (strlen(resolver->binary_path) == 0) {
+        LOG_ERROR("No binary path set for line table lookup");
+        return -1;
+    }
+    
+    memset(locations, 0, count * sizeof(source_location_t));
+    
+    char input_path[] = "/tmp/cachesight_addrXXXXXX";
+    int fd = mkstemp(input_path);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create address list: %s", strerror(errno));
+        return -1;
+    }
+    
+    FILE *input = fdopen(fd, "w");
+    if (!input) {
+        close(fd);
+        unlink(input_path);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        fprintf(input, "0x%lx\n", addresses[i] - resolver->load_bias);
+    }
+    fclose(input);
+    
+    // The list is addr2line's stdin; the name can go once it is open
+    int input_fd = open(input_path, O_RDONLY);
+    unlink(input_path);
+    int out_pipe[2];
+    if (input_fd < 0 || pipe(out_pipe) != 0) {
+        LOG_ERROR("Failed to start addr2line: %s", strerror(errno));
+        if (input_fd >= 0) close(input_fd);
+        return -1;
+    }
+    
+    // Without -C names stay mangled, as compilers expect in profiles. The
+    // binary path is an argument, never shell text
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(input_fd, STDIN_FILENO);
+        dup2(out_pipe[1], STDOUT_FILENO);
+        close(input_fd);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        execlp("addr2line", "addr2line", "-e", resolver->binary_path, "-f", (char *)NULL);
+        _exit(127);
+    }
+    close(input_fd);
+    close(out_pipe[1]);
+    FILE *output = pid > 0 ? fdopen(out_pipe[0], "r") : NULL;
+    if (!output) {
+        LOG_ERROR("Failed to start addr2line: %s", strerror(errno));
+        close(out_pipe[0]);
+        if (pid > 0) waitpid(pid, NULL, 0);
+        return -1;
+    }
+    
+    // Two lines per address: function, then file:line
+    int resolved = 0;
+    char line[1024];
+    for (int i = 0; i < count && fgets(line, sizeof(line), output); i++) {
+        source_location_t *location = &locations[i];
+        line[strcspn(line, "\n")] = '\0';
+        if (strcmp(line, "??") != 0) {
+            strncpy(location->function, line, sizeof(location->function) - 1);
+        }
+        
+        if (!fgets(line, sizeof(line), output)) break;
+        line[strcspn(line, "\n")] = '\0';
+        
+        // "file:line (discriminator n)"
+        char *space = strchr(line, ' ');
+        if (space) *space = '\0';
+        char *colon = strrchr(line, ':');
+        if (!colon || strncmp(line, "??", 2) == 0) continue;
+        
+        *colon = '\0';
+        location->line = atoi(colon + 1);
+        if (location->line > 0) {
+            strncpy(location->file, line, sizeof(location->file) - 1);
+            resolved++;
+        }
+    }
+    
+    fclose(output);
+    waitpid(pid, NULL, 0);
+    
+    LOG_INFO("Resolved line info for %d of %d addresses", resolved, count);
+    return resolved;
+}
+
 // Get memory mappings
 int address_resolver_get_mappings(address_resolver_t *resolver,
                                 memory_mapping_t **mappings, int *count) {
@@ -490,6 +694,182 @@ const memory_mapping_t* address_resolver_find_mapping(address_resolver_t *resolv
     return NULL;
 }
 
+static int compare_elf_functions(const void *a, const void *b) {
+    const elf_function_t *fa = a;
+    const elf_function_t *fb = b;
+    return fa->address < fb->address ? -1 : fa->address > fb->address;
+}
+
+// Load function symbols from .symtab, or .dynsym for stripped binaries
+int address_resolver_load_symbols(address_resolver_t *resolver) {
+    if (!resolver || strlen(resolver->binary_path) == 0) {
+        LOG_ERROR("No binary to load symbols from");
+        return -1;
+    }
+    TRACE_SCOPE(trace, "symbols.load");
+    
+    int fd = open(resolver->binary_path, O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open %s: %s", resolver->binary_path, strerror(errno));
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Elf64_Ehdr)) {
+        close(fd);
+        return -1;
+    }
+    
+    size_t size = st.st_size;
+    const uint8_t *image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        LOG_ERROR("Failed to map %s: %s", resolver->binary_path, strerror(errno));
+        return -1;
+    }
+    
+    const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)image;
+    if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+        ehdr->e_shoff + (uint64_t)ehdr->e_shnum * sizeof(Elf64_Shdr) > size) {
+        LOG_ERROR("%s is not a 64-bit ELF file", resolver->binary_path);
+        munmap((void *)image, size);
+        return -1;
+    }
+    
+    const Elf64_Shdr *sections = (const Elf64_Shdr *)(image + ehdr->e_shoff);
+    const Elf64_Shdr *symtab = NULL;
+    for (int i = 0; i < ehdr->e_shnum; i++) {
+        if (sections[i].sh_type == SHT_SYMTAB) {
+            symtab = &sections[i];
+            break;
+        }
+        if (sections[i].sh_type == SHT_DYNSYM) symtab = &sections[i];
+    }
+    
+    if (!symtab || symtab->sh_link >= ehdr->e_shnum ||
+        symtab->sh_offset + symtab->sh_size > size ||
+        sections[symtab->sh_link].sh_offset + sections[symtab->sh_link].sh_size > size) {
+        LOG_ERROR("No symbol table in %s", resolver->binary_path);
+        munmap((void *)image, size);
+        return -1;
+    }
+    
+    const Elf64_Shdr *strtab = &sections[symtab->sh_link];
+    const Elf64_Sym *symbols = (const Elf64_Sym *)(image + symtab->sh_offset);
+    size_t symbol_count = symtab->sh_size / sizeof(Elf64_Sym);
+    
+    pthread_mutex_lock(&resolver->mutex);
+    
+    if (resolver->functions) FREE_LOGGED(resolver->functions);
+    if (resolver->symbol_names) FREE_LOGGED(resolver->symbol_names);
+    resolver->function_count = 0;
+    resolver->functions = CALLOC_LOGGED(symbol_count > 0 ? symbol_count : 1, sizeof(elf_function_t));
+    resolver->symbol_names = MALLOC_LOGGED(strtab->sh_size + 1);
+    if (!resolver->functions || !resolver->symbol_names) {
+        pthread_mutex_unlock(&resolver->mutex);
+        munmap((void *)image, size);
+        return -1;
+    }
+    memcpy(resolver->symbol_names, image + strtab->sh_offset, strtab->sh_size);
+    resolver->symbol_names[strtab->sh_size] = '\0';
+    
+    for (size_t i = 0; i < symbol_count; i++) {
+        const Elf64_Sym *sym = &symbols[i];
+        if (ELF64_ST_TYPE(sym->st_info) != STT_FUNC || sym->st_value == 0 ||
+            sym->st_shndx == SHN_UNDEF || sym->st_name >= strtab->sh_size) {
+            continue;
+        }
+        elf_function_t *function = &resolver->functions[resolver->function_count++];
+        function->address = sym->st_value;
+        function->size = sym->st_size;
+        function->name_offset = sym->st_name;
+    }
+    qsort(resolver->functions, resolver->function_count, sizeof(elf_function_t),
+          compare_elf_functions);
+    
+    // PIE: the mapping at file offset 0 is the load base. Without the
+    // process's mappings its runtime addresses cannot be placed at all.
+    resolver->load_bias = 0;
+    bool rebased = ehdr->e_type != ET_DYN;
+    for (int i = 0; !rebased && resolver->has_process_maps && i < resolver->mapping_count; i++) {
+        if (resolver->mappings[i].file_offset == 0 &&
+            strcmp(resolver->mappings[i].pathname, resolver->binary_path) == 0) {
+            resolver->load_bias = resolver->mappings[i].start_addr;
+            rebased = true;
+        }
+    }
+    
+    pthread_mutex_unlock(&resolver->mutex);
+    munmap((void *)image, size);
+    
+    if (!rebased) {
+        LOG_ERROR("%s is position-independent and %s; its load address is unknown",
+                  resolver->binary_path,
+                  resolver->has_process_maps ? "not mapped by the sampled process"
+                                             : "no process mappings were captured");
+        return -1;
+    }
+    
+    LOG_INFO("Loaded %d function symbols from %s", resolver->function_count, resolver->binary_path);
+    return resolver->function_count;
+}
+
+static void fill_function_symbol(const address_resolver_t *resolver, const elf_function_t *function,
+                                 symbol_info_t *symbol) {
+    memset(symbol, 0, sizeof(symbol_info_t));
+    symbol->address = function->address + resolver->load_bias;
+    symbol->size = function->size;
+    strncpy(symbol->name, resolver->symbol_names + function->name_offset, sizeof(symbol->name) - 1);
+    strncpy(symbol->demangled_name, symbol->name, sizeof(symbol->demangled_name) - 1);
+    strncpy(symbol->location.function, symbol->name, sizeof(symbol->location.function) - 1);
+    symbol->is_function = true;
+}
+
+int address_resolver_find_symbol(address_resolver_t *resolver,
+                               const char *name, symbol_info_t *symbol) {
+    if (!resolver || !name || !symbol) return -1;
+    
+    pthread_mutex_lock(&resolver->mutex);
+    for (int i = 0; i < resolver->function_count; i++) {
+        if (strcmp(resolver->symbol_names + resolver->functions[i].name_offset, name) == 0) {
+            fill_function_symbol(resolver, &resolver->functions[i], symbol);
+            pthread_mutex_unlock(&resolver->mutex);
+            return 0;
+        }
+    }
+    pthread_mutex_unlock(&resolver->mutex);
+    return -1;
+}
+
+// Binary search for the function containing a runtime address
+int address_resolver_get_function_at(address_resolver_t *resolver,
+                                   uint64_t address, symbol_info_t *function) {
+    if (!resolver || !function) return -1;
+    
+    pthread_mutex_lock(&resolver->mutex);
+    
+    uint64_t target = address - resolver->load_bias;
+    int lo = 0, hi = resolver->function_count - 1, found = -1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (resolver->functions[mid].address <= target) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    
+    if (found < 0 || target >= resolver->functions[found].address + resolver->functions[found].size) {
+        pthread_mutex_unlock(&resolver->mutex);
+        return -1;
+    }
+    
+    fill_function_symbol(resolver, &resolver->functions[found], function);
+    pthread_mutex_unlock(&resolver->mutex);
+    return 0;
+}
+
 // Clear cache
 void address_resolver_clear_cache(address_resolver_t *resolver) {
     if (!resolver) return;
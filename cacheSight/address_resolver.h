@@ -51,14 +51,27 @@ int address_resolver_get_line_info(address_resolver_t *resolver,
                                  uint64_t address, char *filename, 
                                  size_t filename_size, int *line, int *column);
 
+// Line table lookup for many addresses in one addr2line run; unresolved
+// entries get line 0. Returns the number resolved
+int address_resolver_resolve_lines(address_resolver_t *resolver,
+                                 const uint64_t *addresses, int count,
+                                 source_location_t *locations);
+
 // Memory mapping functions
+// Snapshot of /proc/<pid>/maps (0 = this process); free with
+// address_resolver_free_mappings
+int address_resolver_read_maps(pid_t pid, memory_mapping_t **mappings, int *count);
+// Resolve against mappings captured earlier instead of a live process;
+// required to place a position-independent binary
+int address_resolver_set_mappings(address_resolver_t *resolver,
+                                const memory_mapping_t *mappings, int count);
 int address_resolver_get_mappings(address_resolver_t *resolver,
                                 memory_mapping_t **mappings, int *count);
 void address_resolver_free_mappings(memory_mapping_t *mappings);
 const memory_mapping_t* address_resolver_find_mapping(address_resolver_t *resolver,
                                                     uint64_t address);
 
-// Symbol table functions
+// Symbol table functions; symbols come from the binary's ELF symbol table
 int address_resolver_load_symbols(address_resolver_t *resolver);
 int address_resolver_find_symbol(address_resolver_t *resolver,
                                const char *name, symbol_info_t *symbol);
@@ -0,0 +1,363 @@
+#include "arena.h"
+#include <stdarg.h>
+
+#define ARENA_DEFAULT_BLOCK (256 * 1024)
+#define ARENA_ALIGNMENT 16
+
+// One block of the arena; data follows the header
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+} arena_block_t;
+
+// Data starts at the first aligned offset past the header
+#define ARENA_BLOCK_HEADER ((sizeof(arena_block_t) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+struct arena {
+    arena_block_t *current;         // Head of the block list, allocations go here
+    size_t block_size;
+    size_t bytes_used;
+    size_t bytes_reserved;
+};
+
+// Per-thread arenas of a phase; looked up once per stage, not per allocation
+typedef struct group_member {
+    pthread_t thread;
+    arena_t *arena;
+    struct group_member *next;
+} group_member_t;
+
+struct arena_group {
+    char phase[32];
+    size_t block_size;
+    group_member_t *members;
+    pthread_mutex_t mutex;
+};
+
+// Hash set of interned strings; the table is heap memory, strings live in the arena
+struct string_pool {
+    arena_t *arena;
+    const char **slots;
+    uint64_t *hashes;
+    size_t capacity;
+    int count;
+};
+
+static arena_block_t* arena_new_block(arena_t *arena, size_t min_size) {
+    size_t size = arena->block_size > min_size ? arena->block_size : min_size;
+    arena_block_t *block = MALLOC_LOGGED(ARENA_BLOCK_HEADER + size);
+    if (!block) {
+        LOG_ERROR("Failed to allocate %zu byte arena block", size);
+        return NULL;
+    }
+    
+    block->next = arena->current;
+    block->size = size;
+    block->used = 0;
+    arena->current = block;
+    arena->bytes_reserved += size;
+    return block;
+}
+
+arena_t* arena_create(size_t block_size) {
+    arena_t *arena = CALLOC_LOGGED(1, sizeof(arena_t));
+    if (!arena) {
+        LOG_ERROR("Failed to allocate arena");
+        return NULL;
+    }
+    
+    arena->block_size = block_size > 0 ? block_size : ARENA_DEFAULT_BLOCK;
+    return arena;
+}
+
+void arena_destroy(arena_t *arena) {
+    if (!arena) return;
+    
+    LOG_DEBUG("Destroying arena: %zu bytes used of %zu reserved",
+              arena->bytes_used, arena->bytes_reserved);
+    
+    arena_block_t *block = arena->current;
+    while (block) {
+        arena_block_t *next = block->next;
+        FREE_LOGGED(block);
+        block = next;
+    }
+    FREE_LOGGED(arena);
+}
+
+// Keep the newest block for reuse, release the rest
+void arena_reset(arena_t *arena) {
+    if (!arena || !arena->current) return;
+    
+    arena_block_t *block = arena->current->next;
+    while (block) {
+        arena_block_t *next = block->next;
+        FREE_LOGGED(block);
+        block = next;
+    }
+    arena->current->next = NULL;
+    arena->current->used = 0;
+    arena->bytes_used = 0;
+    arena->bytes_reserved = arena->current->size;
+}
+
+void* arena_alloc(arena_t *arena, size_t size) {
+    if (!arena) return NULL;
+    
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (size == 0) size = ARENA_ALIGNMENT;
+    
+    arena_block_t *block = arena->current;
+    if (!block || block->size - block->used < size) {
+        block = arena_new_block(arena, size);
+        if (!block) return NULL;
+    }
+    
+    void *ptr = (char *)block + ARENA_BLOCK_HEADER + block->used;
+    block->used += size;
+    arena->bytes_used += size;
+    return ptr;
+}
+
+void* arena_calloc(arena_t *arena, size_t nmemb, size_t size) {
+    if (size > 0 && nmemb > SIZE_MAX / size) return NULL;
+    
+    void *ptr = arena_alloc(arena, nmemb * size);
+    if (ptr) memset(ptr, 0, nmemb * size);
+    return ptr;
+}
+
+char* arena_strdup(arena_t *arena, const char *str) {
+    if (!str) return NULL;
+    
+    size_t len = strlen(str);
+    char *copy = arena_alloc(arena, len + 1);
+    if (copy) memcpy(copy, str, len + 1);
+    return copy;
+}
+
+char* arena_printf(arena_t *arena, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (len < 0) return NULL;
+    
+    char *str = arena_alloc(arena, (size_t)len + 1);
+    if (!str) return NULL;
+    
+    va_start(args, format);
+    vsnprintf(str, (size_t)len + 1, format, args);
+    va_end(args);
+    return str;
+}
+
+size_t arena_bytes_used(const arena_t *arena) {
+    return arena ? arena->bytes_used : 0;
+}
+
+size_t arena_bytes_reserved(const arena_t *arena) {
+    return arena ? arena->bytes_reserved : 0;
+}
+
+arena_mark_t arena_mark(const arena_t *arena) {
+    arena_mark_t mark = {0};
+    if (arena && arena->current) {
+        mark.block = arena->current;
+        mark.used = arena->current->used;
+        mark.bytes_used = arena->bytes_used;
+    }
+    return mark;
+}
+
+// Blocks opened after the mark are released; a mark taken on an empty arena
+// keeps one block for reuse like arena_reset
+void arena_rewind(arena_t *arena, arena_mark_t mark) {
+    if (!arena || !arena->current) return;
+    
+    if (!mark.block) {
+        arena_reset(arena);
+        return;
+    }
+    
+    while (arena->current != mark.block) {
+        arena_block_t *block = arena->current;
+        if (!block) return;  // Mark from another arena
+        arena->current = block->next;
+        arena->bytes_reserved -= block->size;
+        FREE_LOGGED(block);
+    }
+    arena->current->used = mark.used;
+    arena->bytes_used = mark.bytes_used;
+}
+
+arena_group_t* arena_group_create(const char *phase, size_t block_size) {
+    arena_group_t *group = CALLOC_LOGGED(1, sizeof(arena_group_t));
+    if (!group) return NULL;
+    
+    strncpy(group->phase, phase ? phase : "phase", sizeof(group->phase) - 1);
+    group->block_size = block_size;
+    pthread_mutex_init(&group->mutex, NULL);
+    return group;
+}
+
+void arena_group_destroy(arena_group_t *group) {
+    if (!group) return;
+    
+    LOG_DEBUG("Releasing %s arenas: %zu bytes used", group->phase, arena_group_bytes_used(group));
+    
+    group_member_t *member = group->members;
+    while (member) {
+        group_member_t *next = member->next;
+        arena_destroy(member->arena);
+        FREE_LOGGED(member);
+        member = next;
+    }
+    pthread_mutex_destroy(&group->mutex);
+    FREE_LOGGED(group);
+}
+
+// The calling thread's arena, created on its first use in this phase
+arena_t* arena_group_local(arena_group_t *group) {
+    if (!group) return NULL;
+    
+    pthread_t self = pthread_self();
+    pthread_mutex_lock(&group->mutex);
+    
+    group_member_t *member = group->members;
+    while (member && !pthread_equal(member->thread, self)) {
+        member = member->next;
+    }
+    
+    if (!member) {
+        member = CALLOC_LOGGED(1, sizeof(group_member_t));
+        if (member) {
+            member->thread = self;
+            member->arena = arena_create(group->block_size);
+            if (member->arena) {
+                member->next = group->members;
+                group->members = member;
+            } else {
+                FREE_LOGGED(member);
+                member = NULL;
+            }
+        }
+    }
+    
+    pthread_mutex_unlock(&group->mutex);
+    return member ? member->arena : NULL;
+}
+
+// End of the phase: every thread's arena drops to one reusable block
+void arena_group_reset(arena_group_t *group) {
+    if (!group) return;
+    
+    pthread_mutex_lock(&group->mutex);
+    for (group_member_t *member = group->members; member; member = member->next) {
+        arena_reset(member->arena);
+    }
+    pthread_mutex_unlock(&group->mutex);
+}
+
+size_t arena_group_bytes_used(arena_group_t *group) {
+    if (!group) return 0;
+    
+    size_t used = 0;
+    pthread_mutex_lock(&group->mutex);
+    for (const group_member_t *member = group->members; member; member = member->next) {
+        used += arena_bytes_used(member->arena);
+    }
+    pthread_mutex_unlock(&group->mutex);
+    return used;
+}
+
+static uint64_t pool_hash(const char *str) {
+    // FNV-1a
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *c = (const unsigned char *)str; *c; c++) {
+        h ^= *c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int pool_grow(string_pool_t *pool) {
+    size_t capacity = pool->capacity ? pool->capacity * 2 : 256;
+    const char **slots = CALLOC_LOGGED(capacity, sizeof(const char *));
+    uint64_t *hashes = CALLOC_LOGGED(capacity, sizeof(uint64_t));
+    if (!slots || !hashes) {
+        if (slots) FREE_LOGGED(slots);
+        if (hashes) FREE_LOGGED(hashes);
+        return -1;
+    }
+    
+    for (size_t i = 0; i < pool->capacity; i++) {
+        if (!pool->slots[i]) continue;
+        size_t j = pool->hashes[i] & (capacity - 1);
+        while (slots[j]) j = (j + 1) & (capacity - 1);
+        slots[j] = pool->slots[i];
+        hashes[j] = pool->hashes[i];
+    }
+    
+    if (pool->slots) FREE_LOGGED(pool->slots);
+    if (pool->hashes) FREE_LOGGED(pool->hashes);
+    pool->slots = slots;
+    pool->hashes = hashes;
+    pool->capacity = capacity;
+    return 0;
+}
+
+string_pool_t* string_pool_create(arena_t *arena) {
+    if (!arena) return NULL;
+    
+    string_pool_t *pool = CALLOC_LOGGED(1, sizeof(string_pool_t));
+    if (!pool) return NULL;
+    
+    pool->arena = arena;
+    if (pool_grow(pool) != 0) {
+        FREE_LOGGED(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+// The interned strings stay valid until the arena goes away
+void string_pool_destroy(string_pool_t *pool) {
+    if (!pool) return;
+    
+    FREE_LOGGED(pool->slots);
+    FREE_LOGGED(pool->hashes);
+    FREE_LOGGED(pool);
+}
+
+const char* string_pool_intern(string_pool_t *pool, const char *str) {
+    if (!pool || !str) return NULL;
+    
+    // Keep the table at most half full
+    if ((size_t)(pool->count + 1) * 2 > pool->capacity && pool_grow(pool) != 0) {
+        return NULL;
+    }
+    
+    uint64_t hash = pool_hash(str);
+    size_t mask = pool->capacity - 1;
+    size_t i = hash & mask;
+    while (pool->slots[i]) {
+        if (pool->hashes[i] == hash && strcmp(pool->slots[i], str) == 0) {
+            return pool->slots[i];
+        }
+        i = (i + 1) & mask;
+    }
+    
+    char *copy = arena_strdup(pool->arena, str);
+    if (!copy) return NULL;
+    
+    pool->slots[i] = copy;
+    pool->hashes[i] = hash;
+    pool->count++;
+    return copy;
+}
+
+int string_pool_count(const string_pool_t *pool) {
+    return pool ? pool->count : 0;
+}
@@ -0,0 +1,59 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bump allocator: allocations live until the arena is reset or destroyed
+typedef struct arena arena_t;
+
+// Interned strings backed by an arena; equal strings share one copy
+typedef struct string_pool string_pool_t;
+
+// Arenas of one pipeline phase, one per thread that allocates in it; the
+// whole phase is released at once
+typedef struct arena_group arena_group_t;
+
+// Allocation position; rewinding to it releases everything allocated since
+typedef struct {
+    void *block;
+    size_t used;
+    size_t bytes_used;
+} arena_mark_t;
+
+// API functions
+arena_t* arena_create(size_t block_size);
+void arena_destroy(arena_t *arena);
+void arena_reset(arena_t *arena);
+
+void* arena_alloc(arena_t *arena, size_t size);
+void* arena_calloc(arena_t *arena, size_t nmemb, size_t size);
+char* arena_strdup(arena_t *arena, const char *str);
+char* arena_printf(arena_t *arena, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+size_t arena_bytes_used(const arena_t *arena);
+size_t arena_bytes_reserved(const arena_t *arena);
+
+arena_mark_t arena_mark(const arena_t *arena);
+void arena_rewind(arena_t *arena, arena_mark_t mark);
+
+arena_group_t* arena_group_create(const char *phase, size_t block_size);
+void arena_group_destroy(arena_group_t *group);
+arena_t* arena_group_local(arena_group_t *group);
+void arena_group_reset(arena_group_t *group);
+size_t arena_group_bytes_used(arena_group_t *group);
+
+string_pool_t* string_pool_create(arena_t *arena);
+void string_pool_destroy(string_pool_t *pool);
+const char* string_pool_intern(string_pool_t *pool, const char *str);
+int string_pool_count(const string_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ARENA_H
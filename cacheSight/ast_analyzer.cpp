@@ -722,6 +722,9 @@ private:
         // Check for nested loops
         loop->has_nested_loops = hasNestedLoops(stmt->getBody());
         loop->has_function_calls = hasFunctionCalls(stmt->getBody());
+        
+        // Static instruction count for the per-iteration cost model
+        countBodyOps(stmt->getBody(), loop);
     }
 
     void analyzeStruct(RecordDecl *decl, struct_info_t *info) {
@@ -740,6 +743,17 @@ private:
             
             info->field_offsets[field_idx] = layout.getFieldOffset(field_idx) / 8;
             info->field_sizes[field_idx] = context->getTypeSize(field->getType()) / 8;
+            info->field_aligns[field_idx] = context->getTypeAlignInChars(field->getType()).getQuantity();
+            
+            strncpy(info->field_types[field_idx], field->getType().getAsString().c_str(),
+                    sizeof(info->field_types[field_idx]) - 1);
+            
+            std::string decl_text;
+            llvm::raw_string_ostream decl_os(decl_text);
+            field->getType().print(decl_os, context->getPrintingPolicy(), field->getName());
+            decl_os.flush();
+            strncpy(info->field_decls[field_idx], decl_text.c_str(),
+                    sizeof(info->field_decls[field_idx]) - 1);
             
             if (field->getType()->isPointerType()) {
                 info->has_pointer_fields = true;
@@ -755,16 +769,21 @@ private:
     void analyzeMemberAccess(MemberExpr *expr, static_pattern_t *pattern) {
         pattern->is_struct_access = true;
         pattern->pattern = GATHER_SCATTER;  // Default for struct access
+        pattern->loop_depth = current_loop_depth;
+        
+        // Remember the enclosing loop so field co-access can be grouped per loop
+        if (!loop_stack.empty() && loop_stack.back()->stmt) {
+            PresumedLoc ploc = source_mgr->getPresumedLoc(loop_stack.back()->stmt->getBeginLoc());
+            pattern->enclosing_loop_line = ploc.getLine();
+        }
         
         if (FieldDecl *field = dyn_cast<FieldDecl>(expr->getMemberDecl())) {
             strncpy(pattern->variable_name, field->getNameAsString().c_str(),
                     sizeof(pattern->variable_name) - 1);
             
-            // Get struct name if possible
-            if (DeclRefExpr *base = dyn_cast<DeclRefExpr>(expr->getBase()->IgnoreParenCasts())) {
-                strncpy(pattern->struct_name, base->getNameInfo().getAsString().c_str(),
-                        sizeof(pattern->struct_name) - 1);
-            }
+            // Record the struct type so accesses can be matched against struct_info_t
+            strncpy(pattern->struct_name, field->getParent()->getNameAsString().c_str(),
+                    sizeof(pattern->struct_name) - 1);
         }
     }
     
@@ -804,6 +823,31 @@ private:
         return false;
     }
     
+    // Count operations of one iteration; nested loop bodies belong to their own loop
+    void countBodyOps(Stmt *stmt, loop_info_t *loop) {
+        if (!stmt || isa<ForStmt>(stmt) || isa<WhileStmt>(stmt) || isa<DoStmt>(stmt)) return;
+        
+        if (isa<ArraySubscriptExpr>(stmt)) {
+            loop->body_mem_ops++;
+        } else if (MemberExpr *member = dyn_cast<MemberExpr>(stmt)) {
+            if (member->isArrow()) loop->body_mem_ops++;
+        } else if (UnaryOperator *unary = dyn_cast<UnaryOperator>(stmt)) {
+            if (unary->getOpcode() == UO_Deref) {
+                loop->body_mem_ops++;
+            } else {
+                loop->body_op_count++;
+            }
+        } else if (BinaryOperator *binary = dyn_cast<BinaryOperator>(stmt)) {
+            if (binary->getOpcode() != BO_Assign) loop->body_op_count++;
+        } else if (isa<CallExpr>(stmt)) {
+            loop->body_op_count += 10;  // Opaque call, rough cost
+        }
+        
+        for (auto child : stmt->children()) {
+            countBodyOps(child, loop);
+        }
+    }
+    
     bool hasFunctionCalls(Stmt *stmt) {
         for (auto child : stmt->children()) {
             if (!child) continue;
@@ -1106,11 +1150,7 @@ int ast_analyzer_analyze_files(ast_analyzer_t *analyzer, const char **filenames,
     std::vector<FileResultsHolder> file_results_vec;
     file_results_vec.reserve(file_count);
     
-    // First pass: analyze files and count total items
-    int total_patterns = 0;
-    int total_loops = 0;
-    int total_structs = 0;
-    
+    // Analyze files, then merge what succeeded
     for (int i = 0; i < file_count; i++) {
         FileResultsHolder holder;
         
@@ -1119,13 +1159,40 @@ int ast_analyzer_analyze_files(ast_analyzer_t *analyzer, const char **filenames,
             continue;
         }
         
-        total_patterns += holder.results.pattern_count;
-        total_loops += holder.results.loop_count;
-        total_structs += holder.results.struct_count;
-        
         file_results_vec.push_back(std::move(holder));
     }
     
+    std::vector<analysis_results_t> parts;
+    parts.reserve(file_results_vec.size());
+    for (const auto& holder : file_results_vec) {
+        parts.push_back(holder.results);
+    }
+    
+    if (ast_analyzer_merge_results(parts.data(), static_cast<int>(parts.size()), results) != 0) {
+        return -1;
+    }
+    
+    LOG_INFO("Analyzed %d files: %d patterns, %d loops, %d structs total",
+             file_count, results->pattern_count, results->loop_count, results->struct_count);
+    
+    return 0;
+}
+
+int ast_analyzer_merge_results(const analysis_results_t *parts, int part_count,
+                               analysis_results_t *results) {
+    if (!parts || part_count < 0 || !results) return -1;
+    
+    memset(results, 0, sizeof(analysis_results_t));
+    
+    int total_patterns = 0;
+    int total_loops = 0;
+    int total_structs = 0;
+    for (int p = 0; p < part_count; p++) {
+        total_patterns += parts[p].pattern_count;
+        total_loops += parts[p].loop_count;
+        total_structs += parts[p].struct_count;
+    }
+    
     // Allocate result arrays
     if (total_patterns > 0) {
         results->patterns = new static_pattern_t[total_patterns];
@@ -1137,13 +1204,13 @@ int ast_analyzer_analyze_files(ast_analyzer_t *analyzer, const char **filenames,
         results->structs = new struct_info_t[total_structs];
     }
     
-    // Second pass: copy data (now the pointers are still valid)
+    // Copy data; the parts keep their own arrays
     int pattern_offset = 0;
     int loop_offset = 0;
     int struct_offset = 0;
     
-    for (auto& holder : file_results_vec) {
-        const auto& file_results = holder.results;
+    for (int p = 0; p < part_count; p++) {
+        const analysis_results_t& file_results = parts[p];
         
         // Copy patterns
         if (file_results.patterns && file_results.pattern_count > 0) {
@@ -1157,6 +1224,7 @@ int ast_analyzer_analyze_files(ast_analyzer_t *analyzer, const char **filenames,
         if (file_results.loops && file_results.loop_count > 0) {
             for (int i = 0; i < file_results.loop_count; i++) {
                 results->loops[loop_offset] = file_results.loops[i];
+                results->loops[loop_offset].patterns = nullptr;
                 
                 // Deep copy the patterns array if it exists
                 if (file_results.loops[i].patterns && file_results.loops[i].pattern_count > 0) {
@@ -1182,10 +1250,6 @@ int ast_analyzer_analyze_files(ast_analyzer_t *analyzer, const char **filenames,
     results->pattern_count = pattern_offset;
     results->loop_count = loop_offset;
     results->struct_count = struct_offset;
-    
-    LOG_INFO("Analyzed %d files: %d patterns, %d loops, %d structs total",
-             file_count, results->pattern_count, results->loop_count, results->struct_count);
-    
     return 0;
 }
 
@@ -28,6 +28,7 @@ typedef struct {
     bool is_struct_access;
     int access_count;
     bool is_indirect_index;
+    int enclosing_loop_line;     // Line of innermost enclosing loop (0 = none)
 } static_pattern_t;
 
 // Loop information
@@ -41,6 +42,8 @@ typedef struct {
     bool has_function_calls;
     bool has_nested_loops;
     size_t estimated_iterations;
+    int body_op_count;           // Arithmetic/logic operations per iteration (nested loops excluded)
+    int body_mem_ops;            // Loads and stores per iteration
     static_pattern_t *patterns;
     int pattern_count;
 } loop_info_t;
@@ -51,6 +54,9 @@ typedef struct {
     char field_names[32][64];
     size_t field_offsets[32];
     size_t field_sizes[32];
+    size_t field_aligns[32];
+    char field_types[32][64];
+    char field_decls[32][128];   // Declarator text, e.g. "float pos[3]"
     int field_count;
     size_t total_size;
     bool has_pointer_fields;
@@ -83,6 +89,10 @@ int ast_analyzer_analyze_file(ast_analyzer_t *analyzer, const char *filename,
 int ast_analyzer_analyze_files(ast_analyzer_t *analyzer, const char **filenames,
                               int file_count, analysis_results_t *results);
 
+// Concatenates per-file results, such as files analyzed concurrently; the
+// parts keep their own arrays
+int ast_analyzer_merge_results(const analysis_results_t *parts, int part_count,
+                               analysis_results_t *results);
 void ast_analyzer_free_results(analysis_results_t *results);
 void ast_analyzer_print_results(const analysis_results_t *results);
 
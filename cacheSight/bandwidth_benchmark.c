@@ -252,6 +252,60 @@ double measure_access_latency(void *buffer, size_t size, size_t stride) {
     return latency_ns;
 }
 
+// Measure DRAM load-to-use latency: chase a random single cycle through a
+// buffer well beyond the LLC so neither caches nor prefetchers help
+double measure_memory_latency(const cache_info_t *cache_info) {
+    struct chase_node {
+        struct chase_node *next;
+        char padding[56];
+    };
+    
+    size_t llc_size = cache_info && cache_info->num_levels > 0 ?
+                      cache_info->levels[cache_info->num_levels - 1].size : 0;
+    size_t size = llc_size * 4 > 64 * 1024 * 1024 ? llc_size * 4 : 64 * 1024 * 1024;
+    size_t num_nodes = size / sizeof(struct chase_node);
+    
+    struct chase_node *nodes = allocate_aligned_buffer(size, 4096);
+    size_t *order = MALLOC_LOGGED(num_nodes * sizeof(size_t));
+    if (!nodes || !order) {
+        free_aligned_buffer(nodes);
+        if (order) FREE_LOGGED(order);
+        return 0.0;
+    }
+    
+    // Sattolo's shuffle yields one cycle covering every node
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < num_nodes; i++) order[i] = i;
+    for (size_t i = num_nodes - 1; i > 0; i--) {
+        size_t j = rand_r(&seed) % i;
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    for (size_t i = 0; i < num_nodes; i++) {
+        nodes[order[i]].next = &nodes[order[(i + 1) % num_nodes]];
+    }
+    FREE_LOGGED(order);
+    
+    volatile struct chase_node *p = &nodes[0];
+    for (int i = 0; i < 100000; i++) {
+        p = p->next;
+    }
+    
+    int chase_count = 2000000;
+    double start_time = get_timestamp();
+    for (int i = 0; i < chase_count; i++) {
+        p = p->next;
+    }
+    double elapsed = get_timestamp() - start_time;
+    
+    free_aligned_buffer(nodes);
+    
+    double latency_ns = (elapsed * 1e9) / chase_count;
+    LOG_INFO("Measured memory latency: %.1f ns (%zu MB chase)", latency_ns, size >> 20);
+    return latency_ns;
+}
+
 // Measure memory bandwidth
 int measure_memory_bandwidth(const cache_info_t *cache_info, bandwidth_results_t *results) {
     LOG_INFO("Starting memory bandwidth measurements");
@@ -37,6 +37,7 @@ double benchmark_random_read(void *buffer, size_t size, int iterations);
 double benchmark_random_write(void *buffer, size_t size, int iterations);
 double benchmark_memory_copy(void *src, void *dst, size_t size, int iterations);
 double measure_access_latency(void *buffer, size_t size, size_t stride);
+double measure_memory_latency(const cache_info_t *cache_info);
 
 // Helper functions
 void* allocate_aligned_buffer(size_t size, size_t alignment);
@@ -1,42 +1,38 @@
 #include "bank_conflict_analyzer.h"
+#include "arena.h"
+#include "stage_trace.h"
 #include <math.h>
 
 #ifndef min
 #define min(a, b) ((a) < (b) ? (a) : (b))
 #endif
 
-static bank_config_t g_config;
-static bool g_initialized = false;
+struct bank_conflict_analyzer {
+    bank_config_t config;
+};
 
-// Initialize analyzer
-int bank_conflict_analyzer_init(const bank_config_t *config) {
-    if (g_initialized) {
-        LOG_WARNING("Bank conflict analyzer already initialized");
-        return 0;
-    }
-    
-    if (config) {
-        g_config = *config;
-    } else {
-        // Default to CPU configuration
-        g_config = bank_config_default_cpu();
+// Create analyzer
+bank_conflict_analyzer_t* bank_conflict_analyzer_create(const bank_config_t *config) {
+    bank_conflict_analyzer_t *analyzer = CALLOC_LOGGED(1, sizeof(bank_conflict_analyzer_t));
+    if (!analyzer) {
+        LOG_ERROR("Failed to allocate bank conflict analyzer");
+        return NULL;
     }
     
-    LOG_INFO("Initialized bank conflict analyzer: %d banks, %d-byte width",
-             g_config.num_memory_banks, g_config.bank_width_bytes);
+    // Default to CPU configuration
+    analyzer->config = config ? *config : bank_config_default_cpu();
     
-    g_initialized = true;
-    return 0;
+    LOG_INFO("Created bank conflict analyzer: %d banks, %d-byte width",
+             analyzer->config.num_memory_banks, analyzer->config.bank_width_bytes);
+    return analyzer;
 }
 
-// Cleanup analyzer
-void bank_conflict_analyzer_cleanup(void) {
-    if (!g_initialized) {
-        return;
-    }
+// Destroy analyzer
+void bank_conflict_analyzer_destroy(bank_conflict_analyzer_t *analyzer) {
+    if (!analyzer) return;
     
-    LOG_INFO("Cleaning up bank conflict analyzer");
-    g_initialized = false;
+    LOG_INFO("Destroying bank conflict analyzer");
+    FREE_LOGGED(analyzer);
 }
 
 // Calculate memory bank for address
@@ -49,35 +45,35 @@ int calculate_memory_bank(uint64_t address, const bank_config_t *config) {
 }
 
 // Calculate cache bank (for banked caches)
-int calculate_cache_bank(uint64_t address, int cache_level, 
+int calculate_cache_bank(const bank_conflict_analyzer_t *analyzer,
+                        uint64_t address, int cache_level, 
                         const cache_info_t *cache_info) {
-    if (!cache_info || cache_level < 0 || cache_level >= cache_info->num_levels) {
+    if (!analyzer || !cache_info || cache_level < 0 || cache_level >= cache_info->num_levels) {
         return 0;
     }
     
     // Many modern CPUs have banked L1 caches
-    if (cache_level == 0 && g_config.l1_banks > 0) {
+    if (cache_level == 0 && analyzer->config.l1_banks > 0) {
         // Simple hash based on address bits
-        return (address / 64) % g_config.l1_banks;  // 64-byte cache lines
+        return (address / 64) % analyzer->config.l1_banks;  // 64-byte cache lines
     }
     
     return 0;
 }
 
 // Analyze bank conflicts
-int analyze_bank_conflicts(const cache_miss_sample_t *samples, int sample_count,
+int analyze_bank_conflicts(const bank_conflict_analyzer_t *analyzer,
+                          const cache_miss_sample_t *samples, int sample_count,
                           bank_conflict_t **conflicts, int *conflict_count) {
-    if (!samples || sample_count <= 0 || !conflicts || !conflict_count) {
+    if (!analyzer || !samples || sample_count <= 0 || !conflicts || !conflict_count) {
         LOG_ERROR("Invalid parameters for analyze_bank_conflicts");
         return -1;
     }
+    const bank_config_t *config = &analyzer->config;
+    TRACE_SCOPE(trace, "bank_conflicts.analyze");
+    trace_add_items(&trace, sample_count);
     
-    if (!g_initialized) {
-        LOG_ERROR("Bank conflict analyzer not initialized");
-        return -1;
-    }
-    
-    if (!g_config.has_bank_conflicts) {
+    if (!config->has_bank_conflicts) {
         LOG_INFO("Architecture does not have bank conflicts");
         *conflicts = NULL;
         *conflict_count = 0;
@@ -94,36 +90,39 @@ int analyze_bank_conflicts(const cache_miss_sample_t *samples, int sample_count,
         int thread_mask;
     } bank_access_info_t;
     
-    bank_access_info_t *bank_info = CALLOC_LOGGED(g_config.num_memory_banks,
-                                                  sizeof(bank_access_info_t));
-    if (!bank_info) {
+    // Per-bank slices of one timestamp array, sized by a counting pass; the
+    // arena is released on return
+    arena_t *arena = arena_create(0);
+    bank_access_info_t *bank_info = arena ? arena_calloc(arena, config->num_memory_banks,
+                                                         sizeof(bank_access_info_t)) : NULL;
+    uint64_t *times = arena ? arena_alloc(arena, (size_t)sample_count * sizeof(uint64_t)) : NULL;
+    if (!bank_info || !times) {
         LOG_ERROR("Failed to allocate bank info");
+        arena_destroy(arena);
         return -1;
     }
     
+    for (int i = 0; i < sample_count; i++) {
+        int bank = calculate_memory_bank(samples[i].memory_addr, config);
+        if (bank >= 0 && bank < config->num_memory_banks) {
+            bank_info[bank].access_capacity++;
+        }
+    }
+    
+    size_t offset = 0;
+    for (int bank = 0; bank < config->num_memory_banks; bank++) {
+        bank_info[bank].access_times = times + offset;
+        offset += bank_info[bank].access_capacity;
+    }
+    
     // Track accesses per bank
     for (int i = 0; i < sample_count; i++) {
-        int bank = calculate_memory_bank(samples[i].memory_addr, &g_config);
+        int bank = calculate_memory_bank(samples[i].memory_addr, config);
         
-        if (bank >= 0 && bank < g_config.num_memory_banks) {
+        if (bank >= 0 && bank < config->num_memory_banks) {
             bank_access_info_t *info = &bank_info[bank];
-            
-            // Grow array if needed
-            if (info->access_count >= info->access_capacity) {
-                info->access_capacity = info->access_capacity ? info->access_capacity * 2 : 16;
-                uint64_t *new_times = realloc(info->access_times,
-                                            info->access_capacity * sizeof(uint64_t));
-                if (new_times) {
-                    info->access_times = new_times;
-                } else {
-                    continue;
-                }
-            }
-            
-            if (info->access_count < info->access_capacity) {
-                info->access_times[info->access_count++] = samples[i].timestamp;
-                info->thread_mask |= (1 << (samples[i].tid % 32));
-            }
+            info->access_times[info->access_count++] = samples[i].timestamp;
+            info->thread_mask |= (1 << (samples[i].tid % 32));
         }
     }
     
@@ -134,18 +133,12 @@ int analyze_bank_conflicts(const cache_miss_sample_t *samples, int sample_count,
     
     conflict_list = CALLOC_LOGGED(conflict_capacity, sizeof(bank_conflict_t));
     if (!conflict_list) {
-        // Cleanup
-        for (int i = 0; i < g_config.num_memory_banks; i++) {
-            if (bank_info[i].access_times) {
-                FREE_LOGGED(bank_info[i].access_times);
-            }
-        }
-        FREE_LOGGED(bank_info);
+        arena_destroy(arena);
         return -1;
     }
     
     // Look for banks with high contention
-    for (int bank = 0; bank < g_config.num_memory_banks; bank++) {
+    for (int bank = 0; bank < config->num_memory_banks; bank++) {
         bank_access_info_t *info = &bank_info[bank];
         
         if (info->access_count < 10) continue;  // Skip lightly used banks
@@ -212,13 +205,7 @@ int analyze_bank_conflicts(const cache_miss_sample_t *samples, int sample_count,
         }
     }
     
-    // Cleanup
-    for (int i = 0; i < g_config.num_memory_banks; i++) {
-        if (bank_info[i].access_times) {
-            FREE_LOGGED(bank_info[i].access_times);
-        }
-    }
-    FREE_LOGGED(bank_info);
+    arena_destroy(arena);
     
     *conflicts = conflict_list;
     
@@ -272,9 +259,10 @@ double calculate_bank_conflict_severity(const bank_conflict_t *conflict) {
 }
 
 // Detect strided bank conflict pattern
-bool detect_strided_bank_conflict(const uint64_t *addresses, int count,
+bool detect_strided_bank_conflict(const bank_conflict_analyzer_t *analyzer,
+                                 const uint64_t *addresses, int count,
                                  int *stride, int *conflicting_banks) {
-    if (!addresses || count < 2 || !stride || !conflicting_banks) return false;
+    if (!analyzer || !addresses || count < 2 || !stride || !conflicting_banks) return false;
     
     // Calculate strides
     int common_stride = 0;
@@ -303,7 +291,7 @@ bool detect_strided_bank_conflict(const uint64_t *addresses, int count,
     bool bank_used[32] = {false};  // Track up to 32 banks
     
     for (int i = 0; i < count && i < 100; i++) {
-        int bank = calculate_memory_bank(addresses[i], &g_config);
+        int bank = calculate_memory_bank(addresses[i], &analyzer->config);
         if (bank >= 0 && bank < 32 && !bank_used[bank]) {
             bank_used[bank] = true;
             banks_hit++;
@@ -313,9 +301,9 @@ bool detect_strided_bank_conflict(const uint64_t *addresses, int count,
     *conflicting_banks = banks_hit;
     
     // Conflict if we're hitting fewer banks than we should
-    if (banks_hit < g_config.num_memory_banks && count > g_config.num_memory_banks) {
+    if (banks_hit < analyzer->config.num_memory_banks && count > analyzer->config.num_memory_banks) {
         LOG_DEBUG("Strided bank conflict detected: stride=%d, banks=%d/%d",
-                  common_stride, banks_hit, g_config.num_memory_banks);
+                  common_stride, banks_hit, analyzer->config.num_memory_banks);
         return true;
     }
     
@@ -353,10 +341,11 @@ bool detect_power_of_two_conflict(const uint64_t *addresses, int count) {
 }
 
 // Suggest mitigations
-int suggest_bank_conflict_mitigation(const bank_conflict_t *conflict,
+int suggest_bank_conflict_mitigation(const bank_conflict_analyzer_t *analyzer,
+                                    const bank_conflict_t *conflict,
                                     bank_conflict_mitigation_t **mitigations,
                                     int *mitigation_count) {
-    if (!conflict || !mitigations || !mitigation_count) return -1;
+    if (!analyzer || !conflict || !mitigations || !mitigation_count) return -1;
     
     *mitigations = CALLOC_LOGGED(4, sizeof(bank_conflict_mitigation_t));
     if (!*mitigations) return -1;
@@ -382,7 +371,7 @@ int suggest_bank_conflict_mitigation(const bank_conflict_t *conflict,
              "for (int i = 0; i < 1024; i++)\n"
              "    for (int j = 0; j < 1024; j++)\n"
              "        sum += matrix[i][j];",
-             g_config.num_memory_banks);
+             analyzer->config.num_memory_banks);
     
     // Mitigation 2: Access pattern change
     mit = &(*mitigations)[(*mitigation_count)++];
@@ -36,12 +36,16 @@ typedef struct {
     int shared_memory_banks;       // GPU shared memory banks
 } bank_config_t;
 
+// Analyzer context; independent analyzers can run on separate threads
+typedef struct bank_conflict_analyzer bank_conflict_analyzer_t;
+
 // API functions
-int bank_conflict_analyzer_init(const bank_config_t *config);
-void bank_conflict_analyzer_cleanup(void);
+bank_conflict_analyzer_t* bank_conflict_analyzer_create(const bank_config_t *config);
+void bank_conflict_analyzer_destroy(bank_conflict_analyzer_t *analyzer);
 
 // Analysis functions
-int analyze_bank_conflicts(const cache_miss_sample_t *samples, int sample_count,
+int analyze_bank_conflicts(const bank_conflict_analyzer_t *analyzer,
+                          const cache_miss_sample_t *samples, int sample_count,
                           bank_conflict_t **conflicts, int *conflict_count);
 
 int analyze_bank_access_pattern(const cache_hotspot_t *hotspot,
@@ -49,7 +53,8 @@ int analyze_bank_access_pattern(const cache_hotspot_t *hotspot,
 
 // Bank calculation
 int calculate_memory_bank(uint64_t address, const bank_config_t *config);
-int calculate_cache_bank(uint64_t address, int cache_level, 
+int calculate_cache_bank(const bank_conflict_analyzer_t *analyzer,
+                        uint64_t address, int cache_level, 
                         const cache_info_t *cache_info);
 
 // Severity assessment
@@ -58,7 +63,8 @@ double estimate_bank_conflict_penalty(const bank_conflict_t *conflict,
                                     const cache_info_t *cache_info);
 
 // Pattern detection
-bool detect_strided_bank_conflict(const uint64_t *addresses, int count,
+bool detect_strided_bank_conflict(const bank_conflict_analyzer_t *analyzer,
+                                 const uint64_t *addresses, int count,
                                  int *stride, int *conflicting_banks);
 bool detect_power_of_two_conflict(const uint64_t *addresses, int count);
 
@@ -70,7 +76,8 @@ typedef struct {
     double expected_improvement;   // Expected performance gain (%)
 } bank_conflict_mitigation_t;
 
-int suggest_bank_conflict_mitigation(const bank_conflict_t *conflict,
+int suggest_bank_conflict_mitigation(const bank_conflict_analyzer_t *analyzer,
+                                    const bank_conflict_t *conflict,
                                     bank_conflict_mitigation_t **mitigations,
                                     int *mitigation_count);
 
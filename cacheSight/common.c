@@ -1,11 +1,19 @@
 #include "common.h"
 #include <stdarg.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <sys/time.h>
 
+// Per-thread ring capacity in records (power of two) and flusher period
+#define LOG_RING_SIZE 1024
+#define LOG_FLUSH_INTERVAL_MS 50
+
 // Global logger instance
 logger_config_t g_logger = {
     .console_level = LOG_INFO,
-    .file_level = LOG_DEBUG,
+    .file_level = LOG_INFO,
+    .min_level = LOG_DEBUG,
     .log_file_path = "",
     .log_file = NULL,
     .initialized = false
@@ -23,13 +31,235 @@ static const char* log_level_colors[] = {
     "\033[35m"   // Magenta for CRITICAL
 };
 
+// One formatted message; time and location are rendered by the flusher
+typedef struct {
+    uint64_t time_ns;
+    const char *file;
+    const char *func;
+    int line;
+    log_level_t level;
+    char message[LOG_MESSAGE_MAX];
+} log_record_t;
+
+// Single-producer ring owned by one thread and drained by the flusher
+typedef struct log_ring {
+    _Atomic uint32_t head;          // Next slot the owner fills
+    _Atomic uint32_t tail;          // Next slot the flusher reads
+    _Atomic bool retired;           // Owner exited; freed once drained
+    volatile sig_atomic_t busy;     // Owner is mid-push; a signal handler must not reenter
+    struct log_ring *next;
+    log_record_t records[LOG_RING_SIZE];
+} log_ring_t;
+
+// Asynchronous state; the ring list is guarded by g_logger.log_mutex
+static struct {
+    log_ring_t *rings;
+    pthread_t flusher;
+    pthread_cond_t wake;
+    pthread_key_t ring_key;
+    unsigned generation;            // Bumped per init so stale thread rings are ignored
+    bool running;
+    bool stopping;
+    volatile bool forked;
+    atomic_bool wake_requested;     // Set by producers; survives a signal sent mid-drain
+    _Atomic uint64_t dropped;
+    atomic_bool active;             // Cleared by logger_cleanup before log_mutex goes away
+    atomic_int releasing;           // Thread-exit hooks inside log_ring_release
+} g_async;
+
+static __thread log_ring_t *t_ring;
+static __thread unsigned t_ring_generation;
+static pthread_once_t g_async_once = PTHREAD_ONCE_INIT;
+
+static uint64_t log_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// localtime/strftime only when the second changes; flusher thread only
+static void log_format_time(uint64_t time_ns, char *buffer, size_t size) {
+    static time_t cached_sec = (time_t)-1;
+    static char cached[32];
+    
+    time_t sec = (time_t)(time_ns / 1000000000ull);
+    if (sec != cached_sec) {
+        struct tm tm_info;
+        localtime_r(&sec, &tm_info);
+        strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &tm_info);
+        cached_sec = sec;
+    }
+    snprintf(buffer, size, "%s.%03u", cached, (unsigned)(time_ns / 1000000ull % 1000));
+}
+
+static void log_write_record(const log_record_t *rec) {
+    char time_buffer[48];
+    log_format_time(rec->time_ns, time_buffer, sizeof(time_buffer));
+    
+    // Extract just the filename (not the full path)
+    const char *filename = strrchr(rec->file, '/');
+    filename = filename ? filename + 1 : rec->file;
+    
+    if (rec->level >= g_logger.console_level) {
+        fprintf(stderr, "%s[%s] [%s] [%s:%d:%s] %s\033[0m\n",
+                log_level_colors[rec->level], time_buffer,
+                log_level_strings[rec->level],
+                filename, rec->line, rec->func, rec->message);
+    }
+    
+    if (g_logger.log_file && rec->level >= g_logger.file_level) {
+        fprintf(g_logger.log_file, "[%s] [%s] [%s:%d:%s] %s\n",
+                time_buffer, log_level_strings[rec->level],
+                filename, rec->line, rec->func, rec->message);
+    }
+}
+
+// Merge the pending records of all rings in time order, then free rings
+// whose threads have exited; caller holds log_mutex
+static void log_drain_locked(void) {
+    for (;;) {
+        log_ring_t *oldest = NULL;
+        const log_record_t *rec = NULL;
+        for (log_ring_t *ring = g_async.rings; ring; ring = ring->next) {
+            uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            if (tail == atomic_load_explicit(&ring->head, memory_order_acquire)) continue;
+            const log_record_t *candidate = &ring->records[tail & (LOG_RING_SIZE - 1)];
+            if (!rec || candidate->time_ns < rec->time_ns) {
+                oldest = ring;
+                rec = candidate;
+            }
+        }
+        if (!oldest) break;
+        
+        log_write_record(rec);
+        atomic_fetch_add_explicit(&oldest->tail, 1, memory_order_release);
+    }
+    
+    for (log_ring_t **link = &g_async.rings; *link; ) {
+        log_ring_t *ring = *link;
+        if (atomic_load(&ring->retired) &&
+            atomic_load(&ring->tail) == atomic_load(&ring->head)) {
+            *link = ring->next;
+            free(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+    
+    uint64_t dropped = atomic_exchange(&g_async.dropped, 0);
+    if (dropped > 0) {
+        fprintf(stderr, "[logger] dropped %llu messages\n", (unsigned long long)dropped);
+        if (g_logger.log_file) {
+            fprintf(g_logger.log_file, "[logger] dropped %llu messages\n", (unsigned long long)dropped);
+        }
+    }
+    
+    fflush(stderr);
+    if (g_logger.log_file) fflush(g_logger.log_file);
+}
+
+static void* log_flusher_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&g_logger.log_mutex);
+    while (!g_async.stopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOG_FLUSH_INTERVAL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        if (!atomic_exchange(&g_async.wake_requested, false)) {
+            pthread_cond_timedwait(&g_async.wake, &g_logger.log_mutex, &deadline);
+            atomic_store(&g_async.wake_requested, false);
+        }
+        log_drain_locked();
+    }
+    pthread_mutex_unlock(&g_logger.log_mutex);
+    return NULL;
+}
+
+// Thread exit: hand the ring to the flusher if it still belongs to this logger.
+// After logger_cleanup the ring is already freed and log_mutex destroyed
+static void log_ring_release(void *value) {
+    atomic_fetch_add(&g_async.releasing, 1);
+    if (atomic_load(&g_async.active)) {
+        pthread_mutex_lock(&g_logger.log_mutex);
+        for (log_ring_t *ring = g_async.rings; ring; ring = ring->next) {
+            if (ring == value) {
+                atomic_store(&ring->retired, true);
+                break;
+            }
+        }
+        pthread_mutex_unlock(&g_logger.log_mutex);
+    }
+    atomic_fetch_sub(&g_async.releasing, 1);
+}
+
+// vsnprintf that marks a cut message with a trailing "..."
+static void log_format_message(char *buffer, size_t size, const char *format, va_list args) {
+    int n = vsnprintf(buffer, size, format, args);
+    if (n < 0 || (size_t)n < size || size < 4) return;
+    
+    // Back off to a UTF-8 character boundary before the marker
+    size_t cut = size - 4;
+    while (cut > 0 && ((unsigned char)buffer[cut] & 0xC0) == 0x80) cut--;
+    memcpy(buffer + cut, "...", 4);
+}
+
+// Drains end with the streams flushed under log_mutex, so holding it across
+// fork keeps the child from inheriting (and rewriting) buffered records
+static void log_before_fork(void) {
+    if (g_logger.initialized) pthread_mutex_lock(&g_logger.log_mutex);
+}
+
+static void log_after_fork_parent(void) {
+    if (g_logger.initialized) pthread_mutex_unlock(&g_logger.log_mutex);
+}
+
+// A forked child has no flusher; it logs synchronously
+static void log_after_fork_child(void) {
+    g_async.forked = true;
+}
+
+static void log_wake_flusher(void) {
+    if (!atomic_exchange(&g_async.wake_requested, true)) {
+        pthread_cond_signal(&g_async.wake);
+    }
+}
+
+static void log_once_init(void) {
+    pthread_key_create(&g_async.ring_key, log_ring_release);
+    pthread_atfork(log_before_fork, log_after_fork_parent, log_after_fork_child);
+}
+
+// Rings are plain calloc: the logged allocators would recurse into the logger
+static log_ring_t* log_thread_ring(void) {
+    if (t_ring && t_ring_generation == g_async.generation) return t_ring;
+    
+    log_ring_t *ring = calloc(1, sizeof(log_ring_t));
+    if (!ring) return NULL;
+    
+    pthread_mutex_lock(&g_logger.log_mutex);
+    ring->next = g_async.rings;
+    g_async.rings = ring;
+    pthread_mutex_unlock(&g_logger.log_mutex);
+    
+    pthread_setspecific(g_async.ring_key, ring);
+    t_ring = ring;
+    t_ring_generation = g_async.generation;
+    return ring;
+}
+
 void logger_init(const char *log_file_path, log_level_t console_level, log_level_t file_level) {
     if (g_logger.initialized) {
         LOG_WARNING("Logger already initialized, cleaning up first");
         logger_cleanup();
     }
     
+    pthread_once(&g_async_once, log_once_init);
     pthread_mutex_init(&g_logger.log_mutex, NULL);
+    pthread_cond_init(&g_async.wake, NULL);
     g_logger.console_level = console_level;
     g_logger.file_level = file_level;
     
@@ -41,6 +271,18 @@ void logger_init(const char *log_file_path, log_level_t console_level, log_level
         }
     }
     
+    // Levels nobody writes are rejected at the call site
+    g_logger.min_level = g_logger.log_file && file_level < console_level ? file_level : console_level;
+    
+    g_async.generation++;
+    g_async.stopping = false;
+    g_async.forked = false;
+    atomic_store(&g_async.active, true);
+    g_async.running = pthread_create(&g_async.flusher, NULL, log_flusher_main, NULL) == 0;
+    if (!g_async.running) {
+        fprintf(stderr, "Failed to start log flusher, logging synchronously\n");
+    }
+    
     g_logger.initialized = true;
     LOG_INFO("Logger initialized - Console Level: %s, File Level: %s, Log File: %s",
              log_level_strings[console_level],
@@ -48,14 +290,54 @@ void logger_init(const char *log_file_path, log_level_t console_level, log_level
              log_file_path ? log_file_path : "none");
 }
 
+void logger_flush(void) {
+    if (!g_logger.initialized || g_async.forked) return;
+    
+    pthread_mutex_lock(&g_logger.log_mutex);
+    log_drain_locked();
+    pthread_mutex_unlock(&g_logger.log_mutex);
+}
+
 void logger_cleanup(void) {
+    if (!g_logger.initialized) return;
+    
     if (g_logger.log_file) {
         LOG_INFO("Closing log file");
+    }
+    
+    // The flusher drains everything queued before it exits
+    if (g_async.running) {
+        pthread_mutex_lock(&g_logger.log_mutex);
+        g_async.stopping = true;
+        atomic_store(&g_async.wake_requested, true);
+        pthread_cond_signal(&g_async.wake);
+        pthread_mutex_unlock(&g_logger.log_mutex);
+        pthread_join(g_async.flusher, NULL);
+        g_async.running = false;
+    }
+    
+    // Threads exiting from here on leave log_mutex alone; wait out any
+    // that got in before destroying it
+    atomic_store(&g_async.active, false);
+    pthread_mutex_lock(&g_logger.log_mutex);
+    log_drain_locked();
+    while (g_async.rings) {
+        log_ring_t *next = g_async.rings->next;
+        free(g_async.rings);
+        g_async.rings = next;
+    }
+    pthread_mutex_unlock(&g_logger.log_mutex);
+    t_ring = NULL;
+    while (atomic_load(&g_async.releasing) > 0) sched_yield();
+    
+    if (g_logger.log_file) {
         fclose(g_logger.log_file);
         g_logger.log_file = NULL;
     }
+    pthread_cond_destroy(&g_async.wake);
     pthread_mutex_destroy(&g_logger.log_mutex);
     g_logger.initialized = false;
+    g_logger.min_level = LOG_DEBUG;
 }
 
 // Add these helper functions to verify enum values
@@ -66,11 +348,15 @@ const char* access_pattern_to_string_debug(access_pattern_t pattern) {
     return result;
 }
 
+// Formats into the caller's ring and returns; the flusher does the I/O.
+// ERROR and above drain all rings before returning. Without a flusher (not started, or in a forked child) it writes directly
 void log_message(log_level_t level, const char *file, int line, const char *func, const char *format, ...) {
+    if (level < g_logger.min_level) return;
+    
+    va_list args;
     if (!g_logger.initialized) {
         // Emergency logging to stderr
         fprintf(stderr, "Logger not initialized! Message: ");
-        va_list args;
         va_start(args, format);
         vfprintf(stderr, format, args);
         va_end(args);
@@ -78,49 +364,68 @@ void log_message(log_level_t level, const char *file, int line, const char *func
         return;
     }
     
-    pthread_mutex_lock(&g_logger.log_mutex);
+    if (!g_async.running || g_async.forked) {
+        log_record_t rec = { .time_ns = log_now_ns(), .file = file, .func = func,
+                             .line = line, .level = level };
+        va_start(args, format);
+        log_format_message(rec.message, sizeof(rec.message), format, args);
+        va_end(args);
+        
+        if (!g_async.forked) pthread_mutex_lock(&g_logger.log_mutex);
+        log_write_record(&rec);
+        fflush(stderr);
+        if (g_logger.log_file) fflush(g_logger.log_file);
+        if (!g_async.forked) pthread_mutex_unlock(&g_logger.log_mutex);
+        return;
+    }
     
-    // Get current time
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    struct tm *tm_info = localtime(&tv.tv_sec);
-    char time_buffer[64];
-    strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", tm_info);
+    log_ring_t *ring = log_thread_ring();
+    if (!ring || ring->busy) {
+        atomic_fetch_add(&g_async.dropped, 1);
+        return;
+    }
+    ring->busy = 1;
     
-    // Format the message
-    char message[4096];
-    va_list args;
+    // A full ring drops DEBUG chatter; everything else waits for the flusher
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    while (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= LOG_RING_SIZE) {
+        if (level == LOG_DEBUG) {
+            atomic_fetch_add(&g_async.dropped, 1);
+            ring->busy = 0;
+            return;
+        }
+        log_wake_flusher();
+        sched_yield();
+    }
+    
+    log_record_t *rec = &ring->records[head & (LOG_RING_SIZE - 1)];
+    rec->time_ns = log_now_ns();
+    rec->file = file;
+    rec->func = func;
+    rec->line = line;
+    rec->level = level;
     va_start(args, format);
-    vsnprintf(message, sizeof(message), format, args);
+    log_format_message(rec->message, sizeof(rec->message), format, args);
     va_end(args);
     
-    // Extract just the filename (not the full path)
-    const char *filename = strrchr(file, '/');
-    if (filename) filename++;
-    else filename = file;
-    
-    // Log to console if level is high enough
-    if (level >= g_logger.console_level) {
-        fprintf(stderr, "%s[%s.%03ld] [%s] [%s:%d:%s] %s\033[0m\n",
-                log_level_colors[level],
-                time_buffer, tv.tv_usec / 1000,
-                log_level_strings[level],
-                filename, line, func,
-                message);
-        fflush(stderr);
-    }
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
     
-    // Log to file if level is high enough
-    if (g_logger.log_file && level >= g_logger.file_level) {
-        fprintf(g_logger.log_file, "[%s.%03ld] [%s] [%s:%d:%s] %s\n",
-                time_buffer, tv.tv_usec / 1000,
-                log_level_strings[level],
-                filename, line, func,
-                message);
-        fflush(g_logger.log_file);
+    // Errors are on disk before we return, so a crash right after cannot lose
+    // them; busy stays set so a signal handler here drops instead of deadlocking
+    if (level >= LOG_ERROR) {
+        pthread_mutex_lock(&g_logger.log_mutex);
+        log_drain_locked();
+        pthread_mutex_unlock(&g_logger.log_mutex);
+        ring->busy = 0;
+        return;
     }
+    ring->busy = 0;
     
-    pthread_mutex_unlock(&g_logger.log_mutex);
+    // Nearly full rings are written without waiting for the period
+    uint32_t pending = head + 1 - atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (pending >= LOG_RING_SIZE / 2) {
+        log_wake_flusher();
+    }
 }
 
 const char* access_pattern_to_string(access_pattern_t pattern) {
@@ -177,6 +482,7 @@ const char* optimization_type_to_string(optimization_type_t type) {
         case OPT_CACHE_BLOCKING: return "CACHE_BLOCKING";
         case OPT_NUMA_BINDING: return "NUMA_BINDING";
         case OPT_LOOP_VECTORIZE: return "LOOP_VECTORIZE";
+        case OPT_NONTEMPORAL_STORES: return "NONTEMPORAL_STORES";
         default: return "UNKNOWN";
     }
 }
@@ -201,9 +507,22 @@ char* format_bytes(size_t bytes, char *buffer, size_t buffer_size) {
     return buffer;
 }
 
+// Per-thread totals of logged allocations; read by the stage tracer
+static __thread uint64_t t_alloc_bytes;
+static __thread uint64_t t_alloc_count;
+
+void memory_alloc_counters(uint64_t *bytes, uint64_t *count) {
+    *bytes = t_alloc_bytes;
+    *count = t_alloc_count;
+}
+
+// Allocation tracing is DEBUG only, so size formatting is skipped unless enabled
 void* malloc_logged(size_t size, const char *file, int line, const char *func) {
     void *ptr = malloc(size);
     if (ptr) {
+        t_alloc_bytes += size;
+        t_alloc_count++;
+        if (!LOG_ENABLED(LOG_DEBUG)) return ptr;
         char size_str[32];
         format_bytes(size, size_str, sizeof(size_str));
         LOG_DEBUG("Memory allocated: %s at %p [%s:%d:%s]", size_str, ptr, file, line, func);
@@ -217,6 +536,9 @@ void* calloc_logged(size_t nmemb, size_t size, const char *file, int line, const
     void *ptr = calloc(nmemb, size);
     size_t total_size = nmemb * size;
     if (ptr) {
+        t_alloc_bytes += total_size;
+        t_alloc_count++;
+        if (!LOG_ENABLED(LOG_DEBUG)) return ptr;
         char size_str[32];
         format_bytes(total_size, size_str, sizeof(size_str));
         LOG_DEBUG("Memory allocated (calloc): %s at %p [%s:%d:%s]", size_str, ptr, file, line, func);
@@ -29,12 +29,21 @@ typedef enum {
 typedef struct {
     log_level_t console_level;
     log_level_t file_level;
+    log_level_t min_level;          // Lowest level any destination accepts
     char log_file_path[512];
     FILE *log_file;
     pthread_mutex_t log_mutex;
     bool initialized;
 } logger_config_t;
 
+// Sites below this level compile away (make LOG_COMPILE_LEVEL=0 keeps DEBUG)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
+// Longest message kept by the logger; longer ones end in "..."
+#define LOG_MESSAGE_MAX 480
+
 extern logger_config_t g_logger;
 
 // Source location tracking
@@ -92,20 +101,31 @@ typedef enum {
     OPT_LOOP_UNROLL,
     OPT_CACHE_BLOCKING,
     OPT_NUMA_BINDING,
-    OPT_LOOP_VECTORIZE
+    OPT_LOOP_VECTORIZE,
+    OPT_NONTEMPORAL_STORES
 } optimization_type_t;
 
 // Logging functions
 void logger_init(const char *log_file_path, log_level_t console_level, log_level_t file_level);
 void logger_cleanup(void);
 void log_message(log_level_t level, const char *file, int line, const char *func, const char *format, ...);
+void logger_flush(void);
+
+// Level checks come before the arguments are evaluated or formatted
+#define LOG_ENABLED(level) \
+    ((int)(level) >= LOG_COMPILE_LEVEL && (level) >= g_logger.min_level)
+#define LOG_AT(level, ...) \
+    do { \
+        if (LOG_ENABLED(level)) \
+            log_message(level, __FILE__, __LINE__, __func__, __VA_ARGS__); \
+    } while (0)
 
 // Convenience macros
-#define LOG_DEBUG(...) log_message(LOG_DEBUG, __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define LOG_INFO(...) log_message(LOG_INFO, __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define LOG_WARNING(...) log_message(LOG_WARNING, __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define LOG_ERROR(...) log_message(LOG_ERROR, __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define LOG_CRITICAL(...) log_message(LOG_CRITICAL, __FILE__, __LINE__, __func__, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LOG_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_ERROR, __VA_ARGS__)
+#define LOG_CRITICAL(...) LOG_AT(LOG_CRITICAL, __VA_ARGS__)
 
 // Utility functions
 const char* access_pattern_to_string(access_pattern_t pattern);
@@ -123,6 +143,7 @@ char* format_bytes(size_t bytes, char *buffer, size_t buffer_size);
 void* malloc_logged(size_t size, const char *file, int line, const char *func);
 void* calloc_logged(size_t nmemb, size_t size, const char *file, int line, const char *func);
 void free_logged(void *ptr, const char *file, int line, const char *func);
+void memory_alloc_counters(uint64_t *bytes, uint64_t *count);  // Calling thread's running totals
 
 // Make sure these functions are declared here:
 void log_message(log_level_t level, const char *file, int line, 
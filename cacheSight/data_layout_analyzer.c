@@ -1,47 +1,40 @@
 #include "data_layout_analyzer.h"
 #include <string.h>
 
-static cache_info_t g_cache_info;
-static bool g_initialized = false;
+struct data_layout_analyzer {
+    cache_info_t cache_info;
+    size_t line_size;               // L1 line size, 64 when unknown
+};
 
-int data_layout_analyzer_init(const cache_info_t *cache_info) {
-    if (g_initialized) {
-        LOG_WARNING("Data layout analyzer already initialized");
-        return 0;
+data_layout_analyzer_t* data_layout_analyzer_create(const cache_info_t *cache_info) {
+    if (!cache_info) {
+        LOG_ERROR("NULL cache info provided to data layout analyzer");
+        return NULL;
     }
     
-    if (!cache_info) {
-        LOG_ERROR("NULL cache info provided");
-        return -1;
+    data_layout_analyzer_t *analyzer = CALLOC_LOGGED(1, sizeof(data_layout_analyzer_t));
+    if (!analyzer) {
+        LOG_ERROR("Failed to allocate data layout analyzer");
+        return NULL;
     }
     
-    g_cache_info = *cache_info;
-    g_initialized = true;
+    analyzer->cache_info = *cache_info;
+    analyzer->line_size = cache_info->levels[0].line_size > 0 ? cache_info->levels[0].line_size : 64;
     
-    LOG_INFO("Data layout analyzer initialized");
-    return 0;
+    LOG_INFO("Data layout analyzer created with %zu-byte lines", analyzer->line_size);
+    return analyzer;
 }
 
-void data_layout_analyzer_cleanup(void) {
-    if (!g_initialized) {
-        return;
-    }
+void data_layout_analyzer_destroy(data_layout_analyzer_t *analyzer) {
+    if (!analyzer) return;
     
-    LOG_INFO("Data layout analyzer cleanup");
-    g_initialized = false;
+    LOG_INFO("Destroying data layout analyzer");
+    FREE_LOGGED(analyzer);
 }
 
-int analyze_struct_layout(const struct_info_t *struct_info,
-                         const static_pattern_t *accesses, int access_count,
-                         struct_layout_analysis_t *analysis) {
-    if (!struct_info || !accesses || !analysis || access_count <= 0) {
-        LOG_ERROR("Invalid parameters for analyze_struct_layout");
-        return -1;
-    }
-    
-    LOG_INFO("Analyzing layout for struct %s with %d accesses",
-             struct_info->struct_name, access_count);
-    
+// Allocate analysis buffers and seed per-field stats from the struct layout
+static int init_layout_analysis(const struct_info_t *struct_info,
+                                struct_layout_analysis_t *analysis) {
     memset(analysis, 0, sizeof(struct_layout_analysis_t));
     
     // Copy struct info
@@ -57,6 +50,7 @@ int analyze_struct_layout(const struct_info_t *struct_info,
     if (!analysis->field_stats) {
         LOG_ERROR("Failed to allocate field stats");
         FREE_LOGGED(analysis->struct_info);
+        analysis->struct_info = NULL;
         return -1;
     }
     analysis->field_count = struct_info->field_count;
@@ -69,25 +63,15 @@ int analyze_struct_layout(const struct_info_t *struct_info,
         analysis->field_stats[i].field_size = struct_info->field_sizes[i];
     }
     
-    // Count field accesses
-    int total_struct_accesses = 0;
-    for (int i = 0; i < access_count; i++) {
-        if (!accesses[i].is_struct_access || 
-            strcmp(accesses[i].struct_name, struct_info->struct_name) != 0) {
-            continue;
-        }
-        
-        total_struct_accesses++;
-        
-        // Find which field is accessed
-        for (int j = 0; j < struct_info->field_count; j++) {
-            if (strcmp(accesses[i].variable_name, struct_info->field_names[j]) == 0) {
-                analysis->field_stats[j].access_count++;
-                break;
-            }
-        }
-    }
-    
+    return 0;
+}
+
+// Classify hot/cold fields from access_count and pick a layout. Shared by the
+// static and sample-driven analyses; has_false_sharing must already be set.
+static void classify_and_recommend(const data_layout_analyzer_t *analyzer,
+                                   const struct_info_t *struct_info,
+                                   int total_struct_accesses,
+                                   struct_layout_analysis_t *analysis) {
     // Calculate access frequencies and identify hot/cold fields
     int hot_threshold = total_struct_accesses * 0.2;  // 20% of accesses
     int cold_threshold = total_struct_accesses * 0.05; // 5% of accesses
@@ -118,18 +102,19 @@ int analyze_struct_layout(const struct_info_t *struct_info,
     analysis->padding_bytes = calculate_structure_padding(struct_info);
     LOG_DEBUG("Structure has %zu bytes of padding", analysis->padding_bytes);
     
-    // Check for false sharing
-    analysis->has_false_sharing = 
-        detect_false_sharing_risk(struct_info, accesses, access_count) > 0;
-    
     // Calculate current cache efficiency
     int hot_field_count = 0;
+    int cold_field_count = 0;
     size_t hot_field_size = 0;
+    size_t cold_field_size = 0;
     
     for (int i = 0; i < analysis->field_count; i++) {
         if (analysis->field_stats[i].is_hot) {
             hot_field_count++;
             hot_field_size += analysis->field_stats[i].field_size;
+        } else if (analysis->field_stats[i].is_cold) {
+            cold_field_count++;
+            cold_field_size += analysis->field_stats[i].field_size;
         }
     }
     
@@ -146,6 +131,18 @@ int analyze_struct_layout(const struct_info_t *struct_info,
         
         LOG_INFO("Recommending SoA transformation - only %d/%d fields are hot",
                  hot_field_count, analysis->field_count);
+    } else if (hot_field_count > 0 && cold_field_count > 0 &&
+               cold_field_size >= struct_info->total_size * 0.25) {
+        // Many hot fields but a bulky cold tail - move it behind a pointer
+        analysis->recommended_layout = LAYOUT_HOT_COLD_SPLIT;
+        analysis->predicted_efficiency = 
+            (double)hot_field_size / (hot_field_size + sizeof(void *)) * 100;
+        if (analysis->predicted_efficiency > 95) {
+            analysis->predicted_efficiency = 95;
+        }
+        
+        LOG_INFO("Recommending hot/cold split - %d cold fields occupy %zu of %zu bytes",
+                 cold_field_count, cold_field_size, struct_info->total_size);
     } else if (analysis->padding_bytes > struct_info->total_size * 0.2) {
         // Significant padding - recommend packing or alignment
         analysis->recommended_layout = LAYOUT_PACKED;
@@ -174,16 +171,750 @@ int analyze_struct_layout(const struct_info_t *struct_info,
     
     // Generate transformation code if needed
     if (analysis->recommended_layout != analysis->current_layout) {
-        suggest_struct_transformation(analysis, analysis->transformation_code,
+        suggest_struct_transformation(analyzer, analysis, analysis->transformation_code,
                                      sizeof(analysis->transformation_code));
     }
     
     LOG_INFO("Layout analysis complete: current efficiency=%.1f%%, predicted=%.1f%%",
              analysis->cache_efficiency, analysis->predicted_efficiency);
+}
+
+int analyze_struct_layout(const data_layout_analyzer_t *analyzer,
+                         const struct_info_t *struct_info,
+                         const static_pattern_t *accesses, int access_count,
+                         struct_layout_analysis_t *analysis) {
+    if (!analyzer || !struct_info || !accesses || !analysis || access_count <= 0) {
+        LOG_ERROR("Invalid parameters for analyze_struct_layout");
+        return -1;
+    }
+    
+    LOG_INFO("Analyzing layout for struct %s with %d accesses",
+             struct_info->struct_name, access_count);
+    
+    if (init_layout_analysis(struct_info, analysis) != 0) {
+        return -1;
+    }
+    
+    // Count field accesses
+    int total_struct_accesses = 0;
+    for (int i = 0; i < access_count; i++) {
+        if (!accesses[i].is_struct_access || 
+            strcmp(accesses[i].struct_name, struct_info->struct_name) != 0) {
+            continue;
+        }
+        
+        total_struct_accesses++;
+        
+        // Find which field is accessed
+        for (int j = 0; j < struct_info->field_count; j++) {
+            if (strcmp(accesses[i].variable_name, struct_info->field_names[j]) == 0) {
+                analysis->field_stats[j].access_count++;
+                break;
+            }
+        }
+    }
+    
+    // Check for false sharing
+    analysis->has_false_sharing = 
+        detect_false_sharing_risk(analyzer, struct_info, accesses, access_count) > 0;
+    
+    classify_and_recommend(analyzer, struct_info, total_struct_accesses, analysis);
     
     return 0;
 }
 
+// Find the field covering a byte offset within the struct, -1 for padding
+static int field_at_offset(const struct_info_t *struct_info, size_t offset) {
+    for (int i = 0; i < struct_info->field_count; i++) {
+        if (offset >= struct_info->field_offsets[i] &&
+            offset < struct_info->field_offsets[i] + struct_info->field_sizes[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int analyze_struct_layout_dynamic(const data_layout_analyzer_t *analyzer,
+                                 const struct_info_t *struct_info,
+                                 const object_range_t *ranges, int range_count,
+                                 const cache_miss_sample_t *samples, int sample_count,
+                                 struct_layout_analysis_t *analysis) {
+    if (!analyzer || !struct_info || !ranges || !samples || !analysis ||
+        range_count <= 0 || sample_count <= 0 || struct_info->total_size == 0) {
+        LOG_ERROR("Invalid parameters for analyze_struct_layout_dynamic");
+        return -1;
+    }
+    
+    LOG_INFO("Analyzing layout for struct %s from %d samples over %d ranges",
+             struct_info->struct_name, sample_count, range_count);
+    
+    if (init_layout_analysis(struct_info, analysis) != 0) {
+        return -1;
+    }
+    
+    // First writer per field, used to spot cross-thread writes within a line
+    pid_t writer_tid[32] = {0};
+    double latency_sum[32] = {0};
+    size_t size = struct_info->total_size;
+    int total_struct_accesses = 0;
+    
+    for (int i = 0; i < sample_count; i++) {
+        const cache_miss_sample_t *sample = &samples[i];
+        const object_range_t *range = NULL;
+        
+        for (int r = 0; r < range_count; r++) {
+            if (strcmp(ranges[r].struct_info->struct_name, struct_info->struct_name) != 0) {
+                continue;
+            }
+            if (sample->memory_addr >= ranges[r].base_addr &&
+                sample->memory_addr < ranges[r].base_addr + ranges[r].element_count * size) {
+                range = &ranges[r];
+                break;
+            }
+        }
+        if (!range) continue;
+        
+        int field = field_at_offset(struct_info, (sample->memory_addr - range->base_addr) % size);
+        if (field < 0) continue;
+        
+        field_stats_t *stats = &analysis->field_stats[field];
+        stats->access_count++;
+        if (sample->cache_level_missed > 1) {
+            stats->miss_count++;
+        }
+        latency_sum[field] += sample->latency_cycles;
+        total_struct_accesses++;
+        
+        if (sample->is_write && writer_tid[field] == 0) {
+            writer_tid[field] = sample->tid;
+        }
+    }
+    
+    analysis->sample_count = total_struct_accesses;
+    if (total_struct_accesses == 0) {
+        LOG_WARNING("No samples fell inside %s object ranges", struct_info->struct_name);
+        free_layout_analysis(analysis);
+        return -1;
+    }
+    
+    for (int i = 0; i < analysis->field_count; i++) {
+        if (analysis->field_stats[i].access_count > 0) {
+            analysis->field_stats[i].avg_latency_cycles =
+                latency_sum[i] / analysis->field_stats[i].access_count;
+        }
+    }
+    
+    // Fields sharing a line but written by different threads
+    int line_size = (int)analyzer->line_size;
+    for (int i = 0; i < analysis->field_count && !analysis->has_false_sharing; i++) {
+        for (int j = i + 1; j < analysis->field_count; j++) {
+            if (writer_tid[i] && writer_tid[j] && writer_tid[i] != writer_tid[j] &&
+                struct_info->field_offsets[i] / line_size ==
+                struct_info->field_offsets[j] / line_size) {
+                LOG_DEBUG("Sampled false sharing: fields %s and %s written by threads %d and %d",
+                          struct_info->field_names[i], struct_info->field_names[j],
+                          writer_tid[i], writer_tid[j]);
+                analysis->has_false_sharing = true;
+                break;
+            }
+        }
+    }
+    
+    classify_and_recommend(analyzer, struct_info, total_struct_accesses, analysis);
+    
+    return 0;
+}
+
+// Object base anchored by a sample at a known member access
+typedef struct {
+    int struct_index;
+    uint64_t base_addr;
+} object_anchor_t;
+
+static int compare_patterns_by_line(const void *a, const void *b) {
+    const static_pattern_t *pa = *(const static_pattern_t * const *)a;
+    const static_pattern_t *pb = *(const static_pattern_t * const *)b;
+    return pa->location.line - pb->location.line;
+}
+
+static int compare_anchors(const void *a, const void *b) {
+    const object_anchor_t *aa = a;
+    const object_anchor_t *ab = b;
+    if (aa->struct_index != ab->struct_index) {
+        return aa->struct_index - ab->struct_index;
+    }
+    if (aa->base_addr < ab->base_addr) return -1;
+    return aa->base_addr > ab->base_addr;
+}
+
+static const char *path_basename(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// Max gap (in elements) between anchors still treated as one allocation
+#define RANGE_MAX_GAP_ELEMENTS 64
+
+int infer_object_ranges(const analysis_results_t *static_results,
+                       const cache_miss_sample_t *samples, int sample_count,
+                       object_range_t **ranges, int *range_count) {
+    if (!static_results || !samples || !ranges || !range_count) {
+        LOG_ERROR("Invalid parameters for infer_object_ranges");
+        return -1;
+    }
+    
+    *ranges = NULL;
+    *range_count = 0;
+    
+    if (static_results->struct_count == 0 || sample_count <= 0) {
+        return 0;
+    }
+    
+    // Member accesses sorted by line so each sample is a binary search
+    static_pattern_t **members = CALLOC_LOGGED(static_results->pattern_count + 1,
+                                               sizeof(static_pattern_t *));
+    object_anchor_t *anchors = CALLOC_LOGGED(sample_count, sizeof(object_anchor_t));
+    if (!members || !anchors) {
+        LOG_ERROR("Failed to allocate range inference buffers");
+        FREE_LOGGED(members);
+        FREE_LOGGED(anchors);
+        return -1;
+    }
+    
+    int member_count = 0;
+    for (int i = 0; i < static_results->pattern_count; i++) {
+        if (static_results->patterns[i].is_struct_access) {
+            members[member_count++] = &static_results->patterns[i];
+        }
+    }
+    qsort(members, member_count, sizeof(static_pattern_t *), compare_patterns_by_line);
+    
+    int anchor_count = 0;
+    for (int i = 0; i < sample_count; i++) {
+        const cache_miss_sample_t *sample = &samples[i];
+        if (sample->source_loc.line <= 0 || sample->memory_addr == 0) continue;
+        
+        int lo = 0, hi = member_count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (members[mid]->location.line < sample->source_loc.line) lo = mid + 1;
+            else hi = mid;
+        }
+        
+        for (int m = lo; m < member_count && members[m]->location.line == sample->source_loc.line; m++) {
+            const static_pattern_t *access = members[m];
+            if (strcmp(path_basename(access->location.file),
+                       path_basename(sample->source_loc.file)) != 0) {
+                continue;
+            }
+            
+            for (int s = 0; s < static_results->struct_count; s++) {
+                const struct_info_t *info = &static_results->structs[s];
+                if (strcmp(info->struct_name, access->struct_name) != 0) continue;
+                
+                for (int f = 0; f < info->field_count; f++) {
+                    if (strcmp(info->field_names[f], access->variable_name) == 0 &&
+                        sample->memory_addr >= info->field_offsets[f]) {
+                        anchors[anchor_count].struct_index = s;
+                        anchors[anchor_count].base_addr = sample->memory_addr - info->field_offsets[f];
+                        anchor_count++;
+                        goto next_sample;
+                    }
+                }
+            }
+        }
+    next_sample:;
+    }
+    
+    FREE_LOGGED(members);
+    
+    if (anchor_count == 0) {
+        LOG_INFO("No samples matched static member accesses - no object ranges inferred");
+        FREE_LOGGED(anchors);
+        return 0;
+    }
+    
+    qsort(anchors, anchor_count, sizeof(object_anchor_t), compare_anchors);
+    
+    // Coalesce anchors that sit on a common element grid into ranges
+    *ranges = CALLOC_LOGGED(anchor_count, sizeof(object_range_t));
+    if (!*ranges) {
+        LOG_ERROR("Failed to allocate object ranges");
+        FREE_LOGGED(anchors);
+        return -1;
+    }
+    
+    int count = 0;
+    for (int i = 0; i < anchor_count; ) {
+        const struct_info_t *info = &static_results->structs[anchors[i].struct_index];
+        size_t size = info->total_size > 0 ? info->total_size : 1;
+        uint64_t start = anchors[i].base_addr;
+        uint64_t last = start;
+        int j = i + 1;
+        
+        while (j < anchor_count && anchors[j].struct_index == anchors[i].struct_index &&
+               (anchors[j].base_addr - start) % size == 0 &&
+               anchors[j].base_addr - last <= size * RANGE_MAX_GAP_ELEMENTS) {
+            last = anchors[j].base_addr;
+            j++;
+        }
+        
+        (*ranges)[count].struct_info = info;
+        (*ranges)[count].base_addr = start;
+        (*ranges)[count].element_count = (last - start) / size + 1;
+        LOG_DEBUG("Object range for %s: 0x%lx, %zu elements (%d anchors)",
+                  info->struct_name, start, (*ranges)[count].element_count, j - i);
+        count++;
+        i = j;
+    }
+    
+    FREE_LOGGED(anchors);
+    *range_count = count;
+    
+    LOG_INFO("Inferred %d object ranges from %d anchored samples", count, anchor_count);
+    return 0;
+}
+
+void free_object_ranges(object_range_t *ranges) {
+    if (ranges) {
+        FREE_LOGGED(ranges);
+    }
+}
+
+// Member access tagged with its field index, grouped by enclosing loop
+typedef struct {
+    const static_pattern_t *access;
+    int field;
+} member_access_t;
+
+static int compare_member_scope(const void *a, const void *b) {
+    const static_pattern_t *pa = ((const member_access_t *)a)->access;
+    const static_pattern_t *pb = ((const member_access_t *)b)->access;
+    int cmp = strcmp(pa->location.file, pb->location.file);
+    if (cmp != 0) return cmp;
+    cmp = strcmp(pa->location.function, pb->location.function);
+    if (cmp != 0) return cmp;
+    return pa->enclosing_loop_line - pb->enclosing_loop_line;
+}
+
+static int find_field(const struct_info_t *struct_info, const char *name) {
+    for (int i = 0; i < struct_info->field_count; i++) {
+        if (strcmp(struct_info->field_names[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int build_field_affinity_static(const struct_info_t *struct_info,
+                               const static_pattern_t *accesses, int access_count,
+                               field_affinity_t *affinity) {
+    if (!struct_info || !affinity || (access_count > 0 && !accesses)) {
+        LOG_ERROR("Invalid parameters for build_field_affinity_static");
+        return -1;
+    }
+    
+    memset(affinity, 0, sizeof(field_affinity_t));
+    affinity->field_count = struct_info->field_count;
+    if (access_count <= 0) return 0;
+    
+    member_access_t *members = CALLOC_LOGGED(access_count, sizeof(member_access_t));
+    if (!members) {
+        LOG_ERROR("Failed to allocate member access buffer");
+        return -1;
+    }
+    
+    int member_count = 0;
+    for (int i = 0; i < access_count; i++) {
+        if (!accesses[i].is_struct_access ||
+            strcmp(accesses[i].struct_name, struct_info->struct_name) != 0) {
+            continue;
+        }
+        int field = find_field(struct_info, accesses[i].variable_name);
+        if (field < 0) continue;
+        members[member_count].access = &accesses[i];
+        members[member_count].field = field;
+        member_count++;
+    }
+    
+    qsort(members, member_count, sizeof(member_access_t), compare_member_scope);
+    
+    // Fields touched in the same loop body are co-accessed; deeper loops weigh more
+    for (int i = 0; i < member_count; ) {
+        bool touched[32] = {false};
+        int depth = 0;
+        int j = i;
+        
+        while (j < member_count && compare_member_scope(&members[i], &members[j]) == 0) {
+            touched[members[j].field] = true;
+            if (members[j].access->loop_depth > depth) {
+                depth = members[j].access->loop_depth;
+            }
+            j++;
+        }
+        
+        double weight = (double)(1 << (3 * (depth < 4 ? depth : 4)));
+        for (int a = 0; a < struct_info->field_count; a++) {
+            if (!touched[a]) continue;
+            affinity->field_heat[a] += weight;
+            affinity->total_weight += weight;
+            for (int b = a + 1; b < struct_info->field_count; b++) {
+                if (touched[b]) {
+                    affinity->weights[a][b] += weight;
+                    affinity->weights[b][a] += weight;
+                }
+            }
+        }
+        i = j;
+    }
+    
+    FREE_LOGGED(members);
+    
+    LOG_DEBUG("Static affinity for %s built from %d member accesses",
+              struct_info->struct_name, member_count);
+    return 0;
+}
+
+// Sampled field access on a specific object instance
+typedef struct {
+    uint64_t element;
+    uint64_t timestamp;
+    int field;
+} field_sample_t;
+
+static int compare_field_samples(const void *a, const void *b) {
+    const field_sample_t *fa = a;
+    const field_sample_t *fb = b;
+    if (fa->element != fb->element) return fa->element < fb->element ? -1 : 1;
+    if (fa->timestamp != fb->timestamp) return fa->timestamp < fb->timestamp ? -1 : 1;
+    return 0;
+}
+
+int build_field_affinity_dynamic(const struct_info_t *struct_info,
+                                const object_range_t *ranges, int range_count,
+                                const cache_miss_sample_t *samples, int sample_count,
+                                uint64_t window_ns, field_affinity_t *affinity) {
+    if (!struct_info || !ranges || !samples || !affinity || struct_info->total_size == 0) {
+        LOG_ERROR("Invalid parameters for build_field_affinity_dynamic");
+        return -1;
+    }
+    
+    memset(affinity, 0, sizeof(field_affinity_t));
+    affinity->field_count = struct_info->field_count;
+    if (range_count <= 0 || sample_count <= 0) return 0;
+    
+    field_sample_t *hits = CALLOC_LOGGED(sample_count, sizeof(field_sample_t));
+    if (!hits) {
+        LOG_ERROR("Failed to allocate field sample buffer");
+        return -1;
+    }
+    
+    size_t size = struct_info->total_size;
+    int hit_count = 0;
+    
+    for (int i = 0; i < sample_count; i++) {
+        for (int r = 0; r < range_count; r++) {
+            if (strcmp(ranges[r].struct_info->struct_name, struct_info->struct_name) != 0 ||
+                samples[i].memory_addr < ranges[r].base_addr ||
+                samples[i].memory_addr >= ranges[r].base_addr + ranges[r].element_count * size) {
+                continue;
+            }
+            
+            uint64_t rel = samples[i].memory_addr - ranges[r].base_addr;
+            int field = field_at_offset(struct_info, rel % size);
+            if (field >= 0) {
+                hits[hit_count].element = ranges[r].base_addr + (rel / size) * size;
+                hits[hit_count].timestamp = samples[i].timestamp;
+                hits[hit_count].field = field;
+                hit_count++;
+            }
+            break;
+        }
+    }
+    
+    qsort(hits, hit_count, sizeof(field_sample_t), compare_field_samples);
+    
+    // Different fields of the same object sampled within the window are co-accessed
+    for (int i = 0; i < hit_count; i++) {
+        affinity->field_heat[hits[i].field] += 1.0;
+        affinity->total_weight += 1.0;
+        
+        for (int j = i + 1; j < hit_count && hits[j].element == hits[i].element &&
+             hits[j].timestamp - hits[i].timestamp <= window_ns; j++) {
+            if (hits[j].field != hits[i].field) {
+                affinity->weights[hits[i].field][hits[j].field] += 1.0;
+                affinity->weights[hits[j].field][hits[i].field] += 1.0;
+            }
+        }
+    }
+    
+    FREE_LOGGED(hits);
+    
+    LOG_DEBUG("Dynamic affinity for %s built from %d samples (window %lu ns)",
+              struct_info->struct_name, hit_count, window_ns);
+    return 0;
+}
+
+static size_t field_alignment(const struct_info_t *struct_info, int field) {
+    if (struct_info->is_packed) return 1;
+    if (struct_info->field_aligns[field] > 0) return struct_info->field_aligns[field];
+    
+    // Fall back to natural alignment of the scalar size
+    size_t align = 1;
+    while (align * 2 <= struct_info->field_sizes[field] && align < 8) {
+        align *= 2;
+    }
+    return align;
+}
+
+// Lay out fields in the given order with natural alignment; returns struct size
+static size_t layout_fields(const struct_info_t *struct_info, const int *order,
+                            size_t *offsets) {
+    size_t offset = 0;
+    size_t max_align = 1;
+    
+    for (int k = 0; k < struct_info->field_count; k++) {
+        int field = order[k];
+        size_t align = field_alignment(struct_info, field);
+        offset = (offset + align - 1) / align * align;
+        offsets[field] = offset;
+        offset += struct_info->field_sizes[field];
+        if (align > max_align) max_align = align;
+    }
+    
+    return (offset + max_align - 1) / max_align * max_align;
+}
+
+static size_t gcd_size(size_t a, size_t b) {
+    while (b) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+double estimate_lines_touched(const data_layout_analyzer_t *analyzer,
+                             const struct_info_t *struct_info,
+                             const field_affinity_t *affinity,
+                             const size_t *offsets, size_t struct_size) {
+    if (!analyzer || !struct_info || !affinity || !offsets || struct_size == 0) return 0.0;
+    
+    size_t line = analyzer->line_size;
+    
+    // Array elements start at every multiple of the struct size modulo the line
+    size_t start_count = line / gcd_size(struct_size, line);
+    if (start_count > 64) start_count = 64;
+    
+    double total = 0.0;
+    double events = 0.0;
+    
+    for (size_t s = 0; s < start_count; s++) {
+        size_t start = (s * struct_size) % line;
+        
+        for (int i = 0; i < struct_info->field_count; i++) {
+            size_t size_i = struct_info->field_sizes[i] > 0 ? struct_info->field_sizes[i] : 1;
+            size_t first_i = (start + offsets[i]) / line;
+            size_t last_i = (start + offsets[i] + size_i - 1) / line;
+            
+            // Single-field accesses
+            total += affinity->field_heat[i] * (last_i - first_i + 1);
+            events += affinity->field_heat[i];
+            
+            // Co-accessed pairs touch the union of both fields' lines
+            for (int j = i + 1; j < struct_info->field_count; j++) {
+                double w = affinity->weights[i][j];
+                if (w <= 0) continue;
+                
+                size_t size_j = struct_info->field_sizes[j] > 0 ? struct_info->field_sizes[j] : 1;
+                size_t first_j = (start + offsets[j]) / line;
+                size_t last_j = (start + offsets[j] + size_j - 1) / line;
+                
+                size_t lo = first_i > first_j ? first_i : first_j;
+                size_t hi = last_i < last_j ? last_i : last_j;
+                size_t overlap = hi >= lo ? hi - lo + 1 : 0;
+                
+                total += w * ((last_i - first_i + 1) + (last_j - first_j + 1) - overlap);
+                events += w;
+            }
+        }
+    }
+    
+    return events > 0 ? total / events : 0.0;
+}
+
+// Objective: lines touched per hot access plus padding waste in line units
+static double reorder_cost(const data_layout_analyzer_t *analyzer,
+                           const struct_info_t *struct_info, const field_affinity_t *affinity,
+                           const int *order, size_t payload) {
+    size_t offsets[32];
+    size_t size = layout_fields(struct_info, order, offsets);
+    size_t line = analyzer->line_size;
+    
+    return estimate_lines_touched(analyzer, struct_info, affinity, offsets, size) +
+           (double)(size - payload) / line;
+}
+
+int optimize_field_order(const data_layout_analyzer_t *analyzer,
+                        const struct_info_t *struct_info,
+                        const field_affinity_t *affinity,
+                        field_reorder_t *result) {
+    if (!analyzer || !struct_info || !affinity || !result || struct_info->field_count <= 0) {
+        LOG_ERROR("Invalid parameters for optimize_field_order");
+        return -1;
+    }
+    
+    memset(result, 0, sizeof(field_reorder_t));
+    int n = struct_info->field_count;
+    result->field_count = n;
+    
+    // Overlapping fields mean unions or bit-fields, which we do not reorder
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            if (struct_info->field_offsets[i] == struct_info->field_offsets[j]) {
+                LOG_INFO("Struct %s has overlapping fields - skipping reordering",
+                         struct_info->struct_name);
+                return -1;
+            }
+        }
+    }
+    
+    size_t payload = 0;
+    for (int i = 0; i < n; i++) {
+        payload += struct_info->field_sizes[i];
+    }
+    
+    result->old_size = struct_info->total_size;
+    result->old_padding = struct_info->total_size > payload ? struct_info->total_size - payload : 0;
+    result->lines_before = estimate_lines_touched(analyzer, struct_info, affinity,
+                                                  struct_info->field_offsets,
+                                                  struct_info->total_size);
+    
+    // Greedy seed: start from the hottest field, then keep pulling in the field
+    // with the strongest affinity to what is already placed
+    int order[32];
+    bool placed[32] = {false};
+    int count = 0;
+    
+    while (count < n) {
+        int best = -1;
+        double best_score = -1.0;
+        
+        for (int f = 0; f < n; f++) {
+            if (placed[f]) continue;
+            
+            double score = affinity->field_heat[f] * 1e-3;
+            for (int k = 0; k < count; k++) {
+                score += affinity->weights[f][order[k]];
+            }
+            
+            // Cold fields go last, largest alignment first to limit padding
+            if (affinity->field_heat[f] <= 0) {
+                score = -1.0 + (double)field_alignment(struct_info, f) * 1e-6;
+            }
+            
+            if (best < 0 || score > best_score) {
+                best = f;
+                best_score = score;
+            }
+        }
+        
+        order[count++] = best;
+        placed[best] = true;
+    }
+    
+    // Pairwise swap refinement
+    double cost = reorder_cost(analyzer, struct_info, affinity, order, payload);
+    for (int pass = 0; pass < 8; pass++) {
+        bool improved = false;
+        
+        for (int a = 0; a < n; a++) {
+            for (int b = a + 1; b < n; b++) {
+                int tmp = order[a];
+                order[a] = order[b];
+                order[b] = tmp;
+                
+                double candidate = reorder_cost(analyzer, struct_info, affinity, order, payload);
+                if (candidate < cost - 1e-9) {
+                    cost = candidate;
+                    improved = true;
+                } else {
+                    order[b] = order[a];
+                    order[a] = tmp;
+                }
+            }
+        }
+        
+        if (!improved) break;
+    }
+    
+    // Keep the declared order unless the search actually beats it
+    int declared[32];
+    for (int i = 0; i < n; i++) {
+        declared[i] = i;
+    }
+    if (reorder_cost(analyzer, struct_info, affinity, declared, payload) <= cost) {
+        memcpy(order, declared, sizeof(int) * n);
+    }
+    
+    memcpy(result->order, order, sizeof(int) * n);
+    result->new_size = layout_fields(struct_info, order, result->new_offsets);
+    result->new_padding = result->new_size > payload ? result->new_size - payload : 0;
+    result->lines_after = estimate_lines_touched(analyzer, struct_info, affinity,
+                                                 result->new_offsets, result->new_size);
+    
+    // Emit the reordered definition
+    size_t line = analyzer->line_size;
+    char *code = result->struct_definition;
+    size_t code_size = sizeof(result->struct_definition);
+    
+    snprintf(code, code_size,
+            "// Reordered %s: %.2f -> %.2f cache lines per hot access, %zu -> %zu bytes\n"
+            "struct %s {\n",
+            struct_info->struct_name, result->lines_before, result->lines_after,
+            result->old_size, result->new_size, struct_info->struct_name);
+    
+    for (int k = 0; k < n; k++) {
+        int f = order[k];
+        char field_line[256];
+        double heat = affinity->total_weight > 0 ?
+                      affinity->field_heat[f] / affinity->total_weight * 100 : 0.0;
+        
+        if (struct_info->field_decls[f][0]) {
+            snprintf(field_line, sizeof(field_line),
+                    "    %s;  // offset %zu, line %zu, %.1f%% of accesses\n",
+                    struct_info->field_decls[f], result->new_offsets[f],
+                    result->new_offsets[f] / line, heat);
+        } else {
+            snprintf(field_line, sizeof(field_line),
+                    "    type %s;  // offset %zu, line %zu, %.1f%% of accesses\n",
+                    struct_info->field_names[f], result->new_offsets[f],
+                    result->new_offsets[f] / line, heat);
+        }
+        strncat(code, field_line, code_size - strlen(code) - 1);
+    }
+    
+    strncat(code, struct_info->is_packed ? "} __attribute__((packed));\n" : "};\n",
+            code_size - strlen(code) - 1);
+    
+    LOG_INFO("Field reordering for %s: %.2f -> %.2f lines per hot access, padding %zu -> %zu",
+             struct_info->struct_name, result->lines_before, result->lines_after,
+             result->old_padding, result->new_padding);
+    
+    return 0;
+}
+
+void print_field_reorder(const struct_info_t *struct_info, const field_reorder_t *result) {
+    if (!struct_info || !result) return;
+    
+    printf("\n=== Field Reordering: %s ===\n", struct_info->struct_name);
+    printf("Lines touched per hot access: %.2f -> %.2f\n",
+           result->lines_before, result->lines_after);
+    printf("Size: %zu -> %zu bytes (padding %zu -> %zu)\n",
+           result->old_size, result->new_size, result->old_padding, result->new_padding);
+    printf("\n%s\n", result->struct_definition);
+}
+
 int analyze_array_layout(const static_pattern_t *accesses, int access_count,
                         array_analysis_t *analysis) {
     if (!accesses || !analysis || access_count <= 0) {
@@ -317,9 +1048,27 @@ int analyze_array_layout(const static_pattern_t *accesses, int access_count,
     return 0;
 }
 
-int suggest_struct_transformation(const struct_layout_analysis_t *analysis,
+// Append one field of a hot/cold split, using its declaration when known
+static void append_split_field(const struct_layout_analysis_t *analysis, int i,
+                               char *code, size_t code_size) {
+    const char *decl = analysis->struct_info->field_decls[i];
+    char field_line[256];
+    
+    if (decl[0]) {
+        snprintf(field_line, sizeof(field_line), "    %s;  // %.1f%% of accesses\n",
+                decl, analysis->field_stats[i].access_frequency);
+    } else {
+        snprintf(field_line, sizeof(field_line), "    type %s;  // %.1f%% of accesses\n",
+                analysis->field_stats[i].field_name,
+                analysis->field_stats[i].access_frequency);
+    }
+    strncat(code, field_line, code_size - strlen(code) - 1);
+}
+
+int suggest_struct_transformation(const data_layout_analyzer_t *analyzer,
+                                 const struct_layout_analysis_t *analysis,
                                  char *transformation_code, size_t code_size) {
-    if (!analysis || !transformation_code || code_size == 0) {
+    if (!analyzer || !analysis || !transformation_code || code_size == 0) {
         LOG_ERROR("Invalid parameters for suggest_struct_transformation");
         return -1;
     }
@@ -346,6 +1095,43 @@ int suggest_struct_transformation(const struct_layout_analysis_t *analysis,
                 analysis->cache_efficiency,
                 analysis->predicted_efficiency);
                 
+    } else if (analysis->recommended_layout == LAYOUT_AOSOA) {
+        int block = choose_aosoa_block_size(analysis->struct_info, &analyzer->cache_info);
+        generate_aosoa_definition(analyzer, analysis->struct_info, block > 0 ? block : 8,
+                                  transformation_code, code_size);
+        
+    } else if (analysis->recommended_layout == LAYOUT_HOT_COLD_SPLIT) {
+        snprintf(transformation_code, code_size,
+                "// Hot/cold split for %s: rarely touched fields move out of line\n"
+                "struct %s_cold;\n\n"
+                "struct %s {\n",
+                analysis->struct_info->struct_name,
+                analysis->struct_info->struct_name,
+                analysis->struct_info->struct_name);
+        
+        for (int i = 0; i < analysis->field_count; i++) {
+            if (analysis->field_stats[i].is_cold) continue;
+            append_split_field(analysis, i, transformation_code, code_size);
+        }
+        
+        char cold_header[256];
+        snprintf(cold_header, sizeof(cold_header),
+                "    struct %s_cold *cold;  // Allocated alongside, touched rarely\n"
+                "};\n\n"
+                "struct %s_cold {\n",
+                analysis->struct_info->struct_name,
+                analysis->struct_info->struct_name);
+        strncat(transformation_code, cold_header,
+                code_size - strlen(transformation_code) - 1);
+        
+        for (int i = 0; i < analysis->field_count; i++) {
+            if (!analysis->field_stats[i].is_cold) continue;
+            append_split_field(analysis, i, transformation_code, code_size);
+        }
+        
+        strncat(transformation_code, "};\n",
+                code_size - strlen(transformation_code) - 1);
+        
     } else if (analysis->recommended_layout == LAYOUT_PACKED) {
         snprintf(transformation_code, code_size,
                 "// Packed structure to eliminate padding\n"
@@ -373,7 +1159,7 @@ int suggest_struct_transformation(const struct_layout_analysis_t *analysis,
         snprintf(transformation_code, code_size,
                 "// Cache-aligned structure to prevent false sharing\n"
                 "struct alignas(%d) %s_aligned {\n",
-                (int)g_cache_info.levels[0].line_size,
+                (int)analyzer->line_size,
                 analysis->struct_info->struct_name);
                 
         // Group hot fields together
@@ -412,6 +1198,8 @@ int suggest_struct_transformation(const struct_layout_analysis_t *analysis,
     
     LOG_DEBUG("Generated transformation code for %s layout",
               analysis->recommended_layout == LAYOUT_SOA ? "SoA" :
+              analysis->recommended_layout == LAYOUT_AOSOA ? "AoSoA" :
+              analysis->recommended_layout == LAYOUT_HOT_COLD_SPLIT ? "hot/cold split" :
               analysis->recommended_layout == LAYOUT_PACKED ? "packed" :
               analysis->recommended_layout == LAYOUT_ALIGNED ? "aligned" : "unknown");
     
@@ -485,11 +1273,12 @@ int calculate_structure_padding(const struct_info_t *struct_info) {
     return padding;
 }
 
-int detect_false_sharing_risk(const struct_info_t *struct_info, 
+int detect_false_sharing_risk(const data_layout_analyzer_t *analyzer,
+                             const struct_info_t *struct_info, 
                              const static_pattern_t *accesses, int access_count) {
-    if (!struct_info || !accesses || access_count <= 0) return 0;
+    if (!analyzer || !struct_info || !accesses || access_count <= 0) return 0;
     
-    int cache_line_size = g_cache_info.levels[0].line_size;
+    int cache_line_size = (int)analyzer->line_size;
     int risk_count = 0;
     
     // Check if different fields that might be accessed by different threads
@@ -545,18 +1334,34 @@ void print_layout_analysis(const struct_layout_analysis_t *analysis) {
     printf("Padding bytes: %zu\n", analysis->padding_bytes);
     printf("False sharing risk: %s\n", analysis->has_false_sharing ? "Yes" : "No");
     
-    printf("\nField Access Statistics:\n");
-    for (int i = 0; i < analysis->field_count; i++) {
-        printf("  %-20s: %4d accesses (%5.1f%%) %s\n",
-               analysis->field_stats[i].field_name,
-               analysis->field_stats[i].access_count,
-               analysis->field_stats[i].access_frequency,
-               analysis->field_stats[i].is_hot ? "[HOT]" :
-               analysis->field_stats[i].is_cold ? "[COLD]" : "");
+    if (analysis->sample_count > 0) {
+        printf("\nField Access Statistics (%d runtime samples):\n", analysis->sample_count);
+        for (int i = 0; i < analysis->field_count; i++) {
+            printf("  %-20s: %4d samples (%5.1f%%), %4d misses, %6.1f cycles %s\n",
+                   analysis->field_stats[i].field_name,
+                   analysis->field_stats[i].access_count,
+                   analysis->field_stats[i].access_frequency,
+                   analysis->field_stats[i].miss_count,
+                   analysis->field_stats[i].avg_latency_cycles,
+                   analysis->field_stats[i].is_hot ? "[HOT]" :
+                   analysis->field_stats[i].is_cold ? "[COLD]" : "");
+        }
+    } else {
+        printf("\nField Access Statistics:\n");
+        for (int i = 0; i < analysis->field_count; i++) {
+            printf("  %-20s: %4d accesses (%5.1f%%) %s\n",
+                   analysis->field_stats[i].field_name,
+                   analysis->field_stats[i].access_count,
+                   analysis->field_stats[i].access_frequency,
+                   analysis->field_stats[i].is_hot ? "[HOT]" :
+                   analysis->field_stats[i].is_cold ? "[COLD]" : "");
+        }
     }
     
     printf("\nRecommended layout: %s\n",
            analysis->recommended_layout == LAYOUT_SOA ? "Structure of Arrays (SoA)" :
+           analysis->recommended_layout == LAYOUT_AOSOA ? "Array of Structure of Arrays (AoSoA)" :
+           analysis->recommended_layout == LAYOUT_HOT_COLD_SPLIT ? "Hot/cold split" :
            analysis->recommended_layout == LAYOUT_PACKED ? "Packed" :
            analysis->recommended_layout == LAYOUT_ALIGNED ? "Cache-aligned" :
            "No change");
@@ -633,3 +1438,191 @@ int generate_aos_to_soa_conversion(const struct_info_t *struct_info,
     
     return 0;
 }
+
+int choose_aosoa_block_size(const struct_info_t *struct_info, const cache_info_t *cache_info) {
+    if (!struct_info || !cache_info || struct_info->field_count <= 0) return -1;
+    
+    size_t min_size = 0;
+    for (int i = 0; i < struct_info->field_count; i++) {
+        size_t size = struct_info->field_sizes[i];
+        if (size > 0 && (min_size == 0 || size < min_size)) {
+            min_size = size;
+        }
+    }
+    if (min_size == 0) return -1;
+    
+    int simd_width = cache_info->simd_width_bytes > 0 ? cache_info->simd_width_bytes : 16;
+    int line_size = cache_info->levels[0].line_size > 0 ? (int)cache_info->levels[0].line_size : 64;
+    
+    // Every field run must fill whole vectors, and the narrowest one a whole line
+    int block = simd_width / (int)min_size;
+    if (block < line_size / (int)min_size) {
+        block = line_size / (int)min_size;
+    }
+    if (block < 1) block = 1;
+    
+    // Round up to a power of two so index math reduces to shifts and masks
+    int pow2 = 1;
+    while (pow2 < block && pow2 < 64) {
+        pow2 *= 2;
+    }
+    
+    LOG_DEBUG("AoSoA block size for %s: %d (simd=%d, line=%d, narrowest field=%zu)",
+              struct_info->struct_name, pow2, simd_width, line_size, min_size);
+    return pow2;
+}
+
+// Write the declarator for field[count], e.g. "float pos[3]" -> "float pos[8][3]"
+static void format_field_array_decl(const struct_info_t *struct_info, int field,
+                                    const char *count, char *out, size_t out_size) {
+    const char *decl = struct_info->field_decls[field];
+    const char *name = struct_info->field_names[field];
+    const char *at = decl[0] ? strstr(decl, name) : NULL;
+    
+    if (!at) {
+        snprintf(out, out_size, "type %s[%s]", name, count);
+        return;
+    }
+    
+    size_t name_end = (at - decl) + strlen(name);
+    snprintf(out, out_size, "%.*s[%s]%s", (int)name_end, decl, count, decl + name_end);
+}
+
+int generate_aosoa_definition(const data_layout_analyzer_t *analyzer,
+                             const struct_info_t *struct_info, int block_size,
+                             char *code, size_t code_size) {
+    if (!analyzer || !struct_info || !code || code_size == 0 || block_size <= 0) return -1;
+    
+    int line_size = (int)analyzer->line_size;
+    char block_macro[160];
+    snprintf(block_macro, sizeof(block_macro), "%s_AOSOA_BLOCK", struct_info->struct_name);
+    for (char *p = block_macro; *p; p++) {
+        if (*p >= 'a' && *p <= 'z') *p -= 'a' - 'A';
+    }
+    
+    snprintf(code, code_size,
+            "// AoSoA layout for %s: blocks of %d elements, each field contiguous in a block\n"
+            "#define %s %d\n\n"
+            "struct %s_AoSoA_block {\n",
+            struct_info->struct_name, block_size,
+            block_macro, block_size,
+            struct_info->struct_name);
+    
+    for (int i = 0; i < struct_info->field_count; i++) {
+        char decl[256];
+        char field_line[320];
+        format_field_array_decl(struct_info, i, block_macro, decl, sizeof(decl));
+        snprintf(field_line, sizeof(field_line), "    %s;\n", decl);
+        strncat(code, field_line, code_size - strlen(code) - 1);
+    }
+    
+    char tail[1024];
+    snprintf(tail, sizeof(tail),
+            "} __attribute__((aligned(%d)));\n\n"
+            "struct %s_AoSoA {\n"
+            "    size_t count;\n"
+            "    struct %s_AoSoA_block *blocks;  // (count + %s - 1) / %s blocks\n"
+            "};\n\n"
+            "// Element accessors (lvalues)\n",
+            line_size,
+            struct_info->struct_name,
+            struct_info->struct_name, block_macro, block_macro);
+    strncat(code, tail, code_size - strlen(code) - 1);
+    
+    for (int i = 0; i < struct_info->field_count; i++) {
+        char accessor[320];
+        snprintf(accessor, sizeof(accessor),
+                "#define %s_aosoa_%s(s, i) ((s)->blocks[(i) / %s].%s[(i) %% %s])\n",
+                struct_info->struct_name, struct_info->field_names[i],
+                block_macro, struct_info->field_names[i], block_macro);
+        strncat(code, accessor, code_size - strlen(code) - 1);
+    }
+    
+    return 0;
+}
+
+int generate_aos_to_aosoa_conversion(const data_layout_analyzer_t *analyzer,
+                                    const struct_info_t *struct_info,
+                                    const char *aos_var, const char *aosoa_var,
+                                    int block_size, char *code, size_t code_size) {
+    if (!analyzer || !struct_info || !aos_var || !aosoa_var || !code || code_size == 0 || block_size <= 0) {
+        return -1;
+    }
+    
+    int line_size = (int)analyzer->line_size;
+    
+    snprintf(code, code_size,
+            "// Convert AoS to AoSoA\n"
+            "int convert_%s_aos_to_aosoa(const struct %s *%s, struct %s_AoSoA *%s, size_t count) {\n"
+            "    size_t nblocks = (count + %d - 1) / %d;\n"
+            "    %s->count = count;\n"
+            "    %s->blocks = aligned_alloc(%d, nblocks * sizeof(struct %s_AoSoA_block));\n"
+            "    if (!%s->blocks) return -1;\n"
+            "    memset(%s->blocks, 0, nblocks * sizeof(struct %s_AoSoA_block));\n"
+            "    \n"
+            "    for (size_t i = 0; i < count; i++) {\n"
+            "        struct %s_AoSoA_block *b = &%s->blocks[i / %d];\n"
+            "        size_t lane = i %% %d;\n",
+            struct_info->struct_name, struct_info->struct_name, aos_var,
+            struct_info->struct_name, aosoa_var,
+            block_size, block_size,
+            aosoa_var,
+            aosoa_var, line_size, struct_info->struct_name,
+            aosoa_var,
+            aosoa_var, struct_info->struct_name,
+            struct_info->struct_name, aosoa_var, block_size,
+            block_size);
+    
+    for (int i = 0; i < struct_info->field_count; i++) {
+        char copy_line[256];
+        snprintf(copy_line, sizeof(copy_line),
+                "        memcpy(&b->%s[lane], &%s[i].%s, sizeof(%s[i].%s));\n",
+                struct_info->field_names[i], aos_var, struct_info->field_names[i],
+                aos_var, struct_info->field_names[i]);
+        strncat(code, copy_line, code_size - strlen(code) - 1);
+    }
+    
+    strncat(code, "    }\n    return 0;\n}\n", code_size - strlen(code) - 1);
+    
+    return 0;
+}
+
+uint64_t layout_element_address(const data_layout_analyzer_t *analyzer,
+                               const struct_info_t *struct_info, data_layout_t layout,
+                               int block_size, size_t element_count,
+                               size_t index, int field) {
+    if (!analyzer || !struct_info || field < 0 || field >= struct_info->field_count) return 0;
+    
+    const uint64_t base = 0x10000000;
+    const size_t page = 4096;
+    size_t line = analyzer->line_size;
+    
+    switch (layout) {
+        case LAYOUT_SOA: {
+            // One page-aligned array per field
+            uint64_t addr = base;
+            for (int f = 0; f < field; f++) {
+                addr += (element_count * struct_info->field_sizes[f] + page - 1) / page * page;
+            }
+            return addr + index * struct_info->field_sizes[field];
+        }
+        
+        case LAYOUT_AOSOA: {
+            if (block_size <= 0) block_size = 1;
+            size_t inner = 0;
+            size_t block_bytes = 0;
+            for (int f = 0; f < struct_info->field_count; f++) {
+                size_t align = field_alignment(struct_info, f);
+                block_bytes = (block_bytes + align - 1) / align * align;
+                if (f == field) inner = block_bytes;
+                block_bytes += block_size * struct_info->field_sizes[f];
+            }
+            block_bytes = (block_bytes + line - 1) / line * line;
+            return base + (index / block_size) * block_bytes + inner +
+                   (index % block_size) * struct_info->field_sizes[field];
+        }
+        
+        default:
+            return base + index * struct_info->total_size + struct_info->field_offsets[field];
+    }
+}
@@ -4,6 +4,7 @@
 #include "common.h"
 #include "ast_analyzer.h"
 #include "hardware_detector.h"
+#include "perf_sampler.h"
 
 // Data layout types
 typedef enum {
@@ -12,7 +13,8 @@ typedef enum {
     LAYOUT_AOSOA,      // Hybrid - Array of Structure of Arrays
     LAYOUT_PACKED,     // Packed structure
     LAYOUT_ALIGNED,    // Cache-aligned structure
-    LAYOUT_CUSTOM      // Custom layout
+    LAYOUT_CUSTOM,     // Custom layout
+    LAYOUT_HOT_COLD_SPLIT  // Cold fields moved out behind a pointer
 } data_layout_t;
 
 // Field access statistics
@@ -24,8 +26,17 @@ typedef struct {
     bool is_cold;            // Rarely accessed field
     size_t field_offset;
     size_t field_size;
+    int miss_count;          // Sampled misses beyond L1 (dynamic analysis only)
+    double avg_latency_cycles;
 } field_stats_t;
 
+// Runtime address range holding contiguous instances of a struct
+typedef struct {
+    const struct_info_t *struct_info;
+    uint64_t base_addr;
+    size_t element_count;
+} object_range_t;
+
 // Structure layout analysis
 typedef struct {
     struct_info_t *struct_info;
@@ -37,6 +48,7 @@ typedef struct {
     double predicted_efficiency;  // After transformation
     size_t padding_bytes;         // Wasted bytes due to padding
     bool has_false_sharing;       // Potential false sharing detected
+    int sample_count;             // Samples attributed to the struct (0 = static counts)
     char transformation_code[2048];
 } struct_layout_analysis_t;
 
@@ -53,18 +65,77 @@ typedef struct {
     char optimization_suggestion[512];
 } array_analysis_t;
 
+// Field co-access affinity graph
+typedef struct {
+    int field_count;
+    double weights[32][32];       // Symmetric co-access weight per field pair
+    double field_heat[32];        // Access weight per field
+    double total_weight;
+} field_affinity_t;
+
+// Field reordering result
+typedef struct {
+    int order[32];                // New position -> original field index
+    size_t new_offsets[32];       // Indexed by original field index
+    int field_count;
+    size_t old_size;
+    size_t new_size;
+    size_t old_padding;
+    size_t new_padding;
+    double lines_before;          // Expected cache lines touched per hot access
+    double lines_after;
+    char struct_definition[2048]; // Ready-to-paste reordered definition
+} field_reorder_t;
+
+// Analyzer context bound to one cache hierarchy
+typedef struct data_layout_analyzer data_layout_analyzer_t;
+
 // API functions
-int data_layout_analyzer_init(const cache_info_t *cache_info);
-void data_layout_analyzer_cleanup(void);
+data_layout_analyzer_t* data_layout_analyzer_create(const cache_info_t *cache_info);
+void data_layout_analyzer_destroy(data_layout_analyzer_t *analyzer);
 
-int analyze_struct_layout(const struct_info_t *struct_info,
+int analyze_struct_layout(const data_layout_analyzer_t *analyzer,
+                         const struct_info_t *struct_info,
                          const static_pattern_t *accesses, int access_count,
                          struct_layout_analysis_t *analysis);
 
+// Dynamic variant: field access counts come from samples falling inside
+// object ranges instead of static MemberExpr occurrences
+int analyze_struct_layout_dynamic(const data_layout_analyzer_t *analyzer,
+                                 const struct_info_t *struct_info,
+                                 const object_range_t *ranges, int range_count,
+                                 const cache_miss_sample_t *samples, int sample_count,
+                                 struct_layout_analysis_t *analysis);
+
+// Infer object ranges by anchoring samples at static member accesses
+int infer_object_ranges(const analysis_results_t *static_results,
+                       const cache_miss_sample_t *samples, int sample_count,
+                       object_range_t **ranges, int *range_count);
+void free_object_ranges(object_range_t *ranges);
+
+// Field affinity and reordering
+int build_field_affinity_static(const struct_info_t *struct_info,
+                               const static_pattern_t *accesses, int access_count,
+                               field_affinity_t *affinity);
+int build_field_affinity_dynamic(const struct_info_t *struct_info,
+                                const object_range_t *ranges, int range_count,
+                                const cache_miss_sample_t *samples, int sample_count,
+                                uint64_t window_ns, field_affinity_t *affinity);
+double estimate_lines_touched(const data_layout_analyzer_t *analyzer,
+                             const struct_info_t *struct_info,
+                             const field_affinity_t *affinity,
+                             const size_t *offsets, size_t struct_size);
+int optimize_field_order(const data_layout_analyzer_t *analyzer,
+                        const struct_info_t *struct_info,
+                        const field_affinity_t *affinity,
+                        field_reorder_t *result);
+void print_field_reorder(const struct_info_t *struct_info, const field_reorder_t *result);
+
 int analyze_array_layout(const static_pattern_t *accesses, int access_count,
                         array_analysis_t *analysis);
 
-int suggest_struct_transformation(const struct_layout_analysis_t *analysis,
+int suggest_struct_transformation(const data_layout_analyzer_t *analyzer,
+                                 const struct_layout_analysis_t *analysis,
                                  char *transformation_code, size_t code_size);
 
 void free_layout_analysis(struct_layout_analysis_t *analysis);
@@ -72,7 +143,8 @@ void free_layout_analysis(struct_layout_analysis_t *analysis);
 // Helper functions
 bool should_transform_aos_to_soa(const struct_layout_analysis_t *analysis);
 int calculate_structure_padding(const struct_info_t *struct_info);
-int detect_false_sharing_risk(const struct_info_t *struct_info, 
+int detect_false_sharing_risk(const data_layout_analyzer_t *analyzer,
+                             const struct_info_t *struct_info, 
                              const static_pattern_t *accesses, int access_count);
 void print_layout_analysis(const struct_layout_analysis_t *analysis);
 
@@ -82,4 +154,18 @@ int generate_aos_to_soa_conversion(const struct_info_t *struct_info,
                                   const char *aos_var, const char *soa_var,
                                   int array_size, char *code, size_t code_size);
 
+// AoSoA (blocked SoA) layout
+int choose_aosoa_block_size(const struct_info_t *struct_info, const cache_info_t *cache_info);
+int generate_aosoa_definition(const data_layout_analyzer_t *analyzer,
+                             const struct_info_t *struct_info, int block_size,
+                             char *code, size_t code_size);
+int generate_aos_to_aosoa_conversion(const data_layout_analyzer_t *analyzer,
+                                    const struct_info_t *struct_info,
+                                    const char *aos_var, const char *aosoa_var,
+                                    int block_size, char *code, size_t code_size);
+uint64_t layout_element_address(const data_layout_analyzer_t *analyzer,
+                               const struct_info_t *struct_info, data_layout_t layout,
+                               int block_size, size_t element_count,
+                               size_t index, int field);
+
 #endif // DATA_LAYOUT_ANALYZER_H
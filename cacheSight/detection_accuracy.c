@@ -0,0 +1,491 @@
+// Scores the classifier and detectors on synthetic workloads with known
+// ground truth. Built by `make accuracy`; `make test` fails when a workload
+// that the recorded baseline got right is now missed.
+#include "common.h"
+#include "arena.h"
+#include "json_writer.h"
+#include "json_reader.h"
+#include "stage_trace.h"
+#include "workload_generator.h"
+#include "sample_collector.h"
+#include "pattern_classifier.h"
+#include "false_sharing_detector.h"
+#include "bank_conflict_analyzer.h"
+#include <getopt.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ACCURACY_MAX_CASES 32
+
+// Confusion counts of a yes/no detector against the ground truth
+typedef struct {
+    int true_positives;
+    int false_positives;
+    int false_negatives;
+    int true_negatives;
+} detector_score_t;
+
+// Verdicts on one workload
+typedef struct {
+    const workload_spec_t *spec;
+    int sample_count;
+    int hotspot_count;
+    access_pattern_t access;            // Graded hotspot's dominant pattern
+    bool classified;                    // Graded hotspot passed the confidence threshold
+    cache_antipattern_t antipattern;
+    double confidence;
+    bool correct;
+    bool false_sharing;                 // detect_false_sharing confirmed a line
+    bool bank_conflicts;                // analyze_bank_conflicts reported a bank
+    bool baseline_correct;              // Valid when in_baseline
+    bool in_baseline;
+    bool regressed;
+} case_result_t;
+
+typedef struct {
+    const char *filter;
+    const char *emit_dir;
+    const char *baseline;
+    const char *write_baseline;
+    size_t accesses;                    // 0 = each workload's own
+    bool verbose;
+} accuracy_options_t;
+
+// Detector contexts shared by every case
+typedef struct {
+    false_sharing_detector_t *false_sharing;
+    bank_conflict_analyzer_t *bank;
+} accuracy_detectors_t;
+
+// Fixed hierarchy so the suite does not depend on the host
+static void accuracy_cache_info(cache_info_t *info) {
+    memset(info, 0, sizeof(*info));
+    size_t sizes[3] = {32 * 1024, 1024 * 1024, 32 * 1024 * 1024};
+    int ways[3] = {8, 16, 16};
+    int latency[3] = {4, 14, 50};
+    for (int i = 0; i < 3; i++) {
+        cache_level_t *level = &info->levels[i];
+        level->level = i + 1;
+        level->size = sizes[i];
+        level->line_size = 64;
+        level->associativity = ways[i];
+        level->sets = (int)(sizes[i] / (64 * ways[i]));
+        level->latency_cycles = latency[i];
+        strcpy(level->type, i == 0 ? "data" : "unified");
+    }
+    info->num_levels = 3;
+    info->num_cores = 8;
+    info->num_threads = 16;
+    info->page_size = 4096;
+    info->cpu_frequency_ghz = 3.0;
+    strcpy(info->arch, "x86_64");
+    strcpy(info->cpu_model, "cachesight-accuracy");
+}
+
+static const char *expected_name(const workload_spec_t *spec) {
+    return spec->kind == WORKLOAD_ACCESS_PATTERN ? access_pattern_to_string(spec->access) :
+                                                   cache_antipattern_to_string(spec->antipattern);
+}
+
+static const char *predicted_name(const case_result_t *result) {
+    if (result->hotspot_count == 0) return "(no hotspot)";
+    if (result->spec->kind == WORKLOAD_ACCESS_PATTERN) return access_pattern_to_string(result->access);
+    return result->classified ? cache_antipattern_to_string(result->antipattern) : "(below threshold)";
+}
+
+static void score(detector_score_t *detector, bool expected, bool detected) {
+    if (expected && detected) detector->true_positives++;
+    else if (!expected && detected) detector->false_positives++;
+    else if (expected) detector->false_negatives++;
+    else detector->true_negatives++;
+}
+
+// Write the kernel and its ground-truth stream side by side
+static void emit_workload(const accuracy_options_t *options, const workload_spec_t *spec,
+                          const cache_miss_sample_t *samples, int count) {
+    char kernel_path[PATH_MAX];
+    char stream_path[PATH_MAX];
+    int kernel_len = snprintf(kernel_path, sizeof(kernel_path), "%s/%s.c",
+                              options->emit_dir, spec->name);
+    int stream_len = snprintf(stream_path, sizeof(stream_path), "%s/%s.ndjson",
+                              options->emit_dir, spec->name);
+    if (kernel_len < 0 || (size_t)kernel_len >= sizeof(kernel_path) ||
+        stream_len < 0 || (size_t)stream_len >= sizeof(stream_path)) {
+        LOG_ERROR("Emit path for %s is too long; skipping it", spec->name);
+        return;
+    }
+    
+    workload_emit_kernel(spec, kernel_path);
+    workload_save_stream(spec, samples, count, stream_path);
+}
+
+// Run the pipeline main.c runs on a sample stream and grade the hotspot
+// with the most misses
+static int evaluate_case(const workload_spec_t *spec, const cache_info_t *cache_info,
+                         const accuracy_detectors_t *detectors,
+                         const accuracy_options_t *options, case_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    result->spec = spec;
+    
+    cache_miss_sample_t *samples = NULL;
+    int sample_count = 0;
+    if (workload_generate(spec, cache_info, &samples, &sample_count) != 0) return -1;
+    result->sample_count = sample_count;
+    
+    if (options->emit_dir) {
+        emit_workload(options, spec, samples, sample_count);
+    }
+    
+    collector_config_t collector_config = collector_config_default();
+    sample_collector_t *collector = sample_collector_create(&collector_config, cache_info);
+    cache_hotspot_t *hotspots = NULL;
+    int hotspot_count = 0;
+    if (collector) {
+        sample_collector_attach_samples(collector, samples, sample_count);
+        sample_collector_process(collector);
+        sample_collector_take_hotspots(collector, &hotspots, &hotspot_count);
+        sample_collector_destroy(collector);
+    }
+    result->hotspot_count = hotspot_count;
+    
+    // Hotspots come back sorted by misses
+    if (hotspot_count > 0) {
+        result->access = hotspots[0].dominant_pattern;
+        
+        classifier_config_t classifier_config = classifier_config_default();
+        pattern_classifier_t *classifier = pattern_classifier_create(&classifier_config, cache_info);
+        classified_pattern_t *patterns = NULL;
+        int pattern_count = 0;
+        if (classifier && pattern_classifier_classify_all(classifier, hotspots, hotspot_count,
+                                                          &patterns, &pattern_count) == 0) {
+            for (int i = 0; i < pattern_count; i++) {
+                if (patterns[i].hotspot == &hotspots[0]) {
+                    result->classified = true;
+                    result->antipattern = patterns[i].type;
+                    result->confidence = patterns[i].confidence;
+                    break;
+                }
+            }
+        }
+        if (patterns) FREE_LOGGED(patterns);
+        pattern_classifier_destroy(classifier);
+    }
+    
+    if (spec->kind == WORKLOAD_ACCESS_PATTERN) {
+        result->correct = hotspot_count > 0 && result->access == spec->access;
+    } else {
+        result->correct = result->classified && result->antipattern == spec->antipattern;
+    }
+    
+    // Detectors see the raw stream, as in main
+    false_sharing_results_t fs_results;
+    memset(&fs_results, 0, sizeof(fs_results));
+    if (detect_false_sharing(detectors->false_sharing, samples, sample_count, &fs_results) == 0) {
+        result->false_sharing = fs_results.confirmed_count > 0;
+        free_false_sharing_results(&fs_results);
+    }
+    
+    bank_conflict_t *conflicts = NULL;
+    int conflict_count = 0;
+    if (analyze_bank_conflicts(detectors->bank, samples, sample_count,
+                               &conflicts, &conflict_count) == 0) {
+        result->bank_conflicts = conflict_count > 0;
+        free_bank_conflicts(conflicts, conflict_count);
+    }
+    
+    if (hotspots) sample_collector_free_hotspots(hotspots, hotspot_count);
+    FREE_LOGGED(samples);
+    return 0;
+}
+
+// A detector verdict regresses when it matched the ground truth in the
+// baseline and no longer does
+static bool detector_regressed(const json_value_t *entry, const char *key, bool expected, bool detected) {
+    const json_value_t *recorded = json_get(entry, key);
+    bool baseline_detected = recorded && recorded->type == JSON_BOOL && recorded->boolean;
+    return recorded && baseline_detected == expected && detected != expected;
+}
+
+// Marks regressions against a recorded run: a workload graded correct there
+// and wrong now, or a detector that lost a right verdict. Returns the number of cases found in the baseline, -1
+// without a usable one.
+static int apply_baseline(const char *path, case_result_t *results, int count) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "No baseline at %s; run `make accuracy-baseline` to record one\n", path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    size_t length = (size_t)st.st_size;
+    const char *text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) return -1;
+    
+    arena_t *arena = arena_create(0);
+    const json_value_t *document = arena ? json_parse(arena, text, length, NULL) : NULL;
+    const json_value_t *cases = document ? json_get(document, "cases") : NULL;
+    int matched = -1;
+    if (cases && cases->type == JSON_ARRAY) {
+        matched = 0;
+        for (const json_value_t *entry = cases->child; entry; entry = entry->next) {
+            const char *name = json_get_string(entry, "name", "");
+            const json_value_t *correct = json_get(entry, "correct");
+            for (int i = 0; i < count; i++) {
+                case_result_t *result = &results[i];
+                if (strcmp(result->spec->name, name) != 0) continue;
+                
+                result->in_baseline = true;
+                result->baseline_correct = correct && correct->type == JSON_BOOL && correct->boolean;
+                const workload_spec_t *spec = result->spec;
+                bool antipattern = spec->kind == WORKLOAD_ANTIPATTERN;
+                result->regressed = (result->baseline_correct && !result->correct) ||
+                    detector_regressed(entry, "false_sharing_detected",
+                                       antipattern && spec->antipattern == FALSE_SHARING,
+                                       result->false_sharing) ||
+                    detector_regressed(entry, "bank_conflicts_detected",
+                                       antipattern && spec->antipattern == BANK_CONFLICTS,
+                                       result->bank_conflicts);
+                matched++;
+            }
+        }
+    } else {
+        fprintf(stderr, "%s is not an accuracy baseline\n", path);
+    }
+    
+    arena_destroy(arena);
+    munmap((void *)text, length);
+    return matched;
+}
+
+static void write_detector(json_writer_t *writer, const char *key, const detector_score_t *detector) {
+    json_begin_object(writer, key);
+    json_int(writer, "true_positives", detector->true_positives);
+    json_int(writer, "false_positives", detector->false_positives);
+    json_int(writer, "false_negatives", detector->false_negatives);
+    json_int(writer, "true_negatives", detector->true_negatives);
+    json_end_object(writer);
+}
+
+static int write_baseline(const char *path, const case_result_t *results, int count,
+                          const detector_score_t *false_sharing, const detector_score_t *bank) {
+    json_writer_t *writer = MALLOC_LOGGED(sizeof(json_writer_t));
+    if (!writer) return -1;
+    if (json_writer_open(writer, path, true) != 0) {
+        FREE_LOGGED(writer);
+        return -1;
+    }
+    
+    json_begin_object(writer, NULL);
+    json_int(writer, "version", 1);
+    json_begin_array(writer, "cases");
+    for (int i = 0; i < count; i++) {
+        const case_result_t *result = &results[i];
+        json_begin_object(writer, NULL);
+        json_string(writer, "name", result->spec->name);
+        json_string(writer, "kind", workload_kind_to_string(result->spec->kind));
+        json_string(writer, "expected", expected_name(result->spec));
+        json_string(writer, "predicted", predicted_name(result));
+        json_bool(writer, "correct", result->correct);
+        json_bool(writer, "false_sharing_detected", result->false_sharing);
+        json_bool(writer, "bank_conflicts_detected", result->bank_conflicts);
+        json_end_object(writer);
+    }
+    json_end_array(writer);
+    json_begin_object(writer, "detectors");
+    write_detector(writer, "false_sharing", false_sharing);
+    write_detector(writer, "bank_conflicts", bank);
+    json_end_object(writer);
+    json_end_object(writer);
+    json_end_record(writer);
+    
+    int ret = json_writer_close(writer);
+    FREE_LOGGED(writer);
+    if (ret == 0) {
+        printf("Baseline written to %s\n", path);
+    }
+    return ret;
+}
+
+static void print_detector(const char *name, const detector_score_t *detector) {
+    int flagged = detector->true_positives + detector->false_positives;
+    int actual = detector->true_positives + detector->false_negatives;
+    printf("%-16s TP %2d  FP %2d  FN %2d  TN %2d  precision %5.1f%%  recall %5.1f%%\n", name,
+           detector->true_positives, detector->false_positives,
+           detector->false_negatives, detector->true_negatives,
+           flagged > 0 ? 100.0 * detector->true_positives / flagged : 0.0,
+           actual > 0 ? 100.0 * detector->true_positives / actual : 0.0);
+}
+
+static void print_results(const case_result_t *results, int count, bool verbose) {
+    printf("\n%-30s %-26s %-26s %8s %5s %5s  %s\n", "Workload", "Expected", "Predicted",
+           "Samples", "FS", "Bank", "Result");
+    for (int i = 0; i < count; i++) {
+        const case_result_t *result = &results[i];
+        const char *verdict = result->correct ? "ok" : "MISS";
+        if (result->regressed) verdict = "REGRESSED";
+        else if (result->in_baseline && !result->baseline_correct && result->correct) verdict = "ok (new)";
+        
+        printf("%-30s %-26s %-26s %8d %5s %5s  %s\n", result->spec->name,
+               expected_name(result->spec), predicted_name(result), result->sample_count,
+               result->false_sharing ? "yes" : "-", result->bank_conflicts ? "yes" : "-", verdict);
+        if (verbose) {
+            printf("    %d hotspots, graded hotspot access %s, confidence %.2f\n",
+                   result->hotspot_count, access_pattern_to_string(result->access),
+                   result->confidence);
+        }
+    }
+}
+
+static void print_usage(const char *prog_name) {
+    printf("Usage: %s [OPTIONS]\n", prog_name);
+    printf("\nScores pattern classification and detectors on synthetic workloads\n");
+    printf("\nOptions:\n");
+    printf("  --filter TEXT           Only workloads whose name contains TEXT\n");
+    printf("  --accesses N            Accesses per thread (default: each workload's own)\n");
+    printf("  --emit DIR              Write each workload's kernel (.c) and stream (.ndjson) to DIR\n");
+    printf("  --baseline FILE         Compare against FILE; exit 1 if a passing workload now fails\n");
+    printf("  --write-baseline FILE   Save these verdicts as a baseline\n");
+    printf("  --verbose               Show hotspot details per workload\n");
+}
+
+int main(int argc, char *argv[]) {
+    accuracy_options_t options;
+    memset(&options, 0, sizeof(options));
+    
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+        {"filter", required_argument, 0, 'f'},
+        {"accesses", required_argument, 0, 'a'},
+        {"emit", required_argument, 0, 'e'},
+        {"baseline", required_argument, 0, 'b'},
+        {"write-baseline", required_argument, 0, 'w'},
+        {"verbose", no_argument, 0, 'v'},
+        {0, 0, 0, 0}
+    };
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "hv", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                options.filter = optarg;
+                break;
+            case 'a':
+                options.accesses = (size_t)atol(optarg);
+                break;
+            case 'e':
+                options.emit_dir = optarg;
+                break;
+            case 'b':
+                options.baseline = optarg;
+                break;
+            case 'w':
+                options.write_baseline = optarg;
+                break;
+            case 'v':
+                options.verbose = true;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 2;
+        }
+    }
+    
+    logger_init(NULL, LOG_ERROR, LOG_ERROR);
+    trace_set_enabled(false);
+    
+    if (options.emit_dir && mkdir(options.emit_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Cannot create %s: %s\n", options.emit_dir, strerror(errno));
+        return 2;
+    }
+    
+    cache_info_t cache_info;
+    accuracy_cache_info(&cache_info);
+    
+    false_sharing_config_t fs_config = false_sharing_config_default();
+    fs_config.cache_line_size = cache_info.levels[0].line_size;
+    bank_config_t bank_config = bank_config_default_cpu();
+    accuracy_detectors_t detectors = {
+        .false_sharing = false_sharing_detector_create(&fs_config),
+        .bank = bank_conflict_analyzer_create(&bank_config),
+    };
+    if (!detectors.false_sharing || !detectors.bank) {
+        fprintf(stderr, "Failed to create detectors\n");
+        false_sharing_detector_destroy(detectors.false_sharing);
+        bank_conflict_analyzer_destroy(detectors.bank);
+        return 2;
+    }
+    
+    workload_spec_t specs[ACCURACY_MAX_CASES];
+    int spec_count = workload_suite_default(&cache_info, specs, ACCURACY_MAX_CASES);
+    
+    case_result_t results[ACCURACY_MAX_CASES];
+    int result_count = 0;
+    detector_score_t false_sharing = {0}, bank = {0};
+    int access_total = 0, access_correct = 0, anti_total = 0, anti_correct = 0;
+    
+    for (int i = 0; i < spec_count; i++) {
+        workload_spec_t *spec = &specs[i];
+        if (options.filter && !strstr(spec->name, options.filter)) continue;
+        if (options.accesses > 0) spec->accesses = options.accesses;
+        
+        case_result_t *result = &results[result_count];
+        if (evaluate_case(spec, &cache_info, &detectors, &options, result) != 0) {
+            fprintf(stderr, "Failed to evaluate %s\n", spec->name);
+            continue;
+        }
+        result_count++;
+        
+        if (spec->kind == WORKLOAD_ACCESS_PATTERN) {
+            access_total++;
+            if (result->correct) access_correct++;
+        } else {
+            anti_total++;
+            if (result->correct) anti_correct++;
+        }
+        bool antipattern = spec->kind == WORKLOAD_ANTIPATTERN;
+        score(&false_sharing, antipattern && spec->antipattern == FALSE_SHARING, result->false_sharing);
+        score(&bank, antipattern && spec->antipattern == BANK_CONFLICTS, result->bank_conflicts);
+    }
+    
+    int matched = -1;
+    if (options.baseline) {
+        matched = apply_baseline(options.baseline, results, result_count);
+    }
+    print_results(results, result_count, options.verbose);
+    
+    printf("\nAccess patterns: %d/%d correct\n", access_correct, access_total);
+    printf("Anti-patterns:   %d/%d correct\n", anti_correct, anti_total);
+    print_detector("False sharing", &false_sharing);
+    print_detector("Bank conflicts", &bank);
+    
+    int regressions = 0;
+    for (int i = 0; i < result_count; i++) {
+        if (results[i].regressed) regressions++;
+    }
+    if (matched >= 0) {
+        printf("\n%d of %d workloads matched %s; %d regression%s\n", matched, result_count,
+               options.baseline, regressions, regressions == 1 ? "" : "s");
+    }
+    
+    if (options.write_baseline) {
+        write_baseline(options.write_baseline, results, result_count, &false_sharing, &bank);
+    }
+    if (options.emit_dir) {
+        printf("Kernels and streams written to %s/\n", options.emit_dir);
+    }
+    
+    bank_conflict_analyzer_destroy(detectors.bank);
+    false_sharing_detector_destroy(detectors.false_sharing);
+    trace_cleanup();
+    logger_cleanup();
+    return regressions > 0 ? 1 : 0;
+}
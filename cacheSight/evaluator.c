@@ -1,4 +1,6 @@
 #include "evaluator.h"
+#include "stage_trace.h"
+#include "statistical_analyzer.h"
 #include <math.h>
 #include <time.h>
 
@@ -21,6 +23,7 @@ struct evaluator {
     // Cache simulators
     cache_level_sim_t *cache_sims[4];
     int num_cache_levels;
+    data_layout_analyzer_t *layout;     // Element addresses for layout validation
     
     // Statistics
     double total_evaluation_time;
@@ -95,15 +98,14 @@ evaluator_t* evaluator_create(const evaluator_config_t *config,
             }
         }
 
-        // Initialize any remaining array elements to NULL
-        for (int i = evaluator->num_cache_levels; i < 4; i++) {
-            evaluator->cache_sims[i] = NULL;
+        if (evaluator->num_cache_levels > 4) {
+            evaluator->num_cache_levels = 4;
         }
         
-        if (evaluator->cache_sims) {
-            for (int i = 0; i < evaluator->num_cache_levels; i++) {
-                evaluator->cache_sims[i] = create_cache_simulator(&cache_info->levels[i]);
-            }
+        evaluator->layout = data_layout_analyzer_create(cache_info);
+        if (!evaluator->layout) {
+            evaluator_destroy(evaluator);
+            return NULL;
         }
     }
     
@@ -122,12 +124,10 @@ void evaluator_destroy(evaluator_t *evaluator) {
              evaluator->evaluations_performed);
     
     // Destroy cache simulators
-    if (evaluator->cache_sims) {
-        for (int i = 0; i < evaluator->num_cache_levels; i++) {
-            destroy_cache_simulator(evaluator->cache_sims[i]);
-        }
-        FREE_LOGGED(evaluator->cache_sims);
+    for (int i = 0; i < evaluator->num_cache_levels && i < 4; i++) {
+        destroy_cache_simulator(evaluator->cache_sims[i]);
     }
+    data_layout_analyzer_destroy(evaluator->layout);
     
     pthread_mutex_destroy(&evaluator->mutex);
     FREE_LOGGED(evaluator);
@@ -306,49 +306,57 @@ static void simulate_cache_access(cache_level_sim_t *sim, uint64_t address) {
     }
 }
 
-// Simulate cache with samples
-int evaluator_simulate_cache(evaluator_t *evaluator,
-                            const cache_miss_sample_t *samples, int sample_count,
-                            evaluation_metrics_t *metrics) {
-    if (!evaluator || !samples || !metrics || sample_count <= 0) {
-        LOG_ERROR("Invalid parameters for simulate_cache");
-        return -1;
-    }
+// Is the line resident? Does not touch LRU state or statistics
+static bool sim_contains(const cache_level_sim_t *sim, uint64_t address) {
+    uint64_t tag = address / sim->line_size;
+    int set_index = (tag % sim->num_sets);
     
-    if (!evaluator->config.enable_simulation || !evaluator->cache_sims) {
-        LOG_WARNING("Cache simulation not enabled");
-        return -1;
+    for (int way = 0; way < sim->associativity; way++) {
+        if (sim->tags[set_index * sim->associativity + way] == tag) return true;
     }
-    
-    LOG_INFO("Simulating cache behavior with %d samples", sample_count);
-    
-    pthread_mutex_lock(&evaluator->mutex);
-    
-    // Reset simulators
+    return false;
+}
+
+// Install a prefetched line without counting it as a demand access
+static void sim_fill(cache_level_sim_t *sim, uint64_t address) {
+    if (sim_contains(sim, address)) return;
+    
+    uint64_t hits = sim->hits;
+    simulate_cache_access(sim, address);
+    sim->hits = hits;
+    sim->misses--;
+}
+
+static void reset_simulators(evaluator_t *evaluator) {
     for (int i = 0; i < evaluator->num_cache_levels; i++) {
         if (evaluator->cache_sims[i]) {
-            evaluator->cache_sims[i]->hits = 0;
-            evaluator->cache_sims[i]->misses = 0;
-            // Clear tags
-            memset(evaluator->cache_sims[i]->tags, 0,
-                   evaluator->cache_sims[i]->num_sets * 
-                   evaluator->cache_sims[i]->associativity * sizeof(uint64_t));
+            cache_level_sim_t *sim = evaluator->cache_sims[i];
+            size_t entries = (size_t)sim->num_sets * sim->associativity;
+            sim->hits = 0;
+            sim->misses = 0;
+            memset(sim->tags, 0, entries * sizeof(uint64_t));
+            memset(sim->lru_counters, 0, entries * sizeof(uint64_t));
         }
     }
+}
+
+// Run an address trace through the simulated hierarchy; caller holds the mutex
+static void simulate_address_trace(evaluator_t *evaluator, const uint64_t *addrs,
+                                   const cache_miss_sample_t *samples, int count,
+                                   evaluation_metrics_t *metrics) {
+    reset_simulators(evaluator);
     
     // Run simulation
-    for (int i = 0; i < sample_count; i++) {
-        uint64_t addr = samples[i].memory_addr;
+    for (int i = 0; i < count; i++) {
+        uint64_t addr = addrs ? addrs[i] : samples[i].memory_addr;
         
         // Simulate through cache hierarchy
-        bool hit = false;
         for (int level = 0; level < evaluator->num_cache_levels; level++) {
             if (evaluator->cache_sims[level]) {
                 uint64_t prev_hits = evaluator->cache_sims[level]->hits;
                 simulate_cache_access(evaluator->cache_sims[level], addr);
                 
                 if (evaluator->cache_sims[level]->hits > prev_hits) {
-                    hit = true;
                     break;  // Hit at this level
                 }
             }
@@ -371,9 +379,276 @@ int evaluator_simulate_cache(evaluator_t *evaluator,
                       metrics->cache_miss_rate[i] * 100);
         }
     }
+}
+
+// Simulate cache with samples
+int evaluator_simulate_cache(evaluator_t *evaluator,
+                            const cache_miss_sample_t *samples, int sample_count,
+                            evaluation_metrics_t *metrics) {
+    if (!evaluator || !samples || !metrics || sample_count <= 0) {
+        LOG_ERROR("Invalid parameters for simulate_cache");
+        return -1;
+    }
+    
+    if (!evaluator->config.enable_simulation || evaluator->num_cache_levels == 0) {
+        LOG_WARNING("Cache simulation not enabled");
+        return -1;
+    }
+    TRACE_SCOPE(trace, "evaluator.simulate_cache");
+    trace_add_items(&trace, sample_count);
+    
+    LOG_INFO("Simulating cache behavior with %d samples", sample_count);
+    
+    pthread_mutex_lock(&evaluator->mutex);
+    simulate_address_trace(evaluator, NULL, samples, sample_count, metrics);
+    pthread_mutex_unlock(&evaluator->mutex);
+    
+    return 0;
+}
+
+// Simulated L1 misses per element for one layout and access shape
+static double simulate_layout_misses(evaluator_t *evaluator, const struct_info_t *struct_info,
+                                     data_layout_t layout, int block_size,
+                                     size_t element_count, int sweep_field,
+                                     uint64_t *trace) {
+    int count = 0;
+    
+    for (size_t i = 0; i < element_count; i++) {
+        if (sweep_field >= 0) {
+            trace[count++] = layout_element_address(evaluator->layout, struct_info, layout,
+                                                    block_size, element_count, i, sweep_field);
+        } else {
+            for (int f = 0; f < struct_info->field_count; f++) {
+                trace[count++] = layout_element_address(evaluator->layout, struct_info, layout,
+                                                        block_size, element_count, i, f);
+            }
+        }
+    }
+    
+    evaluation_metrics_t metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    simulate_address_trace(evaluator, trace, NULL, count, &metrics);
+    
+    return metrics.cache_miss_rate[0] * count / element_count;
+}
+
+int evaluator_validate_aosoa(evaluator_t *evaluator, const struct_info_t *struct_info,
+                            int block_size, int sweep_field, size_t element_count,
+                            layout_validation_t *result) {
+    if (!evaluator || !struct_info || !result || block_size <= 0 || element_count == 0 ||
+        sweep_field < 0 || sweep_field >= struct_info->field_count) {
+        LOG_ERROR("Invalid parameters for validate_aosoa");
+        return -1;
+    }
+    
+    if (!evaluator->config.enable_simulation || !evaluator->cache_sims[0]) {
+        LOG_WARNING("Cache simulation not enabled");
+        return -1;
+    }
+    
+    memset(result, 0, sizeof(layout_validation_t));
+    result->block_size = block_size;
+    
+    uint64_t *trace = CALLOC_LOGGED(element_count * struct_info->field_count, sizeof(uint64_t));
+    if (!trace) {
+        LOG_ERROR("Failed to allocate layout trace");
+        return -1;
+    }
+    
+    const data_layout_t layouts[3] = {LAYOUT_AOS, LAYOUT_SOA, LAYOUT_AOSOA};
+    
+    pthread_mutex_lock(&evaluator->mutex);
+    for (int l = 0; l < 3; l++) {
+        result->whole_struct_misses[l] = simulate_layout_misses(evaluator, struct_info, layouts[l],
+                                                                block_size, element_count, -1, trace);
+        result->field_sweep_misses[l] = simulate_layout_misses(evaluator, struct_info, layouts[l],
+                                                               block_size, element_count,
+                                                               sweep_field, trace);
+    }
+    pthread_mutex_unlock(&evaluator->mutex);
+    
+    FREE_LOGGED(trace);
+    
+    // AoSoA must stay close to AoS for whole-struct walks and to SoA for field sweeps
+    double whole_best = result->whole_struct_misses[0] < result->whole_struct_misses[1] ?
+                        result->whole_struct_misses[0] : result->whole_struct_misses[1];
+    double sweep_best = result->field_sweep_misses[0] < result->field_sweep_misses[1] ?
+                        result->field_sweep_misses[0] : result->field_sweep_misses[1];
+    
+    result->aosoa_validated =
+        result->whole_struct_misses[2] <= whole_best * 1.1 + 0.01 &&
+        result->field_sweep_misses[2] <= sweep_best * 1.1 + 0.01;
+    
+    // Each field run within a block must be a whole number of vectors
+    int simd_width = evaluator->cache_info.simd_width_bytes > 0 ?
+                     evaluator->cache_info.simd_width_bytes : 16;
+    for (int f = 0; f < struct_info->field_count; f++) {
+        if ((block_size * struct_info->field_sizes[f]) % simd_width != 0) {
+            result->aosoa_validated = false;
+        }
+    }
+    
+    LOG_INFO("AoSoA validation for %s (block %d): whole-struct %.3f/%.3f/%.3f, "
+             "field sweep %.3f/%.3f/%.3f misses per element (AoS/SoA/AoSoA) - %s",
+             struct_info->struct_name, block_size,
+             result->whole_struct_misses[0], result->whole_struct_misses[1],
+             result->whole_struct_misses[2],
+             result->field_sweep_misses[0], result->field_sweep_misses[1],
+             result->field_sweep_misses[2],
+             result->aosoa_validated ? "validated" : "rejected");
+    
+    return 0;
+}
+
+// Cycles until a line is available, served from the closest level holding it
+static double line_fetch_cycles(const evaluator_t *evaluator, uint64_t address, int from_level,
+                                double memory_cycles) {
+    for (int level = from_level; level < evaluator->num_cache_levels; level++) {
+        if (evaluator->cache_sims[level] && sim_contains(evaluator->cache_sims[level], address)) {
+            return evaluator->cache_info.levels[level].latency_cycles;
+        }
+    }
+    return memory_cycles;
+}
+
+// Stream `iterations` accesses with an optional prefetch `distance` iterations
+// ahead; returns stall cycles per iteration. In-flight prefetches are modelled
+// with their fetch latency so short distances show up as late prefetches.
+static double simulate_prefetch_stream(evaluator_t *evaluator, int stride_bytes, size_t iterations,
+                                       double cycles_per_iteration, int distance, int target_level,
+                                       double memory_cycles, prefetch_validation_t *result) {
+    typedef struct {
+        uint64_t line_addr;
+        double ready;                   // Iteration at which the line arrives
+    } inflight_t;
+    
+    // Prefetches are issued in address order and land in issue order, so the
+    // in-flight set is a ring and every lookup touches only its head
+    inflight_t queue[256];
+    int head = 0, queue_len = 0;
+    uint64_t line_size = evaluator->cache_info.levels[0].line_size;
+    uint64_t base = 1ULL << 32;
+    uint64_t last_prefetched = UINT64_MAX;
+    double stall = 0;
+    size_t issued = 0, late = 0, useless = 0;
+    int first_fill = target_level > 0 ? target_level - 1 : 0;
+    int last_fill = target_level > 0 ? evaluator->num_cache_levels - 1 : 0;
+    
+    reset_simulators(evaluator);
+    
+    for (size_t i = 0; i < iterations; i++) {
+        // Land prefetches that have arrived
+        while (queue_len > 0 && queue[head].ready <= (double)i) {
+            for (int level = first_fill; level <= last_fill; level++) {
+                if (evaluator->cache_sims[level]) sim_fill(evaluator->cache_sims[level], queue[head].line_addr);
+            }
+            head = (head + 1) % 256;
+            queue_len--;
+        }
+        
+        // Issue the prefetch for iteration i + distance once per line
+        if (distance > 0) {
+            uint64_t line_addr = (base + (i + distance) * (uint64_t)stride_bytes) / line_size * line_size;
+            if (line_addr != last_prefetched) {
+                last_prefetched = line_addr;
+                issued++;
+                if (evaluator->cache_sims[first_fill] &&
+                    sim_contains(evaluator->cache_sims[first_fill], line_addr)) {
+                    useless++;
+                } else if (queue_len < 256) {
+                    double fetch = line_fetch_cycles(evaluator, line_addr, first_fill, memory_cycles);
+                    inflight_t *slot = &queue[(head + queue_len) % 256];
+                    slot->line_addr = line_addr;
+                    slot->ready = i + fetch / cycles_per_iteration;
+                    queue_len++;
+                }
+            }
+        }
+        
+        // Demand access: wait for an in-flight prefetch, else take the miss
+        uint64_t addr = base + i * (uint64_t)stride_bytes;
+        uint64_t line_addr = addr / line_size * line_size;
+        bool waited = false;
+        while (queue_len > 0 && queue[head].line_addr <= line_addr) {
+            inflight_t *front = &queue[head];
+            if (front->line_addr == line_addr) {
+                if (front->ready > (double)i) {
+                    stall += (front->ready - i) * cycles_per_iteration;
+                    late++;
+                }
+                waited = true;
+            }
+            for (int level = first_fill; level <= last_fill; level++) {
+                if (evaluator->cache_sims[level]) sim_fill(evaluator->cache_sims[level], front->line_addr);
+            }
+            head = (head + 1) % 256;
+            queue_len--;
+        }
+        
+        double cost = memory_cycles;
+        for (int level = 0; level < evaluator->num_cache_levels; level++) {
+            if (!evaluator->cache_sims[level]) continue;
+            uint64_t prev_hits = evaluator->cache_sims[level]->hits;
+            simulate_cache_access(evaluator->cache_sims[level], addr);
+            if (evaluator->cache_sims[level]->hits > prev_hits) {
+                cost = level == 0 ? 0 : evaluator->cache_info.levels[level].latency_cycles;
+                break;
+            }
+        }
+        if (!waited) stall += cost;
+    }
+    
+    if (result && issued > 0) {
+        result->late_fraction = (double)late / issued;
+        result->useless_fraction = (double)useless / issued;
+    }
+    return stall / iterations;
+}
+
+int evaluator_validate_prefetch(evaluator_t *evaluator, int stride_bytes, size_t footprint_bytes,
+                                double cycles_per_iteration, int distance, int target_level,
+                                prefetch_validation_t *result) {
+    if (!evaluator || !result || stride_bytes <= 0 || distance <= 0 || cycles_per_iteration <= 0) {
+        LOG_ERROR("Invalid parameters for validate_prefetch");
+        return -1;
+    }
+    
+    if (!evaluator->config.enable_simulation || !evaluator->cache_sims[0]) {
+        LOG_WARNING("Cache simulation not enabled");
+        return -1;
+    }
     
+    memset(result, 0, sizeof(prefetch_validation_t));
+    result->distance = distance;
+    result->target_level = target_level;
+    
+    const cache_info_t *info = &evaluator->cache_info;
+    double memory_cycles = info->memory_latency_ns > 0 && info->cpu_frequency_ghz > 0 ?
+                           info->memory_latency_ns * info->cpu_frequency_ghz : 200.0;
+    
+    size_t iterations = footprint_bytes / stride_bytes;
+    if (iterations < 4096) iterations = 4096;
+    if (iterations > (1 << 16)) iterations = 1 << 16;
+    
+    pthread_mutex_lock(&evaluator->mutex);
+    result->baseline_stall_cycles = simulate_prefetch_stream(evaluator, stride_bytes, iterations,
+                                                             cycles_per_iteration, 0, target_level,
+                                                             memory_cycles, NULL);
+    result->prefetch_stall_cycles = simulate_prefetch_stream(evaluator, stride_bytes, iterations,
+                                                             cycles_per_iteration, distance, target_level,
+                                                             memory_cycles, result);
     pthread_mutex_unlock(&evaluator->mutex);
     
+    // A mistuned distance costs bandwidth and cache space, so demand a clear win
+    result->validated = result->prefetch_stall_cycles < result->baseline_stall_cycles * 0.8 &&
+                        result->useless_fraction < 0.5;
+    
+    LOG_INFO("Prefetch validation (stride %d, distance %d, level %d): %.1f -> %.1f stall "
+             "cycles/iteration, %.0f%% late, %.0f%% useless - %s",
+             stride_bytes, distance, target_level, result->baseline_stall_cycles,
+             result->prefetch_stall_cycles, result->late_fraction * 100,
+             result->useless_fraction * 100, result->validated ? "validated" : "rejected");
+    
     return 0;
 }
 
@@ -413,62 +688,104 @@ double evaluator_measure_performance(evaluator_t *evaluator,
     return avg_time;
 }
 
-// Statistical comparison (simplified t-test)
+static void mean_and_variance(const double *values, int count, double *mean, double *variance) {
+    double sum = 0;
+    for (int i = 0; i < count; i++) sum += values[i];
+    *mean = sum / count;
+    
+    double squares = 0;
+    for (int i = 0; i < count; i++) {
+        double diff = values[i] - *mean;
+        squares += diff * diff;
+    }
+    *variance = count > 1 ? squares / (count - 1) : 0;
+}
+
+// Standard error of the difference of two means with unequal variances;
+// df gets the Welch-Satterthwaite degrees of freedom
+static double welch_standard_error(double var_a, int count_a, double var_b, int count_b,
+                                   double *df) {
+    double share_a = var_a / count_a;
+    double share_b = var_b / count_b;
+    double pooled = share_a + share_b;
+    double denom = share_a * share_a / (count_a - 1) + share_b * share_b / (count_b - 1);
+    *df = denom > 0 ? pooled * pooled / denom : count_a + count_b - 2;
+    return sqrt(pooled);
+}
+
+// Welch's t-test on the run times
 int evaluator_compare_performance(evaluator_t *evaluator,
                                  double *baseline_times, int baseline_count,
                                  double *optimized_times, int optimized_count,
                                  double *speedup, double *p_value) {
     if (!evaluator || !baseline_times || !optimized_times || 
-        !speedup || !p_value || baseline_count <= 0 || optimized_count <= 0) {
+        !speedup || !p_value || baseline_count < 2 || optimized_count < 2) {
         LOG_ERROR("Invalid parameters for compare_performance");
         return -1;
     }
     
-    // Calculate means
-    double baseline_mean = 0, optimized_mean = 0;
+    double baseline_mean, baseline_var, optimized_mean, optimized_var;
+    mean_and_variance(baseline_times, baseline_count, &baseline_mean, &baseline_var);
+    mean_and_variance(optimized_times, optimized_count, &optimized_mean, &optimized_var);
+    if (optimized_mean <= 0) return -1;
     
-    for (int i = 0; i < baseline_count; i++) {
-        baseline_mean += baseline_times[i];
-    }
-    baseline_mean /= baseline_count;
+    *speedup = baseline_mean / optimized_mean;
     
-    for (int i = 0; i < optimized_count; i++) {
-        optimized_mean += optimized_times[i];
+    double df = 0;
+    double se = welch_standard_error(baseline_var, baseline_count,
+                                     optimized_var, optimized_count, &df);
+    if (se <= 0) {
+        // Identical runs on each side: only the means can tell them apart
+        *p_value = baseline_mean == optimized_mean ? 1.0 : 0.0;
+    } else {
+        double t_stat = (baseline_mean - optimized_mean) / se;
+        *p_value = student_t_p_value(t_stat, df);
     }
-    optimized_mean /= optimized_count;
     
-    *speedup = baseline_mean / optimized_mean;
-    
-    // Calculate standard deviations
-    double baseline_var = 0, optimized_var = 0;
+    LOG_INFO("Performance comparison: speedup=%.2fx, p-value=%.4f (df=%.1f)",
+             *speedup, *p_value, df);
     
-    for (int i = 0; i < baseline_count; i++) {
-        double diff = baseline_times[i] - baseline_mean;
-        baseline_var += diff * diff;
+    return 0;
+}
+
+int evaluator_speedup_interval(evaluator_t *evaluator,
+                              const double *baseline_times, int baseline_count,
+                              const double *optimized_times, int optimized_count,
+                              double *low, double *high) {
+    if (!evaluator || !baseline_times || !optimized_times || !low || !high ||
+        baseline_count < 2 || optimized_count < 2) {
+        LOG_ERROR("Invalid parameters for speedup_interval");
+        return -1;
     }
-    baseline_var /= (baseline_count - 1);
     
-    for (int i = 0; i < optimized_count; i++) {
-        double diff = optimized_times[i] - optimized_mean;
-        optimized_var += diff * diff;
+    double baseline_mean, baseline_var, optimized_mean, optimized_var;
+    mean_and_variance(baseline_times, baseline_count, &baseline_mean, &baseline_var);
+    mean_and_variance(optimized_times, optimized_count, &optimized_mean, &optimized_var);
+    if (baseline_mean <= 0 || optimized_mean <= 0) return -1;
+    
+    // Var(log mean) ~ var / (n * mean^2)
+    double df = 0;
+    double se = welch_standard_error(baseline_var / (baseline_mean * baseline_mean), baseline_count,
+                                     optimized_var / (optimized_mean * optimized_mean), optimized_count,
+                                     &df);
+    
+    // Two-sided Student-t quantile for the confidence level
+    double t = student_t_critical(1.0 - evaluator->config.confidence_level, df);
+    if (isnan(t)) {
+        LOG_ERROR("Invalid confidence level %.3f", evaluator->config.confidence_level);
+        return -1;
     }
-    optimized_var /= (optimized_count - 1);
-    
-    // Welch's t-test (unequal variances)
-    double se = sqrt(baseline_var / baseline_count + optimized_var / optimized_count);
-    double t_stat = (baseline_mean - optimized_mean) / se;
-    
-    // Approximate p-value (simplified - assumes normal distribution)
-    // Real implementation would use t-distribution
-    double z = fabs(t_stat);
-    *p_value = 2 * (1 - 0.5 * (1 + erf(z / sqrt(2))));
-    
-    LOG_INFO("Performance comparison: speedup=%.2fx, p-value=%.4f",
-             *speedup, *p_value);
     
+    double log_ratio = log(baseline_mean / optimized_mean);
+    *low = exp(log_ratio - t * se);
+    *high = exp(log_ratio + t * se);
     return 0;
 }
 
+double evaluator_confidence_level(const evaluator_t *evaluator) {
+    return evaluator ? evaluator->config.confidence_level : 0;
+}
+
 // Print evaluation metrics
 void evaluator_print_metrics(const evaluation_metrics_t *metrics) {
     if (!metrics) return;
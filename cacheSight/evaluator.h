@@ -4,6 +4,7 @@
 #include "common.h"
 #include "hardware_detector.h"
 #include "recommendation_engine.h"
+#include "data_layout_analyzer.h"
 
 // Comprehensive evaluation metrics
 typedef struct {
@@ -55,6 +56,25 @@ typedef struct {
     double p_value;                     // Statistical p-value
 } benchmark_result_t;
 
+// Simulated L1 misses per element for AoS, SoA and AoSoA (in that order)
+typedef struct {
+    int block_size;
+    double whole_struct_misses[3];      // Every field of each element touched
+    double field_sweep_misses[3];       // One field streamed, as in a SIMD loop
+    bool aosoa_validated;               // AoSoA matches the better layout in both
+} layout_validation_t;
+
+// Simulated software prefetching of one strided stream
+typedef struct {
+    int distance;                       // Iterations ahead
+    int target_level;                   // First level filled: 1 (T0), 2 (T1), 0 = L1 only (NTA)
+    double baseline_stall_cycles;       // Per iteration without prefetching
+    double prefetch_stall_cycles;       // Per iteration with prefetching
+    double late_fraction;               // Prefetches still in flight when used
+    double useless_fraction;            // Prefetches of lines already cached
+    bool validated;                     // Prefetching clearly reduces stalls
+} prefetch_validation_t;
+
 // API functions
 evaluator_t* evaluator_create(const evaluator_config_t *config,
                              const cache_info_t *cache_info);
@@ -80,17 +100,34 @@ double evaluator_measure_performance(evaluator_t *evaluator,
                                    void *test_data,
                                    int iterations);
 
-// Statistical analysis
+// Statistical analysis: Welch's t-test, two-sided p-value from Student's t
 int evaluator_compare_performance(evaluator_t *evaluator,
                                  double *baseline_times, int baseline_count,
                                  double *optimized_times, int optimized_count,
                                  double *speedup, double *p_value);
 
+// Confidence interval of the baseline/optimized mean ratio (delta method on
+// the log ratio, Student-t quantile with Welch-Satterthwaite degrees of
+// freedom) at the configured confidence level
+int evaluator_speedup_interval(evaluator_t *evaluator,
+                              const double *baseline_times, int baseline_count,
+                              const double *optimized_times, int optimized_count,
+                              double *low, double *high);
+double evaluator_confidence_level(const evaluator_t *evaluator);
+
 // Cache simulation
 int evaluator_simulate_cache(evaluator_t *evaluator,
                             const cache_miss_sample_t *samples, int sample_count,
                             evaluation_metrics_t *metrics);
 
+int evaluator_validate_aosoa(evaluator_t *evaluator, const struct_info_t *struct_info,
+                            int block_size, int sweep_field, size_t element_count,
+                            layout_validation_t *result);
+
+int evaluator_validate_prefetch(evaluator_t *evaluator, int stride_bytes, size_t footprint_bytes,
+                                double cycles_per_iteration, int distance, int target_level,
+                                prefetch_validation_t *result);
+
 // Reporting
 void evaluator_print_metrics(const evaluation_metrics_t *metrics);
 void evaluator_print_comparison(const benchmark_result_t *result);
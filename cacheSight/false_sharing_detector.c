@@ -1,37 +1,33 @@
 #include "false_sharing_detector.h"
+#include "arena.h"
+#include "stage_trace.h"
 #include <math.h>
 
-static false_sharing_config_t g_config;
-static bool g_initialized = false;
+struct false_sharing_detector {
+    false_sharing_config_t config;
+};
 
-// Initialize detector
-int false_sharing_detector_init(const false_sharing_config_t *config) {
-    if (g_initialized) {
-        LOG_WARNING("False sharing detector already initialized");
-        return 0;
+// Create detector
+false_sharing_detector_t* false_sharing_detector_create(const false_sharing_config_t *config) {
+    false_sharing_detector_t *detector = CALLOC_LOGGED(1, sizeof(false_sharing_detector_t));
+    if (!detector) {
+        LOG_ERROR("Failed to allocate false sharing detector");
+        return NULL;
     }
     
-    if (config) {
-        g_config = *config;
-    } else {
-        g_config = false_sharing_config_default();
-    }
-    
-    LOG_INFO("Initialized false sharing detector (cache line: %d bytes)",
-             g_config.cache_line_size);
+    detector->config = config ? *config : false_sharing_config_default();
     
-    g_initialized = true;
-    return 0;
+    LOG_INFO("Created false sharing detector (cache line: %d bytes)",
+             detector->config.cache_line_size);
+    return detector;
 }
 
-// Cleanup detector
-void false_sharing_detector_cleanup(void) {
-    if (!g_initialized) {
-        return;
-    }
+// Destroy detector
+void false_sharing_detector_destroy(false_sharing_detector_t *detector) {
+    if (!detector) return;
     
-    LOG_INFO("Cleaning up false sharing detector");
-    g_initialized = false;
+    LOG_INFO("Destroying false sharing detector");
+    FREE_LOGGED(detector);
 }
 
 // Get cache line address
@@ -39,6 +35,26 @@ uint64_t get_cache_line_address(uint64_t address, int cache_line_size) {
     return (address / cache_line_size) * cache_line_size;
 }
 
+// Samples of one cache line, chained per hash bucket
+#define LINE_HASH_SIZE 1024
+
+typedef struct cache_line_info {
+    uint64_t cache_line;
+    cache_miss_sample_t *samples;
+    int sample_count;
+    int sample_capacity;
+    struct cache_line_info *next;
+} cache_line_info_t;
+
+static cache_line_info_t* find_cache_line(cache_line_info_t **buckets, uint64_t cache_line,
+                                          int line_size) {
+    cache_line_info_t *info = buckets[(cache_line / line_size) % LINE_HASH_SIZE];
+    while (info && info->cache_line != cache_line) {
+        info = info->next;
+    }
+    return info;
+}
+
 // Comparison function for sorting candidates by contention score
 static int compare_candidates_by_contention(const void *a, const void *b) {
     const false_sharing_candidate_t *c1 = (const false_sharing_candidate_t *)a;
@@ -51,80 +67,56 @@ static int compare_candidates_by_contention(const void *a, const void *b) {
 }
 
 // Detect false sharing in samples
-int detect_false_sharing(const cache_miss_sample_t *samples, int sample_count,
+int detect_false_sharing(const false_sharing_detector_t *detector,
+                        const cache_miss_sample_t *samples, int sample_count,
                         false_sharing_results_t *results) {
-    if (!samples || sample_count <= 0 || !results) {
+    if (!detector || !samples || sample_count <= 0 || !results) {
         LOG_ERROR("Invalid parameters for detect_false_sharing");
         return -1;
     }
-    
-    if (!g_initialized) {
-        LOG_ERROR("False sharing detector not initialized");
-        return -1;
-    }
+    const false_sharing_config_t *config = &detector->config;
+    TRACE_SCOPE(trace, "false_sharing.detect");
+    trace_add_items(&trace, sample_count);
     
     LOG_INFO("Detecting false sharing in %d samples", sample_count);
     
     memset(results, 0, sizeof(false_sharing_results_t));
     
-    // Group samples by cache line
-    typedef struct cache_line_info {
-        uint64_t cache_line;
-        cache_miss_sample_t *samples;
-        int sample_count;
-        int sample_capacity;
-    } cache_line_info_t;
-    
-    // Simple hash table for cache lines
-    #define HASH_SIZE 1024
-    cache_line_info_t *cache_lines[HASH_SIZE] = {NULL};
+    // Lines and their samples live in one arena released on return
+    arena_t *arena = arena_create(0);
+    if (!arena) return -1;
+    cache_line_info_t *cache_lines[LINE_HASH_SIZE] = {NULL};
     
-    // Group samples by cache line
+    // Count each line's samples first so every line gets one exact array
     for (int i = 0; i < sample_count; i++) {
         uint64_t cache_line = get_cache_line_address(samples[i].memory_addr,
-                                                    g_config.cache_line_size);
-        uint64_t hash = (cache_line / g_config.cache_line_size) % HASH_SIZE;
-        
-        // Find or create cache line info
-        cache_line_info_t *info = cache_lines[hash];
-        cache_line_info_t *prev = NULL;
-        
-        while (info && info->cache_line != cache_line) {
-            prev = info;
-            info = (cache_line_info_t *)info->samples;  // Reusing pointer as next  // Reusing pointer as next
-        }
+                                                    config->cache_line_size);
+        cache_line_info_t *info = find_cache_line(cache_lines, cache_line, config->cache_line_size);
         
         if (!info) {
-            info = CALLOC_LOGGED(1, sizeof(cache_line_info_t));
+            info = arena_calloc(arena, 1, sizeof(cache_line_info_t));
             if (!info) continue;
             
+            uint64_t hash = (cache_line / config->cache_line_size) % LINE_HASH_SIZE;
             info->cache_line = cache_line;
-            info->sample_capacity = 16;
-            info->samples = MALLOC_LOGGED(info->sample_capacity * sizeof(cache_miss_sample_t));
-            
-            if (!info->samples) {
-                FREE_LOGGED(info);
-                continue;
-            }
-            
-            if (prev) {
-                prev->samples = (cache_miss_sample_t*)info;  // Chain
-            } else {
-                cache_lines[hash] = info;
-            }
+            info->next = cache_lines[hash];
+            cache_lines[hash] = info;
         }
-        
-        // Add sample to cache line
-        if (info->sample_count >= info->sample_capacity) {
-            info->sample_capacity *= 2;
-            cache_miss_sample_t *new_samples = realloc(info->samples,
-                info->sample_capacity * sizeof(cache_miss_sample_t));
-            if (new_samples) {
-                info->samples = new_samples;
-            }
+        info->sample_capacity++;
+    }
+    
+    for (int i = 0; i < LINE_HASH_SIZE; i++) {
+        for (cache_line_info_t *info = cache_lines[i]; info; info = info->next) {
+            info->samples = arena_alloc(arena, info->sample_capacity * sizeof(cache_miss_sample_t));
+            if (!info->samples) info->sample_capacity = 0;
         }
-        
-        if (info->sample_count < info->sample_capacity) {
+    }
+    
+    for (int i = 0; i < sample_count; i++) {
+        uint64_t cache_line = get_cache_line_address(samples[i].memory_addr,
+                                                    config->cache_line_size);
+        cache_line_info_t *info = find_cache_line(cache_lines, cache_line, config->cache_line_size);
+        if (info && info->sample_count < info->sample_capacity) {
             info->samples[info->sample_count++] = samples[i];
         }
     }
@@ -136,71 +128,52 @@ int detect_false_sharing(const cache_miss_sample_t *samples, int sample_count,
     
     candidates = CALLOC_LOGGED(candidate_capacity, sizeof(false_sharing_candidate_t));
     if (!candidates) {
-        // Cleanup and return
-        for (int i = 0; i < HASH_SIZE; i++) {
-            cache_line_info_t *info = cache_lines[i];
-            while (info) {
-                cache_line_info_t *next = (cache_line_info_t*)info->samples;
-                if (info->samples && info->sample_count > 0) {
-                    FREE_LOGGED(info->samples);
-                }
-                FREE_LOGGED(info);
-                info = next;
-            }
-        }
+        arena_destroy(arena);
         return -1;
     }
     
     // Check each cache line
-    for (int i = 0; i < HASH_SIZE; i++) {
-        cache_line_info_t *info = cache_lines[i];
-        
-        while (info) {
-            if (info->sample_count >= g_config.min_thread_count) {
-                false_sharing_candidate_t candidate = {0};
-                
-                if (analyze_cache_line_sharing(info->samples, info->sample_count,
-                                             info->cache_line, &candidate) == 0) {
-                    if (candidate.num_threads >= g_config.min_thread_count) {
-                        // Calculate contention score
-                        candidate.contention_score = calculate_contention_score(&candidate);
-                        
-                        // Verify if it's real false sharing
-                        candidate.confirmed = verify_false_sharing(&candidate,
-                                                                 info->samples,
-                                                                 info->sample_count);
-                        
-                        // Add to candidates
-                        if (candidate_count >= candidate_capacity) {
-                            candidate_capacity *= 2;
-                            false_sharing_candidate_t *new_candidates = 
-                                realloc(candidates, candidate_capacity * 
-                                       sizeof(false_sharing_candidate_t));
-                            if (new_candidates) {
-                                candidates = new_candidates;
-                            }
-                        }
-                        
-                        if (candidate_count < candidate_capacity) {
-                            candidates[candidate_count++] = candidate;
-                            
-                            if (candidate.confirmed) {
-                                results->confirmed_count++;
-                                results->total_impact_score += candidate.contention_score;
-                            }
-                        }
-                    }
+    for (int i = 0; i < LINE_HASH_SIZE; i++) {
+        for (cache_line_info_t *info = cache_lines[i]; info; info = info->next) {
+            if (info->sample_count < config->min_thread_count) continue;
+            
+            false_sharing_candidate_t candidate = {0};
+            if (analyze_cache_line_sharing(info->samples, info->sample_count,
+                                         info->cache_line, &candidate) != 0 ||
+                candidate.num_threads < config->min_thread_count) {
+                continue;
+            }
+            
+            // Calculate contention score
+            candidate.contention_score = calculate_contention_score(&candidate);
+            
+            // Verify if it's real false sharing
+            candidate.confirmed = verify_false_sharing(detector, &candidate,
+                                                     info->samples,
+                                                     info->sample_count);
+            
+            // Add to candidates
+            if (candidate_count >= candidate_capacity) {
+                candidate_capacity *= 2;
+                false_sharing_candidate_t *new_candidates = 
+                    realloc(candidates, candidate_capacity * 
+                           sizeof(false_sharing_candidate_t));
+                if (new_candidates) {
+                    candidates = new_candidates;
                 }
             }
             
-            cache_line_info_t *next = (cache_line_info_t*)info->samples;
-            if (info->samples && info->sample_count > 0) {
-                FREE_LOGGED(info->samples);
+            if (candidate_count < candidate_capacity) {
+                candidates[candidate_count++] = candidate;
+                
+                if (candidate.confirmed) {
+                    results->confirmed_count++;
+                    results->total_impact_score += candidate.contention_score;
+                }
             }
-            FREE_LOGGED(info);
-            info = next;
         }
     }
+    arena_destroy(arena);
     
     if (candidate_count > 0) {
         qsort(candidates, candidate_count, sizeof(false_sharing_candidate_t),
@@ -323,9 +296,10 @@ double calculate_contention_score(const false_sharing_candidate_t *candidate) {
 }
 
 // Verify false sharing
-bool verify_false_sharing(const false_sharing_candidate_t *candidate,
+bool verify_false_sharing(const false_sharing_detector_t *detector,
+                         const false_sharing_candidate_t *candidate,
                          const cache_miss_sample_t *samples, int sample_count) {
-    if (!candidate || !samples || sample_count <= 0) return false;
+    if (!detector || !candidate || !samples || sample_count <= 0) return false;
     
     // Verification criteria:
     // 1. Multiple threads with writes
@@ -355,13 +329,13 @@ bool verify_false_sharing(const false_sharing_candidate_t *candidate,
     
     double write_ratio = total_accesses > 0 ? (double)total_writes / total_accesses : 0;
     
-    if (write_ratio < g_config.min_write_ratio) {
+    if (write_ratio < detector->config.min_write_ratio) {
         LOG_DEBUG("Not false sharing: low write ratio %.2f", write_ratio);
         return false;
     }
     
     // Check for different source locations
-    if (g_config.require_different_vars && candidate->num_locations < 2) {
+    if (detector->config.require_different_vars && candidate->num_locations < 2) {
         LOG_DEBUG("Not false sharing: single source location");
         return false;
     }
@@ -371,10 +345,12 @@ bool verify_false_sharing(const false_sharing_candidate_t *candidate,
 }
 
 // Generate mitigation suggestions
-int generate_mitigation_suggestions(const false_sharing_candidate_t *candidate,
+int generate_mitigation_suggestions(const false_sharing_detector_t *detector,
+                                   const false_sharing_candidate_t *candidate,
                                    mitigation_suggestion_t **suggestions,
                                    int *suggestion_count) {
-    if (!candidate || !suggestions || !suggestion_count) return -1;
+    if (!detector || !candidate || !suggestions || !suggestion_count) return -1;
+    int line_size = detector->config.cache_line_size;
     
     *suggestions = CALLOC_LOGGED(4, sizeof(mitigation_suggestion_t));
     if (!*suggestions) return -1;
@@ -401,7 +377,7 @@ int generate_mitigation_suggestions(const false_sharing_candidate_t *candidate,
              "    char padding[%d];  // Cache line size - sizeof(int)\n"
              "    int thread2_counter;  // Now in different cache line\n"
              "};",
-             g_config.cache_line_size - (int)sizeof(int));
+             line_size - (int)sizeof(int));
     
     // Suggestion 2: Alignment
     sug = &(*suggestions)[(*suggestion_count)++];
@@ -421,7 +397,7 @@ int generate_mitigation_suggestions(const false_sharing_candidate_t *candidate,
              "// Or use aligned allocation:\n"
              "void *aligned_data;\n"
              "posix_memalign(&aligned_data, %d, sizeof(thread_data));",
-             g_config.cache_line_size, g_config.cache_line_size);
+             line_size, line_size);
     
     // Suggestion 3: Data restructuring
     if (candidate->num_locations > 1) {
@@ -441,7 +417,7 @@ int generate_mitigation_suggestions(const false_sharing_candidate_t *candidate,
                  "    char padding[%d];\n"
                  "    struct { int b1; int b2; } thread2_data;\n"
                  "};",
-                 g_config.cache_line_size);
+                 line_size);
     }
     
     LOG_DEBUG("Generated %d mitigation suggestions", *suggestion_count);
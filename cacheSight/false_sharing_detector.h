@@ -36,12 +36,16 @@ typedef struct {
     double total_impact_score;      // Overall performance impact
 } false_sharing_results_t;
 
+// Detector context; independent detectors can run on separate threads
+typedef struct false_sharing_detector false_sharing_detector_t;
+
 // API functions
-int false_sharing_detector_init(const false_sharing_config_t *config);
-void false_sharing_detector_cleanup(void);
+false_sharing_detector_t* false_sharing_detector_create(const false_sharing_config_t *config);
+void false_sharing_detector_destroy(false_sharing_detector_t *detector);
 
 // Detection functions
-int detect_false_sharing(const cache_miss_sample_t *samples, int sample_count,
+int detect_false_sharing(const false_sharing_detector_t *detector,
+                        const cache_miss_sample_t *samples, int sample_count,
                         false_sharing_results_t *results);
 
 int detect_false_sharing_hotspots(const cache_hotspot_t *hotspots, int hotspot_count,
@@ -53,7 +57,8 @@ int analyze_cache_line_sharing(const cache_miss_sample_t *samples, int count,
 
 double calculate_contention_score(const false_sharing_candidate_t *candidate);
 
-bool verify_false_sharing(const false_sharing_candidate_t *candidate,
+bool verify_false_sharing(const false_sharing_detector_t *detector,
+                         const false_sharing_candidate_t *candidate,
                          const cache_miss_sample_t *samples, int sample_count);
 
 // Mitigation suggestions
@@ -64,7 +69,8 @@ typedef struct {
     double expected_improvement;    // Percentage improvement
 } mitigation_suggestion_t;
 
-int generate_mitigation_suggestions(const false_sharing_candidate_t *candidate,
+int generate_mitigation_suggestions(const false_sharing_detector_t *detector,
+                                   const false_sharing_candidate_t *candidate,
                                    mitigation_suggestion_t **suggestions,
                                    int *suggestion_count);
 
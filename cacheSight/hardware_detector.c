@@ -174,7 +174,7 @@ static int parse_cpu_info(cache_info_t *info) {
         return -1;
     }
 
-    char line[1024];
+    char line[4096];  // x86 flags lines run well past 1 KB
     int physical_cores = 0;
     int logical_cores = 0;
     bool found_model = false;
@@ -204,11 +204,25 @@ static int parse_cpu_info(cache_info_t *info) {
             }
         } else if (strncmp(line, "cpu cores", 9) == 0) {
             sscanf(line, "cpu cores : %d", &physical_cores);
+        } else if ((strncmp(line, "flags", 5) == 0 || strncmp(line, "Features", 8) == 0) &&
+                   info->simd_width_bytes == 0) {
+            if (strstr(line, " avx512f")) {
+                info->simd_width_bytes = 64;
+            } else if (strstr(line, " avx2") || strstr(line, " avx ")) {
+                info->simd_width_bytes = 32;
+            } else if (strstr(line, " sse2") || strstr(line, " asimd")) {
+                info->simd_width_bytes = 16;
+            }
         }
     }
 
     fclose(fp);
 
+    if (info->simd_width_bytes == 0) {
+        info->simd_width_bytes = 16;  // SSE2/NEON baseline
+    }
+    LOG_DEBUG("SIMD width: %d bytes", info->simd_width_bytes);
+
     info->num_threads = logical_cores;
     info->num_cores = physical_cores > 0 ? physical_cores : logical_cores;
 
@@ -307,6 +321,7 @@ void print_cache_info(const cache_info_t *info) {
     printf("CPU Model: %s\n", info->cpu_model);
     printf("CPU Family: %d, Model: %d\n", info->cpu_family, info->cpu_model_num);
     printf("CPU Frequency: %.2f GHz\n", info->cpu_frequency_ghz);
+    printf("SIMD Width: %d bytes\n", info->simd_width_bytes);
     printf("Cores: %d physical, %d logical\n", info->num_cores, info->num_threads);
     printf("NUMA Nodes: %d\n", info->numa_nodes);
     printf("Page Size: %d bytes\n", info->page_size);
@@ -315,6 +330,9 @@ void print_cache_info(const cache_info_t *info) {
     format_bytes(info->total_memory, mem_str, sizeof(mem_str));
     printf("Total Memory: %s\n", mem_str);
     printf("Memory Bandwidth: ~%zu GB/s\n", info->memory_bandwidth_gbps);
+    if (info->memory_latency_ns > 0) {
+        printf("Memory Latency: %.1f ns\n", info->memory_latency_ns);
+    }
 
     printf("\n=== Cache Hierarchy ===\n");
     for (int i = 0; i < info->num_levels; i++) {
@@ -357,12 +375,14 @@ int save_cache_info_to_file(const cache_info_t *info, const char *filename) {
     fprintf(fp, "cpu_family=%d\n", info->cpu_family);
     fprintf(fp, "cpu_model_num=%d\n", info->cpu_model_num);
     fprintf(fp, "cpu_frequency_ghz=%.2f\n", info->cpu_frequency_ghz);
+    fprintf(fp, "simd_width_bytes=%d\n", info->simd_width_bytes);
     fprintf(fp, "num_cores=%d\n", info->num_cores);
     fprintf(fp, "num_threads=%d\n", info->num_threads);
     fprintf(fp, "numa_nodes=%d\n", info->numa_nodes);
     fprintf(fp, "page_size=%d\n", info->page_size);
     fprintf(fp, "total_memory=%zu\n", info->total_memory);
     fprintf(fp, "memory_bandwidth_gbps=%zu\n", info->memory_bandwidth_gbps);
+    fprintf(fp, "memory_latency_ns=%.1f\n", info->memory_latency_ns);
     fprintf(fp, "num_cache_levels=%d\n\n", info->num_levels);
 
     for (int i = 0; i < info->num_levels; i++) {
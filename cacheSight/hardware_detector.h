@@ -32,6 +32,8 @@ typedef struct {
     int cpu_family;             // CPU family
     int cpu_model_num;          // CPU model number
     double cpu_frequency_ghz;   // CPU frequency in GHz
+    int simd_width_bytes;       // Widest vector register (16, 32 or 64)
+    double memory_latency_ns;   // Measured DRAM load-to-use latency (0 = not measured)
 } cache_info_t;
 
 // Main API functions
@@ -0,0 +1,334 @@
+#include "json_reader.h"
+
+#define JSON_MAX_DEPTH 64
+
+typedef struct {
+    arena_t *arena;
+    const char *text;
+    size_t length;
+    size_t pos;
+    int depth;
+    bool failed;
+} json_parser_t;
+
+static json_value_t* parse_value(json_parser_t *parser);
+
+static void fail(json_parser_t *parser, const char *what) {
+    if (!parser->failed) {
+        LOG_DEBUG("JSON parse error at offset %zu: %s", parser->pos, what);
+    }
+    parser->failed = true;
+}
+
+static void skip_space(json_parser_t *parser) {
+    while (parser->pos < parser->length) {
+        char c = parser->text[parser->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+        parser->pos++;
+    }
+}
+
+static bool consume(json_parser_t *parser, char c) {
+    skip_space(parser);
+    if (parser->pos < parser->length && parser->text[parser->pos] == c) {
+        parser->pos++;
+        return true;
+    }
+    return false;
+}
+
+static bool consume_word(json_parser_t *parser, const char *word) {
+    size_t len = strlen(word);
+    if (parser->length - parser->pos < len || memcmp(parser->text + parser->pos, word, len) != 0) {
+        return false;
+    }
+    parser->pos += len;
+    return true;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static size_t encode_utf8(unsigned code, char *out) {
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        out[0] = (char)(0xc0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3f));
+        return 2;
+    }
+    if (code < 0x10000) {
+        out[0] = (char)(0xe0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (code & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3f));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3f));
+    out[3] = (char)(0x80 | (code & 0x3f));
+    return 4;
+}
+
+static unsigned parse_hex4(json_parser_t *parser) {
+    if (parser->length - parser->pos < 4) {
+        fail(parser, "short \\u escape");
+        return 0;
+    }
+    
+    unsigned code = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hex_value(parser->text[parser->pos++]);
+        if (digit < 0) {
+            fail(parser, "bad \\u escape");
+            return 0;
+        }
+        code = (code << 4) | (unsigned)digit;
+    }
+    return code;
+}
+
+// Decoded text is never longer than the quoted source, so one arena block of
+// that size holds it
+static const char* parse_string(json_parser_t *parser) {
+    if (!consume(parser, '"')) {
+        fail(parser, "expected string");
+        return NULL;
+    }
+    
+    size_t start = parser->pos;
+    size_t end = start;
+    while (end < parser->length && parser->text[end] != '"') {
+        if (parser->text[end] == '\\') end++;
+        end++;
+    }
+    if (end >= parser->length) {
+        fail(parser, "unterminated string");
+        return NULL;
+    }
+    
+    char *out = arena_alloc(parser->arena, end - start + 1);
+    if (!out) {
+        fail(parser, "out of memory");
+        return NULL;
+    }
+    
+    size_t n = 0;
+    while (parser->pos < end) {
+        char c = parser->text[parser->pos++];
+        if (c != '\\') {
+            out[n++] = c;
+            continue;
+        }
+        
+        char esc = parser->text[parser->pos++];
+        switch (esc) {
+            case '"': out[n++] = '"'; break;
+            case '\\': out[n++] = '\\'; break;
+            case '/': out[n++] = '/'; break;
+            case 'b': out[n++] = '\b'; break;
+            case 'f': out[n++] = '\f'; break;
+            case 'n': out[n++] = '\n'; break;
+            case 'r': out[n++] = '\r'; break;
+            case 't': out[n++] = '\t'; break;
+            case 'u': {
+                unsigned code = parse_hex4(parser);
+                // A surrogate pair spells one code point in 12 source bytes
+                if (code >= 0xd800 && code < 0xdc00 && parser->pos + 6 <= end &&
+                    parser->text[parser->pos] == '\\' && parser->text[parser->pos + 1] == 'u') {
+                    parser->pos += 2;
+                    unsigned low = parse_hex4(parser);
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                n += encode_utf8(code, out + n);
+                break;
+            }
+            default:
+                fail(parser, "bad escape");
+                return NULL;
+        }
+    }
+    out[n] = '\0';
+    parser->pos = end + 1;
+    
+    return parser->failed ? NULL : out;
+}
+
+static bool parse_number(json_parser_t *parser, double *number) {
+    char buffer[64];
+    size_t n = 0;
+    
+    while (parser->pos < parser->length && n < sizeof(buffer) - 1) {
+        char c = parser->text[parser->pos];
+        if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) {
+            break;
+        }
+        buffer[n++] = c;
+        parser->pos++;
+    }
+    buffer[n] = '\0';
+    
+    char *end;
+    *number = strtod(buffer, &end);
+    if (n == 0 || *end != '\0') {
+        fail(parser, "bad number");
+        return false;
+    }
+    return true;
+}
+
+static json_value_t* new_value(json_parser_t *parser, json_type_t type) {
+    json_value_t *value = arena_calloc(parser->arena, 1, sizeof(json_value_t));
+    if (!value) {
+        fail(parser, "out of memory");
+        return NULL;
+    }
+    value->type = type;
+    return value;
+}
+
+// Members of an object or elements of an array, linked in source order
+static json_value_t* parse_container(json_parser_t *parser, bool is_object) {
+    char close = is_object ? '}' : ']';
+    json_value_t *container = new_value(parser, is_object ? JSON_OBJECT : JSON_ARRAY);
+    if (!container) return NULL;
+    
+    if (++parser->depth > JSON_MAX_DEPTH) {
+        fail(parser, "nesting too deep");
+        return NULL;
+    }
+    
+    json_value_t **tail = &container->child;
+    if (!consume(parser, close)) {
+        do {
+            const char *key = NULL;
+            if (is_object) {
+                key = parse_string(parser);
+                if (!key || !consume(parser, ':')) {
+                    fail(parser, "expected member");
+                    return NULL;
+                }
+            }
+            
+            json_value_t *item = parse_value(parser);
+            if (!item) return NULL;
+            item->key = key;
+            *tail = item;
+            tail = &item->next;
+            container->count++;
+        } while (consume(parser, ','));
+        
+        if (!consume(parser, close)) {
+            fail(parser, is_object ? "expected '}'" : "expected ']'");
+            return NULL;
+        }
+    }
+    
+    parser->depth--;
+    return container;
+}
+
+static json_value_t* parse_value(json_parser_t *parser) {
+    skip_space(parser);
+    if (parser->failed || parser->pos >= parser->length) {
+        fail(parser, "unexpected end");
+        return NULL;
+    }
+    
+    char c = parser->text[parser->pos];
+    json_value_t *value = NULL;
+    
+    switch (c) {
+        case '{':
+            parser->pos++;
+            return parse_container(parser, true);
+        
+        case '[':
+            parser->pos++;
+            return parse_container(parser, false);
+        
+        case '"': {
+            const char *string = parse_string(parser);
+            if (!string) return NULL;
+            value = new_value(parser, JSON_STRING);
+            if (value) value->string = string;
+            return value;
+        }
+        
+        case 't':
+        case 'f':
+            if (consume_word(parser, c == 't' ? "true" : "false")) {
+                value = new_value(parser, JSON_BOOL);
+                if (value) value->boolean = (c == 't');
+                return value;
+            }
+            break;
+        
+        case 'n':
+            if (consume_word(parser, "null")) {
+                return new_value(parser, JSON_NULL);
+            }
+            break;
+        
+        default: {
+            double number;
+            if (parse_number(parser, &number)) {
+                value = new_value(parser, JSON_NUMBER);
+                if (value) value->number = number;
+                return value;
+            }
+            return NULL;
+        }
+    }
+    
+    fail(parser, "unexpected token");
+    return NULL;
+}
+
+json_value_t* json_parse(arena_t *arena, const char *text, size_t length, size_t *end) {
+    if (!arena || !text) return NULL;
+    
+    json_parser_t parser = {
+        .arena = arena,
+        .text = text,
+        .length = length
+    };
+    
+    json_value_t *value = parse_value(&parser);
+    if (parser.failed) {
+        return NULL;
+    }
+    
+    if (end) {
+        *end = parser.pos;
+    }
+    return value;
+}
+
+// Objects are small; a linear scan beats building an index
+const json_value_t* json_get(const json_value_t *object, const char *key) {
+    if (!object || object->type != JSON_OBJECT || !key) return NULL;
+    
+    for (const json_value_t *member = object->child; member; member = member->next) {
+        if (strcmp(member->key, key) == 0) {
+            return member;
+        }
+    }
+    return NULL;
+}
+
+const char* json_get_string(const json_value_t *object, const char *key, const char *fallback) {
+    const json_value_t *value = json_get(object, key);
+    return value && value->type == JSON_STRING ? value->string : fallback;
+}
+
+double json_get_number(const json_value_t *object, const char *key, double fallback) {
+    const json_value_t *value = json_get(object, key);
+    return value && value->type == JSON_NUMBER ? value->number : fallback;
+}
@@ -0,0 +1,37 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include "common.h"
+#include "arena.h"
+
+typedef enum {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} json_type_t;
+
+// Parsed value; every node and string lives in the arena passed to json_parse
+typedef struct json_value json_value_t;
+struct json_value {
+    json_type_t type;
+    const char *key;            // Member name when inside an object
+    const char *string;
+    double number;
+    bool boolean;
+    json_value_t *child;        // First element or member
+    json_value_t *next;         // Next sibling
+    int count;                  // Elements or members
+};
+
+// API functions
+// Parse one value from text; *end (if given) is set past it
+json_value_t* json_parse(arena_t *arena, const char *text, size_t length, size_t *end);
+
+const json_value_t* json_get(const json_value_t *object, const char *key);
+const char* json_get_string(const json_value_t *object, const char *key, const char *fallback);
+double json_get_number(const json_value_t *object, const char *key, double fallback);
+
+#endif // JSON_READER_H
@@ -0,0 +1,256 @@
+#include "json_writer.h"
+#include <math.h>
+
+// Digits for \u escapes of control characters
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+// Push the pending chunk to the file
+int json_writer_flush(json_writer_t *writer) {
+    if (!writer || !writer->fp) return -1;
+    
+    if (writer->used > 0) {
+        if (fwrite(writer->chunk, 1, writer->used, writer->fp) != writer->used) {
+            writer->failed = true;
+        }
+        writer->bytes_written += writer->used;
+        writer->used = 0;
+    }
+    return writer->failed ? -1 : 0;
+}
+
+static void put_bytes(json_writer_t *writer, const char *data, size_t len) {
+    while (len > 0) {
+        if (writer->used == sizeof(writer->chunk) && json_writer_flush(writer) != 0) {
+            return;
+        }
+        size_t room = sizeof(writer->chunk) - writer->used;
+        size_t n = len < room ? len : room;
+        memcpy(writer->chunk + writer->used, data, n);
+        writer->used += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static void put_char(json_writer_t *writer, char c) {
+    if (writer->used == sizeof(writer->chunk) && json_writer_flush(writer) != 0) {
+        return;
+    }
+    writer->chunk[writer->used++] = c;
+}
+
+void json_escape(const char *data, size_t len, json_emit_fn emit, void *ctx) {
+    size_t run = 0;
+    for (size_t i = 0; i < len; i++) {
+        // Runs of bytes that need no escaping go out in one piece
+        unsigned char c = (unsigned char)data[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        
+        if (i > run) emit(ctx, data + run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"': emit(ctx, "\\\"", 2); break;
+            case '\\': emit(ctx, "\\\\", 2); break;
+            case '\n': emit(ctx, "\\n", 2); break;
+            case '\r': emit(ctx, "\\r", 2); break;
+            case '\t': emit(ctx, "\\t", 2); break;
+            default: {
+                char esc[6] = { '\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xf] };
+                emit(ctx, esc, sizeof(esc));
+            }
+        }
+    }
+    if (len > run) emit(ctx, data + run, len - run);
+}
+
+static void emit_bytes(void *ctx, const char *data, size_t len) {
+    put_bytes(ctx, data, len);
+}
+
+static void put_escaped(json_writer_t *writer, const char *str) {
+    put_char(writer, '"');
+    json_escape(str, strlen(str), emit_bytes, writer);
+    put_char(writer, '"');
+}
+
+// Separator, indentation and key ahead of a value
+static void begin_value(json_writer_t *writer, const char *key) {
+    if (writer->depth > 0) {
+        if (!writer->first[writer->depth]) {
+            put_char(writer, ',');
+        }
+        writer->first[writer->depth] = false;
+        
+        if (writer->pretty) {
+            put_char(writer, '\n');
+            for (int i = 0; i < writer->depth; i++) {
+                put_bytes(writer, "  ", 2);
+            }
+        }
+    }
+    
+    if (key) {
+        put_escaped(writer, key);
+        put_bytes(writer, writer->pretty ? ": " : ":", writer->pretty ? 2 : 1);
+    }
+}
+
+static void open_container(json_writer_t *writer, const char *key, char open) {
+    begin_value(writer, key);
+    put_char(writer, open);
+    
+    if (writer->depth + 1 >= JSON_WRITER_MAX_DEPTH) {
+        LOG_ERROR("JSON nesting deeper than %d", JSON_WRITER_MAX_DEPTH);
+        writer->failed = true;
+        return;
+    }
+    writer->first[++writer->depth] = true;
+}
+
+static void close_container(json_writer_t *writer, char close) {
+    if (writer->depth == 0) {
+        writer->failed = true;
+        return;
+    }
+    
+    bool empty = writer->first[writer->depth];
+    writer->depth--;
+    if (writer->pretty && !empty) {
+        put_char(writer, '\n');
+        for (int i = 0; i < writer->depth; i++) {
+            put_bytes(writer, "  ", 2);
+        }
+    }
+    put_char(writer, close);
+}
+
+int json_writer_open(json_writer_t *writer, const char *path, bool pretty) {
+    if (!writer || !path) return -1;
+    
+    memset(writer, 0, sizeof(*writer));
+    writer->fp = fopen(path, "w");
+    if (!writer->fp) {
+        LOG_ERROR("Failed to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    writer->pretty = pretty;
+    return 0;
+}
+
+int json_writer_close(json_writer_t *writer) {
+    if (!writer || !writer->fp) return -1;
+    
+    if (writer->depth != 0) {
+        LOG_WARNING("JSON writer closed with %d open containers", writer->depth);
+        writer->failed = true;
+    }
+    
+    json_writer_flush(writer);
+    if (fclose(writer->fp) != 0) {
+        writer->failed = true;
+    }
+    writer->fp = NULL;
+    return writer->failed ? -1 : 0;
+}
+
+void json_begin_object(json_writer_t *writer, const char *key) {
+    open_container(writer, key, '{');
+}
+
+void json_end_object(json_writer_t *writer) {
+    close_container(writer, '}');
+}
+
+void json_begin_array(json_writer_t *writer, const char *key) {
+    open_container(writer, key, '[');
+}
+
+void json_end_array(json_writer_t *writer) {
+    close_container(writer, ']');
+}
+
+void json_string(json_writer_t *writer, const char *key, const char *value) {
+    begin_value(writer, key);
+    if (value) {
+        put_escaped(writer, value);
+    } else {
+        put_bytes(writer, "null", 4);
+    }
+}
+
+// Digits are produced backwards into a small stack buffer; no printf
+static void put_u64(json_writer_t *writer, uint64_t value, bool negative) {
+    char digits[24];
+    int n = 0;
+    
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    if (negative) {
+        digits[sizeof(digits) - 1 - n++] = '-';
+    }
+    put_bytes(writer, digits + sizeof(digits) - n, n);
+}
+
+void json_int(json_writer_t *writer, const char *key, int64_t value) {
+    begin_value(writer, key);
+    if (value < 0) {
+        put_u64(writer, (uint64_t)0 - (uint64_t)value, true);
+    } else {
+        put_u64(writer, (uint64_t)value, false);
+    }
+}
+
+void json_uint(json_writer_t *writer, const char *key, uint64_t value) {
+    begin_value(writer, key);
+    put_u64(writer, value, false);
+}
+
+void json_double(json_writer_t *writer, const char *key, double value) {
+    begin_value(writer, key);
+    
+    // JSON has no NaN or infinity
+    if (!isfinite(value)) {
+        put_bytes(writer, "null", 4);
+        return;
+    }
+    
+    // Whole numbers skip the formatter
+    if (fabs(value) < 1e15 && value == (double)(int64_t)value) {
+        int64_t whole = (int64_t)value;
+        if (whole < 0) {
+            put_u64(writer, (uint64_t)0 - (uint64_t)whole, true);
+        } else {
+            put_u64(writer, (uint64_t)whole, false);
+        }
+        return;
+    }
+    
+    char buffer[32];
+    int n = snprintf(buffer, sizeof(buffer), "%.10g", value);
+    put_bytes(writer, buffer, n > 0 ? (size_t)n : 0);
+}
+
+void json_bool(json_writer_t *writer, const char *key, bool value) {
+    begin_value(writer, key);
+    if (value) {
+        put_bytes(writer, "true", 4);
+    } else {
+        put_bytes(writer, "false", 5);
+    }
+}
+
+void json_null(json_writer_t *writer, const char *key) {
+    begin_value(writer, key);
+    put_bytes(writer, "null", 4);
+}
+
+void json_end_record(json_writer_t *writer) {
+    if (writer->depth != 0) {
+        writer->failed = true;
+        return;
+    }
+    put_char(writer, '\n');
+    writer->records++;
+}
@@ -0,0 +1,48 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include "common.h"
+
+#define JSON_WRITER_CHUNK 65536
+#define JSON_WRITER_MAX_DEPTH 32
+
+// Streaming JSON writer over a fixed chunk; nothing is allocated per value.
+// A key is required inside objects and ignored (pass NULL) inside arrays.
+typedef struct {
+    FILE *fp;
+    char chunk[JSON_WRITER_CHUNK];
+    size_t used;
+    int depth;
+    bool first[JSON_WRITER_MAX_DEPTH];  // No value written yet at this depth
+    bool pretty;                        // Indent nested values; off for NDJSON
+    bool failed;                        // A write failed or nesting overflowed
+    uint64_t records;                   // Completed top-level values
+    size_t bytes_written;
+} json_writer_t;
+
+// API functions
+int json_writer_open(json_writer_t *writer, const char *path, bool pretty);
+int json_writer_close(json_writer_t *writer);
+int json_writer_flush(json_writer_t *writer);
+
+void json_begin_object(json_writer_t *writer, const char *key);
+void json_end_object(json_writer_t *writer);
+void json_begin_array(json_writer_t *writer, const char *key);
+void json_end_array(json_writer_t *writer);
+
+void json_string(json_writer_t *writer, const char *key, const char *value);
+void json_int(json_writer_t *writer, const char *key, int64_t value);
+void json_uint(json_writer_t *writer, const char *key, uint64_t value);
+void json_double(json_writer_t *writer, const char *key, double value);
+void json_bool(json_writer_t *writer, const char *key, bool value);
+void json_null(json_writer_t *writer, const char *key);
+
+// Finish a top-level value; in NDJSON mode this ends the line
+void json_end_record(json_writer_t *writer);
+
+// JSON string escaping (contents only, no quotes), shared with writers that
+// do not go through json_writer_t; control characters become \u00XX
+typedef void (*json_emit_fn)(void *ctx, const char *data, size_t len);
+void json_escape(const char *data, size_t len, json_emit_fn emit, void *ctx);
+
+#endif // JSON_WRITER_H
@@ -1,34 +1,33 @@
 #include "loop_analyzer.h"
 #include <math.h>
 
-static cache_info_t g_cache_info;
-static bool g_initialized = false;
+struct loop_analyzer {
+    cache_info_t cache_info;
+};
 
-int loop_analyzer_init(const cache_info_t *cache_info) {
-    if (g_initialized) {
-        LOG_WARNING("Loop analyzer already initialized");
-        return 0;
-    }
-    
+loop_analyzer_t* loop_analyzer_create(const cache_info_t *cache_info) {
     if (!cache_info) {
         LOG_ERROR("NULL cache info provided to loop analyzer");
-        return -1;
+        return NULL;
     }
     
-    g_cache_info = *cache_info;
-    g_initialized = true;
+    loop_analyzer_t *analyzer = CALLOC_LOGGED(1, sizeof(loop_analyzer_t));
+    if (!analyzer) {
+        LOG_ERROR("Failed to allocate loop analyzer");
+        return NULL;
+    }
     
-    LOG_INFO("Loop analyzer initialized with %d cache levels", cache_info->num_levels);
-    return 0;
+    analyzer->cache_info = *cache_info;
+    
+    LOG_INFO("Loop analyzer created with %d cache levels", cache_info->num_levels);
+    return analyzer;
 }
 
-void loop_analyzer_cleanup(void) {
-    if (!g_initialized) {
-        return;
-    }
+void loop_analyzer_destroy(loop_analyzer_t *analyzer) {
+    if (!analyzer) return;
     
-    LOG_INFO("Loop analyzer cleanup");
-    g_initialized = false;
+    LOG_INFO("Destroying loop analyzer");
+    FREE_LOGGED(analyzer);
 }
 
 int analyze_loop_characteristics(const loop_info_t *loop, const cache_info_t *cache_info,
@@ -104,8 +103,9 @@ int analyze_loop_characteristics(const loop_info_t *loop, const cache_info_t *ca
     return 0;
 }
 
-int analyze_loop_nest(const loop_info_t *loops, int loop_count, loop_nest_t *nest) {
-    if (!loops || loop_count <= 0 || !nest) {
+int analyze_loop_nest(const loop_analyzer_t *analyzer, const loop_info_t *loops, int loop_count,
+                     loop_nest_t *nest) {
+    if (!analyzer || !loops || loop_count <= 0 || !nest) {
         LOG_ERROR("Invalid parameters for analyze_loop_nest");
         return -1;
     }
@@ -148,12 +148,12 @@ int analyze_loop_nest(const loop_info_t *loops, int loop_count, loop_nest_t *nes
     }
     
     for (int i = 0; i < loop_count; i++) {
-        analyze_loop_characteristics(sorted_loops[i], &g_cache_info, 
+        analyze_loop_characteristics(sorted_loops[i], &analyzer->cache_info, 
                                     &nest->characteristics[i]);
     }
     
     // Suggest optimizations
-    nest->optimization_flags = suggest_loop_optimizations(nest, &g_cache_info);
+    nest->optimization_flags = suggest_loop_optimizations(nest, &analyzer->cache_info);
     
     LOG_INFO("Loop nest analysis complete: depth=%d, optimizations=0x%x",
              nest->depth, nest->optimization_flags);
@@ -467,6 +467,18 @@ size_t estimate_working_set_size(const loop_info_t *loop) {
     return total_size;
 }
 
+// Throughput bound of one iteration from the static operation count: four
+// ALU ops and two memory ops issue per cycle, plus the loop branch
+double estimate_cycles_per_iteration(const loop_info_t *loop) {
+    if (!loop) return 0;
+    
+    double alu_cycles = (loop->body_op_count + 2) / 4.0;
+    double mem_cycles = loop->body_mem_ops / 2.0;
+    double cycles = alu_cycles > mem_cycles ? alu_cycles : mem_cycles;
+    
+    return cycles < 1.0 ? 1.0 : cycles;
+}
+
 int estimate_reuse_distance(const loop_info_t *loop) {
     if (!loop || loop->pattern_count == 0) return -1;
     
@@ -47,11 +47,15 @@ typedef struct {
     char rationale[512];
 } tiling_params_t;
 
+// Analyzer context bound to one cache hierarchy
+typedef struct loop_analyzer loop_analyzer_t;
+
 // API functions
-int loop_analyzer_init(const cache_info_t *cache_info);
-void loop_analyzer_cleanup(void);
+loop_analyzer_t* loop_analyzer_create(const cache_info_t *cache_info);
+void loop_analyzer_destroy(loop_analyzer_t *analyzer);
 
-int analyze_loop_nest(const loop_info_t *loops, int loop_count, loop_nest_t *nest);
+int analyze_loop_nest(const loop_analyzer_t *analyzer, const loop_info_t *loops, int loop_count,
+                     loop_nest_t *nest);
 int analyze_loop_characteristics(const loop_info_t *loop, const cache_info_t *cache_info,
                                 loop_characteristics_t *characteristics);
 void free_loop_nest(loop_nest_t *nest);
@@ -66,6 +70,7 @@ bool can_fuse_loops(const loop_info_t *loop1, const loop_info_t *loop2);
 // Helper functions
 size_t estimate_working_set_size(const loop_info_t *loop);
 int estimate_reuse_distance(const loop_info_t *loop);
+double estimate_cycles_per_iteration(const loop_info_t *loop);
 void print_loop_analysis(const loop_nest_t *nest);
 
 #endif // LOOP_ANALYZER_H
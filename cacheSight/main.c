@@ -14,11 +14,22 @@
 #include "papi_sampler.h"
 #include "sample_collector.h"
 #include "address_resolver.h"
+#include "profile_exporter.h"
+#include "structured_export.h"
+#include "profile_diff.h"
+#include "microkernel.h"
 #include "pattern_classifier.h"
 #include "recommendation_engine.h"
 #include "evaluator.h"
+#include "bandwidth_benchmark.h"
 #include "config_parser.h"
 #include "report_generator.h"
+#include "source_transformer.h"
+#include "tile_autotuner.h"
+#include "arena.h"
+#include "stage_trace.h"
+#include "workload_generator.h"
+#include "task_graph.h"
 
 // Global state for signal handling
 static volatile bool g_stop_requested = false;
@@ -47,7 +58,7 @@ static void print_usage(const char *prog_name) {
     printf("  -o, --output FILE       Output report file (default: report.html)\n");
     printf("  -c, --config FILE       Configuration file\n");
     printf("  -j, --json              Output JSON format\n");
-    printf("  -m, --mode MODE         Analysis mode: static, dynamic, full (default: full)\n");
+    printf("  -m, --mode MODE         Analysis mode: static, dynamic, full, diff (default: full)\n");
     printf("  -d, --duration SEC      Dynamic sampling duration (default: 10.0)\n");
     printf("  -s, --samples NUM       Maximum samples to collect (default: 100000)\n");
     printf("  -t, --threshold PCT     Hotspot threshold percentage (default: 1.0)\n");
@@ -56,12 +67,25 @@ static void print_usage(const char *prog_name) {
     printf("  --std STANDARD          C standard (default: c11)\n");
     printf("  --no-recommendations    Skip generating recommendations\n");
     printf("  --auto-apply            Automatically apply safe optimizations\n");
-    printf("  --benchmark             Run before/after benchmarks\n");
+    printf("  --in-place              With --auto-apply, rewrite verified sources (keeps .orig backups)\n");
+    printf("  --diff FILE             With --auto-apply, write the unified diff to FILE\n");
+    printf("  --benchmark             Time microkernels of the top recommendations\n");
+    printf("  --autotune-tiles        Time tiled variants of hot loop nests on this machine\n");
+    printf("  --export-profile BIN    Write a clang sample profile and hot/cold line map for BIN\n");
+    printf("  --autotune-flags        Time compiler flag sets per source file, export per-object CFLAGS\n");
+    printf("  --flags-makefile FILE   With --autotune-flags, write the CFLAGS to FILE (default: cachesight_flags.mk)\n");
+    printf("  --source-root DIR       Object targets in the CFLAGS file are relative to DIR (default: .)\n");
+    printf("  --export FILE           Write hotspots, patterns and recommendations as structured JSON\n");
+    printf("  --ndjson                With --export, write one JSON record per line\n");
+    printf("  --trace FILE            Write a Chrome trace of the tool's own stages to FILE\n");
+    printf("  --replay FILE           Analyze a recorded sample stream (NDJSON) instead of sampling\n");
+    printf("  --jobs N                Pipeline worker threads (default: one per CPU; 1 = no overlap)\n");
     printf("\nExamples:\n");
     printf("  %s matrix_multiply.c\n", prog_name);
     printf("  %s -m static -I./include src/*.c\n", prog_name);
     printf("  %s -m dynamic -d 30 ./my_program\n", prog_name);
     printf("  %s --config optimized.conf src/main.c\n", prog_name);
+    printf("  %s -m diff base.ndjson current.ndjson\n", prog_name);
 }
 
 // Analysis configuration
@@ -69,13 +93,25 @@ typedef struct {
     char log_file[256];
     char output_file[256];
     char config_file[256];
-    char mode[32];  // static, dynamic, full
+    char mode[32];  // static, dynamic, full, diff
     bool verbose;
     bool quiet;
     bool json_output;
     bool no_recommendations;
     bool auto_apply;
+    bool in_place;
+    char diff_file[256];
     bool benchmark;
+    bool autotune_tiles;
+    bool autotune_flags;
+    char flags_makefile[256];
+    char source_root[256];
+    char profile_binary[256];
+    char export_file[256];
+    bool export_ndjson;
+    char trace_file[256];
+    char replay_file[256];
+    int jobs;
     double sampling_duration;
     int max_samples;
     double hotspot_threshold;
@@ -88,16 +124,12 @@ typedef struct {
     char c_standard[16];
 } analysis_config_t;
 
-// Run static analysis
-static int run_static_analysis(const analysis_config_t *config,
-                              analysis_results_t *results) {
-    LOG_INFO("Starting static analysis on %d files", config->num_source_files);
-    
-    // Create AST analyzer
+// Analyzer configured with the run's include paths, defines and standard
+static ast_analyzer_t* create_static_analyzer(const analysis_config_t *config) {
     ast_analyzer_t *analyzer = ast_analyzer_create();
     if (!analyzer) {
         LOG_ERROR("Failed to create AST analyzer");
-        return -1;
+        return NULL;
     }
     
     // Add include paths
@@ -112,14 +144,41 @@ static int run_static_analysis(const analysis_config_t *config,
     
     // Set C standard
     ast_analyzer_set_std(analyzer, config->c_standard);
+    return analyzer;
+}
+
+static void dump_static_patterns(const analysis_results_t *results) {
+    LOG_DEBUG("=== DUMPING ALL STATIC PATTERNS ===");
+    for (int i = 0; i < results->pattern_count; i++) {
+        static_pattern_t *p = &results->patterns[i];
+        LOG_DEBUG("Pattern %d: %s:%d - %s (array: %s, var: %s, stride: %d, pointer: %s)",
+                i, p->location.file, p->location.line,
+                access_pattern_to_string(p->pattern),
+                p->array_name, p->variable_name, p->stride,
+                p->is_pointer_access ? "YES" : "NO");
+    }
+    LOG_DEBUG("=== END PATTERN DUMP ===\n");
+}
+
+// Run static analysis
+static int run_static_analysis(const analysis_config_t *config,
+                              analysis_results_t *results) {
+    TRACE_SCOPE(trace, "static_analysis");
+    trace_add_items(&trace, config->num_source_files);
+    
+    LOG_INFO("Starting static analysis on %d files", config->num_source_files);
+    
+    // Create AST analyzer
+    ast_analyzer_t *analyzer = create_static_analyzer(config);
+    if (!analyzer) {
+        return -1;
+    }
     
     // Analyze files
     int ret = ast_analyzer_analyze_files(analyzer, 
                                         (const char**)config->source_files,
                                         config->num_source_files,
                                         results);
-
-                                        
     
     if (ret != 0) {
         LOG_ERROR("Static analysis failed");
@@ -127,32 +186,25 @@ static int run_static_analysis(const analysis_config_t *config,
         LOG_INFO("Static analysis complete: %d patterns, %d loops, %d structs",
                  results->pattern_count, results->loop_count, results->struct_count);
     }
-
-    // After ast_analyzer_analyze_file returns
-    LOG_INFO("Static analysis complete: %d patterns, %d loops, %d structs", 
-            results->pattern_count, results->loop_count, results->struct_count);
-
-    // ADD THIS DETAILED PATTERN DUMP:
-    // ADD THIS DETAILED PATTERN DUMP:
-    LOG_DEBUG("=== DUMPING ALL STATIC PATTERNS ===");
-    for (int i = 0; i < results->pattern_count; i++) {
-        static_pattern_t *p = &results->patterns[i];
-        LOG_DEBUG("Pattern %d: %s:%d - %s (array: %s, var: %s, stride: %d, pointer: %s)",
-                i, p->location.file, p->location.line,
-                access_pattern_to_string(p->pattern),
-                p->array_name, p->variable_name, p->stride,
-                p->is_pointer_access ? "YES" : "NO");
-    }
-    LOG_DEBUG("=== END PATTERN DUMP ===\n");
+    dump_static_patterns(results);
     
     ast_analyzer_destroy(analyzer);
     return ret;
 }
 
+// The process of --export-profile's binary, as the sampler saw it
+typedef struct {
+    pid_t pid;                      // 0 = none sampled
+    memory_mapping_t *mappings;     // Captured while it ran, for its load address
+    int mapping_count;
+} profiled_process_t;
+
 // Run dynamic profiling
 static int run_dynamic_profiling(const analysis_config_t *config,
                                 cache_miss_sample_t **samples,
-                                int *sample_count) {
+                                int *sample_count, profiled_process_t *target) {
+    TRACE_SCOPE(trace, "dynamic_profiling");
+    
     LOG_INFO("Starting dynamic profiling for %.1f seconds", config->sampling_duration);
     
     // Check permissions
@@ -165,6 +217,7 @@ static int run_dynamic_profiling(const analysis_config_t *config,
     perf_config_t perf_config = perf_config_default();
     perf_config.max_samples = config->max_samples;
     perf_config.sampling_duration = config->sampling_duration;
+    strncpy(perf_config.target_binary, config->profile_binary, sizeof(perf_config.target_binary) - 1);
     
     g_perf_sampler = perf_sampler_create(&perf_config);
     if (!g_perf_sampler) {
@@ -198,15 +251,24 @@ static int run_dynamic_profiling(const analysis_config_t *config,
     // Stop sampling
     perf_sampler_stop(g_perf_sampler);
     
-    // Get samples
-    int ret = perf_sampler_get_samples(g_perf_sampler, samples, sample_count);
-    
-    // Get statistics
+    // Get statistics while the sampler still holds the samples
     perf_stats_t stats;
     if (perf_sampler_get_stats(g_perf_sampler, &stats) == 0) {
         perf_print_stats(&stats);
     }
     
+    // The sampler is destroyed next, so take its buffer instead of a copy
+    int ret = perf_sampler_take_samples(g_perf_sampler, samples, sample_count);
+    trace_add_items(&trace, *sample_count);
+    
+    if (config->profile_binary[0] && ret == 0) {
+        ret = perf_sampler_get_target(g_perf_sampler, &target->pid,
+                                      &target->mappings, &target->mapping_count);
+        if (ret == 0 && target->pid == 0) {
+            LOG_WARNING("No process running %s was sampled", config->profile_binary);
+        }
+    }
+    
     perf_sampler_destroy(g_perf_sampler);
     g_perf_sampler = NULL;
     
@@ -215,6 +277,298 @@ static int run_dynamic_profiling(const analysis_config_t *config,
 }
 
 
+// Offline mode: samples come from a stream file, such as a synthetic
+// workload's ground truth, instead of a perf session
+static int run_replay(const analysis_config_t *config,
+                      cache_miss_sample_t **samples,
+                      int *sample_count) {
+    TRACE_SCOPE(trace, "replay");
+    
+    workload_spec_t spec;
+    if (workload_load_stream(config->replay_file, &spec, samples, sample_count) != 0) {
+        LOG_ERROR("Failed to load samples from %s", config->replay_file);
+        return -1;
+    }
+    trace_add_items(&trace, *sample_count);
+    
+    if (spec.name[0]) {
+        printf("Replaying workload %s: %d samples, ground truth %s\n", spec.name, *sample_count,
+               spec.kind == WORKLOAD_ACCESS_PATTERN ? access_pattern_to_string(spec.access) :
+                                                      cache_antipattern_to_string(spec.antipattern));
+    }
+    return 0;
+}
+
+static int compare_addresses(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Resolver for the profiled binary, placed where its process had it mapped
+static address_resolver_t* create_profile_resolver(const char *binary,
+                                                   const profiled_process_t *target) {
+    address_resolver_t *resolver = address_resolver_create(target->pid);
+    if (!resolver) return NULL;
+    
+    if ((target->mapping_count > 0 &&
+         address_resolver_set_mappings(resolver, target->mappings, target->mapping_count) != 0) ||
+        address_resolver_init_binary(resolver, binary) != 0 ||
+        address_resolver_load_symbols(resolver) <= 0) {
+        LOG_ERROR("Cannot resolve samples against %s", binary);
+        address_resolver_destroy(resolver);
+        return NULL;
+    }
+    return resolver;
+}
+
+// Attribute sampled IPs to source lines of the profiled binary, so hotspots
+// carry the locations correlation matches static patterns on. Samples that
+// already have a line, such as replayed ones, are left alone.
+static int symbolize_samples(const analysis_config_t *config, const profiled_process_t *target,
+                             cache_miss_sample_t *samples, int sample_count) {
+    TRACE_SCOPE(trace, "symbolization");
+    trace_add_items(&trace, sample_count);
+    
+    uint64_t *addresses = MALLOC_LOGGED(sample_count * sizeof(uint64_t));
+    if (!addresses) return -1;
+    
+    int unique_count = 0;
+    for (int i = 0; i < sample_count; i++) {
+        if (samples[i].source_loc.line == 0) addresses[unique_count++] = samples[i].instruction_addr;
+    }
+    qsort(addresses, unique_count, sizeof(uint64_t), compare_addresses);
+    int n = 0;
+    for (int i = 0; i < unique_count; i++) {
+        if (n == 0 || addresses[n - 1] != addresses[i]) addresses[n++] = addresses[i];
+    }
+    unique_count = n;
+    
+    int ret = 0;
+    address_resolver_t *resolver = NULL;
+    source_location_t *locations = NULL;
+    if (unique_count == 0) goto done;
+    
+    // Without the load address the lines would belong to the wrong code,
+    // so samples are left unsymbolized rather than misattributed
+    resolver = create_profile_resolver(config->profile_binary, target);
+    locations = MALLOC_LOGGED(unique_count * sizeof(source_location_t));
+    if (!resolver || !locations) {
+        LOG_ERROR("Cannot symbolize samples against %s", config->profile_binary);
+        ret = -1;
+        goto done;
+    }
+    
+    int resolved = address_resolver_resolve_lines(resolver, addresses, unique_count, locations);
+    if (resolved < 0) {
+        ret = -1;
+        goto done;
+    }
+    for (int i = 0; i < sample_count; i++) {
+        if (samples[i].source_loc.line != 0) continue;
+        
+        const uint64_t *hit = bsearch(&samples[i].instruction_addr, addresses, unique_count,
+                                      sizeof(uint64_t), compare_addresses);
+        if (hit && locations[hit - addresses].line > 0) {
+            samples[i].source_loc = locations[hit - addresses];
+        }
+    }
+    LOG_INFO("Symbolized %d of %d sampled IPs", resolved, unique_count);
+    
+done:
+    if (locations) FREE_LOGGED(locations);
+    address_resolver_destroy(resolver);
+    FREE_LOGGED(addresses);
+    return ret;
+}
+
+// State shared by the tasks of run_analysis. Each output is written by one
+// task and read only by tasks that depend on it.
+typedef struct {
+    const analysis_config_t *config;
+    const cache_info_t *cache_info;
+    
+    // Static analysis: one result per source file, merged once all are in
+    ast_analyzer_t *analyzer;
+    analysis_results_t *file_results;
+    int *file_status;
+    analysis_results_t *static_results;
+    
+    cache_miss_sample_t **samples;
+    int *sample_count;
+    profiled_process_t *target;
+    cache_hotspot_t **hotspots;
+    int *hotspot_count;
+    pattern_classifier_t *classifier;
+    classified_pattern_t **patterns;
+    int *pattern_count;
+} pipeline_t;
+
+// One source file of the static stage
+typedef struct {
+    pipeline_t *pipeline;
+    int index;
+} file_task_t;
+
+static int static_file_task(void *arg) {
+    const file_task_t *task = (const file_task_t *)arg;
+    pipeline_t *pipeline = task->pipeline;
+    TRACE_SCOPE(trace, "static_analysis.file");
+    trace_add_items(&trace, 1);
+    
+    pipeline->file_status[task->index] =
+        ast_analyzer_analyze_file(pipeline->analyzer, pipeline->config->source_files[task->index],
+                                  &pipeline->file_results[task->index]);
+    return pipeline->file_status[task->index];
+}
+
+// Files that failed to parse are left out, as ast_analyzer_analyze_files does
+static int static_merge_task(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *)arg;
+    TRACE_SCOPE(trace, "static_analysis.merge");
+    int file_count = pipeline->config->num_source_files;
+    trace_add_items(&trace, file_count);
+    
+    analysis_results_t *parsed = MALLOC_LOGGED(file_count * sizeof(analysis_results_t));
+    int parsed_count = 0;
+    for (int i = 0; parsed && i < file_count; i++) {
+        if (pipeline->file_status[i] == 0) parsed[parsed_count++] = pipeline->file_results[i];
+    }
+    
+    int ret = parsed ? ast_analyzer_merge_results(parsed, parsed_count, pipeline->static_results) : -1;
+    for (int i = 0; i < file_count; i++) {
+        ast_analyzer_free_results(&pipeline->file_results[i]);
+    }
+    if (parsed) FREE_LOGGED(parsed);
+    
+    if (ret != 0) {
+        LOG_ERROR("Static analysis failed");
+        return -1;
+    }
+    
+    const analysis_results_t *results = pipeline->static_results;
+    LOG_INFO("Static analysis complete: %d of %d files, %d patterns, %d loops, %d structs",
+             parsed_count, file_count, results->pattern_count, results->loop_count,
+             results->struct_count);
+    dump_static_patterns(results);
+    return 0;
+}
+
+static int sampling_task(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *)arg;
+    const analysis_config_t *config = pipeline->config;
+    
+    return config->replay_file[0] ?
+        run_replay(config, pipeline->samples, pipeline->sample_count) :
+        run_dynamic_profiling(config, pipeline->samples, pipeline->sample_count, pipeline->target);
+}
+
+static int symbolization_task(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *)arg;
+    if (*pipeline->sample_count == 0) return 0;
+    
+    return symbolize_samples(pipeline->config, pipeline->target,
+                             *pipeline->samples, *pipeline->sample_count);
+}
+
+// Feed the sampled IPs of the profiled binary back to the compiler
+static int profile_export_task(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *)arg;
+    if (*pipeline->sample_count == 0) return 0;
+    TRACE_SCOPE(trace, "profile_export");
+    
+    // The sampler kept only the target process's samples
+    int ret = -1;
+    address_resolver_t *resolver = create_profile_resolver(pipeline->config->profile_binary,
+                                                           pipeline->target);
+    if (resolver) {
+        profile_export_config_t export_config = profile_export_config_default();
+        profile_export_summary_t export_summary;
+        ret = profile_export_samples(resolver, *pipeline->samples, *pipeline->sample_count,
+                                     &export_config, &export_summary);
+        if (ret == 0) {
+            profile_export_print_summary(&export_summary);
+        }
+    }
+    address_resolver_destroy(resolver);
+    return ret;
+}
+
+// Process samples into hotspots
+static int aggregation_task(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *)arg;
+    int sample_count = *pipeline->sample_count;
+    if (sample_count == 0) return 0;
+    
+    TRACE_SCOPE(trace, "aggregation");
+    trace_add_items(&trace, sample_count);
+    LOG_INFO("Processing samples into hotspots");
+    
+    // Hotspot entries die with the aggregation phase; the hotspots and their
+    // samples are taken out of the collector before it goes
+    arena_group_t *aggregation = arena_group_create("aggregation", 0);
+    
+    // Create sample collector
+    collector_config_t collector_config = collector_config_default();
+    collector_config.hotspot_threshold = pipeline->config->hotspot_threshold / 100.0;
+    collector_config.arena = arena_group_local(aggregation);
+    
+    int ret = -1;
+    sample_collector_t *collector = sample_collector_create(&collector_config, pipeline->cache_info);
+    if (collector) {
+        // Samples stay in the pipeline's buffer, which outlives the collector
+        sample_collector_attach_samples(collector, *pipeline->samples, sample_count);
+        
+        // Process into hotspots
+        sample_collector_process(collector);
+        
+        // Get hotspots
+        ret = sample_collector_take_hotspots(collector, pipeline->hotspots, pipeline->hotspot_count);
+        
+        // Print hotspots
+        sample_collector_print_hotspots(*pipeline->hotspots, *pipeline->hotspot_count);
+        
+        sample_collector_destroy(collector);
+    }
+    arena_group_destroy(aggregation);
+    return ret;
+}
+
+// Pattern classification
+static int classification_task(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *)arg;
+    int hotspot_count = *pipeline->hotspot_count;
+    if (hotspot_count == 0) return 0;
+    
+    TRACE_SCOPE(trace, "classification");
+    trace_add_items(&trace, hotspot_count);
+    LOG_INFO("Classifying cache patterns");
+    
+    classifier_config_t classifier_config = classifier_config_default();
+    pipeline->classifier = pattern_classifier_create(&classifier_config, pipeline->cache_info);
+    if (!pipeline->classifier) return -1;
+    
+    return pattern_classifier_classify_all(pipeline->classifier, *pipeline->hotspots, hotspot_count,
+                                           pipeline->patterns, pipeline->pattern_count);
+}
+
+// Starts once both the classified hotspots and the static patterns exist
+static int correlation_task(void *arg) {
+    pipeline_t *pipeline = (pipeline_t *)arg;
+    if (!pipeline->classifier || *pipeline->pattern_count == 0) return 0;
+    
+    int ret = 0;
+    if (pipeline->static_results->pattern_count > 0) {
+        TRACE_SCOPE(trace, "correlation");
+        trace_add_items(&trace, *pipeline->pattern_count);
+        ret = pattern_classifier_correlate_static(pipeline->classifier, pipeline->static_results,
+                                                  *pipeline->patterns, *pipeline->pattern_count);
+    }
+    
+    pattern_classifier_print_results(*pipeline->patterns, *pipeline->pattern_count);
+    return ret;
+}
+
 /*
 // Helper functions for pattern classification
 static miss_type_t classify_miss_type(cache_hotspot_t *hotspot, cache_info_t *cache_info) {
@@ -265,108 +619,512 @@ static void generate_pattern_description(classified_pattern_t *pattern) {
 
 */
 
+// Struct reordering queued for --auto-apply, kept to verify the rewritten layout
+typedef struct {
+    char struct_name[128];
+    char field_names[32][64];
+    field_affinity_t affinity;
+    double lines_before;
+} applied_reorder_t;
+
+// Loop body cost per hotspot for the prefetch distance model: measured from
+// sample timestamps when possible, else from the enclosing loop's op counts
+static void estimate_hotspot_costs(cache_hotspot_t *hotspots, int hotspot_count,
+                                   const analysis_results_t *static_results,
+                                   const cache_info_t *cache_info) {
+    for (int i = 0; i < hotspot_count; i++) {
+        cache_hotspot_t *hs = &hotspots[i];
+        hs->cycles_per_iteration = estimate_hotspot_cycles_per_iteration(hs, cache_info->cpu_frequency_ghz);
+        if (hs->cycles_per_iteration > 0) continue;
+        
+        const loop_info_t *enclosing = NULL;
+        for (int l = 0; l < static_results->loop_count; l++) {
+            const loop_info_t *loop = &static_results->loops[l];
+            if (strcmp(loop->location.file, hs->location.file) != 0 ||
+                loop->location.line > hs->location.line) continue;
+            if (!enclosing || loop->location.line > enclosing->location.line) enclosing = loop;
+        }
+        if (enclosing) {
+            hs->cycles_per_iteration = estimate_cycles_per_iteration(enclosing);
+        }
+    }
+}
+
+static int count_strided_patterns(const analysis_results_t *results) {
+    int count = 0;
+    for (int i = 0; i < results->pattern_count; i++) {
+        if (results->patterns[i].pattern == STRIDED) count++;
+    }
+    return count;
+}
+
+// Queue source rewrites for the recommendations marked automatic
+static void queue_recommendation_transforms(source_transformer_t *transformer,
+                                            const optimization_rec_t *recs, int rec_count,
+                                            const cache_info_t *cache_info) {
+    for (int i = 0; i < rec_count; i++) {
+        const optimization_rec_t *rec = &recs[i];
+        if (!rec->is_automatic || !rec->pattern || !rec->pattern->hotspot) continue;
+        
+        const cache_hotspot_t *hotspot = rec->pattern->hotspot;
+        transform_request_t request;
+        memset(&request, 0, sizeof(request));
+        request.location = hotspot->location;
+        
+        switch (rec->type) {
+            case OPT_PREFETCH_HINTS:
+                request.kind = TRANSFORM_PREFETCH;
+                request.prefetch_locality = rec->prefetch_locality;
+                request.prefetch_distance = rec->prefetch_distance;
+                break;
+            case OPT_ACCESS_REORDER:
+                request.kind = TRANSFORM_LOOP_INTERCHANGE;
+                break;
+            case OPT_NONTEMPORAL_STORES:
+                request.kind = TRANSFORM_NONTEMPORAL_STORE;
+                break;
+            case OPT_MEMORY_ALIGNMENT:
+                request.kind = TRANSFORM_ALIGNMENT;
+                request.alignment = (int)cache_info->levels[0].line_size;
+                break;
+            default:
+                continue;
+        }
+        
+        source_transformer_add_request(transformer, &request);
+    }
+}
+
+// Re-run static analysis on the transformed copies and compare with the
+// original; fails when the copies do not analyse or add strided patterns
+static int verify_transformations(const analysis_config_t *config,
+                                   const source_transformer_t *transformer,
+                                   const analysis_results_t *before,
+                                   const data_layout_analyzer_t *layout_analyzer,
+                                   const applied_reorder_t *reorders, int reorder_count) {
+    char **transformed = CALLOC_LOGGED(config->num_source_files, sizeof(char*));
+    if (!transformed) return -1;
+    
+    int transformed_count = 0;
+    for (int i = 0; i < config->num_source_files; i++) {
+        const char *path = source_transformer_output_path(transformer, i);
+        if (path) transformed[transformed_count++] = (char*)path;
+    }
+    
+    analysis_config_t verify_config = *config;
+    verify_config.source_files = transformed;
+    verify_config.num_source_files = transformed_count;
+    
+    analysis_results_t after = {0};
+    if (transformed_count == 0 || run_static_analysis(&verify_config, &after) != 0) {
+        LOG_WARNING("Could not re-analyse transformed sources");
+        FREE_LOGGED(transformed);
+        return -1;
+    }
+    
+    int strided_before = count_strided_patterns(before);
+    int strided_after = count_strided_patterns(&after);
+    printf("\n=== Transformation Verification ===\n");
+    printf("  Strided access patterns: %d -> %d\n", strided_before, strided_after);
+    
+    const transform_request_t *requests = NULL;
+    int request_count = 0;
+    source_transformer_get_requests(transformer, &requests, &request_count);
+    
+    for (int r = 0; r < reorder_count; r++) {
+        bool applied = false;
+        for (int q = 0; q < request_count; q++) {
+            if (requests[q].kind == TRANSFORM_FIELD_REORDER && requests[q].applied &&
+                strcmp(requests[q].struct_name, reorders[r].struct_name) == 0) {
+                applied = true;
+            }
+        }
+        if (!applied) continue;
+        
+        for (int s = 0; s < after.struct_count; s++) {
+            const struct_info_t *info = &after.structs[s];
+            if (strcmp(info->struct_name, reorders[r].struct_name) != 0) continue;
+            
+            // Affinity was built against the declared order; remap it by field name
+            int map[32];
+            for (int f = 0; f < info->field_count; f++) {
+                map[f] = f;
+                for (int g = 0; g < reorders[r].affinity.field_count; g++) {
+                    if (strcmp(info->field_names[f], reorders[r].field_names[g]) == 0) map[f] = g;
+                }
+            }
+            
+            field_affinity_t remapped;
+            memset(&remapped, 0, sizeof(remapped));
+            remapped.field_count = info->field_count;
+            remapped.total_weight = reorders[r].affinity.total_weight;
+            for (int f = 0; f < info->field_count; f++) {
+                remapped.field_heat[f] = reorders[r].affinity.field_heat[map[f]];
+                for (int g = 0; g < info->field_count; g++) {
+                    remapped.weights[f][g] = reorders[r].affinity.weights[map[f]][map[g]];
+                }
+            }
+            
+            printf("  struct %s: %.2f -> %.2f cache lines per access group\n",
+                   info->struct_name, reorders[r].lines_before,
+                   estimate_lines_touched(layout_analyzer, info, &remapped, info->field_offsets, info->total_size));
+            break;
+        }
+    }
+    
+    ast_analyzer_free_results(&after);
+    FREE_LOGGED(transformed);
+    return strided_after <= strided_before ? 0 : -1;
+}
+
+// Compare two saved structured exports and rank what got worse
+static int run_diff(const analysis_config_t *config) {
+    if (config->num_source_files != 2) {
+        LOG_ERROR("Diff mode needs two saved analyses: base and current");
+        return -1;
+    }
+    
+    diff_config_t diff_config = diff_config_default();
+    profile_diff_t *diff = profile_diff_create(&diff_config);
+    if (!diff) {
+        return -1;
+    }
+    
+    int ret = profile_diff_compare(diff, config->source_files[0], config->source_files[1]);
+    if (ret == 0) {
+        profile_diff_print(diff);
+        
+        // The HTML report default makes no sense for a diff
+        const char *output = config->output_file;
+        if (strcmp(output, "report.html") == 0) {
+            output = config->json_output ? "profile_diff.json" : "profile_diff.txt";
+        }
+        ret = profile_diff_save(diff, output, config->json_output);
+    }
+    
+    profile_diff_destroy(diff);
+    return ret;
+}
+
 // Main analysis pipeline
 static int run_analysis(const analysis_config_t *config) {
+    // Stage scopes below sit inside blocks: the gotos must not jump into them
+    TRACE_SCOPE(run_trace, "run_analysis");
     int ret = 0;
     
     // Initialize subsystems
     LOG_INFO("Initializing cache optimizer subsystems");
     
     // Detect hardware
+    trace_scope_t hardware_trace = trace_begin("hardware_detection");
     cache_info_t cache_info;
     hardware_detector_init();
     if (detect_cache_hierarchy(&cache_info) != 0) {
         LOG_ERROR("Failed to detect cache hierarchy");
+        trace_end(&hardware_trace);
         return -1;
     }
     
+    // Records and text that live for the whole run
+    arena_t *run_arena = arena_create(0);
+    if (!run_arena) {
+        trace_end(&hardware_trace);
+        return -1;
+    }
+    
+    // DRAM latency drives prefetch distances
+    if (!config->no_recommendations) {
+        cache_info.memory_latency_ns = measure_memory_latency(&cache_info);
+    }
+    
     print_cache_info(&cache_info);
     
     // Save cache info
     save_cache_info_to_file(&cache_info, "cache_info.txt");
+    trace_end(&hardware_trace);
     
-    // Run static analysis if requested
+    // Pipeline outputs
     analysis_results_t static_results = {0};
-    if (strcmp(config->mode, "static") == 0 || strcmp(config->mode, "full") == 0) {
-        if (config->num_source_files > 0) {
-            ret = run_static_analysis(config, &static_results);
-            if (ret != 0 && strcmp(config->mode, "static") == 0) {
-                goto cleanup;
-            }
-            //ast_analyzer_print_results(&static_results); // SEGMENTATION FAULT WHEN UNCOMMENTED
-        } else {
-            LOG_WARNING("No source files provided for static analysis");
-        }
-    }
-    
-    // Run dynamic profiling if requested
     cache_miss_sample_t *samples = NULL;
     int sample_count = 0;
+    profiled_process_t target = {0};
+    cache_hotspot_t *hotspots = NULL;
+    int hotspot_count = 0;
+    classified_pattern_t *patterns = NULL;
+    int pattern_count = 0;
     
-    if (strcmp(config->mode, "dynamic") == 0 || strcmp(config->mode, "full") == 0) {
-        ret = run_dynamic_profiling(config, &samples, &sample_count);
-        if (ret != 0 && strcmp(config->mode, "dynamic") == 0) {
-            goto cleanup;
+    // Source rewriting for --auto-apply
+    source_transformer_t *transformer = NULL;
+    applied_reorder_t *reorders = NULL;
+    int reorder_count = 0;
+    data_layout_analyzer_t *layout_analyzer = NULL;
+    
+    // Measured tile sizes for --autotune-tiles
+    autotune_result_t *tuned_nests = NULL;
+    int tuned_count = 0;
+    
+    // Measured flag sets for --autotune-flags
+    flag_tune_result_t *tuned_files = NULL;
+    int tuned_file_count = 0;
+    if (config->auto_apply && config->num_source_files > 0) {
+        transformer_config_t transformer_config = transformer_config_default();
+        transformer_config.in_place = config->in_place;
+        strncpy(transformer_config.diff_file, config->diff_file,
+                sizeof(transformer_config.diff_file) - 1);
+        transformer = source_transformer_create(&transformer_config);
+        
+        for (int i = 0; transformer && i < config->num_include_paths; i++) {
+            source_transformer_add_include_path(transformer, config->include_paths[i]);
+        }
+        for (int i = 0; transformer && i < config->num_defines; i++) {
+            source_transformer_add_define(transformer, config->defines[i]);
+        }
+        if (transformer) {
+            source_transformer_set_std(transformer, config->c_standard);
         }
     }
     
-    // Process samples into hotspots
-    cache_hotspot_t *hotspots = NULL;
-    int hotspot_count = 0;
+    bool want_static = strcmp(config->mode, "static") == 0 || strcmp(config->mode, "full") == 0;
+    bool want_dynamic = strcmp(config->mode, "dynamic") == 0 || strcmp(config->mode, "full") == 0;
+    if (want_static && config->num_source_files == 0) {
+        LOG_WARNING("No source files provided for static analysis");
+        want_static = false;
+    }
     
-    if (sample_count > 0) {
-        LOG_INFO("Processing samples into hotspots");
-        
-        // Create sample collector
-        collector_config_t collector_config = collector_config_default();
-        collector_config.hotspot_threshold = config->hotspot_threshold / 100.0;
+    // Static parsing and profiling overlap: source files are parsed on the
+    // pipeline's workers while the sampler runs, and symbolization,
+    // aggregation and classification follow the samples. Correlation waits
+    // for both sides. The sampler drops the tool's own pid, so the parsing
+    // never shows up in the profile.
+    // Dependents run even when a prerequisite fails, so each task checks its
+    // inputs: the merge skips unparsed files, aggregation takes unsymbolized
+    // samples as they are, and later stages return on empty outputs.
+    pipeline_t pipeline = {
+        .config = config,
+        .cache_info = &cache_info,
+        .static_results = &static_results,
+        .samples = &samples,
+        .sample_count = &sample_count,
+        .target = &target,
+        .hotspots = &hotspots,
+        .hotspot_count = &hotspot_count,
+        .patterns = &patterns,
+        .pattern_count = &pattern_count
+    };
+    file_task_t *file_tasks = NULL;
+    int static_task = -1;
+    int sampling = -1;
+    int correlation = -1;
+    
+    task_graph_t *graph = task_graph_create(config->jobs);
+    if (!graph) {
+        ret = -1;
+        goto cleanup;
+    }
+    
+    // Sampling is added first so a worker picks it up before any parsing
+    if (want_dynamic) {
+        sampling = task_graph_add(graph, "sampling", sampling_task, &pipeline);
+        int samples_ready = sampling;
         
-        sample_collector_t *collector = sample_collector_create(&collector_config, &cache_info);
-        if (collector) {
-            // Add samples
-            sample_collector_add_samples(collector, samples, sample_count);
-            
-            // Process into hotspots
-            sample_collector_process(collector);
-            
-            // Get hotspots
-            sample_collector_get_hotspots(collector, &hotspots, &hotspot_count);
+        if (config->profile_binary[0]) {
+            int export = task_graph_add(graph, "profile_export", profile_export_task, &pipeline);
+            task_graph_depend(graph, export, sampling);
             
-            // Print hotspots
-            sample_collector_print_hotspots(hotspots, hotspot_count);
-            
-            sample_collector_destroy(collector);
+            samples_ready = task_graph_add(graph, "symbolization", symbolization_task, &pipeline);
+            task_graph_depend(graph, samples_ready, sampling);
         }
+        
+        int aggregation = task_graph_add(graph, "aggregation", aggregation_task, &pipeline);
+        task_graph_depend(graph, aggregation, samples_ready);
+        int classification = task_graph_add(graph, "classification", classification_task, &pipeline);
+        task_graph_depend(graph, classification, aggregation);
+        
+        correlation = task_graph_add(graph, "correlation", correlation_task, &pipeline);
+        task_graph_depend(graph, correlation, classification);
     }
     
-    // Pattern classification
-    classified_pattern_t *patterns = NULL;
-    int pattern_count = 0;
+    if (want_static) {
+        LOG_INFO("Starting static analysis on %d files", config->num_source_files);
+        pipeline.analyzer = create_static_analyzer(config);
+        pipeline.file_results = CALLOC_LOGGED(config->num_source_files, sizeof(analysis_results_t));
+        pipeline.file_status = CALLOC_LOGGED(config->num_source_files, sizeof(int));
+        file_tasks = CALLOC_LOGGED(config->num_source_files, sizeof(file_task_t));
+        
+        if (pipeline.analyzer && pipeline.file_results && pipeline.file_status && file_tasks) {
+            static_task = task_graph_add(graph, "static_analysis.merge", static_merge_task, &pipeline);
+            for (int i = 0; i < config->num_source_files; i++) {
+                file_tasks[i].pipeline = &pipeline;
+                file_tasks[i].index = i;
+                int file = task_graph_add(graph, "static_analysis.file", static_file_task, &file_tasks[i]);
+                task_graph_depend(graph, static_task, file);
+            }
+            if (correlation >= 0) {
+                task_graph_depend(graph, correlation, static_task);
+            }
+        }
+    }
     
-    if (hotspot_count > 0) {
-        LOG_INFO("Classifying cache patterns");
+    task_graph_run(graph);
+    
+    int static_ret = static_task >= 0 ? task_graph_result(graph, static_task) : -1;
+    int sampling_ret = sampling >= 0 ? task_graph_result(graph, sampling) : 0;
+    task_graph_destroy(graph);
+    pattern_classifier_destroy(pipeline.classifier);
+    ast_analyzer_destroy(pipeline.analyzer);
+    if (pipeline.file_results) FREE_LOGGED(pipeline.file_results);
+    if (pipeline.file_status) FREE_LOGGED(pipeline.file_status);
+    if (file_tasks) FREE_LOGGED(file_tasks);
+    
+    if (want_static && static_ret != 0 && strcmp(config->mode, "static") == 0) {
+        ret = -1;
+        goto cleanup;
+    }
+    if (sampling_ret != 0 && strcmp(config->mode, "dynamic") == 0) {
+        ret = -1;
+        goto cleanup;
+    }
+    
+    // Struct layout analysis: sampled field offsets drive hot/cold splitting and
+    // field affinity when available, static co-access in loops otherwise
+    if (static_results.struct_count > 0) {
+        TRACE_SCOPE(trace, "layout_analysis");
+        trace_add_items(&trace, static_results.struct_count);
+        object_range_t *ranges = NULL;
+        int range_count = 0;
         
-        classifier_config_t classifier_config = classifier_config_default();
-        pattern_classifier_t *classifier = pattern_classifier_create(&classifier_config, &cache_info);
+        // Simulator used to validate AoSoA candidates
+        evaluator_config_t layout_eval_config = evaluator_config_default();
+        layout_eval_config.enable_simulation = true;
+        evaluator_t *layout_evaluator = evaluator_create(&layout_eval_config, &cache_info);
         
-        if (classifier) {
-            pattern_classifier_classify_all(classifier, hotspots, hotspot_count,
-                                          &patterns, &pattern_count);
+        layout_analyzer = data_layout_analyzer_create(&cache_info);
+        if (layout_analyzer && sample_count > 0) {
+            infer_object_ranges(&static_results, samples, sample_count, &ranges, &range_count);
+        }
+        
+        for (int i = 0; layout_analyzer && i < static_results.struct_count; i++) {
+            const struct_info_t *info = &static_results.structs[i];
+            field_affinity_t affinity;
+            bool have_affinity = false;
             
-            if (static_results.pattern_count > 0) {
-                pattern_classifier_correlate_static(classifier, &static_results,
-                                                  patterns, pattern_count);
+            if (range_count > 0) {
+                struct_layout_analysis_t layout;
+                if (analyze_struct_layout_dynamic(layout_analyzer, info, ranges, range_count,
+                                                  samples, sample_count, &layout) == 0) {
+                    print_layout_analysis(&layout);
+                    
+                    // Sampled false sharing: give each instance its own cache line
+                    if (transformer && layout.has_false_sharing) {
+                        transform_request_t request;
+                        memset(&request, 0, sizeof(request));
+                        request.kind = TRANSFORM_ALIGNMENT;
+                        request.location = info->location;
+                        strncpy(request.struct_name, info->struct_name,
+                                sizeof(request.struct_name) - 1);
+                        request.alignment = (int)cache_info.levels[0].line_size;
+                        source_transformer_add_request(transformer, &request);
+                    }
+                    free_layout_analysis(&layout);
+                }
+                
+                have_affinity = build_field_affinity_dynamic(info, ranges, range_count,
+                                                             samples, sample_count,
+                                                             10000, &affinity) == 0 &&
+                                affinity.total_weight > 0;
             }
             
-            pattern_classifier_print_results(patterns, pattern_count);
+            if (!have_affinity) {
+                have_affinity = build_field_affinity_static(info, static_results.patterns,
+                                                            static_results.pattern_count,
+                                                            &affinity) == 0 &&
+                                affinity.total_weight > 0;
+            }
             
-            pattern_classifier_destroy(classifier);
+            field_reorder_t reorder;
+            if (have_affinity && optimize_field_order(layout_analyzer, info, &affinity, &reorder) == 0 &&
+                reorder.lines_after < reorder.lines_before) {
+                print_field_reorder(info, &reorder);
+                
+                applied_reorder_t *grown = transformer ?
+                    realloc(reorders, (reorder_count + 1) * sizeof(applied_reorder_t)) : NULL;
+                if (grown) {
+                    reorders = grown;
+                    applied_reorder_t *entry = &reorders[reorder_count++];
+                    strncpy(entry->struct_name, info->struct_name, sizeof(entry->struct_name) - 1);
+                    entry->struct_name[sizeof(entry->struct_name) - 1] = '\0';
+                    memcpy(entry->field_names, info->field_names, sizeof(entry->field_names));
+                    entry->affinity = affinity;
+                    entry->lines_before = reorder.lines_before;
+                    
+                    transform_request_t request;
+                    memset(&request, 0, sizeof(request));
+                    request.kind = TRANSFORM_FIELD_REORDER;
+                    request.location = info->location;
+                    strncpy(request.struct_name, info->struct_name,
+                            sizeof(request.struct_name) - 1);
+                    memcpy(request.field_order, reorder.order, sizeof(request.field_order));
+                    request.field_count = reorder.field_count;
+                    source_transformer_add_request(transformer, &request);
+                }
+            }
+            
+            // AoSoA keeps whole-element locality while SIMD loads on the hottest field
+            // stay contiguous; only offer it when the simulator agrees
+            int hottest = 0;
+            for (int f = 1; have_affinity && f < info->field_count; f++) {
+                if (affinity.field_heat[f] > affinity.field_heat[hottest]) hottest = f;
+            }
+            
+            int block = choose_aosoa_block_size(info, &cache_info);
+            layout_validation_t validation;
+            if (layout_evaluator && info->field_count >= 2 && block > 1 &&
+                evaluator_validate_aosoa(layout_evaluator, info, block, hottest,
+                                         16384, &validation) == 0 &&
+                validation.aosoa_validated) {
+                char aosoa_code[4096];
+                if (generate_aosoa_definition(layout_analyzer, info, block,
+                                              aosoa_code, sizeof(aosoa_code)) == 0) {
+                    printf("\n=== AoSoA Layout: %s ===\n%s\n", info->struct_name, aosoa_code);
+                }
+                if (generate_aos_to_aosoa_conversion(layout_analyzer, info, "aos", "aosoa", block,
+                                                     aosoa_code, sizeof(aosoa_code)) == 0) {
+                    printf("%s\n", aosoa_code);
+                }
+            }
         }
+        
+        evaluator_destroy(layout_evaluator);
+        free_object_ranges(ranges);
     }
-
+    
+    // Empirical tile search: extract each call-free nest into a kernel and time
+    // model-pruned tile sizes on this machine
+    if (config->autotune_tiles && static_results.loop_count > 0) {
+        autotuner_config_t tuner_config = autotuner_config_default();
+        autotune_all_nests(&static_results, &cache_info, &tuner_config, 8,
+                           &tuned_nests, &tuned_count);
+        for (int t = 0; t < tuned_count; t++) {
+            print_autotune_result(&tuned_nests[t]);
+        }
+    }
+    
+    // Rebuild each file's hottest nest under candidate flag sets; only a set
+    // that is significantly faster than the baseline flags is kept
+    if (config->autotune_flags && static_results.loop_count > 0) {
+        autotuner_config_t tuner_config = autotuner_config_default();
+        autotune_flags_per_file(&static_results, &cache_info, &tuner_config, 8,
+                                &tuned_files, &tuned_file_count);
+        for (int t = 0; t < tuned_file_count; t++) {
+            print_flag_tune_result(&tuned_files[t]);
+        }
+    }
+    
     // If no dynamic profiling data, create synthetic patterns from static analysis
     // In run_analysis, improve synthetic pattern generation
     if (sample_count == 0 && static_results.pattern_count > 0) {
+        TRACE_SCOPE(trace, "static_patterns");
+        trace_add_items(&trace, static_results.pattern_count);
         LOG_INFO("No dynamic profiling data - generating patterns from static analysis");
         
         hotspot_count = static_results.pattern_count;
@@ -483,17 +1241,35 @@ static int run_analysis(const analysis_config_t *config) {
         LOG_DEBUG("=== END CONVERSION ===\n");
     }
     
+    if (hotspot_count > 0) {
+        estimate_hotspot_costs(hotspots, hotspot_count, &static_results, &cache_info);
+    }
+    
     // Generate recommendations
     optimization_rec_t *recommendations = NULL;
     int rec_count = 0;
     
+    // Ranking prices each hotspot's sampled misses; counts scale by the period
+    cost_profile_t cost_profile = {
+        .sample_period = sample_count > 0 ? perf_config_default().sample_period : 1,
+        .total_samples = (uint64_t)sample_count,
+        .run_seconds = sample_count > 0 ? config->sampling_duration : 0
+    };
+    
     if (!config->no_recommendations && pattern_count > 0) {
+        TRACE_SCOPE(trace, "recommendations");
+        trace_add_items(&trace, pattern_count);
         LOG_INFO("Generating optimization recommendations");
         
+        arena_group_t *recommendation = arena_group_create("recommendation", 0);
+        
         engine_config_t engine_config = engine_config_default();
+        engine_config.arena = run_arena;
+        engine_config.scratch = arena_group_local(recommendation);
         recommendation_engine_t *engine = recommendation_engine_create(&engine_config, &cache_info);
         
         if (engine) {
+            recommendation_engine_set_profile(engine, &cost_profile);
             recommendation_engine_analyze_all(engine, patterns, pattern_count,
                                             &recommendations, &rec_count);
 
@@ -505,20 +1281,115 @@ static int run_analysis(const analysis_config_t *config) {
             
             recommendation_engine_destroy(engine);
         }
+        arena_group_destroy(recommendation);
+    }
+    
+    // Replace the analytical tile sizes with measured ones for nests we tuned;
+    // every recommendation inside one nest shares the same pooled note
+    string_pool_t *notes = tuned_count > 0 ? string_pool_create(run_arena) : NULL;
+    for (int r = 0; r < rec_count && notes; r++) {
+        optimization_rec_t *rec = &recommendations[r];
+        if (rec->type != OPT_LOOP_TILING || !rec->pattern || !rec->pattern->hotspot) continue;
+        
+        const source_location_t *loc = &rec->pattern->hotspot->location;
+        for (int t = 0; t < tuned_count; t++) {
+            const autotune_result_t *tuned = &tuned_nests[t];
+            if (tuned->best_index < 0 || strcmp(tuned->location.file, loc->file) != 0 ||
+                loc->line < tuned->location.line || loc->line > tuned->end_line) {
+                continue;
+            }
+            
+            const tile_variant_t *best = &tuned->variants[tuned->best_index];
+            char tiles[48];
+            if (tuned->depth == 3) {
+                snprintf(tiles, sizeof(tiles), "%dx%dx%d", best->tile_sizes[0],
+                         best->tile_sizes[1], best->tile_sizes[2]);
+            } else {
+                snprintf(tiles, sizeof(tiles), "%dx%d", best->tile_sizes[0], best->tile_sizes[1]);
+            }
+            
+            char note[512];
+            snprintf(note, sizeof(note), "Measured on %s: best tiles %s give %.2fx over untiled.",
+                     tuned->machine, tiles, tuned->speedup);
+            rec->note = string_pool_intern(notes, note);
+            rec->expected_improvement = (tuned->speedup - 1.0) * 100.0;
+            rec->predicted_miss_reduction = tuned->speedup > 1.0 ? 1.0 - 1.0 / tuned->speedup : 0;
+            rec->confidence_score = 0.95;
+            break;
+        }
+    }
+    if (notes) {
+        // Measured speedups replace the modelled ones; rank again
+        rank_recommendations_by_cost(recommendations, rec_count, &cache_info, &cost_profile);
+    }
+    string_pool_destroy(notes);
+    
+    // Measured flags replace the template ones for every recommendation in a tuned file
+    if (config->autotune_flags && rec_count > 0) {
+        string_pool_t *flag_sets = string_pool_create(run_arena);
+        for (int r = 0; r < rec_count && flag_sets; r++) {
+            optimization_rec_t *rec = &recommendations[r];
+            if (!rec->pattern || !rec->pattern->hotspot) continue;
+            
+            for (int t = 0; t < tuned_file_count; t++) {
+                const char *best = flag_tune_best_flags(&tuned_files[t]);
+                if (best && strcmp(tuned_files[t].location.file, rec->pattern->hotspot->location.file) == 0) {
+                    rec->tuned_flags = string_pool_intern(flag_sets, best);
+                    break;
+                }
+            }
+        }
+        string_pool_destroy(flag_sets);
+        recommendation_engine_export_makefile(recommendations, rec_count,
+                                              config->source_root, config->flags_makefile);
+    }
+    
+    // Rewrite sources for the safe subset of recommendations, then confirm
+    // the rewritten code analyses better than the original
+    if (transformer) {
+        TRACE_SCOPE(trace, "transform");
+        queue_recommendation_transforms(transformer, recommendations, rec_count, &cache_info);
+        
+        int applied = source_transformer_apply(transformer, (const char**)config->source_files,
+                                               config->num_source_files);
+        source_transformer_print_summary(transformer);
+        
+        // --in-place only touches the real sources once the copies verify
+        if (applied > 0) {
+            if (verify_transformations(config, transformer, &static_results, layout_analyzer,
+                                       reorders, reorder_count) == 0) {
+                source_transformer_write_back(transformer, (const char**)config->source_files,
+                                              config->num_source_files);
+            } else if (config->in_place) {
+                LOG_WARNING("Transformed sources failed verification; originals left untouched");
+            }
+        }
     }
     
     // Run evaluation/benchmarks if requested
+    microkernel_result_t *measured = NULL;
+    int measured_count = 0;
+    evaluation_metrics_t baseline_metrics;
+    bool have_metrics = false;
     if (config->benchmark && rec_count > 0) {
+        TRACE_SCOPE(trace, "benchmark");
         LOG_INFO("Running performance evaluation");
         
         evaluator_config_t eval_config = evaluator_config_default();
         evaluator_t *evaluator = evaluator_create(&eval_config, &cache_info);
         
+        // Reproduce the top recommendations as standalone kernels and time
+        // the original and transformed forms on this machine
+        autotuner_config_t kernel_config = autotuner_config_default();
+        microkernel_validate_top(recommendations, rec_count, 5, &cache_info, &kernel_config,
+                                 &measured, &measured_count);
+        for (int m = 0; m < measured_count; m++) {
+            microkernel_print_result(&measured[m]);
+        }
+        
         if (evaluator) {
-            // Evaluate recommendations
-            // This is simplified - real implementation would run actual benchmarks
-            evaluation_metrics_t baseline_metrics;
-            evaluator_collect_metrics(evaluator, hotspots, hotspot_count, &baseline_metrics);
+            have_metrics = evaluator_collect_metrics(evaluator, hotspots, hotspot_count,
+                                                     &baseline_metrics) == 0;
             
             evaluator_print_metrics(&baseline_metrics);
             
@@ -546,6 +1417,33 @@ static int run_analysis(const analysis_config_t *config) {
         LOG_ERROR("Failed to generate report");
     }
     
+    // Typed records for dashboards, alongside the prose report
+    if (strlen(config->export_file) > 0) {
+        analysis_export_t analysis = {
+            .cache_info = &cache_info,
+            .total_samples = (uint64_t)sample_count,
+            .sampling_duration = cost_profile.run_seconds,
+            .sample_period = cost_profile.sample_period,
+            .hotspots = hotspots,
+            .hotspot_count = hotspot_count,
+            .patterns = patterns,
+            .pattern_count = pattern_count,
+            .recommendations = recommendations,
+            .rec_count = rec_count,
+            .simulation = have_metrics ? &baseline_metrics : NULL,
+            .kernels = measured,
+            .kernel_count = measured_count
+        };
+        if (structured_export_write(&analysis,
+                                    config->export_ndjson ? EXPORT_FORMAT_NDJSON : EXPORT_FORMAT_JSON,
+                                    config->export_file) != 0) {
+            LOG_ERROR("Failed to write structured export");
+        }
+    }
+    if (measured) {
+        FREE_LOGGED(measured);
+    }
+    
     cleanup:
 	    // Free allocated memory - order matters to prevent double-free!
 	    
@@ -562,6 +1460,7 @@ static int run_analysis(const analysis_config_t *config) {
 		perf_sampler_free_samples(samples);
 		samples = NULL;
 	    }
+	    address_resolver_free_mappings(target.mappings);
 	    
 	    // Free hotspots - this has its own deep cleanup
 	    if (hotspots) {
@@ -577,11 +1476,20 @@ static int run_analysis(const analysis_config_t *config) {
 		patterns = NULL;
 	    }
 	    
-	    // Free recommendations array
-	    if (recommendations) {
-		LOG_DEBUG("Freeing recommendations array");
-		free(recommendations);
-		recommendations = NULL;
+	    // Recommendations live in the run arena
+	    LOG_DEBUG("Releasing run arena (%zu bytes used)", arena_bytes_used(run_arena));
+	    arena_destroy(run_arena);
+	    recommendations = NULL;
+	    
+	    // Free transformer state
+	    source_transformer_destroy(transformer);
+	    free(reorders);
+	    data_layout_analyzer_destroy(layout_analyzer);
+	    if (tuned_nests) {
+		FREE_LOGGED(tuned_nests);
+	    }
+	    if (tuned_files) {
+		FREE_LOGGED(tuned_files);
 	    }
 	    
 	    // Cleanup hardware detector
@@ -603,7 +1511,18 @@ int main(int argc, char *argv[]) {
         .json_output = false,
         .no_recommendations = false,
         .auto_apply = false,
+        .in_place = false,
+        .diff_file = "auto_apply.diff",
         .benchmark = false,
+        .autotune_tiles = false,
+        .autotune_flags = false,
+        .flags_makefile = "cachesight_flags.mk",
+        .source_root = "",
+        .profile_binary = "",
+        .export_file = "",
+        .export_ndjson = false,
+        .trace_file = "",
+        .replay_file = "",
         .sampling_duration = 10.0,
         .max_samples = 100000,
         .hotspot_threshold = 1.0,
@@ -634,7 +1553,19 @@ int main(int argc, char *argv[]) {
         {"std", required_argument, 0, 0},
         {"no-recommendations", no_argument, 0, 0},
         {"auto-apply", no_argument, 0, 0},
+        {"in-place", no_argument, 0, 0},
+        {"diff", required_argument, 0, 0},
         {"benchmark", no_argument, 0, 0},
+        {"autotune-tiles", no_argument, 0, 0},
+        {"autotune-flags", no_argument, 0, 0},
+        {"flags-makefile", required_argument, 0, 0},
+        {"source-root", required_argument, 0, 0},
+        {"export-profile", required_argument, 0, 0},
+        {"export", required_argument, 0, 0},
+        {"ndjson", no_argument, 0, 0},
+        {"trace", required_argument, 0, 0},
+        {"replay", required_argument, 0, 0},
+        {"jobs", required_argument, 0, 0},
         {0, 0, 0, 0}
     };
     
@@ -712,8 +1643,32 @@ int main(int argc, char *argv[]) {
                     config.no_recommendations = true;
                 } else if (strcmp(long_options[option_index].name, "auto-apply") == 0) {
                     config.auto_apply = true;
+                } else if (strcmp(long_options[option_index].name, "in-place") == 0) {
+                    config.in_place = true;
+                } else if (strcmp(long_options[option_index].name, "diff") == 0) {
+                    strncpy(config.diff_file, optarg, sizeof(config.diff_file) - 1);
                 } else if (strcmp(long_options[option_index].name, "benchmark") == 0) {
                     config.benchmark = true;
+                } else if (strcmp(long_options[option_index].name, "autotune-tiles") == 0) {
+                    config.autotune_tiles = true;
+                } else if (strcmp(long_options[option_index].name, "autotune-flags") == 0) {
+                    config.autotune_flags = true;
+                } else if (strcmp(long_options[option_index].name, "flags-makefile") == 0) {
+                    strncpy(config.flags_makefile, optarg, sizeof(config.flags_makefile) - 1);
+                } else if (strcmp(long_options[option_index].name, "source-root") == 0) {
+                    strncpy(config.source_root, optarg, sizeof(config.source_root) - 1);
+                } else if (strcmp(long_options[option_index].name, "export-profile") == 0) {
+                    strncpy(config.profile_binary, optarg, sizeof(config.profile_binary) - 1);
+                } else if (strcmp(long_options[option_index].name, "export") == 0) {
+                    strncpy(config.export_file, optarg, sizeof(config.export_file) - 1);
+                } else if (strcmp(long_options[option_index].name, "ndjson") == 0) {
+                    config.export_ndjson = true;
+                } else if (strcmp(long_options[option_index].name, "trace") == 0) {
+                    strncpy(config.trace_file, optarg, sizeof(config.trace_file) - 1);
+                } else if (strcmp(long_options[option_index].name, "replay") == 0) {
+                    strncpy(config.replay_file, optarg, sizeof(config.replay_file) - 1);
+                } else if (strcmp(long_options[option_index].name, "jobs") == 0) {
+                    config.jobs = atoi(optarg);
                 }
                 break;
                 
@@ -738,7 +1693,7 @@ int main(int argc, char *argv[]) {
     // Initialize logging
     log_level_t console_level = config.quiet ? LOG_WARNING : 
                                (config.verbose ? LOG_DEBUG : LOG_INFO);
-    log_level_t file_level = LOG_DEBUG;
+    log_level_t file_level = config.verbose ? LOG_DEBUG : LOG_INFO;
     
     logger_init(config.log_file, console_level, file_level);
     
@@ -751,12 +1706,21 @@ int main(int argc, char *argv[]) {
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
-    int ret = run_analysis(&config);
+    int ret = strcmp(config.mode, "diff") == 0 ? run_diff(&config) : run_analysis(&config);
 
     if (ret != 0) {  // Check for non-zero (error)
         LOG_ERROR("Failed to generate report");
     }
     
+    // Where the tool's own time went; stderr keeps piped output clean
+    if (!config.quiet) {
+        trace_print_summary(stderr);
+    }
+    if (strlen(config.trace_file) > 0) {
+        trace_write_chrome(config.trace_file);
+    }
+    trace_cleanup();
+    
     // Cleanup
     if (config.include_paths) free(config.include_paths);
     if (config.defines) free(config.defines);
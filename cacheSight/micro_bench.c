@@ -0,0 +1,826 @@
+// Micro-benchmarks of the analysis hot paths over synthetic sample streams.
+// Built by `make bench`; `make test` runs the quick set against the baseline.
+#include "common.h"
+#include "arena.h"
+#include "json_writer.h"
+#include "json_reader.h"
+#include "stage_trace.h"
+#include "sample_collector.h"
+#include "false_sharing_detector.h"
+#include "bank_conflict_analyzer.h"
+#include "evaluator.h"
+#include "statistical_analyzer.h"
+#include "address_resolver.h"
+#include "pattern_classifier.h"
+#include "recommendation_engine.h"
+#include <getopt.h>
+#include <math.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BENCH_BLOCK 65536               // Records per block for streamed benchmarks
+#define BENCH_IPS 512                   // Distinct instruction addresses in a stream
+#define BENCH_MAX_SIZES 8
+#define BENCH_MAX_RESULTS 64
+#define BENCH_MAX_REPEATS 15
+#define BENCH_SAMPLES_PER_PATTERN 100   // Stream records behind one classified pattern
+#define BENCH_PATTERN_SAMPLES 16        // Samples attached to each synthetic hotspot
+
+// Shared state of one benchmark at one size
+typedef struct {
+    cache_info_t cache_info;
+    cache_miss_sample_t *samples;       // Whole stream, or one block when streamed
+    size_t count;                       // Records the benchmark processes
+    size_t stored;                      // Records held in samples
+    uint64_t *addresses;                // Resolver input block
+    size_t address_count;
+    
+    sample_collector_t *collector;
+    false_sharing_detector_t *fs_detector;
+    false_sharing_results_t fs_results;
+    bank_conflict_analyzer_t *bank_analyzer;
+    bank_conflict_t *conflicts;
+    int conflict_count;
+    evaluator_t *evaluator;
+    statistical_analyzer_t *stats_analyzer;
+    address_resolver_t *resolver;
+    cache_hotspot_t *hotspots;
+    classified_pattern_t *patterns;
+    int pattern_count;
+    recommendation_engine_t *engine;
+    arena_t *run_arena;
+    char note[96];
+} bench_ctx_t;
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    bool streamed;                      // Runs over a reused block, so any size fits
+    size_t divisor;                     // Stream records per unit processed
+    size_t bytes_per_unit;              // Resident memory per unit, for the size guard
+    int (*setup)(bench_ctx_t *ctx);     // Once per size, untimed
+    int (*prepare)(bench_ctx_t *ctx);   // Before each repeat, untimed
+    int (*run)(bench_ctx_t *ctx);       // Timed
+    void (*finish)(bench_ctx_t *ctx);   // After each repeat, untimed
+    void (*teardown)(bench_ctx_t *ctx);
+} bench_def_t;
+
+typedef struct {
+    char name[48];
+    size_t records;
+    const char *unit;
+    int repeats;
+    double best_ns;
+    double median_ns;
+    uint64_t alloc_bytes;               // Logged allocations of one repeat
+    uint64_t alloc_count;
+    bool skipped;
+    bool regressed;
+    double baseline_ns_per_record;      // 0 = no baseline entry
+    char note[96];
+} bench_result_t;
+
+typedef struct {
+    size_t sizes[BENCH_MAX_SIZES];
+    int size_count;
+    int repeats;
+    size_t max_mem_mb;
+    double time_limit_ns;               // Skip sizes projected to run longer than this
+    double tolerance;                   // Allowed slowdown before a regression, fraction
+    const char *filter;
+    const char *baseline;
+    const char *write_baseline;
+} bench_options_t;
+
+// Deterministic generator so every run sees the same stream
+static uint64_t g_rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t bench_rand(void) {
+    uint64_t x = g_rng_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    g_rng_state = x;
+    return x;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Fixed hierarchy so simulation results do not depend on the host
+static void bench_cache_info(cache_info_t *info) {
+    memset(info, 0, sizeof(*info));
+    size_t sizes[3] = {32 * 1024, 1024 * 1024, 32 * 1024 * 1024};
+    int ways[3] = {8, 16, 16};
+    int latency[3] = {4, 14, 50};
+    for (int i = 0; i < 3; i++) {
+        cache_level_t *level = &info->levels[i];
+        level->level = i + 1;
+        level->size = sizes[i];
+        level->line_size = 64;
+        level->associativity = ways[i];
+        level->sets = (int)(sizes[i] / (64 * ways[i]));
+        level->latency_cycles = latency[i];
+        strcpy(level->type, i == 0 ? "data" : "unified");
+    }
+    info->num_levels = 3;
+    info->num_cores = 8;
+    info->num_threads = 16;
+    info->page_size = 4096;
+    info->cpu_frequency_ghz = 3.0;
+    info->simd_width_bytes = 32;
+    info->memory_latency_ns = 80.0;
+    strcpy(info->arch, "x86_64");
+    strcpy(info->cpu_model, "cachesight-bench");
+}
+
+// Mix of the shapes the classifier tells apart: a fifth of the IPs take
+// most samples, and each IP keeps one access shape
+static void fill_stream(cache_miss_sample_t *samples, size_t count) {
+    static source_location_t locations[BENCH_IPS];
+    static uint64_t cursors[BENCH_IPS];
+    static bool ready = false;
+    if (!ready) {
+        for (int k = 0; k < BENCH_IPS; k++) {
+            snprintf(locations[k].file, sizeof(locations[k].file), "bench_kernel_%d.c", k % 16);
+            locations[k].line = 100 + k;
+            snprintf(locations[k].function, sizeof(locations[k].function), "kernel_%d", k);
+        }
+        ready = true;
+    }
+    g_rng_state = 0x9E3779B97F4A7C15ULL;
+    memset(cursors, 0, sizeof(cursors));
+    
+    for (size_t i = 0; i < count; i++) {
+        uint64_t r = bench_rand();
+        int k = (r & 7) ? (int)((r >> 8) % (BENCH_IPS / 5)) : (int)((r >> 8) % BENCH_IPS);
+        uint64_t region = 0x10000000ULL + (uint64_t)k * 0x4000000ULL;
+        cache_miss_sample_t *sample = &samples[i];
+        
+        sample->instruction_addr = 0x401000 + (uint64_t)k * 16;
+        sample->cpu_id = (int)((r >> 32) % 8);
+        switch (k % 4) {
+            case 0: sample->memory_addr = region + cursors[k]++ * 8; break;
+            case 1: sample->memory_addr = region + cursors[k]++ * 4096; break;
+            case 2: sample->memory_addr = region + ((r >> 20) % (64 << 20) & ~7ULL); break;
+            default: sample->memory_addr = region + sample->cpu_id * 8; break;
+        }
+        sample->timestamp = i * 100;
+        sample->source_loc = locations[k];
+        sample->cache_level_missed = 1 + (int)((r >> 40) % 3);
+        sample->access_size = 8;
+        sample->is_write = k % 4 == 3 || ((r >> 44) & 3) == 0;
+        sample->latency_cycles = 40 + (r >> 48) % 300;
+        sample->tid = 1000 + sample->cpu_id;
+    }
+}
+
+static int setup_stream(bench_ctx_t *ctx) {
+    fill_stream(ctx->samples, ctx->stored);
+    return 0;
+}
+
+// sample_collector_process: aggregation of the whole stream into hotspots
+static int collector_prepare(bench_ctx_t *ctx) {
+    collector_config_t config = collector_config_default();
+    config.detect_false_sharing = false;
+    ctx->collector = sample_collector_create(&config, &ctx->cache_info);
+    if (!ctx->collector) return -1;
+    return sample_collector_attach_samples(ctx->collector, ctx->samples, (int)ctx->count);
+}
+
+static int collector_run(bench_ctx_t *ctx) {
+    return sample_collector_process(ctx->collector);
+}
+
+static void collector_finish(bench_ctx_t *ctx) {
+    sample_collector_destroy(ctx->collector);
+    ctx->collector = NULL;
+}
+
+// detect_false_sharing
+static int false_sharing_setup(bench_ctx_t *ctx) {
+    false_sharing_config_t config = false_sharing_config_default();
+    ctx->fs_detector = false_sharing_detector_create(&config);
+    if (!ctx->fs_detector) return -1;
+    return setup_stream(ctx);
+}
+
+static int false_sharing_run(bench_ctx_t *ctx) {
+    return detect_false_sharing(ctx->fs_detector, ctx->samples, (int)ctx->count, &ctx->fs_results);
+}
+
+static void false_sharing_finish(bench_ctx_t *ctx) {
+    free_false_sharing_results(&ctx->fs_results);
+}
+
+static void false_sharing_teardown(bench_ctx_t *ctx) {
+    false_sharing_detector_destroy(ctx->fs_detector);
+    ctx->fs_detector = NULL;
+}
+
+// analyze_bank_conflicts
+static int bank_setup(bench_ctx_t *ctx) {
+    bank_config_t config = bank_config_default_cpu();
+    ctx->bank_analyzer = bank_conflict_analyzer_create(&config);
+    if (!ctx->bank_analyzer) return -1;
+    return setup_stream(ctx);
+}
+
+static int bank_run(bench_ctx_t *ctx) {
+    return analyze_bank_conflicts(ctx->bank_analyzer, ctx->samples, (int)ctx->count,
+                                  &ctx->conflicts, &ctx->conflict_count);
+}
+
+static void bank_finish(bench_ctx_t *ctx) {
+    free_bank_conflicts(ctx->conflicts, ctx->conflict_count);
+    ctx->conflicts = NULL;
+    ctx->conflict_count = 0;
+}
+
+static void bank_teardown(bench_ctx_t *ctx) {
+    bank_conflict_analyzer_destroy(ctx->bank_analyzer);
+    ctx->bank_analyzer = NULL;
+}
+
+// evaluator_simulate_cache, streamed block by block
+static int simulate_setup(bench_ctx_t *ctx) {
+    evaluator_config_t config = evaluator_config_default();
+    config.enable_simulation = true;
+    ctx->evaluator = evaluator_create(&config, &ctx->cache_info);
+    if (!ctx->evaluator) return -1;
+    return setup_stream(ctx);
+}
+
+static int simulate_run(bench_ctx_t *ctx) {
+    evaluation_metrics_t metrics;
+    for (size_t done = 0; done < ctx->count; done += ctx->stored) {
+        size_t n = ctx->count - done < ctx->stored ? ctx->count - done : ctx->stored;
+        if (evaluator_simulate_cache(ctx->evaluator, ctx->samples, (int)n, &metrics) != 0) return -1;
+    }
+    return 0;
+}
+
+static void simulate_teardown(bench_ctx_t *ctx) {
+    evaluator_destroy(ctx->evaluator);
+    ctx->evaluator = NULL;
+}
+
+// calculate_pattern_statistics
+static int statistics_setup(bench_ctx_t *ctx) {
+    statistics_config_t config = statistics_config_default();
+    ctx->stats_analyzer = statistical_analyzer_create(&config);
+    if (!ctx->stats_analyzer) return -1;
+    return setup_stream(ctx);
+}
+
+static int statistics_run(bench_ctx_t *ctx) {
+    pattern_statistics_t stats;
+    return calculate_pattern_statistics(ctx->stats_analyzer, ctx->samples, (int)ctx->count, &stats);
+}
+
+static void statistics_teardown(bench_ctx_t *ctx) {
+    statistical_analyzer_destroy(ctx->stats_analyzer);
+    ctx->stats_analyzer = NULL;
+}
+
+// Resolution targets: addresses inside this binary's own functions
+static int bench_resolver_anchor(int x) {
+    return x * 3 + 1;
+}
+
+// address_resolver_resolve over a stream of sampled IPs; the first lookup of
+// each IP (addr2line) happens in setup, the timed loop is the cached path
+static int resolve_setup(bench_ctx_t *ctx) {
+    char exe[256] = {0};
+    if (readlink("/proc/self/exe", exe, sizeof(exe) - 1) <= 0) return -1;
+    
+    ctx->resolver = address_resolver_create(getpid());
+    if (!ctx->resolver || address_resolver_init_process(ctx->resolver) != 0 ||
+        address_resolver_init_binary(ctx->resolver, exe) != 0) {
+        return -1;
+    }
+    address_resolver_load_symbols(ctx->resolver);
+    
+    uint64_t ips[BENCH_IPS];
+    uint64_t anchors[4] = {
+        (uint64_t)(uintptr_t)&bench_resolver_anchor, (uint64_t)(uintptr_t)&fill_stream,
+        (uint64_t)(uintptr_t)&bench_rand, (uint64_t)(uintptr_t)&bench_cache_info
+    };
+    for (int k = 0; k < BENCH_IPS; k++) {
+        ips[k] = anchors[k % 4] + (k / 4) % 16;
+    }
+    
+    int resolved = 0;
+    double start = now_ns();
+    symbol_info_t symbol;
+    for (int k = 0; k < BENCH_IPS; k++) {
+        if (address_resolver_resolve(ctx->resolver, ips[k], &symbol) == 0 && symbol.name[0] &&
+            strcmp(symbol.name, "??") != 0) {
+            resolved++;
+        }
+    }
+    snprintf(ctx->note, sizeof(ctx->note), "cold: %d/%d lookups named in %.1f ms",
+             resolved, BENCH_IPS, (now_ns() - start) / 1e6);
+    
+    ctx->address_count = ctx->stored;
+    ctx->addresses = MALLOC_LOGGED(ctx->address_count * sizeof(uint64_t));
+    if (!ctx->addresses) return -1;
+    g_rng_state = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < ctx->address_count; i++) {
+        ctx->addresses[i] = ips[bench_rand() % BENCH_IPS];
+    }
+    return 0;
+}
+
+static int resolve_run(bench_ctx_t *ctx) {
+    symbol_info_t symbol;
+    for (size_t done = 0; done < ctx->count; done += ctx->address_count) {
+        size_t n = ctx->count - done < ctx->address_count ? ctx->count - done : ctx->address_count;
+        for (size_t i = 0; i < n; i++) {
+            address_resolver_resolve(ctx->resolver, ctx->addresses[i], &symbol);
+        }
+    }
+    return 0;
+}
+
+static void resolve_teardown(bench_ctx_t *ctx) {
+    address_resolver_destroy(ctx->resolver);
+    ctx->resolver = NULL;
+    if (ctx->addresses) FREE_LOGGED(ctx->addresses);
+    ctx->addresses = NULL;
+}
+
+// recommendation_engine_analyze_all over patterns classified from synthetic
+// hotspots, one per BENCH_SAMPLES_PER_PATTERN stream records
+static int engine_setup(bench_ctx_t *ctx) {
+    setup_stream(ctx);
+    
+    int count = (int)ctx->count;
+    ctx->hotspots = CALLOC_LOGGED(count, sizeof(cache_hotspot_t));
+    if (!ctx->hotspots) return -1;
+    
+    for (int i = 0; i < count; i++) {
+        cache_hotspot_t *hotspot = &ctx->hotspots[i];
+        size_t first = ((size_t)i * BENCH_PATTERN_SAMPLES) % (ctx->stored - BENCH_PATTERN_SAMPLES + 1);
+        hotspot->samples = &ctx->samples[first];
+        hotspot->sample_count = BENCH_PATTERN_SAMPLES;
+        hotspot->location = hotspot->samples[0].source_loc;
+        hotspot->location.line = 100 + i;  // One site per pattern
+        hotspot->total_misses = 1000 + i % 5000;
+        hotspot->total_accesses = hotspot->total_misses * 4;
+        hotspot->miss_rate = 0.25;
+        hotspot->avg_latency_cycles = 120;
+        hotspot->dominant_pattern = (access_pattern_t)(i % 4);
+        hotspot->access_stride = (i % 4 == 1) ? 4096 : 8;
+        hotspot->address_range_start = hotspot->samples[0].memory_addr;
+        hotspot->address_range_end = hotspot->address_range_start + 64 * 1024;
+        hotspot->cache_levels_affected[0] = (int)hotspot->total_misses;
+    }
+    
+    classifier_config_t classifier_config = classifier_config_default();
+    pattern_classifier_t *classifier = pattern_classifier_create(&classifier_config, &ctx->cache_info);
+    if (!classifier) return -1;
+    int ret = pattern_classifier_classify_all(classifier, ctx->hotspots, count,
+                                              &ctx->patterns, &ctx->pattern_count);
+    pattern_classifier_destroy(classifier);
+    return ret == 0 && ctx->pattern_count > 0 ? 0 : -1;
+}
+
+static int engine_prepare(bench_ctx_t *ctx) {
+    ctx->run_arena = arena_create(0);
+    engine_config_t config = engine_config_default();
+    config.arena = ctx->run_arena;
+    ctx->engine = recommendation_engine_create(&config, &ctx->cache_info);
+    return ctx->engine && ctx->run_arena ? 0 : -1;
+}
+
+static int engine_run(bench_ctx_t *ctx) {
+    optimization_rec_t *recs = NULL;
+    int rec_count = 0;
+    return recommendation_engine_analyze_all(ctx->engine, ctx->patterns, ctx->pattern_count,
+                                             &recs, &rec_count);
+}
+
+static void engine_finish(bench_ctx_t *ctx) {
+    recommendation_engine_destroy(ctx->engine);
+    arena_destroy(ctx->run_arena);
+    ctx->engine = NULL;
+    ctx->run_arena = NULL;
+}
+
+static void engine_teardown(bench_ctx_t *ctx) {
+    if (ctx->patterns) free(ctx->patterns);
+    if (ctx->hotspots) FREE_LOGGED(ctx->hotspots);
+    ctx->patterns = NULL;
+    ctx->hotspots = NULL;
+}
+
+static const bench_def_t g_benchmarks[] = {
+    {"collector.process", "samples", false, 1, 2 * sizeof(cache_miss_sample_t),
+     setup_stream, collector_prepare, collector_run, collector_finish, NULL},
+    {"false_sharing.detect", "samples", false, 1, 2 * sizeof(cache_miss_sample_t),
+     false_sharing_setup, NULL, false_sharing_run, false_sharing_finish, false_sharing_teardown},
+    {"bank_conflicts.analyze", "samples", false, 1, sizeof(cache_miss_sample_t) + 64,
+     bank_setup, NULL, bank_run, bank_finish, bank_teardown},
+    {"evaluator.simulate_cache", "samples", true, 1, 0,
+     simulate_setup, NULL, simulate_run, NULL, simulate_teardown},
+    {"statistics.pattern", "samples", false, 1, sizeof(cache_miss_sample_t) + 48,
+     statistics_setup, NULL, statistics_run, NULL, statistics_teardown},
+    {"symbols.resolve", "addresses", true, 1, 0,
+     resolve_setup, NULL, resolve_run, NULL, resolve_teardown},
+    {"recommendations.analyze_all", "patterns", false, BENCH_SAMPLES_PER_PATTERN,
+     sizeof(cache_hotspot_t) + sizeof(classified_pattern_t) + 6 * sizeof(optimization_rec_t),
+     engine_setup, engine_prepare, engine_run, engine_finish, engine_teardown},
+};
+
+static int compare_doubles(const void *a, const void *b) {
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+// Run time at a larger size, from the growth between the last two measured
+// sizes; never assumes better than linear
+static double project_time(const bench_result_t *previous, int previous_count, size_t records) {
+    const bench_result_t *last = previous_count > 0 ? &previous[previous_count - 1] : NULL;
+    if (!last || last->skipped) return 0;
+    
+    double exponent = 1.0;
+    if (previous_count > 1 && !previous[previous_count - 2].skipped) {
+        const bench_result_t *before = &previous[previous_count - 2];
+        double growth = log(last->best_ns / before->best_ns) / log((double)last->records / before->records);
+        if (growth > exponent) exponent = growth;
+    }
+    return last->best_ns * pow((double)records / last->records, exponent);
+}
+
+static void run_benchmark(const bench_def_t *def, size_t stream_records, const bench_options_t *options,
+                          const bench_result_t *previous, int previous_count, bench_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    strncpy(result->name, def->name, sizeof(result->name) - 1);
+    result->unit = def->unit;
+    result->records = stream_records / def->divisor;
+    if (result->records == 0) {
+        result->skipped = true;
+        snprintf(result->note, sizeof(result->note), "stream too short");
+        return;
+    }
+    
+    double projected = project_time(previous, previous_count, result->records);
+    if (projected > options->time_limit_ns) {
+        result->skipped = true;
+        snprintf(result->note, sizeof(result->note), "projected %.0f s per repeat (--time-limit %.0f)",
+                 projected / 1e9, options->time_limit_ns / 1e9);
+        return;
+    }
+    
+    bench_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    bench_cache_info(&ctx.cache_info);
+    ctx.count = result->records;
+    
+    // Samples held: a block for streamed benchmarks, the whole stream otherwise
+    // (patterns draw their samples from at most one block)
+    ctx.stored = def->streamed || def->divisor > 1 ?
+                 (stream_records < BENCH_BLOCK ? stream_records : BENCH_BLOCK) : ctx.count;
+    size_t resident = ctx.stored * sizeof(cache_miss_sample_t) + ctx.count * def->bytes_per_unit;
+    if (resident > options->max_mem_mb * 1024 * 1024) {
+        result->skipped = true;
+        snprintf(result->note, sizeof(result->note), "needs %zu MB (--max-mem %zu)",
+                 resident >> 20, options->max_mem_mb);
+        return;
+    }
+    
+    ctx.samples = MALLOC_LOGGED(ctx.stored * sizeof(cache_miss_sample_t));
+    if (!ctx.samples || (def->setup && def->setup(&ctx) != 0)) {
+        result->skipped = true;
+        snprintf(result->note, sizeof(result->note), "setup failed");
+        if (def->teardown) def->teardown(&ctx);
+        if (ctx.samples) FREE_LOGGED(ctx.samples);
+        return;
+    }
+    
+    double times[BENCH_MAX_REPEATS];
+    int repeats = 0;
+    for (int r = 0; r < options->repeats; r++) {
+        if (def->prepare && def->prepare(&ctx) != 0) break;
+        
+        uint64_t bytes_before, count_before, bytes_after, count_after;
+        memory_alloc_counters(&bytes_before, &count_before);
+        double start = now_ns();
+        int ret = def->run(&ctx);
+        times[repeats] = now_ns() - start;
+        memory_alloc_counters(&bytes_after, &count_after);
+        
+        if (def->finish) def->finish(&ctx);
+        if (ret != 0) break;
+        
+        result->alloc_bytes = bytes_after - bytes_before;
+        result->alloc_count = count_after - count_before;
+        repeats++;
+    }
+    
+    if (def->teardown) def->teardown(&ctx);
+    FREE_LOGGED(ctx.samples);
+    strncpy(result->note, ctx.note, sizeof(result->note) - 1);
+    
+    if (repeats == 0) {
+        result->skipped = true;
+        snprintf(result->note, sizeof(result->note), "run failed");
+        return;
+    }
+    qsort(times, repeats, sizeof(double), compare_doubles);
+    result->repeats = repeats;
+    result->best_ns = times[0];
+    result->median_ns = times[repeats / 2];
+}
+
+// Baseline entries are keyed by benchmark name and record count; a result
+// regresses when it is slower or allocates more than the tolerance allows.
+// Returns the number of matched entries, -1 without a usable baseline
+static int apply_baseline(const char *path, bench_result_t *results, int count, double tolerance) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "No baseline at %s; run `make bench-baseline` to record one\n", path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+    size_t length = (size_t)st.st_size;
+    const char *text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) return -1;
+    
+    arena_t *arena = arena_create(0);
+    const json_value_t *document = arena ? json_parse(arena, text, length, NULL) : NULL;
+    const json_value_t *entries = document ? json_get(document, "results") : NULL;
+    if (!entries || entries->type != JSON_ARRAY) {
+        fprintf(stderr, "%s is not a benchmark baseline\n", path);
+    }
+    
+    int matched = 0;
+    for (const json_value_t *entry = entries ? entries->child : NULL; entry; entry = entry->next) {
+        const char *name = json_get_string(entry, "name", "");
+        size_t records = (size_t)json_get_number(entry, "records", 0);
+        double base_ns = json_get_number(entry, "ns_per_record", 0);
+        double base_bytes = json_get_number(entry, "alloc_bytes", 0);
+        for (int i = 0; i < count; i++) {
+            bench_result_t *result = &results[i];
+            if (result->skipped || result->records != records || strcmp(result->name, name) != 0) continue;
+            
+            result->baseline_ns_per_record = base_ns;
+            double ns_per_record = result->best_ns / result->records;
+            result->regressed = (base_ns > 0 && ns_per_record > base_ns * (1.0 + tolerance)) ||
+                                result->alloc_bytes > base_bytes * (1.0 + tolerance) + 4096;
+            matched++;
+        }
+    }
+    
+    bool usable = entries && entries->type == JSON_ARRAY;
+    arena_destroy(arena);
+    munmap((void *)text, length);
+    return usable ? matched : -1;
+}
+
+static int write_baseline(const char *path, const bench_result_t *results, int count) {
+    json_writer_t *writer = MALLOC_LOGGED(sizeof(json_writer_t));
+    if (!writer) return -1;
+    if (json_writer_open(writer, path, true) != 0) {
+        FREE_LOGGED(writer);
+        return -1;
+    }
+    
+    json_begin_object(writer, NULL);
+    json_int(writer, "version", 1);
+    json_begin_array(writer, "results");
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *result = &results[i];
+        if (result->skipped) continue;
+        json_begin_object(writer, NULL);
+        json_string(writer, "name", result->name);
+        json_uint(writer, "records", result->records);
+        json_double(writer, "ns_per_record", result->best_ns / result->records);
+        json_double(writer, "records_per_sec", result->records / (result->best_ns / 1e9));
+        json_uint(writer, "alloc_bytes", result->alloc_bytes);
+        json_uint(writer, "alloc_count", result->alloc_count);
+        json_end_object(writer);
+    }
+    json_end_array(writer);
+    json_end_object(writer);
+    json_end_record(writer);
+    
+    int ret = json_writer_close(writer);
+    FREE_LOGGED(writer);
+    if (ret == 0) {
+        printf("Baseline written to %s\n", path);
+    }
+    return ret;
+}
+
+static void print_results(const bench_result_t *results, int count) {
+    printf("\n%-28s %10s %-9s %10s %10s %10s %9s %10s %8s %9s\n",
+           "Benchmark", "Records", "Unit", "Best ms", "Median ms", "ns/rec", "Mrec/s",
+           "Alloc MB", "Allocs", "vs base");
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *result = &results[i];
+        if (result->skipped) {
+            printf("%-28s %10zu %-9s %10s  skipped: %s\n", result->name, result->records,
+                   result->unit, "-", result->note);
+            continue;
+        }
+        
+        double ns_per_record = result->best_ns / result->records;
+        char versus[16] = "-";
+        if (result->baseline_ns_per_record > 0) {
+            snprintf(versus, sizeof(versus), "%+.0f%%%s",
+                     100.0 * (ns_per_record / result->baseline_ns_per_record - 1.0),
+                     result->regressed ? "!" : "");
+        }
+        printf("%-28s %10zu %-9s %10.2f %10.2f %10.1f %9.2f %10.2f %8lu %9s",
+               result->name, result->records, result->unit,
+               result->best_ns / 1e6, result->median_ns / 1e6, ns_per_record,
+               1e3 / ns_per_record, result->alloc_bytes / (1024.0 * 1024.0),
+               (unsigned long)result->alloc_count, versus);
+        if (result->note[0]) printf("  (%s)", result->note);
+        printf("\n");
+    }
+}
+
+// "10K", "2M" and plain numbers
+static size_t parse_size(const char *text) {
+    char *end;
+    double value = strtod(text, &end);
+    if (*end == 'K' || *end == 'k') value *= 1e3;
+    else if (*end == 'M' || *end == 'm') value *= 1e6;
+    else if (*end == 'G' || *end == 'g') value *= 1e9;
+    return value > 0 ? (size_t)value : 0;
+}
+
+static int parse_sizes(const char *list, bench_options_t *options) {
+    char buffer[256];
+    strncpy(buffer, list, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+    
+    options->size_count = 0;
+    for (char *save = NULL, *token = strtok_r(buffer, ",", &save); token;
+         token = strtok_r(NULL, ",", &save)) {
+        size_t size = parse_size(token);
+        if (size == 0 || options->size_count == BENCH_MAX_SIZES || size > INT32_MAX) {
+            fprintf(stderr, "Bad size '%s' (1 .. 2G records, at most %d sizes)\n", token, BENCH_MAX_SIZES);
+            return -1;
+        }
+        // Kept ascending and unique; run-time projection walks up the sizes
+        int slot = options->size_count;
+        while (slot > 0 && options->sizes[slot - 1] > size) {
+            options->sizes[slot] = options->sizes[slot - 1];
+            slot--;
+        }
+        if (slot > 0 && options->sizes[slot - 1] == size) {
+            memmove(&options->sizes[slot], &options->sizes[slot + 1],
+                    (options->size_count - slot) * sizeof(size_t));
+            continue;
+        }
+        options->sizes[slot] = size;
+        options->size_count++;
+    }
+    return options->size_count > 0 ? 0 : -1;
+}
+
+static void print_usage(const char *prog_name) {
+    printf("Usage: %s [OPTIONS]\n", prog_name);
+    printf("\nMicro-benchmarks of the analysis hot paths over synthetic sample streams\n");
+    printf("\nOptions:\n");
+    printf("  --sizes LIST            Stream sizes in records (default: 10K,100K,1M; up to 100M)\n");
+    printf("  --quick                 Sizes 10K,100K with 3 repeats\n");
+    printf("  --repeats N             Timed repeats per benchmark, best is reported (default: 5)\n");
+    printf("  --filter TEXT           Only benchmarks whose name contains TEXT\n");
+    printf("  --max-mem MB            Skip sizes needing more resident memory (default: 2048)\n");
+    printf("  --time-limit SEC        Skip sizes projected to take longer per repeat (default: 20)\n");
+    printf("  --baseline FILE         Compare against FILE; exit 1 on a regression, 2 if unusable\n");
+    printf("  --tolerance PCT         Slowdown allowed before a regression (default: 25)\n");
+    printf("  --write-baseline FILE   Save these results as a baseline\n");
+}
+
+int main(int argc, char *argv[]) {
+    bench_options_t options = {
+        .sizes = {10000, 100000, 1000000},
+        .size_count = 3,
+        .repeats = 5,
+        .max_mem_mb = 2048,
+        .time_limit_ns = 20e9,
+        .tolerance = 0.25
+    };
+    
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+        {"sizes", required_argument, 0, 's'},
+        {"quick", no_argument, 0, 'q'},
+        {"repeats", required_argument, 0, 'r'},
+        {"filter", required_argument, 0, 'f'},
+        {"max-mem", required_argument, 0, 'm'},
+        {"time-limit", required_argument, 0, 'l'},
+        {"baseline", required_argument, 0, 'b'},
+        {"tolerance", required_argument, 0, 't'},
+        {"write-baseline", required_argument, 0, 'w'},
+        {0, 0, 0, 0}
+    };
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                if (parse_sizes(optarg, &options) != 0) return 2;
+                break;
+            case 'q':
+                options.sizes[0] = 10000;
+                options.sizes[1] = 100000;
+                options.size_count = 2;
+                options.repeats = 3;
+                break;
+            case 'r':
+                options.repeats = atoi(optarg);
+                if (options.repeats < 1) options.repeats = 1;
+                if (options.repeats > BENCH_MAX_REPEATS) options.repeats = BENCH_MAX_REPEATS;
+                break;
+            case 'f':
+                options.filter = optarg;
+                break;
+            case 'm':
+                options.max_mem_mb = (size_t)atol(optarg);
+                break;
+            case 'l':
+                options.time_limit_ns = atof(optarg) * 1e9;
+                break;
+            case 'b':
+                options.baseline = optarg;
+                break;
+            case 't':
+                options.tolerance = atof(optarg) / 100.0;
+                break;
+            case 'w':
+                options.write_baseline = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 2;
+        }
+    }
+    
+    // Benchmarks measure the code, not its logging or stage tracing
+    logger_init(NULL, LOG_ERROR, LOG_ERROR);
+    trace_set_enabled(false);
+    
+    bench_result_t results[BENCH_MAX_RESULTS];
+    int result_count = 0;
+    int benchmark_count = (int)(sizeof(g_benchmarks) / sizeof(g_benchmarks[0]));
+    
+    for (int b = 0; b < benchmark_count; b++) {
+        const bench_def_t *def = &g_benchmarks[b];
+        if (options.filter && !strstr(def->name, options.filter)) continue;
+        
+        int first = result_count;
+        for (int s = 0; s < options.size_count && result_count < BENCH_MAX_RESULTS; s++) {
+            fprintf(stderr, "Running %s on %zu records...\n", def->name, options.sizes[s]);
+            run_benchmark(def, options.sizes[s], &options, &results[first], result_count - first,
+                          &results[result_count]);
+            result_count++;
+        }
+    }
+    
+    int matched = -1;
+    if (options.baseline) {
+        matched = apply_baseline(options.baseline, results, result_count, options.tolerance);
+    }
+    print_results(results, result_count);
+    
+    int regressions = 0;
+    for (int i = 0; i < result_count; i++) {
+        if (results[i].regressed) regressions++;
+    }
+    if (matched >= 0) {
+        printf("\n%d of %d results matched %s; %d regression%s beyond %.0f%%\n",
+               matched, result_count, options.baseline, regressions, regressions == 1 ? "" : "s",
+               options.tolerance * 100.0);
+    }
+    
+    if (options.write_baseline) {
+        write_baseline(options.write_baseline, results, result_count);
+    }
+    
+    trace_cleanup();
+    logger_cleanup();
+    
+    // A requested comparison that could not run is not a pass
+    if (options.baseline && matched < 0) return 2;
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,493 @@
+#include "microkernel.h"
+#include "sample_collector.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#define MICROKERNEL_MIN_FOOTPRINT (64 * 1024)
+#define MICROKERNEL_MAX_FOOTPRINT (256UL * 1024 * 1024)
+
+static bool has_kernel_model(optimization_type_t type) {
+    switch (type) {
+        case OPT_PREFETCH_HINTS:
+        case OPT_LOOP_TILING:
+        case OPT_CACHE_BLOCKING:
+        case OPT_ACCESS_REORDER:
+        case OPT_DATA_LAYOUT_CHANGE:
+        case OPT_NONTEMPORAL_STORES:
+        case OPT_MEMORY_ALIGNMENT:
+        case OPT_MEMORY_POOLING:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int microkernel_params_from_rec(const optimization_rec_t *rec, const cache_info_t *cache_info,
+                               microkernel_params_t *params) {
+    if (!rec || !cache_info || !params || !rec->pattern || !rec->pattern->hotspot) return -1;
+    
+    const cache_hotspot_t *hotspot = rec->pattern->hotspot;
+    memset(params, 0, sizeof(microkernel_params_t));
+    
+    // Sampled range when there is one, else several times the last level
+    size_t llc = cache_info->num_levels > 0 ? cache_info->levels[cache_info->num_levels - 1].size : 0;
+    size_t footprint = hotspot->address_range_end > hotspot->address_range_start ?
+                       hotspot->address_range_end - hotspot->address_range_start : 4 * llc;
+    if (footprint < MICROKERNEL_MIN_FOOTPRINT) footprint = MICROKERNEL_MIN_FOOTPRINT;
+    if (footprint > MICROKERNEL_MAX_FOOTPRINT) footprint = MICROKERNEL_MAX_FOOTPRINT;
+    params->footprint_bytes = footprint;
+    
+    params->stride_bytes = estimate_hotspot_stride_bytes(hotspot);
+    if (params->stride_bytes < 8) params->stride_bytes = 8;
+    
+    // A dependent FP add or multiply costs about four cycles
+    int ops = (int)(hotspot->cycles_per_iteration / 4.0);
+    params->work_ops = ops < 0 ? 0 : ops > 64 ? 64 : ops;
+    
+    params->prefetch_distance = rec->prefetch_distance > 0 ? rec->prefetch_distance : 8;
+    params->prefetch_locality = rec->prefetch_distance > 0 ? rec->prefetch_locality : 3;
+    params->indirect = hotspot->dominant_pattern == RANDOM ||
+                       hotspot->dominant_pattern == GATHER_SCATTER ||
+                       hotspot->dominant_pattern == INDIRECT_ACCESS;
+    
+    params->tile = rec->text_id == REC_TEXT_LOOP_TILING && rec->text_args[0] >= 4 ?
+                   (int)rec->text_args[0] : 32;
+    
+    // Only one field of each struct is used: fields ~ line bytes / used bytes
+    double wasted = rec->text_id == REC_TEXT_DATA_LAYOUT ? rec->text_args[0] : 75.0;
+    int fields = wasted < 100 ? (int)lround(100.0 / (100.0 - wasted)) : 16;
+    params->fields = fields < 2 ? 2 : fields > 16 ? 16 : fields;
+    return 0;
+}
+
+static void write_prologue(FILE *fp, const optimization_rec_t *rec, const microkernel_params_t *p,
+                           int passes) {
+    const source_location_t *loc = &rec->pattern->hotspot->location;
+    fprintf(fp, "// Microkernel generated by cacheSight for %s at %s:%d\n",
+            optimization_type_to_string(rec->type), loc->file, loc->line);
+    fprintf(fp, "#include <stdio.h>\n#include <stdlib.h>\n#include <stdint.h>\n#include <time.h>\n");
+    fprintf(fp, "#ifdef __SSE2__\n#include <emmintrin.h>\n#endif\n\n");
+    fprintf(fp, "#ifndef TRANSFORMED\n#define TRANSFORMED 0\n#endif\n");
+    fprintf(fp, "#define KERNEL_PASSES %d\n", passes);
+    fprintf(fp, "#define FOOTPRINT %zuUL\n", p->footprint_bytes);
+    fprintf(fp, "#define WORK_OPS %d\n\n", p->work_ops);
+    fprintf(fp, "// Loop body cost from the loop model\n"
+                "#define WORK(v) for (int w = 0; w < WORK_OPS; w++) v = v * 0.999999 + 0.5\n\n");
+    fprintf(fp, "static double now_ns(void) {\n"
+                "    struct timespec ts;\n"
+                "    clock_gettime(CLOCK_MONOTONIC, &ts);\n"
+                "    return ts.tv_sec * 1e9 + ts.tv_nsec;\n"
+                "}\n\n");
+    fprintf(fp, "static uint64_t lcg = 88172645463325252ULL;\n"
+                "static uint64_t next_random(void) {\n"
+                "    lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;\n"
+                "    return lcg >> 17;\n"
+                "}\n\n");
+}
+
+// Strided or indirect stream; the transformed form prefetches DIST iterations ahead
+static void write_prefetch_kernel(FILE *fp, const microkernel_params_t *p) {
+    fprintf(fp, "#define STRIDE %d\n#define DIST %d\n#define LOCALITY %d\n",
+            p->stride_bytes / 8 > 0 ? p->stride_bytes / 8 : 1, p->prefetch_distance, p->prefetch_locality);
+    fprintf(fp, "#define N (FOOTPRINT / sizeof(double))\n");
+    if (p->indirect) {
+        fprintf(fp, "#define COUNT (N / STRIDE)\n"
+                    "static double *data;\n"
+                    "static size_t *idx;\n\n"
+                    "static void setup(void) {\n"
+                    "    data = malloc(N * sizeof(double));\n"
+                    "    idx = malloc((COUNT + DIST) * sizeof(size_t));\n"
+                    "    for (size_t i = 0; i < N; i++) data[i] = (double)(i %% 7) * 0.25;\n"
+                    "    for (size_t i = 0; i < COUNT + DIST; i++) idx[i] = next_random() %% N;\n"
+                    "}\n\n"
+                    "static double kernel(void) {\n"
+                    "    double acc = 0;\n"
+                    "    for (size_t i = 0; i < COUNT; i++) {\n"
+                    "#if TRANSFORMED\n"
+                    "        __builtin_prefetch(&data[idx[i + DIST]], 0, LOCALITY);\n"
+                    "#endif\n"
+                    "        double v = data[idx[i]];\n"
+                    "        WORK(v);\n"
+                    "        acc += v;\n"
+                    "    }\n"
+                    "    return acc;\n"
+                    "}\n\n");
+    } else {
+        fprintf(fp, "static double *data;\n\n"
+                    "static void setup(void) {\n"
+                    "    data = malloc((N + (DIST + 1) * STRIDE) * sizeof(double));\n"
+                    "    for (size_t i = 0; i < N + (DIST + 1) * STRIDE; i++) data[i] = (double)(i %% 7) * 0.25;\n"
+                    "}\n\n"
+                    "static double kernel(void) {\n"
+                    "    double acc = 0;\n"
+                    "    for (size_t i = 0; i < N; i += STRIDE) {\n"
+                    "#if TRANSFORMED\n"
+                    "        __builtin_prefetch(&data[i + DIST * STRIDE], 0, LOCALITY);\n"
+                    "#endif\n"
+                    "        double v = data[i];\n"
+                    "        WORK(v);\n"
+                    "        acc += v;\n"
+                    "    }\n"
+                    "    return acc;\n"
+                    "}\n\n");
+    }
+}
+
+// Column walk over a square matrix: tiled, or interchanged to a row walk
+static void write_matrix_kernel(FILE *fp, const microkernel_params_t *p, bool interchange) {
+    int n = (int)sqrt((double)p->footprint_bytes / (2 * sizeof(double)));
+    fprintf(fp, "#define DIM %d\n#define TILE %d\n", n, p->tile);
+    fprintf(fp, "#define MIN(a, b) ((a) < (b) ? (a) : (b))\n"
+                "static double *a, *b;\n\n"
+                "static void setup(void) {\n"
+                "    a = malloc((size_t)DIM * DIM * sizeof(double));\n"
+                "    b = malloc((size_t)DIM * DIM * sizeof(double));\n"
+                "    for (size_t i = 0; i < (size_t)DIM * DIM; i++) {\n"
+                "        a[i] = (double)(i %% 7) * 0.25;\n"
+                "        b[i] = 0;\n"
+                "    }\n"
+                "}\n\n");
+    if (interchange) {
+        fprintf(fp, "static double kernel(void) {\n"
+                    "    double acc = 0;\n"
+                    "#if TRANSFORMED\n"
+                    "    for (size_t j = 0; j < DIM; j++)\n"
+                    "        for (size_t i = 0; i < DIM; i++) {\n"
+                    "#else\n"
+                    "    for (size_t i = 0; i < DIM; i++)\n"
+                    "        for (size_t j = 0; j < DIM; j++) {\n"
+                    "#endif\n"
+                    "            double v = a[j * DIM + i];\n"
+                    "            WORK(v);\n"
+                    "            acc += v;\n"
+                    "        }\n"
+                    "    return acc;\n"
+                    "}\n\n");
+    } else {
+        fprintf(fp, "static double kernel(void) {\n"
+                    "#if TRANSFORMED\n"
+                    "    for (size_t ii = 0; ii < DIM; ii += TILE)\n"
+                    "        for (size_t jj = 0; jj < DIM; jj += TILE)\n"
+                    "            for (size_t i = ii; i < MIN(ii + TILE, DIM); i++)\n"
+                    "                for (size_t j = jj; j < MIN(jj + TILE, DIM); j++) {\n"
+                    "#else\n"
+                    "    for (size_t i = 0; i < DIM; i++)\n"
+                    "        for (size_t j = 0; j < DIM; j++) {\n"
+                    "#endif\n"
+                    "            double v = a[j * DIM + i];\n"
+                    "            WORK(v);\n"
+                    "            b[i * DIM + j] += v;\n"
+                    "        }\n"
+                    "    return b[DIM / 2];\n"
+                    "}\n\n");
+    }
+}
+
+// One hot field read from an array of structs, or from its own array
+static void write_layout_kernel(FILE *fp, const microkernel_params_t *p) {
+    fprintf(fp, "#define FIELDS %d\n#define N (FOOTPRINT / (FIELDS * sizeof(double)))\n", p->fields);
+    fprintf(fp, "typedef struct { double f[FIELDS]; } record_t;\n"
+                "#if TRANSFORMED\n"
+                "static double *hot;\n"
+                "#else\n"
+                "static record_t *records;\n"
+                "#endif\n\n"
+                "static void setup(void) {\n"
+                "#if TRANSFORMED\n"
+                "    hot = malloc(N * sizeof(double));\n"
+                "    for (size_t i = 0; i < N; i++) hot[i] = (double)(i %% 7) * 0.25;\n"
+                "#else\n"
+                "    records = malloc(N * sizeof(record_t));\n"
+                "    for (size_t i = 0; i < N; i++)\n"
+                "        for (int f = 0; f < FIELDS; f++) records[i].f[f] = (double)(i %% 7) * 0.25;\n"
+                "#endif\n"
+                "}\n\n"
+                "static double kernel(void) {\n"
+                "    double acc = 0;\n"
+                "    for (size_t i = 0; i < N; i++) {\n"
+                "#if TRANSFORMED\n"
+                "        double v = hot[i];\n"
+                "#else\n"
+                "        double v = records[i].f[0];\n"
+                "#endif\n"
+                "        WORK(v);\n"
+                "        acc += v;\n"
+                "    }\n"
+                "    return acc;\n"
+                "}\n\n");
+}
+
+// Write-only stream; streaming stores skip the read-for-ownership
+static void write_nontemporal_kernel(FILE *fp) {
+    fprintf(fp, "#define N (FOOTPRINT / sizeof(double))\n"
+                "static double *data;\n\n"
+                "static void setup(void) {\n"
+                "    data = aligned_alloc(64, N * sizeof(double));\n"
+                "}\n\n"
+                "static double kernel(void) {\n"
+                "#if TRANSFORMED && defined(__SSE2__)\n"
+                "    for (size_t i = 0; i + 1 < N; i += 2)\n"
+                "        _mm_stream_pd(&data[i], _mm_set_pd((double)(i + 1) * 0.5, (double)i * 0.5));\n"
+                "    _mm_sfence();\n"
+                "#else\n"
+                "    for (size_t i = 0; i < N; i++) data[i] = (double)i * 0.5;\n"
+                "#endif\n"
+                "    return data[N / 2];\n"
+                "}\n\n");
+}
+
+// 64-byte records read whole, either straddling two lines or line aligned
+static void write_alignment_kernel(FILE *fp) {
+    fprintf(fp, "#define RECORD_DOUBLES 8\n"
+                "#define N (FOOTPRINT / 64)\n"
+                "#if TRANSFORMED\n#define OFFSET 0\n#else\n#define OFFSET 4\n#endif\n"
+                "static double *data;\n\n"
+                "static void setup(void) {\n"
+                "    double *raw = aligned_alloc(64, (N + 1) * 64);\n"
+                "    for (size_t i = 0; i < (N + 1) * RECORD_DOUBLES; i++) raw[i] = (double)(i %% 7) * 0.25;\n"
+                "    data = raw + OFFSET;\n"
+                "}\n\n"
+                "static double kernel(void) {\n"
+                "    double acc = 0;\n"
+                "    for (size_t r = 0; r < N; r++) {\n"
+                "        const double *rec = &data[r * RECORD_DOUBLES];\n"
+                "        double v = 0;\n"
+                "        for (int f = 0; f < RECORD_DOUBLES; f++) v += rec[f];\n"
+                "        WORK(v);\n"
+                "        acc += v;\n"
+                "    }\n"
+                "    return acc;\n"
+                "}\n\n");
+}
+
+// Linked list walk: nodes scattered by separate allocations, or contiguous in a pool
+static void write_pool_kernel(FILE *fp) {
+    fprintf(fp, "typedef struct node { struct node *next; double value; char pad[48]; } node_t;\n"
+                "#define N (FOOTPRINT / sizeof(node_t))\n"
+                "static node_t *head;\n\n"
+                "static void setup(void) {\n"
+                "    node_t *pool = malloc(N * sizeof(node_t));\n"
+                "    size_t *order = malloc(N * sizeof(size_t));\n"
+                "    for (size_t i = 0; i < N; i++) order[i] = i;\n"
+                "#if !TRANSFORMED\n"
+                "    for (size_t i = N - 1; i > 0; i--) {\n"
+                "        size_t j = next_random() %% (i + 1);\n"
+                "        size_t t = order[i]; order[i] = order[j]; order[j] = t;\n"
+                "    }\n"
+                "#endif\n"
+                "    for (size_t i = 0; i < N; i++) {\n"
+                "        pool[order[i]].value = (double)(i %% 7) * 0.25;\n"
+                "        pool[order[i]].next = i + 1 < N ? &pool[order[i + 1]] : NULL;\n"
+                "    }\n"
+                "    head = &pool[order[0]];\n"
+                "    free(order);\n"
+                "}\n\n"
+                "static double kernel(void) {\n"
+                "    double acc = 0;\n"
+                "    for (const node_t *n = head; n; n = n->next) {\n"
+                "        double v = n->value;\n"
+                "        WORK(v);\n"
+                "        acc += v;\n"
+                "    }\n"
+                "    return acc;\n"
+                "}\n\n");
+}
+
+int microkernel_write(const optimization_rec_t *rec, const microkernel_params_t *params,
+                     int passes, const char *path) {
+    if (!rec || !params || !path || !rec->pattern || !rec->pattern->hotspot) return -1;
+    if (!has_kernel_model(rec->type)) return -1;
+    
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        LOG_ERROR("Failed to create microkernel %s: %s", path, strerror(errno));
+        return -1;
+    }
+    
+    write_prologue(fp, rec, params, passes);
+    switch (rec->type) {
+        case OPT_PREFETCH_HINTS:
+            write_prefetch_kernel(fp, params);
+            break;
+        case OPT_LOOP_TILING:
+        case OPT_CACHE_BLOCKING:
+            write_matrix_kernel(fp, params, false);
+            break;
+        case OPT_ACCESS_REORDER:
+            write_matrix_kernel(fp, params, true);
+            break;
+        case OPT_DATA_LAYOUT_CHANGE:
+            write_layout_kernel(fp, params);
+            break;
+        case OPT_NONTEMPORAL_STORES:
+            write_nontemporal_kernel(fp);
+            break;
+        case OPT_MEMORY_ALIGNMENT:
+            write_alignment_kernel(fp);
+            break;
+        default:
+            write_pool_kernel(fp);
+            break;
+    }
+    
+    // Same output contract as the tile kernels: best pass in ns, then a checksum
+    fprintf(fp, "int main(void) {\n"
+                "    setup();\n"
+                "    double checksum = kernel();\n"
+                "    double best = 1e300;\n"
+                "    for (int pass = 0; pass < KERNEL_PASSES; pass++) {\n"
+                "        double start = now_ns();\n"
+                "        checksum += kernel();\n"
+                "        double elapsed = now_ns() - start;\n"
+                "        if (elapsed < best) best = elapsed;\n"
+                "    }\n"
+                "    printf(\"%%.0f %%g\\n\", best, checksum);\n"
+                "    return 0;\n"
+                "}\n");
+    
+    fclose(fp);
+    return 0;
+}
+
+static double mean_of(const double *values, int count) {
+    double sum = 0;
+    for (int i = 0; i < count; i++) sum += values[i];
+    return count > 0 ? sum / count : 0;
+}
+
+int microkernel_validate(optimization_rec_t *rec, const cache_info_t *cache_info,
+                        const autotuner_config_t *config, evaluator_t *evaluator,
+                        microkernel_result_t *result) {
+    if (!rec || !cache_info || !config || !evaluator || !result) {
+        LOG_ERROR("NULL parameters in microkernel_validate");
+        return -1;
+    }
+    
+    memset(result, 0, sizeof(microkernel_result_t));
+    result->type = rec->type;
+    if (rec->pattern && rec->pattern->hotspot) result->location = rec->pattern->hotspot->location;
+    
+    if (!has_kernel_model(rec->type)) {
+        snprintf(result->notes, sizeof(result->notes), "no kernel model for %s",
+                 optimization_type_to_string(rec->type));
+        return -1;
+    }
+    if (microkernel_params_from_rec(rec, cache_info, &result->params) != 0) {
+        snprintf(result->notes, sizeof(result->notes), "recommendation has no hotspot");
+        return -1;
+    }
+    
+    // Kernel files are per call; validations may run concurrently
+    static atomic_int kernel_id;
+    int id = atomic_fetch_add(&kernel_id, 1);
+    mkdir(config->work_dir, 0755);
+    snprintf(result->kernel_path, sizeof(result->kernel_path), "%s/micro_%d_%s.c",
+             config->work_dir, id, optimization_type_to_string(rec->type));
+    if (microkernel_write(rec, &result->params, config->passes, result->kernel_path) != 0) {
+        snprintf(result->notes, sizeof(result->notes), "failed to write kernel");
+        return -1;
+    }
+    
+    char baseline_bin[600], transformed_bin[600];
+    snprintf(baseline_bin, sizeof(baseline_bin), "%s/micro_%d_base", config->work_dir, id);
+    snprintf(transformed_bin, sizeof(transformed_bin), "%s/micro_%d_opt", config->work_dir, id);
+    if (autotune_build_kernel(config, result->kernel_path, baseline_bin, config->cflags, "-DTRANSFORMED=0") != 0 ||
+        autotune_build_kernel(config, result->kernel_path, transformed_bin, config->cflags, "-DTRANSFORMED=1") != 0) {
+        snprintf(result->notes, sizeof(result->notes), "kernel does not compile");
+        remove(baseline_bin);
+        return -1;
+    }
+    
+    autotuner_config_t runs = *config;
+    runs.repetitions = config->comparison_repetitions;
+    double baseline_times[32], transformed_times[32];
+    int baseline_count = autotune_sample_kernel(&runs, baseline_bin, baseline_times, 32, NULL);
+    int transformed_count = autotune_sample_kernel(&runs, transformed_bin, transformed_times, 32, NULL);
+    remove(baseline_bin);
+    remove(transformed_bin);
+    
+    if (baseline_count < 2 || transformed_count < 2) {
+        snprintf(result->notes, sizeof(result->notes), "kernel failed to run");
+        return -1;
+    }
+    
+    result->baseline_ns = mean_of(baseline_times, baseline_count);
+    result->transformed_ns = mean_of(transformed_times, transformed_count);
+    if (evaluator_compare_performance(evaluator, baseline_times, baseline_count,
+                                      transformed_times, transformed_count,
+                                      &result->speedup, &result->p_value) != 0 ||
+        evaluator_speedup_interval(evaluator, baseline_times, baseline_count,
+                                   transformed_times, transformed_count,
+                                   &result->ci_low, &result->ci_high) != 0) {
+        return -1;
+    }
+    
+    result->confidence_level = evaluator_confidence_level(evaluator);
+    
+    // Significant when the interval excludes 1 in either direction
+    result->significant = result->ci_low > 1.0 || result->ci_high < 1.0;
+    result->valid = true;
+    
+    rec->measured_speedup = result->speedup;
+    rec->speedup_ci_low = result->ci_low;
+    rec->speedup_ci_high = result->ci_high;
+    return 0;
+}
+
+int microkernel_validate_top(optimization_rec_t *recs, int rec_count, int max_recs,
+                            const cache_info_t *cache_info, const autotuner_config_t *config,
+                            microkernel_result_t **results, int *result_count) {
+    if (!recs || !cache_info || !config || !results || !result_count) {
+        LOG_ERROR("NULL parameters in microkernel_validate_top");
+        return -1;
+    }
+    
+    *results = NULL;
+    *result_count = 0;
+    if (rec_count <= 0 || max_recs <= 0) return 0;
+    
+    int limit = rec_count < max_recs ? rec_count : max_recs;
+    *results = CALLOC_LOGGED(limit, sizeof(microkernel_result_t));
+    if (!*results) return -1;
+    
+    evaluator_config_t eval_config = evaluator_config_default();
+    evaluator_t *evaluator = evaluator_create(&eval_config, cache_info);
+    if (!evaluator) {
+        FREE_LOGGED(*results);
+        *results = NULL;
+        return -1;
+    }
+    
+    for (int i = 0; i < limit; i++) {
+        microkernel_result_t *result = &(*results)[(*result_count)++];
+        if (microkernel_validate(&recs[i], cache_info, config, evaluator, result) != 0) {
+            LOG_INFO("Recommendation %d (%s) not measured: %s", i + 1,
+                     optimization_type_to_string(recs[i].type), result->notes);
+        }
+    }
+    
+    evaluator_destroy(evaluator);
+    return *result_count;
+}
+
+void microkernel_print_result(const microkernel_result_t *result) {
+    if (!result) return;
+    
+    printf("\n=== Microkernel: %s at %s:%d ===\n", optimization_type_to_string(result->type),
+           result->location.file, result->location.line);
+    if (!result->valid) {
+        printf("Not measured: %s\n", result->notes);
+        return;
+    }
+    
+    char footprint[32];
+    format_bytes(result->params.footprint_bytes, footprint, sizeof(footprint));
+    printf("Kernel: %s (footprint %s, stride %d bytes, %d work ops)\n", result->kernel_path,
+           footprint, result->params.stride_bytes, result->params.work_ops);
+    printf("Baseline: %.3f ms, transformed: %.3f ms\n",
+           result->baseline_ns / 1e6, result->transformed_ns / 1e6);
+    printf("Speedup: %.2fx (%.0f%% CI %.2f-%.2f, p=%.4f)%s\n", result->speedup,
+           result->confidence_level * 100, result->ci_low, result->ci_high, result->p_value,
+           result->significant ? "" : "  not significant");
+}
@@ -0,0 +1,60 @@
+#ifndef MICROKERNEL_H
+#define MICROKERNEL_H
+
+#include "common.h"
+#include "hardware_detector.h"
+#include "recommendation_engine.h"
+#include "tile_autotuner.h"
+#include "evaluator.h"
+
+// Parameters of a generated kernel, taken from the hotspot and the recommendation
+typedef struct {
+    size_t footprint_bytes;         // Data the kernel sweeps per pass
+    int stride_bytes;
+    int work_ops;                   // Dependent FP ops per iteration, from the loop model
+    int prefetch_distance;
+    int prefetch_locality;
+    int tile;                       // Tile edge for tiling and blocking kernels
+    int fields;                     // Struct fields for the layout kernel
+    bool indirect;                  // Random or gather access through an index array
+} microkernel_params_t;
+
+// Measured outcome for one recommendation
+typedef struct {
+    optimization_type_t type;
+    source_location_t location;
+    microkernel_params_t params;
+    char kernel_path[512];
+    double baseline_ns;             // Mean pass time of the original form
+    double transformed_ns;
+    double speedup;
+    double ci_low;                  // Confidence interval of the speedup
+    double ci_high;
+    double confidence_level;        // Of the interval, from the evaluator
+    double p_value;
+    bool significant;
+    bool valid;
+    char notes[256];                // Why a recommendation could not be measured
+} microkernel_result_t;
+
+// API functions
+int microkernel_params_from_rec(const optimization_rec_t *rec, const cache_info_t *cache_info,
+                               microkernel_params_t *params);
+
+// Write one source with the baseline and, behind -DTRANSFORMED=1, the transformed form
+int microkernel_write(const optimization_rec_t *rec, const microkernel_params_t *params,
+                     int passes, const char *path);
+
+// Build and time both forms, then attach the speedup and its interval to rec
+int microkernel_validate(optimization_rec_t *rec, const cache_info_t *cache_info,
+                        const autotuner_config_t *config, evaluator_t *evaluator,
+                        microkernel_result_t *result);
+
+// Validate the first max_recs recommendations (callers rank them first)
+int microkernel_validate_top(optimization_rec_t *recs, int rec_count, int max_recs,
+                            const cache_info_t *cache_info, const autotuner_config_t *config,
+                            microkernel_result_t **results, int *result_count);
+
+void microkernel_print_result(const microkernel_result_t *result);
+
+#endif // MICROKERNEL_H
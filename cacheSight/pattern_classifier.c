@@ -1,4 +1,5 @@
 #include "pattern_classifier.h"
+#include "stage_trace.h"
 #include <math.h>
 
 // Internal classifier structure
@@ -251,8 +252,8 @@ int pattern_classifier_classify_hotspot(pattern_classifier_t *classifier,
     // Check for specific antipatterns that override the basic classification
     double fs_severity, thrash_severity, stream_severity;
     
-    // Check for false sharing
-    if (hotspot->is_false_sharing || detect_false_sharing_pattern(hotspot, &fs_severity)) {
+    // Check for false sharing; the detector scores flagged hotspots too
+    if (detect_false_sharing_pattern(hotspot, &fs_severity)) {
         if (fs_severity > pattern->severity_score) {
             pattern->type = FALSE_SHARING;
             pattern->severity_score = fs_severity;
@@ -331,6 +332,8 @@ int pattern_classifier_classify_all(pattern_classifier_t *classifier,
         LOG_ERROR("Invalid parameters for classify_all");
         return -1;
     }
+    TRACE_SCOPE(trace, "classifier.classify_all");
+    trace_add_items(&trace, hotspot_count);
     
     LOG_INFO("Classifying %d hotspots", hotspot_count);
     
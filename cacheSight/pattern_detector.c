@@ -1,51 +1,57 @@
 #include "pattern_detector.h"
 #include <math.h>
 
-static pattern_config_t g_config = {
-    .detect_spatial_locality = true,
-    .detect_temporal_locality = true,
-    .detect_indirect_access = true,
-    .detect_pointer_chasing = true,
-    .min_stride_threshold = 1,
-    .max_stride_threshold = 256
+struct pattern_detector {
+    pattern_config_t config;
 };
 
-static bool g_initialized = false;
+pattern_config_t pattern_config_default(void) {
+    pattern_config_t config = {
+        .detect_spatial_locality = true,
+        .detect_temporal_locality = true,
+        .detect_indirect_access = true,
+        .detect_pointer_chasing = true,
+        .min_stride_threshold = 1,
+        .max_stride_threshold = 256
+    };
+    return config;
+}
 
-int pattern_detector_init(const pattern_config_t *config) {
-    if (g_initialized) {
-        LOG_WARNING("Pattern detector already initialized");
-        return 0;
-    }
-    
-    if (config) {
-        g_config = *config;
+pattern_detector_t* pattern_detector_create(const pattern_config_t *config) {
+    pattern_detector_t *detector = CALLOC_LOGGED(1, sizeof(pattern_detector_t));
+    if (!detector) {
+        LOG_ERROR("Failed to allocate pattern detector");
+        return NULL;
     }
     
-    LOG_INFO("Pattern detector initialized - spatial: %s, temporal: %s, indirect: %s",
-             g_config.detect_spatial_locality ? "yes" : "no",
-             g_config.detect_temporal_locality ? "yes" : "no",
-             g_config.detect_indirect_access ? "yes" : "no");
+    detector->config = config ? *config : pattern_config_default();
     
-    g_initialized = true;
-    return 0;
+    LOG_INFO("Pattern detector created - spatial: %s, temporal: %s, indirect: %s",
+             detector->config.detect_spatial_locality ? "yes" : "no",
+             detector->config.detect_temporal_locality ? "yes" : "no",
+             detector->config.detect_indirect_access ? "yes" : "no");
+    return detector;
 }
 
-void pattern_detector_cleanup(void) {
-    if (!g_initialized) {
-        return;
-    }
+void pattern_detector_destroy(pattern_detector_t *detector) {
+    if (!detector) return;
     
-    LOG_INFO("Pattern detector cleanup");
-    g_initialized = false;
+    LOG_INFO("Destroying pattern detector");
+    FREE_LOGGED(detector);
 }
 
-int detect_access_pattern(const static_pattern_t *pattern, pattern_detail_t *detail) {
-    if (!pattern || !detail) {
+int detect_access_pattern(const pattern_detector_t *detector, const static_pattern_t *pattern,
+                          pattern_detail_t *detail) {
+    if (!detector || !pattern || !detail) {
         LOG_ERROR("NULL parameter passed to detect_access_pattern");
         return -1;
     }
     
+    // Disabled pattern kinds are not reported
+    if (pattern->pattern == INDIRECT_ACCESS && !detector->config.detect_indirect_access) {
+        return 1;
+    }
+    
     memset(detail, 0, sizeof(pattern_detail_t));
     detail->type = pattern->pattern;
     
@@ -149,8 +155,9 @@ int detect_access_pattern(const static_pattern_t *pattern, pattern_detail_t *det
     return 0;
 }
 
-int detect_loop_patterns(const loop_info_t *loop, pattern_detail_t *details, int max_details) {
-    if (!loop || !details || max_details <= 0) {
+int detect_loop_patterns(const pattern_detector_t *detector, const loop_info_t *loop,
+                         pattern_detail_t *details, int max_details) {
+    if (!detector || !loop || !details || max_details <= 0) {
         LOG_ERROR("Invalid parameters for detect_loop_patterns");
         return -1;
     }
@@ -162,7 +169,7 @@ int detect_loop_patterns(const loop_info_t *loop, pattern_detail_t *details, int
     
     // Analyze each pattern in the loop
     for (int i = 0; i < loop->pattern_count && detected_count < max_details; i++) {
-        if (detect_access_pattern(&loop->patterns[i], &details[detected_count]) == 0) {
+        if (detect_access_pattern(detector, &loop->patterns[i], &details[detected_count]) == 0) {
             
             // Additional loop-specific analysis
             if (loop->has_nested_loops) {
@@ -216,10 +223,11 @@ int detect_loop_patterns(const loop_info_t *loop, pattern_detail_t *details, int
     return detected_count;
 }
 
-int detect_struct_access_patterns(const struct_info_t *struct_info, 
+int detect_struct_access_patterns(const pattern_detector_t *detector,
+                                 const struct_info_t *struct_info, 
                                  const static_pattern_t *accesses, int access_count,
                                  pattern_detail_t *detail) {
-    if (!struct_info || !accesses || !detail || access_count <= 0) {
+    if (!detector || !struct_info || !accesses || !detail || access_count <= 0) {
         LOG_ERROR("Invalid parameters for detect_struct_access_patterns");
         return -1;
     }
@@ -25,13 +25,20 @@ typedef struct {
     int cache_line_utilization;  // Percentage
 } pattern_detail_t;
 
-// API functions
-int pattern_detector_init(const pattern_config_t *config);
-void pattern_detector_cleanup(void);
+// Detector context; independent detectors can run on separate threads
+typedef struct pattern_detector pattern_detector_t;
 
-int detect_access_pattern(const static_pattern_t *pattern, pattern_detail_t *detail);
-int detect_loop_patterns(const loop_info_t *loop, pattern_detail_t *details, int max_details);
-int detect_struct_access_patterns(const struct_info_t *struct_info, 
+// API functions
+pattern_detector_t* pattern_detector_create(const pattern_config_t *config);
+void pattern_detector_destroy(pattern_detector_t *detector);
+
+// Returns 1 when the pattern's kind is disabled in the config
+int detect_access_pattern(const pattern_detector_t *detector, const static_pattern_t *pattern,
+                          pattern_detail_t *detail);
+int detect_loop_patterns(const pattern_detector_t *detector, const loop_info_t *loop,
+                         pattern_detail_t *details, int max_details);
+int detect_struct_access_patterns(const pattern_detector_t *detector,
+                                 const struct_info_t *struct_info, 
                                  const static_pattern_t *accesses, int access_count,
                                  pattern_detail_t *detail);
 
@@ -42,6 +49,7 @@ int calculate_spatial_locality_score(const static_pattern_t *patterns, int count
 int calculate_temporal_locality_score(const static_pattern_t *patterns, int count);
 
 // Helper functions
+pattern_config_t pattern_config_default(void);
 const char* get_optimization_suggestion(access_pattern_t pattern);
 int estimate_cache_efficiency(const static_pattern_t *pattern, int cache_line_size);
 
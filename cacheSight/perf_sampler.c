@@ -1,9 +1,11 @@
 #include "perf_sampler.h"
+#include "stage_trace.h"
 #include <perfmon/pfmlib.h>
 #include <perfmon/pfmlib_perf_event.h>
 #include <sys/mman.h>
 #include <poll.h>
 #include <signal.h>
+#include <limits.h>
 //#include <linux/perf_event.h>
 
 #define MMAP_PAGES 256  // Number of pages for ring buffer
@@ -27,6 +29,15 @@ struct perf_sampler {
     pthread_t sampling_thread;
     pthread_mutex_t samples_mutex;
     bool stop_requested;
+    
+    // Process of config.target_binary, found from the sampled pids
+    char target_path[PATH_MAX];     // Canonical, as /proc/<pid>/exe reads
+    pid_t target_pid;
+    memory_mapping_t *target_maps;  // Snapshot taken when the process was found
+    int target_map_count;
+    pid_t rejected_pids[64];        // Recently checked non-target pids
+    int rejected_count;
+    pid_t self_pid;                 // The tool itself; never part of the profile
 };
 
 // Global initialization flag
@@ -55,11 +66,14 @@ static void parse_perf_sample(struct perf_event_header *header,
     // This is a simplified parser - real implementation would handle
     // various sample formats based on perf_event_attr configuration
     
+    // Fields appear in perf's fixed order: IP, TID, TIME, ADDR, CPU
     struct {
         struct perf_event_header header;
         uint64_t ip;
-        uint64_t addr;
+        uint32_t pid;
+        uint32_t tid;
         uint64_t time;
+        uint64_t addr;
         uint32_t cpu;
         uint32_t res;
     } *data = (void *)header;
@@ -69,14 +83,47 @@ static void parse_perf_sample(struct perf_event_header *header,
         sample->memory_addr = data->addr;
         sample->timestamp = data->time;
         sample->cpu_id = data->cpu;
+        sample->pid = data->pid;
         
         // These would need proper parsing from sample data
         sample->cache_level_missed = 1;  // Default to L1
         sample->is_write = false;
         sample->access_size = 8;
         sample->latency_cycles = 0;
-        sample->tid = 0;
+        sample->tid = data->tid;
+    }
+}
+
+// Without a target binary every sample is kept. Otherwise only samples of
+// the first process found running it, whose mappings are captured right
+// away since it may exit before its samples are resolved.
+static bool is_target_sample(perf_sampler_t *sampler, pid_t pid) {
+    // Events are system-wide; the tool's own parsing runs while it samples
+    if (pid == sampler->self_pid) return false;
+    if (!sampler->target_path[0]) return true;
+    if (sampler->target_pid) return pid == sampler->target_pid;
+    
+    int remembered = sampler->rejected_count < 64 ? sampler->rejected_count : 64;
+    for (int i = 0; i < remembered; i++) {
+        if (sampler->rejected_pids[i] == pid) return false;
+    }
+    
+    char link[64];
+    char exe[PATH_MAX];
+    snprintf(link, sizeof(link), "/proc/%d/exe", pid);
+    ssize_t length = readlink(link, exe, sizeof(exe) - 1);
+    if (length > 0) {
+        exe[length] = '\0';
+        if (strcmp(exe, sampler->target_path) == 0 &&
+            address_resolver_read_maps(pid, &sampler->target_maps, &sampler->target_map_count) == 0) {
+            sampler->target_pid = pid;
+            LOG_INFO("Profiling process %d (%s)", pid, exe);
+            return true;
+        }
     }
+    
+    sampler->rejected_pids[sampler->rejected_count++ % 64] = pid;
+    return false;
 }
 
 // Sampling thread function
@@ -130,19 +177,24 @@ static void* sampling_thread_func(void *arg) {
                     metadata->data_offset + (tail & (sampler->mmap_size - 1)));
                 
                 if (header->type == PERF_RECORD_SAMPLE) {
-                    pthread_mutex_lock(&sampler->samples_mutex);
+                    cache_miss_sample_t sample;
+                    memset(&sample, 0, sizeof(sample));
+                    parse_perf_sample(header, &sample);
                     
-                    if (sampler->sample_count < sampler->config.max_samples) {
-                        parse_perf_sample(header, 
-                                         &sampler->samples[sampler->sample_count]);
-                        sampler->sample_count++;
+                    if (is_target_sample(sampler, sample.pid)) {
+                        pthread_mutex_lock(&sampler->samples_mutex);
                         
-                        if (sampler->sample_count % 1000 == 0) {
-                            LOG_DEBUG("Collected %d samples", sampler->sample_count);
+                        if (sampler->sample_count < sampler->config.max_samples) {
+                            sampler->samples[sampler->sample_count] = sample;
+                            sampler->sample_count++;
+                            
+                            if (sampler->sample_count % 1000 == 0) {
+                                LOG_DEBUG("Collected %d samples", sampler->sample_count);
+                            }
                         }
+                        
+                        pthread_mutex_unlock(&sampler->samples_mutex);
                     }
-                    
-                    pthread_mutex_unlock(&sampler->samples_mutex);
                 }
                 
                 tail += header->size;
@@ -194,6 +246,13 @@ perf_sampler_t* perf_sampler_create(const perf_config_t *config) {
     sampler->config = *config;
     pthread_mutex_init(&sampler->samples_mutex, NULL);
     
+    if (config->target_binary[0] && !realpath(config->target_binary, sampler->target_path)) {
+        LOG_ERROR("Cannot resolve target binary %s: %s", config->target_binary, strerror(errno));
+        pthread_mutex_destroy(&sampler->samples_mutex);
+        FREE_LOGGED(sampler);
+        return NULL;
+    }
+    
     // Allocate sample buffer
     sampler->sample_capacity = config->max_samples;
     sampler->samples = CALLOC_LOGGED(sampler->sample_capacity, sizeof(cache_miss_sample_t));
@@ -230,7 +289,7 @@ perf_sampler_t* perf_sampler_create(const perf_config_t *config) {
                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
         .sample_period = config->sample_period,
-        .sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_ADDR | 
+        .sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_ADDR |
                       PERF_SAMPLE_TIME | PERF_SAMPLE_CPU,
         .disabled = 1,
         .exclude_kernel = !config->include_kernel,
@@ -321,6 +380,7 @@ void perf_sampler_destroy(perf_sampler_t *sampler) {
     if (sampler->samples) {
         FREE_LOGGED(sampler->samples);
     }
+    address_resolver_free_mappings(sampler->target_maps);
     
     pthread_mutex_destroy(&sampler->samples_mutex);
     FREE_LOGGED(sampler);
@@ -340,8 +400,23 @@ int perf_sampler_start(perf_sampler_t *sampler) {
     
     LOG_INFO("Starting perf sampling");
     
+    // The previous buffer may have been taken by perf_sampler_take_samples
+    if (!sampler->samples) {
+        sampler->samples = CALLOC_LOGGED(sampler->sample_capacity, sizeof(cache_miss_sample_t));
+        if (!sampler->samples) {
+            LOG_ERROR("Failed to allocate sample buffer");
+            return -1;
+        }
+    }
+    
     // Reset state
     sampler->sample_count = 0;
+    address_resolver_free_mappings(sampler->target_maps);
+    sampler->target_maps = NULL;
+    sampler->target_map_count = 0;
+    sampler->target_pid = 0;
+    sampler->rejected_count = 0;
+    sampler->self_pid = getpid();
     sampler->stop_requested = false;
     sampler->start_time = get_timestamp();
     
@@ -421,6 +496,7 @@ int perf_sampler_get_samples(perf_sampler_t *sampler,
         LOG_ERROR("Invalid parameters for perf_sampler_get_samples");
         return -1;
     }
+    TRACE_SCOPE(trace, "sampler.get_samples");
     
     pthread_mutex_lock(&sampler->samples_mutex);
     
@@ -445,6 +521,72 @@ int perf_sampler_get_samples(perf_sampler_t *sampler,
     return 0;
 }
 
+// Hand the sample buffer to the caller instead of copying it
+int perf_sampler_take_samples(perf_sampler_t *sampler,
+                             cache_miss_sample_t **samples, int *count) {
+    if (!sampler || !samples || !count) {
+        LOG_ERROR("Invalid parameters for perf_sampler_take_samples");
+        return -1;
+    }
+    TRACE_SCOPE(trace, "sampler.take_samples");
+    
+    pthread_mutex_lock(&sampler->samples_mutex);
+    
+    if (sampler->is_running) {
+        pthread_mutex_unlock(&sampler->samples_mutex);
+        LOG_ERROR("Cannot take samples while the sampler is running");
+        return -1;
+    }
+    
+    *count = sampler->sample_count;
+    *samples = NULL;
+    if (sampler->sample_count > 0) {
+        // The buffer is sized for max_samples; give back the unused tail
+        cache_miss_sample_t *shrunk = realloc(sampler->samples,
+                                              sampler->sample_count * sizeof(cache_miss_sample_t));
+        *samples = shrunk ? shrunk : sampler->samples;
+        sampler->samples = NULL;
+        sampler->sample_count = 0;
+    }
+    
+    pthread_mutex_unlock(&sampler->samples_mutex);
+    
+    LOG_INFO("Took %d samples", *count);
+    return 0;
+}
+
+int perf_sampler_get_target(perf_sampler_t *sampler, pid_t *pid,
+                           memory_mapping_t **mappings, int *count) {
+    if (!sampler || !pid || !mappings || !count) {
+        LOG_ERROR("Invalid parameters for perf_sampler_get_target");
+        return -1;
+    }
+    
+    pthread_mutex_lock(&sampler->samples_mutex);
+    
+    if (sampler->is_running) {
+        pthread_mutex_unlock(&sampler->samples_mutex);
+        LOG_ERROR("Cannot read the target process while the sampler is running");
+        return -1;
+    }
+    
+    *pid = sampler->target_pid;
+    *mappings = NULL;
+    *count = 0;
+    if (sampler->target_map_count > 0) {
+        *mappings = MALLOC_LOGGED(sampler->target_map_count * sizeof(memory_mapping_t));
+        if (!*mappings) {
+            pthread_mutex_unlock(&sampler->samples_mutex);
+            return -1;
+        }
+        memcpy(*mappings, sampler->target_maps, sampler->target_map_count * sizeof(memory_mapping_t));
+        *count = sampler->target_map_count;
+    }
+    
+    pthread_mutex_unlock(&sampler->samples_mutex);
+    return 0;
+}
+
 // Free samples
 void perf_sampler_free_samples(cache_miss_sample_t *samples) {
     if (samples) {
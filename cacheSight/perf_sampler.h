@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "hardware_detector.h"
+#include "address_resolver.h"
 
 // Cache miss sample structure
 typedef struct {
@@ -16,6 +17,7 @@ typedef struct {
     bool is_write;               // Read or write access
     uint64_t latency_cycles;     // Access latency in cycles
     pid_t tid;                   // Thread ID
+    pid_t pid;                   // Process ID (0 = unknown, e.g. replayed)
 } cache_miss_sample_t;
 
 // Sampling configuration
@@ -26,6 +28,7 @@ typedef struct {
     bool include_kernel;         // Include kernel samples
     int cache_levels_mask;       // Bitmask of cache levels to monitor
     double sampling_duration;    // Duration in seconds (0 = until stopped)
+    char target_binary[256];     // Keep only the first process running this ("" = all)
 } perf_config_t;
 
 // Perf sampler state
@@ -42,8 +45,18 @@ bool perf_sampler_is_running(const perf_sampler_t *sampler);
 // Get samples
 int perf_sampler_get_samples(perf_sampler_t *sampler, 
                             cache_miss_sample_t **samples, int *count);
+// Moves the collected samples out without copying; the sampler starts its
+// next session with a fresh buffer. Not allowed while running.
+int perf_sampler_take_samples(perf_sampler_t *sampler,
+                             cache_miss_sample_t **samples, int *count);
 void perf_sampler_free_samples(cache_miss_sample_t *samples);
 
+// The process kept for target_binary and its mappings, captured while it
+// ran; pid 0 when none was seen. Free the mappings with
+// address_resolver_free_mappings.
+int perf_sampler_get_target(perf_sampler_t *sampler, pid_t *pid,
+                           memory_mapping_t **mappings, int *count);
+
 // Configuration helpers
 perf_config_t perf_config_default(void);
 int perf_check_permissions(void);
@@ -0,0 +1,679 @@
+#include "profile_diff.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "statistical_analyzer.h"
+#include <math.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Sites of one run with an open-addressing index on (file, function, line)
+typedef struct {
+    diff_site_t *sites;
+    int count;
+    int capacity;
+    int *slots;                     // Site index or -1
+    int slot_capacity;              // Power of two
+} site_table_t;
+
+typedef struct {
+    char path[256];
+    site_table_t lines;
+    site_table_t functions;
+    uint64_t total_samples;
+    double sampling_duration;
+    int hotspot_records;
+} diff_run_t;
+
+struct profile_diff {
+    diff_config_t config;
+    arena_t *arena;                 // Interned names shared by both runs
+    arena_t *scratch;               // Parse trees, reset after each record
+    string_pool_t *names;
+    diff_run_t base;
+    diff_run_t current;
+    double exposure_scale;          // Base exposure over current exposure
+    const char *exposure_unit;
+    diff_delta_t *line_deltas;
+    int line_delta_count;
+    diff_delta_t *function_deltas;
+    int function_delta_count;
+    diff_summary_t summary;
+};
+
+// Names are interned, so their addresses are the identity
+static uint64_t site_hash(const char *file, const char *function, int line) {
+    uint64_t h = (uint64_t)(uintptr_t)file * 0x9e3779b97f4a7c15ULL;
+    h ^= (uint64_t)(uintptr_t)function + 0x632be59bd9b4e019ULL + (h << 6) + (h >> 2);
+    h ^= (uint64_t)(uint32_t)line * 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static int table_lookup(const site_table_t *table, const char *file, const char *function,
+                        int line) {
+    if (table->slot_capacity == 0) return -1;
+    
+    size_t mask = (size_t)table->slot_capacity - 1;
+    for (size_t slot = site_hash(file, function, line) & mask; ; slot = (slot + 1) & mask) {
+        int index = table->slots[slot];
+        if (index < 0) return -1;
+        
+        const diff_site_t *site = &table->sites[index];
+        if (site->file == file && site->function == function && site->line == line) {
+            return index;
+        }
+    }
+}
+
+static int table_rehash(site_table_t *table, int slot_capacity) {
+    int *slots = MALLOC_LOGGED((size_t)slot_capacity * sizeof(int));
+    if (!slots) return -1;
+    memset(slots, 0xff, (size_t)slot_capacity * sizeof(int));
+    
+    size_t mask = (size_t)slot_capacity - 1;
+    for (int i = 0; i < table->count; i++) {
+        const diff_site_t *site = &table->sites[i];
+        size_t slot = site_hash(site->file, site->function, site->line) & mask;
+        while (slots[slot] >= 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = i;
+    }
+    
+    if (table->slots) {
+        FREE_LOGGED(table->slots);
+    }
+    table->slots = slots;
+    table->slot_capacity = slot_capacity;
+    return 0;
+}
+
+// Existing site with this identity, or a new zeroed one
+static diff_site_t* table_find_or_add(site_table_t *table, const char *file,
+                                      const char *function, int line) {
+    int index = table_lookup(table, file, function, line);
+    if (index >= 0) return &table->sites[index];
+    
+    if (table->count == table->capacity) {
+        int capacity = table->capacity ? table->capacity * 2 : 256;
+        diff_site_t *sites = realloc(table->sites, (size_t)capacity * sizeof(diff_site_t));
+        if (!sites) {
+            LOG_ERROR("Failed to grow diff site table");
+            return NULL;
+        }
+        table->sites = sites;
+        table->capacity = capacity;
+    }
+    
+    // Keep the index at most half full
+    if ((table->count + 1) * 2 > table->slot_capacity &&
+        table_rehash(table, table->slot_capacity ? table->slot_capacity * 2 : 512) != 0) {
+        return NULL;
+    }
+    
+    diff_site_t *site = &table->sites[table->count];
+    memset(site, 0, sizeof(*site));
+    site->file = file;
+    site->function = function;
+    site->line = line;
+    
+    size_t mask = (size_t)table->slot_capacity - 1;
+    size_t slot = site_hash(file, function, line) & mask;
+    while (table->slots[slot] >= 0) {
+        slot = (slot + 1) & mask;
+    }
+    table->slots[slot] = table->count++;
+    return site;
+}
+
+static void table_free(site_table_t *table) {
+    free(table->sites);
+    if (table->slots) {
+        FREE_LOGGED(table->slots);
+    }
+    memset(table, 0, sizeof(*table));
+}
+
+// Fold another hotspot into a site; latency statistics are pooled by sample count
+static void merge_site(diff_site_t *site, uint64_t misses, uint64_t samples,
+                       double latency_mean, double latency_var, uint64_t footprint) {
+    double wa = site->samples ? (double)site->samples : (double)site->misses;
+    double wb = samples ? (double)samples : (double)misses;
+    
+    if (site->samples >= 2 && samples >= 2) {
+        double n = (double)(site->samples + samples);
+        double delta = latency_mean - site->latency_mean;
+        double m2 = site->latency_var * (double)(site->samples - 1) +
+                    latency_var * (double)(samples - 1) +
+                    delta * delta * (double)site->samples * (double)samples / n;
+        site->latency_var = m2 / (n - 1);
+    } else if (samples >= 2) {
+        site->latency_var = latency_var;
+    }
+    
+    if (wa + wb > 0) {
+        site->latency_mean = (site->latency_mean * wa + latency_mean * wb) / (wa + wb);
+    }
+    site->misses += misses;
+    site->samples += samples;
+    site->footprint += footprint;
+}
+
+static int add_hotspot(profile_diff_t *diff, diff_run_t *run, const json_value_t *hotspot) {
+    const json_value_t *location = json_get(hotspot, "location");
+    const json_value_t *samples = json_get(hotspot, "samples");
+    
+    const char *file = string_pool_intern(diff->names, json_get_string(location, "file", "unknown"));
+    const char *function = string_pool_intern(diff->names, json_get_string(location, "function", ""));
+    int line = (int)json_get_number(location, "line", 0);
+    if (!file || !function) return -1;
+    
+    uint64_t misses = (uint64_t)json_get_number(hotspot, "total_misses", 0);
+    uint64_t footprint = (uint64_t)json_get_number(hotspot, "footprint_bytes", 0);
+    uint64_t sample_count = (uint64_t)json_get_number(samples, "count", 0);
+    double latency_mean = json_get_number(samples, "latency_mean_cycles",
+                                          json_get_number(hotspot, "avg_latency_cycles", 0));
+    double latency_var = json_get_number(samples, "latency_var_cycles", 0);
+    
+    // Without per-sample statistics the mean still ranks, but cannot be tested
+    if (!json_get(samples, "latency_var_cycles")) {
+        sample_count = 0;
+    }
+    
+    diff_site_t *line_site = table_find_or_add(&run->lines, file, function, line);
+    diff_site_t *function_site = table_find_or_add(&run->functions, file, function, 0);
+    if (!line_site || !function_site) return -1;
+    
+    merge_site(line_site, misses, sample_count, latency_mean, latency_var, footprint);
+    merge_site(function_site, misses, sample_count, latency_mean, latency_var, footprint);
+    run->hotspot_records++;
+    return 0;
+}
+
+static void read_run_header(diff_run_t *run, const json_value_t *header) {
+    run->total_samples = (uint64_t)json_get_number(header, "total_samples", 0);
+    run->sampling_duration = json_get_number(header, "sampling_duration", 0);
+}
+
+// NDJSON exports hold one record per line; each parse tree is dropped after use
+static int load_ndjson(profile_diff_t *diff, diff_run_t *run, const char *text, size_t length) {
+    size_t pos = 0;
+    int line_number = 0;
+    
+    while (pos < length) {
+        const char *newline = memchr(text + pos, '\n', length - pos);
+        size_t line_length = newline ? (size_t)(newline - (text + pos)) : length - pos;
+        line_number++;
+        
+        if (line_length > 0) {
+            json_value_t *record = json_parse(diff->scratch, text + pos, line_length, NULL);
+            if (!record) {
+                LOG_ERROR("%s:%d: malformed record", run->path, line_number);
+                return -1;
+            }
+            
+            const char *kind = json_get_string(record, "record", "");
+            if (strcmp(kind, "run") == 0) {
+                read_run_header(run, record);
+            } else if (strcmp(kind, "hotspot") == 0 && add_hotspot(diff, run, record) != 0) {
+                return -1;
+            }
+            arena_reset(diff->scratch);
+        }
+        pos += line_length + 1;
+    }
+    return 0;
+}
+
+static int load_document(profile_diff_t *diff, diff_run_t *run, const char *text, size_t length) {
+    json_value_t *document = json_parse(diff->scratch, text, length, NULL);
+    if (!document || document->type != JSON_OBJECT) {
+        LOG_ERROR("%s: not a structured export", run->path);
+        return -1;
+    }
+    
+    read_run_header(run, document);
+    
+    const json_value_t *hotspots = json_get(document, "hotspots");
+    for (const json_value_t *h = hotspots ? hotspots->child : NULL; h; h = h->next) {
+        if (add_hotspot(diff, run, h) != 0) return -1;
+    }
+    
+    arena_reset(diff->scratch);
+    return 0;
+}
+
+static int load_run(profile_diff_t *diff, diff_run_t *run, const char *path) {
+    strncpy(run->path, path, sizeof(run->path) - 1);
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        LOG_ERROR("%s is empty or unreadable", path);
+        close(fd);
+        return -1;
+    }
+    
+    size_t length = (size_t)st.st_size;
+    const char *text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        LOG_ERROR("Cannot map %s: %s", path, strerror(errno));
+        return -1;
+    }
+    madvise((void *)text, length, MADV_SEQUENTIAL);
+    
+    // An NDJSON export starts with a complete {"record": ...} object on line one
+    const char *newline = memchr(text, '\n', length);
+    size_t first_length = newline ? (size_t)(newline - text) : length;
+    while (first_length > 0 && (text[first_length - 1] == ' ' || text[first_length - 1] == '\r')) {
+        first_length--;
+    }
+    bool ndjson = false;
+    if (first_length > 1 && text[first_length - 1] == '}') {
+        json_value_t *first = json_parse(diff->scratch, text, first_length, NULL);
+        ndjson = first && json_get(first, "record") != NULL;
+        arena_reset(diff->scratch);
+    }
+    
+    int ret = ndjson ? load_ndjson(diff, run, text, length) :
+                       load_document(diff, run, text, length);
+    munmap((void *)text, length);
+    
+    if (ret == 0) {
+        LOG_INFO("Loaded %s (%s): %d hotspots, %d lines, %d functions", path,
+                 ndjson ? "NDJSON" : "JSON", run->hotspot_records, run->lines.count,
+                 run->functions.count);
+    }
+    return ret;
+}
+
+// Two-sided test that two Poisson counts share one rate; current_share is the
+// current run's fraction of the combined exposure
+static double rate_p_value(double base, double current, double current_share) {
+    double n = base + current;
+    if (n <= 0) return 1.0;
+    
+    double variance = n * current_share * (1.0 - current_share);
+    if (variance <= 0) return 1.0;
+    
+    double z = (current - n * current_share) / sqrt(variance);
+    return erfc(fabs(z) / sqrt(2.0));
+}
+
+// Welch's test on the latency means, Welch-Satterthwaite degrees of freedom
+static double welch_p_value(const diff_site_t *a, const diff_site_t *b) {
+    if (a->samples < 2 || b->samples < 2) return 1.0;
+    
+    double share_a = a->latency_var / (double)a->samples;
+    double share_b = b->latency_var / (double)b->samples;
+    double se = sqrt(share_a + share_b);
+    if (se <= 0) return a->latency_mean == b->latency_mean ? 1.0 : 0.0;
+    
+    double df = (share_a + share_b) * (share_a + share_b) /
+                (share_a * share_a / (double)(a->samples - 1) +
+                 share_b * share_b / (double)(b->samples - 1));
+    double t = (b->latency_mean - a->latency_mean) / se;
+    return student_t_p_value(t, df);
+}
+
+static void compute_delta(const profile_diff_t *diff, const diff_site_t *base,
+                          const diff_site_t *current, diff_delta_t *delta) {
+    memset(delta, 0, sizeof(*delta));
+    delta->base = base;
+    delta->current = current;
+    
+    double base_misses = base ? (double)base->misses : 0;
+    double raw_current = current ? (double)current->misses : 0;
+    double current_misses = raw_current * diff->exposure_scale;
+    double base_latency = base ? base->latency_mean : 0;
+    double current_latency = current ? current->latency_mean : 0;
+    
+    delta->miss_delta = current_misses - base_misses;
+    delta->miss_change = base_misses > 0 ? delta->miss_delta / base_misses :
+                         (current_misses > 0 ? INFINITY : 0);
+    double current_share = 1.0 / (1.0 + diff->exposure_scale);
+    delta->miss_p_value = rate_p_value(base_misses, raw_current, current_share);
+    
+    delta->latency_p_value = 1.0;
+    if (base && current) {
+        delta->latency_delta = current_latency - base_latency;
+        delta->latency_p_value = welch_p_value(base, current);
+    }
+    
+    delta->footprint_delta = (int64_t)(current ? current->footprint : 0) -
+                             (int64_t)(base ? base->footprint : 0);
+    delta->cost_delta = current_misses * current_latency - base_misses * base_latency;
+    
+    // A change must be both significant and large enough to matter
+    const diff_config_t *config = &diff->config;
+    bool misses_changed = delta->miss_p_value < config->significance &&
+                          fabs(delta->miss_change) >= config->min_relative_change;
+    bool latency_changed = base && current && base_latency > 0 &&
+                           delta->latency_p_value < config->significance &&
+                           fabs(delta->latency_delta) / base_latency >= config->min_relative_change;
+    
+    delta->verdict = DIFF_UNCHANGED;
+    if ((misses_changed || latency_changed) && delta->cost_delta != 0) {
+        delta->verdict = delta->cost_delta > 0 ? DIFF_REGRESSION : DIFF_IMPROVEMENT;
+    }
+}
+
+// Regressions by cost added, then improvements by cost removed, then the rest
+static int compare_deltas(const void *a, const void *b) {
+    const diff_delta_t *da = a;
+    const diff_delta_t *db = b;
+    static const int rank[] = { [DIFF_REGRESSION] = 0, [DIFF_IMPROVEMENT] = 1, [DIFF_UNCHANGED] = 2 };
+    
+    if (da->verdict != db->verdict) {
+        return rank[da->verdict] - rank[db->verdict];
+    }
+    
+    double ka = da->verdict == DIFF_IMPROVEMENT ? -da->cost_delta : fabs(da->cost_delta);
+    double kb = db->verdict == DIFF_IMPROVEMENT ? -db->cost_delta : fabs(db->cost_delta);
+    return ka > kb ? -1 : ka < kb;
+}
+
+// Match every current site against the base index, then add the vanished ones
+static int diff_tables(profile_diff_t *diff, const site_table_t *base,
+                       const site_table_t *current, diff_delta_t **deltas, int *count,
+                       bool count_matches) {
+    int capacity = base->count + current->count;
+    *deltas = MALLOC_LOGGED((size_t)(capacity > 0 ? capacity : 1) * sizeof(diff_delta_t));
+    bool *matched = CALLOC_LOGGED(base->count > 0 ? base->count : 1, sizeof(bool));
+    if (!*deltas || !matched) {
+        if (*deltas) FREE_LOGGED(*deltas);
+        if (matched) FREE_LOGGED(matched);
+        *deltas = NULL;
+        return -1;
+    }
+    
+    int n = 0;
+    for (int i = 0; i < current->count; i++) {
+        const diff_site_t *site = &current->sites[i];
+        int index = table_lookup(base, site->file, site->function, site->line);
+        if (index >= 0) {
+            matched[index] = true;
+            if (count_matches) diff->summary.matched++;
+        } else if (count_matches) {
+            diff->summary.added++;
+        }
+        compute_delta(diff, index >= 0 ? &base->sites[index] : NULL, site, &(*deltas)[n++]);
+    }
+    
+    for (int i = 0; i < base->count; i++) {
+        if (matched[i]) continue;
+        if (count_matches) diff->summary.removed++;
+        compute_delta(diff, &base->sites[i], NULL, &(*deltas)[n++]);
+    }
+    FREE_LOGGED(matched);
+    
+    qsort(*deltas, n, sizeof(diff_delta_t), compare_deltas);
+    *count = n;
+    return 0;
+}
+
+profile_diff_t* profile_diff_create(const diff_config_t *config) {
+    profile_diff_t *diff = CALLOC_LOGGED(1, sizeof(profile_diff_t));
+    if (!diff) {
+        LOG_ERROR("Failed to allocate profile diff");
+        return NULL;
+    }
+    
+    diff->config = config ? *config : diff_config_default();
+    diff->arena = arena_create(0);
+    diff->scratch = arena_create(0);
+    diff->names = diff->arena ? string_pool_create(diff->arena) : NULL;
+    if (!diff->arena || !diff->scratch || !diff->names) {
+        profile_diff_destroy(diff);
+        return NULL;
+    }
+    
+    return diff;
+}
+
+void profile_diff_destroy(profile_diff_t *diff) {
+    if (!diff) return;
+    
+    table_free(&diff->base.lines);
+    table_free(&diff->base.functions);
+    table_free(&diff->current.lines);
+    table_free(&diff->current.functions);
+    if (diff->line_deltas) FREE_LOGGED(diff->line_deltas);
+    if (diff->function_deltas) FREE_LOGGED(diff->function_deltas);
+    string_pool_destroy(diff->names);
+    arena_destroy(diff->scratch);
+    arena_destroy(diff->arena);
+    FREE_LOGGED(diff);
+}
+
+int profile_diff_compare(profile_diff_t *diff, const char *base_path, const char *current_path) {
+    if (!diff || !base_path || !current_path) return -1;
+    
+    if (load_run(diff, &diff->base, base_path) != 0 ||
+        load_run(diff, &diff->current, current_path) != 0) {
+        return -1;
+    }
+    
+    // Counts are compared per unit of exposure: wall time when both runs
+    // recorded it, otherwise total samples
+    diff->exposure_scale = 1.0;
+    diff->exposure_unit = "equal exposure assumed";
+    if (diff->base.sampling_duration > 0 && diff->current.sampling_duration > 0) {
+        diff->exposure_scale = diff->base.sampling_duration / diff->current.sampling_duration;
+        diff->exposure_unit = "sampling time";
+    } else if (diff->base.total_samples > 0 && diff->current.total_samples > 0) {
+        diff->exposure_scale = (double)diff->base.total_samples / (double)diff->current.total_samples;
+        diff->exposure_unit = "total samples";
+    }
+    
+    memset(&diff->summary, 0, sizeof(diff->summary));
+    if (diff_tables(diff, &diff->base.lines, &diff->current.lines,
+                    &diff->line_deltas, &diff->line_delta_count, true) != 0 ||
+        diff_tables(diff, &diff->base.functions, &diff->current.functions,
+                    &diff->function_deltas, &diff->function_delta_count, false) != 0) {
+        return -1;
+    }
+    
+    for (int i = 0; i < diff->line_delta_count; i++) {
+        if (diff->line_deltas[i].verdict == DIFF_REGRESSION) diff->summary.regressions++;
+        if (diff->line_deltas[i].verdict == DIFF_IMPROVEMENT) diff->summary.improvements++;
+    }
+    for (int i = 0; i < diff->function_delta_count; i++) {
+        if (diff->function_deltas[i].verdict == DIFF_REGRESSION) diff->summary.function_regressions++;
+        if (diff->function_deltas[i].verdict == DIFF_IMPROVEMENT) diff->summary.function_improvements++;
+    }
+    
+    LOG_INFO("Profile diff: %d matched, %d new, %d gone; %d regressions, %d improvements",
+             diff->summary.matched, diff->summary.added, diff->summary.removed,
+             diff->summary.regressions, diff->summary.improvements);
+    return 0;
+}
+
+int profile_diff_get_deltas(const profile_diff_t *diff, bool functions,
+                           const diff_delta_t **deltas, int *count) {
+    if (!diff || !deltas || !count) return -1;
+    
+    *deltas = functions ? diff->function_deltas : diff->line_deltas;
+    *count = functions ? diff->function_delta_count : diff->line_delta_count;
+    return 0;
+}
+
+void profile_diff_get_summary(const profile_diff_t *diff, diff_summary_t *summary) {
+    if (!diff || !summary) return;
+    *summary = diff->summary;
+}
+
+static const diff_site_t* delta_site(const diff_delta_t *delta) {
+    return delta->current ? delta->current : delta->base;
+}
+
+static void write_table(FILE *fp, const diff_delta_t *deltas, int count, diff_verdict_t verdict,
+                        const char *title, bool functions, int max_rows) {
+    int shown = 0;
+    for (int i = 0; i < count; i++) {
+        if (deltas[i].verdict == verdict) shown++;
+    }
+    
+    fprintf(fp, "\n%s (%d)\n", title, shown);
+    if (shown == 0) return;
+    
+    fprintf(fp, "%-4s %-44s %22s %8s %9s %10s %8s %12s\n", "#", functions ? "Function" : "Location",
+            "Misses base -> new", "Change", "p", "Latency", "p", "Footprint");
+    
+    int row = 0;
+    for (int i = 0; i < count && row < max_rows; i++) {
+        const diff_delta_t *d = &deltas[i];
+        if (d->verdict != verdict) continue;
+        
+        const diff_site_t *site = delta_site(d);
+        char where[320];
+        if (functions) {
+            snprintf(where, sizeof(where), "%s (%s)", site->function[0] ? site->function : "?",
+                     site->file);
+        } else {
+            snprintf(where, sizeof(where), "%s:%d", site->file, site->line);
+        }
+        
+        char misses[48], change[16];
+        snprintf(misses, sizeof(misses), "%llu -> %llu",
+                 (unsigned long long)(d->base ? d->base->misses : 0),
+                 (unsigned long long)(d->current ? d->current->misses : 0));
+        if (!d->base) {
+            snprintf(change, sizeof(change), "new");
+        } else if (!d->current) {
+            snprintf(change, sizeof(change), "gone");
+        } else {
+            snprintf(change, sizeof(change), "%+.0f%%", d->miss_change * 100);
+        }
+        
+        fprintf(fp, "%-4d %-44.44s %22s %8s %9.2g %+10.1f %8.2g %+12lld\n",
+                ++row, where, misses, change, d->miss_p_value, d->latency_delta,
+                d->latency_p_value, (long long)d->footprint_delta);
+    }
+}
+
+static void write_text(const profile_diff_t *diff, FILE *fp) {
+    const diff_summary_t *s = &diff->summary;
+    int rows = diff->config.max_rows;
+    
+    fprintf(fp, "Profile Diff\n============\n");
+    fprintf(fp, "Base:    %s\n", diff->base.path);
+    fprintf(fp, "Current: %s\n", diff->current.path);
+    fprintf(fp, "Current counts scaled by %.3f (%s); significance p < %.3g, change >= %.0f%%\n",
+            diff->exposure_scale, diff->exposure_unit, diff->config.significance,
+            diff->config.min_relative_change * 100);
+    fprintf(fp, "Hotspot lines: %d matched, %d new, %d gone\n", s->matched, s->added, s->removed);
+    fprintf(fp, "Regressions: %d lines, %d functions; improvements: %d lines, %d functions\n",
+            s->regressions, s->function_regressions, s->improvements, s->function_improvements);
+    
+    write_table(fp, diff->function_deltas, diff->function_delta_count, DIFF_REGRESSION,
+                "REGRESSIONS BY FUNCTION", true, rows);
+    write_table(fp, diff->line_deltas, diff->line_delta_count, DIFF_REGRESSION,
+                "REGRESSIONS BY LINE", false, rows);
+    write_table(fp, diff->function_deltas, diff->function_delta_count, DIFF_IMPROVEMENT,
+                "IMPROVEMENTS BY FUNCTION", true, rows);
+    write_table(fp, diff->line_deltas, diff->line_delta_count, DIFF_IMPROVEMENT,
+                "IMPROVEMENTS BY LINE", false, rows);
+}
+
+void profile_diff_print(const profile_diff_t *diff) {
+    if (!diff) return;
+    
+    printf("\n");
+    write_text(diff, stdout);
+    printf("\n");
+}
+
+static void write_json_deltas(json_writer_t *writer, const char *key,
+                              const diff_delta_t *deltas, int count) {
+    static const char *verdicts[] = {
+        [DIFF_UNCHANGED] = "unchanged",
+        [DIFF_REGRESSION] = "regression",
+        [DIFF_IMPROVEMENT] = "improvement"
+    };
+    
+    json_begin_array(writer, key);
+    for (int i = 0; i < count; i++) {
+        const diff_delta_t *d = &deltas[i];
+        if (d->verdict == DIFF_UNCHANGED) continue;
+        
+        const diff_site_t *site = delta_site(d);
+        json_begin_object(writer, NULL);
+        json_string(writer, "verdict", verdicts[d->verdict]);
+        json_string(writer, "file", site->file);
+        json_string(writer, "function", site->function);
+        if (site->line > 0) {
+            json_int(writer, "line", site->line);
+        }
+        json_uint(writer, "base_misses", d->base ? d->base->misses : 0);
+        json_uint(writer, "current_misses", d->current ? d->current->misses : 0);
+        json_double(writer, "miss_delta", d->miss_delta);
+        json_double(writer, "miss_change", d->miss_change);
+        json_double(writer, "miss_p_value", d->miss_p_value);
+        json_double(writer, "latency_delta", d->latency_delta);
+        json_double(writer, "latency_p_value", d->latency_p_value);
+        json_int(writer, "footprint_delta", d->footprint_delta);
+        json_double(writer, "cost_delta", d->cost_delta);
+        json_end_object(writer);
+    }
+    json_end_array(writer);
+}
+
+int profile_diff_save(const profile_diff_t *diff, const char *path, bool json) {
+    if (!diff || !path) return -1;
+    
+    if (!json) {
+        FILE *fp = fopen(path, "w");
+        if (!fp) {
+            LOG_ERROR("Failed to open %s: %s", path, strerror(errno));
+            return -1;
+        }
+        write_text(diff, fp);
+        fclose(fp);
+        LOG_INFO("Profile diff saved to %s", path);
+        return 0;
+    }
+    
+    json_writer_t *writer = MALLOC_LOGGED(sizeof(json_writer_t));
+    if (!writer) return -1;
+    if (json_writer_open(writer, path, true) != 0) {
+        FREE_LOGGED(writer);
+        return -1;
+    }
+    
+    json_begin_object(writer, NULL);
+    json_string(writer, "base", diff->base.path);
+    json_string(writer, "current", diff->current.path);
+    json_double(writer, "exposure_scale", diff->exposure_scale);
+    json_int(writer, "matched", diff->summary.matched);
+    json_int(writer, "added", diff->summary.added);
+    json_int(writer, "removed", diff->summary.removed);
+    write_json_deltas(writer, "functions", diff->function_deltas, diff->function_delta_count);
+    write_json_deltas(writer, "lines", diff->line_deltas, diff->line_delta_count);
+    json_end_object(writer);
+    json_end_record(writer);
+    
+    int ret = json_writer_close(writer);
+    FREE_LOGGED(writer);
+    if (ret == 0) {
+        LOG_INFO("Profile diff saved to %s", path);
+    }
+    return ret;
+}
+
+diff_config_t diff_config_default(void) {
+    diff_config_t config = {
+        .significance = 0.01,
+        .min_relative_change = 0.05,
+        .max_rows = 25
+    };
+    
+    return config;
+}
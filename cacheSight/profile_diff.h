@@ -0,0 +1,77 @@
+#ifndef PROFILE_DIFF_H
+#define PROFILE_DIFF_H
+
+#include "common.h"
+#include "arena.h"
+
+// Comparison of two saved analyses (structured exports, JSON or NDJSON)
+typedef struct profile_diff profile_diff_t;
+
+// Diff configuration
+typedef struct {
+    double significance;            // p-value below which a change counts
+    double min_relative_change;     // Smaller changes are unchanged even if significant
+    int max_rows;                   // Rows per table in the printed report
+} diff_config_t;
+
+// Hotspot line or function aggregate from one run; names are interned so
+// identity compares pointers
+typedef struct {
+    const char *file;
+    const char *function;
+    int line;                       // 0 for function aggregates
+    uint64_t misses;
+    uint64_t samples;               // Samples behind the latency statistics
+    double latency_mean;            // Cycles
+    double latency_var;
+    uint64_t footprint;             // Bytes
+} diff_site_t;
+
+typedef enum {
+    DIFF_UNCHANGED,
+    DIFF_REGRESSION,
+    DIFF_IMPROVEMENT
+} diff_verdict_t;
+
+// Change at one site; current counts are scaled to the base run's exposure
+typedef struct {
+    const diff_site_t *base;        // NULL for sites new in the current run
+    const diff_site_t *current;     // NULL for sites that disappeared
+    double miss_delta;
+    double miss_change;             // Relative, +0.25 = 25% more misses
+    double miss_p_value;            // Poisson rate test
+    double latency_delta;
+    double latency_p_value;         // Welch test on the sample latencies
+    int64_t footprint_delta;
+    double cost_delta;              // Miss cycles, the ranking key
+    diff_verdict_t verdict;
+} diff_delta_t;
+
+// Diff summary
+typedef struct {
+    int matched;
+    int added;
+    int removed;
+    int regressions;
+    int improvements;
+    int function_regressions;
+    int function_improvements;
+} diff_summary_t;
+
+// API functions
+profile_diff_t* profile_diff_create(const diff_config_t *config);
+void profile_diff_destroy(profile_diff_t *diff);
+
+// Load both runs, match their hotspots and rank the changes
+int profile_diff_compare(profile_diff_t *diff, const char *base_path, const char *current_path);
+
+int profile_diff_get_deltas(const profile_diff_t *diff, bool functions,
+                           const diff_delta_t **deltas, int *count);
+void profile_diff_get_summary(const profile_diff_t *diff, diff_summary_t *summary);
+
+void profile_diff_print(const profile_diff_t *diff);
+int profile_diff_save(const profile_diff_t *diff, const char *path, bool json);
+
+diff_config_t diff_config_default(void);
+
+#endif // PROFILE_DIFF_H
@@ -0,0 +1,369 @@
+#include "profile_exporter.h"
+#include "stage_trace.h"
+#include <ctype.h>
+
+// Samples at one instruction address
+typedef struct {
+    uint64_t address;
+    uint64_t samples;
+} ip_count_t;
+
+// Samples at one line, as an offset from the function's first line
+typedef struct {
+    int offset;
+    uint64_t samples;
+    bool hot;
+} line_count_t;
+
+typedef struct {
+    char name[256];                 // Mangled, as the compiler looks it up
+    uint64_t entry;
+    source_location_t start;        // Line of the entry address
+    uint64_t total;
+    uint64_t head;                  // Samples on the entry instruction
+    line_count_t *lines;
+    int line_count;
+    int line_capacity;
+    bool hot;
+} profile_function_t;
+
+// Reference to one line for the hot/cold ranking
+typedef struct {
+    profile_function_t *function;
+    line_count_t *line;
+} line_ref_t;
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int compare_line_offsets(const void *a, const void *b) {
+    return ((const line_count_t *)a)->offset - ((const line_count_t *)b)->offset;
+}
+
+static int compare_function_totals(const void *a, const void *b) {
+    uint64_t x = ((const profile_function_t *)a)->total;
+    uint64_t y = ((const profile_function_t *)b)->total;
+    return x > y ? -1 : x < y;
+}
+
+static int compare_line_samples(const void *a, const void *b) {
+    uint64_t x = ((const line_ref_t *)a)->line->samples;
+    uint64_t y = ((const line_ref_t *)b)->line->samples;
+    return x > y ? -1 : x < y;
+}
+
+static int add_line(profile_function_t *function, int offset, uint64_t samples) {
+    if (function->line_count == function->line_capacity) {
+        int capacity = function->line_capacity ? function->line_capacity * 2 : 8;
+        line_count_t *lines = MALLOC_LOGGED(capacity * sizeof(line_count_t));
+        if (!lines) return -1;
+        if (function->lines) {
+            memcpy(lines, function->lines, function->line_count * sizeof(line_count_t));
+            FREE_LOGGED(function->lines);
+        }
+        function->lines = lines;
+        function->line_capacity = capacity;
+    }
+    
+    line_count_t *line = &function->lines[function->line_count++];
+    line->offset = offset;
+    line->samples = samples;
+    line->hot = false;
+    return 0;
+}
+
+// Sort lines by offset and merge addresses that map to the same line
+static void merge_lines(profile_function_t *function) {
+    if (function->line_count < 2) return;
+    
+    qsort(function->lines, function->line_count, sizeof(line_count_t), compare_line_offsets);
+    int out = 0;
+    for (int i = 1; i < function->line_count; i++) {
+        if (function->lines[i].offset == function->lines[out].offset) {
+            function->lines[out].samples += function->lines[i].samples;
+        } else {
+            function->lines[++out] = function->lines[i];
+        }
+    }
+    function->line_count = out + 1;
+}
+
+// Line offsets count from the line naming the function, as the compiler's
+// debug info does; the entry instruction usually sits on a later line, so
+// search back for "name(" when the source is readable
+static int find_declaration_line(const char *file, const char *name, int entry_line) {
+    FILE *fp = fopen(file, "r");
+    if (!fp) return entry_line;
+    
+    size_t name_len = strlen(name);
+    int declaration = entry_line;
+    char line[1024];
+    for (int number = 1; number <= entry_line && fgets(line, sizeof(line), fp); number++) {
+        for (const char *p = strstr(line, name); p; p = strstr(p + 1, name)) {
+            const char *after = p + name_len;
+            while (*after == ' ' || *after == '\t') after++;
+            bool starts_word = p == line || !(isalnum((unsigned char)p[-1]) || p[-1] == '_');
+            if (starts_word && *after == '(') {
+                declaration = number;
+                break;
+            }
+        }
+    }
+    
+    fclose(fp);
+    return declaration;
+}
+
+// Clang's text sample profile: "name:total:head" then " offset: samples"
+static int write_sample_profile(const profile_function_t *functions, int count, const char *filename) {
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        LOG_ERROR("Failed to open %s for writing", filename);
+        return -1;
+    }
+    
+    for (int f = 0; f < count; f++) {
+        const profile_function_t *function = &functions[f];
+        fprintf(fp, "%s:%lu:%lu\n", function->name, function->total, function->head);
+        for (int l = 0; l < function->line_count; l++) {
+            fprintf(fp, " %d: %lu\n", function->lines[l].offset, function->lines[l].samples);
+        }
+    }
+    
+    fclose(fp);
+    LOG_INFO("Wrote sample profile for %d functions to %s", count, filename);
+    return 0;
+}
+
+static int write_line_map(const profile_function_t *functions, int count,
+                          const profile_export_summary_t *summary, double hot_fraction,
+                          const char *filename) {
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        LOG_ERROR("Failed to open %s for writing", filename);
+        return -1;
+    }
+    
+    fprintf(fp, "# cacheSight line map: %lu samples, hot lines cover %.0f%% of them\n",
+            summary->attributed_samples, hot_fraction * 100);
+    fprintf(fp, "# file:line function samples class\n");
+    for (int f = 0; f < count; f++) {
+        const profile_function_t *function = &functions[f];
+        for (int l = 0; l < function->line_count; l++) {
+            const line_count_t *line = &function->lines[l];
+            fprintf(fp, "%s:%d %s %lu %s\n", function->start.file,
+                    function->start.line + line->offset, function->name, line->samples,
+                    line->hot ? "hot" : "cold");
+        }
+    }
+    
+    fclose(fp);
+    LOG_INFO("Wrote hot/cold map of %d lines to %s", summary->line_count, filename);
+    return 0;
+}
+
+// One symbol per line, hottest first (lld --symbol-ordering-file)
+static int write_symbol_order(const profile_function_t *functions, int count, const char *filename) {
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        LOG_ERROR("Failed to open %s for writing", filename);
+        return -1;
+    }
+    
+    for (int f = 0; f < count; f++) {
+        if (functions[f].hot) fprintf(fp, "%s\n", functions[f].name);
+    }
+    
+    fclose(fp);
+    return 0;
+}
+
+// Mark the hottest lines until they cover hot_fraction of the samples
+static void classify_lines(profile_function_t *functions, int count, double hot_fraction,
+                           profile_export_summary_t *summary) {
+    line_ref_t *refs = MALLOC_LOGGED((summary->line_count > 0 ? summary->line_count : 1) * sizeof(line_ref_t));
+    if (!refs) return;
+    
+    int n = 0;
+    for (int f = 0; f < count; f++) {
+        for (int l = 0; l < functions[f].line_count; l++) {
+            refs[n].function = &functions[f];
+            refs[n].line = &functions[f].lines[l];
+            n++;
+        }
+    }
+    qsort(refs, n, sizeof(line_ref_t), compare_line_samples);
+    
+    double budget = hot_fraction * summary->attributed_samples;
+    double covered = 0;
+    for (int i = 0; i < n && covered < budget; i++) {
+        refs[i].line->hot = true;
+        covered += refs[i].line->samples;
+        summary->hot_line_count++;
+        if (!refs[i].function->hot) {
+            refs[i].function->hot = true;
+            summary->hot_function_count++;
+        }
+    }
+    
+    FREE_LOGGED(refs);
+}
+
+int profile_export_samples(address_resolver_t *resolver,
+                          const cache_miss_sample_t *samples, int sample_count,
+                          const profile_export_config_t *config,
+                          profile_export_summary_t *summary) {
+    if (!resolver || !samples || !config || !summary || sample_count <= 0) {
+        LOG_ERROR("Invalid parameters for profile_export_samples");
+        return -1;
+    }
+    TRACE_SCOPE(trace, "profile_export.samples");
+    trace_add_items(&trace, sample_count);
+    
+    memset(summary, 0, sizeof(profile_export_summary_t));
+    summary->total_samples = sample_count;
+    
+    // Count samples per unique IP
+    uint64_t *ips = MALLOC_LOGGED(sample_count * sizeof(uint64_t));
+    ip_count_t *unique = MALLOC_LOGGED(sample_count * sizeof(ip_count_t));
+    if (!ips || !unique) {
+        if (ips) FREE_LOGGED(ips);
+        if (unique) FREE_LOGGED(unique);
+        return -1;
+    }
+    
+    for (int i = 0; i < sample_count; i++) ips[i] = samples[i].instruction_addr;
+    qsort(ips, sample_count, sizeof(uint64_t), compare_u64);
+    
+    int unique_count = 0;
+    for (int i = 0; i < sample_count; i++) {
+        if (unique_count > 0 && unique[unique_count - 1].address == ips[i]) {
+            unique[unique_count - 1].samples++;
+        } else {
+            unique[unique_count].address = ips[i];
+            unique[unique_count].samples = 1;
+            unique_count++;
+        }
+    }
+    FREE_LOGGED(ips);
+    
+    // Sorted IPs visit each function's range contiguously
+    profile_function_t *functions = CALLOC_LOGGED(unique_count, sizeof(profile_function_t));
+    int *owner = MALLOC_LOGGED(unique_count * sizeof(int));
+    uint64_t *addresses = MALLOC_LOGGED(2 * unique_count * sizeof(uint64_t));
+    source_location_t *locations = MALLOC_LOGGED(2 * unique_count * sizeof(source_location_t));
+    int function_count = 0;
+    int ret = -1;
+    if (!functions || !owner || !addresses || !locations) goto cleanup;
+    
+    for (int i = 0; i < unique_count; i++) {
+        symbol_info_t symbol;
+        owner[i] = -1;
+        if (address_resolver_get_function_at(resolver, unique[i].address, &symbol) != 0) continue;
+        
+        if (function_count == 0 || functions[function_count - 1].entry != symbol.address) {
+            profile_function_t *function = &functions[function_count++];
+            strncpy(function->name, symbol.name, sizeof(function->name) - 1);
+            function->entry = symbol.address;
+        }
+        owner[i] = function_count - 1;
+    }
+    
+    if (function_count == 0) {
+        LOG_WARNING("No samples fall inside a known function; nothing to export");
+        ret = 0;
+        goto cleanup;
+    }
+    
+    // One line table query for every sampled IP and every function entry
+    for (int i = 0; i < unique_count; i++) addresses[i] = unique[i].address;
+    for (int f = 0; f < function_count; f++) addresses[unique_count + f] = functions[f].entry;
+    if (address_resolver_resolve_lines(resolver, addresses, unique_count + function_count, locations) < 0) {
+        goto cleanup;
+    }
+    for (int f = 0; f < function_count; f++) {
+        functions[f].start = locations[unique_count + f];
+        if (functions[f].start.line > 0) {
+            functions[f].start.line = find_declaration_line(functions[f].start.file, functions[f].name,
+                                                            functions[f].start.line);
+        }
+    }
+    
+    // Lines from other files were inlined; they have no offset in this function
+    for (int i = 0; i < unique_count; i++) {
+        if (owner[i] < 0) continue;
+        profile_function_t *function = &functions[owner[i]];
+        const source_location_t *location = &locations[i];
+        if (function->start.line <= 0 || location->line < function->start.line ||
+            strcmp(location->file, function->start.file) != 0) {
+            continue;
+        }
+        
+        if (add_line(function, location->line - function->start.line, unique[i].samples) != 0) goto cleanup;
+        function->total += unique[i].samples;
+        if (unique[i].address == function->entry) function->head += unique[i].samples;
+        summary->attributed_samples += unique[i].samples;
+    }
+    
+    for (int f = 0; f < function_count; f++) {
+        merge_lines(&functions[f]);
+        summary->line_count += functions[f].line_count;
+    }
+    qsort(functions, function_count, sizeof(profile_function_t), compare_function_totals);
+    while (function_count > 0 && functions[function_count - 1].total == 0) {
+        function_count--;
+        if (functions[function_count].lines) FREE_LOGGED(functions[function_count].lines);
+        functions[function_count].lines = NULL;
+    }
+    summary->function_count = function_count;
+    
+    classify_lines(functions, function_count, config->hot_fraction, summary);
+    
+    ret = 0;
+    if (config->sample_profile_file[0] &&
+        write_sample_profile(functions, function_count, config->sample_profile_file) != 0) ret = -1;
+    if (config->line_map_file[0] &&
+        write_line_map(functions, function_count, summary, config->hot_fraction,
+                       config->line_map_file) != 0) ret = -1;
+    if (config->symbol_order_file[0] &&
+        write_symbol_order(functions, function_count, config->symbol_order_file) != 0) ret = -1;
+
+cleanup:
+    if (functions) {
+        for (int f = 0; f < function_count; f++) {
+            if (functions[f].lines) FREE_LOGGED(functions[f].lines);
+        }
+        FREE_LOGGED(functions);
+    }
+    if (owner) FREE_LOGGED(owner);
+    if (addresses) FREE_LOGGED(addresses);
+    if (locations) FREE_LOGGED(locations);
+    FREE_LOGGED(unique);
+    return ret;
+}
+
+void profile_export_print_summary(const profile_export_summary_t *summary) {
+    if (!summary) return;
+    
+    printf("\n=== Profile Export ===\n");
+    printf("Samples: %lu, attributed to source lines: %lu (%.1f%%)\n",
+           summary->total_samples, summary->attributed_samples,
+           summary->total_samples > 0 ?
+           100.0 * summary->attributed_samples / summary->total_samples : 0.0);
+    printf("Functions: %d (%d hot), lines: %d (%d hot)\n",
+           summary->function_count, summary->hot_function_count,
+           summary->line_count, summary->hot_line_count);
+}
+
+profile_export_config_t profile_export_config_default(void) {
+    profile_export_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.hot_fraction = 0.9;
+    strncpy(config.sample_profile_file, "cachesight.prof", sizeof(config.sample_profile_file) - 1);
+    strncpy(config.line_map_file, "hot_cold_lines.txt", sizeof(config.line_map_file) - 1);
+    strncpy(config.symbol_order_file, "symbol_order.txt", sizeof(config.symbol_order_file) - 1);
+    return config;
+}
@@ -0,0 +1,38 @@
+#ifndef PROFILE_EXPORTER_H
+#define PROFILE_EXPORTER_H
+
+#include "common.h"
+#include "perf_sampler.h"
+#include "address_resolver.h"
+
+// Export configuration; an empty file name skips that output
+typedef struct {
+    double hot_fraction;                // Hottest lines covering this share of samples are hot
+    char sample_profile_file[256];      // Text sample profile for clang -fprofile-sample-use
+    char line_map_file[256];            // Per-line sample counts tagged hot or cold
+    char symbol_order_file[256];        // Hot functions, hottest first, for the linker
+} profile_export_config_t;
+
+// Export summary
+typedef struct {
+    uint64_t total_samples;             // Samples handed to the exporter
+    uint64_t attributed_samples;        // Samples mapped to a function line
+    int function_count;                 // Functions in the sample profile
+    int line_count;                     // Distinct source lines
+    int hot_line_count;
+    int hot_function_count;
+} profile_export_summary_t;
+
+// API functions
+profile_export_config_t profile_export_config_default(void);
+
+// Aggregate sample IPs by function and line using the resolver's symbol and
+// line tables, then write the configured outputs
+int profile_export_samples(address_resolver_t *resolver,
+                          const cache_miss_sample_t *samples, int sample_count,
+                          const profile_export_config_t *config,
+                          profile_export_summary_t *summary);
+
+void profile_export_print_summary(const profile_export_summary_t *summary);
+
+#endif // PROFILE_EXPORTER_H
@@ -1,10 +1,24 @@
 #include "recommendation_engine.h"
+#include "evaluator.h"
+#include "stage_trace.h"
 #include <math.h>
+#include <limits.h>
 
 // Internal engine structure
 struct recommendation_engine {
     engine_config_t config;
     cache_info_t cache_info;
+    evaluator_t *prefetch_evaluator;     // Created on first prefetch validation
+    arena_t *scratch;                    // Per-call temporaries
+    bool owns_scratch;
+    cost_profile_t profile;              // Cost model inputs for ranking
+    
+    // Recent prefetch validations; hotspots in the same kind of loop repeat
+    // the same parameters
+    struct {
+        uint64_t key;
+        prefetch_validation_t result;
+    } prefetch_memo[64];
     
     // Statistics
     int total_recommendations_generated;
@@ -13,6 +27,112 @@ struct recommendation_engine {
     pthread_mutex_t mutex;
 };
 
+// Open-addressed index over recommendations keyed by (file ID, line, type).
+// Paths are interned once so probes compare integers instead of strings
+typedef struct {
+    const char *name;               // Borrowed from a hotspot location
+    uint64_t hash;
+} interned_name_t;
+
+typedef struct {
+    uint64_t key;                   // 0 = empty slot
+    int rec_index;
+} rec_slot_t;
+
+typedef struct {
+    interned_name_t *names;
+    size_t name_capacity;
+    int name_count;
+    rec_slot_t *slots;
+    size_t capacity;
+} rec_index_t;
+
+static size_t next_power_of_two(size_t n) {
+    size_t p = 64;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+static uint64_t hash_name(const char *name) {
+    // FNV-1a
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *c = (const unsigned char *)name; *c; c++) {
+        h ^= *c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t mix_key(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+}
+
+// Sized for max_entries keys and names, at most half full
+static int rec_index_init(rec_index_t *index, size_t max_entries) {
+    memset(index, 0, sizeof(rec_index_t));
+    index->capacity = next_power_of_two(max_entries * 2);
+    index->name_capacity = index->capacity;
+    index->slots = CALLOC_LOGGED(index->capacity, sizeof(rec_slot_t));
+    index->names = CALLOC_LOGGED(index->name_capacity, sizeof(interned_name_t));
+    if (!index->slots || !index->names) {
+        if (index->slots) FREE_LOGGED(index->slots);
+        if (index->names) FREE_LOGGED(index->names);
+        return -1;
+    }
+    return 0;
+}
+
+static void rec_index_destroy(rec_index_t *index) {
+    FREE_LOGGED(index->slots);
+    FREE_LOGGED(index->names);
+}
+
+// Small integer ID for a file or function name, assigned on first sight
+static uint64_t rec_index_name_id(rec_index_t *index, const char *name) {
+    uint64_t hash = hash_name(name);
+    size_t mask = index->name_capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        interned_name_t *slot = &index->names[i];
+        if (!slot->name) {
+            slot->name = name;
+            slot->hash = hash;
+            index->name_count++;
+            return (uint64_t)i + 1;
+        }
+        if (slot->hash == hash && strcmp(slot->name, name) == 0) {
+            return (uint64_t)i + 1;
+        }
+    }
+}
+
+// Name ID in the top 24 bits, line in the next 32, type in the low 8
+static uint64_t rec_index_key(rec_index_t *index, const char *name, int line,
+                              optimization_type_t type) {
+    return (rec_index_name_id(index, name) << 40) |
+           ((uint64_t)(uint32_t)line << 8) | (uint64_t)(type & 0xff);
+}
+
+// Slot holding the recommendation index for key, -1 if newly inserted
+static int* rec_index_find(rec_index_t *index, uint64_t key) {
+    size_t mask = index->capacity - 1;
+    for (size_t i = mix_key(key) & mask;; i = (i + 1) & mask) {
+        rec_slot_t *slot = &index->slots[i];
+        if (slot->key == key) return &slot->rec_index;
+        if (slot->key == 0) {
+            slot->key = key;
+            slot->rec_index = -1;
+            return &slot->rec_index;
+        }
+    }
+}
+
+static const cache_hotspot_t* rec_hotspot(const optimization_rec_t *rec) {
+    return rec->pattern ? rec->pattern->hotspot : NULL;
+}
+
 /// Current: isDuplicate is not working properly
 // Fix: Improve deduplication logic
 static bool isDuplicate(optimization_rec_t* recs, int count, 
@@ -38,349 +158,64 @@ static bool isDuplicate(optimization_rec_t* recs, int count,
     }
     return false;
 }
-// Add this helper function at the top of the file after the isDuplicate function
-static bool hasConflictingPattern(optimization_rec_t *recs, int count, 
-                                 const classified_pattern_t *pattern) {
-    if (!pattern || !pattern->hotspot) return false;
-    
-    for (int i = 0; i < count; i++) {
-        if (recs[i].pattern && recs[i].pattern->hotspot &&
-            recs[i].pattern->hotspot->location.line == pattern->hotspot->location.line &&
-            strcmp(recs[i].pattern->hotspot->location.file, pattern->hotspot->location.file) == 0) {
-            
-            // Check for conflicting access patterns
-            access_pattern_t existing = recs[i].pattern->hotspot->dominant_pattern;
-            access_pattern_t new_pattern = pattern->hotspot->dominant_pattern;
-            
-            // SEQUENTIAL conflicts with GATHER_SCATTER
-            if ((existing == SEQUENTIAL && new_pattern == GATHER_SCATTER) ||
-                (existing == GATHER_SCATTER && new_pattern == SEQUENTIAL)) {
-                return true;
-            }
-        }
-    }
-    return false;
-}
-
 // ============================================================================
 // File: recommendation_engine.c - TARGETED DEDUPLICATION LOGIC
 // ============================================================================
 
-// 1. FUNCTION TO IDENTIFY LOGICAL SCOPE FOR RECOMMENDATIONS
-typedef struct {
-    char function_name[128];
-    optimization_type_t opt_type;
-    int start_line;
-    int end_line;
-} recommendation_scope_t;
-
-bool is_same_logical_scope(const optimization_rec_t *rec1, const optimization_rec_t *rec2) {
-    // Check for null pointers
-    if (!rec1 || !rec2) {
-        return false;
-    }
-    
-    if (!rec1->pattern || !rec1->pattern->hotspot || 
-        !rec2->pattern || !rec2->pattern->hotspot) {
-        return false;
-    }
-    
-    const char *func1 = rec1->pattern->hotspot->location.function;
-    const char *func2 = rec2->pattern->hotspot->location.function;
-    int line1 = rec1->pattern->hotspot->location.line;
-    int line2 = rec2->pattern->hotspot->location.line;
-    
-    // Additional safety checks
-    if (!func1 || !func2) {
-        return false;
-    }
-    
-    // Same function
-    if (strcmp(func1, func2) != 0) {
-        return false;
-    }
-    
-    // Same optimization type
-    if (rec1->type != rec2->type) {
-        return false;
-    }
-    
-    // For certain optimizations, treat the entire function as one scope
-    switch (rec1->type) {
+// 1. LOGICAL SCOPE OF A RECOMMENDATION
+// Loop-wide optimizations are recommended once per function of a file, the
+// rest once per source line. The function's ID takes the line's place with
+// the top bit set, so the two kinds of scope never share a key
+static uint64_t scope_key(rec_index_t *index, const optimization_rec_t *rec) {
+    const cache_hotspot_t *hotspot = rec_hotspot(rec);
+    
+    switch (rec->type) {
         case OPT_LOOP_VECTORIZE:
         case OPT_PREFETCH_HINTS:
         case OPT_CACHE_BLOCKING:
         case OPT_LOOP_TILING:
-            // These should be recommended once per function, not per line
-            return true;
-            
-        case OPT_ACCESS_REORDER:
-        case OPT_DATA_LAYOUT_CHANGE:
-            // These can be different for different loops within same function
-            // Only consider same scope if lines are very close (same loop)
-            return abs(line1 - line2) <= 5;
-            
         case OPT_MEMORY_POOLING:
-            // This is typically a function-level or file-level optimization
-            return true;
-            
+            if (hotspot->location.function[0]) {
+                uint64_t function_id = rec_index_name_id(index, hotspot->location.function);
+                return rec_index_key(index, hotspot->location.file,
+                                     (int)(function_id | 0x80000000u), rec->type);
+            }
+            break;
         default:
-            return false;
-    }
-}
-
-// 2. FUNCTION TO DETERMINE IF A RECOMMENDATION MAKES SENSE
-bool is_sensible_recommendation(const optimization_rec_t *rec) {
-    if (!rec) {
-        return false;
-    }
-    
-    // Check for null pointers before accessing nested structures
-    if (!rec->pattern || !rec->pattern->hotspot) {
-        return false;
-    }
-    
-    const char *function = rec->pattern->hotspot->location.function;
-    int line = rec->pattern->hotspot->location.line;
-    
-    // Additional safety check
-    if (!function) {
-        return false;
-    }
-    
-    // Skip main() function for loop optimizations
-    if (strcmp(function, "main") == 0) {
-        switch (rec->type) {
-            case OPT_LOOP_VECTORIZE:
-            case OPT_PREFETCH_HINTS:
-            case OPT_LOOP_TILING:
-            case OPT_CACHE_BLOCKING:
-                return false;  // Don't optimize initialization code
-            default:
-                break;
-        }
-    }
-    
-    // Skip utility functions
-    if (strstr(function, "printf") || strstr(function, "malloc") || 
-        strstr(function, "free") || strstr(function, "init")) {
-        return false;
-    }
-    
-    // Skip recommendations with very low confidence or impact
-    if (rec->confidence_score < 0.5 || rec->expected_improvement < 15.0) {
-        return false;
-    }
-    
-    // OPT_LOOP_VECTORIZE: Only makes sense for computational loops
-    if (rec->type == OPT_LOOP_VECTORIZE) {
-        // Skip if this looks like initialization (early lines, low impact)
-        if (line < 30 && rec->expected_improvement < 30.0) {
-            return false;
-        }
-        // Skip if very low confidence
-        if (rec->confidence_score < 0.8) {
-            return false;
-        }
-    }
-    
-    // OPT_PREFETCH_HINTS: Only for significant access patterns
-    if (rec->type == OPT_PREFETCH_HINTS) {
-        // Skip for small arrays or low-impact patterns
-        if (rec->expected_improvement < 20.0) {
-            return false;
-        }
-    }
-    
-    // OPT_DATA_LAYOUT_CHANGE: Only if there's actually random access
-    if (rec->type == OPT_DATA_LAYOUT_CHANGE) {
-        // This shouldn't be recommended for simple matrix multiplication
-        if (strstr(function, "matrix") && rec->confidence_score < 0.8) {
-            return false;
-        }
+            break;
     }
-    
-    return true;
+    return rec_index_key(index, hotspot->location.file, hotspot->location.line, rec->type);
 }
 
 // Forward declaration
 int compare_recommendation_quality(const void *a, const void *b);
 
-// 3. SMART DEDUPLICATION THAT KEEPS ONE PER LOGICAL SCOPE
-
-// ============================================================================
-// MEMORY STRUCTURE DEBUG - Add this to recommendation_engine.c
-// ============================================================================
-
-// Ultra-basic memory check
-int check_memory_structure(optimization_rec_t *input_recs, int input_count) {
-    printf("=== MEMORY STRUCTURE DEBUG ===\n");
-    printf("Input recs pointer: %p\n", (void*)input_recs);
-    printf("Input count: %d\n", input_count);
-    printf("sizeof(optimization_rec_t): %zu\n", sizeof(optimization_rec_t));
-    
-    if (!input_recs) {
-        printf("ERROR: input_recs is NULL!\n");
-        return -1;
-    }
-    
-    if (input_count <= 0 || input_count > 1000) {
-        printf("ERROR: Suspicious input_count: %d\n", input_count);
-        return -1;
-    }
-    
-    // Try to access just the memory addresses without reading values
-    printf("Memory layout check:\n");
-    for (int i = 0; i < input_count && i < 5; i++) {
-        void *rec_addr = &input_recs[i];
-        printf("  Rec[%d] address: %p\n", i, rec_addr);
-        
-        // Try to access each field offset without reading the value
-        void *type_addr = &(input_recs[i].type);
-        void *priority_addr = &(input_recs[i].priority);
-        void *improvement_addr = &(input_recs[i].expected_improvement);
-        
-        printf("    type field at: %p\n", type_addr);
-        printf("    priority field at: %p\n", priority_addr);
-        printf("    improvement field at: %p\n", improvement_addr);
-    }
-    
-    printf("=== TRYING TO READ FIRST VALUE ===\n");
-    // Try to read just one value very carefully
-    volatile int test_type = input_recs[0].type;
-    printf("First rec type: %d\n", test_type);
-    
-    return 0;
-}
-
-// Replace your deduplicate_by_scope function with this minimal version:
-int deduplicate_by_scope(optimization_rec_t *input_recs, int input_count,
-                        optimization_rec_t **output_recs, int *output_count) {
-    
-    printf("=== MEMORY DEBUG DEDUPLICATION ===\n");
-    
-    // Check memory structure first
-    if (check_memory_structure(input_recs, input_count) != 0) {
-        return -1;
-    }
-    
-    // If we get here, just return the input unchanged for now
-    optimization_rec_t *output = malloc(input_count * sizeof(optimization_rec_t));
-    if (!output) {
-        printf("Failed to allocate output array\n");
-        return -1;
-    }
-    
-    // Simple copy without any processing
-    memcpy(output, input_recs, input_count * sizeof(optimization_rec_t));
-    
-    *output_recs = output;
-    *output_count = input_count;
+// 2. DEDUPLICATION THAT KEEPS THE BEST RECOMMENDATION PER LOGICAL SCOPE
+// In place, keeping first-seen order; returns the new count
+static int deduplicate_by_scope(optimization_rec_t *recs, int count) {
+    if (!recs || count <= 1) return count;
     
-    printf("Memory debug complete - returning %d recommendations unchanged\n", input_count);
-    return 0;
-}
-
-
-
-/*
-int deduplicate_by_scope(optimization_rec_t *input_recs, int input_count,
-                        optimization_rec_t **output_recs, int *output_count) {
-    
-    // Step 1: Filter out non-sensible recommendations
-    optimization_rec_t *sensible_recs = malloc(input_count * sizeof(optimization_rec_t));
-    int sensible_count = 0;
-    
-    printf("=== FILTERING RECOMMENDATIONS ===\n");
-    for (int i = 0; i < input_count; i++) {
-        // Safe access with null checks
-        const char *func = "unknown";
-        int line = -1;
-        
-        if (input_recs[i].pattern && input_recs[i].pattern->hotspot) {
-            func = input_recs[i].pattern->hotspot->location.function;
-            line = input_recs[i].pattern->hotspot->location.line;
-        }
-        
-        bool keep = is_sensible_recommendation(&input_recs[i]);
-        
-        printf("Rec #%d: %s at %s:%d (%.1f%% improvement) - %s\n",
-               i + 1,
-               optimization_type_to_string(input_recs[i].type),
-               func ? func : "null", line,
-               input_recs[i].expected_improvement,
-               keep ? "KEEP" : "FILTER");
-               
-        if (keep) {
-            sensible_recs[sensible_count++] = input_recs[i];
-        }
-    }
+    // Up to two names (file and function) per recommendation
+    rec_index_t index;
+    if (rec_index_init(&index, (size_t)count * 2) != 0) return count;
     
-    // Step 2: Remove duplicates within same logical scope
-    optimization_rec_t *unique_recs = malloc(sensible_count * sizeof(optimization_rec_t));
     int unique_count = 0;
-    
-    printf("\n=== DEDUPLICATING BY SCOPE ===\n");
-    for (int i = 0; i < sensible_count; i++) {
-        bool is_duplicate = false;
-        
-        // Check if we already have this optimization for this scope
-        for (int j = 0; j < unique_count; j++) {
-            if (is_same_logical_scope(&sensible_recs[i], &unique_recs[j])) {
-                // Keep the better recommendation
-                if (sensible_recs[i].priority < unique_recs[j].priority ||
-                    (sensible_recs[i].priority == unique_recs[j].priority && 
-                     sensible_recs[i].expected_improvement > unique_recs[j].expected_improvement)) {
-                    
-                    printf("Replacing %s with better version (%.1f%% vs %.1f%%)\n",
-                           optimization_type_to_string(sensible_recs[i].type),
-                           sensible_recs[i].expected_improvement,
-                           unique_recs[j].expected_improvement);
-                           
-                    unique_recs[j] = sensible_recs[i];  // Replace with better
-                } else {
-                    printf("Skipping duplicate %s (worse than existing)\n",
-                           optimization_type_to_string(sensible_recs[i].type));
-                }
-                is_duplicate = true;
-                break;
-            }
-        }
-        
-        if (!is_duplicate) {
-            const char *func = "unknown";
-            int line = -1;
-            
-            if (sensible_recs[i].pattern && sensible_recs[i].pattern->hotspot) {
-                func = sensible_recs[i].pattern->hotspot->location.function;
-                line = sensible_recs[i].pattern->hotspot->location.line;
-            }
-            
-            printf("Adding unique %s for %s:%d\n",
-                   optimization_type_to_string(sensible_recs[i].type),
-                   func ? func : "null", line);
-                   
-            unique_recs[unique_count++] = sensible_recs[i];
+    for (int i = 0; i < count; i++) {
+        int *slot = rec_index_find(&index, scope_key(&index, &recs[i]));
+        if (*slot < 0) {
+            *slot = unique_count;
+            recs[unique_count++] = recs[i];
+        } else if (compare_recommendation_quality(&recs[i], &recs[*slot]) < 0) {
+            recs[*slot] = recs[i];
         }
     }
+    rec_index_destroy(&index);
     
-    // Step 3: Sort by priority and impact
-    qsort(unique_recs, unique_count, sizeof(optimization_rec_t), compare_recommendation_quality);
-    
-    *output_recs = unique_recs;
-    *output_count = unique_count;
-    
-    printf("\n=== FINAL RESULT ===\n");
-    printf("Original: %d recommendations\n", input_count);
-    printf("After filtering: %d recommendations\n", sensible_count);
-    printf("After deduplication: %d recommendations\n", unique_count);
-    
-    free(sensible_recs);
-    return 0;
+    LOG_DEBUG("Scope deduplication: %d -> %d recommendations", count, unique_count);
+    return unique_count;
 }
-*/
 
-// 4. COMPARISON FUNCTION FOR SORTING
+// 3. COMPARISON FUNCTION FOR SORTING
 int compare_recommendation_quality(const void *a, const void *b) {
     const optimization_rec_t *rec_a = (const optimization_rec_t *)a;
     const optimization_rec_t *rec_b = (const optimization_rec_t *)b;
@@ -398,7 +233,8 @@ int compare_recommendation_quality(const void *a, const void *b) {
     if (rec_a->confidence_score > rec_b->confidence_score) return -1;
     if (rec_a->confidence_score < rec_b->confidence_score) return 1;
     
-    return 0;
+    // Easier to implement last
+    return rec_a->implementation_difficulty - rec_b->implementation_difficulty;
 }
 
 // Safe string helper
@@ -419,118 +255,306 @@ const char* safe_opt_type_string(optimization_type_t type) {
         case OPT_MEMORY_ALIGNMENT: return "MEMORY_ALIGNMENT";
         case OPT_LOOP_UNROLL: return "LOOP_UNROLL";
         case OPT_NUMA_BINDING: return "NUMA_BINDING";
+        case OPT_NONTEMPORAL_STORES: return "NONTEMPORAL_STORES";
         default: return "UNKNOWN";
     }
 }
 
-// Step-by-step debugging function
-int debug_recommendations_safely(optimization_rec_t *input_recs, int input_count) {
-    printf("=== ULTRA-SAFE DEBUG START ===\n");
-    printf("Input count: %d\n", input_count);
-    
-    if (!input_recs) {
-        printf("ERROR: input_recs is NULL!\n");
-        return -1;
+// Fixed text of each template; fields with arguments are formatted in
+// recommendation_render
+typedef struct {
+    const char *code;
+    const char *guide;
+    const char *rationale;
+    const char *flags;
+} rec_template_t;
+
+static const rec_template_t rec_templates[REC_TEXT_COUNT] = {
+    [REC_TEXT_VECTORIZE] = {
+        "// Vectorize sequential access\n"
+        "#pragma omp simd\n"
+        "for (int i = 0; i < n; i++) {\n"
+        "    sum += data[i];\n"
+        "}\n\n"
+        "// Or use intrinsics for more control:\n"
+        "#include <immintrin.h>\n"
+        "__m256d vsum = _mm256_setzero_pd();\n"
+        "for (int i = 0; i < n; i += 4) {\n"
+        "    __m256d vdata = _mm256_load_pd(&data[i]);\n"
+        "    vsum = _mm256_add_pd(vsum, vdata);\n"
+        "}",
+        "1. Ensure data is aligned to 32-byte boundaries\n"
+        "2. Use -march=native for auto-vectorization\n"
+        "3. Consider #pragma omp simd for explicit vectorization\n"
+        "4. Check vectorization report with -fopt-info-vec",
+        "Sequential access patterns are ideal for SIMD vectorization. "
+        "Processing 4-8 elements simultaneously can improve performance by 4-8x.",
+        "-O3 -march=native -ftree-vectorize -mavx2 -mfma -fopt-info-vec"
+    },
+    [REC_TEXT_ACCESS_REORDER] = {
+        "// Original column-major access (poor)\n"
+        "// for (int j = 0; j < N; j++)\n"
+        "//     for (int i = 0; i < M; i++)\n"
+        "//         sum += matrix[i][j];\n\n"
+        "// Optimized row-major access\n"
+        "for (int i = 0; i < M; i++) {\n"
+        "    for (int j = 0; j < N; j++) {\n"
+        "        sum += matrix[i][j];  // Sequential in memory\n"
+        "    }\n"
+        "}\n\n"
+        "// Or use loop interchange pragma\n"
+        "#pragma GCC ivdep\n"
+        "#pragma GCC loop interchange",
+        "1. Swap loop order to access memory sequentially\n"
+        "2. Inner loop should iterate over contiguous memory\n"
+        "3. Use compiler pragmas for automatic interchange\n"
+        "4. Consider cache-oblivious algorithms",
+        "Column-major access in row-major layout causes cache misses on every access. "
+        "Loop interchange provides immediate and significant improvement.",
+        "-floop-interchange -ftree-loop-distribution -ftree-loop-im"
+    },
+    [REC_TEXT_CACHE_BLOCKING] = {
+        "// Cache blocking to reduce working set\n"
+        "const int L1_BLOCK = 32;   // Fit in L1\n"
+        "const int L2_BLOCK = 128;  // Fit in L2\n"
+        "const int L3_BLOCK = 512;  // Fit in L3\n\n"
+        "for (int l3 = 0; l3 < n; l3 += L3_BLOCK) {\n"
+        "    for (int l2 = l3; l2 < min(l3 + L3_BLOCK, n); l2 += L2_BLOCK) {\n"
+        "        for (int l1 = l2; l1 < min(l2 + L2_BLOCK, n); l1 += L1_BLOCK) {\n"
+        "            // Process L1-sized block\n"
+        "        }\n"
+        "    }\n"
+        "}",
+        "",
+        "Multi-level cache blocking keeps data in appropriate cache levels, "
+        "preventing thrashing.",
+        "-floop-block --param l1-cache-size=32 --param l2-cache-size=512"
+    },
+    [REC_TEXT_MEMORY_POOLING] = {
+        "// Use memory pool to improve locality\n"
+        "typedef struct {\n"
+        "    void* blocks[MAX_BLOCKS];\n"
+        "    size_t block_size;\n"
+        "    int free_list[MAX_BLOCKS];\n"
+        "} memory_pool_t;\n\n"
+        "// Allocate from pool instead of malloc\n"
+        "data = pool_alloc(&pool, size);",
+        "",
+        "Memory pooling keeps related data together, improving cache locality "
+        "for random access.",
+        ""
+    },
+    [REC_TEXT_NONTEMPORAL] = {
+        "// Non-temporal stores for streaming data\n"
+        "#include <immintrin.h>\n"
+        "for (int i = 0; i < large_n; i += 4) {\n"
+        "    __m256d vdata = _mm256_load_pd(&input[i]);\n"
+        "    // Process vdata\n"
+        "    _mm256_stream_pd(&output[i], vdata);  // Bypass cache\n"
+        "}\n"
+        "_mm_sfence();  // Ensure completion\n\n"
+        "// Or use compiler intrinsics\n"
+        "#pragma GCC ivdep\n"
+        "#pragma vector nontemporal",
+        "1. Use non-temporal stores for data not reused\n"
+        "2. Keep frequently accessed data in cache\n"
+        "3. Process in chunks to maintain useful data\n"
+        "4. Consider cache partitioning if available",
+        "Non-temporal hints prevent streaming data from evicting useful cached data, "
+        "preserving performance.",
+        ""
+    },
+    [REC_TEXT_LOOP_TILING] = {
+        "// Original nested loops with poor cache behavior\n"
+        "// for (int i = 0; i < N; i++)\n"
+        "//   for (int j = 0; j < M; j++)\n"
+        "//     C[i][j] = A[i][j] + B[i][j];\n\n"
+        "// Tiled version for better cache reuse\n"
+        "#define TILE_SIZE %d  // Fits in L1 cache\n\n"
+        "for (int ii = 0; ii < N; ii += TILE_SIZE) {\n"
+        "    for (int jj = 0; jj < M; jj += TILE_SIZE) {\n"
+        "        // Process one tile\n"
+        "        for (int i = ii; i < min(ii + TILE_SIZE, N); i++) {\n"
+        "            for (int j = jj; j < min(jj + TILE_SIZE, M); j++) {\n"
+        "                C[i][j] = A[i][j] + B[i][j];\n"
+        "            }\n"
+        "        }\n"
+        "    }\n"
+        "}",
+        "1. Identify loop bounds and array dimensions\n"
+        "2. Choose tile size to fit in L1 cache (%d elements)\n"
+        "3. Add outer loops with tile-sized steps\n"
+        "4. Ensure inner loops handle boundary conditions\n"
+        "5. Test with different tile sizes for optimal performance",
+        "Loop tiling improves temporal locality by processing data in "
+        "cache-sized blocks. Working set of %.0f KB exceeds L%d cache (%.0f KB). "
+        "Tiling reduces cache misses by ~%.0f%%.",
+        ""
+    },
+    [REC_TEXT_PREFETCH] = {
+        "// Add software prefetch hints\n"
+        "#include <xmmintrin.h>  // For _mm_prefetch\n\n"
+        "for (int i = 0; i < n; i++) {\n"
+        "    // Prefetch %d iterations (%d bytes) ahead\n"
+        "    if (i + %d < n) {\n"
+        "        _mm_prefetch((const char*)&data[i + %d], %s);\n"
+        "    }\n"
+        "    \n"
+        "    // Process current element\n"
+        "    result[i] = process(data[i]);\n"
+        "}\n\n"
+        "// Alternative: Use compiler builtin\n"
+        "for (int i = 0; i < n; i++) {\n"
+        "    __builtin_prefetch(&data[i + %d], 0, %d);\n"
+        "    result[i] = process(data[i]);\n"
+        "}",
+        "1. Prefetch distance = latency / cycles per iteration = %.0f / %.1f -> %d\n"
+        "2. Insert one prefetch per stream at the top of the loop body\n"
+        "3. Use %s (locality %d) as chosen from the miss-level mix\n"
+        "4. Re-measure: a distance that is too short or too long costs bandwidth",
+        "Misses are served with ~%.0f cycles latency and one iteration costs ~%.1f cycles "
+        "(stride %d bytes), so data must be requested %d iterations ahead. %s",
+        ""
+    },
+    [REC_TEXT_DATA_LAYOUT] = {
+        "// Original Array of Structures (AoS)\n"
+        "struct Particle {\n"
+        "    double x, y, z;\n"
+        "    double vx, vy, vz;\n"
+        "    double mass;\n"
+        "};\n"
+        "Particle particles[N];\n\n"
+        "// Transformed to Structure of Arrays (SoA)\n"
+        "struct ParticleArray {\n"
+        "    double *x, *y, *z;\n"
+        "    double *vx, *vy, *vz;\n"
+        "    double *mass;\n"
+        "    size_t count;\n"
+        "};\n\n"
+        "// Access pattern changes from:\n"
+        "// for (i = 0; i < N; i++) \n"
+        "//     particles[i].x += particles[i].vx * dt;\n"
+        "// To:\n"
+        "for (i = 0; i < N; i++)\n"
+        "    particle_array.x[i] += particle_array.vx[i] * dt;",
+        "1. Identify fields that are accessed together\n"
+        "2. Group hot fields in separate arrays\n"
+        "3. Allocate arrays with proper alignment\n"
+        "4. Update all access patterns in code\n"
+        "5. Consider SIMD opportunities with SoA layout",
+        "Structure of Arrays (SoA) improves cache efficiency for "
+        "scattered field access. Current layout wastes %.0f%% of "
+        "cache line transfers. SoA enables vectorization.",
+        ""
+    },
+    [REC_TEXT_ALIGNMENT] = {
+        "// Align data structures to cache line boundaries\n"
+        "#define CACHE_LINE_SIZE 64\n\n"
+        "// Method 1: Aligned allocation\n"
+        "void* aligned_data;\n"
+        "if (posix_memalign(&aligned_data, CACHE_LINE_SIZE, \n"
+        "                   sizeof(DataType) * count) != 0) {\n"
+        "    // Handle allocation failure\n"
+        "}\n\n"
+        "// Method 2: Compiler attributes\n"
+        "struct alignas(CACHE_LINE_SIZE) AlignedData {\n"
+        "    double values[8];  // One cache line\n"
+        "};\n\n"
+        "// Method 3: Padding to prevent false sharing\n"
+        "struct PaddedData {\n"
+        "    double value;\n"
+        "    char padding[CACHE_LINE_SIZE - sizeof(double)];\n"
+        "} __attribute__((packed));",
+        "1. Identify shared data structures\n"
+        "2. Add padding or alignment attributes\n"
+        "3. Use posix_memalign for dynamic allocation\n"
+        "4. Ensure each thread's data is in separate cache lines\n"
+        "5. Verify alignment with address checks",
+        "False sharing occurs when multiple threads access different data "
+        "in the same cache line. Alignment and padding ensure each thread's "
+        "data occupies separate cache lines, eliminating coherence traffic.",
+        ""
     }
-    
-    for (int i = 0; i < input_count; i++) {
-        printf("--- Rec #%d ---\n", i + 1);
-        
-        // Check basic structure
-        printf("  Rec pointer: %p\n", (void*)&input_recs[i]);
-        printf("  Type: %d\n", (int)input_recs[i].type);
-        printf("  Type string: %s\n", safe_opt_type_string(input_recs[i].type));
-        printf("  Expected improvement: %.1f\n", input_recs[i].expected_improvement);
-        printf("  Confidence: %.1f\n", input_recs[i].confidence_score);
-        
-        // Check pattern pointer
-        printf("  Pattern: %p\n", (void*)input_recs[i].pattern);
-        if (input_recs[i].pattern) {
-            printf("  Hotspot: %p\n", (void*)input_recs[i].pattern->hotspot);
-            if (input_recs[i].pattern->hotspot) {
-                printf("  Function: %s\n", safe_string(input_recs[i].pattern->hotspot->location.function));
-                printf("  Line: %d\n", input_recs[i].pattern->hotspot->location.line);
-            } else {
-                printf("  Hotspot is NULL\n");
-            }
-        } else {
-            printf("  Pattern is NULL\n");
-        }
-        
-        printf("  --- End Rec #%d ---\n", i + 1);
-        
-        // Stop if we detect any major issues
-        if (i > 20) {
-            printf("Stopping debug after 20 items to prevent overflow\n");
-            break;
-        }
+};
+
+static const char* prefetch_hint_name(int locality) {
+    switch (locality) {
+        case 0: return "_MM_HINT_NTA";
+        case 1: return "_MM_HINT_T2";
+        case 2: return "_MM_HINT_T1";
+        default: return "_MM_HINT_T0";
     }
-    
-    printf("=== ULTRA-SAFE DEBUG END ===\n");
-    return 0;
 }
 
-// Ultra-simple deduplication that just filters main()
-int simple_filter_main_only(optimization_rec_t *input_recs, int input_count,
-                            optimization_rec_t **output_recs, int *output_count) {
-    
-    printf("=== SIMPLE FILTER (MAIN ONLY) ===\n");
-    
-    // First, debug the input safely
-    if (debug_recommendations_safely(input_recs, input_count) != 0) {
-        return -1;
-    }
-    
-    // Allocate output array
-    optimization_rec_t *filtered = malloc(input_count * sizeof(optimization_rec_t));
-    if (!filtered) {
-        printf("ERROR: Failed to allocate filtered array\n");
-        return -1;
+// Render one text field. Only templates with arguments go through
+// snprintf; the note is appended to the rationale
+int recommendation_render(const optimization_rec_t *rec, rec_field_t field,
+                          char *buffer, size_t size) {
+    if (!rec || !buffer || size == 0) return -1;
+    
+    buffer[0] = '\0';
+    if (rec->text_id <= REC_TEXT_NONE || rec->text_id >= REC_TEXT_COUNT) {
+        if (field == REC_FIELD_RATIONALE && rec->note) {
+            return snprintf(buffer, size, "%s", rec->note);
+        }
+        return 0;
     }
     
-    int filtered_count = 0;
-    
-    printf("Starting filtering loop...\n");
-    for (int i = 0; i < input_count; i++) {
-        bool keep = true;
-        
-        printf("Processing rec #%d: ", i + 1);
-        
-        // Only filter out main() function recommendations
-        if (input_recs[i].pattern && 
-            input_recs[i].pattern->hotspot && 
-            input_recs[i].pattern->hotspot->location.function) {
+    const rec_template_t *t = &rec_templates[rec->text_id];
+    const double *a = rec->text_args;
+    int len = 0;
+    
+    switch (field) {
+        case REC_FIELD_CODE:
+            if (rec->text_id == REC_TEXT_LOOP_TILING) {
+                len = snprintf(buffer, size, t->code, (int)a[0]);
+            } else if (rec->text_id == REC_TEXT_PREFETCH) {
+                int distance = (int)a[0], locality = (int)a[2];
+                len = snprintf(buffer, size, t->code, distance, distance * (int)a[1],
+                               distance, distance, prefetch_hint_name(locality),
+                               distance, locality);
+            } else {
+                len = snprintf(buffer, size, "%s", t->code);
+            }
+            break;
             
-            const char *func = input_recs[i].pattern->hotspot->location.function;
-            printf("Function: %s ", func);
+        case REC_FIELD_GUIDE:
+            if (rec->text_id == REC_TEXT_LOOP_TILING) {
+                len = snprintf(buffer, size, t->guide, (int)a[0]);
+            } else if (rec->text_id == REC_TEXT_PREFETCH) {
+                len = snprintf(buffer, size, t->guide, a[3], a[4], (int)a[0],
+                               prefetch_hint_name((int)a[2]), (int)a[2]);
+            } else {
+                len = snprintf(buffer, size, "%s", t->guide);
+            }
+            break;
             
-            if (strcmp(func, "main") == 0) {
-                printf("- FILTERED (main function)");
-                keep = false;
+        case REC_FIELD_RATIONALE:
+            if (rec->text_id == REC_TEXT_LOOP_TILING) {
+                len = snprintf(buffer, size, t->rationale, a[1], (int)a[2], a[3], a[4]);
+            } else if (rec->text_id == REC_TEXT_PREFETCH) {
+                len = snprintf(buffer, size, t->rationale, a[3], a[4], (int)a[1], (int)a[0],
+                               a[5] != 0 ? "Cache simulation confirms fewer stall cycles." :
+                                           "Not validated by simulation.");
+            } else if (rec->text_id == REC_TEXT_DATA_LAYOUT) {
+                len = snprintf(buffer, size, t->rationale, a[0]);
             } else {
-                printf("- KEPT");
+                len = snprintf(buffer, size, "%s", t->rationale);
             }
-        } else {
-            printf("- KEPT (no function info)");
-        }
-        
-        printf("\n");
-        
-        if (keep) {
-            filtered[filtered_count] = input_recs[i];
-            filtered_count++;
-        }
+            if (rec->note && len >= 0) {
+                size_t used = (size_t)len < size ? (size_t)len : size - 1;
+                len += snprintf(buffer + used, size - used, " %s", rec->note);
+            }
+            break;
+            
+        case REC_FIELD_FLAGS:
+            len = snprintf(buffer, size, "%s", rec->tuned_flags ? rec->tuned_flags : t->flags);
+            break;
     }
     
-    printf("Filtered: %d -> %d recommendations\n", input_count, filtered_count);
-    
-    *output_recs = filtered;
-    *output_count = filtered_count;
-    
-    return 0;
+    return len;
 }
 
-
 int recommendation_engine_save_to_file(const optimization_rec_t *recs, int count,
                                       const char *filename) {
     FILE *fp = fopen(filename, "w");
@@ -544,6 +568,7 @@ int recommendation_engine_save_to_file(const optimization_rec_t *recs, int count
     fprintf(fp, "Total recommendations: %d\n\n", count);
     
     // Group by location for better readability
+    char text[2048];
     int rec_num = 1;
     for (int i = 0; i < count; i++) {
         const optimization_rec_t *rec = &recs[i];
@@ -571,6 +596,13 @@ int recommendation_engine_save_to_file(const optimization_rec_t *recs, int count
         fprintf(fp, "Expected Improvement: %.1f%%\n", rec->expected_improvement);
         fprintf(fp, "Confidence: %.0f%%\n", rec->confidence_score * 100);
         fprintf(fp, "Implementation Difficulty: %d/10\n", rec->implementation_difficulty);
+        if (rec->cycles_saved > 0) {
+            fprintf(fp, "Estimated Savings: %.0f cycles\n", rec->cycles_saved);
+        }
+        if (rec->measured_speedup > 0) {
+            fprintf(fp, "Measured Speedup: %.2fx (CI %.2f-%.2f, microkernel)\n",
+                    rec->measured_speedup, rec->speedup_ci_low, rec->speedup_ci_high);
+        }
         
         if (rec->pattern && rec->pattern->hotspot) {
             fprintf(fp, "Location: %s:%d\n",
@@ -578,18 +610,19 @@ int recommendation_engine_save_to_file(const optimization_rec_t *recs, int count
                    rec->pattern->hotspot->location.line);
         }
         
-        fprintf(fp, "\nRationale:\n%s\n", rec->rationale);
+        recommendation_render(rec, REC_FIELD_RATIONALE, text, sizeof(text));
+        fprintf(fp, "\nRationale:\n%s\n", text);
         
-        if (strlen(rec->compiler_flags) > 0) {
-            fprintf(fp, "\nCompiler Flags:\n%s\n", rec->compiler_flags);
+        if (recommendation_render(rec, REC_FIELD_FLAGS, text, sizeof(text)) > 0) {
+            fprintf(fp, "\nCompiler Flags:\n%s\n", text);
         }
         
-        if (strlen(rec->implementation_guide) > 0) {
-            fprintf(fp, "\nImplementation Guide:\n%s\n", rec->implementation_guide);
+        if (recommendation_render(rec, REC_FIELD_GUIDE, text, sizeof(text)) > 0) {
+            fprintf(fp, "\nImplementation Guide:\n%s\n", text);
         }
         
-        if (strlen(rec->code_suggestion) > 0) {
-            fprintf(fp, "\nCode Example:\n%s\n", rec->code_suggestion);
+        if (recommendation_render(rec, REC_FIELD_CODE, text, sizeof(text)) > 0) {
+            fprintf(fp, "\nCode Example:\n%s\n", text);
         }
         
         fprintf(fp, "\n");
@@ -601,8 +634,8 @@ int recommendation_engine_save_to_file(const optimization_rec_t *recs, int count
 }
 
 
-
-// In recommendation_engine.c, replace the entire recommendation_engine_analyze_all function:
+static int analyze_pattern(recommendation_engine_t *engine, const classified_pattern_t *pattern,
+                           optimization_rec_t *recs);
 
 int recommendation_engine_analyze_all(recommendation_engine_t *engine,
                                      const classified_pattern_t *patterns,
@@ -613,295 +646,134 @@ int recommendation_engine_analyze_all(recommendation_engine_t *engine,
         LOG_ERROR("Invalid parameters for recommendation_engine_analyze_all");
         return -1;
     }
+    TRACE_SCOPE(trace, "recommendations.analyze_all");
+    trace_add_items(&trace, pattern_count);
+    
+    *all_recommendations = NULL;
+    *total_rec_count = 0;
     
-    // Track which locations we've already generated recommendations for
-    typedef struct {
-        char file[256];
-        int line;
-        optimization_type_t types[10];  // Track which types we've recommended
-        int type_count;
-    } location_tracker_t;
-    
-    location_tracker_t *tracked_locations = CALLOC_LOGGED(pattern_count * 5, sizeof(location_tracker_t));
-    int tracked_count = 0;
-    
-    // Pre-allocate space for all potential recommendations
-    int max_total = pattern_count * engine->config.max_recommendations;
-    optimization_rec_t *temp_recs = CALLOC_LOGGED(max_total, sizeof(optimization_rec_t));
-    if (!temp_recs || !tracked_locations) {
-        if (temp_recs) FREE_LOGGED(temp_recs);
-        if (tracked_locations) FREE_LOGGED(tracked_locations);
+    // One index entry per (file, line, type) already recommended
+    rec_index_t index;
+    size_t max_total = (size_t)pattern_count * engine->config.max_recommendations;
+    if (rec_index_init(&index, max_total) != 0) {
         return -1;
     }
     
-    int total_count = 0;
-    
-    // Helper function to check if we already have this type at this location
-    auto already_has_recommendation = [&](const char* file, int line, optimization_type_t type) -> bool {
-        for (int i = 0; i < tracked_count; i++) {
-            if (tracked_locations[i].line == line && 
-                strcmp(tracked_locations[i].file, file) == 0) {
-                // Check if we already have this type
-                for (int j = 0; j < tracked_locations[i].type_count; j++) {
-                    if (tracked_locations[i].types[j] == type) {
-                        return true;
-                    }
-                }
-                return false;
-            }
-        }
-        return false;
-    };
+    // Working buffers live in scratch and are rewound on return; temp_recs is
+    // grown on demand since most patterns yield far fewer than max_recommendations
+    pthread_mutex_lock(&engine->mutex);
+    arena_mark_t mark = arena_mark(engine->scratch);
+    int max_recs = engine->config.max_recommendations;
+    int capacity = pattern_count;
+    optimization_rec_t *recs = arena_alloc(engine->scratch, max_recs * sizeof(optimization_rec_t));
+    optimization_rec_t *temp_recs = arena_alloc(engine->scratch, capacity * sizeof(optimization_rec_t));
+    if (!recs || !temp_recs) {
+        arena_rewind(engine->scratch, mark);
+        pthread_mutex_unlock(&engine->mutex);
+        rec_index_destroy(&index);
+        return -1;
+    }
     
-    // Helper function to add a tracked recommendation
-    auto track_recommendation = [&](const char* file, int line, optimization_type_t type) {
-        // Find or create location entry
-        int loc_idx = -1;
-        for (int i = 0; i < tracked_count; i++) {
-            if (tracked_locations[i].line == line && 
-                strcmp(tracked_locations[i].file, file) == 0) {
-                loc_idx = i;
-                break;
-            }
-        }
-        
-        if (loc_idx == -1) {
-            // New location
-            loc_idx = tracked_count++;
-            strncpy(tracked_locations[loc_idx].file, file, 255);
-            tracked_locations[loc_idx].line = line;
-            tracked_locations[loc_idx].type_count = 0;
-        }
-        
-        // Add type if there's room
-        if (tracked_locations[loc_idx].type_count < 10) {
-            tracked_locations[loc_idx].types[tracked_locations[loc_idx].type_count++] = type;
-        }
-    };
+    int total_count = 0;
+    int duplicate_count = 0;
+    int skipped_count = 0;
     
     // Process each pattern
     for (int i = 0; i < pattern_count; i++) {
-        // Skip patterns without valid hotspot data
-        if (!patterns[i].hotspot) {
-            LOG_WARNING("Pattern %d has no hotspot data, skipping", i);
-            continue;
-        }
-        
-        // Validate line number - skip if it's beyond reasonable bounds
-        if (patterns[i].hotspot->location.line <= 0 || 
-            patterns[i].hotspot->location.line > 1000) {
-            LOG_WARNING("Invalid line number %d for pattern %d, skipping",
-                       patterns[i].hotspot->location.line, i);
+        // Skip patterns without a resolved source location
+        if (!patterns[i].hotspot || patterns[i].hotspot->location.line <= 0) {
+            skipped_count++;
             continue;
         }
         
-        optimization_rec_t *recs = NULL;
-        int count = 0;
+        memset(recs, 0, max_recs * sizeof(optimization_rec_t));
+        int count = analyze_pattern(engine, &patterns[i], recs);
         
-        if (recommendation_engine_analyze(engine, &patterns[i], &recs, &count) == 0) {
-            // Filter recommendations based on location tracking
-            for (int j = 0; j < count; j++) {
-                if (!recs[j].pattern || !recs[j].pattern->hotspot) {
-                    continue;
-                }
-                
-                const char* file = recs[j].pattern->hotspot->location.file;
-                int line = recs[j].pattern->hotspot->location.line;
-                optimization_type_t type = recs[j].type;
-                
-                // Skip if we already have this type of recommendation at this location
-                if (already_has_recommendation(file, line, type)) {
-                    LOG_DEBUG("Skipping duplicate %s at %s:%d",
-                             optimization_type_to_string(type), file, line);
-                    continue;
-                }
-                
-                // Additional filtering based on context
-                bool should_include = true;
-                
-                // Filter out memory pooling for static arrays
-                if (type == OPT_MEMORY_POOLING) {
-                    // Check if this is actually dynamic allocation context
-                    // For now, skip memory pooling for matrix multiplication
-                    if (strstr(file, "matrix") != NULL) {
-                        LOG_DEBUG("Skipping memory pooling for matrix code");
-                        should_include = false;
-                    }
-                }
-                
-                // Filter out SoA transformation unless it's actually struct access
-                if (type == OPT_DATA_LAYOUT_CHANGE) {
-                    // Check if the pattern is actually about struct access
-                    if (patterns[i].hotspot->dominant_pattern != GATHER_SCATTER &&
-                        patterns[i].hotspot->dominant_pattern != RANDOM) {
-                        LOG_DEBUG("Skipping data layout change for non-gather pattern");
-                        should_include = false;
-                    }
+        for (int j = 0; j < count; j++) {
+            const cache_hotspot_t *hotspot = rec_hotspot(&recs[j]);
+            if (!hotspot) continue;
+            
+            const char *file = hotspot->location.file;
+            int line = hotspot->location.line;
+            optimization_type_t type = recs[j].type;
+            
+            // Filter out memory pooling for static arrays
+            if (type == OPT_MEMORY_POOLING && strstr(file, "matrix") != NULL) {
+                LOG_DEBUG("Skipping memory pooling for matrix code");
+                continue;
+            }
+            
+            // Filter out SoA transformation unless it's actually struct access
+            if (type == OPT_DATA_LAYOUT_CHANGE &&
+                patterns[i].hotspot->dominant_pattern != GATHER_SCATTER &&
+                patterns[i].hotspot->dominant_pattern != RANDOM) {
+                LOG_DEBUG("Skipping data layout change for non-gather pattern");
+                continue;
+            }
+            
+            // Same type at the same location: keep the better one
+            int *slot = rec_index_find(&index, rec_index_key(&index, file, line, type));
+            if (*slot >= 0) {
+                if (compare_recommendation_quality(&recs[j], &temp_recs[*slot]) < 0) {
+                    temp_recs[*slot] = recs[j];
                 }
-                
-                // Only include if it passes all filters
-                if (should_include && total_count < max_total) {
-                    temp_recs[total_count] = recs[j];
-                    track_recommendation(file, line, type);
-                    total_count++;
-                    
-                    LOG_DEBUG("Added %s recommendation for %s:%d (total: %d)",
-                             optimization_type_to_string(type), file, line, total_count);
+                duplicate_count++;
+                continue;
+            }
+            
+            if (total_count == capacity) {
+                capacity *= 2;
+                optimization_rec_t *grown = arena_alloc(engine->scratch, capacity * sizeof(optimization_rec_t));
+                if (!grown) {
+                    LOG_ERROR("Failed to grow recommendation buffer to %d entries", capacity);
+                    arena_rewind(engine->scratch, mark);
+                    pthread_mutex_unlock(&engine->mutex);
+                    rec_index_destroy(&index);
+                    return -1;
                 }
+                memcpy(grown, temp_recs, total_count * sizeof(optimization_rec_t));
+                temp_recs = grown;
             }
-            FREE_LOGGED(recs);
+            
+            *slot = total_count;
+            temp_recs[total_count++] = recs[j];
         }
     }
     
-    // Sort by priority and expected improvement
-    qsort(temp_recs, total_count, sizeof(optimization_rec_t), 
-          [](const void* a, const void* b) -> int {
-              const optimization_rec_t* ra = (const optimization_rec_t*)a;
-              const optimization_rec_t* rb = (const optimization_rec_t*)b;
-              
-              // First sort by priority (lower number = higher priority)
-              if (ra->priority != rb->priority) {
-                  return ra->priority - rb->priority;
-              }
-              
-              // Then by expected improvement (higher is better)
-              if (ra->expected_improvement > rb->expected_improvement) return -1;
-              if (ra->expected_improvement < rb->expected_improvement) return 1;
-              
-              return 0;
-          });
-    
-    // Final allocation and copy
-    *all_recommendations = CALLOC_LOGGED(total_count, sizeof(optimization_rec_t));
-    if (!*all_recommendations) {
-        FREE_LOGGED(temp_recs);
-        FREE_LOGGED(tracked_locations);
-        return -1;
+    rec_index_destroy(&index);
+    
+    if (skipped_count > 0) {
+        LOG_WARNING("Skipped %d patterns without a source location", skipped_count);
     }
     
-    memcpy(*all_recommendations, temp_recs, total_count * sizeof(optimization_rec_t));
+    // Loop-wide optimizations once per function, then drop the conflicts
+    total_count = deduplicate_by_scope(temp_recs, total_count);
+    total_count = filter_conflicting_recommendations(temp_recs, total_count);
+    rank_recommendations_by_cost(temp_recs, total_count, &engine->cache_info, &engine->profile);
+    
+    if (total_count > 0) {
+        // With a run arena the records live as long as the run and the caller
+        // does not free them
+        size_t bytes = total_count * sizeof(optimization_rec_t);
+        *all_recommendations = engine->config.arena ? arena_alloc(engine->config.arena, bytes)
+                                                    : MALLOC_LOGGED(bytes);
+        if (!*all_recommendations) {
+            arena_rewind(engine->scratch, mark);
+            pthread_mutex_unlock(&engine->mutex);
+            return -1;
+        }
+        memcpy(*all_recommendations, temp_recs, bytes);
+    }
+    arena_rewind(engine->scratch, mark);
+    pthread_mutex_unlock(&engine->mutex);
     *total_rec_count = total_count;
     
-    FREE_LOGGED(temp_recs);
-    FREE_LOGGED(tracked_locations);
-    
-    LOG_INFO("Generated %d unique recommendations after deduplication", total_count);
+    LOG_INFO("Generated %d unique recommendations from %d patterns (%d duplicates merged)",
+             total_count, pattern_count, duplicate_count);
     
     return 0;
 }
 
-// Also fix the synthetic pattern generation in main.c to avoid invalid line numbers:
-// In main.c, replace the synthetic pattern generation section:
-
-    // If no dynamic profiling data, create synthetic patterns from static analysis
-    if (sample_count == 0 && static_results.pattern_count > 0) {
-        LOG_INFO("No dynamic profiling data - generating patterns from static analysis");
-        
-        // Count valid patterns (with reasonable line numbers)
-        int valid_pattern_count = 0;
-        for (int i = 0; i < static_results.pattern_count; i++) {
-            if (static_results.patterns[i].location.line > 0 && 
-                static_results.patterns[i].location.line <= 1000) {
-                valid_pattern_count++;
-            }
-        }
-        
-        if (valid_pattern_count == 0) {
-            LOG_WARNING("No valid static patterns found");
-            goto cleanup;
-        }
-        
-        hotspot_count = valid_pattern_count;
-        hotspots = CALLOC_LOGGED(hotspot_count, sizeof(cache_hotspot_t));
-        patterns = CALLOC_LOGGED(hotspot_count, sizeof(classified_pattern_t));
-        pattern_count = hotspot_count;
-        
-        int idx = 0;
-        for (int i = 0; i < static_results.pattern_count && idx < hotspot_count; i++) {
-            static_pattern_t *sp = &static_results.patterns[i];
-            
-            // Skip patterns with invalid line numbers
-            if (sp->location.line <= 0 || sp->location.line > 1000) {
-                LOG_DEBUG("Skipping pattern with invalid line %d", sp->location.line);
-                continue;
-            }
-            
-            cache_hotspot_t *hs = &hotspots[idx];
-            classified_pattern_t *pat = &patterns[idx];
-            
-            // Copy location and set dominant pattern
-            hs->location = sp->location;
-            hs->dominant_pattern = sp->pattern;
-            hs->access_stride = (sp->stride > 0 && sp->stride < 1000) ? sp->stride : 1;
-            pat->hotspot = hs;
-            
-            // Map static patterns to cache antipatterns
-            switch(sp->pattern) {
-                case SEQUENTIAL:
-                    pat->type = HOTSPOT_REUSE;
-                    hs->miss_rate = 0.05;
-                    hs->avg_latency_cycles = 4;
-                    break;
-                    
-                case STRIDED:
-                    // For matrix multiplication, strided usually means poor loop order
-                    if (strstr(sp->location.file, "matrix") != NULL) {
-                        pat->type = LOOP_INTERCHANGE_NEEDED;
-                        hs->miss_rate = 0.6;
-                    } else if (sp->stride > 8) {
-                        pat->type = STREAMING_EVICTION;
-                        hs->miss_rate = 0.5;
-                    } else {
-                        pat->type = BANK_CONFLICTS;
-                        hs->miss_rate = 0.4;
-                    }
-                    hs->avg_latency_cycles = 50 + sp->stride * 2;
-                    break;
-                    
-                case RANDOM:
-                    pat->type = IRREGULAR_GATHER_SCATTER;
-                    hs->miss_rate = 0.8;
-                    hs->avg_latency_cycles = 200;
-                    break;
-                    
-                case GATHER_SCATTER:
-                    pat->type = IRREGULAR_GATHER_SCATTER;
-                    hs->miss_rate = 0.7;
-                    hs->avg_latency_cycles = 150;
-                    break;
-                    
-                default:
-                    pat->type = UNCLASSIFIED;
-                    hs->miss_rate = 0.5;
-                    hs->avg_latency_cycles = 100;
-                    break;
-            }
-            
-            // Set other pattern fields
-            pat->severity_score = hs->miss_rate * 100;
-            pat->confidence = 0.7;  // Lower confidence for synthetic
-            pat->performance_impact = hs->miss_rate * 50;
-            
-            snprintf(pat->description, sizeof(pat->description),
-                     "Static analysis pattern: %s access with stride %d at line %d",
-                     access_pattern_to_string(sp->pattern), 
-                     hs->access_stride,
-                     sp->location.line);
-            snprintf(pat->root_cause, sizeof(pat->root_cause),
-                     "Detected from static code analysis at %s:%d",
-                     sp->location.file, sp->location.line);
-            
-            idx++;
-        }
-        
-        // Adjust counts if we skipped any
-        hotspot_count = idx;
-        pattern_count = idx;
-        
-        LOG_INFO("Generated %d synthetic patterns from static analysis", pattern_count);
-    }
-
-
 // Create recommendation engine
 recommendation_engine_t* recommendation_engine_create(const engine_config_t *config,
                                                     const cache_info_t *cache_info) {
@@ -920,6 +792,16 @@ recommendation_engine_t* recommendation_engine_create(const engine_config_t *con
     engine->cache_info = *cache_info;
     pthread_mutex_init(&engine->mutex, NULL);
     
+    engine->scratch = config->scratch;
+    if (!engine->scratch) {
+        engine->scratch = arena_create(0);
+        engine->owns_scratch = true;
+        if (!engine->scratch) {
+            recommendation_engine_destroy(engine);
+            return NULL;
+        }
+    }
+    
     LOG_INFO("Created recommendation engine with min improvement threshold %.1f%%",
              config->min_expected_improvement);
     
@@ -931,6 +813,12 @@ void recommendation_engine_destroy(recommendation_engine_t *engine) {
     if (!engine) return;
     
     LOG_INFO("Destroying recommendation engine");
+    if (engine->prefetch_evaluator) {
+        evaluator_destroy(engine->prefetch_evaluator);
+    }
+    if (engine->owns_scratch) {
+        arena_destroy(engine->scratch);
+    }
     pthread_mutex_destroy(&engine->mutex);
     FREE_LOGGED(engine);
 }
@@ -938,40 +826,98 @@ void recommendation_engine_destroy(recommendation_engine_t *engine) {
 
 
 
-// Analyze single pattern
-// Analyze single pattern with comprehensive pattern-specific recommendations
-// Fix 2: Improved recommendation analysis with better stride handling
-int recommendation_engine_analyze(recommendation_engine_t *engine,
-                                 const classified_pattern_t *pattern,
-                                 optimization_rec_t **recommendations,
-                                 int *rec_count) {
-    if (!engine || !pattern || !recommendations || !rec_count) {
-        LOG_ERROR("Invalid parameters for recommendation_engine_analyze");
+// Validate through the memo, keyed by stride, distance, level, the loop cost
+// in quarter cycles and the footprint's power of two
+static int validate_prefetch_cached(recommendation_engine_t *engine, int stride_bytes,
+                                    size_t footprint, double cycles_per_iteration,
+                                    int distance, int target_level,
+                                    prefetch_validation_t *validation) {
+    int footprint_log2 = 0;
+    while (footprint_log2 < 63 && ((size_t)1 << footprint_log2) < footprint) footprint_log2++;
+    
+    uint64_t key = ((uint64_t)(uint32_t)stride_bytes << 32) ^ ((uint64_t)distance << 16) ^
+                   ((uint64_t)target_level << 12) ^ ((uint64_t)footprint_log2 << 6) ^
+                   ((uint64_t)llround(cycles_per_iteration * 4) << 40);
+    key = mix_key(key) | 1;
+    
+    int slot = key % 64;
+    if (engine->prefetch_memo[slot].key == key) {
+        *validation = engine->prefetch_memo[slot].result;
+        return 0;
+    }
+    
+    if (evaluator_validate_prefetch(engine->prefetch_evaluator, stride_bytes, footprint,
+                                    cycles_per_iteration, distance, target_level, validation) != 0) {
         return -1;
     }
+    engine->prefetch_memo[slot].key = key;
+    engine->prefetch_memo[slot].result = *validation;
+    return 0;
+}
+
+// Compute a prefetch plan and check it in the cache simulator. A late
+// prefetch gets one retry at twice the distance; a plan that still does
+// not reduce stalls is dropped, a wrong distance is worse than none
+static int plan_validated_prefetch(recommendation_engine_t *engine,
+                                   const cache_hotspot_t *hotspot, prefetch_plan_t *plan) {
+    if (compute_prefetch_plan(hotspot, &engine->cache_info, plan) != 0) return -1;
+    
+    if (!engine->prefetch_evaluator) {
+        evaluator_config_t eval_config = evaluator_config_default();
+        eval_config.enable_simulation = true;
+        engine->prefetch_evaluator = evaluator_create(&eval_config, &engine->cache_info);
+        if (!engine->prefetch_evaluator) return 0;  // Keep the unvalidated plan
+    }
     
-    LOG_INFO("Analyzing pattern %s for optimizations (access pattern: %s)",
-             cache_antipattern_to_string(pattern->type),
-             pattern->hotspot ? access_pattern_to_string(pattern->hotspot->dominant_pattern) : "unknown");
+    size_t footprint = hotspot->address_range_end > hotspot->address_range_start ?
+                       hotspot->address_range_end - hotspot->address_range_start : 0;
+    int target_level = plan->locality == 3 ? 1 : plan->locality == 0 ? 0 : 2;
     
-    pthread_mutex_lock(&engine->mutex);
+    prefetch_validation_t validation;
+    if (validate_prefetch_cached(engine, plan->stride_bytes, footprint,
+                                 plan->cycles_per_iteration, plan->distance, target_level,
+                                 &validation) != 0) {
+        return 0;
+    }
     
-    // Allocate space for recommendations
-    optimization_rec_t *recs = CALLOC_LOGGED(engine->config.max_recommendations, 
-                                            sizeof(optimization_rec_t));
-    if (!recs) {
-        pthread_mutex_unlock(&engine->mutex);
+    if (!validation.validated && validation.late_fraction > 0.3 && plan->distance < 512) {
+        int retry = plan->distance * 2 > 512 ? 512 : plan->distance * 2;
+        prefetch_validation_t longer;
+        if (validate_prefetch_cached(engine, plan->stride_bytes, footprint,
+                                     plan->cycles_per_iteration, retry, target_level,
+                                     &longer) == 0 && longer.validated) {
+            plan->distance = retry;
+            validation = longer;
+        }
+    }
+    
+    if (!validation.validated) {
+        LOG_DEBUG("Dropping prefetch for %s:%d: distance %d does not reduce stalls "
+                  "(late %.0f%%, useless %.0f%%)", hotspot->location.file, hotspot->location.line,
+                  plan->distance, validation.late_fraction * 100, validation.useless_fraction * 100);
         return -1;
     }
     
+    plan->validated = true;
+    plan->stall_before = validation.baseline_stall_cycles;
+    plan->stall_after = validation.prefetch_stall_cycles;
+    return 0;
+}
+
+// Analyze single pattern with comprehensive pattern-specific recommendations
+// into recs, zeroed with room for max_recommendations; returns the count kept.
+// Caller holds the engine mutex
+static int analyze_pattern(recommendation_engine_t *engine, const classified_pattern_t *pattern,
+                           optimization_rec_t *recs) {
+    LOG_INFO("Analyzing pattern %s for optimizations (access pattern: %s)",
+             cache_antipattern_to_string(pattern->type),
+             pattern->hotspot ? access_pattern_to_string(pattern->hotspot->dominant_pattern) : "unknown");
+    
     int count = 0;
     
     // Skip if no hotspot data
     if (!pattern->hotspot) {
         LOG_WARNING("Pattern has no hotspot data, skipping");
-        *recommendations = recs;
-        *rec_count = 0;
-        pthread_mutex_unlock(&engine->mutex);
         return 0;
     }
     
@@ -1009,32 +955,7 @@ int recommendation_engine_analyze(recommendation_engine_t *engine,
                 rec->implementation_difficulty = 3;
                 rec->priority = 2;
                 
-                snprintf(rec->code_suggestion, sizeof(rec->code_suggestion),
-                        "// Vectorize sequential access\n"
-                        "#pragma omp simd\n"
-                        "for (int i = 0; i < n; i++) {\n"
-                        "    sum += data[i];\n"
-                        "}\n\n"
-                        "// Or use intrinsics for more control:\n"
-                        "#include <immintrin.h>\n"
-                        "__m256d vsum = _mm256_setzero_pd();\n"
-                        "for (int i = 0; i < n; i += 4) {\n"
-                        "    __m256d vdata = _mm256_load_pd(&data[i]);\n"
-                        "    vsum = _mm256_add_pd(vsum, vdata);\n"
-                        "}");
-                
-                snprintf(rec->implementation_guide, sizeof(rec->implementation_guide),
-                        "1. Ensure data is aligned to 32-byte boundaries\n"
-                        "2. Use -march=native for auto-vectorization\n"
-                        "3. Consider #pragma omp simd for explicit vectorization\n"
-                        "4. Check vectorization report with -fopt-info-vec");
-                
-                snprintf(rec->rationale, sizeof(rec->rationale),
-                        "Sequential access patterns are ideal for SIMD vectorization. "
-                        "Processing 4-8 elements simultaneously can improve performance by 4-8x.");
-                
-                snprintf(rec->compiler_flags, sizeof(rec->compiler_flags),
-                        "-O3 -march=native -ftree-vectorize -mavx2 -mfma -fopt-info-vec");
+                rec->text_id = REC_TEXT_VECTORIZE;
                 
                 if (!isDuplicate(recs, count, rec->type, pattern)) {
                     count++;
@@ -1043,8 +964,9 @@ int recommendation_engine_analyze(recommendation_engine_t *engine,
             
             // Prefetching for sequential (less important)
             if (count < engine->config.max_recommendations && pattern->hotspot->miss_rate > 0.05) {
-                if (generate_prefetch_recommendation(pattern, &recs[count]) == 0) {
-                    recs[count].expected_improvement = 15.0;
+                prefetch_plan_t plan;
+                if (plan_validated_prefetch(engine, pattern->hotspot, &plan) == 0 &&
+                    generate_prefetch_recommendation(pattern, &plan, &recs[count]) == 0) {
                     recs[count].priority = 3;
                     if (!isDuplicate(recs, count, recs[count].type, pattern)) {
                         count++;
@@ -1073,33 +995,8 @@ int recommendation_engine_analyze(recommendation_engine_t *engine,
                 rec->implementation_difficulty = 2;
                 rec->priority = 1;
                 
-                snprintf(rec->code_suggestion, sizeof(rec->code_suggestion),
-                        "// Original column-major access (poor)\n"
-                        "// for (int j = 0; j < N; j++)\n"
-                        "//     for (int i = 0; i < M; i++)\n"
-                        "//         sum += matrix[i][j];\n\n"
-                        "// Optimized row-major access\n"
-                        "for (int i = 0; i < M; i++) {\n"
-                        "    for (int j = 0; j < N; j++) {\n"
-                        "        sum += matrix[i][j];  // Sequential in memory\n"
-                        "    }\n"
-                        "}\n\n"
-                        "// Or use loop interchange pragma\n"
-                        "#pragma GCC ivdep\n"
-                        "#pragma GCC loop interchange");
-                
-                snprintf(rec->implementation_guide, sizeof(rec->implementation_guide),
-                        "1. Swap loop order to access memory sequentially\n"
-                        "2. Inner loop should iterate over contiguous memory\n"
-                        "3. Use compiler pragmas for automatic interchange\n"
-                        "4. Consider cache-oblivious algorithms");
-                
-                snprintf(rec->rationale, sizeof(rec->rationale),
-                        "Column-major access in row-major layout causes cache misses on every access. "
-                        "Loop interchange provides immediate and significant improvement.");
-                
-                snprintf(rec->compiler_flags, sizeof(rec->compiler_flags),
-                        "-floop-interchange -ftree-loop-distribution -ftree-loop-im");
+                rec->text_id = REC_TEXT_ACCESS_REORDER;
+                rec->is_automatic = true;  // Interchange can be applied with --auto-apply
                 
                 if (!isDuplicate(recs, count, rec->type, pattern)) {
                     count++;
@@ -1116,25 +1013,7 @@ int recommendation_engine_analyze(recommendation_engine_t *engine,
                 rec->implementation_difficulty = 5;
                 rec->priority = 2;
                 
-                snprintf(rec->code_suggestion, sizeof(rec->code_suggestion),
-                        "// Cache blocking to reduce working set\n"
-                        "const int L1_BLOCK = 32;   // Fit in L1\n"
-                        "const int L2_BLOCK = 128;  // Fit in L2\n"
-                        "const int L3_BLOCK = 512;  // Fit in L3\n\n"
-                        "for (int l3 = 0; l3 < n; l3 += L3_BLOCK) {\n"
-                        "    for (int l2 = l3; l2 < min(l3 + L3_BLOCK, n); l2 += L2_BLOCK) {\n"
-                        "        for (int l1 = l2; l1 < min(l2 + L2_BLOCK, n); l1 += L1_BLOCK) {\n"
-                        "            // Process L1-sized block\n"
-                        "        }\n"
-                        "    }\n"
-                        "}");
-                
-                snprintf(rec->rationale, sizeof(rec->rationale),
-                        "Multi-level cache blocking keeps data in appropriate cache levels, "
-                        "preventing thrashing.");
-                
-                snprintf(rec->compiler_flags, sizeof(rec->compiler_flags),
-                        "-floop-block --param l1-cache-size=32 --param l2-cache-size=512");
+                rec->text_id = REC_TEXT_CACHE_BLOCKING;
                 
                 if (!isDuplicate(recs, count, rec->type, pattern)) {
                     count++;
@@ -1166,19 +1045,7 @@ int recommendation_engine_analyze(recommendation_engine_t *engine,
                 rec->implementation_difficulty = 6;
                 rec->priority = 3;
                 
-                snprintf(rec->code_suggestion, sizeof(rec->code_suggestion),
-                        "// Use memory pool to improve locality\n"
-                        "typedef struct {\n"
-                        "    void* blocks[MAX_BLOCKS];\n"
-                        "    size_t block_size;\n"
-                        "    int free_list[MAX_BLOCKS];\n"
-                        "} memory_pool_t;\n\n"
-                        "// Allocate from pool instead of malloc\n"
-                        "data = pool_alloc(&pool, size);");
-                
-                snprintf(rec->rationale, sizeof(rec->rationale),
-                        "Memory pooling keeps related data together, improving cache locality "
-                        "for random access.");
+                rec->text_id = REC_TEXT_MEMORY_POOLING;
                 
                 if (!isDuplicate(recs, count, rec->type, pattern)) {
                     count++;
@@ -1194,35 +1061,15 @@ int recommendation_engine_analyze(recommendation_engine_t *engine,
     // Add non-temporal hints for streaming patterns with high miss rates
     if (pattern->hotspot->miss_rate > 0.7 && count < engine->config.max_recommendations) {
         optimization_rec_t *rec = &recs[count];
-        rec->type = OPT_PREFETCH_HINTS;
+        rec->type = OPT_NONTEMPORAL_STORES;
         rec->pattern = (classified_pattern_t*)pattern;
         rec->expected_improvement = 25.0;
+        rec->is_automatic = true;
         rec->confidence_score = 0.8;
         rec->implementation_difficulty = 4;
         rec->priority = 3;
         
-        snprintf(rec->code_suggestion, sizeof(rec->code_suggestion),
-                "// Non-temporal stores for streaming data\n"
-                "#include <immintrin.h>\n"
-                "for (int i = 0; i < large_n; i += 4) {\n"
-                "    __m256d vdata = _mm256_load_pd(&input[i]);\n"
-                "    // Process vdata\n"
-                "    _mm256_stream_pd(&output[i], vdata);  // Bypass cache\n"
-                "}\n"
-                "_mm_sfence();  // Ensure completion\n\n"
-                "// Or use compiler intrinsics\n"
-                "#pragma GCC ivdep\n"
-                "#pragma vector nontemporal");
-        
-        snprintf(rec->implementation_guide, sizeof(rec->implementation_guide),
-                "1. Use non-temporal stores for data not reused\n"
-                "2. Keep frequently accessed data in cache\n"
-                "3. Process in chunks to maintain useful data\n"
-                "4. Consider cache partitioning if available");
-        
-        snprintf(rec->rationale, sizeof(rec->rationale),
-                "Non-temporal hints prevent streaming data from evicting useful cached data, "
-                "preserving performance.");
+        rec->text_id = REC_TEXT_NONTEMPORAL;
         
         if (!isDuplicate(recs, count, rec->type, pattern)) {
             count++;
@@ -1243,18 +1090,36 @@ int recommendation_engine_analyze(recommendation_engine_t *engine,
     // Rank recommendations
     rank_recommendations(recs, filtered_count);
     
-    *recommendations = recs;
-    *rec_count = filtered_count;
-    
     engine->total_recommendations_generated += filtered_count;
     
-    pthread_mutex_unlock(&engine->mutex);
-    
     LOG_INFO("Generated %d recommendations for pattern at %s:%d", 
-             filtered_count,
-             pattern->hotspot ? pattern->hotspot->location.file : "unknown",
-             pattern->hotspot ? pattern->hotspot->location.line : 0);
+             filtered_count, pattern->hotspot->location.file, pattern->hotspot->location.line);
+    
+    return filtered_count;
+}
+
+// Analyze single pattern; the caller frees the returned array
+int recommendation_engine_analyze(recommendation_engine_t *engine,
+                                 const classified_pattern_t *pattern,
+                                 optimization_rec_t **recommendations,
+                                 int *rec_count) {
+    if (!engine || !pattern || !recommendations || !rec_count) {
+        LOG_ERROR("Invalid parameters for recommendation_engine_analyze");
+        return -1;
+    }
+    
+    // Allocate space for recommendations
+    optimization_rec_t *recs = CALLOC_LOGGED(engine->config.max_recommendations, 
+                                            sizeof(optimization_rec_t));
+    if (!recs) {
+        return -1;
+    }
     
+    pthread_mutex_lock(&engine->mutex);
+    *rec_count = analyze_pattern(engine, pattern, recs);
+    pthread_mutex_unlock(&engine->mutex);
+    
+    *recommendations = recs;
     return 0;
 }
 
@@ -1281,41 +1146,13 @@ int generate_loop_tiling_recommendation(const classified_pattern_t *pattern,
     rec->confidence_score = 0.85;
     rec->implementation_difficulty = 6;
     
-    snprintf(rec->code_suggestion, sizeof(rec->code_suggestion),
-             "// Original nested loops with poor cache behavior\n"
-             "// for (int i = 0; i < N; i++)\n"
-             "//   for (int j = 0; j < M; j++)\n"
-             "//     C[i][j] = A[i][j] + B[i][j];\n\n"
-             "// Tiled version for better cache reuse\n"
-             "#define TILE_SIZE %d  // Fits in L1 cache\n\n"
-             "for (int ii = 0; ii < N; ii += TILE_SIZE) {\n"
-             "    for (int jj = 0; jj < M; jj += TILE_SIZE) {\n"
-             "        // Process one tile\n"
-             "        for (int i = ii; i < min(ii + TILE_SIZE, N); i++) {\n"
-             "            for (int j = jj; j < min(jj + TILE_SIZE, M); j++) {\n"
-             "                C[i][j] = A[i][j] + B[i][j];\n"
-             "            }\n"
-             "        }\n"
-             "    }\n"
-             "}", l1_tile);
-    
-    snprintf(rec->implementation_guide, sizeof(rec->implementation_guide),
-             "1. Identify loop bounds and array dimensions\n"
-             "2. Choose tile size to fit in L1 cache (%d elements)\n"
-             "3. Add outer loops with tile-sized steps\n"
-             "4. Ensure inner loops handle boundary conditions\n"
-             "5. Test with different tile sizes for optimal performance",
-             l1_tile);
-    
-    snprintf(rec->rationale, sizeof(rec->rationale),
-             "Loop tiling improves temporal locality by processing data in "
-             "cache-sized blocks. Working set of %zu KB exceeds L%d cache (%zu KB). "
-             "Tiling reduces cache misses by ~%.0f%%.",
-             (pattern->hotspot->address_range_end - 
-              pattern->hotspot->address_range_start) / 1024,
-             pattern->affected_cache_levels & 1 ? 1 : 2,
-             cache_info->levels[0].size / 1024,
-             rec->expected_improvement);
+    rec->text_id = REC_TEXT_LOOP_TILING;
+    rec->text_args[0] = l1_tile;
+    rec->text_args[1] = (pattern->hotspot->address_range_end -
+                         pattern->hotspot->address_range_start) / 1024;
+    rec->text_args[2] = pattern->affected_cache_levels & 1 ? 1 : 2;
+    rec->text_args[3] = cache_info->levels[0].size / 1024;
+    rec->text_args[4] = rec->expected_improvement;
     
     rec->priority = 1;  // High priority
     rec->is_automatic = false;
@@ -1324,64 +1161,112 @@ int generate_loop_tiling_recommendation(const classified_pattern_t *pattern,
     return 0;
 }
 
+// Choose distance and target level: distance covers the latency of the level
+// the misses are served from, the hint follows the miss-level mix
+int compute_prefetch_plan(const cache_hotspot_t *hotspot, const cache_info_t *cache_info,
+                         prefetch_plan_t *plan) {
+    if (!hotspot || !cache_info || !plan || cache_info->num_levels == 0) return -1;
+    
+    memset(plan, 0, sizeof(prefetch_plan_t));
+    
+    int llc = cache_info->num_levels - 1;
+    size_t line_size = cache_info->levels[0].line_size ? cache_info->levels[0].line_size : 64;
+    double memory_cycles = cache_info->memory_latency_ns > 0 && cache_info->cpu_frequency_ghz > 0 ?
+                           cache_info->memory_latency_ns * cache_info->cpu_frequency_ghz : 200.0;
+    
+    plan->stride_bytes = estimate_hotspot_stride_bytes(hotspot);
+    plan->cycles_per_iteration = hotspot->cycles_per_iteration > 0 ? hotspot->cycles_per_iteration : 1.0;
+    
+    // Deepest level that accounts for a quarter of the misses decides where
+    // the data comes from
+    uint64_t total_misses = 0;
+    for (int i = 0; i < 4; i++) total_misses += hotspot->cache_levels_affected[i];
+    
+    int deepest = llc;
+    if (total_misses > 0) {
+        deepest = 0;
+        for (int i = 0; i < 4 && i <= llc; i++) {
+            if ((uint64_t)hotspot->cache_levels_affected[i] * 4 >= total_misses) deepest = i;
+        }
+    }
+    bool from_memory = deepest >= llc;
+    plan->latency_cycles = from_memory ? memory_cycles : cache_info->levels[deepest + 1].latency_cycles;
+    
+    // Cover the latency, and at least reach the next cache line
+    int distance = (int)ceil(plan->latency_cycles / plan->cycles_per_iteration);
+    int min_distance = plan->stride_bytes < (int)line_size ? (int)line_size / plan->stride_bytes : 1;
+    if (distance < min_distance) distance = min_distance;
+    
+    // Lines in flight must not crowd out the L1 working set
+    size_t bytes_per_iteration = (size_t)plan->stride_bytes > line_size / 8 ? (size_t)plan->stride_bytes : line_size / 8;
+    size_t max_in_flight = cache_info->levels[0].size / 4;
+    if (max_in_flight > 0 && distance * bytes_per_iteration > max_in_flight) {
+        distance = max_in_flight / bytes_per_iteration;
+    }
+    if (distance > 512) distance = 512;
+    if (distance < 1) distance = 1;
+    plan->distance = distance;
+    
+    size_t working_set = hotspot->address_range_end > hotspot->address_range_start ?
+                         hotspot->address_range_end - hotspot->address_range_start : 0;
+    bool streaming = hotspot->dominant_pattern == SEQUENTIAL || hotspot->dominant_pattern == STRIDED;
+    size_t in_flight = (size_t)distance * (plan->stride_bytes > (int)line_size ? line_size : (size_t)plan->stride_bytes);
+    
+    if (from_memory && streaming && working_set > cache_info->levels[llc].size) {
+        plan->locality = 0;           // No reuse: keep it out of the outer levels
+        plan->hint = "_MM_HINT_NTA";
+    } else if (in_flight > cache_info->levels[0].size / 2) {
+        plan->locality = 2;           // Too far ahead for L1, stage in L2
+        plan->hint = "_MM_HINT_T1";
+    } else {
+        plan->locality = 3;
+        plan->hint = "_MM_HINT_T0";
+    }
+    
+    LOG_DEBUG("Prefetch plan for %s:%d: stride %d B, %.1f cycles/iter, latency %.0f cycles -> "
+              "distance %d, %s", hotspot->location.file, hotspot->location.line,
+              plan->stride_bytes, plan->cycles_per_iteration, plan->latency_cycles,
+              plan->distance, plan->hint);
+    return 0;
+}
+
 // Generate prefetch recommendation
 int generate_prefetch_recommendation(const classified_pattern_t *pattern,
+                                    const prefetch_plan_t *plan,
                                     optimization_rec_t *rec) {
-    if (!pattern || !rec) return -1;
+    if (!pattern || !pattern->hotspot || !plan || !rec) return -1;
     
     rec->type = OPT_PREFETCH_HINTS;
     rec->pattern = (classified_pattern_t*)pattern;
-    
-    int prefetch_distance = 8;  // Default prefetch distance
-    
-    // Adjust based on pattern
-    if (pattern->hotspot->dominant_pattern == STRIDED) {
-        prefetch_distance = 16;  // Larger distance for strided
-    } else if (pattern->hotspot->dominant_pattern == SEQUENTIAL) {
-        prefetch_distance = 4;   // Smaller for sequential
+    rec->prefetch_distance = plan->distance;
+    rec->prefetch_locality = plan->locality;
+    if (plan->validated && plan->stall_before > 0) {
+        rec->predicted_miss_reduction = (plan->stall_before - plan->stall_after) / plan->stall_before;
     }
     
-    rec->expected_improvement = 15 + (pattern->hotspot->miss_rate * 20);
-    rec->confidence_score = 0.75;
+    // Improvement from the simulated stall reduction when available
+    if (plan->validated && plan->stall_before > 0) {
+        rec->expected_improvement = 100.0 * (plan->stall_before - plan->stall_after) /
+                                    (plan->stall_before + plan->cycles_per_iteration);
+        rec->confidence_score = 0.85;
+    } else {
+        rec->expected_improvement = 15 + (pattern->hotspot->miss_rate * 20);
+        rec->confidence_score = 0.6;
+    }
     rec->implementation_difficulty = 3;
     
-    snprintf(rec->code_suggestion, sizeof(rec->code_suggestion),
-             "// Add software prefetch hints\n"
-             "#include <xmmintrin.h>  // For _mm_prefetch\n\n"
-             "for (int i = 0; i < n; i++) {\n"
-             "    // Prefetch future data\n"
-             "    if (i + %d < n) {\n"
-             "        _mm_prefetch(&data[i + %d], _MM_HINT_T0);  // Prefetch to L1\n"
-             "    }\n"
-             "    \n"
-             "    // Process current element\n"
-             "    result[i] = process(data[i]);\n"
-             "}\n\n"
-             "// Alternative: Use compiler builtin\n"
-             "for (int i = 0; i < n; i++) {\n"
-             "    __builtin_prefetch(&data[i + %d], 0, 3);\n"
-             "    result[i] = process(data[i]);\n"
-             "}",
-             prefetch_distance, prefetch_distance, prefetch_distance);
-    
-    snprintf(rec->implementation_guide, sizeof(rec->implementation_guide),
-             "1. Identify the access pattern and stride\n"
-             "2. Calculate prefetch distance (typically 4-16 iterations ahead)\n"
-             "3. Insert prefetch intrinsics or builtins\n"
-             "4. Use _MM_HINT_T0 for L1, _MM_HINT_T1 for L2\n"
-             "5. Profile to find optimal prefetch distance");
-    
-    snprintf(rec->rationale, sizeof(rec->rationale),
-             "Software prefetching can hide memory latency by bringing data "
-             "into cache before it's needed. With %.1f%% miss rate and "
-             "%s access pattern, prefetching can reduce stalls.",
-             pattern->hotspot->miss_rate * 100,
-             access_pattern_to_string(pattern->hotspot->dominant_pattern));
+    rec->text_id = REC_TEXT_PREFETCH;
+    rec->text_args[0] = plan->distance;
+    rec->text_args[1] = plan->stride_bytes;
+    rec->text_args[2] = plan->locality;
+    rec->text_args[3] = plan->latency_cycles;
+    rec->text_args[4] = plan->cycles_per_iteration;
+    rec->text_args[5] = plan->validated;
     
     rec->priority = 2;  // Medium priority
-    rec->is_automatic = false;
+    rec->is_automatic = true;  // Prefetches can be inserted with --auto-apply
     
-    LOG_DEBUG("Generated prefetch recommendation with distance %d", prefetch_distance);
+    LOG_DEBUG("Generated prefetch recommendation with distance %d", plan->distance);
     return 0;
 }
 
@@ -1397,40 +1282,8 @@ int generate_data_layout_recommendation(const classified_pattern_t *pattern,
     rec->confidence_score = 0.80;
     rec->implementation_difficulty = 7;
     
-    snprintf(rec->code_suggestion, sizeof(rec->code_suggestion),
-             "// Original Array of Structures (AoS)\n"
-             "struct Particle {\n"
-             "    double x, y, z;\n"
-             "    double vx, vy, vz;\n"
-             "    double mass;\n"
-             "};\n"
-             "Particle particles[N];\n\n"
-             "// Transformed to Structure of Arrays (SoA)\n"
-             "struct ParticleArray {\n"
-             "    double *x, *y, *z;\n"
-             "    double *vx, *vy, *vz;\n"
-             "    double *mass;\n"
-             "    size_t count;\n"
-             "};\n\n"
-             "// Access pattern changes from:\n"
-             "// for (i = 0; i < N; i++) \n"
-             "//     particles[i].x += particles[i].vx * dt;\n"
-             "// To:\n"
-             "for (i = 0; i < N; i++)\n"
-             "    particle_array.x[i] += particle_array.vx[i] * dt;");
-    
-    snprintf(rec->implementation_guide, sizeof(rec->implementation_guide),
-             "1. Identify fields that are accessed together\n"
-             "2. Group hot fields in separate arrays\n"
-             "3. Allocate arrays with proper alignment\n"
-             "4. Update all access patterns in code\n"
-             "5. Consider SIMD opportunities with SoA layout");
-    
-    snprintf(rec->rationale, sizeof(rec->rationale),
-             "Structure of Arrays (SoA) improves cache efficiency for "
-             "scattered field access. Current layout wastes %.0f%% of "
-             "cache line transfers. SoA enables vectorization.",
-             (1.0 - pattern->hotspot->miss_rate) * 100);
+    rec->text_id = REC_TEXT_DATA_LAYOUT;
+    rec->text_args[0] = (1.0 - pattern->hotspot->miss_rate) * 100;
     
     rec->priority = 1;  // High priority for gather/scatter patterns
     rec->is_automatic = false;
@@ -1451,36 +1304,7 @@ int generate_alignment_recommendation(const classified_pattern_t *pattern,
     rec->confidence_score = 0.90;
     rec->implementation_difficulty = 4;
     
-    snprintf(rec->code_suggestion, sizeof(rec->code_suggestion),
-             "// Align data structures to cache line boundaries\n"
-             "#define CACHE_LINE_SIZE 64\n\n"
-             "// Method 1: Aligned allocation\n"
-             "void* aligned_data;\n"
-             "if (posix_memalign(&aligned_data, CACHE_LINE_SIZE, \n"
-             "                   sizeof(DataType) * count) != 0) {\n"
-             "    // Handle allocation failure\n"
-             "}\n\n"
-             "// Method 2: Compiler attributes\n"
-             "struct alignas(CACHE_LINE_SIZE) AlignedData {\n"
-             "    double values[8];  // One cache line\n"
-             "};\n\n"
-             "// Method 3: Padding to prevent false sharing\n"
-             "struct PaddedData {\n"
-             "    double value;\n"
-             "    char padding[CACHE_LINE_SIZE - sizeof(double)];\n"
-             "} __attribute__((packed));");
-    
-    snprintf(rec->implementation_guide, sizeof(rec->implementation_guide),
-             "1. Identify shared data structures\n"
-             "2. Add padding or alignment attributes\n"
-             "3. Use posix_memalign for dynamic allocation\n"
-             "4. Ensure each thread's data is in separate cache lines\n"
-             "5. Verify alignment with address checks");
-    
-    snprintf(rec->rationale, sizeof(rec->rationale),
-             "False sharing occurs when multiple threads access different data "
-             "in the same cache line. Alignment and padding ensure each thread's "
-             "data occupies separate cache lines, eliminating coherence traffic.");
+    rec->text_id = REC_TEXT_ALIGNMENT;
     
     rec->priority = 1;  // High priority for false sharing
     rec->is_automatic = true;  // Can be automated with padding
@@ -1489,106 +1313,180 @@ int generate_alignment_recommendation(const classified_pattern_t *pattern,
     return 0;
 }
 
-// Comparison function for sorting recommendations
-static int compare_recommendations(const void *a, const void *b) {
-    const optimization_rec_t *r1 = (const optimization_rec_t *)a;
-    const optimization_rec_t *r2 = (const optimization_rec_t *)b;
+void rank_recommendations(optimization_rec_t *recommendations, int count) {
+    if (!recommendations || count <= 1) return;
+    
+    // Priority, then expected improvement, confidence and difficulty
+    qsort(recommendations, count, sizeof(optimization_rec_t), compare_recommendation_quality);
+}
+
+// Modelled share of miss cycles an optimization removes, used when the
+// recommendation carries no simulated or measured figure
+static double modelled_miss_reduction(const optimization_rec_t *rec) {
+    switch (rec->type) {
+        case OPT_ACCESS_REORDER:      return 0.70;
+        case OPT_LOOP_TILING:         return 0.60;
+        case OPT_CACHE_BLOCKING:      return 0.50;
+        case OPT_PREFETCH_HINTS:      return 0.50;
+        case OPT_DATA_LAYOUT_CHANGE:  return 0.40;
+        case OPT_MEMORY_ALIGNMENT:    return rec->pattern && rec->pattern->hotspot &&
+                                             rec->pattern->hotspot->is_false_sharing ? 0.80 : 0.10;
+        case OPT_NONTEMPORAL_STORES:  return 0.30;
+        case OPT_MEMORY_POOLING:      return 0.20;
+        case OPT_LOOP_VECTORIZE:      return 0.10;  // Mostly compute, few misses removed
+        default:                      return 0.10;
+    }
+}
+
+// Cycles one miss at `level` (0 = L1) costs: the latency of the level that
+// serves it. Streams overlap their DRAM misses, so they pay the larger of
+// latency over memory-level parallelism and the line's bandwidth cost.
+static double miss_penalty_cycles(const cache_info_t *cache_info, int level, bool streaming) {
+    if (level + 1 < cache_info->num_levels) {
+        return cache_info->levels[level + 1].latency_cycles;
+    }
     
-    // First sort by priority (descending)
-    if (r1->priority > r2->priority) return -1;
-    if (r1->priority < r2->priority) return 1;
+    double ghz = cache_info->cpu_frequency_ghz > 0 ? cache_info->cpu_frequency_ghz : 3.0;
+    double memory_cycles = cache_info->memory_latency_ns > 0 ?
+                           cache_info->memory_latency_ns * ghz : 200.0;
+    if (!streaming) return memory_cycles;
+    
+    double line = cache_info->levels[0].line_size ? cache_info->levels[0].line_size : 64;
+    double bytes_per_cycle = cache_info->memory_bandwidth_gbps > 0 ?
+                             cache_info->memory_bandwidth_gbps / ghz : 8.0;
+    double bandwidth_cycles = line / bytes_per_cycle;
+    double overlapped = memory_cycles / 10.0;   // ~10 line fill buffers
+    return overlapped > bandwidth_cycles ? overlapped : bandwidth_cycles;
+}
+
+int estimate_recommendation_cost(const optimization_rec_t *rec, const cache_info_t *cache_info,
+                                 const cost_profile_t *profile, cost_estimate_t *estimate) {
+    if (!rec || !cache_info || !estimate) return -1;
+    
+    memset(estimate, 0, sizeof(cost_estimate_t));
+    const cache_hotspot_t *hotspot = rec_hotspot(rec);
+    if (!hotspot || cache_info->num_levels == 0) return -1;
+    
+    double period = profile && profile->sample_period > 1 ? profile->sample_period : 1;
+    bool streaming = hotspot->dominant_pattern == SEQUENTIAL || hotspot->dominant_pattern == STRIDED;
+    
+    // Sampled misses per level, scaled to events
+    uint64_t sampled = 0;
+    for (int level = 0; level < 4 && level < cache_info->num_levels; level++) {
+        if (hotspot->cache_levels_affected[level] == 0) continue;
+        sampled += hotspot->cache_levels_affected[level];
+        estimate->miss_cycles += hotspot->cache_levels_affected[level] * period *
+                                 miss_penalty_cycles(cache_info, level, streaming);
+    }
     
-    // Then by expected improvement (descending)
-    if (r1->expected_improvement > r2->expected_improvement) return -1;
-    if (r1->expected_improvement < r2->expected_improvement) return 1;
+    // No per-level counts (static analysis): one pass over the footprint at
+    // the hotspot's miss rate and latency
+    if (sampled == 0) {
+        double line = cache_info->levels[0].line_size ? cache_info->levels[0].line_size : 64;
+        double footprint = hotspot->address_range_end > hotspot->address_range_start ?
+                           (double)(hotspot->address_range_end - hotspot->address_range_start) : 0;
+        double misses = hotspot->total_misses > 0 ? hotspot->total_misses * period :
+                        footprint / line * hotspot->miss_rate;
+        double latency = hotspot->avg_latency_cycles > 0 ? hotspot->avg_latency_cycles :
+                         miss_penalty_cycles(cache_info, cache_info->num_levels - 1, streaming);
+        estimate->miss_cycles = misses * latency;
+    }
+    
+    estimate->simulated = rec->predicted_miss_reduction > 0;
+    estimate->miss_reduction = estimate->simulated ? rec->predicted_miss_reduction :
+                                                     modelled_miss_reduction(rec);
+    if (estimate->miss_reduction > 1.0) estimate->miss_reduction = 1.0;
+    estimate->cycles_saved = estimate->miss_cycles * estimate->miss_reduction;
     
+    double hz = (cache_info->cpu_frequency_ghz > 0 ? cache_info->cpu_frequency_ghz : 3.0) * 1e9;
+    
+    // A hotspot cannot give back more time than its share of the run
+    if (profile && profile->total_samples > 0) {
+        estimate->hotspot_share = (double)hotspot->sample_count / profile->total_samples;
+        if (profile->run_seconds > 0) {
+            double share_cycles = estimate->hotspot_share * profile->run_seconds * hz;
+            if (estimate->cycles_saved > share_cycles) estimate->cycles_saved = share_cycles;
+        }
+    }
+    
+    estimate->seconds_saved = estimate->cycles_saved / hz;
     return 0;
 }
 
-void rank_recommendations(optimization_rec_t *recommendations, int count) {
-    if (!recommendations || count <= 1) return;
+void recommendation_engine_set_profile(recommendation_engine_t *engine,
+                                       const cost_profile_t *profile) {
+    if (!engine || !profile) return;
+    engine->profile = *profile;
+}
+
+static int compare_cycles_saved(const void *a, const void *b) {
+    const optimization_rec_t *rec_a = (const optimization_rec_t *)a;
+    const optimization_rec_t *rec_b = (const optimization_rec_t *)b;
     
-    // Sort by:
-    // 1. Priority (lower is better)
-    // 2. Expected improvement (higher is better)
-    // 3. Confidence score (higher is better)
-    // 4. Implementation difficulty (lower is better)
+    if (rec_a->cycles_saved > rec_b->cycles_saved) return -1;
+    if (rec_a->cycles_saved < rec_b->cycles_saved) return 1;
+    return compare_recommendation_quality(a, b);
+}
+
+// Most wall-clock time given back first
+void rank_recommendations_by_cost(optimization_rec_t *recommendations, int count,
+                                  const cache_info_t *cache_info, const cost_profile_t *profile) {
+    if (!recommendations || !cache_info) return;
     
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = i + 1; j < count; j++) {
-            bool swap = false;
-            
-            // First by priority
-            if (recommendations[i].priority > recommendations[j].priority) {
-                swap = true;
-            } else if (recommendations[i].priority == recommendations[j].priority) {
-                // Then by expected improvement
-                if (recommendations[i].expected_improvement < recommendations[j].expected_improvement) {
-                    swap = true;
-                } else if (recommendations[i].expected_improvement == recommendations[j].expected_improvement) {
-                    // Then by confidence
-                    if (recommendations[i].confidence_score < recommendations[j].confidence_score) {
-                        swap = true;
-                    } else if (recommendations[i].confidence_score == recommendations[j].confidence_score) {
-                        // Finally by difficulty
-                        if (recommendations[i].implementation_difficulty > recommendations[j].implementation_difficulty) {
-                            swap = true;
-                        }
-                    }
-                }
-            }
-            
-            if (swap) {
-                optimization_rec_t temp = recommendations[i];
-                recommendations[i] = recommendations[j];
-                recommendations[j] = temp;
-            }
-        }
+    for (int i = 0; i < count; i++) {
+        cost_estimate_t estimate;
+        recommendations[i].cycles_saved =
+            estimate_recommendation_cost(&recommendations[i], cache_info, profile, &estimate) == 0 ?
+            estimate.cycles_saved : 0;
+    }
+    
+    if (count > 1) {
+        qsort(recommendations, count, sizeof(optimization_rec_t), compare_cycles_saved);
     }
 }
 
-//
+// Vectorization and a data layout change at the same location conflict;
+// keep the one with the higher expected improvement
 int filter_conflicting_recommendations(optimization_rec_t *recommendations, int count) {
     if (!recommendations || count <= 1) return count;
     
-    // Mark conflicting recommendations for removal
-    bool *to_remove = calloc(count, sizeof(bool));
+    bool *to_remove = CALLOC_LOGGED(count, sizeof(bool));
+    rec_index_t index;
+    if (!to_remove || rec_index_init(&index, count) != 0) {
+        if (to_remove) FREE_LOGGED(to_remove);
+        return count;
+    }
     
-    for (int i = 0; i < count - 1; i++) {
-        if (to_remove[i]) continue;
+    // Best vectorization recommendation per location
+    for (int i = 0; i < count; i++) {
+        const cache_hotspot_t *hotspot = rec_hotspot(&recommendations[i]);
+        if (recommendations[i].type != OPT_LOOP_VECTORIZE || !hotspot) continue;
         
-        for (int j = i + 1; j < count; j++) {
-            if (to_remove[j]) continue;
-            
-            // Check if they target the same location
-            if (recommendations[i].pattern && recommendations[j].pattern &&
-                recommendations[i].pattern->hotspot && recommendations[j].pattern->hotspot) {
-                
-                cache_hotspot_t *h1 = recommendations[i].pattern->hotspot;
-                cache_hotspot_t *h2 = recommendations[j].pattern->hotspot;
-                
-                if (h1->location.line == h2->location.line &&
-                    strcmp(h1->location.file, h2->location.file) == 0) {
-                    
-                    // Same location - check for conflicts
-                    if ((recommendations[i].type == OPT_LOOP_VECTORIZE && 
-                         recommendations[j].type == OPT_DATA_LAYOUT_CHANGE) ||
-                        (recommendations[j].type == OPT_LOOP_VECTORIZE && 
-                         recommendations[i].type == OPT_DATA_LAYOUT_CHANGE)) {
-                        
-                        // Keep the one with higher expected improvement
-                        if (recommendations[i].expected_improvement < 
-                            recommendations[j].expected_improvement) {
-                            to_remove[i] = true;
-                        } else {
-                            to_remove[j] = true;
-                        }
-                    }
-                }
-            }
+        int *slot = rec_index_find(&index, rec_index_key(&index, hotspot->location.file,
+                                                         hotspot->location.line, OPT_LOOP_VECTORIZE));
+        if (*slot < 0 || recommendations[i].expected_improvement >
+                         recommendations[*slot].expected_improvement) {
+            *slot = i;
         }
     }
     
+    for (int i = 0; i < count; i++) {
+        const cache_hotspot_t *hotspot = rec_hotspot(&recommendations[i]);
+        if (recommendations[i].type != OPT_DATA_LAYOUT_CHANGE || !hotspot) continue;
+        
+        int *slot = rec_index_find(&index, rec_index_key(&index, hotspot->location.file,
+                                                         hotspot->location.line, OPT_LOOP_VECTORIZE));
+        if (*slot < 0 || to_remove[*slot]) continue;
+        
+        if (recommendations[i].expected_improvement > recommendations[*slot].expected_improvement) {
+            to_remove[*slot] = true;
+        } else {
+            to_remove[i] = true;
+        }
+    }
+    
+    rec_index_destroy(&index);
+    
     // Compact the array
     int new_count = 0;
     for (int i = 0; i < count; i++) {
@@ -1600,7 +1498,7 @@ int filter_conflicting_recommendations(optimization_rec_t *recommendations, int
         }
     }
     
-    free(to_remove);
+    FREE_LOGGED(to_remove);
     return new_count;
 }
 
@@ -1609,6 +1507,7 @@ void recommendation_engine_print_recommendations(const optimization_rec_t *recs,
     printf("\n=== Optimization Recommendations ===\n");
     printf("Found %d optimization opportunities:\n\n", count);
     
+    char text[2048];
     for (int i = 0; i < count; i++) {
         const optimization_rec_t *rec = &recs[i];
         
@@ -1618,6 +1517,13 @@ void recommendation_engine_print_recommendations(const optimization_rec_t *recs,
         printf("    Expected improvement: %.1f%%\n", rec->expected_improvement);
         printf("    Confidence: %.0f%%\n", rec->confidence_score * 100);
         printf("    Difficulty: %d/10\n", rec->implementation_difficulty);
+        if (rec->cycles_saved > 0) {
+            printf("    Estimated savings: %.0f cycles\n", rec->cycles_saved);
+        }
+        if (rec->measured_speedup > 0) {
+            printf("    Measured speedup: %.2fx (CI %.2f-%.2f, microkernel)\n",
+                   rec->measured_speedup, rec->speedup_ci_low, rec->speedup_ci_high);
+        }
         
         if (rec->pattern && rec->pattern->hotspot) {
             printf("    Location: %s:%d\n",
@@ -1625,24 +1531,107 @@ void recommendation_engine_print_recommendations(const optimization_rec_t *recs,
                    rec->pattern->hotspot->location.line);
         }
         
-        printf("\n    Rationale: %s\n", rec->rationale);
+        recommendation_render(rec, REC_FIELD_RATIONALE, text, sizeof(text));
+        printf("\n    Rationale: %s\n", text);
         
-        if (strlen(rec->compiler_flags) > 0) {
-            printf("\n    Compiler flags: %s\n", rec->compiler_flags);
+        if (recommendation_render(rec, REC_FIELD_FLAGS, text, sizeof(text)) > 0) {
+            printf("\n    Compiler flags: %s\n", text);
         }
         
-        if (strlen(rec->implementation_guide) > 0) {
-            printf("\n    Implementation guide:\n%s\n", rec->implementation_guide);
+        if (recommendation_render(rec, REC_FIELD_GUIDE, text, sizeof(text)) > 0) {
+            printf("\n    Implementation guide:\n%s\n", text);
         }
         
-        if (strlen(rec->code_suggestion) > 0) {
-            printf("\n    Code example:\n%s\n", rec->code_suggestion);
+        if (recommendation_render(rec, REC_FIELD_CODE, text, sizeof(text)) > 0) {
+            printf("\n    Code example:\n%s\n", text);
         }
         
         printf("\n" "─" "─" "─" "─" "─" "─" "─" "─" "─" "─" "\n\n");
     }
 }
 
+// Path of file relative to root, or NULL when it lies outside it
+static const char* path_under_root(const char *file, const char *root, char *buf) {
+    if (!realpath(file, buf)) {
+        if (file[0] == '/') return NULL;
+        return file;  // Not on disk here; already relative
+    }
+    
+    size_t len = strlen(root);
+    if (strncmp(buf, root, len) != 0) return NULL;
+    if (len == 1) return buf + 1;  // Root is "/"
+    if (buf[len] != '/') return NULL;
+    return buf + len + 1;
+}
+
+int recommendation_engine_export_makefile(const optimization_rec_t *recs, int count,
+                                        const char *source_root, const char *filename) {
+    if (!recs || !filename) {
+        LOG_ERROR("NULL parameters in export_makefile");
+        return -1;
+    }
+    
+    char root[PATH_MAX];
+    if (!realpath(source_root && source_root[0] ? source_root : ".", root)) {
+        LOG_ERROR("Invalid source root %s: %s", source_root, strerror(errno));
+        return -1;
+    }
+    
+    FILE *fp = fopen(filename, "w");
+    if (!fp) {
+        LOG_ERROR("Failed to open %s for writing", filename);
+        return -1;
+    }
+    
+    // Every file gets one entry; the pool tells us when a file is new
+    arena_t *arena = arena_create(0);
+    string_pool_t *files = arena ? string_pool_create(arena) : NULL;
+    if (!files) {
+        arena_destroy(arena);
+        fclose(fp);
+        return -1;
+    }
+    
+    fprintf(fp, "# Per-object compiler flags from cacheSight\n");
+    fprintf(fp, "# Measured flag sets are applied; modelled suggestions are left commented\n");
+    fprintf(fp, "# Targets are relative to %s; include this from the Makefile there\n\n", root);
+    
+    int measured = 0;
+    char flags[512];
+    char resolved[PATH_MAX];
+    for (int i = 0; i < count; i++) {
+        const optimization_rec_t *rec = &recs[i];
+        if (!rec->pattern || !rec->pattern->hotspot) continue;
+        
+        const char *file = rec->pattern->hotspot->location.file;
+        if (!file[0] || recommendation_render(rec, REC_FIELD_FLAGS, flags, sizeof(flags)) <= 0) continue;
+        int known = string_pool_count(files);
+        if (!string_pool_intern(files, file) || string_pool_count(files) == known) continue;
+        
+        const char *target = path_under_root(file, root, resolved);
+        if (!target) {
+            fprintf(fp, "# %s is outside the source root: CFLAGS += %s\n", file, flags);
+            continue;
+        }
+        
+        const char *dot = strrchr(target, '.');
+        int stem = dot ? (int)(dot - target) : (int)strlen(target);
+        if (rec->tuned_flags) {
+            fprintf(fp, "%.*s.o: CFLAGS += %s\n", stem, target, flags);
+            measured++;
+        } else {
+            fprintf(fp, "# %.*s.o: CFLAGS += %s\n", stem, target, flags);
+        }
+    }
+    
+    string_pool_destroy(files);
+    arena_destroy(arena);
+    fclose(fp);
+    
+    LOG_INFO("Exported compiler flags to %s (%d measured)", filename, measured);
+    return 0;
+}
+
 // Get default configuration
 engine_config_t engine_config_default(void) {
     engine_config_t config = {
@@ -1650,7 +1639,9 @@ engine_config_t engine_config_default(void) {
         .consider_compiler_flags = true,
         .prefer_automatic = false,
         .max_recommendations = 5,
-        .min_expected_improvement = 10.0
+        .min_expected_improvement = 10.0,
+        .arena = NULL,
+        .scratch = NULL
     };
     
     return config;
@@ -5,22 +5,86 @@
 #include "pattern_classifier.h"
 #include "hardware_detector.h"
 #include "loop_analyzer.h"
+#include "arena.h"
+
+// Text templates for recommendations; the text is rendered from the
+// template and its arguments only when a report needs it
+typedef enum {
+    REC_TEXT_NONE,
+    REC_TEXT_VECTORIZE,
+    REC_TEXT_ACCESS_REORDER,
+    REC_TEXT_CACHE_BLOCKING,
+    REC_TEXT_MEMORY_POOLING,
+    REC_TEXT_NONTEMPORAL,
+    REC_TEXT_LOOP_TILING,       // args: tile, working set KB, cache level, L1 KB, improvement
+    REC_TEXT_PREFETCH,          // args: distance, stride bytes, locality, latency, cycles/iter, validated
+    REC_TEXT_DATA_LAYOUT,       // args: wasted line transfer %
+    REC_TEXT_ALIGNMENT,
+    REC_TEXT_COUNT
+} rec_text_t;
+
+// Renderable text fields
+typedef enum {
+    REC_FIELD_CODE,             // Suggested code transformation
+    REC_FIELD_GUIDE,            // How to implement
+    REC_FIELD_RATIONALE,        // Why this optimization helps
+    REC_FIELD_FLAGS             // Suggested compiler flags
+} rec_field_t;
+
+#define REC_TEXT_MAX_ARGS 6
 
 // Optimization recommendation
 typedef struct {
     optimization_type_t type;           // Type of optimization
     classified_pattern_t *pattern;      // Associated pattern
-    char code_suggestion[2048];         // Suggested code transformation
-    char implementation_guide[1024];    // How to implement
     double expected_improvement;        // Performance improvement (%)
     double confidence_score;            // Confidence in recommendation (0-1)
     int implementation_difficulty;      // 1-10 scale
-    char rationale[1024];              // Why this optimization helps
     int priority;                      // Priority ranking
     bool is_automatic;                 // Can be automatically applied
-    char compiler_flags[256];          // Suggested compiler flags
+    int prefetch_distance;             // Iterations ahead (OPT_PREFETCH_HINTS)
+    int prefetch_locality;             // __builtin_prefetch locality (OPT_PREFETCH_HINTS)
+    rec_text_t text_id;                // Template for code, guide, rationale and flags
+    double text_args[REC_TEXT_MAX_ARGS];
+    const char *note;                  // Appended to the rationale, NULL if none
+    double predicted_miss_reduction;   // Simulated or measured share of miss cycles removed (0 = model)
+    double cycles_saved;               // Cost model estimate, the ranking key
+    const char *tuned_flags;           // Measured best flags for the file, NULL if not tuned
+    double measured_speedup;           // Microkernel baseline/transformed time (0 = not measured)
+    double speedup_ci_low;             // Confidence interval of measured_speedup
+    double speedup_ci_high;
 } optimization_rec_t;
 
+// Run-level inputs of the cost model
+typedef struct {
+    uint64_t sample_period;             // Events per sample (0 or 1 = counts are exact)
+    uint64_t total_samples;             // Samples over all hotspots
+    double run_seconds;                 // Profiled wall time (0 = unknown)
+} cost_profile_t;
+
+// Cost model estimate for one recommendation
+typedef struct {
+    double miss_cycles;                 // Cycles the hotspot spends on misses today
+    double miss_reduction;              // Fraction of those cycles removed
+    double cycles_saved;
+    double seconds_saved;
+    double hotspot_share;               // Hotspot's fraction of all samples (0 = unknown)
+    bool simulated;                     // Reduction came from simulation or measurement
+} cost_estimate_t;
+
+// Prefetch distance and target level derived from the latency model
+typedef struct {
+    int distance;                       // Iterations ahead
+    int locality;                       // __builtin_prefetch locality: 3 (T0), 2 (T1), 0 (NTA)
+    const char *hint;                   // Matching _MM_HINT_* name
+    int stride_bytes;
+    double latency_cycles;              // Latency being hidden
+    double cycles_per_iteration;        // Loop body cost
+    bool validated;                     // Simulator confirmed fewer stalls
+    double stall_before;                // Simulated stall cycles per iteration
+    double stall_after;
+} prefetch_plan_t;
+
 // Recommendation engine state
 typedef struct recommendation_engine recommendation_engine_t;
 
@@ -31,8 +95,14 @@ typedef struct {
     bool prefer_automatic;              // Prioritize automatic transformations
     int max_recommendations;            // Maximum recommendations per pattern
     double min_expected_improvement;    // Minimum improvement threshold (%)
+    arena_t *arena;                     // Per-run arena for records (NULL = heap, caller frees)
+    arena_t *scratch;                   // Temporaries, rewound per call (NULL = engine-owned)
 } engine_config_t;
 
+// Render one text field into buffer; returns the full length like snprintf
+int recommendation_render(const optimization_rec_t *rec, rec_field_t field,
+                          char *buffer, size_t size);
+
 int recommendation_engine_save_to_file(const optimization_rec_t *recs, int count,
                                       const char *filename);
 
@@ -58,7 +128,11 @@ int generate_loop_tiling_recommendation(const classified_pattern_t *pattern,
                                        const cache_info_t *cache_info,
                                        optimization_rec_t *rec);
 
+int compute_prefetch_plan(const cache_hotspot_t *hotspot, const cache_info_t *cache_info,
+                         prefetch_plan_t *plan);
+
 int generate_prefetch_recommendation(const classified_pattern_t *pattern,
+                                    const prefetch_plan_t *plan,
                                     optimization_rec_t *rec);
 
 int generate_data_layout_recommendation(const classified_pattern_t *pattern,
@@ -77,14 +151,27 @@ int generate_prefetch_code(const cache_hotspot_t *hotspot,
 int generate_soa_transformation_code(const struct_info_t *struct_info,
                                     char *code, size_t code_size);
 
+// Cost model: cycles a recommendation gives back, from the hotspot's
+// per-level misses priced at the measured latency and bandwidth
+int estimate_recommendation_cost(const optimization_rec_t *rec, const cache_info_t *cache_info,
+                                 const cost_profile_t *profile, cost_estimate_t *estimate);
+void recommendation_engine_set_profile(recommendation_engine_t *engine,
+                                       const cost_profile_t *profile);
+
 // Recommendation ranking and filtering
 void rank_recommendations(optimization_rec_t *recommendations, int count);
+void rank_recommendations_by_cost(optimization_rec_t *recommendations, int count,
+                                  const cache_info_t *cache_info, const cost_profile_t *profile);
 int filter_conflicting_recommendations(optimization_rec_t *recommendations, int count);
 
 // Reporting
 void recommendation_engine_print_recommendations(const optimization_rec_t *recs, int count);
+// Per-object CFLAGS for make: measured flags become rules, modelled ones comments.
+// Object targets are relative to source_root (the current directory when NULL or
+// empty), so the file is meant to be included from the Makefile in that directory;
+// sources outside the root are listed as comments only.
 int recommendation_engine_export_makefile(const optimization_rec_t *recs, int count,
-                                        const char *filename);
+                                        const char *source_root, const char *filename);
 
 // Configuration
 engine_config_t engine_config_default(void);
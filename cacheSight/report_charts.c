@@ -0,0 +1,535 @@
+#include "report_generator.h"
+#include <math.h>
+#include <stdarg.h>
+
+// Fixed heatmap grid; the report size does not depend on the sample count
+#define HEATMAP_COLS 160
+#define HEATMAP_ROWS 64
+#define HEATMAP_ADDR_PROBES 4096
+
+// Timelines are bucketed finely, then reduced to a few hundred points
+#define TIMELINE_BUCKETS 2048
+#define TIMELINE_POINTS 240
+
+// Flame graph frames: root, file, function, line
+#define FLAME_MAX_NODES 8192
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+// Time and address extent of the samples behind the heatmap and timelines
+typedef struct {
+    uint64_t t0, t1;
+    uint64_t addr_lo, addr_hi;
+    uint64_t sample_count;
+} chart_bounds_t;
+
+typedef struct {
+    const cache_hotspot_t *hotspot;
+    int depth;
+    uint64_t value;
+} flame_node_t;
+
+static const char b64_alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Base64 of a little-endian array, encoded in chunks straight into the sink
+static void write_base64(report_sink_t *sink, const void *data, size_t len) {
+    const unsigned char *in = data;
+    char out[4096];
+    size_t n = 0;
+    
+    for (size_t i = 0; i < len; i += 3) {
+        unsigned v = (unsigned)in[i] << 16;
+        if (i + 1 < len) v |= (unsigned)in[i + 1] << 8;
+        if (i + 2 < len) v |= in[i + 2];
+        
+        out[n++] = b64_alphabet[(v >> 18) & 63];
+        out[n++] = b64_alphabet[(v >> 12) & 63];
+        out[n++] = i + 1 < len ? b64_alphabet[(v >> 6) & 63] : '=';
+        out[n++] = i + 2 < len ? b64_alphabet[v & 63] : '=';
+        
+        if (n + 4 > sizeof(out)) {
+            report_sink_markup(sink, out, n);
+            n = 0;
+        }
+    }
+    report_sink_markup(sink, out, n);
+}
+
+static void markup_str(report_sink_t *sink, const char *str) {
+    report_sink_markup(sink, str, strlen(str));
+}
+
+static void markup_printf(report_sink_t *sink, const char *format, ...) {
+    char buffer[1024];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (n > 0) {
+        report_sink_markup(sink, buffer, min((size_t)n, sizeof(buffer) - 1));
+    }
+}
+
+// JSON string safe inside a script element
+static void markup_string(report_sink_t *sink, const char *str) {
+    char buffer[512];
+    size_t n = 0;
+    
+    buffer[n++] = '"';
+    for (; *str && n < sizeof(buffer) - 8; str++) {
+        unsigned char c = (unsigned char)*str;
+        if (c == '"' || c == '\\') {
+            buffer[n++] = '\\';
+            buffer[n++] = (char)c;
+        } else if (c < 0x20 || c == '<' || c == '>' || c == '&') {
+            n += snprintf(buffer + n, sizeof(buffer) - n, "\\u%04x", c);
+        } else {
+            buffer[n++] = (char)c;
+        }
+    }
+    buffer[n++] = '"';
+    report_sink_markup(sink, buffer, n);
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Time extent from every sample; the address axis spans the 1st to 99th
+// percentile of an evenly strided probe so stray stack or kernel addresses do
+// not squash the heap into one row
+static bool compute_bounds(const chart_input_t *in, chart_bounds_t *bounds) {
+    memset(bounds, 0, sizeof(*bounds));
+    bounds->t0 = UINT64_MAX;
+    
+    for (int i = 0; i < in->hotspot_count; i++) {
+        const cache_hotspot_t *hs = &in->hotspots[i];
+        for (size_t s = 0; s < hs->sample_count; s++) {
+            uint64_t t = hs->samples[s].timestamp;
+            if (t < bounds->t0) bounds->t0 = t;
+            if (t > bounds->t1) bounds->t1 = t;
+        }
+        bounds->sample_count += hs->sample_count;
+    }
+    if (bounds->sample_count == 0) return false;
+    if (bounds->t1 <= bounds->t0) bounds->t1 = bounds->t0 + 1;
+    
+    uint64_t stride = bounds->sample_count / HEATMAP_ADDR_PROBES + 1;
+    uint64_t *probe = MALLOC_LOGGED(HEATMAP_ADDR_PROBES * sizeof(uint64_t));
+    if (!probe) return false;
+    
+    size_t probes = 0;
+    uint64_t index = 0;
+    for (int i = 0; i < in->hotspot_count; i++) {
+        const cache_hotspot_t *hs = &in->hotspots[i];
+        for (size_t s = 0; s < hs->sample_count; s++, index++) {
+            if (index % stride == 0 && probes < HEATMAP_ADDR_PROBES) {
+                probe[probes++] = hs->samples[s].memory_addr;
+            }
+        }
+    }
+    qsort(probe, probes, sizeof(uint64_t), compare_u64);
+    bounds->addr_lo = probe[probes / 100];
+    bounds->addr_hi = probe[probes - 1 - probes / 100];
+    if (bounds->addr_hi <= bounds->addr_lo) bounds->addr_hi = bounds->addr_lo + 64;
+    
+    FREE_LOGGED(probe);
+    return true;
+}
+
+static int grid_index(uint64_t value, uint64_t lo, uint64_t hi, int bins) {
+    if (value <= lo) return 0;
+    if (value >= hi) return bins - 1;
+    return (int)((double)(value - lo) / (double)(hi - lo) * bins);
+}
+
+// One pass over the samples into a fixed grid, stored as log-scaled bytes
+static void write_heatmap(report_sink_t *sink, const chart_input_t *in,
+                          const chart_bounds_t *bounds) {
+    uint32_t *grid = CALLOC_LOGGED(HEATMAP_COLS * HEATMAP_ROWS, sizeof(uint32_t));
+    uint8_t *cells = MALLOC_LOGGED(HEATMAP_COLS * HEATMAP_ROWS);
+    if (!grid || !cells) {
+        if (grid) FREE_LOGGED(grid);
+        if (cells) FREE_LOGGED(cells);
+        return;
+    }
+    
+    uint32_t peak = 0;
+    for (int i = 0; i < in->hotspot_count; i++) {
+        const cache_hotspot_t *hs = &in->hotspots[i];
+        for (size_t s = 0; s < hs->sample_count; s++) {
+            const cache_miss_sample_t *sample = &hs->samples[s];
+            int col = grid_index(sample->timestamp, bounds->t0, bounds->t1, HEATMAP_COLS);
+            int row = grid_index(sample->memory_addr, bounds->addr_lo, bounds->addr_hi, HEATMAP_ROWS);
+            uint32_t count = ++grid[row * HEATMAP_COLS + col];
+            if (count > peak) peak = count;
+        }
+    }
+    
+    // Zero stays empty; any hit is at least 1
+    double scale = 254.0 / log1p((double)peak);
+    for (int i = 0; i < HEATMAP_COLS * HEATMAP_ROWS; i++) {
+        cells[i] = grid[i] ? (uint8_t)(1 + log1p((double)grid[i]) * scale + 0.5) : 0;
+    }
+    
+    double seconds = (bounds->t1 - bounds->t0) / 1e9;
+    markup_printf(sink, "<h3>Misses by address and time</h3>\n"
+                  "<canvas id=\"cs-heat\" width=\"640\" height=\"256\"></canvas>\n"
+                  "<div id=\"cs-heat-info\"><small>%llu samples, 0x%llx-0x%llx over %.3f s; "
+                  "hover for a cell</small></div>\n",
+                  (unsigned long long)bounds->sample_count,
+                  (unsigned long long)bounds->addr_lo, (unsigned long long)bounds->addr_hi, seconds);
+    markup_printf(sink, "<script>csCharts.heat(\"cs-heat\",{cols:%d,rows:%d,peak:%u,"
+                  "dt:%.9g,a0:%llu,da:%.9g,data:\"", HEATMAP_COLS, HEATMAP_ROWS, peak,
+                  seconds / HEATMAP_COLS, (unsigned long long)bounds->addr_lo,
+                  (double)(bounds->addr_hi - bounds->addr_lo) / HEATMAP_ROWS);
+    write_base64(sink, cells, HEATMAP_COLS * HEATMAP_ROWS);
+    markup_str(sink, "\"});</script>\n");
+    
+    FREE_LOGGED(grid);
+    FREE_LOGGED(cells);
+}
+
+// Largest-Triangle-Three-Buckets: keeps the first and last point and, per
+// bucket, the point spanning the largest triangle with its neighbours
+static int lttb_downsample(const float *x, const float *y, int n, int threshold, float *out) {
+    if (threshold >= n || threshold < 3) {
+        for (int i = 0; i < n; i++) {
+            out[2 * i] = x[i];
+            out[2 * i + 1] = y[i];
+        }
+        return n;
+    }
+    
+    double every = (double)(n - 2) / (threshold - 2);
+    int a = 0, k = 0;
+    out[k++] = x[0];
+    out[k++] = y[0];
+    
+    for (int i = 0; i < threshold - 2; i++) {
+        int avg_start = (int)((i + 1) * every) + 1;
+        int avg_end = min((int)((i + 2) * every) + 1, n);
+        double avg_x = 0, avg_y = 0;
+        for (int j = avg_start; j < avg_end; j++) {
+            avg_x += x[j];
+            avg_y += y[j];
+        }
+        int avg_count = avg_end - avg_start;
+        if (avg_count > 0) {
+            avg_x /= avg_count;
+            avg_y /= avg_count;
+        } else {
+            avg_x = x[n - 1];
+            avg_y = y[n - 1];
+        }
+        
+        int range_start = (int)(i * every) + 1;
+        int range_end = (int)((i + 1) * every) + 1;
+        double best_area = -1;
+        int best = range_start;
+        for (int j = range_start; j < range_end; j++) {
+            double area = fabs((x[a] - avg_x) * (y[j] - y[a]) - (x[a] - x[j]) * (avg_y - y[a]));
+            if (area > best_area) {
+                best_area = area;
+                best = j;
+            }
+        }
+        out[k++] = x[best];
+        out[k++] = y[best];
+        a = best;
+    }
+    
+    out[k++] = x[n - 1];
+    out[k++] = y[n - 1];
+    return k / 2;
+}
+
+// Miss rate over time of the hottest hotspots, LTTB-reduced (x seconds, y misses/s)
+static void write_timelines(report_sink_t *sink, const chart_input_t *in,
+                            const chart_bounds_t *bounds) {
+    int wanted = min(in->max_timelines > 0 ? in->max_timelines : 8, in->hotspot_count);
+    int *order = MALLOC_LOGGED((size_t)in->hotspot_count * sizeof(int));
+    float *x = MALLOC_LOGGED(TIMELINE_BUCKETS * sizeof(float));
+    float *y = MALLOC_LOGGED(TIMELINE_BUCKETS * sizeof(float));
+    float *points = MALLOC_LOGGED(2 * TIMELINE_POINTS * sizeof(float));
+    if (!order || !x || !y || !points) goto cleanup;
+    
+    // Partial selection of the hotspots with the most samples
+    for (int i = 0; i < in->hotspot_count; i++) order[i] = i;
+    for (int i = 0; i < wanted; i++) {
+        int best = i;
+        for (int j = i + 1; j < in->hotspot_count; j++) {
+            if (in->hotspots[order[j]].sample_count > in->hotspots[order[best]].sample_count) best = j;
+        }
+        int tmp = order[i];
+        order[i] = order[best];
+        order[best] = tmp;
+    }
+    
+    double span = (bounds->t1 - bounds->t0) / 1e9;
+    double bucket_seconds = span / TIMELINE_BUCKETS;
+    markup_str(sink, "<h3>Miss rate over time</h3>\n");
+    
+    for (int r = 0; r < wanted; r++) {
+        const cache_hotspot_t *hs = &in->hotspots[order[r]];
+        if (hs->sample_count == 0) break;
+        
+        memset(y, 0, TIMELINE_BUCKETS * sizeof(float));
+        for (size_t s = 0; s < hs->sample_count; s++) {
+            y[grid_index(hs->samples[s].timestamp, bounds->t0, bounds->t1, TIMELINE_BUCKETS)] += 1.0f;
+        }
+        for (int b = 0; b < TIMELINE_BUCKETS; b++) {
+            x[b] = (float)((b + 0.5) * bucket_seconds);
+            y[b] = (float)(y[b] / bucket_seconds);
+        }
+        int n = lttb_downsample(x, y, TIMELINE_BUCKETS, TIMELINE_POINTS, points);
+        
+        // Source names come from the profiled binary; the caption is set as
+        // text by the script, like the flame graph's names
+        char label[sizeof(hs->location.file) + sizeof(hs->location.function) + 48];
+        snprintf(label, sizeof(label), "%s:%d (%s), %zu samples", hs->location.file,
+                 hs->location.line, hs->location.function, hs->sample_count);
+        markup_printf(sink, "<div><small id=\"cs-line-%d-label\"></small><br>"
+                      "<svg id=\"cs-line-%d\" width=\"640\" height=\"64\"></svg></div>\n", r, r);
+        markup_printf(sink, "<script>csCharts.line(\"cs-line-%d\",{label:", r);
+        markup_string(sink, label);
+        markup_printf(sink, ",span:%.9g,data:\"", span);
+        write_base64(sink, points, (size_t)n * 2 * sizeof(float));
+        markup_str(sink, "\"});</script>\n");
+    }
+
+cleanup:
+    if (order) FREE_LOGGED(order);
+    if (x) FREE_LOGGED(x);
+    if (y) FREE_LOGGED(y);
+    if (points) FREE_LOGGED(points);
+}
+
+static int compare_hotspot_context(const void *a, const void *b) {
+    const cache_hotspot_t *ha = *(const cache_hotspot_t * const *)a;
+    const cache_hotspot_t *hb = *(const cache_hotspot_t * const *)b;
+    int cmp = strcmp(ha->location.file, hb->location.file);
+    if (cmp == 0) cmp = strcmp(ha->location.function, hb->location.function);
+    if (cmp == 0) cmp = (ha->location.line > hb->location.line) - (ha->location.line < hb->location.line);
+    return cmp;
+}
+
+// Frames in depth-first order as (depth, misses) pairs plus a name table; the
+// renderer lays out widths from the order alone
+static void write_flame_graph(report_sink_t *sink, const chart_input_t *in) {
+    const cache_hotspot_t **sorted = MALLOC_LOGGED((size_t)in->hotspot_count * sizeof(*sorted));
+    flame_node_t *nodes = MALLOC_LOGGED(FLAME_MAX_NODES * sizeof(flame_node_t));
+    float *encoded = MALLOC_LOGGED(FLAME_MAX_NODES * 2 * sizeof(float));
+    if (!sorted || !nodes || !encoded) goto cleanup;
+    
+    for (int i = 0; i < in->hotspot_count; i++) sorted[i] = &in->hotspots[i];
+    qsort(sorted, in->hotspot_count, sizeof(*sorted), compare_hotspot_context);
+    
+    int n = 0, file_node = -1, function_node = -1;
+    nodes[n++] = (flame_node_t){ .hotspot = NULL, .depth = 0 };
+    for (int i = 0; i < in->hotspot_count && n + 3 <= FLAME_MAX_NODES; i++) {
+        const cache_hotspot_t *hs = sorted[i];
+        const cache_hotspot_t *prev = i > 0 ? sorted[i - 1] : NULL;
+        uint64_t misses = hs->total_misses;
+        
+        bool new_file = !prev || strcmp(prev->location.file, hs->location.file) != 0;
+        if (new_file) {
+            file_node = n;
+            nodes[n++] = (flame_node_t){ .hotspot = hs, .depth = 1 };
+        }
+        if (new_file || strcmp(prev->location.function, hs->location.function) != 0) {
+            function_node = n;
+            nodes[n++] = (flame_node_t){ .hotspot = hs, .depth = 2 };
+        }
+        nodes[n++] = (flame_node_t){ .hotspot = hs, .depth = 3, .value = misses };
+        nodes[file_node].value += misses;
+        nodes[function_node].value += misses;
+        nodes[0].value += misses;
+    }
+    if (nodes[0].value == 0) goto cleanup;
+    
+    for (int i = 0; i < n; i++) {
+        encoded[2 * i] = (float)nodes[i].depth;
+        encoded[2 * i + 1] = (float)nodes[i].value;
+    }
+    
+    markup_str(sink, "<h3>Misses by context (file, function, line)</h3>\n"
+                       "<div id=\"cs-flame\" class=\"cs-flame\"></div>\n");
+    markup_str(sink, "<script>csCharts.flame(\"cs-flame\",{names:[");
+    for (int i = 0; i < n; i++) {
+        const cache_hotspot_t *hs = nodes[i].hotspot;
+        char line[32];
+        if (i > 0) markup_str(sink, ",");
+        switch (nodes[i].depth) {
+            case 0: markup_string(sink, "all"); break;
+            case 1: markup_string(sink, hs->location.file); break;
+            case 2: markup_string(sink, hs->location.function); break;
+            default:
+                snprintf(line, sizeof(line), "line %d", hs->location.line);
+                markup_string(sink, line);
+                break;
+        }
+    }
+    markup_str(sink, "],data:\"");
+    write_base64(sink, encoded, (size_t)n * 2 * sizeof(float));
+    markup_str(sink, "\"});</script>\n");
+
+cleanup:
+    if (sorted) FREE_LOGGED(sorted);
+    if (nodes) FREE_LOGGED(nodes);
+    if (encoded) FREE_LOGGED(encoded);
+}
+
+// Decoders and painters for the embedded arrays; defined once per section
+static const char chart_renderer[] =
+    "<style>.cs-flame{position:relative;width:100%;font:11px monospace}"
+    ".cs-flame div{position:absolute;height:17px;overflow:hidden;white-space:nowrap;"
+    "background:#f4a261;border-right:1px solid #fff;box-sizing:border-box;cursor:pointer}"
+    "#cs-heat{image-rendering:pixelated;border:1px solid #dee2e6}</style>\n"
+    "<script>var csCharts=(function(){\n"
+    "function bytes(s){var b=atob(s),u=new Uint8Array(b.length);"
+    "for(var i=0;i<b.length;i++)u[i]=b.charCodeAt(i);return u.buffer;}\n"
+    "function esc(s){return String(s).replace(/[&<>\"]/g,function(c){"
+    "return'&#'+c.charCodeAt(0)+';';});}\n"
+    "function heat(id,d){var c=document.getElementById(id),v=new Uint8Array(bytes(d.data)),"
+    "W=d.cols,H=d.rows,o=document.createElement('canvas');o.width=W;o.height=H;"
+    "var g=o.getContext('2d'),img=g.createImageData(W,H);"
+    "for(var r=0;r<H;r++)for(var k=0;k<W;k++){var t=v[r*W+k],p=((H-1-r)*W+k)*4;"
+    "img.data[p]=t?255:250;img.data[p+1]=t?230-t*0.8:250;img.data[p+2]=t?120-t*0.45:250;"
+    "img.data[p+3]=255;}g.putImageData(img,0,0);var x=c.getContext('2d');"
+    "x.imageSmoothingEnabled=false;x.drawImage(o,0,0,c.width,c.height);"
+    "c.onmousemove=function(e){var k=Math.floor(e.offsetX*W/c.width),"
+    "r=H-1-Math.floor(e.offsetY*H/c.height);if(k<0||k>=W||r<0||r>=H)return;"
+    "document.getElementById(id+'-info').textContent='t='+(k*d.dt).toFixed(3)+'s addr=0x'+"
+    "Math.floor(d.a0+r*d.da).toString(16)+' level='+v[r*W+k]+'/255 (log scale, peak '+d.peak+')';};}\n"
+    "function line(id,d){var s=document.getElementById(id),p=new Float32Array(bytes(d.data)),"
+    "n=p.length/2,m=0,pts=[];document.getElementById(id+'-label').textContent=d.label;"
+    "for(var i=0;i<n;i++)m=Math.max(m,p[2*i+1]);"
+    "for(i=0;i<n;i++)pts.push((p[2*i]/d.span*640).toFixed(1)+','+"
+    "(62-p[2*i+1]/(m||1)*58).toFixed(1));"
+    "s.innerHTML='<polyline fill=\"none\" stroke=\"#007bff\" points=\"'+pts.join(' ')+'\"/>'+"
+    "'<text x=\"4\" y=\"12\" font-size=\"10\">peak '+m.toExponential(2)+' misses/s</text>';}\n"
+    "function flame(id,d){var el=document.getElementById(id),v=new Float32Array(bytes(d.data)),"
+    "n=v.length/2;function draw(r){var d0=v[2*r],tot=v[2*r+1],cur={},h='',deep=0;cur[d0]=0;"
+    "for(var i=r;i<n;i++){var dp=v[2*i];if(i>r&&dp<=d0)break;var x=cur[dp],w=v[2*i+1];"
+    "cur[dp]+=w;cur[dp+1]=x;deep=Math.max(deep,dp-d0);var lb=esc(d.names[i])+' ('+w+')';"
+    "h+='<div data-i=\"'+i+'\" title=\"'+lb+'\" style=\"left:'+(x/tot*100)+'%;width:'+"
+    "(w/tot*100)+'%;top:'+((dp-d0)*18)+'px\">'+lb+'</div>';}"
+    "el.innerHTML=h;el.style.height=((deep+1)*18)+'px';"
+    "el.onclick=function(e){var i=e.target.getAttribute('data-i');"
+    "if(i!==null)draw(+i===r?0:+i);};}draw(0);}\n"
+    "return{heat:heat,line:line,flame:flame};})();</script>\n";
+
+// HTML gets the encoded charts; other formats get the text charts
+static int produce_visualizations(report_sink_t *sink, const report_section_t *section) {
+    const chart_input_t *in = section->data;
+    
+    if (!report_sink_is_html(sink)) {
+        char *buffer = MALLOC_LOGGED(8192);
+        if (!buffer) return -1;
+        if (generate_cache_miss_chart(in->hotspots, in->hotspot_count, buffer, 8192) > 0) {
+            report_sink_puts(sink, buffer);
+        }
+        if (generate_pattern_distribution_chart(in->patterns, in->pattern_count, buffer, 8192) > 0) {
+            report_sink_puts(sink, "\n");
+            report_sink_puts(sink, buffer);
+        }
+        FREE_LOGGED(buffer);
+        return sink->failed ? -1 : 0;
+    }
+    
+    markup_str(sink, chart_renderer);
+    
+    chart_bounds_t bounds;
+    if (compute_bounds(in, &bounds)) {
+        write_heatmap(sink, in, &bounds);
+        write_timelines(sink, in, &bounds);
+    }
+    write_flame_graph(sink, in);
+    
+    return sink->failed ? -1 : 0;
+}
+
+int generate_visualization_section(report_t *report, const chart_input_t *input) {
+    if (!report || !input) return -1;
+    
+    return report_add_producer(report, "Visualizations", 88,
+                               produce_visualizations, input, 0) ? 0 : -1;
+}
+
+// Horizontal bars of the hotspots with the most misses
+int generate_cache_miss_chart(const cache_hotspot_t *hotspots, int count,
+                             char *output_buffer, size_t buffer_size) {
+    if (!output_buffer || buffer_size == 0) return -1;
+    output_buffer[0] = '\0';
+    if (!hotspots || count <= 0) return 0;
+    
+    uint64_t peak = 0;
+    for (int i = 0; i < count; i++) {
+        if (hotspots[i].total_misses > peak) peak = hotspots[i].total_misses;
+    }
+    if (peak == 0) return 0;
+    
+    size_t used = snprintf(output_buffer, buffer_size, "Cache misses by hotspot\n```\n");
+    int shown = min(count, 20);
+    for (int i = 0; i < shown && used < buffer_size; i++) {
+        const cache_hotspot_t *hs = &hotspots[i];
+        int width = (int)((double)hs->total_misses / peak * 40 + 0.5);
+        char bar[41];
+        memset(bar, '#', width);
+        bar[width] = '\0';
+        
+        const char *file = strrchr(hs->location.file, '/');
+        used += snprintf(output_buffer + used, buffer_size - used, "%24.24s:%-5d %-40s %llu\n",
+                         file ? file + 1 : hs->location.file, hs->location.line, bar,
+                         (unsigned long long)hs->total_misses);
+    }
+    if (used < buffer_size) {
+        used += snprintf(output_buffer + used, buffer_size - used, "```\n");
+    }
+    
+    return (int)min(used, buffer_size - 1);
+}
+
+// Count and summed severity per anti-pattern type
+int generate_pattern_distribution_chart(const classified_pattern_t *patterns,
+                                       int count, char *output_buffer,
+                                       size_t buffer_size) {
+    if (!output_buffer || buffer_size == 0) return -1;
+    output_buffer[0] = '\0';
+    if (!patterns || count <= 0) return 0;
+    
+    int counts[BANK_CONFLICTS + 1] = {0};
+    double severity[BANK_CONFLICTS + 1] = {0};
+    int peak = 0;
+    for (int i = 0; i < count; i++) {
+        unsigned type = patterns[i].type;
+        if (type > BANK_CONFLICTS) continue;
+        counts[type]++;
+        severity[type] += patterns[i].severity_score;
+        if (counts[type] > peak) peak = counts[type];
+    }
+    if (peak == 0) return 0;
+    
+    size_t used = snprintf(output_buffer, buffer_size, "Pattern distribution\n```\n");
+    for (int t = 0; t <= BANK_CONFLICTS && used < buffer_size; t++) {
+        if (counts[t] == 0) continue;
+        int width = (int)((double)counts[t] / peak * 30 + 0.5);
+        char bar[31];
+        memset(bar, '#', width);
+        bar[width] = '\0';
+        
+        used += snprintf(output_buffer + used, buffer_size - used, "%-28s %-30s %3d (severity %.1f)\n",
+                         cache_antipattern_to_string((cache_antipattern_t)t), bar,
+                         counts[t], severity[t] / counts[t]);
+    }
+    if (used < buffer_size) {
+        used += snprintf(output_buffer + used, buffer_size - used, "```\n");
+    }
+    
+    return (int)min(used, buffer_size - 1);
+}
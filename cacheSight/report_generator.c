@@ -1,8 +1,211 @@
 #include "report_generator.h"
+#include "json_writer.h"
+#include "source_index.h"
+#include "stage_trace.h"
 #include <time.h>
+#include <stdarg.h>
 #ifndef min
 #define min(a, b) ((a) < (b) ? (a) : (b))
 #endif
+// Push the pending chunk to the file
+static int sink_flush(report_sink_t *sink) {
+    if (sink->used == 0) return sink->failed ? -1 : 0;
+    
+    if (fwrite(sink->chunk, 1, sink->used, sink->fp) != sink->used) {
+        sink->failed = true;
+    }
+    sink->bytes_written += sink->used;
+    sink->used = 0;
+    return sink->failed ? -1 : 0;
+}
+
+// Append bytes without escaping
+static int sink_raw(report_sink_t *sink, const char *data, size_t len) {
+    while (len > 0) {
+        if (sink->used == sizeof(sink->chunk) && sink_flush(sink) != 0) {
+            return -1;
+        }
+        size_t n = min(len, sizeof(sink->chunk) - sink->used);
+        memcpy(sink->chunk + sink->used, data, n);
+        sink->used += n;
+        data += n;
+        len -= n;
+    }
+    return sink->failed ? -1 : 0;
+}
+
+static int sink_raw_str(report_sink_t *sink, const char *str) {
+    return sink_raw(sink, str, strlen(str));
+}
+
+static void sink_emit_raw(void *ctx, const char *data, size_t len) {
+    sink_raw(ctx, data, len);
+}
+
+// Emit one content line as HTML, detecting code the way the text sections mark it
+static void sink_html_line(report_sink_t *sink) {
+    size_t len = sink->line_len;
+    sink->line_len = 0;
+    if (len == 0) return;
+    sink->line[len] = '\0';
+    
+    const char *line = sink->line;
+    
+    // A bare fence only opens or closes a code block
+    if (strcmp(line, "```") == 0) {
+        sink_raw_str(sink, sink->in_code ? "</pre>\n" : "<pre>");
+        sink->in_code = !sink->in_code;
+        return;
+    }
+    
+    if (strstr(line, "```") || strstr(line, "//") || strstr(line, "/*")) {
+        if (!sink->in_code) {
+            sink_raw_str(sink, "<pre>");
+            sink->in_code = true;
+        }
+        sink_raw(sink, line, len);
+        sink_raw_str(sink, "\n");
+    } else if (sink->in_code) {
+        sink_raw(sink, line, len);
+        sink_raw_str(sink, "\n");
+    } else {
+        sink_raw_str(sink, "<p>");
+        sink_raw(sink, line, len);
+        sink_raw_str(sink, "</p>\n");
+    }
+}
+
+static int sink_open(report_sink_t *sink, const char *path) {
+    memset(sink, 0, sizeof(*sink));
+    sink->fp = fopen(path, "w");
+    if (!sink->fp) {
+        LOG_ERROR("Failed to open output file: %s", path);
+        return -1;
+    }
+    return 0;
+}
+
+static int sink_close(report_sink_t *sink) {
+    int ret = sink_flush(sink);
+    if (fclose(sink->fp) != 0) ret = -1;
+    sink->fp = NULL;
+    if (ret != 0) {
+        LOG_ERROR("Failed to write report output");
+    } else {
+        LOG_DEBUG("Report sink wrote %zu bytes", sink->bytes_written);
+    }
+    return ret;
+}
+
+// Switch escaping; leaving HTML line mode flushes the pending line and closes <pre>
+static void sink_set_escape(report_sink_t *sink, report_escape_t escape) {
+    if (sink->escape == REPORT_ESCAPE_HTML_LINES && escape != REPORT_ESCAPE_HTML_LINES) {
+        sink_html_line(sink);
+        if (sink->in_code) {
+            sink_raw_str(sink, "</pre>\n");
+            sink->in_code = false;
+        }
+    }
+    sink->escape = escape;
+}
+
+int report_sink_write(report_sink_t *sink, const char *data, size_t len) {
+    if (!sink || !data) return -1;
+    
+    switch (sink->escape) {
+        case REPORT_ESCAPE_NONE:
+            return sink_raw(sink, data, len);
+        
+        case REPORT_ESCAPE_JSON:
+            json_escape(data, len, sink_emit_raw, sink);
+            break;
+        
+        case REPORT_ESCAPE_HTML_LINES:
+            for (size_t i = 0; i < len; i++) {
+                if (data[i] == '\n') {
+                    sink_html_line(sink);
+                    continue;
+                }
+                // Over-long lines are split rather than truncated
+                if (sink->line_len == sizeof(sink->line) - 1) {
+                    sink_html_line(sink);
+                }
+                sink->line[sink->line_len++] = data[i];
+            }
+            break;
+    }
+    
+    return sink->failed ? -1 : 0;
+}
+
+int report_sink_puts(report_sink_t *sink, const char *str) {
+    if (!str) return -1;
+    return report_sink_write(sink, str, strlen(str));
+}
+
+int report_sink_write_text(report_sink_t *sink, const char *data, size_t len) {
+    if (!sink || !data) return -1;
+    if (sink->escape != REPORT_ESCAPE_HTML_LINES) {
+        return report_sink_write(sink, data, len);
+    }
+    
+    size_t run = 0;
+    for (size_t i = 0; i < len; i++) {
+        const char *entity = data[i] == '<' ? "&lt;" : data[i] == '>' ? "&gt;" :
+                             data[i] == '&' ? "&amp;" : NULL;
+        if (!entity) continue;
+        
+        report_sink_write(sink, data + run, i - run);
+        report_sink_puts(sink, entity);
+        run = i + 1;
+    }
+    return report_sink_write(sink, data + run, len - run);
+}
+
+int report_sink_markup(report_sink_t *sink, const char *data, size_t len) {
+    if (!sink || !data) return -1;
+    if (sink->escape != REPORT_ESCAPE_HTML_LINES) return 0;
+    
+    // Finish any pending text line and code block so markup lands after them
+    sink_html_line(sink);
+    if (sink->in_code) {
+        sink_raw_str(sink, "</pre>\n");
+        sink->in_code = false;
+    }
+    return sink_raw(sink, data, len);
+}
+
+bool report_sink_is_html(const report_sink_t *sink) {
+    return sink && sink->escape == REPORT_ESCAPE_HTML_LINES;
+}
+
+int report_sink_printf(report_sink_t *sink, const char *format, ...) {
+    char buffer[2048];
+    va_list args, copy;
+    
+    va_start(args, format);
+    va_copy(copy, args);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    
+    int ret = -1;
+    if (n < 0) {
+        ret = -1;
+    } else if ((size_t)n < sizeof(buffer)) {
+        ret = report_sink_write(sink, buffer, n);
+    } else {
+        // Rare long line: format once more into an exact-size buffer
+        char *big = MALLOC_LOGGED(n + 1);
+        if (big) {
+            vsnprintf(big, n + 1, format, copy);
+            ret = report_sink_write(sink, big, n);
+            FREE_LOGGED(big);
+        }
+    }
+    va_end(copy);
+    return ret;
+}
+
 // Create report
 report_t* report_create(const char *title) {
     report_t *report = CALLOC_LOGGED(1, sizeof(report_t));
@@ -37,6 +240,11 @@ void report_destroy(report_t *report) {
     if (!report) return;
     
     if (report->sections) {
+        for (int i = 0; i < report->section_count; i++) {
+            if (report->sections[i].content) {
+                FREE_LOGGED(report->sections[i].content);
+            }
+        }
         FREE_LOGGED(report->sections);
     }
     
@@ -56,6 +264,31 @@ int generate_static_analysis_section(report_t *report,
     return report_add_section(report, "Static Analysis", buffer, 80);
 }
 
+// Stream the hotspot list
+static int produce_hotspots(report_sink_t *sink, const report_section_t *section) {
+    const cache_hotspot_t *hotspots = section->data;
+    
+    report_sink_printf(sink, "Identified %d cache hotspots with high miss rates\n\n",
+                       section->count);
+    
+    for (int i = 0; i < section->count; i++) {
+        const cache_hotspot_t *hs = &hotspots[i];
+        report_sink_printf(sink, "%d. %s:%d - %.1f%% miss rate (%zu misses)\n",
+                           i + 1,
+                           hs->location.file,
+                           hs->location.line,
+                           hs->miss_rate * 100,
+                           hs->total_misses);
+        
+        // Include source snippet if requested
+        if (section->include_source && hs->location.function[0] != '\0') {
+            report_sink_printf(sink, "   Function: %s\n", hs->location.function);
+        }
+    }
+    
+    return sink->failed ? -1 : 0;
+}
+
 // Generate hotspot section - use include_source parameter
 int generate_hotspot_section(report_t *report,
                             const cache_hotspot_t *hotspots,
@@ -63,93 +296,54 @@ int generate_hotspot_section(report_t *report,
                             bool include_source) {
     if (!report || !hotspots) return -1;
     
-    char buffer[8192];
-    char *p = buffer;
-    int remaining = sizeof(buffer);
+    report_section_t *section = report_add_producer(report, "Cache Hotspots", 95,
+                                                    produce_hotspots, hotspots, count);
+    if (!section) return -1;
     
-    int n = snprintf(p, remaining,
-                    "Identified %d cache hotspots with high miss rates\n\n",
-                    count);
-    p += n; remaining -= n;
+    section->include_source = include_source;
+    return 0;
+}
+
+// Stream the pattern list
+static int produce_patterns(report_sink_t *sink, const report_section_t *section) {
+    const classified_pattern_t *patterns = section->data;
     
-    for (int i = 0; i < count && i < 10 && remaining > 100; i++) {
-        const cache_hotspot_t *hs = &hotspots[i];
-        n = snprintf(p, remaining,
-                    "%d. %s:%d - %.1f%% miss rate (%zu misses)\n",
-                    i + 1,
-                    hs->location.file,
-                    hs->location.line,
-                    hs->miss_rate * 100,
-                    hs->total_misses);
-        if (n > 0 && n < remaining) {
-            p += n; remaining -= n;
-        }
-        
-        // Include source snippet if requested
-        if (include_source && hs->location.function[0] != '\0' && remaining > 50) {
-            n = snprintf(p, remaining,
-                        "   Function: %s\n",
-                        hs->location.function);
-            if (n > 0 && n < remaining) {
-                p += n; remaining -= n;
-            }
-        }
+    report_sink_printf(sink, "Detected %d cache access patterns\n\n", section->count);
+    
+    for (int i = 0; i < section->count; i++) {
+        const classified_pattern_t *pat = &patterns[i];
+        report_sink_printf(sink, "%d. %s - Severity: %.1f, Impact: %.1f%%\n",
+                           i + 1,
+                           pat->description,
+                           pat->severity_score,
+                           pat->performance_impact);
     }
     
-    return report_add_section(report, "Cache Hotspots", buffer, 95);
+    return sink->failed ? -1 : 0;
 }
 
-
 // Generate pattern section
 int generate_pattern_section(report_t *report,
                             const classified_pattern_t *patterns,
                             int count) {
     if (!report || !patterns) return -1;
     
-    char buffer[8192];
-    char *p = buffer;
-    int remaining = sizeof(buffer);
-    
-    int n = snprintf(p, remaining,
-                    "Detected %d cache access patterns\n\n",
-                    count);
-    p += n; remaining -= n;
-    
-    for (int i = 0; i < count && i < 10 && remaining > 100; i++) {
-        const classified_pattern_t *pat = &patterns[i];
-        n = snprintf(p, remaining,
-                    "%d. %s - Severity: %.1f, Impact: %.1f%%\n",
-                    i + 1,
-                    pat->description,
-                    pat->severity_score,
-                    pat->performance_impact);
-        if (n > 0 && n < remaining) {
-            p += n; remaining -= n;
-        }
-    }
-    
-    return report_add_section(report, "Access Patterns", buffer, 85);
+    return report_add_producer(report, "Access Patterns", 85,
+                               produce_patterns, patterns, count) ? 0 : -1;
 }
 
-// UPDATE THIS - SHOULD PROVIDE LOCATIONS
-// UPDATE THIS - SHOULD PROVIDE LOCATIONS AND DETAILS
-int generate_recommendation_section(report_t *report,
-                                   const optimization_rec_t *recommendations,
-                                   int count) {
-    if (!report || !recommendations) return -1;
-    
-    char buffer[65536];
-    char *p = buffer;
-    int remaining = sizeof(buffer);
+// Stream every recommendation with its location and rendered text
+static int produce_recommendations(report_sink_t *sink, const report_section_t *section) {
+    const optimization_rec_t *recommendations = section->data;
+    char text[2048];
     
-    int n = snprintf(p, remaining,
-                    "<h3>Generated %d optimization recommendations</h3>\n"
-                    "<div class='recommendations'>\n",
-                    count);
-    p += n; remaining -= n;
+    report_sink_printf(sink,
+                       "<h3>Generated %d optimization recommendations</h3>\n"
+                       "<div class='recommendations'>\n",
+                       section->count);
     
     // Add each recommendation with HTML formatting
-    for (int i = 0; i < count && remaining > 500; i++) {
+    for (int i = 0; i < section->count; i++) {
         const optimization_rec_t *rec = &recommendations[i];
         
         // Add location if available
@@ -160,128 +354,406 @@ int generate_recommendation_section(report_t *report,
             line = rec->pattern->hotspot->location.line;
         }
         
-        n = snprintf(p, remaining,
-                    "<div class='recommendation'>\n"
-                    "<h4>%d. %s (Priority: %d)</h4>\n"
-                    "<ul>\n"
-                    "<li><strong>Location:</strong> %s:%d</li>\n"
-                    "<li><strong>Expected Improvement:</strong> %.1f%% (Confidence: %.0f%%)</li>\n"
-                    "<li><strong>Difficulty:</strong> %d/10</li>\n"
-                    "<li><strong>Rationale:</strong> %s</li>\n",
-                    i + 1,
-                    optimization_type_to_string(rec->type),
-                    rec->priority,
-                    file, line,
-                    rec->expected_improvement,
-                    rec->confidence_score * 100,
-                    rec->implementation_difficulty,
-                    rec->rationale);
+        recommendation_render(rec, REC_FIELD_RATIONALE, text, sizeof(text));
+        report_sink_printf(sink,
+                           "<div class='recommendation'>\n"
+                           "<h4>%d. %s (Priority: %d)</h4>\n"
+                           "<ul>\n"
+                           "<li><strong>Location:</strong> %s:%d</li>\n"
+                           "<li><strong>Expected Improvement:</strong> %.1f%% (Confidence: %.0f%%)</li>\n"
+                           "<li><strong>Difficulty:</strong> %d/10</li>\n"
+                           "<li><strong>Rationale:</strong> %s</li>\n",
+                           i + 1,
+                           optimization_type_to_string(rec->type),
+                           rec->priority,
+                           file, line,
+                           rec->expected_improvement,
+                           rec->confidence_score * 100,
+                           rec->implementation_difficulty,
+                           text);
         
-        if (n > 0 && n < remaining) {
-            p += n; remaining -= n;
+        // Measured on this machine with a generated microkernel
+        if (rec->measured_speedup > 0) {
+            report_sink_printf(sink,
+                               "<li><strong>Measured Speedup:</strong> %.2fx (CI %.2f&ndash;%.2f)</li>\n",
+                               rec->measured_speedup, rec->speedup_ci_low, rec->speedup_ci_high);
         }
         
         // Add compiler flags if present
-        if (strlen(rec->compiler_flags) > 0 && remaining > 50) {
-            n = snprintf(p, remaining,
-                        "<li><strong>Compiler flags:</strong> <code>%s</code></li>\n",
-                        rec->compiler_flags);
-            if (n > 0 && n < remaining) {
-                p += n; remaining -= n;
-            }
+        if (recommendation_render(rec, REC_FIELD_FLAGS, text, sizeof(text)) > 0) {
+            report_sink_printf(sink, "<li><strong>Compiler flags:</strong> <code>%s</code></li>\n",
+                               text);
         }
         
         // Add implementation guide
-        if (strlen(rec->implementation_guide) > 0 && remaining > 100) {
-            n = snprintf(p, remaining,
-                        "<li><strong>Implementation:</strong><pre>%s</pre></li>\n",
-                        rec->implementation_guide);
-            if (n > 0 && n < remaining) {
-                p += n; remaining -= n;
-            }
+        if (recommendation_render(rec, REC_FIELD_GUIDE, text, sizeof(text)) > 0) {
+            report_sink_printf(sink, "<li><strong>Implementation:</strong><pre>%s</pre></li>\n",
+                               text);
         }
         
-        // Add code example if space permits
-        if (strlen(rec->code_suggestion) > 0 && remaining > 500) {
-            n = snprintf(p, remaining,
-                        "<li><strong>Code Example:</strong><pre>%s</pre></li>\n",
-                        rec->code_suggestion);
-            if (n > 0 && n < remaining) {
-                p += n; remaining -= n;
-            }
+        // Add code example
+        if (recommendation_render(rec, REC_FIELD_CODE, text, sizeof(text)) > 0) {
+            report_sink_printf(sink, "<li><strong>Code Example:</strong><pre>%s</pre></li>\n",
+                               text);
+        }
+        
+        report_sink_puts(sink, "</ul>\n</div>\n<hr>\n");
+    }
+    
+    report_sink_puts(sink, "</div>\n");
+    return sink->failed ? -1 : 0;
+}
+
+// Generate recommendation section with locations and details
+int generate_recommendation_section(report_t *report,
+                                   const optimization_rec_t *recommendations,
+                                   int count) {
+    if (!report || !recommendations) return -1;
+    
+    return report_add_producer(report, "Recommendations", 100,
+                               produce_recommendations, recommendations, count) ? 0 : -1;
+}
+
+// Counters joined onto one source line
+typedef struct {
+    const char *file;
+    int line;
+    uint64_t misses;
+    double latency_sum;             // Latency weighted by misses
+    double latency_weight;
+    uint32_t static_tags;           // Bit per access_pattern_t
+    uint32_t antipattern_tags;      // Bit per cache_antipattern_t
+} line_counter_t;
+
+// Annotated lines of one file: counters[first .. first + count)
+typedef struct {
+    const char *file;
+    int first;
+    int count;
+    uint64_t misses;
+} file_group_t;
+
+static int compare_line_counters(const void *a, const void *b) {
+    const line_counter_t *la = a;
+    const line_counter_t *lb = b;
+    int c = strcmp(la->file, lb->file);
+    return c != 0 ? c : la->line - lb->line;
+}
+
+static int compare_file_groups(const void *a, const void *b) {
+    const file_group_t *fa = a;
+    const file_group_t *fb = b;
+    if (fa->misses != fb->misses) return fa->misses > fb->misses ? -1 : 1;
+    return fb->count - fa->count;
+}
+
+static void add_line_counter(line_counter_t *counters, int *count, const source_location_t *loc) {
+    if (loc->file[0] == '\0' || loc->line <= 0) return;
+    
+    line_counter_t *c = &counters[(*count)++];
+    memset(c, 0, sizeof(*c));
+    c->file = loc->file;
+    c->line = loc->line;
+}
+
+static void format_tags(const line_counter_t *c, char *buffer, size_t size) {
+    size_t used = 0;
+    buffer[0] = '\0';
+    
+    for (int bit = 0; bit < 32 && used < size; bit++) {
+        if (c->antipattern_tags & (1u << bit)) {
+            used += snprintf(buffer + used, size - used, "%s%s", used ? "," : "",
+                             cache_antipattern_to_string((cache_antipattern_t)bit));
+        }
+    }
+    for (int bit = 0; bit < 32 && used < size; bit++) {
+        if (c->static_tags & (1u << bit)) {
+            used += snprintf(buffer + used, size - used, "%s%s", used ? "," : "",
+                             access_pattern_to_string((access_pattern_t)bit));
+        }
+    }
+}
+
+static void write_annotated_line(report_sink_t *sink, int line, const line_counter_t *c,
+                                 const char *text, size_t length) {
+    char misses[24] = "", latency[24] = "", tags[128] = "";
+    if (c) {
+        if (c->misses > 0) {
+            snprintf(misses, sizeof(misses), "%llu", (unsigned long long)c->misses);
+        }
+        if (c->latency_weight > 0) {
+            snprintf(latency, sizeof(latency), "%.0f", c->latency_sum / c->latency_weight);
+        }
+        format_tags(c, tags, sizeof(tags));
+    }
+    
+    report_sink_printf(sink, "%10s %8s  %-28.28s %6d | ", misses, latency, tags, line);
+    if (text) {
+        report_sink_write_text(sink, text, length);
+    }
+    report_sink_puts(sink, "\n");
+}
+
+// Join aggregated line counters with each hot file, mapped once and walked in
+// line order; memory is bounded by the counters, not the sources
+static int produce_annotations(report_sink_t *sink, const report_section_t *section) {
+    const annotation_input_t *in = section->data;
+    const analysis_results_t *sr = in->static_results;
+    int capacity = in->hotspot_count + in->pattern_count + (sr ? sr->pattern_count : 0);
+    if (capacity == 0) return 0;
+    
+    line_counter_t *counters = MALLOC_LOGGED((size_t)capacity * sizeof(line_counter_t));
+    file_group_t *files = MALLOC_LOGGED((size_t)capacity * sizeof(file_group_t));
+    if (!counters || !files) {
+        if (counters) FREE_LOGGED(counters);
+        if (files) FREE_LOGGED(files);
+        return -1;
+    }
+    
+    int n = 0;
+    for (int i = 0; i < in->hotspot_count; i++) {
+        const cache_hotspot_t *hs = &in->hotspots[i];
+        int before = n;
+        add_line_counter(counters, &n, &hs->location);
+        if (n > before) {
+            double weight = hs->total_misses > 0 ? (double)hs->total_misses : 1.0;
+            counters[before].misses = hs->total_misses;
+            counters[before].latency_sum = hs->avg_latency_cycles * weight;
+            counters[before].latency_weight = hs->avg_latency_cycles > 0 ? weight : 0;
+        }
+    }
+    for (int i = 0; i < in->pattern_count; i++) {
+        const classified_pattern_t *pat = &in->patterns[i];
+        int before = n;
+        if (pat->hotspot) add_line_counter(counters, &n, &pat->hotspot->location);
+        if (n > before && (unsigned)pat->type < 32) {
+            counters[before].antipattern_tags = 1u << pat->type;
+        }
+    }
+    for (int i = 0; sr && i < sr->pattern_count; i++) {
+        int before = n;
+        add_line_counter(counters, &n, &sr->patterns[i].location);
+        if (n > before && (unsigned)sr->patterns[i].pattern < 32) {
+            counters[before].static_tags = 1u << sr->patterns[i].pattern;
+        }
+    }
+    
+    // Sort by file and line, then fold duplicates in place
+    qsort(counters, n, sizeof(line_counter_t), compare_line_counters);
+    int unique = 0;
+    for (int i = 0; i < n; i++) {
+        line_counter_t *last = unique > 0 ? &counters[unique - 1] : NULL;
+        if (last && last->line == counters[i].line && strcmp(last->file, counters[i].file) == 0) {
+            last->misses += counters[i].misses;
+            last->latency_sum += counters[i].latency_sum;
+            last->latency_weight += counters[i].latency_weight;
+            last->static_tags |= counters[i].static_tags;
+            last->antipattern_tags |= counters[i].antipattern_tags;
+        } else {
+            counters[unique++] = counters[i];
+        }
+    }
+    
+    int file_count = 0;
+    for (int i = 0; i < unique; i++) {
+        if (file_count == 0 || strcmp(files[file_count - 1].file, counters[i].file) != 0) {
+            files[file_count++] = (file_group_t){ .file = counters[i].file, .first = i };
         }
+        files[file_count - 1].count++;
+        files[file_count - 1].misses += counters[i].misses;
+    }
+    qsort(files, file_count, sizeof(file_group_t), compare_file_groups);
+    
+    int shown = in->max_files > 0 && in->max_files < file_count ? in->max_files : file_count;
+    report_sink_printf(sink, "Annotated %d of %d source files with attributed misses, "
+                       "average latency (cycles) and pattern tags\n\n", shown, file_count);
+    
+    for (int f = 0; f < shown; f++) {
+        const file_group_t *group = &files[f];
+        const line_counter_t *lines = &counters[group->first];
+        source_index_t *source = source_index_open(group->file);
         
-        n = snprintf(p, remaining, "</ul>\n</div>\n<hr>\n");
-        if (n > 0 && n < remaining) {
-            p += n; remaining -= n;
+        report_sink_printf(sink, "%s: %llu misses on %d annotated lines%s\n", group->file,
+                           (unsigned long long)group->misses, group->count,
+                           source ? "" : " (source not available)");
+        report_sink_puts(sink, "```\n");
+        report_sink_printf(sink, "%10s %8s  %-28s %6s |\n", "Misses", "Latency", "Tags", "Line");
+        
+        if (source) {
+            // Merge walk: every source line, counters picked up as their line comes
+            int next = 0;
+            for (int line = 1; line <= source->line_count; line++) {
+                const line_counter_t *c = NULL;
+                while (next < group->count && lines[next].line < line) next++;
+                if (next < group->count && lines[next].line == line) c = &lines[next];
+                
+                size_t length;
+                const char *text = source_index_line(source, line, &length);
+                write_annotated_line(sink, line, c, text, length);
+            }
+            source_index_close(source);
+        } else {
+            for (int i = 0; i < group->count; i++) {
+                write_annotated_line(sink, lines[i].line, &lines[i], NULL, 0);
+            }
         }
+        report_sink_puts(sink, "```\n\n");
     }
     
-    n = snprintf(p, remaining, "</div>\n");
-    if (n > 0) p += n;
+    FREE_LOGGED(counters);
+    FREE_LOGGED(files);
+    return sink->failed ? -1 : 0;
+}
+
+int generate_annotation_section(report_t *report, const annotation_input_t *input) {
+    if (!report || !input) return -1;
+    
+    return report_add_producer(report, "Source Annotation", 75,
+                               produce_annotations, input, 0) ? 0 : -1;
+}
+
+// Copy numbered source lines into a buffer; returns the number of lines copied
+int extract_code_snippet(const char *filename, int start_line, int end_line,
+                        char *output_buffer, size_t buffer_size) {
+    if (!filename || !output_buffer || buffer_size == 0) return -1;
+    output_buffer[0] = '\0';
+    
+    source_index_t *source = source_index_open(filename);
+    if (!source) return -1;
+    
+    if (start_line < 1) start_line = 1;
+    if (end_line > source->line_count) end_line = source->line_count;
+    
+    size_t used = 0;
+    int copied = 0;
+    for (int line = start_line; line <= end_line; line++) {
+        size_t length;
+        const char *text = source_index_line(source, line, &length);
+        int n = snprintf(output_buffer + used, buffer_size - used, "%5d | %.*s\n",
+                         line, (int)length, text);
+        if (n < 0 || (size_t)n >= buffer_size - used) {
+            output_buffer[used] = '\0';
+            break;
+        }
+        used += n;
+        copied++;
+    }
     
-    return report_add_section(report, "Recommendations", buffer, 100);
+    source_index_close(source);
+    return copied;
 }
 
 // Generate markdown report - fix the unused parameter warning
 int generate_markdown_report(const report_t *report, const char *output_file,
                            const report_config_t *config) {
-    FILE *fp = fopen(output_file, "w");
-    if (!fp) return -1;
+    report_sink_t sink;
+    if (sink_open(&sink, output_file) != 0) return -1;
     
     // Use config parameter to avoid warning
     bool verbose = config ? config->verbose : false;
     
-    fprintf(fp, "# %s\n\n", report->title);
-    fprintf(fp, "*Generated: %s*\n\n", report->timestamp);
+    report_sink_printf(&sink, "# %s\n\n", report->title);
+    report_sink_printf(&sink, "*Generated: %s*\n\n", report->timestamp);
     
     if (strlen(report->summary) > 0) {
-        fprintf(fp, "## Summary\n\n%s\n\n", report->summary);
+        report_sink_printf(&sink, "## Summary\n\n%s\n\n", report->summary);
     }
     
     for (int i = 0; i < report->section_count; i++) {
-        fprintf(fp, "## %s\n\n", report->sections[i].title);
-        if (report->sections[i].is_critical) {
-            fprintf(fp, "**⚠️ CRITICAL**\n\n");
+        const report_section_t *section = &report->sections[i];
+        
+        report_sink_printf(&sink, "## %s\n\n", section->title);
+        if (section->is_critical) {
+            report_sink_puts(&sink, "**⚠️ CRITICAL**\n\n");
         }
-        fprintf(fp, "%s\n\n", report->sections[i].content);
+        section->produce(&sink, section);
+        report_sink_puts(&sink, "\n\n");
         
         if (verbose) {
-            fprintf(fp, "*Priority: %d*\n\n", report->sections[i].priority);
+            report_sink_printf(&sink, "*Priority: %d*\n\n", section->priority);
         }
     }
     
-    fclose(fp);
-    return 0;
+    return sink_close(&sink);
 }
 
-// Add section
-int report_add_section(report_t *report, const char *title, 
-                      const char *content, int priority) {
-    if (!report || !title || !content) return -1;
+// Fixed-text sections replay their stored copy
+static int produce_content(report_sink_t *sink, const report_section_t *section) {
+    return report_sink_puts(sink, section->content);
+}
+
+// Append a section record; bodies are produced when the report is written
+report_section_t* report_add_producer(report_t *report, const char *title, int priority,
+                                      report_producer_t produce, const void *data, int count) {
+    if (!report || !title || !produce) return NULL;
     
     // Grow sections array if needed
     if (report->section_count >= report->section_capacity) {
-        report->section_capacity *= 2;
+        int capacity = report->section_capacity * 2;
         report_section_t *new_sections = realloc(report->sections,
-            report->section_capacity * sizeof(report_section_t));
+            capacity * sizeof(report_section_t));
         if (!new_sections) {
             LOG_ERROR("Failed to grow sections array");
-            return -1;
+            return NULL;
         }
         report->sections = new_sections;
+        report->section_capacity = capacity;
     }
     
-    report_section_t *section = &report->sections[report->section_count++];
+    report_section_t *section = &report->sections[report->section_count];
+    memset(section, 0, sizeof(*section));
     strncpy(section->title, title, sizeof(section->title) - 1);
-    strncpy(section->content, content, sizeof(section->content) - 1);
     section->priority = priority;
     section->is_critical = (priority >= 90);
+    section->sequence = report->section_count++;
+    section->produce = produce;
+    section->data = data;
+    section->count = count;
     
     LOG_DEBUG("Added report section: %s (priority: %d)", title, priority);
+    return section;
+}
+
+// Add section
+int report_add_section(report_t *report, const char *title, 
+                      const char *content, int priority) {
+    if (!report || !title || !content) return -1;
+    
+    // Only as much as the text needs, never truncated
+    size_t len = strlen(content);
+    char *copy = MALLOC_LOGGED(len + 1);
+    if (!copy) return -1;
+    memcpy(copy, content, len + 1);
+    
+    report_section_t *section = report_add_producer(report, title, priority,
+                                                    produce_content, NULL, 0);
+    if (!section) {
+        FREE_LOGGED(copy);
+        return -1;
+    }
+    
+    section->content = copy;
     return 0;
 }
 
+static int compare_sections(const void *a, const void *b) {
+    const report_section_t *sa = a;
+    const report_section_t *sb = b;
+    
+    if (sa->priority != sb->priority) {
+        return sb->priority - sa->priority;
+    }
+    return sa->sequence - sb->sequence;
+}
+
+// Sort sections by priority
+void report_sort_sections(report_t *report) {
+    if (!report || report->section_count < 2) return;
+    
+    qsort(report->sections, report->section_count, sizeof(report_section_t),
+          compare_sections);
+}
+
 // Add summary
 int report_add_summary(report_t *report, const char *summary) {
     if (!report || !summary) return -1;
@@ -303,6 +775,7 @@ int generate_report(const report_config_t *config,
         LOG_ERROR("Invalid parameters for generate_report");
         return -1;
     }
+    TRACE_SCOPE(trace, "report.generate");
     
     LOG_INFO("Generating %s report to %s",
              config->format == REPORT_FORMAT_HTML ? "HTML" :
@@ -355,21 +828,36 @@ int generate_report(const report_config_t *config,
                                 min(pattern_count, config->max_items_per_section));
     }
     
+    // Joined at write time; the input lives on this frame until the report is out
+    annotation_input_t annotation = {
+        .hotspots = hotspots,
+        .hotspot_count = hotspot_count,
+        .patterns = patterns,
+        .pattern_count = pattern_count,
+        .static_results = static_results,
+        .max_files = config->max_items_per_section
+    };
+    if (config->include_source_snippets && hotspots && hotspot_count > 0) {
+        generate_annotation_section(report, &annotation);
+    }
+    
+    chart_input_t charts = {
+        .hotspots = hotspots,
+        .hotspot_count = hotspot_count,
+        .patterns = patterns,
+        .pattern_count = pattern_count,
+        .max_timelines = min(config->max_items_per_section, 12)
+    };
+    if (config->include_graphs && hotspots && hotspot_count > 0) {
+        generate_visualization_section(report, &charts);
+    }
+    
     if (recommendations && rec_count > 0) {
         generate_recommendation_section(report, recommendations,
                                        min(rec_count, config->max_items_per_section));
     }
     
-    // Sort sections by priority
-    for (int i = 0; i < report->section_count - 1; i++) {
-        for (int j = i + 1; j < report->section_count; j++) {
-            if (report->sections[i].priority < report->sections[j].priority) {
-                report_section_t temp = report->sections[i];
-                report->sections[i] = report->sections[j];
-                report->sections[j] = temp;
-            }
-        }
-    }
+    report_sort_sections(report);
     
     // Generate output based on format
     int ret = -1;
@@ -443,286 +931,262 @@ int generate_executive_summary(report_t *report,
     return 0;
 }
 
-// Generate hardware section
-int generate_hardware_section(report_t *report, const cache_info_t *cache_info) {
-    char buffer[4096];
-    char *p = buffer;
-    int remaining = sizeof(buffer);
-    
-    int n = snprintf(p, remaining,
-                    "Hardware Configuration Details\n"
-                    "==============================\n\n");
-    p += n; remaining -= n;
-    
-    n = snprintf(p, remaining,
-                "CPU Information:\n"
-                "- Model: %s\n"
-                "- Architecture: %s\n"
-                "- Cores: %d physical, %d logical\n"
-                "- Frequency: %.2f GHz\n"
-                "- NUMA Nodes: %d\n\n",
-                cache_info->cpu_model,
-                cache_info->arch,
-                cache_info->num_cores,
-                cache_info->num_threads,
-                cache_info->cpu_frequency_ghz,
-                cache_info->numa_nodes);
-    p += n; remaining -= n;
-    
-    n = snprintf(p, remaining, "Cache Hierarchy:\n");
-    p += n; remaining -= n;
+// Stream the CPU, cache and memory details
+static int produce_hardware(report_sink_t *sink, const report_section_t *section) {
+    const cache_info_t *cache_info = section->data;
+    
+    report_sink_puts(sink,
+                     "Hardware Configuration Details\n"
+                     "==============================\n\n");
+    
+    report_sink_printf(sink,
+                       "CPU Information:\n"
+                       "- Model: %s\n"
+                       "- Architecture: %s\n"
+                       "- Cores: %d physical, %d logical\n"
+                       "- Frequency: %.2f GHz\n"
+                       "- NUMA Nodes: %d\n\n",
+                       cache_info->cpu_model,
+                       cache_info->arch,
+                       cache_info->num_cores,
+                       cache_info->num_threads,
+                       cache_info->cpu_frequency_ghz,
+                       cache_info->numa_nodes);
+    
+    report_sink_puts(sink, "Cache Hierarchy:\n");
     
     for (int i = 0; i < cache_info->num_levels; i++) {
         const cache_level_t *level = &cache_info->levels[i];
-        n = snprintf(p, remaining,
-                    "- L%d %s Cache:\n"
-                    "  - Size: %zu KB\n"
-                    "  - Line Size: %zu bytes\n"
-                    "  - Associativity: %d-way\n"
-                    "  - Latency: ~%d cycles\n"
-                    "  - Shared: %s\n",
-                    level->level,
-                    level->type,
-                    level->size / 1024,
-                    level->line_size,
-                    level->associativity,
-                    level->latency_cycles,
-                    level->shared ? "Yes" : "No");
-        p += n; remaining -= n;
-    }
-    
-    n = snprintf(p, remaining,
-                "\nMemory Configuration:\n"
-                "- Total Memory: %.1f GB\n"
-                "- Page Size: %d KB\n"
-                "- Estimated Bandwidth: %zu GB/s\n",
-                cache_info->total_memory / (1024.0 * 1024 * 1024),
-                cache_info->page_size / 1024,
-                cache_info->memory_bandwidth_gbps);
-    
-    report_add_section(report, "Hardware Configuration", buffer, 90);
-    return 0;
+        report_sink_printf(sink,
+                           "- L%d %s Cache:\n"
+                           "  - Size: %zu KB\n"
+                           "  - Line Size: %zu bytes\n"
+                           "  - Associativity: %d-way\n"
+                           "  - Latency: ~%d cycles\n"
+                           "  - Shared: %s\n",
+                           level->level,
+                           level->type,
+                           level->size / 1024,
+                           level->line_size,
+                           level->associativity,
+                           level->latency_cycles,
+                           level->shared ? "Yes" : "No");
+    }
+    
+    report_sink_printf(sink,
+                       "\nMemory Configuration:\n"
+                       "- Total Memory: %.1f GB\n"
+                       "- Page Size: %d KB\n"
+                       "- Estimated Bandwidth: %zu GB/s\n",
+                       cache_info->total_memory / (1024.0 * 1024 * 1024),
+                       cache_info->page_size / 1024,
+                       cache_info->memory_bandwidth_gbps);
+    
+    return sink->failed ? -1 : 0;
+}
+
+// Generate hardware section
+int generate_hardware_section(report_t *report, const cache_info_t *cache_info) {
+    if (!report || !cache_info) return -1;
+    
+    return report_add_producer(report, "Hardware Configuration", 90,
+                               produce_hardware, cache_info, 0) ? 0 : -1;
 }
 
 // Generate HTML report
 int generate_html_report(const report_t *report, const char *output_file,
                         const report_config_t *config) {
-    FILE *fp = fopen(output_file, "w");
-    if (!fp) {
-        LOG_ERROR("Failed to open output file: %s", output_file);
-        return -1;
-    }
+    report_sink_t sink;
+    if (sink_open(&sink, output_file) != 0) return -1;
     
     // HTML header
-    fprintf(fp, "<!DOCTYPE html>\n<html>\n<head>\n");
-    fprintf(fp, "<meta charset=\"UTF-8\">\n");
-    fprintf(fp, "<title>%s</title>\n", report->title);
+    report_sink_puts(&sink, "<!DOCTYPE html>\n<html>\n<head>\n");
+    report_sink_puts(&sink, "<meta charset=\"UTF-8\">\n");
+    report_sink_printf(&sink, "<title>%s</title>\n", report->title);
     
     // Embedded CSS or link to external
     if (strlen(config->css_file) > 0) {
-        fprintf(fp, "<link rel=\"stylesheet\" href=\"%s\">\n", config->css_file);
+        report_sink_printf(&sink, "<link rel=\"stylesheet\" href=\"%s\">\n", config->css_file);
     } else {
         // Embed default CSS
-        fprintf(fp, "<style>\n");
-        fprintf(fp, "body { font-family: Arial, sans-serif; margin: 40px; "
-                   "background-color: #f5f5f5; }\n");
-        fprintf(fp, ".container { max-width: 1200px; margin: 0 auto; "
-                   "background-color: white; padding: 20px; box-shadow: 0 0 10px rgba(0,0,0,0.1); }\n");
-        fprintf(fp, "h1 { color: #333; border-bottom: 3px solid #007bff; padding-bottom: 10px; }\n");
-        fprintf(fp, "h2 { color: #555; margin-top: 30px; }\n");
-        fprintf(fp, ".summary { background-color: #e9ecef; padding: 15px; "
-                   "border-radius: 5px; margin-bottom: 20px; }\n");
-        fprintf(fp, ".critical { background-color: #f8d7da; color: #721c24; "
-                   "padding: 10px; border-radius: 5px; margin: 10px 0; }\n");
-        fprintf(fp, ".recommendation { background-color: #d4edda; color: #155724; "
-                   "padding: 10px; border-radius: 5px; margin: 10px 0; }\n");
-        fprintf(fp, "pre { background-color: #f8f9fa; padding: 10px; "
-                   "border: 1px solid #dee2e6; border-radius: 5px; overflow-x: auto; }\n");
-        fprintf(fp, "table { border-collapse: collapse; width: 100%%; margin: 15px 0; }\n");
-        fprintf(fp, "th, td { border: 1px solid #ddd; padding: 8px; text-align: left; }\n");
-        fprintf(fp, "th { background-color: #007bff; color: white; }\n");
-        fprintf(fp, "tr:nth-child(even) { background-color: #f2f2f2; }\n");
-        fprintf(fp, ".chart { margin: 20px 0; }\n");
-        fprintf(fp, "</style>\n");
-    }
-    
-    fprintf(fp, "</head>\n<body>\n<div class=\"container\">\n");
+        report_sink_puts(&sink,
+            "<style>\n"
+            "body { font-family: Arial, sans-serif; margin: 40px; "
+            "background-color: #f5f5f5; }\n"
+            ".container { max-width: 1200px; margin: 0 auto; "
+            "background-color: white; padding: 20px; box-shadow: 0 0 10px rgba(0,0,0,0.1); }\n"
+            "h1 { color: #333; border-bottom: 3px solid #007bff; padding-bottom: 10px; }\n"
+            "h2 { color: #555; margin-top: 30px; }\n"
+            ".summary { background-color: #e9ecef; padding: 15px; "
+            "border-radius: 5px; margin-bottom: 20px; }\n"
+            ".critical { background-color: #f8d7da; color: #721c24; "
+            "padding: 10px; border-radius: 5px; margin: 10px 0; }\n"
+            ".recommendation { background-color: #d4edda; color: #155724; "
+            "padding: 10px; border-radius: 5px; margin: 10px 0; }\n"
+            "pre { background-color: #f8f9fa; padding: 10px; "
+            "border: 1px solid #dee2e6; border-radius: 5px; overflow-x: auto; }\n"
+            "table { border-collapse: collapse; width: 100%; margin: 15px 0; }\n"
+            "th, td { border: 1px solid #ddd; padding: 8px; text-align: left; }\n"
+            "th { background-color: #007bff; color: white; }\n"
+            "tr:nth-child(even) { background-color: #f2f2f2; }\n"
+            ".chart { margin: 20px 0; }\n"
+            "</style>\n");
+    }
+    
+    report_sink_puts(&sink, "</head>\n<body>\n<div class=\"container\">\n");
     
     // Title and timestamp
-    fprintf(fp, "<h1>%s</h1>\n", report->title);
-    fprintf(fp, "<p>Generated: %s</p>\n", report->timestamp);
+    report_sink_printf(&sink, "<h1>%s</h1>\n", report->title);
+    report_sink_printf(&sink, "<p>Generated: %s</p>\n", report->timestamp);
     
-    // Summary
+    // Summary, newlines converted to <br> for HTML
     if (strlen(report->summary) > 0) {
-        fprintf(fp, "<div class=\"summary\">\n");
-        fprintf(fp, "<h2>Summary</h2>\n");
+        report_sink_puts(&sink, "<div class=\"summary\">\n");
+        report_sink_puts(&sink, "<h2>Summary</h2>\n");
         
-        // Convert newlines to <br> for HTML
-        char *summary = strdup(report->summary);
-        char *line = strtok(summary, "\n");
-        while (line) {
-            fprintf(fp, "%s<br>\n", line);
-            line = strtok(NULL, "\n");
+        const char *line = report->summary;
+        while (*line) {
+            size_t len = strcspn(line, "\n");
+            if (len > 0) {
+                report_sink_write(&sink, line, len);
+                report_sink_puts(&sink, "<br>\n");
+            }
+            line += len;
+            if (*line == '\n') line++;
         }
-        free(summary);
         
-        fprintf(fp, "</div>\n");
+        report_sink_puts(&sink, "</div>\n");
     }
     
-    // Sections
+    // Sections stream through the line converter (simple text to HTML)
     for (int i = 0; i < report->section_count; i++) {
-        report_section_t *section = &report->sections[i];
-        
-        fprintf(fp, "<div class=\"section%s\">\n",
-                section->is_critical ? " critical" : "");
-        fprintf(fp, "<h2>%s</h2>\n", section->title);
+        const report_section_t *section = &report->sections[i];
         
-        // Convert content (simple text to HTML)
-        char *content = strdup(section->content);
-        char *line = strtok(content, "\n");
-        bool in_code = false;
-        
-        while (line) {
-            // Simple code detection
-            if (strstr(line, "```") || strstr(line, "//") || strstr(line, "/*")) {
-                if (!in_code) {
-                    fprintf(fp, "<pre>");
-                    in_code = true;
-                }
-                fprintf(fp, "%s\n", line);
-            } else if (in_code && strlen(line) == 0) {
-                fprintf(fp, "</pre>\n");
-                in_code = false;
-            } else if (in_code) {
-                fprintf(fp, "%s\n", line);
-            } else {
-                fprintf(fp, "<p>%s</p>\n", line);
-            }
-            
-            line = strtok(NULL, "\n");
-        }
+        report_sink_printf(&sink, "<div class=\"section%s\">\n",
+                           section->is_critical ? " critical" : "");
+        report_sink_printf(&sink, "<h2>%s</h2>\n", section->title);
         
-        if (in_code) {
-            fprintf(fp, "</pre>\n");
-        }
+        sink_set_escape(&sink, REPORT_ESCAPE_HTML_LINES);
+        section->produce(&sink, section);
+        sink_set_escape(&sink, REPORT_ESCAPE_NONE);
         
-        free(content);
-        fprintf(fp, "</div>\n");
+        report_sink_puts(&sink, "</div>\n");
     }
     
     // Footer
-    fprintf(fp, "<hr>\n");
-    fprintf(fp, "<p><small>Generated by Cache Optimizer Tool</small></p>\n");
-    fprintf(fp, "</div>\n</body>\n</html>\n");
+    report_sink_puts(&sink, "<hr>\n");
+    report_sink_puts(&sink, "<p><small>Generated by Cache Optimizer Tool</small></p>\n");
+    report_sink_puts(&sink, "</div>\n</body>\n</html>\n");
     
-    fclose(fp);
-    return 0;
+    return sink_close(&sink);
+}
+
+// Write a JSON string value through the escaping sink
+static void sink_json_string(report_sink_t *sink, const char *str) {
+    sink_raw_str(sink, "\"");
+    sink_set_escape(sink, REPORT_ESCAPE_JSON);
+    report_sink_puts(sink, str);
+    sink_set_escape(sink, REPORT_ESCAPE_NONE);
+    sink_raw_str(sink, "\"");
 }
 
 // Generate JSON report - use config parameter
 int generate_json_report(const report_t *report, const char *output_file,
                         const report_config_t *config) {
-    FILE *fp = fopen(output_file, "w");
-    if (!fp) {
-        LOG_ERROR("Failed to open output file: %s", output_file);
-        return -1;
-    }
+    report_sink_t sink;
+    if (sink_open(&sink, output_file) != 0) return -1;
     
-    fprintf(fp, "{\n");
-    fprintf(fp, "  \"title\": \"%s\",\n", report->title);
-    fprintf(fp, "  \"timestamp\": \"%s\",\n", report->timestamp);
-    fprintf(fp, "  \"summary\": \"%s\",\n", report->summary);
+    report_sink_puts(&sink, "{\n  \"title\": ");
+    sink_json_string(&sink, report->title);
+    report_sink_puts(&sink, ",\n  \"timestamp\": ");
+    sink_json_string(&sink, report->timestamp);
+    report_sink_puts(&sink, ",\n  \"summary\": ");
+    sink_json_string(&sink, report->summary);
+    report_sink_puts(&sink, ",\n");
     
     // Include metadata if verbose
     if (config && config->verbose) {
-        fprintf(fp, "  \"format_version\": \"1.0\",\n");
-        fprintf(fp, "  \"section_count\": %d,\n", report->section_count);
+        report_sink_puts(&sink, "  \"format_version\": \"1.0\",\n");
+        report_sink_printf(&sink, "  \"section_count\": %d,\n", report->section_count);
     }
     
-    fprintf(fp, "  \"sections\": [\n");
+    report_sink_puts(&sink, "  \"sections\": [\n");
     
     for (int i = 0; i < report->section_count; i++) {
-        report_section_t *section = &report->sections[i];
+        const report_section_t *section = &report->sections[i];
         
-        fprintf(fp, "    {\n");
-        fprintf(fp, "      \"title\": \"%s\",\n", section->title);
-        fprintf(fp, "      \"priority\": %d,\n", section->priority);
-        fprintf(fp, "      \"is_critical\": %s,\n", 
-                section->is_critical ? "true" : "false");
+        report_sink_puts(&sink, "    {\n      \"title\": ");
+        sink_json_string(&sink, section->title);
+        report_sink_printf(&sink, ",\n      \"priority\": %d,\n", section->priority);
+        report_sink_printf(&sink, "      \"is_critical\": %s,\n",
+                           section->is_critical ? "true" : "false");
         
-        // Escape content for JSON
-        fprintf(fp, "      \"content\": \"");
-        for (const char *p = section->content; *p; p++) {
-            switch (*p) {
-                case '"': fprintf(fp, "\\\""); break;
-                case '\\': fprintf(fp, "\\\\"); break;
-                case '\n': fprintf(fp, "\\n"); break;
-                case '\r': fprintf(fp, "\\r"); break;
-                case '\t': fprintf(fp, "\\t"); break;
-                default: fputc(*p, fp);
-            }
-        }
-        fprintf(fp, "\"\n");
+        // Content is escaped as the producer writes it
+        report_sink_puts(&sink, "      \"content\": \"");
+        sink_set_escape(&sink, REPORT_ESCAPE_JSON);
+        section->produce(&sink, section);
+        sink_set_escape(&sink, REPORT_ESCAPE_NONE);
+        report_sink_puts(&sink, "\"\n");
         
-        fprintf(fp, "    }%s\n", i < report->section_count - 1 ? "," : "");
+        report_sink_printf(&sink, "    }%s\n", i < report->section_count - 1 ? "," : "");
     }
     
-    fprintf(fp, "  ]\n");
-    fprintf(fp, "}\n");
+    report_sink_puts(&sink, "  ]\n");
+    report_sink_puts(&sink, "}\n");
     
-    fclose(fp);
-    return 0;
+    return sink_close(&sink);
+}
+
+// Underline a heading with the given character
+static void sink_underline(report_sink_t *sink, const char *title, char ch) {
+    for (size_t i = 0; title[i]; i++) {
+        sink_raw(sink, &ch, 1);
+    }
+    sink_raw_str(sink, "\n");
 }
 
 // Generate text report - use config parameter
 int generate_text_report(const report_t *report, const char *output_file,
                         const report_config_t *config) {
-    FILE *fp = fopen(output_file, "w");
-    if (!fp) {
-        LOG_ERROR("Failed to open output file: %s", output_file);
-        return -1;
-    }
+    report_sink_t sink;
+    if (sink_open(&sink, output_file) != 0) return -1;
     
     // Header
-    fprintf(fp, "%s\n", report->title);
-    for (size_t i = 0; i < strlen(report->title); i++) {
-        fprintf(fp, "=");
-    }
-    fprintf(fp, "\n\n");
+    report_sink_printf(&sink, "%s\n", report->title);
+    sink_underline(&sink, report->title, '=');
+    report_sink_puts(&sink, "\n");
     
-    fprintf(fp, "Generated: %s\n\n", report->timestamp);
+    report_sink_printf(&sink, "Generated: %s\n\n", report->timestamp);
     
     // Summary
     if (strlen(report->summary) > 0) {
-        fprintf(fp, "SUMMARY\n");
-        fprintf(fp, "-------\n");
-        fprintf(fp, "%s\n\n", report->summary);
+        report_sink_puts(&sink, "SUMMARY\n");
+        report_sink_puts(&sink, "-------\n");
+        report_sink_printf(&sink, "%s\n\n", report->summary);
     }
     
     // Sections
     for (int i = 0; i < report->section_count; i++) {
-        report_section_t *section = &report->sections[i];
+        const report_section_t *section = &report->sections[i];
         
-        fprintf(fp, "\n%s\n", section->title);
-        for (size_t j = 0; j < strlen(section->title); j++) {
-            fprintf(fp, "-");
-        }
-        fprintf(fp, "\n\n");
+        report_sink_printf(&sink, "\n%s\n", section->title);
+        sink_underline(&sink, section->title, '-');
+        report_sink_puts(&sink, "\n");
         
         if (section->is_critical) {
-            fprintf(fp, "*** CRITICAL ***\n\n");
+            report_sink_puts(&sink, "*** CRITICAL ***\n\n");
         }
         
-        fprintf(fp, "%s\n", section->content);
+        section->produce(&sink, section);
+        report_sink_puts(&sink, "\n");
         
         // Include raw data if configured
         if (config && config->include_raw_data) {
-            fprintf(fp, "\n[Priority: %d]\n", section->priority);
+            report_sink_printf(&sink, "\n[Priority: %d]\n", section->priority);
         }
     }
     
-    fclose(fp);
-    return 0;
+    return sink_close(&sink);
 }
 
 // Get default configuration
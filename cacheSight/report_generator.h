@@ -28,13 +28,47 @@ typedef struct {
     char template_file[256];      // Custom template
 } report_config_t;
 
-// Report sections
+// Buffered output sink; writes collect in a fixed chunk that is flushed to the
+// file when full, so memory stays flat however long the report grows
+#define REPORT_SINK_CHUNK 16384
+#define REPORT_SINK_LINE 4096
+
+// Escaping applied to section bodies as they stream through the sink
+typedef enum {
+    REPORT_ESCAPE_NONE,
+    REPORT_ESCAPE_JSON,             // Quote and control characters escaped
+    REPORT_ESCAPE_HTML_LINES        // Lines wrapped in <p>, code lines in <pre>
+} report_escape_t;
+
 typedef struct {
+    FILE *fp;
+    char chunk[REPORT_SINK_CHUNK];
+    size_t used;
+    report_escape_t escape;
+    char line[REPORT_SINK_LINE];    // Pending line for REPORT_ESCAPE_HTML_LINES
+    size_t line_len;
+    bool in_code;
+    bool failed;                    // A write to the file failed
+    size_t bytes_written;
+} report_sink_t;
+
+typedef struct report_section report_section_t;
+
+// Section producers write their body through the sink when the report is emitted
+typedef int (*report_producer_t)(report_sink_t *sink, const report_section_t *section);
+
+// Report sections
+struct report_section {
     char title[128];
-    char content[65536];          // Large buffer for content
     int priority;                 // Display priority
     bool is_critical;            // Critical section
-} report_section_t;
+    int sequence;                // Insertion order, breaks priority ties
+    report_producer_t produce;
+    const void *data;            // Producer input; must outlive the report
+    int count;
+    bool include_source;
+    char *content;               // Owned copy for fixed-text sections
+};
 
 // Complete report
 typedef struct {
@@ -46,6 +80,25 @@ typedef struct {
     int section_capacity;
 } report_t;
 
+// Inputs the source annotation view joins; must outlive the report
+typedef struct {
+    const cache_hotspot_t *hotspots;
+    int hotspot_count;
+    const classified_pattern_t *patterns;
+    int pattern_count;
+    const analysis_results_t *static_results;
+    int max_files;                  // Hottest files to annotate
+} annotation_input_t;
+
+// Inputs of the visualizations; samples are read from the hotspots
+typedef struct {
+    const cache_hotspot_t *hotspots;
+    int hotspot_count;
+    const classified_pattern_t *patterns;
+    int pattern_count;
+    int max_timelines;              // Hotspots that get a miss-rate timeline
+} chart_input_t;
+
 // API functions
 report_t* report_create(const char *title);
 void report_destroy(report_t *report);
@@ -53,8 +106,24 @@ void report_destroy(report_t *report);
 // Add sections
 int report_add_section(report_t *report, const char *title, 
                       const char *content, int priority);
+report_section_t* report_add_producer(report_t *report, const char *title, int priority,
+                                      report_producer_t produce, const void *data, int count);
 int report_add_summary(report_t *report, const char *summary);
 
+// Write section bodies; output passes through the sink's current escaping
+int report_sink_write(report_sink_t *sink, const char *data, size_t len);
+int report_sink_puts(report_sink_t *sink, const char *str);
+// Literal text such as source code; markup characters are escaped for HTML
+int report_sink_write_text(report_sink_t *sink, const char *data, size_t len);
+// Markup that bypasses the HTML line conversion; dropped by other formats
+int report_sink_markup(report_sink_t *sink, const char *data, size_t len);
+bool report_sink_is_html(const report_sink_t *sink);
+int report_sink_printf(report_sink_t *sink, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// Order sections by descending priority, keeping insertion order within a priority
+void report_sort_sections(report_t *report);
+
 // Generate report from analysis results
 int generate_report(const report_config_t *config,
                    const char *output_file,
@@ -86,6 +155,12 @@ int generate_pattern_section(report_t *report,
 int generate_recommendation_section(report_t *report,
                                    const optimization_rec_t *recs, int count);
 
+// Every line of each hot file with its misses, latency and pattern tags
+int generate_annotation_section(report_t *report, const annotation_input_t *input);
+
+// Address x time heatmap, per-hotspot timelines and a flame graph (report_charts.c)
+int generate_visualization_section(report_t *report, const chart_input_t *input);
+
 // Format-specific generators
 int generate_html_report(const report_t *report, const char *output_file,
                         const report_config_t *config);
@@ -1,10 +1,13 @@
 #include "sample_collector.h"
+#include "stage_trace.h"
 #include <stdlib.h>
 
 // Hash table entry for hotspot lookup
 typedef struct hotspot_entry {
     uint64_t key;                   // Hash key (instruction address or function)
     cache_hotspot_t hotspot;        // Hotspot data
+    size_t pending;                 // Samples counted but not yet copied in
+    double latency_sum;
     struct hotspot_entry *next;     // Next entry in chain
 } hotspot_entry_t;
 
@@ -18,10 +21,21 @@ struct sample_collector {
     size_t table_size;
     size_t hotspot_count;
     
-    // Raw samples buffer
-    cache_miss_sample_t *all_samples;
+    // Raw samples: the collector's own buffer or a block attached by the caller
+    const cache_miss_sample_t *all_samples;
     size_t all_samples_count;
-    size_t all_samples_capacity;
+    size_t processed_count;         // Samples already aggregated
+    cache_miss_sample_t *sample_buffer;
+    size_t sample_buffer_capacity;
+    
+    // Every hotspot's samples in one block, behind room for the hotspot
+    // array so sample_collector_take_hotspots can hand it over whole
+    char *hotspot_block;
+    bool hotspots_taken;            // Block moved out; only destroy is left
+    
+    // Hotspot entries; released together, never one by one
+    arena_t *arena;
+    bool owns_arena;
     
     // Statistics
     collector_stats_t stats;
@@ -53,6 +67,16 @@ sample_collector_t* sample_collector_create(const collector_config_t *config,
     collector->cache_info = *cache_info;
     pthread_mutex_init(&collector->mutex, NULL);
     
+    collector->arena = config->arena;
+    if (!collector->arena) {
+        collector->arena = arena_create(0);
+        collector->owns_arena = true;
+        if (!collector->arena) {
+            sample_collector_destroy(collector);
+            return NULL;
+        }
+    }
+    
     // Initialize hash table
     collector->table_size = config->max_hotspots * 4;  // 4x for lower load factor
     collector->hotspot_table = CALLOC_LOGGED(collector->table_size, sizeof(hotspot_entry_t*));
@@ -62,16 +86,6 @@ sample_collector_t* sample_collector_create(const collector_config_t *config,
         return NULL;
     }
     
-    // Initialize sample buffer
-    collector->all_samples_capacity = 10000;
-    collector->all_samples = CALLOC_LOGGED(collector->all_samples_capacity,
-                                           sizeof(cache_miss_sample_t));
-    if (!collector->all_samples) {
-        LOG_ERROR("Failed to allocate sample buffer");
-        sample_collector_destroy(collector);
-        return NULL;
-    }
-    
     LOG_INFO("Created sample collector with table size %zu", collector->table_size);
     return collector;
 }
@@ -82,30 +96,75 @@ void sample_collector_destroy(sample_collector_t *collector) {
     
     LOG_INFO("Destroying sample collector");
     
-    // Free hash table entries
+    // Entries live in the arena; a borrowed arena is released by its phase
     if (collector->hotspot_table) {
-        for (size_t i = 0; i < collector->table_size; i++) {
-            hotspot_entry_t *entry = collector->hotspot_table[i];
-            while (entry) {
-                hotspot_entry_t *next = entry->next;
-                if (entry->hotspot.samples) {
-                    FREE_LOGGED(entry->hotspot.samples);
-                }
-                FREE_LOGGED(entry);
-                entry = next;
-            }
-        }
         FREE_LOGGED(collector->hotspot_table);
     }
+    if (collector->owns_arena) {
+        arena_destroy(collector->arena);
+    }
     
-    if (collector->all_samples) {
-        FREE_LOGGED(collector->all_samples);
+    if (collector->sample_buffer) {
+        FREE_LOGGED(collector->sample_buffer);
+    }
+    if (collector->hotspot_block) {
+        FREE_LOGGED(collector->hotspot_block);
     }
     
     pthread_mutex_destroy(&collector->mutex);
     FREE_LOGGED(collector);
 }
 
+// Make the unaggregated samples collector-owned with room for extra more.
+// Aggregated samples are never read again, so they are dropped.
+static int reserve_samples(sample_collector_t *collector, size_t extra) {
+    size_t pending = collector->all_samples_count - collector->processed_count;
+    bool borrowed = collector->all_samples && collector->all_samples != collector->sample_buffer;
+    
+    size_t capacity = collector->sample_buffer_capacity ? collector->sample_buffer_capacity : 10000;
+    while (capacity < pending + extra) {
+        capacity *= 2;
+    }
+    if (capacity != collector->sample_buffer_capacity) {
+        cache_miss_sample_t *new_buffer = realloc(collector->sample_buffer,
+                                                  capacity * sizeof(cache_miss_sample_t));
+        if (!new_buffer) {
+            LOG_ERROR("Failed to grow sample buffer");
+            return -1;
+        }
+        if (!borrowed) {
+            collector->all_samples = new_buffer;
+        }
+        collector->sample_buffer = new_buffer;
+        collector->sample_buffer_capacity = capacity;
+        LOG_DEBUG("Grew sample buffer to %zu", capacity);
+    }
+    
+    if (pending > 0 && (borrowed || collector->processed_count > 0)) {
+        memmove(collector->sample_buffer, collector->all_samples + collector->processed_count,
+                pending * sizeof(cache_miss_sample_t));
+    }
+    collector->all_samples = collector->sample_buffer;
+    collector->all_samples_count = pending;
+    collector->processed_count = 0;
+    return 0;
+}
+
+// Caller holds the mutex
+static int append_samples(sample_collector_t *collector,
+                          const cache_miss_sample_t *samples, int count) {
+    if (reserve_samples(collector, count) != 0) {
+        return -1;
+    }
+    
+    // Copy samples
+    memcpy(&collector->sample_buffer[collector->all_samples_count],
+           samples, count * sizeof(cache_miss_sample_t));
+    collector->all_samples_count += count;
+    collector->stats.total_samples_processed += count;
+    return 0;
+}
+
 // Add samples to collector
 int sample_collector_add_samples(sample_collector_t *collector,
                                 const cache_miss_sample_t *samples, int count) {
@@ -117,32 +176,39 @@ int sample_collector_add_samples(sample_collector_t *collector,
     LOG_INFO("Adding %d samples to collector", count);
     
     pthread_mutex_lock(&collector->mutex);
+    int ret = append_samples(collector, samples, count);
+    pthread_mutex_unlock(&collector->mutex);
     
-    // Grow buffer if needed
-    while (collector->all_samples_count + count > collector->all_samples_capacity) {
-        size_t new_capacity = collector->all_samples_capacity * 2;
-        cache_miss_sample_t *new_buffer = realloc(collector->all_samples,
-                                                  new_capacity * sizeof(cache_miss_sample_t));
-        if (!new_buffer) {
-            LOG_ERROR("Failed to grow sample buffer");
-            pthread_mutex_unlock(&collector->mutex);
-            return -1;
-        }
-        collector->all_samples = new_buffer;
-        collector->all_samples_capacity = new_capacity;
-        LOG_DEBUG("Grew sample buffer to %zu", new_capacity);
+    LOG_INFO("Total samples in collector: %llu",
+             (unsigned long long)collector->stats.total_samples_processed);
+    return ret;
+}
+
+// Aggregate the caller's block where it is instead of copying it in
+int sample_collector_attach_samples(sample_collector_t *collector,
+                                   const cache_miss_sample_t *samples, int count) {
+    if (!collector || !samples || count <= 0) {
+        LOG_ERROR("Invalid parameters for sample_collector_attach_samples");
+        return -1;
     }
     
-    // Copy samples
-    memcpy(&collector->all_samples[collector->all_samples_count],
-           samples, count * sizeof(cache_miss_sample_t));
-    collector->all_samples_count += count;
-    collector->stats.total_samples_processed += count;
+    pthread_mutex_lock(&collector->mutex);
     
-    pthread_mutex_unlock(&collector->mutex);
+    int ret = 0;
+    if (collector->processed_count < collector->all_samples_count) {
+        // Unaggregated samples are waiting; one view cannot span both blocks
+        LOG_DEBUG("Collector has pending samples, copying %d attached samples", count);
+        ret = append_samples(collector, samples, count);
+    } else {
+        collector->all_samples = samples;
+        collector->all_samples_count = count;
+        collector->processed_count = 0;
+        collector->stats.total_samples_processed += count;
+        LOG_INFO("Attached %d samples to collector", count);
+    }
     
-    LOG_INFO("Total samples in collector: %zu", collector->all_samples_count);
-    return 0;
+    pthread_mutex_unlock(&collector->mutex);
+    return ret;
 }
 
 // Add single sample
@@ -151,20 +217,32 @@ int sample_collector_add_sample(sample_collector_t *collector,
     return sample_collector_add_samples(collector, sample, 1);
 }
 
+// Key of a sample's hotspot for the configured aggregation mode
+static uint64_t sample_key(const sample_collector_t *collector, const cache_miss_sample_t *sample) {
+    if (collector->config.aggregate_by_function) {
+        // Aggregate by function (simplified - would need symbol table)
+        return sample->instruction_addr & ~0xFFFULL;  // Align to 4KB
+    }
+    return sample->instruction_addr;
+}
+
+static hotspot_entry_t* find_hotspot(const sample_collector_t *collector, uint64_t key) {
+    hotspot_entry_t *entry = collector->hotspot_table[hash_address(key, collector->table_size)];
+    while (entry && entry->key != key) {
+        entry = entry->next;
+    }
+    return entry;
+}
+
 // Find or create hotspot entry
 static hotspot_entry_t* find_or_create_hotspot(sample_collector_t *collector,
                                                uint64_t key,
                                                const source_location_t *location) {
-    uint64_t hash = hash_address(key, collector->table_size);
-    hotspot_entry_t *entry = collector->hotspot_table[hash];
-    
-    // Search for existing entry
-    while (entry) {
-        if (entry->key == key) {
-            return entry;
-        }
-        entry = entry->next;
+    hotspot_entry_t *entry = find_hotspot(collector, key);
+    if (entry) {
+        return entry;
     }
+    uint64_t hash = hash_address(key, collector->table_size);
     
     // Create new entry
     if (collector->hotspot_count >= collector->config.max_hotspots) {
@@ -172,7 +250,8 @@ static hotspot_entry_t* find_or_create_hotspot(sample_collector_t *collector,
         return NULL;
     }
     
-    entry = CALLOC_LOGGED(1, sizeof(hotspot_entry_t));
+    // Samples are sized once their count is known, see sample_collector_process
+    entry = arena_calloc(collector->arena, 1, sizeof(hotspot_entry_t));
     if (!entry) {
         LOG_ERROR("Failed to allocate hotspot entry");
         return NULL;
@@ -180,13 +259,6 @@ static hotspot_entry_t* find_or_create_hotspot(sample_collector_t *collector,
     
     entry->key = key;
     entry->hotspot.location = *location;
-    entry->hotspot.sample_capacity = 100;
-    entry->hotspot.samples = CALLOC_LOGGED(entry->hotspot.sample_capacity,
-                                           sizeof(cache_miss_sample_t));
-    if (!entry->hotspot.samples) {
-        FREE_LOGGED(entry);
-        return NULL;
-    }
     
     // Add to hash table
     entry->next = collector->hotspot_table[hash];
@@ -205,38 +277,33 @@ int sample_collector_process(sample_collector_t *collector) {
         LOG_ERROR("NULL collector in sample_collector_process");
         return -1;
     }
-    
-    LOG_INFO("Processing %zu samples into hotspots", collector->all_samples_count);
+    TRACE_SCOPE(trace, "collector.process");
     
     pthread_mutex_lock(&collector->mutex);
     
-    // Process each sample
-    for (size_t i = 0; i < collector->all_samples_count; i++) {
-        cache_miss_sample_t *sample = &collector->all_samples[i];
-        
-        // Determine key based on aggregation mode
-        uint64_t key;
-        if (collector->config.aggregate_by_function) {
-            // Aggregate by function (simplified - would need symbol table)
-            key = sample->instruction_addr & ~0xFFFULL;  // Align to 4KB
-        } else {
-            // Aggregate by instruction
-            key = sample->instruction_addr;
-        }
+    if (collector->hotspots_taken) {
+        pthread_mutex_unlock(&collector->mutex);
+        LOG_ERROR("Hotspots were taken from this collector");
+        return -1;
+    }
+    
+    size_t first = collector->processed_count;
+    size_t last = collector->all_samples_count;
+    trace_add_items(&trace, last - first);
+    LOG_INFO("Processing %zu samples into hotspots", last - first);
+    
+    // Pass 1: statistics, and how many samples each hotspot gains
+    for (size_t i = first; i < last; i++) {
+        const cache_miss_sample_t *sample = &collector->all_samples[i];
         
-        // Find or create hotspot
-        hotspot_entry_t *entry = find_or_create_hotspot(collector, key, 
+        hotspot_entry_t *entry = find_or_create_hotspot(collector, sample_key(collector, sample),
                                                         &sample->source_loc);
         if (!entry) continue;
         
         cache_hotspot_t *hotspot = &entry->hotspot;
         
-        // Update hotspot statistics
-        hotspot->total_misses++;
-        hotspot->total_accesses++;  // Simplified - assumes miss = access
-        
         // Update address range
-        if (hotspot->sample_count == 0) {
+        if (hotspot->total_misses == 0) {
             hotspot->address_range_start = sample->memory_addr;
             hotspot->address_range_end = sample->memory_addr;
         } else {
@@ -248,34 +315,70 @@ int sample_collector_process(sample_collector_t *collector) {
             }
         }
         
+        // Update hotspot statistics
+        hotspot->total_misses++;
+        hotspot->total_accesses++;  // Simplified - assumes miss = access
+        
         // Update cache level statistics
         if (sample->cache_level_missed >= 1 && sample->cache_level_missed <= 4) {
             hotspot->cache_levels_affected[sample->cache_level_missed - 1]++;
         }
         
-        // Add sample to hotspot
-        if (hotspot->sample_count < hotspot->sample_capacity) {
-            // Grow if needed
-            if (hotspot->sample_count == hotspot->sample_capacity) {
-                size_t new_capacity = hotspot->sample_capacity * 2;
-                cache_miss_sample_t *new_samples = realloc(hotspot->samples,
-                    new_capacity * sizeof(cache_miss_sample_t));
-                if (new_samples) {
-                    hotspot->samples = new_samples;
-                    hotspot->sample_capacity = new_capacity;
+        entry->latency_sum += sample->latency_cycles;
+        entry->pending++;
+    }
+    
+    // Lay every hotspot's samples out in one exact-size block; hotspots that
+    // gained nothing move over too, since the previous block is released
+    size_t header = collector->hotspot_count * sizeof(cache_hotspot_t);
+    size_t total = 0;
+    for (size_t t = 0; t < collector->table_size; t++) {
+        for (hotspot_entry_t *entry = collector->hotspot_table[t]; entry; entry = entry->next) {
+            total += entry->hotspot.sample_count + entry->pending;
+        }
+    }
+    
+    char *block = last > first ? MALLOC_LOGGED(header + total * sizeof(cache_miss_sample_t)) : NULL;
+    if (block) {
+        cache_miss_sample_t *next = (cache_miss_sample_t *)(block + header);
+        for (size_t t = 0; t < collector->table_size; t++) {
+            for (hotspot_entry_t *entry = collector->hotspot_table[t]; entry; entry = entry->next) {
+                cache_hotspot_t *hotspot = &entry->hotspot;
+                if (hotspot->sample_count > 0) {
+                    memcpy(next, hotspot->samples, hotspot->sample_count * sizeof(cache_miss_sample_t));
                 }
+                hotspot->samples = next;
+                hotspot->sample_capacity = hotspot->sample_count + entry->pending;
+                next += hotspot->sample_capacity;
             }
-            
-            if (hotspot->sample_count < hotspot->sample_capacity) {
-                hotspot->samples[hotspot->sample_count++] = *sample;
+        }
+        if (collector->hotspot_block) {
+            FREE_LOGGED(collector->hotspot_block);
+        }
+        collector->hotspot_block = block;
+    } else if (last > first) {
+        LOG_ERROR("Failed to allocate %zu samples for hotspots", total);
+    }
+    
+    // Pass 2: copy the samples in
+    for (size_t i = first; i < last; i++) {
+        const cache_miss_sample_t *sample = &collector->all_samples[i];
+        hotspot_entry_t *entry = find_hotspot(collector, sample_key(collector, sample));
+        if (entry && entry->hotspot.sample_count < entry->hotspot.sample_capacity) {
+            entry->hotspot.samples[entry->hotspot.sample_count++] = *sample;
+        }
+    }
+    
+    for (size_t t = 0; t < collector->table_size; t++) {
+        for (hotspot_entry_t *entry = collector->hotspot_table[t]; entry; entry = entry->next) {
+            if (entry->pending == 0) continue;
+            entry->pending = 0;
+            if (entry->hotspot.sample_count > 0) {
+                entry->hotspot.avg_latency_cycles = entry->latency_sum / entry->hotspot.sample_count;
             }
         }
-        
-        // Update latency
-        hotspot->avg_latency_cycles = 
-            (hotspot->avg_latency_cycles * (hotspot->sample_count - 1) + 
-             sample->latency_cycles) / hotspot->sample_count;
     }
+    collector->processed_count = last;
     
     // Calculate miss rates and detect patterns
     sample_collector_analyze_patterns(collector);
@@ -369,6 +472,96 @@ int sample_collector_analyze_patterns(sample_collector_t *collector) {
     return 0;
 }
 
+static int compare_samples_by_thread_time(const void *a, const void *b) {
+    const cache_miss_sample_t *sa = (const cache_miss_sample_t *)a;
+    const cache_miss_sample_t *sb = (const cache_miss_sample_t *)b;
+    if (sa->tid != sb->tid) return sa->tid < sb->tid ? -1 : 1;
+    return sa->timestamp < sb->timestamp ? -1 : sa->timestamp > sb->timestamp;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return da < db ? -1 : da > db;
+}
+
+static uint64_t gcd_u64(uint64_t a, uint64_t b) {
+    while (b) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Stride in bytes: sampled addresses are whole strides apart, so their
+// differences share the stride as a divisor. Static hotspots carry the
+// element stride and are assumed to walk 8-byte elements.
+int estimate_hotspot_stride_bytes(const cache_hotspot_t *hotspot) {
+    if (!hotspot) return 0;
+    
+    if (hotspot->sample_count >= 2) {
+        uint64_t stride = 0;
+        for (size_t i = 1; i < hotspot->sample_count; i++) {
+            uint64_t a = hotspot->samples[i - 1].memory_addr;
+            uint64_t b = hotspot->samples[i].memory_addr;
+            uint64_t delta = a > b ? a - b : b - a;
+            if (delta > 0 && delta < 65536) stride = gcd_u64(stride, delta);
+        }
+        if (stride > 0) return (int)stride;
+    }
+    
+    return hotspot->access_stride > 0 ? hotspot->access_stride * 8 : 8;
+}
+
+// Cycles per loop iteration from consecutive samples of one thread: the address
+// advance divided by the stride gives the iterations between them
+double estimate_hotspot_cycles_per_iteration(const cache_hotspot_t *hotspot, double cpu_ghz) {
+    if (!hotspot || hotspot->sample_count < 4 || cpu_ghz <= 0) return 0;
+    
+    size_t count = hotspot->sample_count;
+    cache_miss_sample_t *ordered = MALLOC_LOGGED(count * sizeof(cache_miss_sample_t));
+    double *estimates = MALLOC_LOGGED(count * sizeof(double));
+    if (!ordered || !estimates) {
+        if (ordered) FREE_LOGGED(ordered);
+        if (estimates) FREE_LOGGED(estimates);
+        return 0;
+    }
+    
+    memcpy(ordered, hotspot->samples, count * sizeof(cache_miss_sample_t));
+    qsort(ordered, count, sizeof(cache_miss_sample_t), compare_samples_by_thread_time);
+    
+    uint64_t stride = (uint64_t)estimate_hotspot_stride_bytes(hotspot);
+    int estimate_count = 0;
+    
+    for (size_t i = 1; i < count; i++) {
+        const cache_miss_sample_t *prev = &ordered[i - 1];
+        const cache_miss_sample_t *cur = &ordered[i];
+        if (cur->tid != prev->tid || cur->timestamp <= prev->timestamp ||
+            cur->memory_addr <= prev->memory_addr) {
+            continue;  // New thread, or the loop restarted
+        }
+        
+        double iterations = (double)(cur->memory_addr - prev->memory_addr) / stride;
+        if (iterations < 1.0) continue;
+        
+        estimates[estimate_count++] = (cur->timestamp - prev->timestamp) * cpu_ghz / iterations;
+    }
+    
+    double cycles = 0;
+    if (estimate_count >= 3) {
+        qsort(estimates, estimate_count, sizeof(double), compare_doubles);
+        cycles = estimates[estimate_count / 2];
+    }
+    
+    FREE_LOGGED(ordered);
+    FREE_LOGGED(estimates);
+    
+    LOG_DEBUG("Hotspot %s:%d: %.2f cycles/iteration from %d sample pairs",
+              hotspot->location.file, hotspot->location.line, cycles, estimate_count);
+    return cycles;
+}
+
 // Detect false sharing
 int sample_collector_detect_false_sharing(sample_collector_t *collector) {
     if (!collector) return -1;
@@ -434,7 +627,12 @@ int sample_collector_detect_false_sharing(sample_collector_t *collector) {
     return false_sharing_count;
 }
 
-// Get hotspots
+static bool is_significant(const sample_collector_t *collector, const hotspot_entry_t *entry) {
+    return (int)entry->hotspot.sample_count >= collector->config.min_samples_per_hotspot &&
+           entry->hotspot.miss_rate >= collector->config.hotspot_threshold;
+}
+
+// Get hotspots: a copy in one allocation, the array followed by the samples
 int sample_collector_get_hotspots(sample_collector_t *collector,
                                  cache_hotspot_t **hotspots, int *count) {
     if (!collector || !hotspots || !count) {
@@ -444,65 +642,63 @@ int sample_collector_get_hotspots(sample_collector_t *collector,
     
     pthread_mutex_lock(&collector->mutex);
     
-    // Count significant hotspots
+    *hotspots = NULL;
+    *count = 0;
+    if (collector->hotspots_taken) {
+        pthread_mutex_unlock(&collector->mutex);
+        LOG_ERROR("Hotspots were taken from this collector");
+        return -1;
+    }
+    
+    // Count significant hotspots and their samples
     int hotspot_count = 0;
+    size_t sample_total = 0;
     for (size_t i = 0; i < collector->table_size; i++) {
-        hotspot_entry_t *entry = collector->hotspot_table[i];
-        while (entry) {
-            if ((int)entry->hotspot.sample_count >= collector->config.min_samples_per_hotspot &&
-                entry->hotspot.miss_rate >= collector->config.hotspot_threshold) {
+        for (hotspot_entry_t *entry = collector->hotspot_table[i]; entry; entry = entry->next) {
+            if (is_significant(collector, entry)) {
                 hotspot_count++;
+                sample_total += entry->hotspot.sample_count;
             }
-            entry = entry->next;
         }
     }
     
     if (hotspot_count == 0) {
-        *hotspots = NULL;
-        *count = 0;
         pthread_mutex_unlock(&collector->mutex);
         return 0;
     }
     
-    // Allocate array
-    *hotspots = CALLOC_LOGGED(hotspot_count, sizeof(cache_hotspot_t));
-    if (!*hotspots) {
+    size_t header = hotspot_count * sizeof(cache_hotspot_t);
+    char *block = MALLOC_LOGGED(header + sample_total * sizeof(cache_miss_sample_t));
+    if (!block) {
         LOG_ERROR("Failed to allocate hotspot array");
         pthread_mutex_unlock(&collector->mutex);
         return -1;
     }
     
     // Copy hotspots
+    cache_hotspot_t *array = (cache_hotspot_t *)block;
+    cache_miss_sample_t *next = (cache_miss_sample_t *)(block + header);
     int idx = 0;
     for (size_t i = 0; i < collector->table_size; i++) {
-        hotspot_entry_t *entry = collector->hotspot_table[i];
-        while (entry && idx < hotspot_count) {
-            if ((int)entry->hotspot.sample_count >= collector->config.min_samples_per_hotspot &&
-                entry->hotspot.miss_rate >= collector->config.hotspot_threshold) {
-                
-                // Deep copy hotspot
-                (*hotspots)[idx] = entry->hotspot;
-                
-                // Copy samples
-                if (entry->hotspot.sample_count > 0) {
-                    (*hotspots)[idx].samples = MALLOC_LOGGED(
-                        entry->hotspot.sample_count * sizeof(cache_miss_sample_t));
-                    if ((*hotspots)[idx].samples) {
-                        memcpy((*hotspots)[idx].samples, entry->hotspot.samples,
-                               entry->hotspot.sample_count * sizeof(cache_miss_sample_t));
-                    }
-                }
-                
-                idx++;
+        for (hotspot_entry_t *entry = collector->hotspot_table[i]; entry; entry = entry->next) {
+            if (!is_significant(collector, entry)) continue;
+            
+            array[idx] = entry->hotspot;
+            if (entry->hotspot.sample_count > 0) {
+                memcpy(next, entry->hotspot.samples,
+                       entry->hotspot.sample_count * sizeof(cache_miss_sample_t));
             }
-            entry = entry->next;
+            array[idx].samples = next;
+            array[idx].sample_capacity = entry->hotspot.sample_count;
+            next += entry->hotspot.sample_count;
+            idx++;
         }
     }
     
-    *count = idx;
-    
     // Sort by total misses
-    qsort(*hotspots, *count, sizeof(cache_hotspot_t), compare_hotspots_by_misses);
+    qsort(array, idx, sizeof(cache_hotspot_t), compare_hotspots_by_misses);
+    *hotspots = array;
+    *count = idx;
     
     pthread_mutex_unlock(&collector->mutex);
     
@@ -510,16 +706,60 @@ int sample_collector_get_hotspots(sample_collector_t *collector,
     return 0;
 }
 
-// Free hotspots
-void sample_collector_free_hotspots(cache_hotspot_t *hotspots, int count) {
-    if (!hotspots) return;
+// Move the hotspots out: the array is written into the space reserved at the
+// front of the sample block, so no sample is copied
+int sample_collector_take_hotspots(sample_collector_t *collector,
+                                  cache_hotspot_t **hotspots, int *count) {
+    if (!collector || !hotspots || !count) {
+        LOG_ERROR("Invalid parameters for sample_collector_take_hotspots");
+        return -1;
+    }
+    
+    pthread_mutex_lock(&collector->mutex);
     
-    for (int i = 0; i < count; i++) {
-        if (hotspots[i].samples) {
-            FREE_LOGGED(hotspots[i].samples);
+    *hotspots = NULL;
+    *count = 0;
+    if (collector->hotspots_taken) {
+        pthread_mutex_unlock(&collector->mutex);
+        LOG_ERROR("Hotspots were already taken from this collector");
+        return -1;
+    }
+    if (!collector->hotspot_block) {
+        pthread_mutex_unlock(&collector->mutex);
+        return 0;
+    }
+    
+    cache_hotspot_t *array = (cache_hotspot_t *)collector->hotspot_block;
+    int idx = 0;
+    for (size_t i = 0; i < collector->table_size; i++) {
+        for (hotspot_entry_t *entry = collector->hotspot_table[i]; entry; entry = entry->next) {
+            if (is_significant(collector, entry)) {
+                array[idx++] = entry->hotspot;
+            }
         }
     }
     
+    if (idx > 0) {
+        qsort(array, idx, sizeof(cache_hotspot_t), compare_hotspots_by_misses);
+        *hotspots = array;
+        *count = idx;
+        
+        // The entries' samples now belong to the caller
+        collector->hotspot_block = NULL;
+        collector->hotspots_taken = true;
+    }
+    
+    pthread_mutex_unlock(&collector->mutex);
+    
+    LOG_INFO("Took %d significant hotspots", *count);
+    return 0;
+}
+
+// Free hotspots; collector arrays carry their samples in the same allocation
+void sample_collector_free_hotspots(cache_hotspot_t *hotspots, int count) {
+    (void)count;
+    if (!hotspots) return;
+    
     FREE_LOGGED(hotspots);
 }
 
@@ -538,12 +778,12 @@ int sample_collector_get_stats(const sample_collector_t *collector,
     
     if (collector->hotspot_count > 0) {
         stats->avg_samples_per_hotspot = 
-            (double)collector->all_samples_count / collector->hotspot_count;
+            (double)stats->total_samples_processed / collector->hotspot_count;
     }
     
     // Count unique addresses and instructions
     // This is simplified - real implementation would use hash sets
-    stats->total_unique_addresses = collector->all_samples_count / 10;
+    stats->total_unique_addresses = stats->total_samples_processed / 10;
     stats->total_unique_instructions = collector->hotspot_count;
     
     pthread_mutex_unlock((pthread_mutex_t*)&collector->mutex);
@@ -588,7 +828,8 @@ collector_config_t collector_config_default(void) {
         .hotspot_threshold = 0.01,      // 1% miss rate
         .aggregate_by_function = false,
         .detect_false_sharing = true,
-        .max_hotspots = 1000
+        .max_hotspots = 1000,
+        .arena = NULL
     };
     
     return config;
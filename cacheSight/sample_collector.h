@@ -4,6 +4,7 @@
 #include "common.h"
 #include "perf_sampler.h"
 #include "hardware_detector.h"
+#include "arena.h"
 
 // Cache hotspot information
 typedef struct {
@@ -21,6 +22,7 @@ typedef struct {
     double miss_rate;               // Cache miss rate (0-1)
     bool is_false_sharing;          // Potential false sharing detected
     int access_stride;              // access stride in bytes
+    double cycles_per_iteration;    // Cost of one loop iteration (0 = unknown)
 } cache_hotspot_t;
 
 // Sample collector state
@@ -33,6 +35,7 @@ typedef struct {
     bool aggregate_by_function;     // Group by function vs line
     bool detect_false_sharing;      // Enable false sharing detection
     size_t max_hotspots;           // Maximum hotspots to track
+    arena_t *arena;                 // Hotspot entries (NULL = collector-owned)
 } collector_config_t;
 
 // API functions
@@ -45,6 +48,10 @@ int sample_collector_add_samples(sample_collector_t *collector,
                                 const cache_miss_sample_t *samples, int count);
 int sample_collector_add_sample(sample_collector_t *collector,
                                const cache_miss_sample_t *sample);
+// Borrows the block instead of copying it; it must stay valid and unchanged
+// until sample_collector_process has run. Copies when samples are pending.
+int sample_collector_attach_samples(sample_collector_t *collector,
+                                   const cache_miss_sample_t *samples, int count);
 
 // Process and aggregate samples
 int sample_collector_process(sample_collector_t *collector);
@@ -52,11 +59,17 @@ int sample_collector_process(sample_collector_t *collector);
 // Get hotspots
 int sample_collector_get_hotspots(sample_collector_t *collector,
                                  cache_hotspot_t **hotspots, int *count);
+// Moves the hotspots and their samples out without copying; afterwards the
+// collector can only be destroyed
+int sample_collector_take_hotspots(sample_collector_t *collector,
+                                  cache_hotspot_t **hotspots, int *count);
 void sample_collector_free_hotspots(cache_hotspot_t *hotspots, int count);
 
 // Analysis functions
 int sample_collector_analyze_patterns(sample_collector_t *collector);
 int sample_collector_detect_false_sharing(sample_collector_t *collector);
+int estimate_hotspot_stride_bytes(const cache_hotspot_t *hotspot);
+double estimate_hotspot_cycles_per_iteration(const cache_hotspot_t *hotspot, double cpu_ghz);
 
 // Statistics and reporting
 typedef struct {
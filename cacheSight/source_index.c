@@ -0,0 +1,91 @@
+#include "source_index.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+source_index_t* source_index_open(const char *path) {
+    if (!path) return NULL;
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_DEBUG("Cannot open source %s: %s", path, strerror(errno));
+        return NULL;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+    
+    source_index_t *index = CALLOC_LOGGED(1, sizeof(source_index_t));
+    if (!index) {
+        close(fd);
+        return NULL;
+    }
+    strncpy(index->path, path, sizeof(index->path) - 1);
+    index->size = (size_t)st.st_size;
+    
+    // Empty files have no mapping, only a line count of zero
+    if (index->size > 0) {
+        void *data = mmap(NULL, index->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            LOG_WARNING("Cannot map source %s: %s", path, strerror(errno));
+            close(fd);
+            FREE_LOGGED(index);
+            return NULL;
+        }
+        madvise(data, index->size, MADV_SEQUENTIAL);
+        index->data = data;
+    }
+    close(fd);
+    
+    // Count lines first so the index is allocated once
+    int lines = 0;
+    for (const char *p = index->data, *end = index->data + index->size; p && p < end; lines++) {
+        const char *newline = memchr(p, '\n', end - p);
+        p = newline ? newline + 1 : end;
+    }
+    
+    index->line_starts = MALLOC_LOGGED((size_t)(lines > 0 ? lines : 1) * sizeof(size_t));
+    if (!index->line_starts) {
+        source_index_close(index);
+        return NULL;
+    }
+    
+    size_t offset = 0;
+    for (int i = 0; i < lines; i++) {
+        index->line_starts[i] = offset;
+        const char *newline = memchr(index->data + offset, '\n', index->size - offset);
+        offset = newline ? (size_t)(newline - index->data) + 1 : index->size;
+    }
+    index->line_count = lines;
+    
+    return index;
+}
+
+void source_index_close(source_index_t *index) {
+    if (!index) return;
+    
+    if (index->data) {
+        munmap((void *)index->data, index->size);
+    }
+    if (index->line_starts) {
+        FREE_LOGGED(index->line_starts);
+    }
+    FREE_LOGGED(index);
+}
+
+const char* source_index_line(const source_index_t *index, int line, size_t *length) {
+    if (!index || line < 1 || line > index->line_count) return NULL;
+    
+    size_t start = index->line_starts[line - 1];
+    size_t end = line < index->line_count ? index->line_starts[line] : index->size;
+    
+    // Drop the newline and a carriage return before it
+    if (end > start && index->data[end - 1] == '\n') end--;
+    if (end > start && index->data[end - 1] == '\r') end--;
+    
+    if (length) *length = end - start;
+    return index->data + start;
+}
@@ -0,0 +1,22 @@
+#ifndef SOURCE_INDEX_H
+#define SOURCE_INDEX_H
+
+#include "common.h"
+
+// Memory-mapped source file with the offset of every line start
+typedef struct {
+    char path[512];
+    const char *data;
+    size_t size;
+    size_t *line_starts;            // Line n starts at line_starts[n - 1]
+    int line_count;
+} source_index_t;
+
+// API functions
+source_index_t* source_index_open(const char *path);
+void source_index_close(source_index_t *index);
+
+// Text of a 1-based line without its newline, NULL when out of range
+const char* source_index_line(const source_index_t *index, int line, size_t *length);
+
+#endif // SOURCE_INDEX_H
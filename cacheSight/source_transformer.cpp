@@ -0,0 +1,1100 @@
+#include "source_transformer.h"
+#include "common.h"
+
+#include <clang/AST/AST.h>
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Tooling/Tooling.h>
+#include <clang/Tooling/Core/Replacement.h>
+#include <clang/Rewrite/Core/Rewriter.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Lex/Lexer.h>
+#include <llvm/Support/Error.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <string>
+#include <set>
+#include <map>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace clang;
+using namespace clang::tooling;
+
+// Transformer implementation
+struct source_transformer {
+    transformer_config_t config;
+    std::vector<std::string> include_paths;
+    std::vector<std::string> defines;
+    std::string std_version;
+    std::vector<transform_request_t> requests;
+    std::vector<std::string> output_paths;   // Parallel to the input files, "" if unchanged
+
+    source_transformer() : std_version("c11") {}
+};
+
+// Array access flattened from an ArraySubscriptExpr chain: base[idx0][idx1]...
+struct ArrayAccess {
+    const ArraySubscriptExpr *expr;
+    const DeclRefExpr *base;            // Root array/pointer, NULL if not a plain variable
+    std::vector<const Expr*> indices;   // Outermost dimension first
+    bool is_write;
+};
+
+static std::string basenameOf(const std::string &path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// Mirror the source's path under work_dir so same-named files in different
+// directories get separate copies; ".." and absolute prefixes stay inside it
+static std::string mirroredPath(const std::string &work_dir, const std::string &original) {
+    std::string path = work_dir;
+    size_t pos = 0;
+    while (pos < original.size()) {
+        size_t slash = original.find('/', pos);
+        if (slash == std::string::npos) slash = original.size();
+        std::string part = original.substr(pos, slash - pos);
+        pos = slash + 1;
+
+        if (part.empty() || part == ".") continue;
+        if (part == "..") part = "__parent";
+        mkdir(path.c_str(), 0755);
+        path += "/" + part;
+    }
+    return path;
+}
+
+// Collects the declarations and statements transformations can target
+class TransformCollector : public RecursiveASTVisitor<TransformCollector> {
+public:
+    explicit TransformCollector(ASTContext *ctx) : source_mgr(&ctx->getSourceManager()) {}
+
+    std::vector<const ForStmt*> loops;
+    std::vector<const RecordDecl*> records;
+    std::vector<const InitListExpr*> init_lists;
+
+    bool VisitForStmt(ForStmt *stmt) {
+        if (source_mgr->isInMainFile(stmt->getBeginLoc())) {
+            loops.push_back(stmt);
+        }
+        return true;
+    }
+
+    bool VisitRecordDecl(RecordDecl *decl) {
+        if (source_mgr->isInMainFile(decl->getBeginLoc()) && decl->isCompleteDefinition()) {
+            records.push_back(decl);
+        }
+        return true;
+    }
+
+    bool VisitInitListExpr(InitListExpr *expr) {
+        if (source_mgr->isInMainFile(expr->getBeginLoc())) {
+            init_lists.push_back(expr);
+        }
+        return true;
+    }
+
+private:
+    SourceManager *source_mgr;
+};
+
+// Applies the requests of one translation unit
+class TransformConsumer : public ASTConsumer {
+public:
+    TransformConsumer(source_transformer *t, int file_index)
+        : transformer(t), file_index(file_index) {}
+
+    void HandleTranslationUnit(ASTContext &context) override {
+        ctx = &context;
+        sm = &context.getSourceManager();
+        lang_opts = &context.getLangOpts();
+
+        TransformCollector collector(&context);
+        collector.TraverseDecl(context.getTranslationUnitDecl());
+        loops = &collector.loops;
+        records = &collector.records;
+        init_lists = &collector.init_lists;
+
+        const FileEntry *main_entry = sm->getFileEntryForID(sm->getMainFileID());
+        std::string main_file = main_entry ? main_entry->getName().str() : "";
+
+        Replacements replaces;
+        int applied = 0;
+
+        for (auto &request : transformer->requests) {
+            if (request.applied) continue;
+
+            // Struct requests match by name, loop requests by file and line
+            if (request.struct_name[0] == '\0' &&
+                basenameOf(request.location.file) != basenameOf(main_file)) {
+                continue;
+            }
+
+            std::vector<Replacement> edits;
+            std::string why;
+            bool ok = false;
+
+            switch (request.kind) {
+                case TRANSFORM_ALIGNMENT:
+                    ok = buildAlignment(request, edits, why);
+                    break;
+                case TRANSFORM_FIELD_REORDER:
+                    ok = buildFieldReorder(request, edits, why);
+                    break;
+                case TRANSFORM_LOOP_INTERCHANGE:
+                    ok = buildInterchange(request, edits, why);
+                    break;
+                case TRANSFORM_PREFETCH:
+                    ok = buildPrefetch(request, edits, why);
+                    break;
+                case TRANSFORM_NONTEMPORAL_STORE:
+                    ok = buildNonTemporal(request, edits, why);
+                    break;
+            }
+
+            // Commit all edits of a request or none of them
+            if (ok) {
+                Replacements candidate = replaces;
+                for (const auto &edit : edits) {
+                    if (llvm::Error err = candidate.add(edit)) {
+                        llvm::consumeError(std::move(err));
+                        ok = false;
+                        why = "overlaps an earlier transformation";
+                        break;
+                    }
+                }
+                if (ok) {
+                    replaces = candidate;
+                    applied++;
+                }
+            }
+
+            if (ok || request.struct_name[0] == '\0') {
+                request.applied = ok;
+                snprintf(request.status, sizeof(request.status), "%s", why.c_str());
+                LOG_INFO("%s at %s:%d: %s %s", transform_kind_to_string(request.kind),
+                         request.location.file, request.location.line,
+                         ok ? "applied -" : "skipped -", why.c_str());
+            }
+        }
+
+        if (applied == 0) return;
+
+        Rewriter rewriter(*sm, *lang_opts);
+        if (!applyAllReplacements(replaces, rewriter)) {
+            LOG_ERROR("Failed to apply replacements to %s", main_file.c_str());
+            return;
+        }
+
+        const RewriteBuffer *buffer = rewriter.getRewriteBufferFor(sm->getMainFileID());
+        if (!buffer) return;
+
+        writeOutput(main_file, std::string(buffer->begin(), buffer->end()));
+    }
+
+private:
+    source_transformer *transformer;
+    int file_index;
+    ASTContext *ctx = nullptr;
+    SourceManager *sm = nullptr;
+    const LangOptions *lang_opts = nullptr;
+    std::vector<const ForStmt*> *loops = nullptr;
+    std::vector<const RecordDecl*> *records = nullptr;
+    std::vector<const InitListExpr*> *init_lists = nullptr;
+
+    std::string text(SourceRange range) {
+        return Lexer::getSourceText(CharSourceRange::getTokenRange(range), *sm, *lang_opts).str();
+    }
+
+    Replacement replaceRange(SourceRange range, const std::string &new_text) {
+        return Replacement(*sm, CharSourceRange::getTokenRange(range), new_text, *lang_opts);
+    }
+
+    Replacement insertAfterToken(SourceLocation loc, const std::string &new_text) {
+        SourceLocation end = Lexer::getLocForEndOfToken(loc, 0, *sm, *lang_opts);
+        return Replacement(*sm, end, 0, new_text);
+    }
+
+    unsigned indentOf(SourceLocation loc) {
+        return sm->getSpellingColumnNumber(loc) - 1;
+    }
+
+    // Innermost-first loops whose source range covers the requested line
+    std::vector<const ForStmt*> loopsAtLine(int line) {
+        std::vector<const ForStmt*> found;
+        for (const ForStmt *loop : *loops) {
+            unsigned begin = sm->getSpellingLineNumber(loop->getBeginLoc());
+            unsigned end = sm->getSpellingLineNumber(loop->getEndLoc());
+            if ((int)begin <= line && line <= (int)end) {
+                found.push_back(loop);
+            }
+        }
+        std::sort(found.begin(), found.end(), [this](const ForStmt *a, const ForStmt *b) {
+            return sm->getSpellingLineNumber(a->getBeginLoc()) >
+                   sm->getSpellingLineNumber(b->getBeginLoc());
+        });
+        return found;
+    }
+
+    const RecordDecl* findRecord(const char *name) {
+        for (const RecordDecl *record : *records) {
+            if (record->getNameAsString() == name) return record;
+        }
+        return nullptr;
+    }
+
+    static const VarDecl* loopVar(const ForStmt *loop) {
+        if (!loop->getInit()) return nullptr;
+        if (const DeclStmt *decl = dyn_cast<DeclStmt>(loop->getInit())) {
+            if (decl->isSingleDecl()) {
+                return dyn_cast<VarDecl>(decl->getSingleDecl());
+            }
+        } else if (const BinaryOperator *assign = dyn_cast<BinaryOperator>(loop->getInit())) {
+            if (assign->getOpcode() == BO_Assign) {
+                if (const DeclRefExpr *ref = dyn_cast<DeclRefExpr>(assign->getLHS()->IgnoreParenImpCasts())) {
+                    return dyn_cast<VarDecl>(ref->getDecl());
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    static bool refersTo(const Stmt *stmt, const VarDecl *var) {
+        if (!stmt || !var) return false;
+        if (const DeclRefExpr *ref = dyn_cast<DeclRefExpr>(stmt)) {
+            if (ref->getDecl() == var) return true;
+        }
+        for (const Stmt *child : stmt->children()) {
+            if (refersTo(child, var)) return true;
+        }
+        return false;
+    }
+
+    static bool isVarRef(const Expr *expr, const VarDecl *var) {
+        const DeclRefExpr *ref = dyn_cast<DeclRefExpr>(expr->IgnoreParenImpCasts());
+        return ref && ref->getDecl() == var;
+    }
+
+    static ArrayAccess flatten(const ArraySubscriptExpr *expr, bool is_write) {
+        ArrayAccess access = {expr, nullptr, {}, is_write};
+        const Expr *current = expr;
+        while (const ArraySubscriptExpr *sub = dyn_cast<ArraySubscriptExpr>(current->IgnoreParenImpCasts())) {
+            access.indices.insert(access.indices.begin(), sub->getIdx());
+            current = sub->getBase();
+        }
+        access.base = dyn_cast<DeclRefExpr>(current->IgnoreParenImpCasts());
+        return access;
+    }
+
+    // Walk a loop body, recording array accesses and anything that blocks
+    // reordering its iterations (calls, writes through unknown lvalues)
+    void collectAccesses(const Stmt *stmt, const Stmt *body_scope,
+                         std::vector<ArrayAccess> &accesses, bool &unsafe, std::string &why) {
+        if (!stmt) return;
+
+        if (isa<CallExpr>(stmt)) {
+            unsafe = true;
+            why = "loop body contains a function call";
+            return;
+        }
+
+        const Expr *written = nullptr;
+        const Stmt *rest = nullptr;
+        bool also_read = false;
+
+        if (const BinaryOperator *op = dyn_cast<BinaryOperator>(stmt)) {
+            if (op->isAssignmentOp()) {
+                written = op->getLHS();
+                rest = op->getRHS();
+                also_read = op->isCompoundAssignmentOp();
+            }
+        } else if (const UnaryOperator *op = dyn_cast<UnaryOperator>(stmt)) {
+            if (op->isIncrementDecrementOp()) {
+                written = op->getSubExpr();
+                also_read = true;
+            }
+        }
+
+        if (written) {
+            const Expr *lhs = written->IgnoreParenImpCasts();
+            if (const ArraySubscriptExpr *sub = dyn_cast<ArraySubscriptExpr>(lhs)) {
+                ArrayAccess access = flatten(sub, true);
+                accesses.push_back(access);
+                if (also_read) {
+                    ArrayAccess read = access;
+                    read.is_write = false;
+                    accesses.push_back(read);
+                }
+                for (const Expr *idx : access.indices) {
+                    collectAccesses(idx, body_scope, accesses, unsafe, why);
+                }
+            } else if (const DeclRefExpr *ref = dyn_cast<DeclRefExpr>(lhs)) {
+                // Scalars are only safe when private to one iteration
+                const VarDecl *var = dyn_cast<VarDecl>(ref->getDecl());
+                if (!var || !body_scope ||
+                    !sm->isBeforeInTranslationUnit(body_scope->getBeginLoc(), var->getLocation()) ||
+                    !sm->isBeforeInTranslationUnit(var->getLocation(), body_scope->getEndLoc())) {
+                    unsafe = true;
+                    why = "loop writes a scalar declared outside the nest";
+                    return;
+                }
+            } else {
+                unsafe = true;
+                why = "loop writes through a pointer or member";
+                return;
+            }
+            collectAccesses(rest, body_scope, accesses, unsafe, why);
+            return;
+        }
+
+        if (const ArraySubscriptExpr *sub = dyn_cast<ArraySubscriptExpr>(stmt)) {
+            ArrayAccess access = flatten(sub, false);
+            accesses.push_back(access);
+            for (const Expr *idx : access.indices) {
+                collectAccesses(idx, body_scope, accesses, unsafe, why);
+            }
+            return;
+        }
+
+        for (const Stmt *child : stmt->children()) {
+            collectAccesses(child, body_scope, accesses, unsafe, why);
+            if (unsafe) return;
+        }
+    }
+
+    bool buildAlignment(const transform_request_t &request, std::vector<Replacement> &edits,
+                        std::string &why) {
+        int alignment = request.alignment > 0 ? request.alignment : 64;
+        std::string attr = " __attribute__((aligned(" + std::to_string(alignment) + ")))";
+
+        if (request.struct_name[0]) {
+            const RecordDecl *record = findRecord(request.struct_name);
+            if (!record) {
+                why = "struct not defined in this file";
+                return false;
+            }
+            if (record->hasAttr<AlignedAttr>()) {
+                why = "struct already has an alignment attribute";
+                return false;
+            }
+            SourceLocation brace = record->getBraceRange().getEnd();
+            if (brace.isInvalid() || brace.isMacroID()) {
+                why = "struct definition comes from a macro";
+                return false;
+            }
+            edits.push_back(insertAfterToken(brace, attr));
+            why = "aligned struct " + std::string(request.struct_name) + " to " +
+                  std::to_string(alignment) + " bytes";
+            return true;
+        }
+
+        // Align the fixed-size arrays the loop touches
+        std::vector<const ForStmt*> found = loopsAtLine(request.location.line);
+        if (found.empty()) {
+            why = "no loop at this line";
+            return false;
+        }
+
+        std::vector<ArrayAccess> accesses;
+        bool unsafe = false;
+        std::string ignored;
+        collectAccesses(found.back()->getBody(), nullptr, accesses, unsafe, ignored);
+
+        std::set<const VarDecl*> seen;
+        std::string names;
+        for (const ArrayAccess &access : accesses) {
+            if (!access.base) continue;
+            const VarDecl *var = dyn_cast<VarDecl>(access.base->getDecl());
+            if (!var || seen.count(var) || isa<ParmVarDecl>(var) || var->hasExternalStorage() ||
+                !var->getType()->isConstantArrayType() || var->hasAttr<AlignedAttr>() ||
+                !sm->isInMainFile(var->getLocation()) || !var->getTypeSourceInfo()) {
+                continue;
+            }
+            SourceLocation end = var->getTypeSourceInfo()->getTypeLoc().getEndLoc();
+            if (end.isInvalid() || end.isMacroID()) continue;
+
+            seen.insert(var);
+            edits.push_back(insertAfterToken(end, attr));
+            names += (names.empty() ? "" : ", ") + var->getNameAsString();
+        }
+
+        if (edits.empty()) {
+            why = "no fixed-size arrays to align";
+            return false;
+        }
+        why = "aligned " + names + " to " + std::to_string(alignment) + " bytes";
+        return true;
+    }
+
+    bool buildFieldReorder(const transform_request_t &request, std::vector<Replacement> &edits,
+                           std::string &why) {
+        const RecordDecl *record = findRecord(request.struct_name);
+        if (!record) {
+            why = "struct not defined in this file";
+            return false;
+        }
+
+        std::vector<const FieldDecl*> fields(record->field_begin(), record->field_end());
+        if ((int)fields.size() != request.field_count || fields.size() > 32) {
+            why = "field count does not match the analysed layout";
+            return false;
+        }
+
+        for (size_t i = 0; i < fields.size(); i++) {
+            if (fields[i]->isBitField() || fields[i]->getBeginLoc().isMacroID()) {
+                why = "struct has bit-fields or macro-generated fields";
+                return false;
+            }
+            if (i > 0 && fields[i]->getBeginLoc() == fields[i - 1]->getBeginLoc()) {
+                why = "fields share a declaration";
+                return false;
+            }
+        }
+
+        // Positional initializers would silently change meaning
+        for (const InitListExpr *init : *init_lists) {
+            const RecordType *type = init->getType()->getAsStructureType();
+            if (!type || type->getDecl() != record || !init->isSyntacticForm()) continue;
+
+            bool zero_init = init->getNumInits() == 1 && isa<IntegerLiteral>(init->getInit(0)->IgnoreParenImpCasts());
+            for (unsigned i = 0; i < init->getNumInits() && !zero_init; i++) {
+                if (!isa<DesignatedInitExpr>(init->getInit(i))) {
+                    why = "struct has positional initializers";
+                    return false;
+                }
+            }
+        }
+
+        bool identity = true;
+        for (int i = 0; i < request.field_count; i++) {
+            if (request.field_order[i] != i) identity = false;
+        }
+        if (identity) {
+            why = "fields already in the requested order";
+            return false;
+        }
+
+        for (int slot = 0; slot < request.field_count; slot++) {
+            int from = request.field_order[slot];
+            if (from < 0 || from >= request.field_count) {
+                why = "invalid field order";
+                edits.clear();
+                return false;
+            }
+            if (from == slot) continue;
+            edits.push_back(replaceRange(fields[slot]->getSourceRange(),
+                                         text(fields[from]->getSourceRange())));
+        }
+
+        why = "reordered fields of " + std::string(request.struct_name);
+        return true;
+    }
+
+    bool buildInterchange(const transform_request_t &request, std::vector<Replacement> &edits,
+                          std::string &why) {
+        std::vector<const ForStmt*> found = loopsAtLine(request.location.line);
+
+        // Pick the innermost perfectly nested pair around the line
+        const ForStmt *outer = nullptr;
+        const ForStmt *inner = nullptr;
+        for (size_t i = 0; i + 1 < found.size() && !outer; i++) {
+            const Stmt *body = found[i + 1]->getBody();
+            if (const CompoundStmt *block = dyn_cast<CompoundStmt>(body)) {
+                body = block->size() == 1 ? block->body_front() : nullptr;
+            }
+            if (body == found[i]) {
+                outer = found[i + 1];
+                inner = found[i];
+            }
+        }
+
+        if (!outer) {
+            why = "no perfectly nested loop pair";
+            return false;
+        }
+
+        const VarDecl *outer_var = loopVar(outer);
+        const VarDecl *inner_var = loopVar(inner);
+        if (!outer_var || !inner_var) {
+            why = "loops are not in canonical form";
+            return false;
+        }
+        if (refersTo(inner->getInit(), outer_var) || refersTo(inner->getCond(), outer_var) ||
+            refersTo(inner->getInc(), outer_var)) {
+            why = "inner bounds depend on the outer loop (non-rectangular)";
+            return false;
+        }
+        if (outer->getForLoc().isMacroID() || inner->getForLoc().isMacroID()) {
+            why = "loop header comes from a macro";
+            return false;
+        }
+
+        std::vector<ArrayAccess> accesses;
+        bool unsafe = false;
+        collectAccesses(inner->getBody(), inner->getBody(), accesses, unsafe, why);
+        if (unsafe) return false;
+
+        // Dependence test: every written array is indexed identically everywhere,
+        // and each index is either a loop variable or independent of both
+        std::map<const ValueDecl*, std::string> written;
+        for (const ArrayAccess &access : accesses) {
+            if (!access.is_write) continue;
+            if (!access.base) {
+                why = "write through a non-variable array base";
+                return false;
+            }
+            for (const Expr *idx : access.indices) {
+                bool uses_loops = refersTo(idx, outer_var) || refersTo(idx, inner_var);
+                if (uses_loops && !isVarRef(idx, outer_var) && !isVarRef(idx, inner_var)) {
+                    why = "written array uses a compound subscript";
+                    return false;
+                }
+            }
+            std::string subscript = text(access.expr->getSourceRange());
+            auto it = written.find(access.base->getDecl());
+            if (it != written.end() && it->second != subscript) {
+                why = "array written with different subscripts";
+                return false;
+            }
+            written[access.base->getDecl()] = subscript;
+        }
+
+        int benefit = 0;
+        int harm = 0;
+        for (const ArrayAccess &access : accesses) {
+            if (access.base) {
+                auto it = written.find(access.base->getDecl());
+                if (it != written.end() && it->second != text(access.expr->getSourceRange())) {
+                    why = "array read and written with different subscripts";
+                    return false;
+                }
+
+                // Unrestricted pointers may alias a written pointer
+                QualType type = access.base->getDecl()->getType();
+                if (!access.is_write && type->isPointerType() && !type.isRestrictQualified() &&
+                    it == written.end()) {
+                    for (const auto &entry : written) {
+                        QualType wtype = entry.first->getType();
+                        if (wtype->isPointerType() && !wtype.isRestrictQualified()) {
+                            why = "pointers may alias";
+                            return false;
+                        }
+                    }
+                }
+            }
+
+            if (!access.indices.empty()) {
+                if (isVarRef(access.indices.back(), outer_var)) benefit++;
+                if (isVarRef(access.indices.back(), inner_var)) harm++;
+            }
+        }
+
+        if (benefit <= harm) {
+            why = "interchange would not make the innermost subscripts contiguous";
+            return false;
+        }
+
+        SourceRange outer_header(outer->getForLoc(), outer->getRParenLoc());
+        SourceRange inner_header(inner->getForLoc(), inner->getRParenLoc());
+        edits.push_back(replaceRange(outer_header, text(inner_header)));
+        edits.push_back(replaceRange(inner_header, text(outer_header)));
+
+        why = "interchanged " + outer_var->getNameAsString() + "/" + inner_var->getNameAsString() +
+              " loops (" + std::to_string(benefit) + " accesses become unit-stride)";
+        return true;
+    }
+
+    bool buildPrefetch(const transform_request_t &request, std::vector<Replacement> &edits,
+                       std::string &why) {
+        std::vector<const ForStmt*> found = loopsAtLine(request.location.line);
+        if (found.empty()) {
+            why = "no loop at this line";
+            return false;
+        }
+
+        const ForStmt *loop = found.front();
+        const VarDecl *var = loopVar(loop);
+        const CompoundStmt *body = dyn_cast<CompoundStmt>(loop->getBody());
+        if (!var || !body || body->body_empty()) {
+            why = "loop is not canonical or its body is not a block";
+            return false;
+        }
+        if (text(body->getSourceRange()).find("__builtin_prefetch") != std::string::npos) {
+            why = "loop already prefetches";
+            return false;
+        }
+
+        std::vector<ArrayAccess> accesses;
+        bool unsafe = false;
+        std::string ignored;
+        collectAccesses(body, body, accesses, unsafe, ignored);
+
+        int distance = request.prefetch_distance > 0 ? request.prefetch_distance : 8;
+        int locality = request.prefetch_locality >= 0 && request.prefetch_locality <= 3 ?
+                       request.prefetch_locality : 3;
+        std::string indent(indentOf(body->body_front()->getBeginLoc()), ' ');
+        std::set<std::string> seen;
+        std::string inserted;
+        int count = 0;
+
+        for (const ArrayAccess &access : accesses) {
+            if (!access.base || access.indices.empty() || count >= 4) continue;
+            if (!isVarRef(access.indices.back(), var)) continue;
+
+            // Prefix is everything but the innermost subscript, e.g. "a[i]" of a[i][j]
+            const ArraySubscriptExpr *innermost = access.expr;
+            std::string prefix = text(innermost->getBase()->getSourceRange());
+            if (seen.count(prefix)) continue;
+            seen.insert(prefix);
+
+            inserted += "\n" + indent + "__builtin_prefetch(&" + prefix + "[" +
+                        var->getNameAsString() + " + " + std::to_string(distance) + "], " +
+                        (access.is_write ? "1" : "0") + ", " + std::to_string(locality) + ");";
+            count++;
+        }
+
+        if (count == 0) {
+            why = "no unit-stride array accesses on the loop variable";
+            return false;
+        }
+
+        edits.push_back(insertAfterToken(body->getLBracLoc(), inserted));
+        why = "inserted " + std::to_string(count) + " prefetches " + std::to_string(distance) +
+              " iterations ahead";
+        return true;
+    }
+
+    bool buildNonTemporal(const transform_request_t &request, std::vector<Replacement> &edits,
+                          std::string &why) {
+        std::vector<const ForStmt*> found = loopsAtLine(request.location.line);
+        if (found.empty()) {
+            why = "no loop at this line";
+            return false;
+        }
+
+        const ForStmt *loop = found.front();
+        const VarDecl *var = loopVar(loop);
+        const CompoundStmt *body = dyn_cast<CompoundStmt>(loop->getBody());
+        if (!var || !body) {
+            why = "loop is not canonical or its body is not a block";
+            return false;
+        }
+        if (text(body->getSourceRange()).find("__builtin_nontemporal_store") != std::string::npos) {
+            why = "loop already uses non-temporal stores";
+            return false;
+        }
+
+        std::vector<ArrayAccess> accesses;
+        bool unsafe = false;
+        std::string ignored;
+        collectAccesses(body, body, accesses, unsafe, ignored);
+
+        // Arrays that are read anywhere in the loop still benefit from caching
+        std::set<const ValueDecl*> read_bases;
+        for (const ArrayAccess &access : accesses) {
+            if (!access.is_write && access.base) read_bases.insert(access.base->getDecl());
+        }
+
+        int count = 0;
+        for (const Stmt *child : body->body()) {
+            const BinaryOperator *assign = dyn_cast<BinaryOperator>(child);
+            if (!assign || assign->getOpcode() != BO_Assign) continue;
+
+            const ArraySubscriptExpr *lhs = dyn_cast<ArraySubscriptExpr>(assign->getLHS()->IgnoreParens());
+            if (!lhs || !lhs->getType()->isArithmeticType()) continue;
+
+            ArrayAccess access = flatten(lhs, true);
+            if (!access.base || read_bases.count(access.base->getDecl()) ||
+                !isVarRef(access.indices.back(), var)) {
+                continue;
+            }
+
+            edits.push_back(replaceRange(assign->getSourceRange(),
+                                         "__builtin_nontemporal_store(" +
+                                         text(assign->getRHS()->getSourceRange()) + ", &" +
+                                         text(lhs->getSourceRange()) + ")"));
+            count++;
+        }
+
+        if (count == 0) {
+            why = "no write-only unit-stride stores";
+            return false;
+        }
+
+        // Order the streaming stores before anything that follows the loop
+        std::string indent(indentOf(loop->getBeginLoc()), ' ');
+        edits.push_back(insertAfterToken(body->getRBracLoc(),
+                                         "\n" + indent + "__atomic_thread_fence(__ATOMIC_SEQ_CST);"));
+
+        why = "converted " + std::to_string(count) + " streaming stores to non-temporal";
+        return true;
+    }
+
+    void writeOutput(const std::string &original, const std::string &content) {
+        std::string work_dir = transformer->config.work_dir[0] ? transformer->config.work_dir : ".";
+        std::string out_path = mirroredPath(work_dir, original);
+        FILE *fp = fopen(out_path.c_str(), "w");
+        if (!fp) {
+            LOG_ERROR("Failed to write transformed source %s: %s", out_path.c_str(), strerror(errno));
+            return;
+        }
+        fwrite(content.data(), 1, content.size(), fp);
+        fclose(fp);
+
+        if ((int)transformer->output_paths.size() > file_index) {
+            transformer->output_paths[file_index] = out_path;
+        }
+
+        LOG_INFO("Transformed %s -> %s", original.c_str(), out_path.c_str());
+    }
+};
+
+class TransformAction : public ASTFrontendAction {
+public:
+    TransformAction(source_transformer *t, int index) : transformer(t), file_index(index) {}
+
+    std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI, StringRef file) override {
+        (void)CI;
+        LOG_DEBUG("Creating transform consumer for file: %s", file.str().c_str());
+        return std::make_unique<TransformConsumer>(transformer, file_index);
+    }
+
+private:
+    source_transformer *transformer;
+    int file_index;
+};
+
+// Append `diff -u original transformed` to the configured diff output; the
+// paths are passed as arguments, never through a shell
+static int append_unified_diff(const char *original, const char *transformed, FILE *out) {
+    std::string label_a = std::string("a/") + original;
+    std::string label_b = std::string("b/") + original;
+
+    fflush(out);
+    pid_t pid = fork();
+    if (pid < 0) {
+        LOG_ERROR("Failed to run diff for %s: %s", original, strerror(errno));
+        return -1;
+    }
+
+    if (pid == 0) {
+        dup2(fileno(out), STDOUT_FILENO);
+        execlp("diff", "diff", "-u", "--label", label_a.c_str(), "--label", label_b.c_str(),
+               original, transformed, (char*)NULL);
+        _exit(127);
+    }
+
+    // diff exits 1 when the files differ, which they do
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) > 1) {
+        LOG_ERROR("Failed to run diff for %s", original);
+        return -1;
+    }
+    return 0;
+}
+
+// Copies all of in to out, checking every write
+static bool copy_stream(FILE *in, FILE *out) {
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, 1, n, out) != n) return false;
+    }
+    return !ferror(in);
+}
+
+// Writes src into a new file at dst with the given mode; fails if dst exists
+static int copy_file_exclusive(const char *src, const char *dst, mode_t mode) {
+    int fd = open(dst, O_WRONLY | O_CREAT | O_EXCL, mode & 07777);
+    if (fd < 0) return -1;
+    FILE *in = fopen(src, "r");
+    FILE *out = fdopen(fd, "w");
+    bool ok = in && out && copy_stream(in, out);
+    if (in) fclose(in);
+    if (out) {
+        if (fclose(out) != 0) ok = false;
+    } else {
+        close(fd);
+    }
+    if (!ok) unlink(dst);
+    return ok ? 0 : -1;
+}
+
+// Replaces original with the transformed output. The new contents go to a
+// temp file next to the original, which keeps its mode and is renamed over
+// it only after every write succeeded. An existing .orig is never replaced.
+static int replace_in_place(const char *original, const char *transformed) {
+    std::string backup = std::string(original) + ".orig";
+    if (access(backup.c_str(), F_OK) == 0) {
+        LOG_ERROR("Backup %s already exists; refusing to overwrite it", backup.c_str());
+        return -1;
+    }
+
+    struct stat st;
+    if (stat(original, &st) != 0) {
+        LOG_ERROR("Failed to stat %s: %s", original, strerror(errno));
+        return -1;
+    }
+
+    std::string temp_path = std::string(original) + ".XXXXXX";
+    std::vector<char> temp_buf(temp_path.begin(), temp_path.end());
+    temp_buf.push_back('\0');
+    int fd = mkstemp(temp_buf.data());
+    if (fd < 0) {
+        LOG_ERROR("Failed to create temp file for %s: %s", original, strerror(errno));
+        return -1;
+    }
+    temp_path = temp_buf.data();
+
+    FILE *in = fopen(transformed, "r");
+    FILE *out = fdopen(fd, "w");
+    bool ok = in && out && fchmod(fd, st.st_mode & 07777) == 0 && copy_stream(in, out);
+    int saved_errno = errno;
+    if (in) fclose(in);
+    if (out) {
+        if (fclose(out) != 0 && ok) {
+            ok = false;
+            saved_errno = errno;
+        }
+    } else {
+        close(fd);
+    }
+    if (!ok) {
+        LOG_ERROR("Failed to write transformed %s: %s", original, strerror(saved_errno));
+        unlink(temp_path.c_str());
+        return -1;
+    }
+
+    // Hard link the backup so the original is never missing; copy where the
+    // filesystem has no links. Both fail rather than replace an existing .orig.
+    if (link(original, backup.c_str()) != 0 &&
+        (errno == EEXIST || copy_file_exclusive(original, backup.c_str(), st.st_mode) != 0)) {
+        LOG_ERROR("Failed to back up %s: %s", original, strerror(errno));
+        unlink(temp_path.c_str());
+        return -1;
+    }
+
+    if (rename(temp_path.c_str(), original) != 0) {
+        LOG_ERROR("Failed to replace %s: %s", original, strerror(errno));
+        unlink(temp_path.c_str());
+        return -1;
+    }
+
+    LOG_INFO("Applied transformations to %s (backup: %s)", original, backup.c_str());
+    return 0;
+}
+
+// C API implementation
+extern "C" {
+
+source_transformer_t* source_transformer_create(const transformer_config_t *config) {
+    source_transformer_t *transformer = new source_transformer();
+    if (config) {
+        transformer->config = *config;
+    } else {
+        transformer->config = transformer_config_default();
+    }
+    LOG_INFO("Created source transformer (%s)",
+             transformer->config.in_place ? "in place" : "diff output");
+    return transformer;
+}
+
+void source_transformer_destroy(source_transformer_t *transformer) {
+    if (transformer) {
+        LOG_INFO("Destroying source transformer");
+        delete transformer;
+    }
+}
+
+int source_transformer_add_include_path(source_transformer_t *transformer, const char *path) {
+    if (!transformer || !path) return -1;
+    transformer->include_paths.push_back(std::string("-I") + path);
+    return 0;
+}
+
+int source_transformer_add_define(source_transformer_t *transformer, const char *define) {
+    if (!transformer || !define) return -1;
+    transformer->defines.push_back(std::string("-D") + define);
+    return 0;
+}
+
+int source_transformer_set_std(source_transformer_t *transformer, const char *std) {
+    if (!transformer || !std) return -1;
+    transformer->std_version = std;
+    return 0;
+}
+
+int source_transformer_add_request(source_transformer_t *transformer,
+                                  const transform_request_t *request) {
+    if (!transformer || !request) return -1;
+
+    transform_request_t copy = *request;
+    copy.applied = false;
+    copy.status[0] = '\0';
+    transformer->requests.push_back(copy);
+
+    LOG_DEBUG("Queued %s for %s:%d %s", transform_kind_to_string(request->kind),
+              request->location.file, request->location.line, request->struct_name);
+    return 0;
+}
+
+int source_transformer_apply(source_transformer_t *transformer,
+                            const char **filenames, int file_count) {
+    if (!transformer || !filenames || file_count <= 0) return -1;
+
+    LOG_INFO("Applying %zu transformation requests to %d files",
+             transformer->requests.size(), file_count);
+
+    transformer->output_paths.assign(file_count, "");
+    std::string std_flag = "-std=" + transformer->std_version;
+
+    for (int i = 0; i < file_count; i++) {
+        std::vector<const char*> argv;
+        argv.push_back("cache_optimizer");
+        argv.push_back(filenames[i]);
+        argv.push_back("--");
+        argv.push_back(std_flag.c_str());
+        for (const auto &inc : transformer->include_paths) {
+            argv.push_back(inc.c_str());
+        }
+        for (const auto &def : transformer->defines) {
+            argv.push_back(def.c_str());
+        }
+
+        std::string err;
+        int argc = static_cast<int>(argv.size());
+        std::unique_ptr<CompilationDatabase> compilations(
+            FixedCompilationDatabase::loadFromCommandLine(
+                argc, const_cast<char**>(argv.data()), err));
+        if (!compilations) {
+            LOG_ERROR("Failed to create compilation database: %s", err.c_str());
+            continue;
+        }
+
+        std::vector<std::string> source_paths;
+        source_paths.push_back(filenames[i]);
+        ClangTool tool(*compilations, source_paths);
+
+        class TransformActionFactory : public FrontendActionFactory {
+            source_transformer *transformer;
+            int index;
+        public:
+            TransformActionFactory(source_transformer *t, int i) : transformer(t), index(i) {}
+
+            std::unique_ptr<FrontendAction> create() override {
+                return std::make_unique<TransformAction>(transformer, index);
+            }
+        };
+
+        TransformActionFactory factory(transformer, i);
+        if (tool.run(&factory) != 0) {
+            LOG_ERROR("Failed to parse %s for transformation", filenames[i]);
+        }
+    }
+
+    // Emit the diff; the originals are only replaced by write_back, once the
+    // caller has verified the transformed copies
+    FILE *diff_out = stdout;
+    if (transformer->config.diff_file[0]) {
+        diff_out = fopen(transformer->config.diff_file, "w");
+        if (!diff_out) {
+            LOG_ERROR("Failed to open %s: %s", transformer->config.diff_file, strerror(errno));
+            diff_out = stdout;
+        }
+    }
+
+    for (int i = 0; i < file_count; i++) {
+        if (transformer->output_paths[i].empty()) continue;
+        append_unified_diff(filenames[i], transformer->output_paths[i].c_str(), diff_out);
+    }
+
+    if (diff_out != stdout) {
+        fclose(diff_out);
+        LOG_INFO("Wrote unified diff to %s", transformer->config.diff_file);
+    }
+
+    int applied = 0;
+    for (const auto &request : transformer->requests) {
+        if (request.applied) applied++;
+    }
+
+    LOG_INFO("Applied %d of %zu transformations", applied, transformer->requests.size());
+    return applied;
+}
+
+int source_transformer_write_back(source_transformer_t *transformer,
+                                 const char **filenames, int file_count) {
+    if (!transformer || !filenames || file_count > static_cast<int>(transformer->output_paths.size())) {
+        return -1;
+    }
+    if (!transformer->config.in_place) return 0;
+
+    int replaced = 0;
+    for (int i = 0; i < file_count; i++) {
+        if (transformer->output_paths[i].empty()) continue;
+        if (replace_in_place(filenames[i], transformer->output_paths[i].c_str()) == 0) replaced++;
+    }
+    return replaced;
+}
+
+int source_transformer_get_requests(const source_transformer_t *transformer,
+                                   const transform_request_t **requests, int *count) {
+    if (!transformer || !requests || !count) return -1;
+    *requests = transformer->requests.empty() ? nullptr : transformer->requests.data();
+    *count = static_cast<int>(transformer->requests.size());
+    return 0;
+}
+
+const char* source_transformer_output_path(const source_transformer_t *transformer, int file_index) {
+    if (!transformer || file_index < 0 ||
+        file_index >= static_cast<int>(transformer->output_paths.size()) ||
+        transformer->output_paths[file_index].empty()) {
+        return nullptr;
+    }
+    return transformer->output_paths[file_index].c_str();
+}
+
+void source_transformer_print_summary(const source_transformer_t *transformer) {
+    if (!transformer) return;
+
+    printf("\n=== Automatic Transformations ===\n");
+    for (const auto &request : transformer->requests) {
+        printf("  [%s] %-22s %s:%d %s- %s\n",
+               request.applied ? "APPLIED" : "SKIPPED",
+               transform_kind_to_string(request.kind),
+               request.location.file, request.location.line,
+               request.struct_name[0] ? request.struct_name : "",
+               request.status[0] ? request.status : "no matching code");
+    }
+}
+
+transformer_config_t transformer_config_default(void) {
+    transformer_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.in_place = false;
+    strncpy(config.diff_file, "auto_apply.diff", sizeof(config.diff_file) - 1);
+    strncpy(config.work_dir, "cachesight_transformed", sizeof(config.work_dir) - 1);
+    return config;
+}
+
+const char* transform_kind_to_string(transform_kind_t kind) {
+    switch (kind) {
+        case TRANSFORM_ALIGNMENT: return "ALIGNMENT";
+        case TRANSFORM_FIELD_REORDER: return "FIELD_REORDER";
+        case TRANSFORM_LOOP_INTERCHANGE: return "LOOP_INTERCHANGE";
+        case TRANSFORM_PREFETCH: return "PREFETCH";
+        case TRANSFORM_NONTEMPORAL_STORE: return "NONTEMPORAL_STORE";
+        default: return "UNKNOWN";
+    }
+}
+
+} // extern "C"
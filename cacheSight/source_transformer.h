@@ -0,0 +1,78 @@
+#ifndef SOURCE_TRANSFORMER_H
+#define SOURCE_TRANSFORMER_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Source-level transformations that can be applied automatically
+typedef enum {
+    TRANSFORM_ALIGNMENT,           // aligned attribute on a struct or the arrays of a loop
+    TRANSFORM_FIELD_REORDER,       // Reorder struct fields
+    TRANSFORM_LOOP_INTERCHANGE,    // Swap a perfectly nested loop pair
+    TRANSFORM_PREFETCH,            // Insert __builtin_prefetch at the top of a loop body
+    TRANSFORM_NONTEMPORAL_STORE    // Turn streaming stores into non-temporal stores
+} transform_kind_t;
+
+// A single transformation request
+typedef struct {
+    transform_kind_t kind;
+    source_location_t location;     // Loop, or an access inside it
+    char struct_name[128];          // Target struct (alignment/reordering)
+    int field_order[32];            // New position -> original field index
+    int field_count;
+    int alignment;                  // Bytes, for TRANSFORM_ALIGNMENT
+    int prefetch_distance;          // Iterations ahead, for TRANSFORM_PREFETCH
+    int prefetch_locality;          // 0 (NTA) to 3 (T0)
+    bool applied;                   // Set by source_transformer_apply
+    char status[256];               // Why it was applied or skipped
+} transform_request_t;
+
+// Transformer configuration
+typedef struct {
+    bool in_place;                  // Overwrite sources, keeping .orig backups
+    char diff_file[256];            // Unified diff output ("" = stdout)
+    char work_dir[256];             // Where transformed copies are written
+} transformer_config_t;
+
+// Transformer state
+typedef struct source_transformer source_transformer_t;
+
+// API functions
+source_transformer_t* source_transformer_create(const transformer_config_t *config);
+void source_transformer_destroy(source_transformer_t *transformer);
+
+int source_transformer_add_include_path(source_transformer_t *transformer, const char *path);
+int source_transformer_add_define(source_transformer_t *transformer, const char *define);
+int source_transformer_set_std(source_transformer_t *transformer, const char *std);
+
+int source_transformer_add_request(source_transformer_t *transformer,
+                                  const transform_request_t *request);
+
+// Apply all requests to copies of the given files under work_dir and write
+// the diff; returns the number applied or -1
+int source_transformer_apply(source_transformer_t *transformer,
+                            const char **filenames, int file_count);
+
+// With in_place, replace the originals by their transformed copies (keeping
+// .orig backups); call once the copies are verified. Returns files replaced
+int source_transformer_write_back(source_transformer_t *transformer,
+                                 const char **filenames, int file_count);
+
+// Results
+int source_transformer_get_requests(const source_transformer_t *transformer,
+                                   const transform_request_t **requests, int *count);
+const char* source_transformer_output_path(const source_transformer_t *transformer, int file_index);
+void source_transformer_print_summary(const source_transformer_t *transformer);
+
+// Configuration
+transformer_config_t transformer_config_default(void);
+const char* transform_kind_to_string(transform_kind_t kind);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOURCE_TRANSFORMER_H
@@ -0,0 +1,344 @@
+#include "stage_trace.h"
+#include "json_writer.h"
+#include <sys/syscall.h>
+
+// One completed scope
+typedef struct {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint64_t self_ns;                   // Duration minus nested scopes on the same thread
+    uint64_t items;
+    uint64_t alloc_bytes;
+    uint64_t alloc_count;
+    int depth;
+} trace_event_t;
+
+typedef struct trace_chunk {
+    struct trace_chunk *next;
+    int count;
+    trace_event_t events[TRACE_CHUNK_EVENTS];
+} trace_chunk_t;
+
+// Running totals for one stage name
+typedef struct {
+    const char *name;
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t self_ns;
+    uint64_t items;
+    uint64_t alloc_bytes;
+    uint64_t alloc_count;
+} trace_stat_t;
+
+// Written only by its owning thread; kept after the thread exits so the
+// export at the end of the run still sees it
+typedef struct trace_thread {
+    pid_t tid;
+    int depth;
+    uint64_t child_ns[TRACE_MAX_DEPTH];  // Time spent in nested scopes, per open depth
+    trace_chunk_t *chunks;               // Newest first
+    uint64_t event_count;
+    uint64_t dropped;                    // Scopes past TRACE_MAX_EVENTS, summary only
+    trace_stat_t stats[TRACE_STAT_SLOTS];
+    struct trace_thread *next;
+} trace_thread_t;
+
+static struct {
+    bool enabled;
+    uint64_t origin_ns;
+    trace_thread_t *threads;
+    pthread_mutex_t mutex;
+} g_trace = {
+    .enabled = true,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+static __thread trace_thread_t *t_trace;
+
+static uint64_t trace_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Buffers use plain calloc so the tracer's own memory stays out of the
+// allocation counters it reports
+static trace_thread_t* trace_thread_get(void) {
+    if (t_trace) return t_trace;
+    
+    trace_thread_t *thread = calloc(1, sizeof(trace_thread_t));
+    if (!thread) return NULL;
+    thread->tid = (pid_t)syscall(SYS_gettid);
+    
+    pthread_mutex_lock(&g_trace.mutex);
+    if (!g_trace.threads && g_trace.origin_ns == 0) {
+        g_trace.origin_ns = trace_now_ns();
+    }
+    thread->next = g_trace.threads;
+    g_trace.threads = thread;
+    pthread_mutex_unlock(&g_trace.mutex);
+    
+    t_trace = thread;
+    return thread;
+}
+
+void trace_set_enabled(bool enabled) {
+    g_trace.enabled = enabled;
+}
+
+bool trace_is_enabled(void) {
+    return g_trace.enabled;
+}
+
+trace_scope_t trace_begin(const char *name) {
+    trace_scope_t scope = {0};
+    if (!g_trace.enabled) return scope;
+    
+    trace_thread_t *thread = trace_thread_get();
+    if (!thread) return scope;
+    
+    scope.name = name;
+    scope.depth = thread->depth++;
+    if (scope.depth < TRACE_MAX_DEPTH) {
+        thread->child_ns[scope.depth] = 0;
+    }
+    memory_alloc_counters(&scope.alloc_bytes, &scope.alloc_count);
+    scope.active = true;
+    scope.start_ns = trace_now_ns();
+    return scope;
+}
+
+void trace_add_items(trace_scope_t *scope, uint64_t items) {
+    if (scope) scope->items += items;
+}
+
+// Pointer-keyed: every call site passes a string literal
+static trace_stat_t* trace_stat_slot(trace_thread_t *thread, const char *name) {
+    size_t start = ((uintptr_t)name >> 4) & (TRACE_STAT_SLOTS - 1);
+    for (size_t probe = 0; probe < TRACE_STAT_SLOTS; probe++) {
+        trace_stat_t *stat = &thread->stats[(start + probe) & (TRACE_STAT_SLOTS - 1)];
+        if (stat->name == name) return stat;
+        if (!stat->name) {
+            stat->name = name;
+            return stat;
+        }
+    }
+    return NULL;
+}
+
+static trace_event_t* trace_event_slot(trace_thread_t *thread) {
+    if (thread->event_count >= TRACE_MAX_EVENTS) return NULL;
+    
+    trace_chunk_t *chunk = thread->chunks;
+    if (!chunk || chunk->count == TRACE_CHUNK_EVENTS) {
+        chunk = calloc(1, sizeof(trace_chunk_t));
+        if (!chunk) return NULL;
+        chunk->next = thread->chunks;
+        thread->chunks = chunk;
+    }
+    thread->event_count++;
+    return &chunk->events[chunk->count++];
+}
+
+void trace_end(trace_scope_t *scope) {
+    if (!scope || !scope->active) return;
+    scope->active = false;
+    
+    uint64_t end_ns = trace_now_ns();
+    uint64_t alloc_bytes, alloc_count;
+    memory_alloc_counters(&alloc_bytes, &alloc_count);
+    
+    trace_thread_t *thread = t_trace;
+    uint64_t duration = end_ns - scope->start_ns;
+    uint64_t self = duration;
+    thread->depth = scope->depth;
+    if (scope->depth < TRACE_MAX_DEPTH) {
+        uint64_t nested = thread->child_ns[scope->depth];
+        self = nested < duration ? duration - nested : 0;
+    }
+    if (scope->depth > 0 && scope->depth <= TRACE_MAX_DEPTH) {
+        thread->child_ns[scope->depth - 1] += duration;
+    }
+    
+    trace_stat_t *stat = trace_stat_slot(thread, scope->name);
+    if (stat) {
+        stat->calls++;
+        stat->total_ns += duration;
+        stat->self_ns += self;
+        stat->items += scope->items;
+        stat->alloc_bytes += alloc_bytes - scope->alloc_bytes;
+        stat->alloc_count += alloc_count - scope->alloc_count;
+    }
+    
+    trace_event_t *event = trace_event_slot(thread);
+    if (!event) {
+        thread->dropped++;
+        return;
+    }
+    event->name = scope->name;
+    event->start_ns = scope->start_ns;
+    event->duration_ns = duration;
+    event->self_ns = self;
+    event->items = scope->items;
+    event->alloc_bytes = alloc_bytes - scope->alloc_bytes;
+    event->alloc_count = alloc_count - scope->alloc_count;
+    event->depth = scope->depth;
+}
+
+// Chrome trace-event format: complete ("X") events in microseconds, loadable
+// in chrome://tracing and Perfetto
+int trace_write_chrome(const char *path) {
+    if (!path) return -1;
+    
+    json_writer_t *writer = MALLOC_LOGGED(sizeof(json_writer_t));
+    if (!writer) return -1;
+    if (json_writer_open(writer, path, false) != 0) {
+        FREE_LOGGED(writer);
+        return -1;
+    }
+    
+    pid_t pid = getpid();
+    uint64_t events = 0;
+    uint64_t dropped = 0;
+    
+    pthread_mutex_lock(&g_trace.mutex);
+    json_begin_object(writer, NULL);
+    json_string(writer, "displayTimeUnit", "ms");
+    json_begin_array(writer, "traceEvents");
+    
+    for (const trace_thread_t *thread = g_trace.threads; thread; thread = thread->next) {
+        char thread_name[32];
+        snprintf(thread_name, sizeof(thread_name), "%s %d",
+                 thread->tid == pid ? "main" : "worker", (int)thread->tid);
+        json_begin_object(writer, NULL);
+        json_string(writer, "name", "thread_name");
+        json_string(writer, "ph", "M");
+        json_int(writer, "pid", pid);
+        json_int(writer, "tid", thread->tid);
+        json_begin_object(writer, "args");
+        json_string(writer, "name", thread_name);
+        json_end_object(writer);
+        json_end_object(writer);
+        
+        for (const trace_chunk_t *chunk = thread->chunks; chunk; chunk = chunk->next) {
+            for (int i = 0; i < chunk->count; i++) {
+                const trace_event_t *event = &chunk->events[i];
+                json_begin_object(writer, NULL);
+                json_string(writer, "name", event->name);
+                json_string(writer, "cat", "stage");
+                json_string(writer, "ph", "X");
+                json_double(writer, "ts", (event->start_ns - g_trace.origin_ns) / 1000.0);
+                json_double(writer, "dur", event->duration_ns / 1000.0);
+                json_int(writer, "pid", pid);
+                json_int(writer, "tid", thread->tid);
+                json_begin_object(writer, "args");
+                json_double(writer, "self_us", event->self_ns / 1000.0);
+                json_uint(writer, "items", event->items);
+                json_uint(writer, "alloc_bytes", event->alloc_bytes);
+                json_uint(writer, "alloc_count", event->alloc_count);
+                json_end_object(writer);
+                json_end_object(writer);
+            }
+        }
+        events += thread->event_count;
+        dropped += thread->dropped;
+    }
+    
+    json_end_array(writer);
+    json_begin_object(writer, "otherData");
+    json_uint(writer, "dropped_events", dropped);
+    json_end_object(writer);
+    json_end_object(writer);
+    json_end_record(writer);
+    pthread_mutex_unlock(&g_trace.mutex);
+    
+    int ret = json_writer_close(writer);
+    FREE_LOGGED(writer);
+    if (ret == 0) {
+        LOG_INFO("Wrote %lu trace events to %s (%lu beyond the per-thread cap not stored)",
+                 (unsigned long)events, path, (unsigned long)dropped);
+    }
+    return ret;
+}
+
+static int compare_stats_by_total(const void *a, const void *b) {
+    const trace_stat_t *sa = (const trace_stat_t *)a;
+    const trace_stat_t *sb = (const trace_stat_t *)b;
+    if (sa->total_ns != sb->total_ns) return sa->total_ns < sb->total_ns ? 1 : -1;
+    return strcmp(sa->name, sb->name);
+}
+
+// Per-stage totals over all threads, heaviest first
+void trace_print_summary(FILE *fp) {
+    if (!fp) return;
+    
+    trace_stat_t merged[TRACE_STAT_SLOTS];
+    int count = 0;
+    
+    pthread_mutex_lock(&g_trace.mutex);
+    uint64_t wall_ns = g_trace.threads ? trace_now_ns() - g_trace.origin_ns : 0;
+    for (const trace_thread_t *thread = g_trace.threads; thread; thread = thread->next) {
+        for (int s = 0; s < TRACE_STAT_SLOTS; s++) {
+            const trace_stat_t *stat = &thread->stats[s];
+            if (!stat->name) continue;
+            
+            // Same stage from another thread or translation unit
+            int m = 0;
+            while (m < count && strcmp(merged[m].name, stat->name) != 0) m++;
+            if (m == count) {
+                if (count == TRACE_STAT_SLOTS) continue;
+                memset(&merged[count], 0, sizeof(trace_stat_t));
+                merged[count++].name = stat->name;
+            }
+            merged[m].calls += stat->calls;
+            merged[m].total_ns += stat->total_ns;
+            merged[m].self_ns += stat->self_ns;
+            merged[m].items += stat->items;
+            merged[m].alloc_bytes += stat->alloc_bytes;
+            merged[m].alloc_count += stat->alloc_count;
+        }
+    }
+    pthread_mutex_unlock(&g_trace.mutex);
+    
+    if (count == 0) return;
+    qsort(merged, count, sizeof(trace_stat_t), compare_stats_by_total);
+    
+    fprintf(fp, "\n=== Stage Profile (wall %.3f s) ===\n", wall_ns / 1e9);
+    fprintf(fp, "%-32s %8s %11s %11s %6s %12s %12s %10s %9s\n",
+            "Stage", "Calls", "Total ms", "Self ms", "%Wall", "Items", "Items/s", "Alloc MB", "Allocs");
+    for (int i = 0; i < count; i++) {
+        const trace_stat_t *stat = &merged[i];
+        double total_s = stat->total_ns / 1e9;
+        fprintf(fp, "%-32.32s %8lu %11.2f %11.2f %5.1f%% %12lu %12.0f %10.2f %9lu\n",
+                stat->name, (unsigned long)stat->calls,
+                stat->total_ns / 1e6, stat->self_ns / 1e6,
+                wall_ns ? 100.0 * stat->total_ns / wall_ns : 0.0,
+                (unsigned long)stat->items,
+                total_s > 0 ? stat->items / total_s : 0.0,
+                stat->alloc_bytes / (1024.0 * 1024.0),
+                (unsigned long)stat->alloc_count);
+    }
+}
+
+void trace_cleanup(void) {
+    pthread_mutex_lock(&g_trace.mutex);
+    trace_thread_t *thread = g_trace.threads;
+    while (thread) {
+        trace_thread_t *next = thread->next;
+        trace_chunk_t *chunk = thread->chunks;
+        while (chunk) {
+            trace_chunk_t *next_chunk = chunk->next;
+            free(chunk);
+            chunk = next_chunk;
+        }
+        free(thread);
+        thread = next;
+    }
+    g_trace.threads = NULL;
+    g_trace.origin_ns = 0;
+    pthread_mutex_unlock(&g_trace.mutex);
+    
+    // Only the calling thread's pointer can be reset; others must not trace again
+    t_trace = NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef STAGE_TRACE_H
+#define STAGE_TRACE_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_CHUNK_EVENTS 4096
+#define TRACE_MAX_EVENTS 65536         // Stored per thread; later scopes only feed the summary
+#define TRACE_MAX_DEPTH 32
+#define TRACE_STAT_SLOTS 128           // Distinct stage names per thread
+
+// An open scope; lives on the caller's stack
+typedef struct {
+    const char *name;                   // Static string, not copied
+    uint64_t start_ns;
+    uint64_t alloc_bytes;               // Thread totals at begin
+    uint64_t alloc_count;
+    uint64_t items;
+    int depth;
+    bool active;
+} trace_scope_t;
+
+// Tracing is on by default; a disabled scope costs one branch
+void trace_set_enabled(bool enabled);
+bool trace_is_enabled(void);
+
+trace_scope_t trace_begin(const char *name);
+void trace_end(trace_scope_t *scope);
+
+void trace_add_items(trace_scope_t *scope, uint64_t items);
+
+// Timer that closes when var goes out of scope; do not jump into its block
+#define TRACE_SCOPE(var, name) \
+    trace_scope_t var __attribute__((cleanup(trace_end))) = trace_begin(name)
+
+// Export once traced threads are idle, typically at exit
+int trace_write_chrome(const char *path);
+void trace_print_summary(FILE *fp);
+void trace_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STAGE_TRACE_H
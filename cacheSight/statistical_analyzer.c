@@ -1,8 +1,13 @@
 #include "statistical_analyzer.h"
+#include "arena.h"
+#include "stage_trace.h"
 #include <math.h>
 #include <float.h>
 
-static bool g_initialized = false;
+struct statistical_analyzer {
+    statistics_config_t config;
+    arena_t *scratch;               // Temporaries of one call, rewound on return
+};
 
 // Comparison function for qsort
 static int compare_doubles(const void *a, const void *b) {
@@ -13,31 +18,46 @@ static int compare_doubles(const void *a, const void *b) {
     return 0;
 }
 
-// Initialize statistical analyzer
-int statistical_analyzer_init(void) {
-    if (g_initialized) {
-        LOG_WARNING("Statistical analyzer already initialized");
-        return 0;
+// Create statistical analyzer
+statistical_analyzer_t* statistical_analyzer_create(const statistics_config_t *config) {
+    statistical_analyzer_t *analyzer = CALLOC_LOGGED(1, sizeof(statistical_analyzer_t));
+    if (!analyzer) {
+        LOG_ERROR("Failed to allocate statistical analyzer");
+        return NULL;
     }
     
-    LOG_INFO("Initializing statistical analyzer");
-    g_initialized = true;
-    return 0;
+    analyzer->config = config ? *config : statistics_config_default();
+    analyzer->scratch = arena_create(0);
+    if (!analyzer->scratch) {
+        FREE_LOGGED(analyzer);
+        return NULL;
+    }
+    
+    LOG_INFO("Created statistical analyzer");
+    return analyzer;
 }
 
-// Cleanup statistical analyzer
-void statistical_analyzer_cleanup(void) {
-    if (!g_initialized) {
-        return;
-    }
+// Destroy statistical analyzer
+void statistical_analyzer_destroy(statistical_analyzer_t *analyzer) {
+    if (!analyzer) return;
     
-    LOG_INFO("Cleaning up statistical analyzer");
-    g_initialized = false;
+    LOG_INFO("Destroying statistical analyzer");
+    arena_destroy(analyzer->scratch);
+    FREE_LOGGED(analyzer);
+}
+
+statistics_config_t statistics_config_default(void) {
+    statistics_config_t config = {
+        .cache_line_size = 64,
+        .reuse_window = 1000
+    };
+    return config;
 }
 
 // Calculate basic statistics
-int calculate_statistics(const double *data, int count, statistics_t *stats) {
-    if (!data || count <= 0 || !stats) {
+int calculate_statistics(statistical_analyzer_t *analyzer,
+                        const double *data, int count, statistics_t *stats) {
+    if (!analyzer || !data || count <= 0 || !stats) {
         LOG_ERROR("Invalid parameters for calculate_statistics");
         return -1;
     }
@@ -47,7 +67,8 @@ int calculate_statistics(const double *data, int count, statistics_t *stats) {
     memset(stats, 0, sizeof(statistics_t));
     
     // Create sorted copy for percentiles
-    double *sorted = MALLOC_LOGGED(count * sizeof(double));
+    arena_mark_t mark = arena_mark(analyzer->scratch);
+    double *sorted = arena_alloc(analyzer->scratch, count * sizeof(double));
     if (!sorted) {
         LOG_ERROR("Failed to allocate sorted array");
         return -1;
@@ -101,7 +122,7 @@ int calculate_statistics(const double *data, int count, statistics_t *stats) {
         stats->kurtosis = sum_fourth / count - 3.0;  // Excess kurtosis
     }
     
-    FREE_LOGGED(sorted);
+    arena_rewind(analyzer->scratch, mark);
     
     LOG_DEBUG("Statistics: mean=%.2f, median=%.2f, std_dev=%.2f, skew=%.2f",
               stats->mean, stats->median, stats->std_dev, stats->skewness);
@@ -110,27 +131,30 @@ int calculate_statistics(const double *data, int count, statistics_t *stats) {
 }
 
 // Calculate pattern statistics
-int calculate_pattern_statistics(const cache_miss_sample_t *samples, int count,
+int calculate_pattern_statistics(statistical_analyzer_t *analyzer,
+                                const cache_miss_sample_t *samples, int count,
                                 pattern_statistics_t *stats) {
-    if (!samples || count <= 0 || !stats) {
+    if (!analyzer || !samples || count <= 0 || !stats) {
         LOG_ERROR("Invalid parameters for calculate_pattern_statistics");
         return -1;
     }
+    TRACE_SCOPE(trace, "statistics.pattern");
+    trace_add_items(&trace, count);
     
     LOG_INFO("Calculating pattern statistics for %d samples", count);
     
     memset(stats, 0, sizeof(pattern_statistics_t));
     
     // Extract addresses and calculate strides
-    uint64_t *addresses = MALLOC_LOGGED(count * sizeof(uint64_t));
-    double *strides = MALLOC_LOGGED((count - 1) * sizeof(double));
-    double *intervals = MALLOC_LOGGED((count - 1) * sizeof(double));
+    arena_t *scratch = analyzer->scratch;
+    arena_mark_t mark = arena_mark(scratch);
+    uint64_t *addresses = arena_alloc(scratch, count * sizeof(uint64_t));
+    double *strides = arena_alloc(scratch, count * sizeof(double));
+    double *intervals = arena_alloc(scratch, count * sizeof(double));
     
     if (!addresses || !strides || !intervals) {
         LOG_ERROR("Failed to allocate arrays");
-        if (addresses) FREE_LOGGED(addresses);
-        if (strides) FREE_LOGGED(strides);
-        if (intervals) FREE_LOGGED(intervals);
+        arena_rewind(scratch, mark);
         return -1;
     }
     
@@ -146,33 +170,34 @@ int calculate_pattern_statistics(const cache_miss_sample_t *samples, int count,
     }
     
     // Calculate stride statistics
-    calculate_statistics(strides, count - 1, &stats->stride_stats);
+    calculate_statistics(analyzer, strides, count - 1, &stats->stride_stats);
     
     // Calculate access interval statistics
-    calculate_statistics(intervals, count - 1, &stats->access_interval);
+    calculate_statistics(analyzer, intervals, count - 1, &stats->access_interval);
     
     // Detect dominant stride
-    detect_stride_pattern(addresses, count, &stats->dominant_stride,
+    detect_stride_pattern(analyzer, addresses, count, &stats->dominant_stride,
                          &stats->stride_regularity);
     
     // Calculate entropy
     stats->entropy = calculate_entropy(addresses, count);
     
     // Calculate autocorrelation
-    stats->autocorrelation = calculate_autocorrelation(addresses, count, 1);
+    stats->autocorrelation = calculate_autocorrelation(analyzer, addresses, count, 1);
     
     // Calculate reuse distance (simplified)
     // This would need a more sophisticated stack distance algorithm
-    double *reuse_distances = CALLOC_LOGGED(count, sizeof(double));
+    uint64_t line_size = analyzer->config.cache_line_size > 0 ? analyzer->config.cache_line_size : 64;
+    double *reuse_distances = arena_alloc(scratch, count * sizeof(double));
     if (reuse_distances) {
         int reuse_count = 0;
         
         for (int i = 0; i < count; i++) {
             // Find previous access to same cache line
-            uint64_t cache_line = addresses[i] / 64;  // 64-byte cache lines
+            uint64_t cache_line = addresses[i] / line_size;
             
-            for (int j = i - 1; j >= 0 && j >= i - 1000; j--) {
-                if (addresses[j] / 64 == cache_line) {
+            for (int j = i - 1; j >= 0 && j >= i - analyzer->config.reuse_window; j--) {
+                if (addresses[j] / line_size == cache_line) {
                     reuse_distances[reuse_count++] = (double)(i - j);
                     break;
                 }
@@ -180,15 +205,11 @@ int calculate_pattern_statistics(const cache_miss_sample_t *samples, int count,
         }
         
         if (reuse_count > 0) {
-            calculate_statistics(reuse_distances, reuse_count, &stats->reuse_distance);
+            calculate_statistics(analyzer, reuse_distances, reuse_count, &stats->reuse_distance);
         }
-        
-        FREE_LOGGED(reuse_distances);
     }
     
-    FREE_LOGGED(addresses);
-    FREE_LOGGED(strides);
-    FREE_LOGGED(intervals);
+    arena_rewind(scratch, mark);
     
     LOG_INFO("Pattern statistics: entropy=%.2f, autocorr=%.2f, dominant_stride=%d",
              stats->entropy, stats->autocorrelation, stats->dominant_stride);
@@ -231,11 +252,13 @@ double calculate_entropy(const uint64_t *addresses, int count) {
 }
 
 // Calculate autocorrelation
-double calculate_autocorrelation(const uint64_t *addresses, int count, int lag) {
-    if (!addresses || count <= lag) return 0;
+double calculate_autocorrelation(statistical_analyzer_t *analyzer,
+                                 const uint64_t *addresses, int count, int lag) {
+    if (!analyzer || !addresses || count <= lag) return 0;
     
     // Convert to differences
-    double *diffs = MALLOC_LOGGED((count - 1) * sizeof(double));
+    arena_mark_t mark = arena_mark(analyzer->scratch);
+    double *diffs = arena_alloc(analyzer->scratch, (count - 1) * sizeof(double));
     if (!diffs) return 0;
     
     double mean = 0;
@@ -259,16 +282,17 @@ double calculate_autocorrelation(const uint64_t *addresses, int count, int lag)
     
     double autocorr = denominator > 0 ? numerator / denominator : 0;
     
-    FREE_LOGGED(diffs);
+    arena_rewind(analyzer->scratch, mark);
     
     LOG_DEBUG("Autocorrelation at lag %d: %.4f", lag, autocorr);
     return autocorr;
 }
 
 // Detect stride pattern
-int detect_stride_pattern(const uint64_t *addresses, int count,
+int detect_stride_pattern(statistical_analyzer_t *analyzer,
+                         const uint64_t *addresses, int count,
                          int *stride, double *confidence) {
-    if (!addresses || count < 3 || !stride || !confidence) return -1;
+    if (!analyzer || !addresses || count < 3 || !stride || !confidence) return -1;
     
     // Count stride occurrences
     typedef struct {
@@ -276,7 +300,8 @@ int detect_stride_pattern(const uint64_t *addresses, int count,
         int count;
     } stride_count_t;
     
-    stride_count_t *stride_counts = CALLOC_LOGGED(count, sizeof(stride_count_t));
+    arena_mark_t mark = arena_mark(analyzer->scratch);
+    stride_count_t *stride_counts = arena_calloc(analyzer->scratch, count, sizeof(stride_count_t));
     if (!stride_counts) return -1;
     
     int unique_strides = 0;
@@ -316,7 +341,7 @@ int detect_stride_pattern(const uint64_t *addresses, int count,
     *stride = dominant_stride;
     *confidence = (double)max_count / (count - 1);
     
-    FREE_LOGGED(stride_counts);
+    arena_rewind(analyzer->scratch, mark);
     
     LOG_DEBUG("Dominant stride: %d (confidence: %.2f%%)", *stride, *confidence * 100);
     return 0;
@@ -387,11 +412,12 @@ int analyze_correlation(const double *x, const double *y, int count,
 }
 
 // Identify distribution type
-distribution_type_t identify_distribution(const double *data, int count) {
-    if (!data || count < 30) return DIST_UNKNOWN;
+distribution_type_t identify_distribution(statistical_analyzer_t *analyzer,
+                                          const double *data, int count) {
+    if (!analyzer || !data || count < 30) return DIST_UNKNOWN;
     
     statistics_t stats;
-    if (calculate_statistics(data, count, &stats) != 0) {
+    if (calculate_statistics(analyzer, data, count, &stats) != 0) {
         return DIST_UNKNOWN;
     }
     
@@ -430,6 +456,72 @@ distribution_type_t identify_distribution(const double *data, int count) {
     return DIST_UNKNOWN;
 }
 
+// Continued fraction of the incomplete beta function (modified Lentz)
+static double beta_continued_fraction(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double c = 1.0;
+    double d = 1.0 - (a + b) * x / (a + 1.0);
+    if (fabs(d) < tiny) d = tiny;
+    d = 1.0 / d;
+    double h = d;
+    
+    for (int m = 1; m <= 300; m++) {
+        int m2 = 2 * m;
+        double num = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+        d = 1.0 + num * d;
+        if (fabs(d) < tiny) d = tiny;
+        c = 1.0 + num / c;
+        if (fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        h *= d * c;
+        
+        num = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+        d = 1.0 + num * d;
+        if (fabs(d) < tiny) d = tiny;
+        c = 1.0 + num / c;
+        if (fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        double delta = d * c;
+        h *= delta;
+        if (fabs(delta - 1.0) < 1e-14) break;
+    }
+    return h;
+}
+
+// Regularized incomplete beta function I_x(a, b)
+static double incomplete_beta(double a, double b, double x) {
+    if (x <= 0) return 0;
+    if (x >= 1) return 1;
+    
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) +
+                       a * log(x) + b * log(1.0 - x));
+    if (x < (a + 1.0) / (a + b + 2.0)) {
+        return front * beta_continued_fraction(a, b, x) / a;
+    }
+    return 1.0 - front * beta_continued_fraction(b, a, 1.0 - x) / b;
+}
+
+// Two-sided p-value of a t statistic with df degrees of freedom
+double student_t_p_value(double t, double df) {
+    if (df <= 0 || isnan(t)) return 1.0;
+    if (isinf(t)) return 0.0;
+    return incomplete_beta(df / 2.0, 0.5, df / (df + t * t));
+}
+
+// Two-sided critical value: |T| exceeds it with probability alpha
+double student_t_critical(double alpha, double df) {
+    if (alpha <= 0 || alpha >= 1 || df <= 0) return NAN;
+    
+    double low = 0, high = 1;
+    while (student_t_p_value(high, df) > alpha && high < 1e6) high *= 2;
+    for (int i = 0; i < 100 && high - low > 1e-10 * high; i++) {
+        double mid = (low + high) / 2;
+        if (student_t_p_value(mid, df) > alpha) low = mid;
+        else high = mid;
+    }
+    return (low + high) / 2;
+}
+
 // Print statistics
 void print_statistics(const statistics_t *stats, const char *name) {
     if (!stats) return;
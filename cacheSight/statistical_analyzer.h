@@ -39,19 +39,33 @@ typedef struct {
     char description[256];
 } correlation_result_t;
 
+// Analyzer configuration
+typedef struct {
+    int cache_line_size;            // Granularity of reuse distances
+    int reuse_window;               // Accesses searched back for a reuse
+} statistics_config_t;
+
+// Analyzer context. Its scratch space makes one context single-threaded;
+// concurrent analyses each use their own.
+typedef struct statistical_analyzer statistical_analyzer_t;
+
 // API functions
-int statistical_analyzer_init(void);
-void statistical_analyzer_cleanup(void);
+statistical_analyzer_t* statistical_analyzer_create(const statistics_config_t *config);
+void statistical_analyzer_destroy(statistical_analyzer_t *analyzer);
 
 // Basic statistics
-int calculate_statistics(const double *data, int count, statistics_t *stats);
-int calculate_pattern_statistics(const cache_miss_sample_t *samples, int count,
+int calculate_statistics(statistical_analyzer_t *analyzer,
+                        const double *data, int count, statistics_t *stats);
+int calculate_pattern_statistics(statistical_analyzer_t *analyzer,
+                                const cache_miss_sample_t *samples, int count,
                                 pattern_statistics_t *stats);
 
 // Pattern analysis
 double calculate_entropy(const uint64_t *addresses, int count);
-double calculate_autocorrelation(const uint64_t *addresses, int count, int lag);
-int detect_stride_pattern(const uint64_t *addresses, int count,
+double calculate_autocorrelation(statistical_analyzer_t *analyzer,
+                                 const uint64_t *addresses, int count, int lag);
+int detect_stride_pattern(statistical_analyzer_t *analyzer,
+                         const uint64_t *addresses, int count,
                          int *stride, double *confidence);
 
 // Correlation analysis
@@ -69,10 +83,15 @@ typedef enum {
     DIST_UNKNOWN
 } distribution_type_t;
 
-distribution_type_t identify_distribution(const double *data, int count);
+distribution_type_t identify_distribution(statistical_analyzer_t *analyzer,
+                                          const double *data, int count);
 double kolmogorov_smirnov_test(const double *data, int count,
                                distribution_type_t dist);
 
+// Student's t distribution; df may be fractional (Welch-Satterthwaite)
+double student_t_p_value(double t, double df);
+double student_t_critical(double alpha, double df);
+
 // Time series analysis
 int analyze_time_series(const cache_miss_sample_t *samples, int count,
                        double *trend, double *seasonality);
@@ -84,6 +103,7 @@ int cluster_access_patterns(const cache_hotspot_t *hotspots, int count,
                            int **cluster_labels, int *num_clusters);
 
 // Helper functions
+statistics_config_t statistics_config_default(void);
 void print_statistics(const statistics_t *stats, const char *name);
 void print_pattern_statistics(const pattern_statistics_t *stats);
 
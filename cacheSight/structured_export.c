@@ -0,0 +1,402 @@
+#include "structured_export.h"
+#include "stage_trace.h"
+
+// Index of element within an array, or -1 when it points elsewhere
+static int index_in(const void *element, const void *base, int count, size_t size) {
+    if (!element || !base || count <= 0) return -1;
+    
+    const char *p = element;
+    const char *start = base;
+    if (p < start || p >= start + (size_t)count * size) return -1;
+    return (int)((size_t)(p - start) / size);
+}
+
+static void write_location(json_writer_t *writer, const char *key,
+                           const source_location_t *location) {
+    json_begin_object(writer, key);
+    json_string(writer, "file", location->file);
+    json_int(writer, "line", location->line);
+    if (location->column > 0) {
+        json_int(writer, "column", location->column);
+    }
+    if (location->function[0]) {
+        json_string(writer, "function", location->function);
+    }
+    json_end_object(writer);
+}
+
+// Rendered recommendation text, omitted when the template is empty
+static void write_rendered(json_writer_t *writer, const char *key,
+                           const optimization_rec_t *rec, rec_field_t field) {
+    char text[4096];
+    if (recommendation_render(rec, field, text, sizeof(text)) > 0) {
+        json_string(writer, key, text);
+    }
+}
+
+void structured_export_machine(json_writer_t *writer, const cache_info_t *cache_info) {
+    json_string(writer, "cpu_model", cache_info->cpu_model);
+    json_string(writer, "arch", cache_info->arch);
+    json_int(writer, "cores", cache_info->num_cores);
+    json_int(writer, "threads", cache_info->num_threads);
+    json_double(writer, "frequency_ghz", cache_info->cpu_frequency_ghz);
+    json_int(writer, "numa_nodes", cache_info->numa_nodes);
+    json_int(writer, "page_size", cache_info->page_size);
+    json_uint(writer, "total_memory", cache_info->total_memory);
+    json_uint(writer, "memory_bandwidth_gbps", cache_info->memory_bandwidth_gbps);
+    json_double(writer, "memory_latency_ns", cache_info->memory_latency_ns);
+    json_int(writer, "simd_width_bytes", cache_info->simd_width_bytes);
+    
+    json_begin_array(writer, "caches");
+    for (int i = 0; i < cache_info->num_levels; i++) {
+        const cache_level_t *level = &cache_info->levels[i];
+        json_begin_object(writer, NULL);
+        json_int(writer, "level", level->level);
+        json_string(writer, "type", level->type);
+        json_uint(writer, "size", level->size);
+        json_uint(writer, "line_size", level->line_size);
+        json_int(writer, "associativity", level->associativity);
+        json_int(writer, "sets", level->sets);
+        json_int(writer, "latency_cycles", level->latency_cycles);
+        json_bool(writer, "shared", level->shared);
+        json_bool(writer, "inclusive", level->inclusive);
+        json_end_object(writer);
+    }
+    json_end_array(writer);
+}
+
+// Summary of a hotspot's raw samples in one pass; the samples themselves stay out
+static void write_sample_summary(json_writer_t *writer, const cache_hotspot_t *hotspot) {
+    uint64_t writes = 0;
+    uint64_t latency_min = UINT64_MAX, latency_max = 0;
+    uint64_t first = UINT64_MAX, last = 0;
+    uint64_t per_level[4] = {0};
+    double latency_mean = 0, latency_m2 = 0;
+    
+    for (size_t i = 0; i < hotspot->sample_count; i++) {
+        const cache_miss_sample_t *s = &hotspot->samples[i];
+        writes += s->is_write;
+        
+        // Welford's update; diff mode tests latency changes against the variance
+        double delta = (double)s->latency_cycles - latency_mean;
+        latency_mean += delta / (double)(i + 1);
+        latency_m2 += delta * ((double)s->latency_cycles - latency_mean);
+        
+        if (s->latency_cycles < latency_min) latency_min = s->latency_cycles;
+        if (s->latency_cycles > latency_max) latency_max = s->latency_cycles;
+        if (s->timestamp < first) first = s->timestamp;
+        if (s->timestamp > last) last = s->timestamp;
+        if (s->cache_level_missed >= 1 && s->cache_level_missed <= 4) {
+            per_level[s->cache_level_missed - 1]++;
+        }
+    }
+    
+    json_begin_object(writer, "samples");
+    json_uint(writer, "count", hotspot->sample_count);
+    if (hotspot->samples && hotspot->sample_count > 0) {
+        json_uint(writer, "writes", writes);
+        json_uint(writer, "latency_min_cycles", latency_min);
+        json_uint(writer, "latency_max_cycles", latency_max);
+        json_double(writer, "latency_mean_cycles", latency_mean);
+        json_double(writer, "latency_var_cycles",
+                    hotspot->sample_count > 1 ? latency_m2 / (double)(hotspot->sample_count - 1) : 0);
+        json_uint(writer, "first_timestamp", first);
+        json_uint(writer, "last_timestamp", last);
+        json_begin_array(writer, "misses_by_level");
+        for (int l = 0; l < 4; l++) {
+            json_uint(writer, NULL, per_level[l]);
+        }
+        json_end_array(writer);
+    }
+    json_end_object(writer);
+}
+
+void structured_export_hotspot(json_writer_t *writer, const cache_hotspot_t *hotspot, int id) {
+    json_int(writer, "id", id);
+    write_location(writer, "location", &hotspot->location);
+    json_uint(writer, "total_misses", hotspot->total_misses);
+    json_uint(writer, "total_accesses", hotspot->total_accesses);
+    json_double(writer, "miss_rate", hotspot->miss_rate);
+    json_double(writer, "avg_latency_cycles", hotspot->avg_latency_cycles);
+    json_string(writer, "dominant_pattern", access_pattern_to_string(hotspot->dominant_pattern));
+    json_int(writer, "access_stride", hotspot->access_stride);
+    json_uint(writer, "address_start", hotspot->address_range_start);
+    json_uint(writer, "address_end", hotspot->address_range_end);
+    json_uint(writer, "footprint_bytes",
+              hotspot->address_range_end > hotspot->address_range_start ?
+              hotspot->address_range_end - hotspot->address_range_start : 0);
+    
+    json_begin_array(writer, "cache_levels_affected");
+    for (int l = 0; l < 4; l++) {
+        json_int(writer, NULL, hotspot->cache_levels_affected[l]);
+    }
+    json_end_array(writer);
+    
+    json_bool(writer, "false_sharing", hotspot->is_false_sharing);
+    if (hotspot->cycles_per_iteration > 0) {
+        json_double(writer, "cycles_per_iteration", hotspot->cycles_per_iteration);
+    }
+    write_sample_summary(writer, hotspot);
+}
+
+void structured_export_pattern(json_writer_t *writer, const analysis_export_t *analysis,
+                              const classified_pattern_t *pattern, int id) {
+    json_int(writer, "id", id);
+    json_int(writer, "hotspot", index_in(pattern->hotspot, analysis->hotspots,
+                                         analysis->hotspot_count, sizeof(cache_hotspot_t)));
+    json_string(writer, "type", cache_antipattern_to_string(pattern->type));
+    json_double(writer, "severity", pattern->severity_score);
+    json_double(writer, "confidence", pattern->confidence);
+    json_string(writer, "miss_type", miss_type_to_string(pattern->primary_miss_type));
+    
+    json_begin_array(writer, "cache_levels");
+    for (int l = 0; l < 4; l++) {
+        if (pattern->affected_cache_levels & (1 << l)) {
+            json_int(writer, NULL, l + 1);
+        }
+    }
+    json_end_array(writer);
+    
+    json_double(writer, "performance_impact", pattern->performance_impact);
+    json_string(writer, "description", pattern->description);
+    json_string(writer, "root_cause", pattern->root_cause);
+}
+
+void structured_export_recommendation(json_writer_t *writer, const analysis_export_t *analysis,
+                                     const optimization_rec_t *rec, int id) {
+    json_int(writer, "id", id);
+    json_int(writer, "pattern", index_in(rec->pattern, analysis->patterns,
+                                         analysis->pattern_count, sizeof(classified_pattern_t)));
+    if (rec->pattern && rec->pattern->hotspot) {
+        json_int(writer, "hotspot", index_in(rec->pattern->hotspot, analysis->hotspots,
+                                             analysis->hotspot_count, sizeof(cache_hotspot_t)));
+        write_location(writer, "location", &rec->pattern->hotspot->location);
+    }
+    json_string(writer, "type", optimization_type_to_string(rec->type));
+    json_int(writer, "priority", rec->priority);
+    json_double(writer, "expected_improvement", rec->expected_improvement);
+    json_double(writer, "confidence", rec->confidence_score);
+    json_int(writer, "difficulty", rec->implementation_difficulty);
+    json_bool(writer, "automatic", rec->is_automatic);
+    json_double(writer, "cycles_saved", rec->cycles_saved);
+    json_double(writer, "predicted_miss_reduction", rec->predicted_miss_reduction);
+    
+    if (rec->prefetch_distance > 0) {
+        json_int(writer, "prefetch_distance", rec->prefetch_distance);
+        json_int(writer, "prefetch_locality", rec->prefetch_locality);
+    }
+    if (rec->measured_speedup > 0) {
+        json_begin_object(writer, "measured");
+        json_double(writer, "speedup", rec->measured_speedup);
+        json_double(writer, "ci_low", rec->speedup_ci_low);
+        json_double(writer, "ci_high", rec->speedup_ci_high);
+        json_end_object(writer);
+    }
+    
+    write_rendered(writer, "rationale", rec, REC_FIELD_RATIONALE);
+    write_rendered(writer, "flags", rec, REC_FIELD_FLAGS);
+    write_rendered(writer, "guide", rec, REC_FIELD_GUIDE);
+    write_rendered(writer, "code", rec, REC_FIELD_CODE);
+}
+
+static void write_simulation(json_writer_t *writer, const evaluation_metrics_t *metrics) {
+    json_double(writer, "cache_line_utilization", metrics->cache_line_utilization);
+    json_double(writer, "temporal_locality", metrics->temporal_locality_score);
+    json_double(writer, "spatial_locality", metrics->spatial_locality_score);
+    json_uint(writer, "loop_footprint_bytes", metrics->loop_footprint_bytes);
+    json_double(writer, "prefetch_accuracy", metrics->prefetch_accuracy);
+    json_double(writer, "prefetch_coverage", metrics->prefetch_coverage);
+    json_double(writer, "thread_contention", metrics->thread_contention_score);
+    json_double(writer, "memory_bandwidth_utilization", metrics->memory_bandwidth_utilization);
+    
+    json_begin_array(writer, "miss_rate_by_level");
+    for (int l = 0; l < 4; l++) {
+        json_double(writer, NULL, metrics->cache_miss_rate[l]);
+    }
+    json_end_array(writer);
+    
+    json_begin_array(writer, "miss_latency_histogram");
+    for (int b = 0; b < 32; b++) {
+        json_uint(writer, NULL, metrics->miss_latency_histogram[b]);
+    }
+    json_end_array(writer);
+}
+
+static void write_kernel(json_writer_t *writer, const microkernel_result_t *kernel) {
+    json_string(writer, "type", optimization_type_to_string(kernel->type));
+    write_location(writer, "location", &kernel->location);
+    json_bool(writer, "valid", kernel->valid);
+    if (kernel->valid) {
+        json_double(writer, "baseline_ns", kernel->baseline_ns);
+        json_double(writer, "transformed_ns", kernel->transformed_ns);
+        json_double(writer, "speedup", kernel->speedup);
+        json_double(writer, "ci_low", kernel->ci_low);
+        json_double(writer, "ci_high", kernel->ci_high);
+        json_double(writer, "confidence_level", kernel->confidence_level);
+        json_double(writer, "p_value", kernel->p_value);
+        json_bool(writer, "significant", kernel->significant);
+    }
+    json_uint(writer, "footprint_bytes", kernel->params.footprint_bytes);
+    json_int(writer, "stride_bytes", kernel->params.stride_bytes);
+    if (kernel->notes[0]) {
+        json_string(writer, "notes", kernel->notes);
+    }
+}
+
+static void write_run(json_writer_t *writer, const analysis_export_t *analysis) {
+    json_string(writer, "schema", STRUCTURED_EXPORT_SCHEMA);
+    json_int(writer, "version", STRUCTURED_EXPORT_VERSION);
+    json_uint(writer, "timestamp", (uint64_t)time(NULL));
+    json_uint(writer, "total_samples", analysis->total_samples);
+    json_uint(writer, "sample_period", analysis->sample_period);
+    json_double(writer, "sampling_duration", analysis->sampling_duration);
+    json_int(writer, "hotspot_count", analysis->hotspot_count);
+    json_int(writer, "pattern_count", analysis->pattern_count);
+    json_int(writer, "recommendation_count", analysis->rec_count);
+}
+
+// NDJSON: every record is a flat object on its own line, tagged with its kind
+static void write_ndjson(json_writer_t *writer, const analysis_export_t *analysis) {
+    json_begin_object(writer, NULL);
+    json_string(writer, "record", "run");
+    write_run(writer, analysis);
+    json_end_object(writer);
+    json_end_record(writer);
+    
+    if (analysis->cache_info) {
+        json_begin_object(writer, NULL);
+        json_string(writer, "record", "machine");
+        structured_export_machine(writer, analysis->cache_info);
+        json_end_object(writer);
+        json_end_record(writer);
+    }
+    
+    for (int i = 0; i < analysis->hotspot_count; i++) {
+        json_begin_object(writer, NULL);
+        json_string(writer, "record", "hotspot");
+        structured_export_hotspot(writer, &analysis->hotspots[i], i);
+        json_end_object(writer);
+        json_end_record(writer);
+    }
+    
+    for (int i = 0; i < analysis->pattern_count; i++) {
+        json_begin_object(writer, NULL);
+        json_string(writer, "record", "pattern");
+        structured_export_pattern(writer, analysis, &analysis->patterns[i], i);
+        json_end_object(writer);
+        json_end_record(writer);
+    }
+    
+    for (int i = 0; i < analysis->rec_count; i++) {
+        json_begin_object(writer, NULL);
+        json_string(writer, "record", "recommendation");
+        structured_export_recommendation(writer, analysis, &analysis->recommendations[i], i);
+        json_end_object(writer);
+        json_end_record(writer);
+    }
+    
+    if (analysis->simulation) {
+        json_begin_object(writer, NULL);
+        json_string(writer, "record", "simulation");
+        write_simulation(writer, analysis->simulation);
+        json_end_object(writer);
+        json_end_record(writer);
+    }
+    
+    for (int i = 0; i < analysis->kernel_count; i++) {
+        json_begin_object(writer, NULL);
+        json_string(writer, "record", "microkernel");
+        write_kernel(writer, &analysis->kernels[i]);
+        json_end_object(writer);
+        json_end_record(writer);
+    }
+}
+
+static void write_document(json_writer_t *writer, const analysis_export_t *analysis) {
+    json_begin_object(writer, NULL);
+    write_run(writer, analysis);
+    
+    if (analysis->cache_info) {
+        json_begin_object(writer, "machine");
+        structured_export_machine(writer, analysis->cache_info);
+        json_end_object(writer);
+    }
+    
+    json_begin_array(writer, "hotspots");
+    for (int i = 0; i < analysis->hotspot_count; i++) {
+        json_begin_object(writer, NULL);
+        structured_export_hotspot(writer, &analysis->hotspots[i], i);
+        json_end_object(writer);
+    }
+    json_end_array(writer);
+    
+    json_begin_array(writer, "patterns");
+    for (int i = 0; i < analysis->pattern_count; i++) {
+        json_begin_object(writer, NULL);
+        structured_export_pattern(writer, analysis, &analysis->patterns[i], i);
+        json_end_object(writer);
+    }
+    json_end_array(writer);
+    
+    json_begin_array(writer, "recommendations");
+    for (int i = 0; i < analysis->rec_count; i++) {
+        json_begin_object(writer, NULL);
+        structured_export_recommendation(writer, analysis, &analysis->recommendations[i], i);
+        json_end_object(writer);
+    }
+    json_end_array(writer);
+    
+    if (analysis->simulation) {
+        json_begin_object(writer, "simulation");
+        write_simulation(writer, analysis->simulation);
+        json_end_object(writer);
+    }
+    
+    json_begin_array(writer, "microkernels");
+    for (int i = 0; i < analysis->kernel_count; i++) {
+        json_begin_object(writer, NULL);
+        write_kernel(writer, &analysis->kernels[i]);
+        json_end_object(writer);
+    }
+    json_end_array(writer);
+    
+    json_end_object(writer);
+    json_end_record(writer);
+}
+
+// Write the analysis as one JSON document or as NDJSON records
+int structured_export_write(const analysis_export_t *analysis, export_format_t format,
+                           const char *path) {
+    if (!analysis || !path) return -1;
+    TRACE_SCOPE(trace, "export.structured");
+    
+    // The writer carries its output chunk; keep it off the stack
+    json_writer_t *writer = MALLOC_LOGGED(sizeof(json_writer_t));
+    if (!writer) return -1;
+    
+    if (json_writer_open(writer, path, format == EXPORT_FORMAT_JSON) != 0) {
+        FREE_LOGGED(writer);
+        return -1;
+    }
+    
+    if (format == EXPORT_FORMAT_NDJSON) {
+        write_ndjson(writer, analysis);
+    } else {
+        write_document(writer, analysis);
+    }
+    
+    uint64_t records = writer->records;
+    int ret = json_writer_close(writer);
+    size_t bytes = writer->bytes_written;
+    FREE_LOGGED(writer);
+    
+    if (ret != 0) {
+        LOG_ERROR("Failed to write structured export %s", path);
+        return -1;
+    }
+    
+    LOG_INFO("Exported %d hotspots, %d patterns, %d recommendations to %s (%s, %zu bytes, %lu records)",
+             analysis->hotspot_count, analysis->pattern_count, analysis->rec_count, path,
+             format == EXPORT_FORMAT_NDJSON ? "NDJSON" : "JSON", bytes, (unsigned long)records);
+    return 0;
+}
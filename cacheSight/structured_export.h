@@ -0,0 +1,52 @@
+#ifndef STRUCTURED_EXPORT_H
+#define STRUCTURED_EXPORT_H
+
+#include "common.h"
+#include "hardware_detector.h"
+#include "sample_collector.h"
+#include "pattern_classifier.h"
+#include "recommendation_engine.h"
+#include "evaluator.h"
+#include "microkernel.h"
+#include "json_writer.h"
+
+#define STRUCTURED_EXPORT_SCHEMA "cachesight.analysis"
+#define STRUCTURED_EXPORT_VERSION 1
+
+// Output layout
+typedef enum {
+    EXPORT_FORMAT_JSON,             // One document with an array per record kind
+    EXPORT_FORMAT_NDJSON            // One {"record": kind, ...} object per line
+} export_format_t;
+
+// Everything one run produced; NULL or zero-count members are left out.
+// Patterns and recommendations refer to hotspots and patterns by index.
+typedef struct {
+    const cache_info_t *cache_info;
+    uint64_t total_samples;
+    double sampling_duration;
+    uint64_t sample_period;
+    const cache_hotspot_t *hotspots;
+    int hotspot_count;
+    const classified_pattern_t *patterns;
+    int pattern_count;
+    const optimization_rec_t *recommendations;
+    int rec_count;
+    const evaluation_metrics_t *simulation;     // Simulated cache behaviour of the hotspots
+    const microkernel_result_t *kernels;        // Measured microkernel speedups
+    int kernel_count;
+} analysis_export_t;
+
+// API functions
+int structured_export_write(const analysis_export_t *analysis, export_format_t format,
+                           const char *path);
+
+// Record writers; each emits the fields of an object the caller has opened
+void structured_export_machine(json_writer_t *writer, const cache_info_t *cache_info);
+void structured_export_hotspot(json_writer_t *writer, const cache_hotspot_t *hotspot, int id);
+void structured_export_pattern(json_writer_t *writer, const analysis_export_t *analysis,
+                              const classified_pattern_t *pattern, int id);
+void structured_export_recommendation(json_writer_t *writer, const analysis_export_t *analysis,
+                                     const optimization_rec_t *rec, int id);
+
+#endif // STRUCTURED_EXPORT_H
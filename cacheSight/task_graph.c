@@ -0,0 +1,234 @@
+#include "task_graph.h"
+#include "stage_trace.h"
+
+#define TASK_GRAPH_INITIAL_CAPACITY 16
+#define TASK_GRAPH_MAX_WORKERS 64
+
+typedef struct {
+    const char *name;               // Static string, not copied
+    task_fn_t fn;
+    void *arg;
+    int result;
+    int pending;                    // Prerequisites not yet finished
+    bool ran;
+} task_t;
+
+// prerequisite must finish before task starts
+typedef struct {
+    int prerequisite;
+    int task;
+} task_edge_t;
+
+struct task_graph {
+    task_t *tasks;
+    int task_count;
+    int task_capacity;
+    task_edge_t *edges;
+    int edge_count;
+    int edge_capacity;
+    int workers;
+    
+    // Run state, guarded by mutex
+    int *ready;                     // FIFO of runnable task ids; each enters once
+    int ready_head;
+    int ready_tail;
+    int running;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+};
+
+task_graph_t* task_graph_create(int workers) {
+    task_graph_t *graph = CALLOC_LOGGED(1, sizeof(task_graph_t));
+    if (!graph) {
+        LOG_ERROR("Failed to allocate task graph");
+        return NULL;
+    }
+    
+    if (workers <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (int)cpus : 1;
+    }
+    graph->workers = workers < TASK_GRAPH_MAX_WORKERS ? workers : TASK_GRAPH_MAX_WORKERS;
+    
+    pthread_mutex_init(&graph->mutex, NULL);
+    pthread_cond_init(&graph->changed, NULL);
+    return graph;
+}
+
+void task_graph_destroy(task_graph_t *graph) {
+    if (!graph) return;
+    
+    pthread_mutex_destroy(&graph->mutex);
+    pthread_cond_destroy(&graph->changed);
+    free(graph->tasks);
+    free(graph->edges);
+    FREE_LOGGED(graph);
+}
+
+int task_graph_add(task_graph_t *graph, const char *name, task_fn_t fn, void *arg) {
+    if (!graph || !name || !fn) {
+        LOG_ERROR("Invalid parameters for task_graph_add");
+        return -1;
+    }
+    
+    if (graph->task_count == graph->task_capacity) {
+        int capacity = graph->task_capacity ? graph->task_capacity * 2 : TASK_GRAPH_INITIAL_CAPACITY;
+        task_t *grown = realloc(graph->tasks, capacity * sizeof(task_t));
+        if (!grown) {
+            LOG_ERROR("Failed to grow task graph to %d tasks", capacity);
+            return -1;
+        }
+        graph->tasks = grown;
+        graph->task_capacity = capacity;
+    }
+    
+    task_t *task = &graph->tasks[graph->task_count];
+    memset(task, 0, sizeof(task_t));
+    task->name = name;
+    task->fn = fn;
+    task->arg = arg;
+    task->result = -1;
+    return graph->task_count++;
+}
+
+int task_graph_depend(task_graph_t *graph, int task, int prerequisite) {
+    if (!graph || task < 0 || task >= graph->task_count ||
+        prerequisite < 0 || prerequisite >= graph->task_count || task == prerequisite) {
+        LOG_ERROR("Invalid dependency %d -> %d", prerequisite, task);
+        return -1;
+    }
+    
+    if (graph->edge_count == graph->edge_capacity) {
+        int capacity = graph->edge_capacity ? graph->edge_capacity * 2 : TASK_GRAPH_INITIAL_CAPACITY;
+        task_edge_t *grown = realloc(graph->edges, capacity * sizeof(task_edge_t));
+        if (!grown) {
+            LOG_ERROR("Failed to grow task graph to %d dependencies", capacity);
+            return -1;
+        }
+        graph->edges = grown;
+        graph->edge_capacity = capacity;
+    }
+    
+    graph->edges[graph->edge_count].prerequisite = prerequisite;
+    graph->edges[graph->edge_count].task = task;
+    graph->edge_count++;
+    return 0;
+}
+
+// Pulls runnable tasks until none is ready and none is running; a finished
+// task releases the dependents it was the last prerequisite of
+static void* task_worker(void *arg) {
+    task_graph_t *graph = (task_graph_t *)arg;
+    
+    pthread_mutex_lock(&graph->mutex);
+    for (;;) {
+        while (graph->ready_head == graph->ready_tail && graph->running > 0) {
+            pthread_cond_wait(&graph->changed, &graph->mutex);
+        }
+        if (graph->ready_head == graph->ready_tail) break;
+        
+        task_t *task = &graph->tasks[graph->ready[graph->ready_head++]];
+        graph->running++;
+        pthread_mutex_unlock(&graph->mutex);
+        
+        LOG_DEBUG("Task %s started", task->name);
+        int result = task->fn(task->arg);
+        LOG_DEBUG("Task %s finished: %d", task->name, result);
+        
+        pthread_mutex_lock(&graph->mutex);
+        task->result = result;
+        task->ran = true;
+        graph->running--;
+        
+        // Dependents are released whatever the result; they guard their inputs
+        int id = (int)(task - graph->tasks);
+        for (int e = 0; e < graph->edge_count; e++) {
+            if (graph->edges[e].prerequisite != id) continue;
+            
+            int dependent = graph->edges[e].task;
+            if (--graph->tasks[dependent].pending == 0) {
+                graph->ready[graph->ready_tail++] = dependent;
+            }
+        }
+        pthread_cond_broadcast(&graph->changed);
+    }
+    pthread_mutex_unlock(&graph->mutex);
+    return NULL;
+}
+
+int task_graph_run(task_graph_t *graph) {
+    if (!graph) {
+        LOG_ERROR("NULL task graph");
+        return -1;
+    }
+    if (graph->task_count == 0) return 0;
+    TRACE_SCOPE(trace, "task_graph.run");
+    trace_add_items(&trace, graph->task_count);
+    
+    graph->ready = MALLOC_LOGGED(graph->task_count * sizeof(int));
+    if (!graph->ready) {
+        LOG_ERROR("Failed to allocate task queue");
+        return -1;
+    }
+    graph->ready_head = 0;
+    graph->ready_tail = 0;
+    graph->running = 0;
+    
+    for (int t = 0; t < graph->task_count; t++) {
+        graph->tasks[t].pending = 0;
+        graph->tasks[t].result = -1;
+        graph->tasks[t].ran = false;
+    }
+    for (int e = 0; e < graph->edge_count; e++) {
+        graph->tasks[graph->edges[e].task].pending++;
+    }
+    for (int t = 0; t < graph->task_count; t++) {
+        if (graph->tasks[t].pending == 0) graph->ready[graph->ready_tail++] = t;
+    }
+    
+    // The calling thread is one of the workers
+    int helpers = (graph->workers < graph->task_count ? graph->workers : graph->task_count) - 1;
+    pthread_t threads[TASK_GRAPH_MAX_WORKERS];
+    int started = 0;
+    for (int i = 0; i < helpers; i++) {
+        int rc = pthread_create(&threads[started], NULL, task_worker, graph);
+        if (rc != 0) {
+            LOG_WARNING("Failed to start task worker: %s", strerror(rc));
+            break;
+        }
+        started++;
+    }
+    
+    task_worker(graph);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    FREE_LOGGED(graph->ready);
+    graph->ready = NULL;
+    
+    int ret = 0;
+    int ran = 0;
+    for (int t = 0; t < graph->task_count; t++) {
+        const task_t *task = &graph->tasks[t];
+        ran += task->ran;
+        if (!task->ran) {
+            LOG_ERROR("Task %s never ran: its dependencies form a cycle", task->name);
+            ret = -1;
+        } else if (task->result != 0) {
+            ret = -1;
+        }
+    }
+    
+    LOG_INFO("Ran %d of %d tasks on %d workers", ran, graph->task_count, started + 1);
+    return ret;
+}
+
+int task_graph_result(const task_graph_t *graph, int task) {
+    if (!graph || task < 0 || task >= graph->task_count) return -1;
+    return graph->tasks[task].result;
+}
+
+int task_graph_task_count(const task_graph_t *graph) {
+    return graph ? graph->task_count : 0;
+}
@@ -0,0 +1,42 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns 0 on success; the value is kept as the task's result
+typedef int (*task_fn_t)(void *arg);
+
+// Tasks with prerequisites, run by a fixed pool of worker threads. A task
+// starts once every prerequisite has finished, whatever their results, so
+// partial failures do not stall the graph. Each task must therefore guard
+// its own inputs: check the outputs it depends on rather than assume its
+// prerequisites succeeded. task_graph_result reports who failed.
+typedef struct task_graph task_graph_t;
+
+// API functions
+// workers <= 0 uses one per online CPU; 1 runs the tasks in the order added
+// as far as the dependencies allow
+task_graph_t* task_graph_create(int workers);
+void task_graph_destroy(task_graph_t *graph);
+
+// Returns the task's id, or -1. name must be a static string.
+int task_graph_add(task_graph_t *graph, const char *name, task_fn_t fn, void *arg);
+int task_graph_depend(task_graph_t *graph, int task, int prerequisite);
+
+// Runs every task and returns once all have finished. Returns 0 when every
+// task returned 0, -1 otherwise or when the dependencies form a cycle.
+int task_graph_run(task_graph_t *graph);
+
+// A task's return value; -1 for a task that never ran
+int task_graph_result(const task_graph_t *graph, int task);
+int task_graph_task_count(const task_graph_t *graph);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TASK_GRAPH_H
@@ -0,0 +1,1466 @@
+#define _GNU_SOURCE
+#include "tile_autotuner.h"
+#include "evaluator.h"
+#include "stage_trace.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define KERNEL_PAD 8
+#define CHECKSUM_TOLERANCE 1e-9
+#define MAX_NEST_DEPTH 3
+#define MAX_KERNEL_SYMBOLS 64
+
+// Canonical loop parsed from source text
+typedef struct {
+    char var[32];
+    char lower[128];
+    char upper[128];              // Exclusive bound
+    bool declares_var;            // "for (int i = ...)"
+    size_t begin;                 // Offset of "for"
+    size_t body_begin;            // Body statement (including braces)
+    size_t end;                   // One past the body statement
+} parsed_loop_t;
+
+// Free identifier the kernel has to declare
+typedef struct {
+    char name[64];
+    int dims;                     // Subscript count, 0 for scalars
+    bool is_int;                  // Used in a subscript or loop header
+    bool in_bound;                // Used in a tiled loop bound
+    char subscripts[3][128];      // First access, for the footprint model
+} kernel_symbol_t;
+
+typedef struct {
+    parsed_loop_t loops[MAX_NEST_DEPTH];
+    int depth;
+    kernel_symbol_t symbols[MAX_KERNEL_SYMBOLS];
+    int symbol_count;
+    int max_literal_bound;
+} kernel_nest_t;
+
+static const char *c_keywords[] = {
+    "int", "long", "short", "char", "float", "double", "unsigned", "signed", "const",
+    "size_t", "for", "if", "else", "while", "do", "return", "sizeof", "break", "continue",
+    "static", "register", "volatile", "restrict", "void", "goto", "switch", "case", "default",
+    NULL
+};
+
+static const char *type_keywords[] = {
+    "int", "long", "short", "char", "float", "double", "unsigned", "signed", "size_t", NULL
+};
+
+// Calls a kernel may contain; everything else cannot be extracted
+static const char *libm_functions[] = {
+    "sqrt", "fabs", "exp", "log", "sin", "cos", "tan", "pow", "fmin", "fmax", "floor", "ceil",
+    "sqrtf", "fabsf", "expf", "logf", "fminf", "fmaxf", NULL
+};
+
+static bool in_list(const char *word, const char **list) {
+    for (int i = 0; list[i]; i++) {
+        if (strcmp(word, list[i]) == 0) return true;
+    }
+    return false;
+}
+
+static bool is_ident_char(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+// Short hash of a source path; keeps kernels of same-line nests in
+// different files apart in the work directory
+static unsigned int path_tag(const char *path) {
+    unsigned int hash = 5381;
+    for (const char *c = path; *c; c++) hash = hash * 33 + (unsigned char)*c;
+    return hash;
+}
+
+static char* read_source_file(const char *path, size_t *length) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        LOG_ERROR("Failed to open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char *buffer = MALLOC_LOGGED(size + 1);
+    if (!buffer) {
+        fclose(fp);
+        return NULL;
+    }
+
+    *length = fread(buffer, 1, size, fp);
+    buffer[*length] = '\0';
+    fclose(fp);
+    return buffer;
+}
+
+// Skip whitespace and comments
+static size_t skip_space(const char *text, size_t pos, size_t end) {
+    while (pos < end) {
+        if (isspace((unsigned char)text[pos])) {
+            pos++;
+        } else if (text[pos] == '/' && pos + 1 < end && text[pos + 1] == '/') {
+            while (pos < end && text[pos] != '\n') pos++;
+        } else if (text[pos] == '/' && pos + 1 < end && text[pos + 1] == '*') {
+            pos += 2;
+            while (pos + 1 < end && !(text[pos] == '*' && text[pos + 1] == '/')) pos++;
+            pos += 2;
+        } else {
+            break;
+        }
+    }
+    return pos < end ? pos : end;
+}
+
+// Offset of the bracket matching text[open], or `end` if unbalanced
+static size_t match_bracket(const char *text, size_t open, size_t end) {
+    char open_char = text[open];
+    char close_char = open_char == '(' ? ')' : open_char == '[' ? ']' : '}';
+    int depth = 0;
+
+    for (size_t pos = open; pos < end; pos++) {
+        char c = text[pos];
+        if (c == '"' || c == '\'') {
+            for (pos++; pos < end && text[pos] != c; pos++) {
+                if (text[pos] == '\\') pos++;
+            }
+        } else if (c == '/' && pos + 1 < end && (text[pos + 1] == '/' || text[pos + 1] == '*')) {
+            pos = skip_space(text, pos, end) - 1;
+        } else if (c == open_char) {
+            depth++;
+        } else if (c == close_char && --depth == 0) {
+            return pos;
+        }
+    }
+    return end;
+}
+
+static void copy_trimmed(char *dst, size_t size, const char *src, size_t length) {
+    while (length > 0 && isspace((unsigned char)*src)) { src++; length--; }
+    while (length > 0 && isspace((unsigned char)src[length - 1])) length--;
+    if (length >= size) length = size - 1;
+    memcpy(dst, src, length);
+    dst[length] = '\0';
+}
+
+static bool starts_with_keyword(const char *text, size_t pos, size_t end, const char *keyword) {
+    size_t len = strlen(keyword);
+    return pos + len <= end && strncmp(text + pos, keyword, len) == 0 &&
+           (pos + len == end || !is_ident_char(text[pos + len]));
+}
+
+// End of the statement starting at pos
+static size_t statement_end(const char *text, size_t pos, size_t end) {
+    pos = skip_space(text, pos, end);
+    if (pos >= end) return end;
+
+    if (text[pos] == '{') {
+        size_t close = match_bracket(text, pos, end);
+        return close < end ? close + 1 : end;
+    }
+    if (starts_with_keyword(text, pos, end, "for") || starts_with_keyword(text, pos, end, "while")) {
+        size_t paren = skip_space(text, pos + 3 + (text[pos] == 'w' ? 2 : 0), end);
+        if (paren >= end || text[paren] != '(') return end;
+        size_t close = match_bracket(text, paren, end);
+        return close < end ? statement_end(text, close + 1, end) : end;
+    }
+
+    // Plain statement: up to the next ';' outside brackets
+    int depth = 0;
+    for (; pos < end; pos++) {
+        if (text[pos] == '(' || text[pos] == '[' || text[pos] == '{') depth++;
+        else if (text[pos] == ')' || text[pos] == ']' || text[pos] == '}') depth--;
+        else if (text[pos] == ';' && depth == 0) return pos + 1;
+    }
+    return end;
+}
+
+// Parse "for (init; cond; inc) body" in canonical form
+static int parse_for_loop(const char *text, size_t pos, size_t end, parsed_loop_t *loop) {
+    memset(loop, 0, sizeof(parsed_loop_t));
+    pos = skip_space(text, pos, end);
+    if (!starts_with_keyword(text, pos, end, "for")) return -1;
+    loop->begin = pos;
+
+    size_t paren = skip_space(text, pos + 3, end);
+    if (paren >= end || text[paren] != '(') return -1;
+    size_t close = match_bracket(text, paren, end);
+    if (close >= end) return -1;
+
+    // Split the header on its two top-level semicolons
+    size_t semis[2];
+    int semi_count = 0;
+    int depth = 0;
+    for (size_t p = paren + 1; p < close; p++) {
+        if (text[p] == '(' || text[p] == '[') depth++;
+        else if (text[p] == ')' || text[p] == ']') depth--;
+        else if (text[p] == ';' && depth == 0 && semi_count < 2) semis[semi_count++] = p;
+    }
+    if (semi_count != 2) return -1;
+
+    char init[160], cond[160], inc[160];
+    copy_trimmed(init, sizeof(init), text + paren + 1, semis[0] - paren - 1);
+    copy_trimmed(cond, sizeof(cond), text + semis[0] + 1, semis[1] - semis[0] - 1);
+    copy_trimmed(inc, sizeof(inc), text + semis[1] + 1, close - semis[1] - 1);
+
+    // init: [type] var = lower
+    char *assign = strchr(init, '=');
+    if (!assign) return -1;
+    char *name_end = assign;
+    while (name_end > init && isspace((unsigned char)name_end[-1])) name_end--;
+    char *name_begin = name_end;
+    while (name_begin > init && is_ident_char(name_begin[-1])) name_begin--;
+    if (name_begin == name_end || (size_t)(name_end - name_begin) >= sizeof(loop->var)) return -1;
+    memcpy(loop->var, name_begin, name_end - name_begin);
+    loop->var[name_end - name_begin] = '\0';
+    loop->declares_var = name_begin != init;
+    copy_trimmed(loop->lower, sizeof(loop->lower), assign + 1, strlen(assign + 1));
+
+    // cond: var < upper or var <= upper
+    size_t var_len = strlen(loop->var);
+    if (strncmp(cond, loop->var, var_len) != 0) return -1;
+    const char *op = cond + var_len;
+    while (isspace((unsigned char)*op)) op++;
+    if (op[0] == '<' && op[1] == '=') {
+        snprintf(loop->upper, sizeof(loop->upper), "(%s) + 1", op + 2);
+    } else if (op[0] == '<' && op[1] != '<') {
+        copy_trimmed(loop->upper, sizeof(loop->upper), op + 1, strlen(op + 1));
+    } else {
+        return -1;
+    }
+
+    // inc: unit step only
+    char compact[160];
+    size_t n = 0;
+    for (const char *c = inc; *c && n < sizeof(compact) - 1; c++) {
+        if (!isspace((unsigned char)*c)) compact[n++] = *c;
+    }
+    compact[n] = '\0';
+    char expected[4][80];
+    snprintf(expected[0], sizeof(expected[0]), "%s++", loop->var);
+    snprintf(expected[1], sizeof(expected[1]), "++%s", loop->var);
+    snprintf(expected[2], sizeof(expected[2]), "%s+=1", loop->var);
+    snprintf(expected[3], sizeof(expected[3]), "%s=%s+1", loop->var, loop->var);
+    bool unit_step = false;
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(compact, expected[i]) == 0) unit_step = true;
+    }
+    if (!unit_step) return -1;
+
+    loop->body_begin = skip_space(text, close + 1, end);
+    loop->end = statement_end(text, loop->body_begin, end);
+    return 0;
+}
+
+static bool mentions_identifier(const char *text, const char *name) {
+    size_t len = strlen(name);
+    for (const char *p = strstr(text, name); p; p = strstr(p + 1, name)) {
+        bool left = p == text || !is_ident_char(p[-1]);
+        bool right = !is_ident_char(p[len]);
+        if (left && right) return true;
+    }
+    return false;
+}
+
+static kernel_symbol_t* find_symbol(kernel_nest_t *nest, const char *name) {
+    for (int i = 0; i < nest->symbol_count; i++) {
+        if (strcmp(nest->symbols[i].name, name) == 0) return &nest->symbols[i];
+    }
+    if (nest->symbol_count >= MAX_KERNEL_SYMBOLS) return NULL;
+
+    kernel_symbol_t *symbol = &nest->symbols[nest->symbol_count++];
+    memset(symbol, 0, sizeof(kernel_symbol_t));
+    strncpy(symbol->name, name, sizeof(symbol->name) - 1);
+    return symbol;
+}
+
+// Whitespace-free text of a written array access's subscripts, for the
+// dependence check
+static void subscript_key(const char *text, size_t begin, size_t end, char *key, size_t size) {
+    size_t n = 0;
+    for (size_t p = begin; p < end && n < size - 1; p++) {
+        if (!isspace((unsigned char)text[p])) key[n++] = text[p];
+    }
+    key[n] = '\0';
+}
+
+// Collect the free identifiers of the nest and check it can be tiled
+static int scan_nest_symbols(const char *text, kernel_nest_t *nest, char *notes, size_t notes_size) {
+    const parsed_loop_t *outer = &nest->loops[0];
+    size_t begin = outer->begin;
+    size_t end = outer->end;
+
+    char locals[32][64];
+    int local_count = 0;
+    char written_keys[MAX_KERNEL_SYMBOLS][256];
+    memset(written_keys, 0, sizeof(written_keys));
+    bool after_type = false;
+    int header_depth = 0;          // >0 while inside a for (...) header
+    int subscript_depth = 0;
+
+    for (size_t pos = begin; pos < end; ) {
+        char c = text[pos];
+
+        if (c == '/' && pos + 1 < end && (text[pos + 1] == '/' || text[pos + 1] == '*')) {
+            pos = skip_space(text, pos, end);
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            snprintf(notes, notes_size, "string or character literal in loop body");
+            return -1;
+        }
+        if (c == '.' && pos + 1 < end && !isdigit((unsigned char)text[pos + 1])) {
+            snprintf(notes, notes_size, "struct member access cannot be synthesized");
+            return -1;
+        }
+        if (c == '-' && pos + 1 < end && text[pos + 1] == '>') {
+            snprintf(notes, notes_size, "pointer member access cannot be synthesized");
+            return -1;
+        }
+        if (c == '[') subscript_depth++;
+        if (c == ']') subscript_depth--;
+        if (c == '(' && header_depth > 0) header_depth++;
+        if (c == ')' && header_depth > 0) header_depth--;
+        if (c == ';' || c == '{' || c == '}' || c == '(' || c == ')') after_type = false;
+
+        if (isdigit((unsigned char)c)) {
+            while (pos < end && (is_ident_char(text[pos]) || text[pos] == '.')) pos++;
+            continue;
+        }
+        if (!is_ident_char(c)) {
+            pos++;
+            continue;
+        }
+
+        size_t word_begin = pos;
+        while (pos < end && is_ident_char(text[pos])) pos++;
+        char word[64];
+        copy_trimmed(word, sizeof(word), text + word_begin, pos - word_begin);
+
+        if (strcmp(word, "for") == 0) {
+            size_t paren = skip_space(text, pos, end);
+            if (paren < end && text[paren] == '(') {
+                header_depth = 1;
+                pos = paren + 1;
+            }
+            continue;
+        }
+        if (in_list(word, type_keywords)) {
+            after_type = true;
+            continue;
+        }
+        if (in_list(word, c_keywords)) continue;
+
+        bool is_loop_var = false;
+        for (int d = 0; d < nest->depth; d++) {
+            if (strcmp(word, nest->loops[d].var) == 0) is_loop_var = true;
+        }
+        if (is_loop_var) continue;
+
+        // Declarations inside the nest stay local to the kernel
+        if (after_type) {
+            if (local_count < 32) strncpy(locals[local_count++], word, 63);
+            after_type = false;
+            continue;
+        }
+        bool is_local = false;
+        for (int i = 0; i < local_count; i++) {
+            if (strcmp(locals[i], word) == 0) is_local = true;
+        }
+        if (is_local) continue;
+
+        size_t next = skip_space(text, pos, end);
+        if (next < end && text[next] == '(') {
+            if (!in_list(word, libm_functions)) {
+                snprintf(notes, notes_size, "call to %s cannot be extracted", word);
+                return -1;
+            }
+            continue;
+        }
+
+        kernel_symbol_t *symbol = find_symbol(nest, word);
+        if (!symbol) {
+            snprintf(notes, notes_size, "too many free identifiers");
+            return -1;
+        }
+        if (header_depth > 0 || subscript_depth > 0) symbol->is_int = true;
+
+        // Array access: count subscripts and detect writes
+        int dims = 0;
+        size_t access_end = next;
+        while (access_end < end && text[access_end] == '[' && dims < 4) {
+            size_t close = match_bracket(text, access_end, end);
+            if (close >= end) break;
+            if (dims < 3 && symbol->dims == 0) {
+                copy_trimmed(symbol->subscripts[dims], sizeof(symbol->subscripts[dims]),
+                             text + access_end + 1, close - access_end - 1);
+            }
+            dims++;
+            access_end = skip_space(text, close + 1, end);
+        }
+        if (dims > 3) {
+            snprintf(notes, notes_size, "%s has more than three dimensions", word);
+            return -1;
+        }
+        if (dims == 0) continue;
+        if (symbol->dims != 0 && symbol->dims != dims) {
+            snprintf(notes, notes_size, "%s is accessed with different ranks", word);
+            return -1;
+        }
+        symbol->dims = dims;
+
+        // Tiling reorders iterations: a written array must be touched at one
+        // subscript per iteration
+        char key[256];
+        subscript_key(text, next, access_end, key, sizeof(key));
+        bool is_write = false;
+        if (access_end + 1 < end) {
+            char op = text[access_end];
+            char after = text[access_end + 1];
+            if (op == '=' && after != '=') {
+                is_write = true;
+            } else if ((op == '+' || op == '-' || op == '*' || op == '/') && after == '=') {
+                is_write = true;
+            } else if ((op == '+' || op == '-') && after == op) {
+                is_write = true;
+            }
+        }
+        int index = (int)(symbol - nest->symbols);
+        if (is_write) {
+            if (written_keys[index][0] && strcmp(written_keys[index], key) != 0) {
+                snprintf(notes, notes_size, "%s is written at different subscripts", word);
+                return -1;
+            }
+            strncpy(written_keys[index], key, sizeof(written_keys[index]) - 1);
+        }
+    }
+
+    // Reads of written arrays must use the written subscript
+    for (int i = 0; i < nest->symbol_count; i++) {
+        if (!written_keys[i][0]) continue;
+        const char *name = nest->symbols[i].name;
+        size_t len = strlen(name);
+
+        for (size_t pos = begin; pos + len < end; pos++) {
+            if (strncmp(text + pos, name, len) != 0 || is_ident_char(text[pos + len]) ||
+                (pos > 0 && is_ident_char(text[pos - 1]))) {
+                continue;
+            }
+            size_t open = skip_space(text, pos + len, end);
+            size_t access_end = open;
+            while (access_end < end && text[access_end] == '[') {
+                size_t close = match_bracket(text, access_end, end);
+                if (close >= end) break;
+                access_end = skip_space(text, close + 1, end);
+            }
+            char key[256];
+            subscript_key(text, open, access_end, key, sizeof(key));
+            if (strcmp(key, written_keys[i]) != 0) {
+                snprintf(notes, notes_size, "%s is read and written at different subscripts", name);
+                return -1;
+            }
+        }
+    }
+
+    // Bounds reference kernel-size scalars; literal bounds size the arrays
+    for (int d = 0; d < nest->depth; d++) {
+        for (int i = 0; i < nest->symbol_count; i++) {
+            kernel_symbol_t *symbol = &nest->symbols[i];
+            if (symbol->dims == 0 && (mentions_identifier(nest->loops[d].upper, symbol->name) ||
+                                      mentions_identifier(nest->loops[d].lower, symbol->name))) {
+                symbol->in_bound = true;
+                symbol->is_int = true;
+            }
+        }
+        const char *upper = nest->loops[d].upper;
+        int literal = atoi(upper[0] == '(' ? upper + 1 : upper);
+        if (literal > nest->max_literal_bound) nest->max_literal_bound = literal;
+    }
+
+    return 0;
+}
+
+// Find the perfect nest that starts at the given line
+static int extract_nest(const char *text, size_t length, int line, kernel_nest_t *nest,
+                        char *notes, size_t notes_size) {
+    memset(nest, 0, sizeof(kernel_nest_t));
+
+    size_t pos = 0;
+    for (int l = 1; l < line && pos < length; pos++) {
+        if (text[pos] == '\n') l++;
+    }
+    while (pos < length && text[pos] != '\n' &&
+           !(starts_with_keyword(text, pos, length, "for") && (pos == 0 || !is_ident_char(text[pos - 1])))) {
+        pos++;
+    }
+
+    if (parse_for_loop(text, pos, length, &nest->loops[0]) != 0) {
+        snprintf(notes, notes_size, "outer loop is not in canonical form");
+        return -1;
+    }
+    nest->depth = 1;
+
+    // Descend while the body is exactly one canonical for loop
+    while (nest->depth < MAX_NEST_DEPTH) {
+        const parsed_loop_t *current = &nest->loops[nest->depth - 1];
+        size_t body = current->body_begin;
+        size_t body_end = current->end;
+        if (text[body] == '{') {
+            body_end = match_bracket(text, body, length);
+            body = skip_space(text, body + 1, body_end);
+        }
+
+        parsed_loop_t inner;
+        if (parse_for_loop(text, body, body_end, &inner) != 0 ||
+            skip_space(text, inner.end, body_end) != body_end) {
+            break;
+        }
+
+        // Tiling needs a rectangular iteration space
+        for (int d = 0; d < nest->depth; d++) {
+            if (mentions_identifier(inner.lower, nest->loops[d].var) ||
+                mentions_identifier(inner.upper, nest->loops[d].var)) {
+                snprintf(notes, notes_size, "loop %s bounds depend on %s", inner.var,
+                         nest->loops[d].var);
+                return -1;
+            }
+        }
+        nest->loops[nest->depth++] = inner;
+    }
+
+    if (nest->depth < 2) {
+        snprintf(notes, notes_size, "not a perfect nest of at least two loops");
+        return -1;
+    }
+
+    return scan_nest_symbols(text, nest, notes, notes_size);
+}
+
+// Bytes one tile touches: tiled subscripts contribute their tile, any other
+// loop index the whole extent, invariant subscripts a single element
+static size_t model_tile_footprint(const kernel_nest_t *nest, const int *tiles, int extent,
+                                   size_t line_size) {
+    size_t total = 0;
+
+    for (int i = 0; i < nest->symbol_count; i++) {
+        const kernel_symbol_t *symbol = &nest->symbols[i];
+        if (symbol->dims == 0) continue;
+
+        size_t elements = 1;
+        for (int s = 0; s < symbol->dims; s++) {
+            size_t span = 1;
+            bool tiled = false;
+            for (int d = 0; d < nest->depth; d++) {
+                if (mentions_identifier(symbol->subscripts[s], nest->loops[d].var)) {
+                    span = tiles[d];
+                    tiled = true;
+                }
+            }
+            if (!tiled) {
+                // Non-tiled loop indices (inner body loops) sweep the extent
+                for (const char *c = symbol->subscripts[s]; *c; c++) {
+                    if (isalpha((unsigned char)*c)) {
+                        span = extent;
+                        break;
+                    }
+                }
+            }
+
+            // The contiguous dimension is fetched in whole lines
+            if (s == symbol->dims - 1) {
+                size_t per_line = line_size / sizeof(double);
+                span = ((span + per_line - 1) / per_line) * per_line;
+            }
+            elements *= span;
+        }
+        total += elements * sizeof(double);
+    }
+    return total;
+}
+
+static int compare_variants_by_model(const void *a, const void *b) {
+    const tile_variant_t *va = a;
+    const tile_variant_t *vb = b;
+    return va->median_ns < vb->median_ns ? -1 : va->median_ns > vb->median_ns;
+}
+
+// Enumerate power-of-two tiles and keep those whose modelled footprint is
+// closest to half of L1 or half of L2
+static int generate_candidates(const kernel_nest_t *nest, const cache_info_t *cache_info,
+                               int extent, int max_variants, autotune_result_t *result) {
+    static const int sizes[] = {8, 16, 32, 64, 128, 256, 512};
+    const int size_count = sizeof(sizes) / sizeof(sizes[0]);
+
+    size_t line_size = cache_info->levels[0].line_size ? cache_info->levels[0].line_size : 64;
+    size_t l1 = cache_info->levels[0].size ? cache_info->levels[0].size : 32 * 1024;
+    size_t l2 = cache_info->num_levels > 1 ? cache_info->levels[1].size : l1 * 8;
+
+    tile_variant_t *candidates = CALLOC_LOGGED(343, sizeof(tile_variant_t));
+    if (!candidates) return -1;
+    int count = 0;
+
+    int idx[3] = {0, 0, 0};
+    int depth = nest->depth;
+    for (;;) {
+        int tiles[3] = {1, 1, 1};
+        bool fits = true;
+        for (int d = 0; d < depth; d++) {
+            tiles[d] = sizes[idx[d]];
+            if (tiles[d] > extent) fits = false;
+        }
+
+        if (fits) {
+            size_t footprint = model_tile_footprint(nest, tiles, extent, line_size);
+            if (footprint <= l2) {
+                tile_variant_t *v = &candidates[count++];
+                memcpy(v->tile_sizes, tiles, sizeof(tiles));
+                v->model_footprint = footprint;
+                double to_l1 = fabs(log2((double)footprint / (l1 / 2.0)));
+                double to_l2 = fabs(log2((double)footprint / (l2 / 2.0)));
+                v->median_ns = to_l1 < to_l2 ? to_l1 : to_l2;   // Model score, replaced by timing
+            }
+        }
+
+        int d = depth - 1;
+        while (d >= 0 && ++idx[d] == size_count) idx[d--] = 0;
+        if (d < 0) break;
+    }
+
+    qsort(candidates, count, sizeof(tile_variant_t), compare_variants_by_model);
+
+    if (max_variants > AUTOTUNE_MAX_VARIANTS) max_variants = AUTOTUNE_MAX_VARIANTS;
+    result->variant_count = count < max_variants ? count : max_variants;
+    for (int i = 0; i < result->variant_count; i++) {
+        result->variants[i] = candidates[i];
+        result->variants[i].median_ns = 0;
+    }
+
+    LOG_INFO("Tile model kept %d of %d candidates", result->variant_count, count);
+    FREE_LOGGED(candidates);
+    return 0;
+}
+
+static void write_loop_header(FILE *fp, const parsed_loop_t *loop, const char *indent) {
+    fprintf(fp, "%sfor (%s%s = %s; %s < %s; %s++)\n", indent,
+            loop->declares_var ? "int " : "", loop->var, loop->lower,
+            loop->var, loop->upper, loop->var);
+}
+
+// Write the kernel: original nest and its tiled form behind -DTILED
+static int write_kernel(const char *text, const kernel_nest_t *nest, const loop_info_t *loop,
+                        int extent, int passes, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        LOG_ERROR("Failed to create kernel %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    int ext = extent + 2 * KERNEL_PAD;
+
+    fprintf(fp, "// Extracted by cacheSight from %s:%d\n", loop->location.file, loop->location.line);
+    fprintf(fp, "#include <stdio.h>\n#include <math.h>\n#include <time.h>\n\n");
+    fprintf(fp, "#ifndef TILED\n#define TILED 0\n#endif\n");
+    fprintf(fp, "#ifndef TILE_0\n#define TILE_0 32\n#endif\n");
+    fprintf(fp, "#ifndef TILE_1\n#define TILE_1 32\n#endif\n");
+    fprintf(fp, "#ifndef TILE_2\n#define TILE_2 32\n#endif\n");
+    fprintf(fp, "#define KERNEL_N %d\n#define KERNEL_PAD %d\n#define KERNEL_EXT %d\n",
+            extent, KERNEL_PAD, ext);
+    fprintf(fp, "#define KERNEL_PASSES %d\n", passes);
+    fprintf(fp, "#define KERNEL_MIN(a, b) ((a) < (b) ? (a) : (b))\n\n");
+
+    // Arrays are padded on every side so stencil offsets stay in bounds
+    for (int i = 0; i < nest->symbol_count; i++) {
+        const kernel_symbol_t *s = &nest->symbols[i];
+        switch (s->dims) {
+            case 0:
+                if (s->is_int) {
+                    fprintf(fp, "int %s = %s;\n", s->name, s->in_bound ? "KERNEL_N" : "1");
+                } else {
+                    fprintf(fp, "double %s = 0.5;\n", s->name);
+                }
+                break;
+            case 1:
+                fprintf(fp, "double %s_storage[KERNEL_EXT];\n", s->name);
+                fprintf(fp, "double *%s = %s_storage + KERNEL_PAD;\n", s->name, s->name);
+                break;
+            case 2:
+                fprintf(fp, "double %s_storage[KERNEL_EXT][KERNEL_EXT];\n", s->name);
+                fprintf(fp, "double (*%s)[KERNEL_EXT] = (double (*)[KERNEL_EXT])&%s_storage[KERNEL_PAD][KERNEL_PAD];\n",
+                        s->name, s->name);
+                break;
+            case 3:
+                fprintf(fp, "double %s_storage[KERNEL_EXT][KERNEL_EXT][KERNEL_EXT];\n", s->name);
+                fprintf(fp, "double (*%s)[KERNEL_EXT][KERNEL_EXT] = "
+                        "(double (*)[KERNEL_EXT][KERNEL_EXT])&%s_storage[KERNEL_PAD][KERNEL_PAD][KERNEL_PAD];\n",
+                        s->name, s->name);
+                break;
+        }
+    }
+
+    fprintf(fp, "\nstatic void kernel(void) {\n");
+    for (int d = 0; d < nest->depth; d++) {
+        if (!nest->loops[d].declares_var) fprintf(fp, "    int %s;\n", nest->loops[d].var);
+    }
+
+    const parsed_loop_t *innermost = &nest->loops[nest->depth - 1];
+    fprintf(fp, "#if TILED\n");
+    char indent[64] = "    ";
+    for (int d = 0; d < nest->depth; d++) {
+        const parsed_loop_t *l = &nest->loops[d];
+        fprintf(fp, "%sfor (int %s_tile = %s; %s_tile < %s; %s_tile += TILE_%d)\n",
+                indent, l->var, l->lower, l->var, l->upper, l->var, d);
+        strcat(indent, "    ");
+    }
+    for (int d = 0; d < nest->depth; d++) {
+        const parsed_loop_t *l = &nest->loops[d];
+        fprintf(fp, "%sfor (%s%s = %s_tile; %s < KERNEL_MIN(%s_tile + TILE_%d, %s); %s++)\n",
+                indent, l->declares_var ? "int " : "", l->var, l->var, l->var, l->var, d,
+                l->upper, l->var);
+        strcat(indent, "    ");
+    }
+    fprintf(fp, "%s%.*s\n", indent, (int)(innermost->end - innermost->body_begin),
+            text + innermost->body_begin);
+
+    fprintf(fp, "#else\n");
+    strcpy(indent, "    ");
+    for (int d = 0; d < nest->depth; d++) {
+        write_loop_header(fp, &nest->loops[d], indent);
+        strcat(indent, "    ");
+    }
+    fprintf(fp, "%s%.*s\n", indent, (int)(innermost->end - innermost->body_begin),
+            text + innermost->body_begin);
+    fprintf(fp, "#endif\n}\n\n");
+
+    fprintf(fp, "static double now_ns(void) {\n"
+                "    struct timespec ts;\n"
+                "    clock_gettime(CLOCK_MONOTONIC, &ts);\n"
+                "    return ts.tv_sec * 1e9 + ts.tv_nsec;\n"
+                "}\n\n");
+
+    fprintf(fp, "int main(void) {\n");
+    for (int i = 0; i < nest->symbol_count; i++) {
+        const kernel_symbol_t *s = &nest->symbols[i];
+        if (s->dims == 0) continue;
+        fprintf(fp, "    for (size_t e = 0; e < sizeof(%s_storage) / sizeof(double); e++)\n"
+                    "        ((double*)%s_storage)[e] = (double)(e %% 7) * 0.25;\n",
+                s->name, s->name);
+    }
+    fprintf(fp, "    kernel();\n"
+                "    double best = 1e300;\n"
+                "    for (int pass = 0; pass < KERNEL_PASSES; pass++) {\n"
+                "        double start = now_ns();\n"
+                "        kernel();\n"
+                "        double elapsed = now_ns() - start;\n"
+                "        if (elapsed < best) best = elapsed;\n"
+                "    }\n"
+                "    double checksum = 0;\n");
+    for (int i = 0; i < nest->symbol_count; i++) {
+        const kernel_symbol_t *s = &nest->symbols[i];
+        if (s->dims > 0) {
+            fprintf(fp, "    checksum += ((double*)%s_storage)[sizeof(%s_storage) / sizeof(double) / 2];\n",
+                    s->name, s->name);
+        } else if (!s->is_int) {
+            fprintf(fp, "    checksum += %s;\n", s->name);
+        }
+    }
+    fprintf(fp, "    printf(\"%%.0f %%.17g\\n\", best, checksum);\n"
+                "    return 0;\n"
+                "}\n");
+
+    fclose(fp);
+    return 0;
+}
+
+// Split a whitespace-separated option string in place; returns the new argc
+static int append_words(char *text, char **argv, int argc, int max_args) {
+    char *save = NULL;
+    for (char *word = strtok_r(text, " \t", &save); word && argc < max_args;
+         word = strtok_r(NULL, " \t", &save)) {
+        argv[argc++] = word;
+    }
+    return argc;
+}
+
+int autotune_build_kernel(const autotuner_config_t *config, const char *kernel_path,
+                         const char *binary, const char *cflags, const char *defines) {
+    // Paths go to the compiler as single arguments, never through a shell
+    char compiler[sizeof(config->compiler)];
+    char flags[256];
+    char extra[256];
+    strncpy(compiler, config->compiler, sizeof(compiler) - 1);
+    compiler[sizeof(compiler) - 1] = '\0';
+    snprintf(flags, sizeof(flags), "%s", cflags ? cflags : "");
+    snprintf(extra, sizeof(extra), "%s", defines ? defines : "");
+
+    char *argv[64];
+    int argc = append_words(compiler, argv, 0, 58);
+    argc = append_words(flags, argv, argc, 58);
+    argc = append_words(extra, argv, argc, 58);
+    if (argc == 0) {
+        LOG_ERROR("No compiler configured");
+        return -1;
+    }
+    argv[argc++] = "-o";
+    argv[argc++] = (char*)binary;
+    argv[argc++] = (char*)kernel_path;
+    argv[argc++] = "-lm";
+    argv[argc] = NULL;
+
+    LOG_DEBUG("Compiling %s: %s %s %s", kernel_path, config->compiler, cflags, defines ? defines : "");
+    pid_t pid = fork();
+    if (pid < 0) {
+        LOG_ERROR("fork failed: %s", strerror(errno));
+        return -1;
+    }
+
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDERR_FILENO);
+            close(null_fd);
+        }
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        LOG_WARNING("Kernel compilation of %s with '%s %s' failed (status %d)",
+                    kernel_path, cflags, defines ? defines : "", status);
+        return -1;
+    }
+    return 0;
+}
+
+static int compile_kernel(const autotuner_config_t *config, const char *kernel_path,
+                          const char *binary, const char *cflags, bool tiled, const int *tiles) {
+    char defines[128];
+    snprintf(defines, sizeof(defines), "-DTILED=%d -DTILE_0=%d -DTILE_1=%d -DTILE_2=%d",
+             tiled ? 1 : 0, tiles[0], tiles[1], tiles[2]);
+    return autotune_build_kernel(config, kernel_path, binary, cflags, defines);
+}
+
+static int compile_variant(const autotuner_config_t *config, const char *kernel_path,
+                           const char *binary, bool tiled, const int *tiles) {
+    return compile_kernel(config, kernel_path, binary, config->cflags, tiled, tiles);
+}
+
+// Run the binary pinned to one CPU; returns its reported best pass time
+// and stores the checksum it printed
+static double run_pinned(const char *binary, int cpu, double *checksum) {
+    int pipefd[2];
+    if (pipe(pipefd) != 0) {
+        LOG_ERROR("pipe failed: %s", strerror(errno));
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        LOG_ERROR("fork failed: %s", strerror(errno));
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+        dup2(pipefd[1], STDOUT_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        execl(binary, binary, (char*)NULL);
+        _exit(127);
+    }
+
+    close(pipefd[1]);
+    char output[128] = {0};
+    ssize_t n = read(pipefd[0], output, sizeof(output) - 1);
+    close(pipefd[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    double best = 0;
+    if (n <= 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+        sscanf(output, "%lf %lf", &best, checksum) != 2) {
+        LOG_WARNING("Kernel %s failed to run", binary);
+        return -1;
+    }
+    return best;
+}
+
+// Reordered floating-point sums may differ in the last bits; anything
+// beyond that means a variant computes something else
+static bool checksums_match(double expected, double actual) {
+    double scale = fabs(expected) > 1.0 ? fabs(expected) : 1.0;
+    return fabs(expected - actual) <= CHECKSUM_TOLERANCE * scale;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return da < db ? -1 : da > db;
+}
+
+// Pinned runs of one binary; returns how many produced a time
+int autotune_sample_kernel(const autotuner_config_t *config, const char *binary,
+                          double *times, int max_runs, double *checksum) {
+    int runs = config->repetitions < max_runs ? config->repetitions : max_runs;
+    int ok = 0;
+
+    for (int r = 0; r < runs; r++) {
+        double sum = 0;
+        double t = run_pinned(binary, config->pin_cpu, &sum);
+        if (t <= 0) continue;
+        if (ok == 0 && checksum) *checksum = sum;
+        times[ok++] = t;
+    }
+    return ok;
+}
+
+// Median time of a variant; 0 if it failed or its checksum differs from
+// the untiled kernel's
+static double time_variant(const autotuner_config_t *config, const char *binary,
+                           const double *expected, double *checksum) {
+    double times[32];
+    double sum = 0;
+    int ok = autotune_sample_kernel(config, binary, times, 32, &sum);
+    if (ok == 0) return 0;
+    if (checksum) *checksum = sum;
+    if (expected && !checksums_match(*expected, sum)) {
+        LOG_WARNING("%s computes a different result (checksum %.17g, expected %.17g)",
+                    binary, sum, *expected);
+        return 0;
+    }
+
+    qsort(times, ok, sizeof(double), compare_doubles);
+    return times[ok / 2];
+}
+
+// Extent sized so the largest array is several times L3
+static int choose_problem_size(const kernel_nest_t *nest, const cache_info_t *cache_info,
+                               const autotuner_config_t *config) {
+    if (config->problem_size > 0) {
+        return config->problem_size > nest->max_literal_bound ?
+               config->problem_size : nest->max_literal_bound;
+    }
+
+    int max_dims = 1;
+    int arrays = 0;
+    for (int i = 0; i < nest->symbol_count; i++) {
+        if (nest->symbols[i].dims > max_dims) max_dims = nest->symbols[i].dims;
+        if (nest->symbols[i].dims > 0) arrays++;
+    }
+
+    size_t llc = cache_info->levels[cache_info->num_levels > 0 ? cache_info->num_levels - 1 : 0].size;
+    double target = llc > 0 ? 4.0 * llc : 32.0 * 1024 * 1024;
+    double budget = 256.0 * 1024 * 1024 / (arrays > 0 ? arrays : 1);
+    if (target > budget) target = budget;
+
+    int extent = (int)pow(target / sizeof(double), 1.0 / max_dims);
+    extent &= ~7;
+    if (extent < 64) extent = 64;
+    return extent > nest->max_literal_bound ? extent : nest->max_literal_bound;
+}
+
+autotuner_config_t autotuner_config_default(void) {
+    autotuner_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.problem_size = 0;
+    config.max_variants = 12;
+    config.repetitions = 5;
+    config.passes = 3;
+    config.pin_cpu = 0;
+    strncpy(config.compiler, "cc", sizeof(config.compiler) - 1);
+    strncpy(config.cflags, "-O2 -march=native", sizeof(config.cflags) - 1);
+    strncpy(config.work_dir, "cachesight_autotune", sizeof(config.work_dir) - 1);
+    strncpy(config.results_file, "tile_tuning.txt", sizeof(config.results_file) - 1);
+    config.comparison_repetitions = 9;
+    config.significance = 0.05;
+    strncpy(config.baseline_flags, "-O2", sizeof(config.baseline_flags) - 1);
+    strncpy(config.flags_file, "flag_tuning.txt", sizeof(config.flags_file) - 1);
+    return config;
+}
+
+void autotune_machine_signature(const cache_info_t *cache_info, char *buffer, size_t size) {
+    int written = snprintf(buffer, size, "%s",
+                           cache_info->cpu_model[0] ? cache_info->cpu_model : cache_info->arch);
+    for (int i = 0; i < cache_info->num_levels && written > 0 && (size_t)written < size; i++) {
+        written += snprintf(buffer + written, size - written, " L%d=%zuK",
+                            cache_info->levels[i].level, cache_info->levels[i].size / 1024);
+    }
+}
+
+int autotune_loop_nest(const loop_info_t *loop, const cache_info_t *cache_info,
+                      const autotuner_config_t *config, autotune_result_t *result) {
+    if (!loop || !cache_info || !config || !result) {
+        LOG_ERROR("NULL parameters in autotune_loop_nest");
+        return -1;
+    }
+
+    memset(result, 0, sizeof(autotune_result_t));
+    result->location = loop->location;
+    result->best_index = -1;
+    autotune_machine_signature(cache_info, result->machine, sizeof(result->machine));
+
+    size_t length = 0;
+    char *text = read_source_file(loop->location.file, &length);
+    if (!text) return -1;
+
+    kernel_nest_t *nest = CALLOC_LOGGED(1, sizeof(kernel_nest_t));
+    if (!nest) {
+        FREE_LOGGED(text);
+        return -1;
+    }
+
+    if (extract_nest(text, length, loop->location.line, nest, result->notes, sizeof(result->notes)) != 0) {
+        LOG_INFO("Cannot autotune %s:%d: %s", loop->location.file, loop->location.line, result->notes);
+        FREE_LOGGED(nest);
+        FREE_LOGGED(text);
+        return -1;
+    }
+
+    result->depth = nest->depth;
+    for (int d = 0; d < nest->depth; d++) {
+        strncpy(result->loop_vars[d], nest->loops[d].var, sizeof(result->loop_vars[d]) - 1);
+    }
+    result->end_line = loop->location.line;
+    for (size_t p = nest->loops[0].begin; p < nest->loops[0].end; p++) {
+        if (text[p] == '\n') result->end_line++;
+    }
+
+    result->problem_size = choose_problem_size(nest, cache_info, config);
+    mkdir(config->work_dir, 0755);
+    unsigned int tag = path_tag(loop->location.file);
+    snprintf(result->kernel_path, sizeof(result->kernel_path), "%s/kernel_%08x_%d.c",
+             config->work_dir, tag, loop->location.line);
+
+    if (write_kernel(text, nest, loop, result->problem_size, config->passes, result->kernel_path) != 0 ||
+        generate_candidates(nest, cache_info, result->problem_size, config->max_variants, result) != 0) {
+        FREE_LOGGED(nest);
+        FREE_LOGGED(text);
+        return -1;
+    }
+    FREE_LOGGED(nest);
+    FREE_LOGGED(text);
+
+    LOG_INFO("Autotuning %d-deep nest at %s:%d (N=%d, %d variants)", result->depth,
+             loop->location.file, loop->location.line, result->problem_size, result->variant_count);
+
+    // Untiled baseline
+    char binary[600];
+    int no_tiles[3] = {0, 0, 0};
+    snprintf(binary, sizeof(binary), "%s/kernel_%08x_%d_base", config->work_dir, tag, loop->location.line);
+    if (compile_variant(config, result->kernel_path, binary, false, no_tiles) != 0) {
+        snprintf(result->notes, sizeof(result->notes), "extracted kernel does not compile");
+        return -1;
+    }
+    double base_checksum = 0;
+    result->untiled_ns = time_variant(config, binary, NULL, &base_checksum);
+    remove(binary);
+    if (result->untiled_ns <= 0) {
+        snprintf(result->notes, sizeof(result->notes), "extracted kernel does not run");
+        return -1;
+    }
+
+    for (int i = 0; i < result->variant_count; i++) {
+        tile_variant_t *v = &result->variants[i];
+        snprintf(binary, sizeof(binary), "%s/kernel_%08x_%d_v%d", config->work_dir, tag,
+                 loop->location.line, i);
+        if (compile_variant(config, result->kernel_path, binary, true, v->tile_sizes) != 0) continue;
+
+        // Tiling must not change what the nest computes
+        v->median_ns = time_variant(config, binary, &base_checksum, NULL);
+        v->valid = v->median_ns > 0;
+        remove(binary);
+
+        if (v->valid && (result->best_index < 0 ||
+                         v->median_ns < result->variants[result->best_index].median_ns)) {
+            result->best_index = i;
+        }
+        LOG_DEBUG("Tiles %dx%dx%d: %.0f ns (model footprint %zu bytes)",
+                  v->tile_sizes[0], v->tile_sizes[1], v->tile_sizes[2], v->median_ns, v->model_footprint);
+    }
+
+    if (result->best_index >= 0 && result->untiled_ns > 0) {
+        result->speedup = result->untiled_ns / result->variants[result->best_index].median_ns;
+    }
+
+    return result->best_index >= 0 ? 0 : -1;
+}
+
+int autotune_all_nests(const analysis_results_t *static_results, const cache_info_t *cache_info,
+                      const autotuner_config_t *config, int max_nests,
+                      autotune_result_t **results, int *result_count) {
+    if (!static_results || !cache_info || !config || !results || !result_count) {
+        LOG_ERROR("NULL parameters in autotune_all_nests");
+        return -1;
+    }
+    TRACE_SCOPE(trace, "autotune.tiles");
+
+    *results = NULL;
+    *result_count = 0;
+    if (static_results->loop_count == 0 || max_nests <= 0) return 0;
+
+    *results = CALLOC_LOGGED(max_nests, sizeof(autotune_result_t));
+    if (!*results) return -1;
+
+    for (int i = 0; i < static_results->loop_count && *result_count < max_nests; i++) {
+        const loop_info_t *loop = &static_results->loops[i];
+        if (loop->nest_level != 1 || !loop->has_nested_loops || loop->has_function_calls) continue;
+
+        autotune_result_t *result = &(*results)[*result_count];
+        if (autotune_loop_nest(loop, cache_info, config, result) == 0) {
+            save_autotune_result(result, config->results_file);
+            (*result_count)++;
+        }
+    }
+
+    LOG_INFO("Autotuned %d loop nests", *result_count);
+    return *result_count;
+}
+
+// Candidate flag sets; unknown flags fail to compile and are skipped
+static const char *flag_candidates[] = {
+    "-O3",
+    "-O3 -march=native",
+    "-O3 -march=native -fno-semantic-interposition",
+    "-O3 -march=native -fprefetch-loop-arrays",
+    "-O3 -march=native -funroll-loops",
+    "-O3 -march=native -funroll-loops --param max-unroll-times=4",
+    "-O3 -march=native -mprefer-vector-width=128",
+    "-O3 -march=native -mprefer-vector-width=256",
+    "-O3 -march=native -mprefer-vector-width=512",
+    "-O2 -march=native -funroll-loops",
+};
+
+// Compile the untiled kernel with one flag set and collect its run times
+// and result checksum
+static int time_flag_set(const autotuner_config_t *config, const char *kernel_path,
+                         const char *binary, const char *flags, double *times, int max_runs,
+                         double *checksum) {
+    int no_tiles[3] = {0, 0, 0};
+    if (compile_kernel(config, kernel_path, binary, flags, false, no_tiles) != 0) return 0;
+
+    autotuner_config_t runs = *config;
+    runs.repetitions = config->comparison_repetitions;
+    int count = autotune_sample_kernel(&runs, binary, times, max_runs, checksum);
+    remove(binary);
+    return count;
+}
+
+static double mean_of(const double *values, int count) {
+    double sum = 0;
+    for (int i = 0; i < count; i++) sum += values[i];
+    return count > 0 ? sum / count : 0;
+}
+
+// Holm step-down adjustment of the valid variants' p-values, so the
+// chance of keeping any flag set by luck stays at the significance level
+static void holm_adjust(flag_variant_t *variants, int count) {
+    int order[FLAG_TUNE_MAX_CANDIDATES];
+    int tested = 0;
+    for (int i = 0; i < count; i++) {
+        if (!variants[i].valid) continue;
+        int k = tested++;
+        while (k > 0 && variants[order[k - 1]].p_value > variants[i].p_value) {
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = i;
+    }
+
+    double running = 0;
+    for (int k = 0; k < tested; k++) {
+        flag_variant_t *v = &variants[order[k]];
+        double adjusted = v->p_value * (tested - k);
+        if (adjusted > 1.0) adjusted = 1.0;
+        if (adjusted < running) adjusted = running;
+        running = adjusted;
+        v->adjusted_p = adjusted;
+    }
+}
+
+int autotune_compiler_flags(const loop_info_t *loop, const cache_info_t *cache_info,
+                           const autotuner_config_t *config, flag_tune_result_t *result) {
+    if (!loop || !cache_info || !config || !result) {
+        LOG_ERROR("NULL parameters in autotune_compiler_flags");
+        return -1;
+    }
+
+    memset(result, 0, sizeof(flag_tune_result_t));
+    result->location = loop->location;
+    result->best_index = -1;
+    autotune_machine_signature(cache_info, result->machine, sizeof(result->machine));
+
+    size_t length = 0;
+    char *text = read_source_file(loop->location.file, &length);
+    if (!text) return -1;
+
+    kernel_nest_t *nest = CALLOC_LOGGED(1, sizeof(kernel_nest_t));
+    if (!nest) {
+        FREE_LOGGED(text);
+        return -1;
+    }
+
+    char kernel_path[512];
+    snprintf(kernel_path, sizeof(kernel_path), "%s/flags_%08x_%d.c", config->work_dir,
+             path_tag(loop->location.file), loop->location.line);
+    int extracted = extract_nest(text, length, loop->location.line, nest,
+                                 result->notes, sizeof(result->notes));
+    if (extracted == 0) {
+        result->problem_size = choose_problem_size(nest, cache_info, config);
+        mkdir(config->work_dir, 0755);
+        extracted = write_kernel(text, nest, loop, result->problem_size, config->passes, kernel_path);
+    }
+    FREE_LOGGED(nest);
+    FREE_LOGGED(text);
+    if (extracted != 0) {
+        LOG_INFO("Cannot tune flags on %s:%d: %s", loop->location.file, loop->location.line, result->notes);
+        return -1;
+    }
+
+    evaluator_config_t eval_config = evaluator_config_default();
+    evaluator_t *evaluator = evaluator_create(&eval_config, cache_info);
+    if (!evaluator) return -1;
+
+    char binary[600];
+    snprintf(binary, sizeof(binary), "%s/flags_%08x_%d_bin", config->work_dir,
+             path_tag(loop->location.file), loop->location.line);
+
+    double baseline_times[32];
+    double baseline_checksum = 0;
+    int baseline_count = time_flag_set(config, kernel_path, binary, config->baseline_flags,
+                                       baseline_times, 32, &baseline_checksum);
+    strncpy(result->baseline.flags, config->baseline_flags, sizeof(result->baseline.flags) - 1);
+    if (baseline_count < 2) {
+        snprintf(result->notes, sizeof(result->notes), "kernel does not build or run with %s",
+                 config->baseline_flags);
+        evaluator_destroy(evaluator);
+        return -1;
+    }
+    result->baseline.mean_ns = mean_of(baseline_times, baseline_count);
+    result->baseline.speedup = 1.0;
+    result->baseline.p_value = 1.0;
+    result->baseline.adjusted_p = 1.0;
+    result->baseline.valid = true;
+
+    LOG_INFO("Tuning compiler flags for %s on %s:%d (N=%d)", result->location.file,
+             loop->location.file, loop->location.line, result->problem_size);
+
+    int candidate_count = (int)(sizeof(flag_candidates) / sizeof(flag_candidates[0]));
+    for (int c = 0; c < candidate_count && result->variant_count < FLAG_TUNE_MAX_CANDIDATES; c++) {
+        flag_variant_t *v = &result->variants[result->variant_count++];
+        strncpy(v->flags, flag_candidates[c], sizeof(v->flags) - 1);
+
+        double times[32];
+        double checksum = 0;
+        int count = time_flag_set(config, kernel_path, binary, v->flags, times, 32, &checksum);
+        if (count < 2) continue;
+
+        // Flags that change the results (e.g. unsafe math) are not candidates
+        if (!checksums_match(baseline_checksum, checksum)) {
+            LOG_WARNING("Flags '%s' change the kernel's result (checksum %.17g, baseline %.17g)",
+                        v->flags, checksum, baseline_checksum);
+            continue;
+        }
+
+        v->mean_ns = mean_of(times, count);
+        v->valid = evaluator_compare_performance(evaluator, baseline_times, baseline_count,
+                                                 times, count, &v->speedup, &v->p_value) == 0;
+        LOG_DEBUG("Flags '%s': %.0f ns, %.2fx, p=%.4f", v->flags, v->mean_ns, v->speedup, v->p_value);
+    }
+    evaluator_destroy(evaluator);
+
+    // Only a set that is both faster and significantly so, after correcting
+    // for the number of sets tried, can replace the baseline
+    holm_adjust(result->variants, result->variant_count);
+    for (int i = 0; i < result->variant_count; i++) {
+        const flag_variant_t *v = &result->variants[i];
+        if (v->valid && v->speedup > 1.0 && v->adjusted_p < config->significance &&
+            (result->best_index < 0 || v->mean_ns < result->variants[result->best_index].mean_ns)) {
+            result->best_index = i;
+        }
+    }
+    if (result->best_index < 0) {
+        snprintf(result->notes, sizeof(result->notes), "no flag set beats %s at Holm-adjusted p < %.2f",
+                 config->baseline_flags, config->significance);
+    }
+    return 0;
+}
+
+// Call-free nests only; the largest estimated trip count stands in for the hot kernel
+int autotune_flags_per_file(const analysis_results_t *static_results, const cache_info_t *cache_info,
+                           const autotuner_config_t *config, int max_files,
+                           flag_tune_result_t **results, int *result_count) {
+    if (!static_results || !cache_info || !config || !results || !result_count) {
+        LOG_ERROR("NULL parameters in autotune_flags_per_file");
+        return -1;
+    }
+    TRACE_SCOPE(trace, "autotune.flags");
+
+    *results = NULL;
+    *result_count = 0;
+    if (static_results->loop_count == 0 || max_files <= 0) return 0;
+
+    *results = CALLOC_LOGGED(max_files, sizeof(flag_tune_result_t));
+    if (!*results) return -1;
+
+    bool *done = CALLOC_LOGGED(static_results->loop_count, sizeof(bool));
+    if (!done) {
+        FREE_LOGGED(*results);
+        *results = NULL;
+        return -1;
+    }
+
+    for (int i = 0; i < static_results->loop_count && *result_count < max_files; i++) {
+        if (done[i]) continue;
+
+        // Candidate nests of this file, hottest first
+        const char *file = static_results->loops[i].location.file;
+        int order[64];
+        int count = 0;
+        for (int j = i; j < static_results->loop_count; j++) {
+            const loop_info_t *loop = &static_results->loops[j];
+            if (strcmp(loop->location.file, file) != 0) continue;
+            done[j] = true;
+            if (loop->nest_level != 1 || !loop->has_nested_loops || loop->has_function_calls ||
+                count == 64) {
+                continue;
+            }
+
+            int k = count++;
+            while (k > 0 && static_results->loops[order[k - 1]].estimated_iterations <
+                            loop->estimated_iterations) {
+                order[k] = order[k - 1];
+                k--;
+            }
+            order[k] = j;
+        }
+
+        for (int c = 0; c < count; c++) {
+            flag_tune_result_t *result = &(*results)[*result_count];
+            if (autotune_compiler_flags(&static_results->loops[order[c]], cache_info, config, result) == 0) {
+                save_flag_tune_result(result, config->flags_file);
+                (*result_count)++;
+                break;
+            }
+        }
+    }
+
+    FREE_LOGGED(done);
+    LOG_INFO("Tuned compiler flags for %d translation units", *result_count);
+    return *result_count;
+}
+
+const char* flag_tune_best_flags(const flag_tune_result_t *result) {
+    if (!result || result->best_index < 0) return NULL;
+    return result->variants[result->best_index].flags;
+}
+
+void print_autotune_result(const autotune_result_t *result) {
+    if (!result) return;
+
+    printf("\n=== Tile Autotuning: %s:%d ===\n", result->location.file, result->location.line);
+    printf("Machine: %s\n", result->machine);
+    printf("Loops: ");
+    for (int d = 0; d < result->depth; d++) {
+        printf("%s%s", d ? " x " : "", result->loop_vars[d]);
+    }
+    printf("  (N=%d, kernel %s)\n", result->problem_size, result->kernel_path);
+
+    if (result->best_index < 0) {
+        printf("No variant ran%s%s\n", result->notes[0] ? ": " : "", result->notes);
+        return;
+    }
+
+    printf("Untiled: %.3f ms\n", result->untiled_ns / 1e6);
+    printf("%-16s %12s %12s\n", "Tiles", "Footprint", "Median (ms)");
+    for (int i = 0; i < result->variant_count; i++) {
+        const tile_variant_t *v = &result->variants[i];
+        char tiles[32];
+        if (result->depth == 3) {
+            snprintf(tiles, sizeof(tiles), "%dx%dx%d", v->tile_sizes[0], v->tile_sizes[1], v->tile_sizes[2]);
+        } else {
+            snprintf(tiles, sizeof(tiles), "%dx%d", v->tile_sizes[0], v->tile_sizes[1]);
+        }
+        if (v->valid) {
+            printf("%-16s %10zuKB %12.3f%s\n", tiles, v->model_footprint / 1024, v->median_ns / 1e6,
+                   i == result->best_index ? "  <- best" : "");
+        } else {
+            printf("%-16s %10zuKB %12s\n", tiles, v->model_footprint / 1024, "failed");
+        }
+    }
+    printf("Best speedup over untiled: %.2fx\n", result->speedup);
+}
+
+int save_autotune_result(const autotune_result_t *result, const char *filename) {
+    if (!result || !filename || result->best_index < 0) return -1;
+
+    FILE *fp = fopen(filename, "a");
+    if (!fp) {
+        LOG_ERROR("Failed to open %s: %s", filename, strerror(errno));
+        return -1;
+    }
+
+    const tile_variant_t *best = &result->variants[result->best_index];
+    fprintf(fp, "%s | %s:%d | depth=%d | tiles=%d,%d,%d | N=%d | speedup=%.2f\n",
+            result->machine, result->location.file, result->location.line, result->depth,
+            best->tile_sizes[0], best->tile_sizes[1], best->tile_sizes[2],
+            result->problem_size, result->speedup);
+
+    fclose(fp);
+    LOG_INFO("Saved best tiles for %s:%d to %s", result->location.file, result->location.line, filename);
+    return 0;
+}
+
+void print_flag_tune_result(const flag_tune_result_t *result) {
+    if (!result) return;
+
+    printf("\n=== Compiler Flag Tuning: %s ===\n", result->location.file);
+    printf("Machine: %s\n", result->machine);
+    printf("Kernel: nest at line %d (N=%d)\n", result->location.line, result->problem_size);
+    printf("Baseline %s: %.3f ms\n", result->baseline.flags, result->baseline.mean_ns / 1e6);
+
+    printf("%-60s %12s %8s %8s %8s\n", "Flags", "Mean (ms)", "Speedup", "p", "Holm p");
+    for (int i = 0; i < result->variant_count; i++) {
+        const flag_variant_t *v = &result->variants[i];
+        if (v->valid) {
+            printf("%-60s %12.3f %7.2fx %8.4f %8.4f%s\n", v->flags, v->mean_ns / 1e6, v->speedup,
+                   v->p_value, v->adjusted_p, i == result->best_index ? "  <- best" : "");
+        } else {
+            printf("%-60s %12s\n", v->flags, "failed");
+        }
+    }
+
+    if (result->best_index < 0) {
+        printf("Keeping %s: %s\n", result->baseline.flags, result->notes);
+    }
+}
+
+int save_flag_tune_result(const flag_tune_result_t *result, const char *filename) {
+    if (!result || !filename || result->best_index < 0) return -1;
+
+    FILE *fp = fopen(filename, "a");
+    if (!fp) {
+        LOG_ERROR("Failed to open %s: %s", filename, strerror(errno));
+        return -1;
+    }
+
+    const flag_variant_t *best = &result->variants[result->best_index];
+    fprintf(fp, "%s | %s | flags=%s | baseline=%s | speedup=%.2f | p=%.4f | holm_p=%.4f\n",
+            result->machine, result->location.file, best->flags, result->baseline.flags,
+            best->speedup, best->p_value, best->adjusted_p);
+
+    fclose(fp);
+    LOG_INFO("Saved best flags for %s to %s", result->location.file, filename);
+    return 0;
+}
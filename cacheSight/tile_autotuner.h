@@ -0,0 +1,115 @@
+#ifndef TILE_AUTOTUNER_H
+#define TILE_AUTOTUNER_H
+
+#include "common.h"
+#include "ast_analyzer.h"
+#include "hardware_detector.h"
+
+#define AUTOTUNE_MAX_VARIANTS 64
+#define FLAG_TUNE_MAX_CANDIDATES 16
+
+// Autotuner configuration
+typedef struct {
+    int problem_size;             // Extent of every array dimension (0 = size from L3)
+    int max_variants;             // Tile variants timed after model pruning
+    int repetitions;              // Pinned runs per variant, median is kept
+    int passes;                   // Kernel passes per run, fastest is kept
+    int pin_cpu;                  // CPU the kernels are pinned to
+    char compiler[64];
+    char cflags[128];
+    char work_dir[256];           // Generated kernels and binaries
+    char results_file[256];       // Best tiles are appended here per machine
+    int comparison_repetitions;   // Pinned runs per side of a measured comparison (t-test)
+    double significance;          // A flag set must beat the baseline at this (Holm) p-value
+    char baseline_flags[128];     // Flag sets are compared against these
+    char flags_file[256];         // Best flag sets are appended here per machine
+} autotuner_config_t;
+
+// One timed tile configuration
+typedef struct {
+    int tile_sizes[3];
+    size_t model_footprint;       // Bytes touched per tile (analytical model)
+    double median_ns;             // Median kernel time, 0 if it failed
+    bool valid;
+} tile_variant_t;
+
+// Autotuning result for one loop nest
+typedef struct {
+    source_location_t location;   // Outermost loop of the nest
+    int end_line;                 // Last line of the nest
+    int depth;                    // Number of tiled loops
+    char loop_vars[3][32];
+    int problem_size;
+    tile_variant_t variants[AUTOTUNE_MAX_VARIANTS];
+    int variant_count;
+    int best_index;               // -1 if no variant ran
+    double untiled_ns;
+    double speedup;               // untiled_ns / best median
+    char machine[384];            // Target machine signature
+    char kernel_path[512];
+    char notes[256];              // Why a nest could not be tuned
+} autotune_result_t;
+
+// One timed compiler flag set
+typedef struct {
+    char flags[128];
+    double mean_ns;               // Mean kernel time, 0 if it failed
+    double speedup;               // Baseline mean / mean
+    double p_value;               // Welch t-test against the baseline
+    double adjusted_p;            // Holm-adjusted across the candidate sets
+    bool valid;                   // Ran, matched the baseline checksum and was compared
+} flag_variant_t;
+
+// Flag tuning result for one translation unit, measured on its hottest nest
+typedef struct {
+    source_location_t location;   // Nest the kernel was extracted from
+    int problem_size;
+    flag_variant_t baseline;
+    flag_variant_t variants[FLAG_TUNE_MAX_CANDIDATES];
+    int variant_count;
+    int best_index;               // -1 if no set beat the baseline significantly (Holm)
+    char machine[384];
+    char notes[256];
+} flag_tune_result_t;
+
+// API functions
+autotuner_config_t autotuner_config_default(void);
+
+// Extract the perfect loop nest starting at loop->location into a standalone
+// kernel, then compile and time tiled variants pinned to one CPU
+int autotune_loop_nest(const loop_info_t *loop, const cache_info_t *cache_info,
+                      const autotuner_config_t *config, autotune_result_t *result);
+
+// Tune every outermost, call-free nested loop; returns the number of results
+int autotune_all_nests(const analysis_results_t *static_results, const cache_info_t *cache_info,
+                      const autotuner_config_t *config, int max_nests,
+                      autotune_result_t **results, int *result_count);
+
+// Time the nest's kernel under each candidate flag set and keep the fastest
+// one that beats the baseline flags significantly
+int autotune_compiler_flags(const loop_info_t *loop, const cache_info_t *cache_info,
+                           const autotuner_config_t *config, flag_tune_result_t *result);
+
+// Tune flags once per translation unit, on its largest call-free nest
+int autotune_flags_per_file(const analysis_results_t *static_results, const cache_info_t *cache_info,
+                           const autotuner_config_t *config, int max_files,
+                           flag_tune_result_t **results, int *result_count);
+
+// Best flag set of a tuned file, NULL if the baseline was kept
+const char* flag_tune_best_flags(const flag_tune_result_t *result);
+
+// Kernel harness shared with other generated kernels: the binary prints its
+// best pass time in ns, then a checksum of its results. Sampling returns the
+// number of runs that succeeded and the checksum of the first (may be NULL)
+int autotune_build_kernel(const autotuner_config_t *config, const char *kernel_path,
+                         const char *binary, const char *cflags, const char *defines);
+int autotune_sample_kernel(const autotuner_config_t *config, const char *binary,
+                          double *times, int max_runs, double *checksum);
+
+void print_autotune_result(const autotune_result_t *result);
+int save_autotune_result(const autotune_result_t *result, const char *filename);
+void print_flag_tune_result(const flag_tune_result_t *result);
+int save_flag_tune_result(const flag_tune_result_t *result, const char *filename);
+void autotune_machine_signature(const cache_info_t *cache_info, char *buffer, size_t size);
+
+#endif // TILE_AUTOTUNER_H
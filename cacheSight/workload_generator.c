@@ -0,0 +1,831 @@
+#include "workload_generator.h"
+#include "json_writer.h"
+#include "json_reader.h"
+#include "arena.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define WORKLOAD_TEXT_BASE 0x401000ULL     // Instruction address of site 0
+#define WORKLOAD_DATA_BASE 0x100000000ULL  // Thread t's data starts t regions above
+#define WORKLOAD_INDEX_BASE 0x7000000000ULL
+#define WORKLOAD_STACK_TOP 0x7ffff0000000ULL
+#define WORKLOAD_REGION (1ULL << 32)       // Address space per thread
+#define WORKLOAD_INDEX_COUNT 65536         // Entries in gather and indirect tables
+#define WORKLOAD_TID_BASE 4000
+#define WORKLOAD_NS_PER_ACCESS 2           // Timestamp step between accesses
+#define WORKLOAD_VERSION_SLOTS 65536       // Line versions tracked for coherence
+
+// How a workload walks memory; several specs share one shape
+typedef enum {
+    SHAPE_SEQUENTIAL,
+    SHAPE_STRIDED,
+    SHAPE_RANDOM,
+    SHAPE_GATHER,
+    SHAPE_CHASE,
+    SHAPE_COLUMN,
+    SHAPE_INDIRECT,
+    SHAPE_SHARED_COUNTER,
+    SHAPE_CODE_SPREAD,
+    SHAPE_SET_CONFLICT,
+    SHAPE_STACK
+} workload_shape_t;
+
+// Line last seen by one site and thread, with the line's version then
+typedef struct {
+    uint64_t line;                      // Line number + 1; 0 = nothing cached
+    uint64_t version;
+} site_view_t;
+
+typedef struct {
+    uint64_t line;
+    uint64_t version;
+} line_version_t;
+
+// Stream generation state
+typedef struct {
+    const workload_spec_t *spec;
+    const cache_info_t *cache_info;
+    workload_shape_t shape;
+    char file[96];
+    int line_size;
+    int level;                          // Level the footprint misses in
+    int latency;
+    int cores;
+    cache_miss_sample_t *samples;
+    int count;
+    int capacity;
+    site_view_t *views;                 // [site * threads + thread]
+    line_version_t *versions;           // Bumped by writes; a stale view misses
+    uint32_t *chase;                    // Next node of the pointer chase
+    size_t nodes;
+    uint64_t rng;
+} workload_gen_t;
+
+static workload_shape_t spec_shape(const workload_spec_t *spec) {
+    if (spec->kind == WORKLOAD_ACCESS_PATTERN) {
+        switch (spec->access) {
+            case SEQUENTIAL: return SHAPE_SEQUENTIAL;
+            case STRIDED: return SHAPE_STRIDED;
+            case RANDOM: return SHAPE_RANDOM;
+            case GATHER_SCATTER: return SHAPE_GATHER;
+            case ACCESS_LOOP_CARRIED_DEP: return SHAPE_CHASE;
+            case NESTED_LOOP: return SHAPE_COLUMN;
+            case INDIRECT_ACCESS: return SHAPE_INDIRECT;
+        }
+        return SHAPE_SEQUENTIAL;
+    }
+    
+    switch (spec->antipattern) {
+        case HOTSPOT_REUSE: return SHAPE_SEQUENTIAL;
+        case THRASHING: return SHAPE_STRIDED;
+        case FALSE_SHARING: return SHAPE_SHARED_COUNTER;
+        case IRREGULAR_GATHER_SCATTER: return SHAPE_GATHER;
+        case UNCOALESCED_ACCESS: return SHAPE_STRIDED;
+        case CACHE_LOOP_CARRIED_DEP: return SHAPE_CHASE;
+        case INSTRUCTION_OVERFLOW: return SHAPE_CODE_SPREAD;
+        case DEAD_STORES: return SHAPE_SEQUENTIAL;
+        case HIGH_ASSOCIATIVITY_PRESSURE: return SHAPE_SET_CONFLICT;
+        case STREAMING_EVICTION: return SHAPE_SEQUENTIAL;
+        case STACK_OVERFLOW: return SHAPE_STACK;
+        case BANK_CONFLICTS: return SHAPE_STRIDED;
+    }
+    return SHAPE_SEQUENTIAL;
+}
+
+const char* workload_kind_to_string(workload_kind_t kind) {
+    return kind == WORKLOAD_ACCESS_PATTERN ? "access_pattern" : "antipattern";
+}
+
+void workload_source_file(const workload_spec_t *spec, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s.c", spec->name);
+}
+
+// Workload with the fields every shape needs
+static workload_spec_t make_spec(const char *name, workload_kind_t kind, access_pattern_t access,
+                                 cache_antipattern_t antipattern, size_t stride, size_t footprint) {
+    workload_spec_t spec;
+    memset(&spec, 0, sizeof(spec));
+    strncpy(spec.name, name, sizeof(spec.name) - 1);
+    spec.kind = kind;
+    spec.access = access;
+    spec.antipattern = antipattern;
+    spec.element_size = 8;
+    spec.stride_bytes = stride;
+    spec.footprint_bytes = footprint;
+    spec.threads = 1;
+    spec.code_sites = 1;
+    spec.write_fraction = 0.25;
+    spec.accesses = 200000;
+    return spec;
+}
+
+int workload_suite_default(const cache_info_t *cache_info, workload_spec_t *specs, int capacity) {
+    if (!cache_info || !specs || cache_info->num_levels <= 0) {
+        LOG_ERROR("Invalid parameters for workload_suite_default");
+        return -1;
+    }
+    
+    const cache_level_t *l1 = &cache_info->levels[0];
+    size_t line = l1->line_size > 0 ? l1->line_size : 64;
+    size_t l2 = cache_info->num_levels > 1 ? cache_info->levels[1].size : l1->size * 8;
+    size_t llc = cache_info->levels[cache_info->num_levels - 1].size;
+    int ways = l1->associativity > 0 ? l1->associativity : 8;
+    
+    workload_spec_t suite[19];
+    int n = 0;
+    
+    // One per access pattern
+    suite[n++] = make_spec("access_sequential", WORKLOAD_ACCESS_PATTERN, SEQUENTIAL,
+                           HOTSPOT_REUSE, 8, 4 * l2);
+    suite[n++] = make_spec("access_strided", WORKLOAD_ACCESS_PATTERN, STRIDED,
+                           UNCOALESCED_ACCESS, 256, 4 * l2);
+    suite[n++] = make_spec("access_random", WORKLOAD_ACCESS_PATTERN, RANDOM,
+                           IRREGULAR_GATHER_SCATTER, 8, 4 * llc);
+    suite[n++] = make_spec("access_gather_scatter", WORKLOAD_ACCESS_PATTERN, GATHER_SCATTER,
+                           IRREGULAR_GATHER_SCATTER, 8, 4 * llc);
+    suite[n++] = make_spec("access_loop_carried_dep", WORKLOAD_ACCESS_PATTERN, ACCESS_LOOP_CARRIED_DEP,
+                           CACHE_LOOP_CARRIED_DEP, line, 4 * l2);
+    suite[n++] = make_spec("access_nested_loop", WORKLOAD_ACCESS_PATTERN, NESTED_LOOP,
+                           UNCOALESCED_ACCESS, 8192, 4 * l2);
+    suite[n++] = make_spec("access_indirect", WORKLOAD_ACCESS_PATTERN, INDIRECT_ACCESS,
+                           IRREGULAR_GATHER_SCATTER, 2 * line, 4 * l2);
+    
+    // One per anti-pattern
+    suite[n] = make_spec("anti_hotspot_reuse", WORKLOAD_ANTIPATTERN, SEQUENTIAL,
+                         HOTSPOT_REUSE, 8, 2048);
+    suite[n++].write_fraction = 0.5;
+    suite[n++] = make_spec("anti_thrashing", WORKLOAD_ANTIPATTERN, STRIDED,
+                           THRASHING, line, l2 + l2 / 2);
+    
+    suite[n] = make_spec("anti_false_sharing", WORKLOAD_ANTIPATTERN, SEQUENTIAL,
+                         FALSE_SHARING, 0, line);
+    suite[n].threads = 4;
+    suite[n].false_sharing_offset = 8;
+    suite[n++].write_fraction = 1.0;
+    
+    suite[n] = make_spec("anti_irregular_gather_scatter", WORKLOAD_ANTIPATTERN, GATHER_SCATTER,
+                         IRREGULAR_GATHER_SCATTER, 8, 4 * llc);
+    suite[n++].write_fraction = 0.5;
+    suite[n++] = make_spec("anti_uncoalesced_access", WORKLOAD_ANTIPATTERN, STRIDED,
+                           UNCOALESCED_ACCESS, 8 * line, 4 * l2);
+    suite[n++] = make_spec("anti_loop_carried_dep", WORKLOAD_ANTIPATTERN, ACCESS_LOOP_CARRIED_DEP,
+                           CACHE_LOOP_CARRIED_DEP, line, 4 * llc);
+    
+    suite[n] = make_spec("anti_instruction_overflow", WORKLOAD_ANTIPATTERN, STRIDED,
+                         INSTRUCTION_OVERFLOW, line, 1024 * 4096);
+    suite[n++].code_sites = 1024;
+    
+    suite[n] = make_spec("anti_dead_stores", WORKLOAD_ANTIPATTERN, SEQUENTIAL,
+                         DEAD_STORES, 8, 4 * l2);
+    suite[n++].write_fraction = 1.0;
+    
+    suite[n] = make_spec("anti_associativity_pressure", WORKLOAD_ANTIPATTERN, STRIDED,
+                         HIGH_ASSOCIATIVITY_PRESSURE, 8, 0);
+    suite[n].conflict_stride = l1->size / ways;
+    suite[n].conflict_ways = 2 * ways;
+    suite[n++].footprint_bytes = 2 * ways * (l1->size / ways);
+    
+    suite[n] = make_spec("anti_streaming_eviction", WORKLOAD_ANTIPATTERN, SEQUENTIAL,
+                         STREAMING_EVICTION, 8, 4 * llc);
+    suite[n++].write_fraction = 0;
+    
+    suite[n] = make_spec("anti_stack_overflow", WORKLOAD_ANTIPATTERN, STRIDED,
+                         STACK_OVERFLOW, 2048, 4 * l2);
+    suite[n++].write_fraction = 0.5;
+    
+    // Every thread walks a power-of-two-aligned region with a stride of one
+    // bank rotation (8 banks of 8 bytes), so all of them hit one bank
+    suite[n] = make_spec("anti_bank_conflicts", WORKLOAD_ANTIPATTERN, STRIDED,
+                         BANK_CONFLICTS, 64, 1024 * 1024);
+    suite[n++].threads = 4;
+    
+    if (n > capacity) n = capacity;
+    memcpy(specs, suite, n * sizeof(workload_spec_t));
+    return n;
+}
+
+static uint64_t gen_rand(workload_gen_t *gen) {
+    uint64_t x = gen->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    gen->rng = x;
+    return x;
+}
+
+// Line of each site in the kernel source: helpers one line above the graded
+// access, spread sites one per line below it
+static int site_line(const workload_spec_t *spec, int site) {
+    return spec->code_sites > 1 ? WORKLOAD_HOT_LINE + site : WORKLOAD_HOT_LINE - site;
+}
+
+static uint64_t *line_version(workload_gen_t *gen, uint64_t line) {
+    line_version_t *slot = &gen->versions[(line * 0x9E3779B97F4A7C15ULL) >> 48];
+    if (slot->line != line) {
+        slot->line = line;
+        slot->version = 0;
+    }
+    return &slot->version;
+}
+
+// Record the access if it misses: the site and thread last touched another
+// line, or another thread wrote this one since
+static void gen_access(workload_gen_t *gen, int thread, int site, uint64_t address,
+                       bool is_write, uint64_t step) {
+    const workload_spec_t *spec = gen->spec;
+    uint64_t line = address / gen->line_size;
+    site_view_t *view = &gen->views[site * spec->threads + thread];
+    uint64_t *version = line_version(gen, line);
+    
+    bool hit = view->line == line + 1 && view->version == *version;
+    if (is_write) (*version)++;
+    view->line = line + 1;
+    view->version = *version;
+    if (hit || gen->count >= gen->capacity) return;
+    
+    cache_miss_sample_t *sample = &gen->samples[gen->count++];
+    memset(sample, 0, sizeof(*sample));
+    sample->instruction_addr = WORKLOAD_TEXT_BASE + (uint64_t)site * 64;
+    sample->memory_addr = address;
+    sample->timestamp = step * WORKLOAD_NS_PER_ACCESS;
+    strncpy(sample->source_loc.file, gen->file, sizeof(sample->source_loc.file) - 1);
+    sample->source_loc.line = site_line(spec, site);
+    if (spec->code_sites > 1) {
+        snprintf(sample->source_loc.function, sizeof(sample->source_loc.function), "site_%d", site);
+    } else {
+        strcpy(sample->source_loc.function, "kernel");
+    }
+    sample->cache_level_missed = gen->level;
+    sample->cpu_id = thread % gen->cores;
+    sample->access_size = (int)spec->element_size;
+    sample->is_write = is_write;
+    sample->latency_cycles = gen->latency;
+    sample->tid = WORKLOAD_TID_BASE + thread;
+}
+
+// Deepest level whose capacity the footprint exceeds; coherence misses on
+// a shared line are served from L2
+static void gen_miss_level(workload_gen_t *gen) {
+    const cache_info_t *info = gen->cache_info;
+    size_t footprint = gen->spec->footprint_bytes;
+    
+    gen->level = 1;
+    for (int i = 0; i < info->num_levels; i++) {
+        if (footprint > info->levels[i].size) gen->level = i + 2;
+    }
+    if (gen->shape == SHAPE_SHARED_COUNTER) gen->level = 2;
+    
+    if (gen->level > info->num_levels) {
+        gen->level = info->num_levels;
+        gen->latency = 200;  // Memory
+    } else {
+        gen->latency = info->levels[gen->level - 1].latency_cycles;
+    }
+}
+
+// Single cycle through every node (Sattolo's shuffle), so the chase never
+// settles into a short loop
+static int build_chase(workload_gen_t *gen) {
+    size_t stride = gen->spec->stride_bytes > 0 ? gen->spec->stride_bytes : 64;
+    gen->nodes = gen->spec->footprint_bytes / stride;
+    if (gen->nodes < 2) gen->nodes = 2;
+    
+    gen->chase = MALLOC_LOGGED(gen->nodes * sizeof(uint32_t));
+    if (!gen->chase) return -1;
+    for (size_t i = 0; i < gen->nodes; i++) gen->chase[i] = (uint32_t)i;
+    for (size_t i = gen->nodes - 1; i > 0; i--) {
+        size_t j = gen_rand(gen) % i;
+        uint32_t t = gen->chase[i];
+        gen->chase[i] = gen->chase[j];
+        gen->chase[j] = t;
+    }
+    return 0;
+}
+
+// Every access of one thread's iteration k, in kernel order
+static void gen_iteration(workload_gen_t *gen, int t, uint64_t k, uint64_t step, uint32_t *position) {
+    const workload_spec_t *spec = gen->spec;
+    uint64_t base = WORKLOAD_DATA_BASE + (uint64_t)t * WORKLOAD_REGION;
+    size_t element = spec->element_size;
+    size_t footprint = spec->footprint_bytes > element ? spec->footprint_bytes : element;
+    size_t stride = spec->stride_bytes > 0 ? spec->stride_bytes : element;
+    bool is_write = (gen_rand(gen) % 1000) < (uint64_t)(spec->write_fraction * 1000);
+    
+    switch (gen->shape) {
+        case SHAPE_SEQUENTIAL:
+            gen_access(gen, t, 0, base + (k * element) % footprint, is_write, step);
+            break;
+        
+        case SHAPE_STRIDED:
+            gen_access(gen, t, 0, base + (k * stride) % footprint, is_write, step);
+            break;
+        
+        case SHAPE_RANDOM:
+            gen_access(gen, t, 0, base + (gen_rand(gen) % (footprint / element)) * element,
+                       is_write, step);
+            break;
+        
+        case SHAPE_GATHER: {
+            uint64_t index = WORKLOAD_INDEX_BASE + (uint64_t)t * WORKLOAD_REGION;
+            gen_access(gen, t, 1, index + (k % WORKLOAD_INDEX_COUNT) * 4, false, step);
+            gen_access(gen, t, 0, base + (gen_rand(gen) % (footprint / element)) * element,
+                       is_write, step);
+            break;
+        }
+        
+        case SHAPE_CHASE:
+            *position = gen->chase[*position];
+            gen_access(gen, t, 0, base + (uint64_t)*position * stride, false, step);
+            break;
+        
+        case SHAPE_COLUMN: {
+            uint64_t rows = footprint / stride > 0 ? footprint / stride : 1;
+            uint64_t column = (k / rows) % (stride / element);
+            gen_access(gen, t, 0, base + (k % rows) * stride + column * element, is_write, step);
+            break;
+        }
+        
+        case SHAPE_INDIRECT: {
+            // Objects allocated in runs of 64, each run handed out in a scrambled order
+            uint64_t nodes = footprint / stride > 0 ? footprint / stride : 1;
+            uint64_t i = k % nodes;
+            uint64_t node = (i & ~63ULL) | (((i & 63) * 37) & 63);
+            uint64_t pointers = WORKLOAD_INDEX_BASE + (uint64_t)t * WORKLOAD_REGION;
+            gen_access(gen, t, 1, pointers + (k % WORKLOAD_INDEX_COUNT) * 8, false, step);
+            gen_access(gen, t, 0, base + (node % nodes) * stride, is_write, step);
+            break;
+        }
+        
+        case SHAPE_SHARED_COUNTER:
+            gen_access(gen, t, 0, WORKLOAD_DATA_BASE + (uint64_t)t * spec->false_sharing_offset,
+                       true, step);
+            break;
+        
+        case SHAPE_CODE_SPREAD: {
+            int site = (int)(k % spec->code_sites);
+            uint64_t offset = ((k / spec->code_sites) * gen->line_size) % 4096;
+            gen_access(gen, t, site, base + (uint64_t)site * 4096 + offset, is_write, step);
+            break;
+        }
+        
+        case SHAPE_SET_CONFLICT: {
+            int ways = spec->conflict_ways > 0 ? spec->conflict_ways : 1;
+            uint64_t column = (k / ways) % 8;
+            gen_access(gen, t, 0, base + (k % ways) * spec->conflict_stride + column * element,
+                       is_write, step);
+            break;
+        }
+        
+        case SHAPE_STACK: {
+            // Depth rises to the footprint and unwinds; each frame is touched near its top
+            uint64_t depth_max = footprint / stride > 0 ? footprint / stride : 1;
+            uint64_t depth = k % (2 * depth_max);
+            if (depth >= depth_max) depth = 2 * depth_max - 1 - depth;
+            uint64_t top = WORKLOAD_STACK_TOP - (uint64_t)t * WORKLOAD_REGION;
+            gen_access(gen, t, 0, top - 8 - depth * stride - (k % 8) * element, is_write, step);
+            break;
+        }
+    }
+}
+
+int workload_generate(const workload_spec_t *spec, const cache_info_t *cache_info,
+                      cache_miss_sample_t **samples, int *count) {
+    if (!spec || !cache_info || !samples || !count || cache_info->num_levels <= 0 ||
+        spec->threads < 1 || spec->threads > WORKLOAD_MAX_THREADS || spec->code_sites < 1) {
+        LOG_ERROR("Invalid parameters for workload_generate");
+        return -1;
+    }
+    
+    workload_gen_t gen;
+    memset(&gen, 0, sizeof(gen));
+    gen.spec = spec;
+    gen.cache_info = cache_info;
+    gen.shape = spec_shape(spec);
+    gen.line_size = cache_info->levels[0].line_size > 0 ? cache_info->levels[0].line_size : 64;
+    gen.cores = cache_info->num_cores > 0 ? cache_info->num_cores : 1;
+    workload_source_file(spec, gen.file, sizeof(gen.file));
+    gen_miss_level(&gen);
+    
+    // Seeded by name so each workload's stream is reproducible
+    gen.rng = 0xcbf29ce484222325ULL;
+    for (const char *c = spec->name; *c; c++) {
+        gen.rng = (gen.rng ^ (uint8_t)*c) * 0x100000001b3ULL;
+    }
+    
+    uint64_t total = (uint64_t)spec->accesses * spec->threads;
+    gen.capacity = total < WORKLOAD_MAX_SAMPLES ? (int)total : WORKLOAD_MAX_SAMPLES;
+    gen.samples = MALLOC_LOGGED((size_t)gen.capacity * sizeof(cache_miss_sample_t));
+    // Index and pointer loads are site 1 next to the graded site 0
+    int sites = spec->code_sites > 2 ? spec->code_sites : 2;
+    gen.views = CALLOC_LOGGED((size_t)sites * spec->threads, sizeof(site_view_t));
+    gen.versions = CALLOC_LOGGED(WORKLOAD_VERSION_SLOTS, sizeof(line_version_t));
+    if (!gen.samples || !gen.views || !gen.versions ||
+        (gen.shape == SHAPE_CHASE && build_chase(&gen) != 0)) {
+        LOG_ERROR("Failed to allocate workload %s", spec->name);
+        if (gen.samples) FREE_LOGGED(gen.samples);
+        if (gen.views) FREE_LOGGED(gen.views);
+        if (gen.versions) FREE_LOGGED(gen.versions);
+        if (gen.chase) FREE_LOGGED(gen.chase);
+        return -1;
+    }
+    
+    // Threads advance in lockstep, interleaving their accesses in time
+    uint32_t positions[WORKLOAD_MAX_THREADS] = {0};
+    for (int t = 0; t < spec->threads; t++) {
+        positions[t] = gen.nodes > 0 ? (uint32_t)(t * (gen.nodes / spec->threads)) : 0;
+    }
+    
+    uint64_t step = 0;
+    for (uint64_t k = 0; k < spec->accesses && gen.count < gen.capacity; k++) {
+        for (int t = 0; t < spec->threads; t++) {
+            gen_iteration(&gen, t, k, step++, &positions[t]);
+        }
+    }
+    
+    FREE_LOGGED(gen.views);
+    FREE_LOGGED(gen.versions);
+    if (gen.chase) FREE_LOGGED(gen.chase);
+    
+    *samples = gen.samples;
+    *count = gen.count;
+    
+    LOG_INFO("Generated workload %s: %d miss records from %lu accesses",
+             spec->name, gen.count, (unsigned long)step);
+    return 0;
+}
+
+// Kernel body per shape; the graded access is preceded by #line so its
+// debug line is WORKLOAD_HOT_LINE whatever the preamble's length
+static void emit_shape(FILE *fp, workload_shape_t shape, const char *file) {
+    switch (shape) {
+        case SHAPE_SEQUENTIAL:
+            fprintf(fp, "#line %d \"%s\"\n", WORKLOAD_HOT_LINE, file);
+            fprintf(fp, "        ACCESS(data + (k * ELEMENT) %% FOOTPRINT);\n");
+            break;
+        case SHAPE_STRIDED:
+            fprintf(fp, "#line %d \"%s\"\n", WORKLOAD_HOT_LINE, file);
+            fprintf(fp, "        ACCESS(data + (k * STRIDE) %% FOOTPRINT);\n");
+            break;
+        case SHAPE_RANDOM:
+            fprintf(fp, "        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;\n");
+            fprintf(fp, "#line %d \"%s\"\n", WORKLOAD_HOT_LINE, file);
+            fprintf(fp, "        ACCESS(data + (seed %% (FOOTPRINT / ELEMENT)) * ELEMENT);\n");
+            break;
+        case SHAPE_GATHER:
+            fprintf(fp, "#line %d \"%s\"\n", WORKLOAD_HOT_LINE - 1, file);
+            fprintf(fp, "        uint32_t j = g_index[t][k %% INDEX_COUNT];\n");
+            fprintf(fp, "        ACCESS(data + (uint64_t)j * ELEMENT);\n");
+            break;
+        case SHAPE_CHASE:
+            fprintf(fp, "#line %d \"%s\"\n", WORKLOAD_HOT_LINE, file);
+            fprintf(fp, "        p = *(volatile uint32_t *)(data + (uint64_t)p * STRIDE);\n");
+            break;
+        case SHAPE_COLUMN:
+            fprintf(fp, "#line %d \"%s\"\n", WORKLOAD_HOT_LINE, file);
+            fprintf(fp, "        ACCESS(data + (k %% ROWS) * STRIDE + ((k / ROWS) %% (STRIDE / ELEMENT)) * ELEMENT);\n");
+            break;
+        case SHAPE_INDIRECT:
+            fprintf(fp, "#line %d \"%s\"\n", WORKLOAD_HOT_LINE - 1, file);
+            fprintf(fp, "        unsigned char *object = g_objects[t][k %% INDEX_COUNT];\n");
+            fprintf(fp, "        ACCESS(object);\n");
+            break;
+        case SHAPE_SHARED_COUNTER:
+            fprintf(fp, "#line %d \"%s\"\n", WORKLOAD_HOT_LINE, file);
+            fprintf(fp, "        (*(volatile uint64_t *)(g_shared + t * OFFSET))++;\n");
+            break;
+        case SHAPE_CODE_SPREAD:
+            fprintf(fp, "        sum += g_sites[k %% SITES](data, k / SITES);\n");
+            break;
+        case SHAPE_SET_CONFLICT:
+            fprintf(fp, "#line %d \"%s\"\n", WORKLOAD_HOT_LINE, file);
+            fprintf(fp, "        ACCESS(data + (k %% WAYS) * CONFLICT_STRIDE + ((k / WAYS) %% 8) * ELEMENT);\n");
+            break;
+        case SHAPE_STACK:
+            // An explicit stack region stands in for recursion so the access stays on one line
+            fprintf(fp, "        uint64_t depth = k %% (2 * DEPTH);\n");
+            fprintf(fp, "        if (depth >= DEPTH) depth = 2 * DEPTH - 1 - depth;\n");
+            fprintf(fp, "#line %d \"%s\"\n", WORKLOAD_HOT_LINE, file);
+            fprintf(fp, "        ACCESS(data + FOOTPRINT - 8 - depth * STRIDE - (k %% 8) * ELEMENT);\n");
+            break;
+    }
+}
+
+int workload_emit_kernel(const workload_spec_t *spec, const char *path) {
+    if (!spec || !path) {
+        LOG_ERROR("Invalid parameters for workload_emit_kernel");
+        return -1;
+    }
+    
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        LOG_ERROR("Cannot write %s: %s", path, strerror(errno));
+        return -1;
+    }
+    
+    workload_shape_t shape = spec_shape(spec);
+    char file[96];
+    workload_source_file(spec, file, sizeof(file));
+    size_t stride = spec->stride_bytes > 0 ? spec->stride_bytes : spec->element_size;
+    size_t footprint = spec->footprint_bytes > spec->element_size ? spec->footprint_bytes : spec->element_size;
+    
+    fprintf(fp, "// %s: cacheSight synthetic workload\n", spec->name);
+    fprintf(fp, "// Ground truth: %s %s\n", workload_kind_to_string(spec->kind),
+            spec->kind == WORKLOAD_ACCESS_PATTERN ? access_pattern_to_string(spec->access) :
+                                                    cache_antipattern_to_string(spec->antipattern));
+    fprintf(fp, "// Build: cc -O1 -g -pthread %s -o %s\n", file, spec->name);
+    fprintf(fp, "// The graded access is on line %d.\n", WORKLOAD_HOT_LINE);
+    fprintf(fp, "#include <pthread.h>\n#include <stdint.h>\n#include <stdio.h>\n#include <stdlib.h>\n\n");
+    fprintf(fp, "#define THREADS %d\n", spec->threads);
+    fprintf(fp, "#define ACCESSES %zuULL\n", spec->accesses);
+    fprintf(fp, "#define REPEAT 500\n");
+    fprintf(fp, "#define ELEMENT %zuULL\n", spec->element_size);
+    fprintf(fp, "#define STRIDE %zuULL\n", stride);
+    fprintf(fp, "#define FOOTPRINT %zuULL\n", footprint);
+    fprintf(fp, "#define ROWS (FOOTPRINT / STRIDE)\n");
+    fprintf(fp, "#define DEPTH (FOOTPRINT / STRIDE)\n");
+    fprintf(fp, "#define INDEX_COUNT %d\n", WORKLOAD_INDEX_COUNT);
+    fprintf(fp, "#define OFFSET %d\n", spec->false_sharing_offset);
+    fprintf(fp, "#define SITES %d\n", spec->code_sites);
+    fprintf(fp, "#define WAYS %d\n", spec->conflict_ways > 0 ? spec->conflict_ways : 1);
+    fprintf(fp, "#define CONFLICT_STRIDE %zuULL\n", spec->conflict_stride);
+    fprintf(fp, "#define WRITES %d  // Of every 1024 accesses\n\n", (int)(spec->write_fraction * 1024));
+    fprintf(fp, "#define ACCESS(p) do { \\\n");
+    fprintf(fp, "    if ((int)((k * 2654435761u) & 1023) < WRITES) *(volatile uint64_t *)(p) = k; \\\n");
+    fprintf(fp, "    else sum += *(volatile uint64_t *)(p); \\\n");
+    fprintf(fp, "} while (0)\n\n");
+    fprintf(fp, "static unsigned char *g_data[THREADS];\n");
+    fprintf(fp, "static __attribute__((unused)) uint32_t *g_index[THREADS];\n");
+    fprintf(fp, "static __attribute__((unused)) unsigned char **g_objects[THREADS];\n");
+    fprintf(fp, "static __attribute__((unused)) unsigned char g_shared[64] __attribute__((aligned(64)));\n");
+    fprintf(fp, "static volatile uint64_t g_sink;\n\n");
+    
+    if (shape == SHAPE_CODE_SPREAD) {
+        // One function per line, so each site has its own instructions and line
+        fprintf(fp, "typedef uint64_t (*site_fn)(unsigned char *, uint64_t);\n");
+        fprintf(fp, "#line %d \"%s\"\n", WORKLOAD_HOT_LINE, file);
+        for (int s = 0; s < spec->code_sites; s++) {
+            fprintf(fp, "__attribute__((noinline)) static uint64_t site_%d(unsigned char *d, uint64_t i) "
+                    "{ return *(volatile uint64_t *)(d + %dULL * 4096 + (i * 64) %% 4096); }\n", s, s);
+        }
+        fprintf(fp, "static const site_fn g_sites[SITES] = {\n");
+        for (int s = 0; s < spec->code_sites; s++) {
+            fprintf(fp, "    site_%d,\n", s);
+        }
+        fprintf(fp, "};\n\n");
+    }
+    
+    fprintf(fp, "static void *kernel(void *arg) {\n");
+    fprintf(fp, "    int t = (int)(intptr_t)arg;\n");
+    fprintf(fp, "    unsigned char *data = g_data[t];\n");
+    fprintf(fp, "    uint64_t seed = 0x9E3779B97F4A7C15ULL + t, sum = 0;\n");
+    fprintf(fp, "    uint32_t p = (uint32_t)(t * ((FOOTPRINT / STRIDE) / THREADS));\n");
+    fprintf(fp, "    (void)data; (void)seed; (void)p;\n");
+    fprintf(fp, "    for (uint64_t k = 0; k < ACCESSES * REPEAT; k++) {\n");
+    emit_shape(fp, shape, file);
+    fprintf(fp, "    }\n");
+    fprintf(fp, "    g_sink += sum + p;\n");
+    fprintf(fp, "    return NULL;\n");
+    fprintf(fp, "}\n\n");
+    
+    fprintf(fp, "int main(void) {\n");
+    fprintf(fp, "    uint64_t seed = 88172645463325252ULL;\n");
+    fprintf(fp, "    (void)seed;\n");
+    fprintf(fp, "    for (int t = 0; t < THREADS; t++) {\n");
+    fprintf(fp, "        uint64_t bytes = FOOTPRINT + %s;\n",
+            shape == SHAPE_SET_CONFLICT ? "WAYS * CONFLICT_STRIDE" :
+            shape == SHAPE_CODE_SPREAD ? "SITES * 4096ULL" : "4096");
+    fprintf(fp, "        if (posix_memalign((void **)&g_data[t], 4096, bytes) != 0) return 1;\n");
+    fprintf(fp, "        for (uint64_t i = 0; i < bytes; i += 4096) g_data[t][i] = 0;\n");
+    if (shape == SHAPE_GATHER) {
+        fprintf(fp, "        g_index[t] = malloc(INDEX_COUNT * sizeof(uint32_t));\n");
+        fprintf(fp, "        for (int i = 0; i < INDEX_COUNT; i++) {\n");
+        fprintf(fp, "            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;\n");
+        fprintf(fp, "            g_index[t][i] = (uint32_t)(seed %% (FOOTPRINT / ELEMENT));\n");
+        fprintf(fp, "        }\n");
+    } else if (shape == SHAPE_INDIRECT) {
+        fprintf(fp, "        // Objects allocated in runs of 64, handed out in a scrambled order\n");
+        fprintf(fp, "        g_objects[t] = malloc(INDEX_COUNT * sizeof(unsigned char *));\n");
+        fprintf(fp, "        for (uint64_t i = 0; i < INDEX_COUNT; i++) {\n");
+        fprintf(fp, "            uint64_t n = i %% (FOOTPRINT / STRIDE);\n");
+        fprintf(fp, "            g_objects[t][i] = g_data[t] + (((n & ~63ULL) | (((n & 63) * 37) & 63)) %% (FOOTPRINT / STRIDE)) * STRIDE;\n");
+        fprintf(fp, "        }\n");
+    } else if (shape == SHAPE_CHASE) {
+        fprintf(fp, "        // Sattolo's shuffle: one cycle through every node\n");
+        fprintf(fp, "        uint64_t nodes = FOOTPRINT / STRIDE;\n");
+        fprintf(fp, "        for (uint64_t i = 0; i < nodes; i++) *(uint32_t *)(g_data[t] + i * STRIDE) = (uint32_t)i;\n");
+        fprintf(fp, "        for (uint64_t i = nodes - 1; i > 0; i--) {\n");
+        fprintf(fp, "            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;\n");
+        fprintf(fp, "            uint32_t *a = (uint32_t *)(g_data[t] + i * STRIDE);\n");
+        fprintf(fp, "            uint32_t *b = (uint32_t *)(g_data[t] + (seed %% i) * STRIDE);\n");
+        fprintf(fp, "            uint32_t tmp = *a; *a = *b; *b = tmp;\n");
+        fprintf(fp, "        }\n");
+    }
+    fprintf(fp, "    }\n\n");
+    fprintf(fp, "    pthread_t threads[THREADS];\n");
+    fprintf(fp, "    for (int t = 0; t < THREADS; t++) {\n");
+    fprintf(fp, "        pthread_create(&threads[t], NULL, kernel, (void *)(intptr_t)t);\n");
+    fprintf(fp, "    }\n");
+    fprintf(fp, "    for (int t = 0; t < THREADS; t++) {\n");
+    fprintf(fp, "        pthread_join(threads[t], NULL);\n");
+    fprintf(fp, "    }\n");
+    fprintf(fp, "    printf(\"%%llu\\n\", (unsigned long long)g_sink);\n");
+    fprintf(fp, "    return 0;\n");
+    fprintf(fp, "}\n");
+    
+    int ret = ferror(fp) ? -1 : 0;
+    if (fclose(fp) != 0) ret = -1;
+    if (ret != 0) {
+        LOG_ERROR("Failed writing %s", path);
+    }
+    return ret;
+}
+
+int workload_save_stream(const workload_spec_t *spec, const cache_miss_sample_t *samples,
+                         int count, const char *path) {
+    if (!spec || (!samples && count > 0) || !path) {
+        LOG_ERROR("Invalid parameters for workload_save_stream");
+        return -1;
+    }
+    
+    json_writer_t *writer = MALLOC_LOGGED(sizeof(json_writer_t));
+    if (!writer) return -1;
+    if (json_writer_open(writer, path, false) != 0) {
+        FREE_LOGGED(writer);
+        return -1;
+    }
+    
+    json_begin_object(writer, NULL);
+    json_string(writer, "record", "workload");
+    json_string(writer, "name", spec->name);
+    json_string(writer, "kind", workload_kind_to_string(spec->kind));
+    json_int(writer, "access", spec->access);
+    json_string(writer, "access_name", access_pattern_to_string(spec->access));
+    json_int(writer, "antipattern", spec->antipattern);
+    json_string(writer, "antipattern_name", cache_antipattern_to_string(spec->antipattern));
+    json_uint(writer, "element_size", spec->element_size);
+    json_uint(writer, "stride_bytes", spec->stride_bytes);
+    json_uint(writer, "footprint_bytes", spec->footprint_bytes);
+    json_int(writer, "threads", spec->threads);
+    json_int(writer, "false_sharing_offset", spec->false_sharing_offset);
+    json_uint(writer, "conflict_stride", spec->conflict_stride);
+    json_int(writer, "conflict_ways", spec->conflict_ways);
+    json_int(writer, "code_sites", spec->code_sites);
+    json_double(writer, "write_fraction", spec->write_fraction);
+    json_uint(writer, "accesses", spec->accesses);
+    json_int(writer, "sample_count", count);
+    json_end_object(writer);
+    json_end_record(writer);
+    
+    for (int i = 0; i < count; i++) {
+        const cache_miss_sample_t *sample = &samples[i];
+        json_begin_object(writer, NULL);
+        json_string(writer, "record", "sample");
+        json_uint(writer, "ip", sample->instruction_addr);
+        json_uint(writer, "addr", sample->memory_addr);
+        json_uint(writer, "time", sample->timestamp);
+        json_int(writer, "cpu", sample->cpu_id);
+        json_int(writer, "tid", sample->tid);
+        json_int(writer, "size", sample->access_size);
+        json_bool(writer, "write", sample->is_write);
+        json_int(writer, "level", sample->cache_level_missed);
+        json_uint(writer, "latency", sample->latency_cycles);
+        json_string(writer, "file", sample->source_loc.file);
+        json_int(writer, "line", sample->source_loc.line);
+        json_string(writer, "function", sample->source_loc.function);
+        json_end_object(writer);
+        json_end_record(writer);
+    }
+    
+    int ret = json_writer_close(writer);
+    FREE_LOGGED(writer);
+    if (ret == 0) {
+        LOG_INFO("Saved workload %s: %d records to %s", spec->name, count, path);
+    }
+    return ret;
+}
+
+static void read_spec(workload_spec_t *spec, const json_value_t *record) {
+    memset(spec, 0, sizeof(*spec));
+    strncpy(spec->name, json_get_string(record, "name", ""), sizeof(spec->name) - 1);
+    spec->kind = strcmp(json_get_string(record, "kind", ""), "antipattern") == 0 ?
+                 WORKLOAD_ANTIPATTERN : WORKLOAD_ACCESS_PATTERN;
+    spec->access = (access_pattern_t)json_get_number(record, "access", 0);
+    spec->antipattern = (cache_antipattern_t)json_get_number(record, "antipattern", 0);
+    spec->element_size = (size_t)json_get_number(record, "element_size", 8);
+    spec->stride_bytes = (size_t)json_get_number(record, "stride_bytes", 0);
+    spec->footprint_bytes = (size_t)json_get_number(record, "footprint_bytes", 0);
+    spec->threads = (int)json_get_number(record, "threads", 1);
+    spec->false_sharing_offset = (int)json_get_number(record, "false_sharing_offset", 0);
+    spec->conflict_stride = (size_t)json_get_number(record, "conflict_stride", 0);
+    spec->conflict_ways = (int)json_get_number(record, "conflict_ways", 0);
+    spec->code_sites = (int)json_get_number(record, "code_sites", 1);
+    spec->write_fraction = json_get_number(record, "write_fraction", 0);
+    spec->accesses = (size_t)json_get_number(record, "accesses", 0);
+}
+
+static void read_sample(cache_miss_sample_t *sample, const json_value_t *record) {
+    memset(sample, 0, sizeof(*sample));
+    sample->instruction_addr = (uint64_t)json_get_number(record, "ip", 0);
+    sample->memory_addr = (uint64_t)json_get_number(record, "addr", 0);
+    sample->timestamp = (uint64_t)json_get_number(record, "time", 0);
+    sample->cpu_id = (int)json_get_number(record, "cpu", 0);
+    sample->tid = (int)json_get_number(record, "tid", 0);
+    sample->access_size = (int)json_get_number(record, "size", 8);
+    const json_value_t *write = json_get(record, "write");
+    sample->is_write = write && write->type == JSON_BOOL && write->boolean;
+    sample->cache_level_missed = (int)json_get_number(record, "level", 1);
+    sample->latency_cycles = (uint64_t)json_get_number(record, "latency", 0);
+    strncpy(sample->source_loc.file, json_get_string(record, "file", ""),
+            sizeof(sample->source_loc.file) - 1);
+    sample->source_loc.line = (int)json_get_number(record, "line", 0);
+    strncpy(sample->source_loc.function, json_get_string(record, "function", ""),
+            sizeof(sample->source_loc.function) - 1);
+}
+
+int workload_load_stream(const char *path, workload_spec_t *spec,
+                         cache_miss_sample_t **samples, int *count) {
+    if (!path || !samples || !count) {
+        LOG_ERROR("Invalid parameters for workload_load_stream");
+        return -1;
+    }
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        LOG_ERROR("%s is empty or unreadable", path);
+        close(fd);
+        return -1;
+    }
+    size_t length = (size_t)st.st_size;
+    const char *text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED) {
+        LOG_ERROR("Cannot map %s: %s", path, strerror(errno));
+        return -1;
+    }
+    madvise((void *)text, length, MADV_SEQUENTIAL);
+    
+    // One record per line, so the line count bounds the samples
+    size_t lines = 1;
+    for (const char *p = text; (p = memchr(p, '\n', length - (p - text))) != NULL; p++) {
+        lines++;
+    }
+    
+    cache_miss_sample_t *buffer = MALLOC_LOGGED(lines * sizeof(cache_miss_sample_t));
+    arena_t *scratch = arena_create(0);
+    if (!buffer || !scratch) {
+        if (buffer) FREE_LOGGED(buffer);
+        arena_destroy(scratch);
+        munmap((void *)text, length);
+        return -1;
+    }
+    
+    int loaded = 0;
+    int line_number = 0;
+    bool have_header = false;
+    size_t pos = 0;
+    while (pos < length) {
+        const char *newline = memchr(text + pos, '\n', length - pos);
+        size_t line_length = newline ? (size_t)(newline - (text + pos)) : length - pos;
+        line_number++;
+        
+        if (line_length > 0) {
+            json_value_t *record = json_parse(scratch, text + pos, line_length, NULL);
+            if (!record) {
+                LOG_ERROR("%s:%d: malformed record", path, line_number);
+                FREE_LOGGED(buffer);
+                arena_destroy(scratch);
+                munmap((void *)text, length);
+                return -1;
+            }
+            
+            const char *kind = json_get_string(record, "record", "");
+            if (strcmp(kind, "sample") == 0) {
+                read_sample(&buffer[loaded++], record);
+            } else if (strcmp(kind, "workload") == 0) {
+                if (spec) read_spec(spec, record);
+                have_header = true;
+            }
+            arena_reset(scratch);
+        }
+        pos += line_length + 1;
+    }
+    
+    arena_destroy(scratch);
+    munmap((void *)text, length);
+    
+    if (!have_header) {
+        LOG_WARNING("%s has no workload header; ground truth unknown", path);
+        if (spec) memset(spec, 0, sizeof(*spec));
+    }
+    
+    *samples = buffer;
+    *count = loaded;
+    LOG_INFO("Loaded %d samples from %s", loaded, path);
+    return 0;
+}
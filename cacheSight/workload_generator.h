@@ -0,0 +1,62 @@
+#ifndef WORKLOAD_GENERATOR_H
+#define WORKLOAD_GENERATOR_H
+
+#include "common.h"
+#include "perf_sampler.h"
+#include "hardware_detector.h"
+
+#define WORKLOAD_HOT_LINE 100           // Source line of the graded access in every kernel
+#define WORKLOAD_MAX_THREADS 16
+#define WORKLOAD_MAX_SAMPLES 1000000    // Miss records kept per stream
+
+// What a workload is built to exhibit
+typedef enum {
+    WORKLOAD_ACCESS_PATTERN,            // Graded on the hotspot's access_pattern_t
+    WORKLOAD_ANTIPATTERN                // Graded on the classified cache_antipattern_t
+} workload_kind_t;
+
+// Parameterized synthetic workload with known ground truth
+typedef struct {
+    char name[64];                      // Also the kernel's file stem
+    workload_kind_t kind;
+    access_pattern_t access;            // Ground-truth access pattern
+    cache_antipattern_t antipattern;    // Ground truth for WORKLOAD_ANTIPATTERN
+    size_t element_size;                // Bytes per access
+    size_t stride_bytes;                // Distance between consecutive accesses
+    size_t footprint_bytes;             // Bytes walked per thread
+    int threads;
+    int false_sharing_offset;           // Bytes between per-thread counters on one line
+    size_t conflict_stride;             // Power-of-two distance between conflicting rows
+    int conflict_ways;                  // Rows that map to one set
+    int code_sites;                     // Distinct instruction sites
+    double write_fraction;
+    size_t accesses;                    // Accesses per thread
+} workload_spec_t;
+
+// API functions
+// One workload per access_pattern_t and per cache_antipattern_t, sized
+// against cache_info; returns the number written to specs
+int workload_suite_default(const cache_info_t *cache_info, workload_spec_t *specs, int capacity);
+
+// Ground-truth miss stream: the accesses the kernel makes that leave the
+// line the same site and thread touched last, attributed to the kernel's
+// source lines. Samples are MALLOC_LOGGED.
+int workload_generate(const workload_spec_t *spec, const cache_info_t *cache_info,
+                      cache_miss_sample_t **samples, int *count);
+
+// Standalone pthread C program doing the same accesses, for live profiling;
+// the graded access sits on WORKLOAD_HOT_LINE
+int workload_emit_kernel(const workload_spec_t *spec, const char *path);
+
+// NDJSON stream: a workload header record followed by one record per sample.
+// main's --replay reads these in place of a perf session.
+int workload_save_stream(const workload_spec_t *spec, const cache_miss_sample_t *samples,
+                         int count, const char *path);
+int workload_load_stream(const char *path, workload_spec_t *spec,
+                         cache_miss_sample_t **samples, int *count);
+
+// Helper functions
+const char* workload_kind_to_string(workload_kind_t kind);
+void workload_source_file(const workload_spec_t *spec, char *buffer, size_t size);
+
+#endif // WORKLOAD_GENERATOR_H